@@ -0,0 +1,74 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TestSupport.h
+ * Description: Scratch directories, file writers, polling and timing shared by the test programs
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// Empty per-process scratch directory under the system temp dir, e.g. caithe_<name>_<pid>
+inline std::filesystem::path makeTempRoot(const std::string& name) {
+    const std::filesystem::path root =
+        std::filesystem::temp_directory_path() / ("caithe_" + name + "_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    return root;
+}
+
+// Both writers create missing parent directories
+inline void writeFile(const std::filesystem::path& path, const std::string& content) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+}
+
+inline void writeFile(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+// stbi_write_*_to_func sink collecting the encoded bytes
+inline void appendToVector(void* context, void* data, int size) {
+    auto* out = static_cast<std::vector<uint8_t>*>(context);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+// Poll until the predicate holds; false once the limit passes
+template <class Predicate>
+bool waitFor(Predicate predicate, std::chrono::milliseconds limit = std::chrono::milliseconds(5000)) {
+    const auto deadline = std::chrono::steady_clock::now() + limit;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// Wall-clock timer for the benchmarks; elapsed() reads milliseconds, elapsed<std::micro>() microseconds
+class Stopwatch {
+public:
+    Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+    void restart() { m_start = std::chrono::steady_clock::now(); }
+
+    template <class Unit = std::milli>
+    double elapsed() const {
+        return std::chrono::duration<double, Unit>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
@@ -0,0 +1,228 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_batch_probe.cpp
+ * Description: Tests for io_uring batch header probing and its worker fallback
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "../src/library/BatchProbe.h"
+#include "../src/utils/TaskScheduler.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+static void append16(std::vector<uint8_t>& out, int value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// PNG signature and IHDR padded to `size` bytes
+static std::vector<uint8_t> makePng(uint32_t width, uint32_t height, size_t size) {
+    std::vector<uint8_t> data = {
+        0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A,
+        0, 0, 0, 13, 'I', 'H', 'D', 'R',
+        static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16),
+        static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+        static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16),
+        static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+        8, 6, 0, 0, 0,
+        0, 0, 0, 0
+    };
+    data.resize(std::max(size, data.size()), 0);
+    return data;
+}
+
+// JPEG whose frame header sits behind `paddingBytes` of APP2 segments (an ICC profile)
+static std::vector<uint8_t> makeJpeg(int width, int height, size_t paddingBytes) {
+    std::vector<uint8_t> jpeg = {0xFF, 0xD8};
+    while (paddingBytes > 0) {
+        const size_t chunk = std::min<size_t>(paddingBytes, 60000);
+        jpeg.push_back(0xFF);
+        jpeg.push_back(0xE2);
+        append16(jpeg, static_cast<int>(chunk + 2));
+        jpeg.insert(jpeg.end(), chunk, 0xA5);
+        paddingBytes -= chunk;
+    }
+    jpeg.push_back(0xFF);
+    jpeg.push_back(0xC0);
+    append16(jpeg, 11);
+    jpeg.push_back(8);
+    append16(jpeg, height);
+    append16(jpeg, width);
+    jpeg.push_back(1);
+    jpeg.insert(jpeg.end(), {1, 0x11, 0});
+    jpeg.insert(jpeg.end(), {0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00});
+    return jpeg;
+}
+
+// A mix of PNGs, JPEGs with headers past the first read, and files that cannot be probed
+static std::vector<std::string> makeLibrary(const fs::path& dir, size_t count) {
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < count; ++i) {
+        const fs::path path = dir / ("wall_" + std::to_string(i));
+        switch (i % 10) {
+            case 7:
+                writeFile(path.string() + ".jpg", makeJpeg(1920 + static_cast<int>(i), 1080, 150000));
+                paths.push_back(path.string() + ".jpg");
+                break;
+            case 8:
+                writeFile(path.string() + ".txt", std::vector<uint8_t>(100, 'x'));
+                paths.push_back(path.string() + ".txt");
+                break;
+            case 9:
+                paths.push_back(path.string() + ".missing.png");
+                break;
+            default:
+                writeFile(path.string() + ".png", makePng(static_cast<uint32_t>(100 + i), 50, 1000 + 97 * i));
+                paths.push_back(path.string() + ".png");
+                break;
+        }
+    }
+    writeFile(dir / "empty.png", std::string());
+    paths.push_back((dir / "empty.png").string());
+    return paths;
+}
+
+static void checkAgainstProbeFile(const std::vector<std::string>& paths, const std::vector<ProbeResult>& results) {
+    ImageProbe probe;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ImageHeader header;
+        const bool ok = probe.probeFile(paths[i], header);
+        assert(results[i].index == i && results[i].ok == ok);
+        if (ok) {
+            assert(results[i].header.format == header.format);
+            assert(results[i].header.width == header.width && results[i].header.height == header.height);
+        } else {
+            assert(results[i].error == probe.getLastErrorCode());
+        }
+    }
+}
+
+void testBackends() {
+    std::cout << "Testing batch probing..." << std::endl;
+
+    const fs::path dir = makeTempRoot("batch_probe");
+    const std::vector<std::string> paths = makeLibrary(dir, 600);
+    TaskScheduler scheduler(4);
+
+    std::vector<BatchProbe::Backend> backends = { BatchProbe::Backend::Threads };
+    if (BatchProbe::isIoUringAvailable()) {
+        backends.push_back(BatchProbe::Backend::IoUring);
+    } else {
+        std::cout << "  io_uring not available here; only the worker fallback is tested" << std::endl;
+    }
+
+    for (const BatchProbe::Backend backend : backends) {
+        const char* name = backend == BatchProbe::Backend::IoUring ? "io_uring" : "workers";
+        BatchProbe batch(64);
+        assert(batch.setBackend(backend) && batch.getBackend() == backend);
+
+        std::vector<ProbeResult> results;
+        assert(batch.probe(paths, scheduler, IoClass::Background, [&](const ProbeResult& result) {
+            results.push_back(result);
+        }, BatchProbe::Order::Input));
+        assert(results.size() == paths.size());
+        checkAgainstProbeFile(paths, results);
+
+        const BatchProbe::Stats stats = batch.getStats();
+        assert(stats.files == paths.size() && stats.probed == 480);
+        assert(stats.followUpReads == 60);      // Every JPEG's frame header is past 64 KiB
+        assert(results[9].systemError == ENOENT && results[8].error == ImageProbe::ErrorCode::UnknownFormat);
+        assert(results.back().error == ImageProbe::ErrorCode::ReadFailed);
+        std::cout << "  ✓ " << name << ": input order, same headers and errors as probeFile()" << std::endl;
+
+        std::vector<size_t> seen;
+        batch.probe(paths, scheduler, IoClass::Background, [&](const ProbeResult& result) {
+            seen.push_back(result.index);
+        });
+        std::sort(seen.begin(), seen.end());
+        for (size_t i = 0; i < seen.size(); ++i) {
+            assert(seen[i] == i);
+        }
+        assert(seen.size() == paths.size());
+        std::cout << "  ✓ " << name << ": completion order reports every file once" << std::endl;
+
+        if (backend == BatchProbe::Backend::IoUring) {
+            assert(batch.getStats().peakInFlight == 64);
+            assert(batch.getStats().ringEnters < paths.size());
+            std::cout << "  ✓ io_uring: 64 files in flight, " << batch.getStats().ringEnters
+                      << " io_uring_enter calls for " << paths.size() << " files" << std::endl;
+        }
+    }
+
+    BatchProbe empty;
+    size_t calls = 0;
+    assert(empty.probe({}, scheduler, IoClass::Background, [&](const ProbeResult&) { ++calls; }) && calls == 0);
+    std::cout << "  ✓ An empty batch does nothing" << std::endl;
+
+    fs::remove_all(dir);
+    std::cout << "✓ Batch probing tests passed" << std::endl;
+}
+
+void benchmarkBatchProbe() {
+    std::cout << "Benchmarking header probing (10000 warm files)..." << std::endl;
+
+    const fs::path dir = makeTempRoot("batch_bench");
+    std::vector<std::string> paths;
+    for (int i = 0; i < 10000; ++i) {
+        const fs::path path = dir / ("wall_" + std::to_string(i) + ".png");
+        writeFile(path, makePng(3840, 2160, 4096));
+        paths.push_back(path.string());
+    }
+    TaskScheduler scheduler;
+
+    Stopwatch timer;
+    ImageProbe probe;
+    size_t probed = 0;
+    for (const std::string& path : paths) {
+        ImageHeader header;
+        probed += probe.probeFile(path, header) ? 1 : 0;
+    }
+    const double sequentialMs = timer.elapsed();
+    assert(probed == paths.size());
+    std::cout << "  probeFile one at a time: " << sequentialMs << " ms" << std::endl;
+
+    std::vector<BatchProbe::Backend> backends = { BatchProbe::Backend::Threads };
+    if (BatchProbe::isIoUringAvailable()) {
+        backends.push_back(BatchProbe::Backend::IoUring);
+    }
+    for (const BatchProbe::Backend backend : backends) {
+        BatchProbe batch;
+        batch.setBackend(backend);
+        probed = 0;
+        timer.restart();
+        batch.probe(paths, scheduler, IoClass::Background, [&](const ProbeResult& result) {
+            probed += result.ok ? 1 : 0;
+        });
+        const double ms = timer.elapsed();
+        assert(probed == paths.size());
+        std::cout << "  BatchProbe (" << (backend == BatchProbe::Backend::IoUring ? "io_uring" : "workers")
+                  << "): " << ms << " ms (" << sequentialMs / ms << "x)" << std::endl;
+    }
+
+    fs::remove_all(dir);
+    std::cout << "✓ Batch probe benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing batch header probing..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testBackends();
+        benchmarkBatchProbe();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All batch probe tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Batch probe test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
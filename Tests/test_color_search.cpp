@@ -0,0 +1,301 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_color_search.cpp
+ * Description: Tests for CIELAB color signatures and color-similarity search, plus 100k-image benchmark
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/library/ColorIndex.h"
+#include "../src/library/ColorSignature.h"
+#include "../src/library/LibraryIndex.h"
+#include "../src/utils/TaskScheduler.h"
+#include "TestSupport.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace fs = std::filesystem;
+
+static bool near(float value, float expected, float tolerance) {
+    return std::fabs(value - expected) <= tolerance;
+}
+
+// Horizontal bands of the given colors, heights proportional to the shares
+static ImageBuffer makeBands(int width, int height, const std::vector<std::array<uint8_t, 3>>& colors,
+                             const std::vector<float>& shares) {
+    ImageBuffer image;
+    image.allocate(width, height, 3);
+    int y = 0;
+    for (size_t c = 0; c < colors.size(); ++c) {
+        const int end = c + 1 == colors.size() ? height : y + static_cast<int>(std::lround(shares[c] * height));
+        for (; y < end; ++y) {
+            uint8_t* row = image.row(y);
+            for (int x = 0; x < width; ++x) {
+                std::copy(colors[c].begin(), colors[c].end(), row + x * 3);
+            }
+        }
+    }
+    return image;
+}
+
+static ColorSignature randomSignature(std::mt19937& rng) {
+    ColorSignature signature;
+    const int used = 1 + static_cast<int>(rng() % ColorSignature::PALETTE_SIZE);
+    for (int s = 0; s < ColorSignature::PALETTE_SIZE; ++s) {
+        if (s < used) {
+            signature.palette[s].l = static_cast<uint8_t>(rng());
+            signature.palette[s].a = static_cast<int8_t>(static_cast<int>(rng() % 200) - 100);
+            signature.palette[s].b = static_cast<int8_t>(static_cast<int>(rng() % 200) - 100);
+            signature.palette[s].weight = static_cast<uint8_t>(1 + rng() % 255);
+        } else {
+            signature.palette[s] = signature.palette[0];
+            signature.palette[s].weight = 0;
+        }
+    }
+    return signature;
+}
+
+void testLabConversion() {
+    std::cout << "Testing sRGB to CIELAB conversion..." << std::endl;
+
+    LabColor white = ColorAnalyzer::srgbToLab(255, 255, 255);
+    assert(near(white.l, 100.0f, 0.01f) && near(white.a, 0.0f, 0.01f) && near(white.b, 0.0f, 0.01f));
+    LabColor black = ColorAnalyzer::srgbToLab(0, 0, 0);
+    assert(near(black.l, 0.0f, 0.01f));
+    LabColor red = ColorAnalyzer::srgbToLab(255, 0, 0);
+    assert(near(red.l, 53.24f, 0.05f) && near(red.a, 80.09f, 0.05f) && near(red.b, 67.20f, 0.05f));
+    LabColor blue = ColorAnalyzer::srgbToLab(0, 0, 255);
+    assert(near(blue.l, 32.30f, 0.05f) && near(blue.a, 79.19f, 0.05f) && near(blue.b, -107.86f, 0.05f));
+    std::cout << "  ✓ Reference colors match published Lab values" << std::endl;
+
+    LabColor theme;
+    assert(ColorAnalyzer::parseHexColor("#1e1e2e", theme));
+    const LabColor direct = ColorAnalyzer::srgbToLab(0x1e, 0x1e, 0x2e);
+    assert(theme.l == direct.l && theme.a == direct.a && theme.b == direct.b);
+    assert(ColorAnalyzer::parseHexColor("FFF", theme) && near(theme.l, 100.0f, 0.01f));
+    for (const char* bad : {"", "#", "#12345", "#12345g", "1e1e2e2"}) {
+        assert(!ColorAnalyzer::parseHexColor(bad, theme));
+    }
+    std::cout << "  ✓ Hex theme colors parse, malformed ones are rejected" << std::endl;
+
+    std::cout << "✓ Lab conversion tests passed" << std::endl;
+}
+
+void testSignatures() {
+    std::cout << "Testing palette signatures..." << std::endl;
+
+    ColorAnalyzer analyzer;
+    ColorSignature signature;
+    assert(analyzer.computeSignature(makeBands(200, 100, {{{30, 30, 46}}}, {1.0f}), signature));
+    assert(signature.palette[0].weight == 255);
+    for (int s = 1; s < ColorSignature::PALETTE_SIZE; ++s) {
+        assert(signature.palette[s].weight == 0);
+    }
+    LabColor theme;
+    ColorAnalyzer::parseHexColor("#1e1e2e", theme);
+    assert(ColorAnalyzer::distance(signature, ColorSignature::fromColor(theme)) < 1.0f);
+    std::cout << "  ✓ A flat image is a one-color palette" << std::endl;
+
+    // 60% navy, 30% orange, 10% white
+    const ImageBuffer bands = makeBands(300, 200, {{{20, 30, 80}}, {{240, 140, 20}}, {{255, 255, 255}}},
+                                        {0.6f, 0.3f, 0.1f});
+    assert(analyzer.computeSignature(bands, signature));
+    assert(near(signature.palette[0].weight, 153.0f, 4.0f));
+    assert(near(signature.palette[1].weight, 77.0f, 4.0f));
+    assert(near(signature.palette[2].weight, 26.0f, 4.0f));
+    const LabColor navy = ColorAnalyzer::srgbToLab(20, 30, 80);
+    const LabColor dominant = signature.color(0);
+    assert(near(dominant.l, navy.l, 2.0f) && near(dominant.a, navy.a, 2.0f) && near(dominant.b, navy.b, 2.0f));
+    std::cout << "  ✓ Dominant colors and their shares recovered in weight order" << std::endl;
+
+    // The same scene at another size and band order is still the closest match
+    ColorSignature resized;
+    ColorSignature other;
+    assert(analyzer.computeSignature(makeBands(64, 48, {{{255, 255, 255}}, {{240, 140, 20}}, {{20, 30, 80}}},
+                                               {0.1f, 0.3f, 0.6f}), resized));
+    assert(analyzer.computeSignature(makeBands(300, 200, {{{200, 40, 40}}, {{40, 160, 60}}}, {0.5f, 0.5f}), other));
+    assert(ColorAnalyzer::distance(signature, signature) == 0.0f);
+    assert(ColorAnalyzer::distance(signature, resized) < 3.0f);
+    assert(ColorAnalyzer::distance(signature, other) > 30.0f);
+    assert(ColorAnalyzer::distance(signature, other) == ColorAnalyzer::distance(other, signature));
+    std::cout << "  ✓ Distance is symmetric and ignores size and layout" << std::endl;
+
+    ImageBuffer empty;
+    assert(!analyzer.computeSignature(empty, signature));
+    assert(analyzer.getLastErrorCode() == ColorAnalyzer::ErrorCode::InvalidImage);
+    std::cout << "  ✓ Empty images are rejected" << std::endl;
+
+    std::cout << "✓ Signature tests passed" << std::endl;
+}
+
+void testColorIndex() {
+    std::cout << "Testing color index search..." << std::endl;
+
+    std::mt19937 rng(9);
+    for (size_t count : {size_t(0), size_t(1), size_t(5), size_t(1025), size_t(3000)}) {
+        std::vector<ColorSignature> signatures;
+        for (size_t i = 0; i < count; ++i) {
+            signatures.push_back(randomSignature(rng));
+        }
+        ColorIndex index;
+        index.build(signatures);
+        assert(index.size() == count);
+
+        for (int q = 0; q < 10; ++q) {
+            const ColorSignature query = q % 2 ? randomSignature(rng)
+                : ColorSignature::fromColor({static_cast<float>(rng() % 100), 10.0f, -20.0f});
+            std::vector<float> distances(count);
+            index.distances(query, distances.data());
+            for (size_t i = 0; i < count; ++i) {
+                assert(near(distances[i], ColorAnalyzer::distance(signatures[i], query), 1e-3f));
+            }
+
+            std::vector<uint32_t> order(count);
+            for (uint32_t i = 0; i < count; ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return distances[a] != distances[b] ? distances[a] < distances[b] : a < b;
+            });
+            std::vector<ColorMatch> matches;
+            index.nearest(query, 12, matches);
+            assert(matches.size() == std::min<size_t>(12, count));
+            for (size_t m = 0; m < matches.size(); ++m) {
+                assert(matches[m].id == order[m] && matches[m].distance == distances[order[m]]);
+            }
+        }
+    }
+    std::cout << "  ✓ SIMD distances and top-k match the scalar reference" << std::endl;
+
+    std::cout << "✓ Color index tests passed" << std::endl;
+}
+
+void testLibraryColors() {
+    std::cout << "Testing color search on an indexed library..." << std::endl;
+
+    const fs::path root = makeTempRoot("colors");
+
+    auto write = [&root](const std::string& name, const ImageBuffer& image) {
+        std::vector<uint8_t> encoded;
+        assert(stbi_write_png_to_func(appendToVector, &encoded, image.width, image.height, 3,
+                                      image.pixels.data(), static_cast<int>(image.stride)) != 0);
+        const std::string path = (root / name).string();
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(encoded.data()),
+                                                    static_cast<std::streamsize>(encoded.size()));
+        return path;
+    };
+    const std::string mocha = write("mocha.png", makeBands(320, 180, {{{30, 30, 46}}, {{137, 180, 250}}}, {0.85f, 0.15f}));
+    const std::string night = write("night.png", makeBands(320, 180, {{{24, 24, 37}}, {{203, 166, 247}}}, {0.8f, 0.2f}));
+    const std::string sunset = write("sunset.png", makeBands(320, 180, {{{250, 150, 60}}, {{200, 60, 80}}}, {0.5f, 0.5f}));
+    const std::string forest = write("forest.png", makeBands(320, 180, {{{30, 90, 40}}, {{120, 160, 80}}}, {0.6f, 0.4f}));
+
+    TaskScheduler scheduler(2);
+    LibraryIndex index;
+    assert(index.indexDirectory(root.string(), scheduler));
+    assert(index.findContent(mocha)->hasColors);
+
+    LabColor theme;
+    assert(ColorAnalyzer::parseHexColor("#1e1e2e", theme));
+    std::vector<ColorSimilarImage> matches = index.findByColor(theme, 2);
+    assert(matches.size() == 2 && matches[0].path == mocha && matches[1].path == night);
+    assert(matches[0].distance < matches[1].distance);
+    std::cout << "  ✓ Theme color #1e1e2e ranks dark-navy wallpapers first" << std::endl;
+
+    matches = index.findSimilarColors(mocha, 3);
+    assert(matches.size() == 3 && matches[0].path == night);
+    assert(std::none_of(matches.begin(), matches.end(), [&](const ColorSimilarImage& m) { return m.path == mocha; }));
+    std::cout << "  ✓ \"Similar colors\" excludes the query and ranks the closest palette first" << std::endl;
+
+    const std::string indexPath = (root / "library.idx").string();
+    assert(index.save(indexPath));
+    LibraryIndex loaded;
+    assert(loaded.load(indexPath));
+    const ColorSignature& before = index.findContent(sunset)->colors;
+    const ColorSignature& after = loaded.findContent(sunset)->colors;
+    assert(loaded.findContent(sunset)->hasColors && ColorAnalyzer::distance(before, after) == 0.0f);
+    assert(loaded.findByColor(theme, 1)[0].path == mocha);
+    std::cout << "  ✓ Signatures persist in the library index" << std::endl;
+
+    assert(index.removeFile(night));
+    assert(index.findSimilarColors(mocha, 1)[0].path != night);
+    assert(index.findSimilarColors(forest + ".missing", 3).empty());
+    std::cout << "  ✓ Searches follow index changes" << std::endl;
+
+    fs::remove_all(root);
+    std::cout << "✓ Library color tests passed" << std::endl;
+}
+
+void benchmarkColorSearch() {
+    std::cout << "Benchmarking color search over 100k images..." << std::endl;
+
+    std::mt19937 rng(42);
+    std::vector<ColorSignature> signatures;
+    for (int i = 0; i < 100000; ++i) {
+        signatures.push_back(randomSignature(rng));
+    }
+    ColorIndex index;
+    Stopwatch buildTimer;
+    index.build(signatures);
+    const double buildMs = buildTimer.elapsed();
+
+    LabColor theme;
+    ColorAnalyzer::parseHexColor("#1e1e2e", theme);
+    const ColorSignature themeQuery = ColorSignature::fromColor(theme);
+    std::vector<ColorMatch> matches;
+    const int iterations = 100;
+    Stopwatch timer;
+    for (int i = 0; i < iterations; ++i) {
+        index.nearest(themeQuery, 20, matches);
+    }
+    const double themeUs = timer.elapsed<std::micro>() / iterations;
+
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        index.nearest(signatures[i], 20, matches);
+    }
+    const double paletteUs = timer.elapsed<std::micro>() / iterations;
+
+    ColorAnalyzer analyzer;
+    const ImageBuffer thumbnail = makeBands(240, 135, {{{30, 30, 46}}, {{137, 180, 250}}, {{243, 139, 168}}},
+                                            {0.6f, 0.3f, 0.1f});
+    ColorSignature signature;
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        analyzer.computeSignature(thumbnail, signature);
+    }
+    const double signatureUs = timer.elapsed<std::micro>() / iterations;
+
+    std::cout << "  Build: " << buildMs << " ms" << std::endl;
+    std::cout << "  Theme color top-20: " << themeUs << " us" << std::endl;
+    std::cout << "  Full palette top-20: " << paletteUs << " us" << std::endl;
+    std::cout << "  Signature per thumbnail: " << signatureUs << " us" << std::endl;
+    std::cout << "✓ Benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing color signatures and color search..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testLabConversion();
+        testSignatures();
+        testColorIndex();
+        testLibraryColors();
+        benchmarkColorSearch();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All color search tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Color search test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
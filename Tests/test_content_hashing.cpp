@@ -0,0 +1,405 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_content_hashing.cpp
+ * Description: Tests for content hashing, exact-duplicate detection and I/O-class scheduling
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/library/ContentHasher.h"
+#include "../src/library/LibraryIndex.h"
+#include "../src/utils/FileUtils.h"
+#include "../src/utils/TaskScheduler.h"
+#include "../src/utils/Xxh64.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+// PNG signature and IHDR followed by random bytes: probes as a PNG of the given size
+static std::vector<uint8_t> makePngLike(uint32_t width, uint32_t height, size_t size, uint32_t seed) {
+    std::vector<uint8_t> data = {
+        0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A,
+        0, 0, 0, 13, 'I', 'H', 'D', 'R',
+        static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16),
+        static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+        static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16),
+        static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+        8, 6, 0, 0, 0,
+        0, 0, 0, 0
+    };
+    std::mt19937 rng(seed);
+    while (data.size() < size) {
+        data.push_back(static_cast<uint8_t>(rng()));
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::vector<std::string> listImages(const std::vector<fs::path>& dirs) {
+    std::vector<std::string> paths;
+    for (const fs::path& dir : dirs) {
+        for (const std::string& path : FileUtils::getImageFilesInDirectory(dir.string())) {
+            paths.push_back(path);
+        }
+    }
+    return paths;
+}
+
+void testXxh64() {
+    std::cout << "Testing XXH64..." << std::endl;
+
+    const char* phrase = "Nobody inspects the spammish repetition";
+    assert(Xxh64::hash("", 0) == 0xEF46DB3751D8E999ULL);
+    assert(Xxh64::hash("a", 1) == 0xD24EC4F1A98C6E5BULL);
+    assert(Xxh64::hash("abc", 3) == 0x44BC2CF5AD770999ULL);
+    assert(Xxh64::hash(phrase, std::strlen(phrase)) == 0xFBCEA83C8A378BF1ULL);
+    std::cout << "  ✓ Reference vectors" << std::endl;
+
+    // Streaming in arbitrary pieces must equal the one-shot digest
+    const std::vector<uint8_t> data = makePngLike(1, 1, 10007, 3);
+    std::mt19937 rng(11);
+    for (uint64_t seed : {0ULL, 1ULL, 0x123456789ULL}) {
+        const uint64_t expected = Xxh64::hash(data.data(), data.size(), seed);
+        for (int trial = 0; trial < 20; ++trial) {
+            Xxh64 stream(seed);
+            size_t offset = 0;
+            while (offset < data.size()) {
+                const size_t piece = std::min<size_t>(data.size() - offset, rng() % 97);
+                stream.update(data.data() + offset, piece);
+                offset += piece;
+            }
+            assert(stream.digest() == expected);
+        }
+    }
+    std::cout << "  ✓ Streaming matches one-shot" << std::endl;
+
+    std::cout << "✓ XXH64 tests passed" << std::endl;
+}
+
+void testContentHasher() {
+    std::cout << "Testing ContentHasher..." << std::endl;
+
+    const fs::path dir = makeTempRoot("hasher");
+    const size_t chunk = ContentHasher::SAMPLE_CHUNK_BYTES;
+
+    // Small files are read whole and get the full hash immediately
+    writeFile(dir / "small.png", makePngLike(8, 8, 3 * chunk, 1));
+    ContentHasher hasher;
+    ContentHash small;
+    assert(hasher.hashSample((dir / "small.png").string(), small));
+    assert(small.size == 3 * chunk && small.hasFull);
+    assert(hasher.getBytesRead() == 3 * chunk);
+    std::cout << "  ✓ Small files hashed in one read" << std::endl;
+
+    // Large files read exactly three chunks for the sample
+    std::vector<uint8_t> large = makePngLike(8, 8, 1 << 20, 2);
+    writeFile(dir / "large.png", large);
+    std::vector<uint8_t> hidden = large;
+    hidden[100000] ^= 0xFF;                     // Outside head, middle and tail chunks
+    writeFile(dir / "hidden.png", hidden);
+    std::vector<uint8_t> tail = large;
+    tail.back() ^= 0xFF;
+    writeFile(dir / "tail.png", tail);
+
+    ContentHasher sampler;
+    ContentHash a, b, c;
+    assert(sampler.hashSample((dir / "large.png").string(), a));
+    assert(sampler.getBytesRead() == 3 * chunk && !a.hasFull);
+    assert(sampler.hashSample((dir / "hidden.png").string(), b));
+    assert(sampler.hashSample((dir / "tail.png").string(), c));
+    assert(a.sample == b.sample);
+    assert(a.sample != c.sample);
+    std::cout << "  ✓ Sample covers head, middle and tail only" << std::endl;
+
+    assert(sampler.hashFull((dir / "large.png").string(), a));
+    assert(sampler.hashFull((dir / "hidden.png").string(), b));
+    assert(a.hasFull && b.hasFull && a.full != b.full);
+    assert(a.full == Xxh64::hash(large.data(), large.size()));
+    std::cout << "  ✓ Full hash separates sample collisions" << std::endl;
+
+    // Size change between the passes is detected
+    ContentHash stale;
+    assert(sampler.hashSample((dir / "tail.png").string(), stale));
+    tail.resize(tail.size() - 1);
+    writeFile(dir / "tail.png", tail);
+    assert(!sampler.hashFull((dir / "tail.png").string(), stale));
+    assert(sampler.getLastErrorCode() == ContentHasher::ErrorCode::FileChanged);
+
+    ContentHash missing;
+    assert(!sampler.hashSample((dir / "missing.png").string(), missing));
+    assert(sampler.getLastErrorCode() == ContentHasher::ErrorCode::FileNotFound);
+    std::cout << "  ✓ Changed and missing files reported" << std::endl;
+
+    fs::remove_all(dir);
+    std::cout << "✓ ContentHasher tests passed" << std::endl;
+}
+
+void testDuplicateDetection() {
+    std::cout << "Testing duplicate detection..." << std::endl;
+
+    const fs::path dir = makeTempRoot("library");
+    const std::vector<uint8_t> photo = makePngLike(3840, 2160, 1 << 20, 10);
+    std::vector<uint8_t> lookalike = photo;
+    lookalike[200000] ^= 0x01;                  // Same sample, different content
+    const std::vector<uint8_t> unique = makePngLike(2560, 1440, 700000, 11);
+    const std::vector<uint8_t> icon = makePngLike(64, 64, 4096, 12);
+
+    writeFile(dir / "a" / "photo.png", photo);
+    writeFile(dir / "b" / "photo copy.png", photo);
+    writeFile(dir / "b" / "lookalike.png", lookalike);
+    writeFile(dir / "a" / "unique.png", unique);
+    writeFile(dir / "a" / "icon.png", icon);
+    writeFile(dir / "b" / "icon.png", icon);
+
+    TaskScheduler scheduler(4);
+    LibraryIndex index;
+    const std::vector<std::string> paths = listImages({dir / "a", dir / "b"});
+    assert(paths.size() == 6);
+    assert(index.indexFiles(paths, scheduler));
+
+    const LibraryIndex::IndexStats& stats = index.getLastIndexStats();
+    assert(stats.sampleHashed == 6 && stats.reused == 0 && stats.failed == 0);
+    assert(stats.fullHashed == 3);              // Two photo copies and the lookalike
+    assert(index.getContents().size() == 4);
+    assert(stats.probed == 4);                  // One probe per content, not per file
+    assert(stats.duplicateFiles == 2);
+    std::cout << "  ✓ Only sample collisions are fully hashed" << std::endl;
+
+    const std::string photoA = (dir / "a" / "photo.png").string();
+    const std::string photoB = (dir / "b" / "photo copy.png").string();
+    const std::string lookalikePath = (dir / "b" / "lookalike.png").string();
+    assert(index.getDuplicates(photoA) == std::vector<std::string>{photoB});
+    assert(index.getDuplicates(lookalikePath).empty());
+    assert(index.getDuplicateGroups().size() == 2);
+    assert(index.findContent(photoA) == index.findContent(photoB));
+    assert(index.getContentKey(photoA) == index.getContentKey(photoB));
+    assert(index.getContentKey(photoA) != index.getContentKey(lookalikePath));
+    assert(index.getContentKey((dir / "a" / "icon.png").string()) ==
+           index.getContentKey((dir / "b" / "icon.png").string()));
+    std::cout << "  ✓ Copies share content record and cache key" << std::endl;
+
+    const LibraryContent* content = index.findContent(photoB);
+    assert(content->probed && content->header.format == ImageFormat::Png);
+    assert(content->header.width == 3840 && content->header.height == 2160);
+    assert(index.findContent((dir / "a" / "unique.png").string())->header.width == 2560);
+    std::cout << "  ✓ Metadata probed once and shared" << std::endl;
+
+    // A second pass over unchanged files does no hashing or probing
+    assert(index.indexFiles(paths, scheduler));
+    assert(index.getLastIndexStats().reused == 6);
+    assert(index.getLastIndexStats().sampleHashed == 0);
+    assert(index.getLastIndexStats().probed == 0);
+    assert(index.getLastIndexStats().bytesRead == 0);
+    assert(index.getDuplicates(photoA) == std::vector<std::string>{photoB});
+    std::cout << "  ✓ Unchanged files reuse their hashes" << std::endl;
+
+    // Overwriting the lookalike with the photo turns it into a third copy
+    writeFile(dir / "b" / "lookalike.png", photo);
+    fs::last_write_time(dir / "b" / "lookalike.png", fs::file_time_type::clock::now() + std::chrono::seconds(5));
+    assert(index.indexFiles(paths, scheduler));
+    assert(index.getLastIndexStats().sampleHashed == 1);
+    assert(index.getLastIndexStats().probed == 0);      // Joined an already probed content
+    assert(index.getDuplicates(photoA).size() == 2);
+    assert(index.getContents().size() == 3);
+    std::cout << "  ✓ Changed files are rehashed and regrouped" << std::endl;
+
+    // Deleted files fail the pass, are dropped, and leave the others intact
+    fs::remove(dir / "a" / "unique.png");
+    assert(!index.indexFiles(paths, scheduler));
+    assert(index.getLastErrorCode() == LibraryIndex::ErrorCode::FileFailed);
+    assert(index.getLastIndexStats().failed == 1);
+    assert(index.findFile((dir / "a" / "unique.png").string()) == nullptr);
+    assert(index.getFiles().size() == 5);
+
+    assert(index.removeFile(photoB));
+    assert(index.getDuplicates(photoA) == std::vector<std::string>{lookalikePath});
+    assert(index.findContent(photoA)->probed);
+    assert(!index.removeFile(photoB));
+    std::cout << "  ✓ Missing and removed files leave the index consistent" << std::endl;
+
+    // A held class fails the pass at once instead of waiting for tasks that never start
+    const size_t filesBefore = index.getFiles().size();
+    scheduler.setDeferred(IoClass::Background, true);
+    assert(!index.indexFiles(paths, scheduler));
+    assert(index.getLastErrorCode() == LibraryIndex::ErrorCode::Deferred);
+    assert(index.getFiles().size() == filesBefore);
+    assert(index.indexFiles({photoA}, scheduler, IoClass::Interactive));
+    scheduler.setDeferred(IoClass::Background, false);
+    std::cout << "  ✓ Indexing under a held I/O class fails fast" << std::endl;
+
+    fs::remove_all(dir);
+    std::cout << "✓ Duplicate detection tests passed" << std::endl;
+}
+
+void testPersistence() {
+    std::cout << "Testing index persistence..." << std::endl;
+
+    const fs::path dir = makeTempRoot("persist");
+    const std::vector<uint8_t> photo = makePngLike(1920, 1080, 300000, 20);
+    writeFile(dir / "one.png", photo);
+    writeFile(dir / "two.png", photo);
+    writeFile(dir / "three.png", makePngLike(1280, 720, 200000, 21));
+
+    TaskScheduler scheduler(2);
+    LibraryIndex index;
+    assert(index.indexDirectory(dir.string(), scheduler));
+    const std::string indexPath = (dir / "library.idx").string();
+    assert(index.save(indexPath));
+
+    LibraryIndex loaded;
+    assert(loaded.load(indexPath));
+    assert(loaded.getFiles().size() == 3 && loaded.getContents().size() == 2);
+    for (const LibraryFile& file : index.getFiles()) {
+        assert(loaded.getContentKey(file.path) == index.getContentKey(file.path));
+        assert(loaded.findContent(file.path)->header.width == index.findContent(file.path)->header.width);
+    }
+    assert(loaded.getDuplicateGroups() == index.getDuplicateGroups());
+    std::cout << "  ✓ Round trip preserves contents and metadata" << std::endl;
+
+    assert(loaded.indexDirectory(dir.string(), scheduler));
+    assert(loaded.getLastIndexStats().reused == 3 && loaded.getLastIndexStats().bytesRead == 0);
+    std::cout << "  ✓ Loaded index skips unchanged files" << std::endl;
+
+    // Any corruption is caught by the checksum
+    std::vector<uint8_t> bytes;
+    {
+        std::ifstream in(indexPath, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    bytes[bytes.size() / 2] ^= 0x40;
+    writeFile(dir / "corrupt.idx", bytes);
+    LibraryIndex corrupt;
+    assert(!corrupt.load((dir / "corrupt.idx").string()));
+    assert(corrupt.getLastErrorCode() == LibraryIndex::ErrorCode::CorruptIndex);
+    assert(!corrupt.load((dir / "absent.idx").string()));
+    assert(corrupt.getLastErrorCode() == LibraryIndex::ErrorCode::ReadFailed);
+    std::cout << "  ✓ Corrupt and missing index files rejected" << std::endl;
+
+    fs::remove_all(dir);
+    std::cout << "✓ Persistence tests passed" << std::endl;
+}
+
+void testSchedulerClasses() {
+    std::cout << "Testing TaskScheduler I/O classes..." << std::endl;
+
+    // Higher classes are dispatched first
+    {
+        TaskScheduler scheduler(1);
+        std::atomic<bool> release{false};
+        std::vector<int> order;
+        std::mutex orderMutex;
+        scheduler.submit(IoClass::Background, [&] { while (!release) std::this_thread::yield(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        scheduler.submit(IoClass::Idle, [&] { std::lock_guard<std::mutex> l(orderMutex); order.push_back(2); });
+        scheduler.submit(IoClass::Background, [&] { std::lock_guard<std::mutex> l(orderMutex); order.push_back(1); });
+        scheduler.submit(IoClass::Interactive, [&] { std::lock_guard<std::mutex> l(orderMutex); order.push_back(0); });
+        release = true;
+        scheduler.waitIdle();
+        assert((order == std::vector<int>{0, 1, 2}));
+    }
+    std::cout << "  ✓ Priority order Interactive > Background > Idle" << std::endl;
+
+    // Concurrency cap holds even with idle workers available
+    {
+        TaskScheduler scheduler(4);
+        scheduler.setConcurrencyLimit(IoClass::Background, 1);
+        std::atomic<int> running{0};
+        std::atomic<int> peak{0};
+        for (int i = 0; i < 16; ++i) {
+            scheduler.submit(IoClass::Background, [&] {
+                const int now = ++running;
+                int expected = peak.load();
+                while (now > expected && !peak.compare_exchange_weak(expected, now)) {}
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                --running;
+            });
+        }
+        scheduler.waitIdle();
+        assert(peak == 1);
+        assert(scheduler.getStats(IoClass::Background).tasksCompleted == 16);
+    }
+    std::cout << "  ✓ Per-class concurrency cap" << std::endl;
+
+    // Rate limit: 4 MiB/s with a 1 MiB burst; 3 MiB must take at least ~0.5 s
+    {
+        TaskScheduler scheduler(1);
+        scheduler.setRateLimit(IoClass::Background, 4 << 20);
+        Stopwatch timer;
+        for (int i = 0; i < 12; ++i) {
+            scheduler.throttle(IoClass::Background, 256 << 10);
+        }
+        const double ms = timer.elapsed();
+        assert(ms >= 450 && ms < 2000);
+        assert(scheduler.getStats(IoClass::Background).bytesCharged == 3u << 20);
+
+        // Other classes are unaffected
+        timer.restart();
+        scheduler.throttle(IoClass::Interactive, 64 << 20);
+        assert(timer.elapsed() < 50);
+    }
+    std::cout << "  ✓ Token-bucket rate limit per class" << std::endl;
+
+    std::cout << "✓ TaskScheduler tests passed" << std::endl;
+}
+
+void benchmarkIndexing() {
+    std::cout << "Benchmarking library indexing (48 x 2 MiB, 16 duplicated)..." << std::endl;
+
+    const fs::path dir = makeTempRoot("bench");
+    for (int i = 0; i < 32; ++i) {
+        const std::vector<uint8_t> data = makePngLike(3840, 2160, 2 << 20, 100 + i);
+        writeFile(dir / ("wall_" + std::to_string(i) + ".png"), data);
+        if (i < 16) {
+            writeFile(dir / "copies" / ("wall_" + std::to_string(i) + ".png"), data);
+        }
+    }
+
+    TaskScheduler scheduler;
+    LibraryIndex index;
+    const std::vector<std::string> paths = listImages({dir, dir / "copies"});
+
+    Stopwatch timer;
+    assert(index.indexFiles(paths, scheduler));
+    const double ms = timer.elapsed();
+
+    const LibraryIndex::IndexStats& stats = index.getLastIndexStats();
+    assert(stats.duplicateFiles == 16 && stats.fullHashed == 32);
+    std::cout << "  Indexed " << paths.size() << " files in " << ms << " ms, read "
+              << (stats.bytesRead >> 20) << " MiB of " << (paths.size() * 2) << " MiB" << std::endl;
+
+    fs::remove_all(dir);
+    std::cout << "✓ Benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing content hashing and duplicate detection..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testXxh64();
+        testContentHasher();
+        testDuplicateDetection();
+        testPersistence();
+        testSchedulerClasses();
+        benchmarkIndexing();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All content hashing tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Content hashing test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,371 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_file_browser.cpp
+ * Description: Tests for the streaming directory scanner, thumbnail cache and browser selection
+ */
+
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/imaging/PngEncoder.h"
+#include "../src/library/ThumbnailCache.h"
+#include "../src/ui/FileBrowser.h"
+#include "../src/utils/DirectoryScanner.h"
+#include "../src/utils/TaskScheduler.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+static void touch(const fs::path& path) {
+    std::ofstream(path) << "x";
+}
+
+static std::string writePng(const fs::path& path, int width, int height) {
+    ImageBuffer image;
+    image.allocate(width, height, 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* pixel = image.row(y) + x * 3;
+            pixel[0] = static_cast<uint8_t>(x * 255 / width);
+            pixel[1] = static_cast<uint8_t>(y * 255 / height);
+            pixel[2] = 128;
+        }
+    }
+    PngEncoder encoder;
+    assert(encoder.writeFile(image, path.string()));
+    return path.string();
+}
+
+// Drain a scan the way the render loop does, one non-blocking take() per "frame"
+static std::vector<DirectoryEntry> drain(DirectoryScanner& scanner) {
+    std::vector<DirectoryEntry> entries;
+    while (!scanner.isFinished()) {
+        scanner.take(entries);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    scanner.take(entries);
+    return entries;
+}
+
+static bool contains(const std::vector<DirectoryEntry>& entries, const std::string& name, bool isDirectory) {
+    for (const DirectoryEntry& entry : entries) {
+        if (entry.name == name) {
+            return entry.isDirectory == isDirectory;
+        }
+    }
+    return false;
+}
+
+void testScanner(const fs::path& root) {
+    std::cout << "Testing directory scanner..." << std::endl;
+
+    const fs::path dir = root / "scan";
+    fs::create_directories(dir / "Nature");
+    fs::create_directories(dir / ".cache");
+    touch(dir / "a.png");
+    touch(dir / "B.JPG");
+    touch(dir / "c.webp");
+    touch(dir / "notes.txt");
+    touch(dir / ".hidden.png");
+    fs::create_symlink(dir / "Nature", dir / "link");
+    fs::create_symlink(dir / "a.png", dir / "alias.png");
+    fs::create_symlink(dir / "missing.png", dir / "broken.png");
+
+    TaskScheduler scheduler(2);
+    DirectoryScanner scanner(scheduler);
+    const std::vector<std::string> extensions = {".png", ".jpg", ".jpeg", ".webp"};
+
+    scanner.start(dir.string(), extensions);
+    std::vector<DirectoryEntry> entries = drain(scanner);
+    assert(entries.size() == 6);
+    assert(contains(entries, "Nature", true) && contains(entries, "link", true));
+    assert(contains(entries, "a.png", false) && contains(entries, "B.JPG", false));
+    assert(contains(entries, "c.webp", false) && contains(entries, "alias.png", false));
+    assert(!contains(entries, "notes.txt", false) && !contains(entries, "broken.png", false));
+    std::cout << "  ✓ Folders and matching images are listed, symlinks resolved, others skipped" << std::endl;
+
+    for (const DirectoryEntry& entry : entries) {
+        assert(entry.path == (dir / entry.name).string());
+        if (entry.name == "a.png") {
+            assert(entry.size == 1 && entry.modified > 0);
+        }
+    }
+    std::cout << "  ✓ Files carry size and mtime for the thumbnail key" << std::endl;
+
+    scanner.start(dir.string(), extensions, true);
+    entries = drain(scanner);
+    assert(entries.size() == 8 && contains(entries, ".cache", true) && contains(entries, ".hidden.png", false));
+    std::cout << "  ✓ Hidden entries on request" << std::endl;
+
+    scanner.start((root / "nope").string(), extensions);
+    entries = drain(scanner);
+    assert(entries.empty());
+    assert(scanner.getLastErrorCode() == DirectoryScanner::ErrorCode::OpenFailed);
+    std::cout << "  ✓ Missing directories are reported" << std::endl;
+
+    std::cout << "✓ Directory scanner tests passed" << std::endl;
+}
+
+void testStreaming(const fs::path& root) {
+    std::cout << "Testing streamed and superseded scans..." << std::endl;
+
+    const fs::path big = root / "big";
+    const fs::path small = root / "small";
+    fs::create_directories(big);
+    fs::create_directories(small);
+    const size_t count = DirectoryScanner::BATCH_SIZE * 40;
+    for (size_t i = 0; i < count; ++i) {
+        touch(big / ("wall_" + std::to_string(i) + ".png"));
+    }
+    touch(small / "only.png");
+
+    TaskScheduler scheduler(2);
+    DirectoryScanner scanner(scheduler);
+    scanner.start(big.string(), {".png"});
+    std::vector<DirectoryEntry> entries = drain(scanner);
+    assert(entries.size() == count);
+    std::cout << "  ✓ " << count << " entries delivered in batches of " << DirectoryScanner::BATCH_SIZE << std::endl;
+
+    // The first scan is superseded straight away; none of its entries may leak into the second
+    const uint64_t first = scanner.start(big.string(), {".png"});
+    const uint64_t second = scanner.start(small.string(), {".png"});
+    assert(second > first && scanner.getGeneration() == second);
+    entries = drain(scanner);
+    assert(entries.size() == 1 && entries[0].name == "only.png");
+    scheduler.waitIdle();
+    entries.clear();
+    assert(scanner.take(entries) == 0);
+    std::cout << "  ✓ A superseded scan publishes nothing" << std::endl;
+
+    scanner.start(big.string(), {".png"});
+    scanner.cancel();
+    scheduler.waitIdle();
+    assert(scanner.isFinished() && scanner.take(entries) == 0);
+    {
+        DirectoryScanner transient(scheduler);
+        transient.start(big.string(), {".png"});
+    }
+    scheduler.waitIdle();
+    std::cout << "  ✓ Cancel and destruction never wait for the scan" << std::endl;
+
+    std::cout << "✓ Streaming tests passed" << std::endl;
+}
+
+void testSelection(const fs::path& root) {
+    std::cout << "Testing browser ordering and selection..." << std::endl;
+
+    const fs::path dir = root / "select";
+    fs::create_directories(dir / "zeta");
+    fs::create_directories(dir / "Alpha");
+    for (const char* name : {"d.png", "b.png", "C.png", "a.png", "e.png"}) {
+        touch(dir / name);
+    }
+
+    TaskScheduler scheduler(2);
+    FileBrowser browser(scheduler);
+    browser.open(dir.string() + "/");
+    assert(browser.getDirectory() == dir.string());
+    assert(waitFor([&]() { browser.poll(); return !browser.isScanning(); }));
+
+    const auto& entries = browser.getEntries();
+    const std::vector<std::string> order = {"Alpha", "zeta", "a.png", "b.png", "C.png", "d.png", "e.png"};
+    assert(entries.size() == order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        assert(entries[i].name == order[i]);
+    }
+    std::cout << "  ✓ Folders first, then case-insensitive names" << std::endl;
+
+    browser.click(2, false, false);
+    browser.click(4, false, true);
+    assert(browser.getSelection() == std::vector<std::string>({entries[2].path, entries[3].path, entries[4].path}));
+    browser.click(3, true, false);
+    assert(browser.getSelectionCount() == 2 && !browser.isSelected(3));
+    browser.click(6, true, false);
+    browser.click(5, false, true);      // Range from the new anchor (6) replaces the selection
+    assert(browser.getSelection() == std::vector<std::string>({entries[5].path, entries[6].path}));
+    browser.click(2, true, true);       // Ctrl+Shift extends instead
+    assert(browser.getSelectionCount() == 5);
+    browser.click(0, false, false);
+    assert(browser.getSelectionCount() == 5);
+    browser.click(3, false, false);
+    assert(browser.getSelection() == std::vector<std::string>({entries[3].path}));
+    std::cout << "  ✓ Click, Ctrl toggle, Shift range and Ctrl+Shift extend" << std::endl;
+
+    assert(browser.activate(4));
+    assert(browser.getSelection() == std::vector<std::string>({entries[4].path}));
+    assert(!browser.activate(0));
+    assert(browser.getDirectory() == (dir / "Alpha").string() && browser.getSelectionCount() == 0);
+    assert(browser.up() && browser.getDirectory() == dir.string());
+    assert(waitFor([&]() { browser.poll(); return !browser.isScanning(); }));
+    assert(browser.getEntries().size() == order.size());
+    std::cout << "  ✓ Activating a folder enters it, a file selects it" << std::endl;
+
+    std::cout << "✓ Browser selection tests passed" << std::endl;
+}
+
+void testThumbnails(const fs::path& root) {
+    std::cout << "Testing thumbnail cache..." << std::endl;
+
+    const fs::path dir = root / "thumbs";
+    fs::create_directories(dir);
+    const std::string wide = writePng(dir / "wide.png", 640, 360);
+    const std::string tiny = writePng(dir / "tiny.png", 40, 20);
+    const std::string broken = (dir / "broken.png").string();
+    touch(broken);
+
+    TaskScheduler scheduler(2);
+    ThumbnailCache cache(scheduler, 160);
+    assert(!cache.request(wide, 1));
+    cache.request(wide, 1);                 // Pending or already done: no second decode is queued
+    assert(waitFor([&]() { return cache.request(wide, 1) != nullptr; }));
+    const auto thumbnail = cache.request(wide, 1);
+    assert(thumbnail->image.width == 160 && thumbnail->image.height == 90 && thumbnail->image.channels == 4);
+    assert(thumbnail->sourceWidth == 640 && thumbnail->sourceHeight == 360);
+    const uint8_t* corner = thumbnail->image.row(89) + 159 * 4;
+    assert(corner[0] > 240 && corner[1] > 240 && corner[2] == 128 && corner[3] == 255);
+    assert(cache.getStats().decoded == 1 && cache.getStats().misses == 1);
+    std::cout << "  ✓ Decoded off-thread and box-filtered to fit 160 px" << std::endl;
+
+    assert(waitFor([&]() { return cache.request(tiny, 1) != nullptr; }));
+    assert(cache.request(tiny, 1)->image.width == 40);
+    std::cout << "  ✓ Small images are never enlarged" << std::endl;
+
+    cache.request(broken, 1);
+    assert(waitFor([&]() { return cache.hasFailed(broken); }));
+    assert(!cache.request(broken, 1) && cache.getStats().failures == 1);
+    const std::vector<std::string> completed = cache.takeCompleted();
+    assert(completed.size() == 3 && cache.takeCompleted().empty());
+    std::cout << "  ✓ Failures are remembered and every completion is reported once" << std::endl;
+
+    // A new mtime invalidates; the fresh decode replaces the old thumbnail
+    writePng(dir / "wide.png", 320, 320);
+    assert(!cache.request(wide, 2));
+    assert(waitFor([&]() { return cache.request(wide, 2) != nullptr; }));
+    assert(cache.request(wide, 2)->image.width == 160 && cache.request(wide, 2)->image.height == 160);
+    std::cout << "  ✓ A changed mtime triggers a fresh decode" << std::endl;
+
+    // Copies under one content key share the entry whatever their path or mtime
+    const std::string copy = (dir / "copy.png").string();
+    fs::copy_file(tiny, copy, fs::copy_options::overwrite_existing);
+    ThumbnailCache keyed(scheduler, 160);
+    assert(!keyed.request(tiny, 1, "s-tiny") && !keyed.request(copy, 7, "s-tiny"));
+    assert(waitFor([&]() { return keyed.request(copy, 7, "s-tiny") != nullptr; }));
+    assert(keyed.request(tiny, 3, "s-tiny") == keyed.request(copy, 7, "s-tiny"));
+    assert(keyed.getStats().decoded == 1 && keyed.getStats().misses == 1);
+    assert(keyed.takeCompleted() == std::vector<std::string>{"s-tiny"});
+    assert(ThumbnailCache::cacheKey(copy, "") == copy && ThumbnailCache::cacheKey(copy, "s-tiny") == "s-tiny");
+    std::cout << "  ✓ Copies sharing a content key share one decode" << std::endl;
+
+    // Budget for two 160x160 thumbnails: the least recently requested goes first
+    const size_t square = 160 * 160 * 4;
+    ThumbnailCache small(scheduler, 160, 2 * square);
+    std::vector<std::string> squares;
+    for (int i = 0; i < 3; ++i) {
+        squares.push_back(writePng(dir / ("square" + std::to_string(i) + ".png"), 320, 320));
+    }
+    for (int i = 0; i < 2; ++i) {
+        small.request(squares[i]);
+        assert(waitFor([&]() { return small.request(squares[i]) != nullptr; }));
+    }
+    small.request(squares[0]);
+    small.request(squares[2]);
+    assert(waitFor([&]() { return small.request(squares[2]) != nullptr; }));
+    assert(small.getStats().evictions == 1 && small.getStats().residentBytes == 2 * square);
+    assert(small.request(squares[0]) != nullptr);
+    assert(small.request(squares[1]) == nullptr);
+    std::cout << "  ✓ Least recently requested thumbnails are evicted over budget" << std::endl;
+
+    // Hold the only worker so queued decodes cannot start, then cancel them
+    TaskScheduler single(1);
+    ThumbnailCache queued(single, 160);
+    std::atomic<bool> release{false};
+    single.submit(IoClass::Interactive, [&]() {
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    for (const std::string& path : squares) {
+        queued.request(path);
+    }
+    queued.cancelPending();
+    release = true;
+    single.waitIdle();
+    assert(queued.getStats().cancelled == 3 && queued.getStats().decoded == 0);
+    assert(queued.takeCompleted().empty());
+    std::cout << "  ✓ Queued decodes can be cancelled before they start" << std::endl;
+
+    std::cout << "✓ Thumbnail cache tests passed" << std::endl;
+}
+
+void benchmarkBrowser(const fs::path& root) {
+    std::cout << "Benchmarking listing and thumbnails..." << std::endl;
+
+    const fs::path big = root / "big";
+    TaskScheduler scheduler;
+    DirectoryScanner scanner(scheduler);
+
+    Stopwatch timer;
+    scanner.start(big.string(), {".png"});
+    std::vector<DirectoryEntry> entries;
+    while (entries.empty() && !scanner.isFinished()) {
+        scanner.take(entries);
+    }
+    const double firstUs = timer.elapsed<std::micro>();
+    std::vector<DirectoryEntry> rest = drain(scanner);
+    const double allUs = timer.elapsed<std::micro>();
+
+    const size_t total = entries.size() + rest.size();
+    std::cout << "  First entries after " << firstUs << " µs, all " << total << " after " << allUs << " µs"
+              << std::endl;
+
+    const fs::path dir = root / "bench";
+    fs::create_directories(dir);
+    std::vector<std::string> paths;
+    for (int i = 0; i < 32; ++i) {
+        paths.push_back(writePng(dir / ("wall" + std::to_string(i) + ".png"), 1920, 1080));
+    }
+    ThumbnailCache cache(scheduler);
+    timer.restart();
+    double longestRequest = 0.0;
+    for (const std::string& path : paths) {
+        Stopwatch request;
+        cache.request(path);
+        longestRequest = std::max(longestRequest, request.elapsed<std::micro>());
+    }
+    assert(waitFor([&]() { return cache.getStats().decoded == paths.size(); }, std::chrono::milliseconds(60000)));
+
+    std::cout << "  32 1080p thumbnails in " << timer.elapsed() << " ms on " << scheduler.getThreadCount()
+              << " workers; longest request() " << longestRequest << " µs" << std::endl;
+
+    std::cout << "✓ Browser benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing file browser..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    const fs::path root = makeTempRoot("browser");
+    try {
+        testScanner(root);
+        testStreaming(root);
+        testSelection(root);
+        testThumbnails(root);
+        benchmarkBrowser(root);
+
+        fs::remove_all(root);
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All file browser tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        fs::remove_all(root);
+        std::cerr << "File browser test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,224 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_glyph_cache.cpp
+ * Description: Tests for the persisted glyph bitmaps and tables used to pre-warm the font atlas
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../src/ui/GlyphCache.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+static std::vector<uint32_t> range(uint32_t first, uint32_t last) {
+    std::vector<uint32_t> codepoints;
+    for (uint32_t codepoint = first; codepoint <= last; ++codepoint) {
+        codepoints.push_back(codepoint);
+    }
+    return codepoints;
+}
+
+// Glyph whose metrics and bitmap derive from its codepoint; the bitmap lives in `pixels`
+static CachedGlyph makeGlyph(uint32_t codepoint, std::vector<uint8_t>& pixels, uint16_t width = 7,
+                             uint16_t height = 9) {
+    CachedGlyph glyph;
+    glyph.codepoint = codepoint;
+    glyph.advanceX = 6.5f + codepoint % 3;
+    glyph.x0 = 0.5f;
+    glyph.y0 = 2.0f + codepoint % 5;
+    glyph.x1 = glyph.x0 + width;
+    glyph.y1 = glyph.y0 + height;
+    glyph.width = width;
+    glyph.height = height;
+    pixels.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = static_cast<uint8_t>(codepoint * 31 + i);
+    }
+    glyph.pixels = pixels.data();
+    return glyph;
+}
+
+static void addRange(GlyphCache& cache, float size, float density, const std::vector<uint32_t>& codepoints) {
+    std::vector<uint8_t> pixels;
+    for (const uint32_t codepoint : codepoints) {
+        cache.addGlyph(size, density, makeGlyph(codepoint, pixels));
+    }
+}
+
+// Same metrics and bitmap as makeGlyph() produced for this codepoint
+static bool matches(const CachedGlyph* glyph, uint32_t codepoint) {
+    std::vector<uint8_t> pixels;
+    const CachedGlyph expected = makeGlyph(codepoint, pixels, glyph ? glyph->width : 7, glyph ? glyph->height : 9);
+    return glyph && glyph->codepoint == codepoint && glyph->advanceX == expected.advanceX &&
+           glyph->y0 == expected.y0 && glyph->x1 == expected.x1 && glyph->y1 == expected.y1 &&
+           std::equal(pixels.begin(), pixels.end(), glyph->pixels);
+}
+
+void testFontKey(const fs::path& root) {
+    std::cout << "Testing font keys..." << std::endl;
+
+    std::ofstream(root / "a.ttf") << "font a contents";
+    std::ofstream(root / "b.ttf") << "font b contents";
+    const uint64_t builtin = GlyphCache::fontKey("", "imgui 1.92.1");
+    assert(builtin == GlyphCache::fontKey("", "imgui 1.92.1"));
+    assert(builtin != GlyphCache::fontKey("", "imgui 1.92.2"));
+    const uint64_t a = GlyphCache::fontKey((root / "a.ttf").string(), "imgui 1.92.1");
+    assert(a != builtin && a != GlyphCache::fontKey((root / "b.ttf").string(), "imgui 1.92.1"));
+    std::cout << "  ✓ Keys follow the font contents and the rasterizer version" << std::endl;
+
+    // Same path, new contents: a font update must not reuse the old glyph set
+    std::ofstream(root / "a.ttf") << "font a, version 2";
+    assert(GlyphCache::fontKey((root / "a.ttf").string(), "imgui 1.92.1") != a);
+    std::cout << "  ✓ Replacing the font file changes the key" << std::endl;
+
+    std::cout << "✓ Font key tests passed" << std::endl;
+}
+
+void testGlyphsAndPersist(const fs::path& root) {
+    std::cout << "Testing glyph tables and persistence..." << std::endl;
+
+    const uint64_t key = GlyphCache::fontKey("", "imgui test");
+    const std::string path = (root / "cache" / "glyphs.bin").string();
+    GlyphCache cache;
+    assert(!cache.load(path, key) && cache.getLastErrorCode() == GlyphCache::ErrorCode::ReadFailed);
+    assert(cache.getCodepoints(13.0f, 1.0f).empty() && !cache.isDirty());
+
+    std::vector<uint8_t> pixels;
+    assert(cache.addGlyph(13.0f, 1.0f, makeGlyph('b', pixels)));
+    assert(cache.addGlyph(13.0f, 1.0f, makeGlyph('a', pixels)));
+    assert(!cache.addGlyph(13.0f, 1.0f, makeGlyph('a', pixels)));         // Already recorded
+    CachedGlyph space = makeGlyph(' ', pixels, 0, 0);
+    space.pixels = nullptr;
+    assert(cache.addGlyph(13.0f, 1.0f, space));                           // Blank glyphs keep only metrics
+    assert(cache.addGlyph(13.0f, 1.0f, makeGlyph(0x00E9, pixels, 8, 12)));
+    std::fill(pixels.begin(), pixels.end(), 0);                            // The cache holds its own copy
+    addRange(cache, 13.0f, 2.0f, range(0x20, 0x7E));                      // HiDPI density is its own set
+    assert(cache.isDirty() && cache.getSetCount() == 2 && cache.getGlyphCount() == 4 + 95);
+    const std::vector<uint32_t> expected = { ' ', 'a', 'b', 0x00E9 };
+    assert(cache.getCodepoints(13.0f, 1.0f) == expected);
+    assert(matches(cache.findGlyph(13.004f, 1.0f, 'a'), 'a'));           // Float noise in the size
+    assert(matches(cache.findGlyph(13.0f, 1.0f, 0x00E9), 0x00E9) && cache.findGlyph(13.0f, 1.0f, 0x00E9)->width == 8);
+    assert(cache.findGlyph(13.0f, 1.0f, ' ')->width == 0 && cache.findGlyph(13.0f, 1.0f, ' ')->advanceX == space.advanceX);
+    assert(!cache.findGlyph(13.0f, 1.0f, 'z') && !cache.findGlyph(16.0f, 1.0f, 'a'));
+    std::cout << "  ✓ Glyphs are kept per size and density with their metrics and bitmaps" << std::endl;
+
+    assert(cache.save(path) && !cache.isDirty());
+    GlyphCache loaded;
+    assert(loaded.load(path, key) && loaded.getSetCount() == 2 && !loaded.isDirty());
+    assert(loaded.getCodepoints(13.0f, 1.0f) == expected && loaded.getCodepoints(13.0f, 2.0f) == range(0x20, 0x7E));
+    assert(matches(loaded.findGlyph(13.0f, 1.0f, 'b'), 'b') && matches(loaded.findGlyph(13.0f, 1.0f, 0x00E9), 0x00E9));
+    assert(matches(loaded.findGlyph(13.0f, 2.0f, '~'), '~') && !loaded.findGlyph(13.0f, 1.0f, ' ')->pixels);
+    std::cout << "  ✓ Saved glyphs load back from the mapped file (creating the cache directory)" << std::endl;
+
+    // Glyphs added after a load sit beside the mapped ones, and saving over the mapped file
+    // leaves the loaded bitmaps readable
+    assert(loaded.addGlyph(13.0f, 1.0f, makeGlyph('c', pixels)) && loaded.save(path));
+    assert(matches(loaded.findGlyph(13.0f, 1.0f, 'b'), 'b') && matches(loaded.findGlyph(13.0f, 1.0f, 'c'), 'c'));
+    GlyphCache reloaded;
+    assert(reloaded.load(path, key) && reloaded.getGlyphCount() == 4 + 95 + 1);
+    assert(matches(reloaded.findGlyph(13.0f, 1.0f, 'c'), 'c'));
+    std::cout << "  ✓ New glyphs extend a loaded cache and persist" << std::endl;
+
+    assert(!loaded.load(path, GlyphCache::fontKey("", "imgui other")));
+    assert(loaded.getLastErrorCode() == GlyphCache::ErrorCode::StaleKey && loaded.getSetCount() == 0);
+    assert(loaded.addGlyph(13.0f, 1.0f, makeGlyph('q', pixels)) && loaded.save(path));
+    assert(!cache.load(path, key) && cache.getLastErrorCode() == GlyphCache::ErrorCode::StaleKey);
+    std::cout << "  ✓ A cache for another font is ignored and replaced" << std::endl;
+
+    std::cout << "✓ Glyph table and persistence tests passed" << std::endl;
+}
+
+void testCorruption(const fs::path& root) {
+    std::cout << "Testing damaged cache files..." << std::endl;
+
+    const uint64_t key = GlyphCache::fontKey("", "imgui test");
+    const std::string path = (root / "damaged.bin").string();
+    GlyphCache cache;
+    cache.load(path, key);
+    addRange(cache, 13.0f, 1.0f, range(0x20, 0x7E));
+    assert(cache.save(path));
+
+    // Flip one byte in the middle of the glyph table
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(60);
+        file.put('\x7f');
+    }
+    assert(!cache.load(path, key) && cache.getLastErrorCode() == GlyphCache::ErrorCode::Corrupt);
+    fs::resize_file(path, 20);
+    assert(!cache.load(path, key) && cache.getLastErrorCode() == GlyphCache::ErrorCode::Corrupt);
+    std::ofstream(path, std::ios::trunc) << "plain text, not a cache";
+    assert(!cache.load(path, key) && cache.getLastErrorCode() == GlyphCache::ErrorCode::Corrupt);
+    assert(cache.getSetCount() == 0);
+    std::cout << "  ✓ Flipped bytes, truncation and foreign files are rejected" << std::endl;
+
+    std::ofstream(root / "blocker") << "x";
+    std::vector<uint8_t> pixels;
+    assert(cache.addGlyph(13.0f, 1.0f, makeGlyph('a', pixels)) && !cache.save((root / "blocker" / "glyphs.bin").string()));
+    assert(cache.getLastErrorCode() == GlyphCache::ErrorCode::WriteFailed && cache.isDirty());
+    std::cout << "  ✓ An unwritable location reports WriteFailed and stays dirty" << std::endl;
+
+    std::cout << "✓ Corruption tests passed" << std::endl;
+}
+
+void benchmarkLoad(const fs::path& root) {
+    std::cout << "Benchmarking glyph cache load..." << std::endl;
+
+    // A CJK-heavy session at three sizes and two densities
+    const uint64_t key = GlyphCache::fontKey("", "imgui bench");
+    const std::string path = (root / "bench.bin").string();
+    GlyphCache cache;
+    cache.load(path, key);
+    for (const float size : {13.0f, 16.0f, 20.0f}) {
+        for (const float density : {1.0f, 2.0f}) {
+            std::vector<uint32_t> codepoints = range(0x20, 0x7E);
+            const std::vector<uint32_t> cjk = range(0x4E00, 0x4E00 + 3000);
+            codepoints.insert(codepoints.end(), cjk.begin(), cjk.end());
+            addRange(cache, size, density, codepoints);
+        }
+    }
+    assert(cache.save(path));
+
+    const int iterations = 200;
+    Stopwatch timer;
+    size_t total = 0;
+    for (int i = 0; i < iterations; ++i) {
+        GlyphCache loaded;
+        assert(loaded.load(path, key));
+        total += loaded.findGlyph(16.0f, 2.0f, 0x4E00 + i) != nullptr ? loaded.getGlyphCount() : 0;
+    }
+    const double us = timer.elapsed<std::micro>() / iterations;
+    assert(total == static_cast<size_t>(iterations) * 6 * 3096);
+    std::cout << "  " << fs::file_size(path) << " bytes, 6 sets of 3096 glyphs: " << us << " us per load" << std::endl;
+
+    std::cout << "✓ Glyph cache benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing glyph cache..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    const fs::path root = makeTempRoot("glyphs");
+    try {
+        testFontKey(root);
+        testGlyphsAndPersist(root);
+        testCorruption(root);
+        benchmarkLoad(root);
+
+        fs::remove_all(root);
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All glyph cache tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        fs::remove_all(root);
+        std::cerr << "Glyph cache test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,435 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_image_orientation.cpp
+ * Description: Tests for header probing with EXIF orientation and orientation-fused resampling
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "../src/imaging/ImageProbe.h"
+#include "../src/imaging/Resampler.h"
+#include "../src/core/WallpaperManager.h"
+#include "TestSupport.h"
+
+static void append16(std::vector<uint8_t>& out, int value, bool littleEndian = false) {
+    if (littleEndian) {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    } else {
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+}
+
+static void append32(std::vector<uint8_t>& out, uint32_t value, bool littleEndian = false) {
+    if (littleEndian) {
+        append16(out, value & 0xFFFF, true);
+        append16(out, value >> 16, true);
+    } else {
+        append16(out, value >> 16);
+        append16(out, value & 0xFFFF);
+    }
+}
+
+// TIFF structure with IFD0 holding an ImageWidth entry and (optionally) Orientation
+static std::vector<uint8_t> makeTiff(int orientation, bool littleEndian) {
+    std::vector<uint8_t> tiff;
+    tiff.push_back(littleEndian ? 'I' : 'M');
+    tiff.push_back(littleEndian ? 'I' : 'M');
+    append16(tiff, 42, littleEndian);
+    append32(tiff, 8, littleEndian);
+
+    append16(tiff, orientation ? 2 : 1, littleEndian);
+    append16(tiff, 0x0100, littleEndian);   // ImageWidth, LONG
+    append16(tiff, 4, littleEndian);
+    append32(tiff, 1, littleEndian);
+    append32(tiff, 640, littleEndian);
+    if (orientation) {
+        append16(tiff, 0x0112, littleEndian);   // Orientation, SHORT
+        append16(tiff, 3, littleEndian);
+        append32(tiff, 1, littleEndian);
+        append16(tiff, orientation, littleEndian);
+        append16(tiff, 0, littleEndian);
+    }
+    append32(tiff, 0, littleEndian);            // No next IFD
+    return tiff;
+}
+
+// JPEG header: SOI, APP1 Exif, optional padding APP2 segments, SOFn, SOS
+static std::vector<uint8_t> makeJpegHeader(int width, int height, int orientation, size_t paddingBytes,
+                                           bool progressive) {
+    std::vector<uint8_t> jpeg = {0xFF, 0xD8};
+
+    if (orientation) {
+        const auto tiff = makeTiff(orientation, false);
+        jpeg.push_back(0xFF);
+        jpeg.push_back(0xE1);
+        append16(jpeg, static_cast<int>(2 + 6 + tiff.size()));
+        const char exif[6] = {'E', 'x', 'i', 'f', 0, 0};
+        jpeg.insert(jpeg.end(), exif, exif + 6);
+        jpeg.insert(jpeg.end(), tiff.begin(), tiff.end());
+    }
+
+    // Large ICC profiles are split over several APP2 segments
+    while (paddingBytes > 0) {
+        const size_t chunk = std::min<size_t>(paddingBytes, 60000);
+        jpeg.push_back(0xFF);
+        jpeg.push_back(0xE2);
+        append16(jpeg, static_cast<int>(chunk + 2));
+        jpeg.insert(jpeg.end(), chunk, 0xA5);
+        paddingBytes -= chunk;
+    }
+
+    jpeg.push_back(0xFF);
+    jpeg.push_back(progressive ? 0xC2 : 0xC0);
+    append16(jpeg, 11);
+    jpeg.push_back(8);
+    append16(jpeg, height);
+    append16(jpeg, width);
+    jpeg.push_back(1);
+    jpeg.insert(jpeg.end(), {1, 0x11, 0});
+
+    jpeg.insert(jpeg.end(), {0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00});
+    return jpeg;
+}
+
+static std::string writeTempFile(const std::string& name, const std::vector<uint8_t>& data) {
+    const std::string path = (std::filesystem::temp_directory_path() / name).string();
+    writeFile(path, data);
+    return path;
+}
+
+// Independent statement of the EXIF definitions: displayed (x, y) shows stored (sx, sy)
+static void storedPixelFor(int orientation, int width, int height, int x, int y, int& sx, int& sy) {
+    switch (orientation) {
+        case 2: sx = width - 1 - x; sy = y; break;
+        case 3: sx = width - 1 - x; sy = height - 1 - y; break;
+        case 4: sx = x; sy = height - 1 - y; break;
+        case 5: sx = y; sy = x; break;
+        case 6: sx = y; sy = height - 1 - x; break;
+        case 7: sx = width - 1 - y; sy = height - 1 - x; break;
+        case 8: sx = width - 1 - y; sy = x; break;
+        default: sx = x; sy = y; break;
+    }
+}
+
+static ImageBuffer makeTestImage(int width, int height, int channels, unsigned seed) {
+    ImageBuffer image;
+    image.allocate(width, height, channels);
+    unsigned state = seed;
+    for (auto& value : image.pixels) {
+        state = state * 1103515245u + 12345u;
+        value = static_cast<uint8_t>(state >> 16);
+    }
+    return image;
+}
+
+void testExifParsing() {
+    std::cout << "Testing EXIF orientation parsing..." << std::endl;
+
+    for (bool littleEndian : {false, true}) {
+        for (int orientation = 1; orientation <= 8; ++orientation) {
+            const auto tiff = makeTiff(orientation, littleEndian);
+            assert(ImageProbe::parseExifOrientation(tiff.data(), tiff.size()) == orientation);
+        }
+    }
+    std::cout << "  ✓ All eight orientations in both byte orders" << std::endl;
+
+    const auto missing = makeTiff(0, true);
+    assert(ImageProbe::parseExifOrientation(missing.data(), missing.size()) == 0);
+
+    auto invalid = makeTiff(9, false);
+    assert(ImageProbe::parseExifOrientation(invalid.data(), invalid.size()) == 0);
+
+    // Truncated IFDs and bogus offsets are ignored rather than read out of bounds
+    const auto full = makeTiff(6, false);
+    for (size_t size = 0; size < full.size(); ++size) {
+        const int value = ImageProbe::parseExifOrientation(full.data(), size);
+        assert(value == 0 || value == 6);
+    }
+    invalid = full;
+    invalid[7] = 0xF0;
+    assert(ImageProbe::parseExifOrientation(invalid.data(), invalid.size()) == 0);
+    std::cout << "  ✓ Missing, invalid and truncated tags" << std::endl;
+
+    std::cout << "✓ EXIF parsing tests passed" << std::endl;
+}
+
+void testJpegProbe() {
+    std::cout << "Testing JPEG header probing..." << std::endl;
+
+    ImageProbe probe;
+    ImageHeader header;
+
+    // A phone photo stored landscape but shot in portrait
+    const auto portrait = makeJpegHeader(4032, 3024, 6, 0, false);
+    assert(probe.probeMemory(portrait.data(), portrait.size(), header));
+    assert(header.format == ImageFormat::Jpeg);
+    assert(header.width == 4032 && header.height == 3024);
+    assert(header.orientation == ImageOrientation::Rotate90);
+    assert(header.displayWidth() == 3024 && header.displayHeight() == 4032);
+    assert(!header.progressive);
+
+    const auto plain = makeJpegHeader(1920, 1080, 0, 0, true);
+    assert(probe.probeMemory(plain.data(), plain.size(), header));
+    assert(header.orientation == ImageOrientation::Normal && header.progressive);
+    assert(header.displayWidth() == 1920 && header.displayHeight() == 1080);
+    std::cout << "  ✓ Post-rotation dimensions for EXIF orientation 6" << std::endl;
+
+    // Frame header behind ~200 KiB of ICC data: the memory probe asks for more data,
+    // the file probe grows its prefix until it finds the frame
+    const auto padded = makeJpegHeader(6000, 4000, 8, 200000, false);
+    assert(!probe.probeMemory(padded.data(), ImageProbe::PROBE_READ_BYTES, header));
+    assert(probe.getLastErrorCode() == ImageProbe::ErrorCode::Truncated);
+
+    const std::string path = writeTempFile("caithe_test_probe.jpg", padded);
+    assert(probe.probeFile(path, header));
+    assert(header.displayWidth() == 4000 && header.displayHeight() == 6000);
+    std::remove(path.c_str());
+
+    assert(!probe.probeFile(path, header));
+    assert(probe.getLastErrorCode() == ImageProbe::ErrorCode::FileNotFound);
+    std::cout << "  ✓ Frame headers beyond the initial prefix" << std::endl;
+
+    // Every truncation before the frame dimensions fails cleanly (the header ends with a
+    // 13-byte SOF0 whose dimensions end at byte 9, followed by a 10-byte SOS)
+    const size_t dimensionsEnd = portrait.size() - 10 - 13 + 9;
+    for (size_t size = 0; size < dimensionsEnd; ++size) {
+        assert(!probe.probeMemory(portrait.data(), size, header));
+    }
+    assert(probe.probeMemory(portrait.data(), dimensionsEnd, header));
+
+    std::cout << "✓ JPEG probe tests passed" << std::endl;
+}
+
+void testOtherFormats() {
+    std::cout << "Testing PNG, GIF, BMP and WebP probing..." << std::endl;
+
+    ImageProbe probe;
+    ImageHeader header;
+
+    // PNG with an eXIf chunk before IDAT (CRCs are not checked by the probe)
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    append32(png, 13);
+    png.insert(png.end(), {'I', 'H', 'D', 'R'});
+    append32(png, 800);
+    append32(png, 600);
+    png.insert(png.end(), {8, 6, 0, 0, 1});
+    append32(png, 0);
+    const auto tiff = makeTiff(5, true);
+    append32(png, static_cast<uint32_t>(tiff.size()));
+    png.insert(png.end(), {'e', 'X', 'I', 'f'});
+    png.insert(png.end(), tiff.begin(), tiff.end());
+    append32(png, 0);
+    append32(png, 0);
+    png.insert(png.end(), {'I', 'D', 'A', 'T'});
+
+    assert(probe.probeMemory(png.data(), png.size(), header));
+    assert(header.format == ImageFormat::Png && header.progressive);
+    assert(header.orientation == ImageOrientation::Transpose);
+    assert(header.displayWidth() == 600 && header.displayHeight() == 800);
+    std::cout << "  ✓ PNG IHDR and eXIf" << std::endl;
+
+    std::vector<uint8_t> gif = {'G', 'I', 'F', '8', '9', 'a'};
+    append16(gif, 320, true);
+    append16(gif, 200, true);
+    assert(probe.probeMemory(gif.data(), gif.size(), header));
+    assert(header.format == ImageFormat::Gif && header.width == 320 && header.height == 200);
+
+    // Top-down BMP (negative height)
+    std::vector<uint8_t> bmp = {'B', 'M'};
+    bmp.resize(14, 0);
+    append32(bmp, 40, true);
+    append32(bmp, 1024, true);
+    append32(bmp, static_cast<uint32_t>(-768), true);
+    assert(probe.probeMemory(bmp.data(), bmp.size(), header));
+    assert(header.format == ImageFormat::Bmp && header.width == 1024 && header.height == 768);
+
+    auto webpHeader = [](const char* chunk) {
+        std::vector<uint8_t> webp = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'E', 'B', 'P'};
+        webp.insert(webp.end(), chunk, chunk + 4);
+        webp.resize(30, 0);
+        return webp;
+    };
+
+    auto lossy = webpHeader("VP8 ");
+    lossy[23] = 0x9D;
+    lossy[24] = 0x01;
+    lossy[25] = 0x2A;
+    lossy[26] = 0x80;
+    lossy[27] = 0x07;    // 1920
+    lossy[28] = 0x38;
+    lossy[29] = 0x04;    // 1080
+    assert(probe.probeMemory(lossy.data(), lossy.size(), header));
+    assert(header.format == ImageFormat::WebP && header.width == 1920 && header.height == 1080);
+
+    auto lossless = webpHeader("VP8L");
+    lossless[20] = 0x2F;
+    const uint32_t bits = (640 - 1) | ((480 - 1) << 14);
+    for (int i = 0; i < 4; ++i) {
+        lossless[21 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    assert(probe.probeMemory(lossless.data(), lossless.size(), header));
+    assert(header.width == 640 && header.height == 480);
+
+    auto extended = webpHeader("VP8X");
+    extended[24] = static_cast<uint8_t>((5000 - 1) & 0xFF);
+    extended[25] = static_cast<uint8_t>((5000 - 1) >> 8);
+    extended[27] = static_cast<uint8_t>((3000 - 1) & 0xFF);
+    extended[28] = static_cast<uint8_t>((3000 - 1) >> 8);
+    assert(probe.probeMemory(extended.data(), extended.size(), header));
+    assert(header.width == 5000 && header.height == 3000);
+    std::cout << "  ✓ GIF, BMP and WebP (VP8, VP8L, VP8X)" << std::endl;
+
+    const uint8_t text[] = "not an image";
+    assert(!probe.probeMemory(text, sizeof(text), header));
+    assert(probe.getLastErrorCode() == ImageProbe::ErrorCode::UnknownFormat);
+
+    std::cout << "✓ Other format tests passed" << std::endl;
+}
+
+void testResamplerOrientation() {
+    std::cout << "Testing orientation-fused resampling..." << std::endl;
+
+    Resampler resampler;
+    ImageBuffer output;
+
+    // At unit scale a box filter is a pure copy, so the output must be exactly the
+    // re-oriented source
+    const ImageBuffer source = makeTestImage(13, 7, 3, 42);
+    for (int value = 1; value <= 8; ++value) {
+        const ImageOrientation orientation = orientationFromExif(value);
+        const int width = orientationSwapsAxes(orientation) ? source.height : source.width;
+        const int height = orientationSwapsAxes(orientation) ? source.width : source.height;
+
+        assert(resampler.resample(source, orientation, output, width, height, Resampler::Filter::Box));
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                int sx = 0, sy = 0;
+                storedPixelFor(value, source.width, source.height, x, y, sx, sy);
+                for (int c = 0; c < 3; ++c) {
+                    assert(output.row(y)[x * 3 + c] == source.row(sy)[sx * 3 + c]);
+                }
+            }
+        }
+    }
+    std::cout << "  ✓ All eight orientations at unit scale" << std::endl;
+
+    // Scaling with orientation equals scaling in stored space and re-orienting afterwards
+    const ImageBuffer photo = makeTestImage(97, 61, 4, 7);
+    ImageBuffer stored;
+    for (int value = 1; value <= 8; ++value) {
+        const ImageOrientation orientation = orientationFromExif(value);
+        const bool swaps = orientationSwapsAxes(orientation);
+        const int width = 23, height = 40;
+
+        assert(resampler.resample(photo, orientation, output, width, height));
+        assert(resampler.resample(photo, ImageOrientation::Normal, stored, swaps ? height : width,
+                                  swaps ? width : height));
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                int sx = 0, sy = 0;
+                storedPixelFor(value, stored.width, stored.height, x, y, sx, sy);
+                for (int c = 0; c < 4; ++c) {
+                    assert(output.row(y)[x * 4 + c] == stored.row(sy)[sx * 4 + c]);
+                }
+            }
+        }
+    }
+    std::cout << "  ✓ Downscaling commutes with orientation" << std::endl;
+
+    // Regions are given in displayed coordinates
+    const ResampleRegion region{3.0, 2.0, 4.0, 5.0};
+    assert(resampler.resampleRegion(source, ImageOrientation::Rotate90, region, output, 4, 5,
+                                    Resampler::Filter::Box));
+    for (int y = 0; y < 5; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int sx = 0, sy = 0;
+            storedPixelFor(6, source.width, source.height, x + 3, y + 2, sx, sy);
+            assert(output.row(y)[x * 3] == source.row(sy)[sx * 3]);
+        }
+    }
+
+    // Flat images stay flat under any filter and scale
+    ImageBuffer flat;
+    flat.allocate(50, 30, 3);
+    std::fill(flat.pixels.begin(), flat.pixels.end(), 77);
+    assert(resampler.resample(flat, ImageOrientation::Rotate270, output, 7, 101));
+    for (uint8_t value : output.pixels) {
+        assert(value == 77);
+    }
+    std::cout << "  ✓ Displayed-space regions and flat-field preservation" << std::endl;
+
+    const ResampleRegion outside{0.0, 0.0, 20.0, 20.0};
+    assert(!resampler.resampleRegion(source, ImageOrientation::Normal, outside, output, 4, 4));
+    assert(resampler.getLastErrorCode() == Resampler::ErrorCode::InvalidArgument);
+
+    std::cout << "✓ Orientation-fused resampling tests passed" << std::endl;
+}
+
+void testWallpaperManagerDimensions() {
+    std::cout << "Testing WallpaperManager post-rotation dimensions..." << std::endl;
+
+    const auto jpeg = makeJpegHeader(4032, 3024, 6, 0, false);
+    const std::string path = writeTempFile("caithe_test_portrait.jpg", jpeg);
+
+    // Applying to Hyprland may fail in the test environment; the stored info does not depend on it
+    WallpaperManager manager;
+    manager.setWallpaper(path, 0);
+    const auto& info = manager.getWallpaperInfo(0);
+    assert(info.path == path);
+    assert(info.width == 3024 && info.height == 4032);
+    assert(info.orientation == ImageOrientation::Rotate90);
+    std::remove(path.c_str());
+
+    std::cout << "✓ WallpaperManager dimension tests passed" << std::endl;
+}
+
+void benchmarkResample() {
+    std::cout << "Benchmarking 4032x3024 -> 1080x1440 pre-render..." << std::endl;
+
+    const ImageBuffer photo = makeTestImage(4032, 3024, 4, 1);
+    Resampler resampler;
+    ImageBuffer output;
+    const int iterations = 5;
+
+    for (ImageOrientation orientation : {ImageOrientation::Normal, ImageOrientation::Rotate90}) {
+        const bool swaps = orientationSwapsAxes(orientation);
+        Stopwatch timer;
+        for (int i = 0; i < iterations; ++i) {
+            assert(resampler.resample(photo, orientation, output, swaps ? 1080 : 1440, swaps ? 1440 : 1080));
+        }
+        const double ms = timer.elapsed() / iterations;
+        std::cout << "  " << (swaps ? "Rotate90: " : "Normal:   ") << ms << " ms" << std::endl;
+    }
+
+    std::cout << "✓ Benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing image probing and orientation..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testExifParsing();
+        testJpegProbe();
+        testOtherFormats();
+        testResamplerOrientation();
+        testWallpaperManagerDimensions();
+        benchmarkResample();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All image orientation tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Image orientation test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
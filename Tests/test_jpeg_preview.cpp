@@ -0,0 +1,361 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_jpeg_preview.cpp
+ * Description: Tests of the DC-coefficient JPEG preview against stb_image full decodes, plus preview speed benchmark
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "../src/imaging/JpegPreviewDecoder.h"
+#include "../src/imaging/ImageDecoder.h"
+#include "TestSupport.h"
+
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+// Progressive JPEGs from libjpeg (jpeg_simple_progression: DC first scan with Al=1, spectral
+// AC scans, then DC and AC refinement); stb_image_write only produces baseline files.
+// 60x44 YCbCr 4:2:0 with a restart interval of 2 MCUs, and 37x21 grayscale.
+const unsigned char PROGRESSIVE_YCBCR_420_JPEG[] = {
+    0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+    0x00, 0x01, 0x00, 0x00, 0xff, 0xdb, 0x00, 0x43, 0x00, 0x05, 0x03, 0x04, 0x04, 0x04, 0x03, 0x05,
+    0x04, 0x04, 0x04, 0x05, 0x05, 0x05, 0x06, 0x07, 0x0c, 0x08, 0x07, 0x07, 0x07, 0x07, 0x0f, 0x0b,
+    0x0b, 0x09, 0x0c, 0x11, 0x0f, 0x12, 0x12, 0x11, 0x0f, 0x11, 0x11, 0x13, 0x16, 0x1c, 0x17, 0x13,
+    0x14, 0x1a, 0x15, 0x11, 0x11, 0x18, 0x21, 0x18, 0x1a, 0x1d, 0x1d, 0x1f, 0x1f, 0x1f, 0x13, 0x17,
+    0x22, 0x24, 0x22, 0x1e, 0x24, 0x1c, 0x1e, 0x1f, 0x1e, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x05, 0x05,
+    0x05, 0x07, 0x06, 0x07, 0x0e, 0x08, 0x08, 0x0e, 0x1e, 0x14, 0x11, 0x14, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0xff, 0xc2,
+    0x00, 0x11, 0x08, 0x00, 0x2c, 0x00, 0x3c, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+    0x01, 0xff, 0xc4, 0x00, 0x17, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x05, 0x04, 0x06, 0xff, 0xc4, 0x00, 0x18, 0x01, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05,
+    0x04, 0x03, 0x01, 0x06, 0xff, 0xdd, 0x00, 0x04, 0x00, 0x02, 0xff, 0xda, 0x00, 0x0c, 0x03, 0x01,
+    0x00, 0x02, 0x10, 0x03, 0x10, 0x00, 0x00, 0x01, 0x57, 0x9c, 0xf2, 0xf9, 0x1a, 0x2d, 0x39, 0xb8,
+    0x97, 0xff, 0xd0, 0xbe, 0xb3, 0x98, 0xe9, 0xa8, 0xa4, 0xe5, 0x91, 0x4f, 0xff, 0xd1, 0xc0, 0xd3,
+    0x9a, 0x90, 0x28, 0xac, 0xe6, 0xc1, 0x3f, 0xff, 0xd2, 0xd0, 0x93, 0x96, 0x5a, 0x28, 0xa4, 0xf4,
+    0x81, 0x4f, 0xff, 0xd3, 0xe6, 0x97, 0x02, 0xaa, 0x7d, 0x04, 0xc0, 0xb1, 0xab, 0xff, 0xd4, 0x9c,
+    0xb8, 0x13, 0x06, 0x77, 0xa6, 0x14, 0x81, 0x4f, 0xff, 0xc4, 0x00, 0x18, 0x10, 0x01, 0x01, 0x01,
+    0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x02,
+    0x12, 0x11, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x05, 0x02, 0x18, 0x6f, 0xff, 0xd0,
+    0x35, 0x1a, 0xbf, 0xff, 0xd1, 0x35, 0x1a, 0xbf, 0xff, 0xd2, 0x35, 0x75, 0x7f, 0xff, 0xd3, 0x18,
+    0x6f, 0xff, 0xd4, 0x35, 0x1a, 0xbf, 0xff, 0xd5, 0x35, 0x1a, 0xbf, 0xff, 0xd6, 0x35, 0x75, 0x7f,
+    0xff, 0xd7, 0x35, 0x1a, 0xbf, 0xff, 0xd0, 0x35, 0x1a, 0xbf, 0xff, 0xd1, 0x35, 0x1a, 0xbf, 0xff,
+    0xd2, 0x35, 0x75, 0x7f, 0xff, 0xd3, 0x35, 0x1a, 0xbf, 0xff, 0xd4, 0x35, 0x1a, 0xbf, 0xff, 0xd5,
+    0x35, 0x1a, 0xbf, 0xff, 0xd6, 0x35, 0x75, 0x7f, 0xff, 0xd7, 0x35, 0x1a, 0xbf, 0xff, 0xd0, 0x35,
+    0x1a, 0xbf, 0xff, 0xd1, 0x35, 0x1a, 0xbf, 0xff, 0xd2, 0x35, 0x75, 0x7f, 0xff, 0xd3, 0x22, 0xff,
+    0xd4, 0x18, 0xbf, 0xff, 0xd5, 0x21, 0xbf, 0xff, 0xd6, 0x1b, 0xdb, 0xff, 0xc4, 0x00, 0x16, 0x11,
+    0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x02, 0xff, 0xda, 0x00, 0x08, 0x01, 0x03, 0x01, 0x01, 0x3f, 0x01, 0x23, 0x88, 0xef,
+    0xff, 0xd0, 0x23, 0x88, 0xaf, 0xff, 0xd1, 0x23, 0x88, 0xef, 0xff, 0xd2, 0x12, 0x88, 0xaf, 0xff,
+    0xd3, 0x2c, 0x42, 0x77, 0xff, 0xd4, 0x13, 0x88, 0xef, 0xff, 0xc4, 0x00, 0x18, 0x11, 0x00, 0x03,
+    0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x02, 0x03, 0x13, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02, 0x01, 0x01, 0x3f, 0x01, 0xe2, 0x3c, 0xcf,
+    0xff, 0xd0, 0xa8, 0x2d, 0x1f, 0xff, 0xd1, 0x79, 0x95, 0x07, 0xff, 0xd2, 0xd1, 0x1a, 0x23, 0xff,
+    0xd3, 0xa9, 0x34, 0x47, 0xff, 0xd4, 0xd0, 0xb4, 0x7f, 0xff, 0xc4, 0x00, 0x14, 0x10, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0xff,
+    0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x06, 0x3f, 0x02, 0x3f, 0xff, 0xd0, 0x3f, 0xff, 0xd1, 0x3f,
+    0xff, 0xd2, 0x3f, 0xff, 0xd3, 0x3f, 0xff, 0xd4, 0x3f, 0xff, 0xd5, 0x3f, 0xff, 0xd6, 0x3f, 0xff,
+    0xd7, 0x3f, 0xff, 0xd0, 0x3f, 0xff, 0xd1, 0x3f, 0xff, 0xd2, 0x3f, 0xff, 0xd3, 0x3f, 0xff, 0xd4,
+    0x3f, 0xff, 0xd5, 0x3f, 0xff, 0xd6, 0x3f, 0xff, 0xd7, 0x3f, 0xff, 0xd0, 0x3f, 0xff, 0xd1, 0x3f,
+    0xff, 0xd2, 0x3f, 0xff, 0xd3, 0x3f, 0xff, 0xd4, 0x3f, 0xff, 0xd5, 0x3f, 0xff, 0xd6, 0x3f, 0xff,
+    0xc4, 0x00, 0x16, 0x10, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x10, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f,
+    0x21, 0xcf, 0xff, 0xd0, 0xca, 0xff, 0xd1, 0xc0, 0xff, 0xd2, 0x10, 0xff, 0xd3, 0xcf, 0xff, 0xd4,
+    0xc8, 0xff, 0xd5, 0xc0, 0xff, 0xd6, 0x10, 0xff, 0xd7, 0xca, 0xff, 0xd0, 0xc0, 0xff, 0xd1, 0xc0,
+    0xff, 0xd2, 0x10, 0xff, 0xd3, 0xca, 0xff, 0xd4, 0xc0, 0xff, 0xd5, 0xc0, 0xff, 0xd6, 0x10, 0xff,
+    0xd7, 0xc0, 0xff, 0xd0, 0xc0, 0xff, 0xd1, 0xc0, 0xff, 0xd2, 0x10, 0xff, 0xd3, 0xaa, 0xaa, 0xff,
+    0xd4, 0xa2, 0xab, 0xff, 0xd5, 0xaa, 0xa3, 0xff, 0xd6, 0xa2, 0x53, 0xff, 0xda, 0x00, 0x0c, 0x03,
+    0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x00, 0x00, 0x10, 0x8c, 0x3f, 0xff, 0xd0, 0x6c, 0x8f, 0xff,
+    0xd1, 0x05, 0xbf, 0xff, 0xd2, 0x7e, 0x3f, 0xff, 0xd3, 0x7d, 0xef, 0xff, 0xd4, 0x9f, 0x7f, 0xff,
+    0xc4, 0x00, 0x18, 0x11, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x10, 0x21, 0x11, 0xff, 0xda, 0x00, 0x08, 0x01, 0x03, 0x01,
+    0x01, 0x3f, 0x10, 0xc3, 0xff, 0xd0, 0x7c, 0x1f, 0xff, 0xd1, 0xcf, 0xff, 0xd2, 0x1c, 0x1f, 0xff,
+    0xd3, 0x9a, 0x0f, 0xff, 0xd4, 0x82, 0x1e, 0x3f, 0xff, 0xc4, 0x00, 0x18, 0x11, 0x01, 0x01, 0x01,
+    0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x01,
+    0x21, 0x10, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02, 0x01, 0x01, 0x3f, 0x10, 0xc2, 0x2f, 0xff, 0xd0,
+    0x93, 0xbb, 0xff, 0xd1, 0x8a, 0x4f, 0xff, 0xd2, 0x8b, 0xa3, 0xff, 0xd3, 0xcf, 0x3c, 0x3f, 0xff,
+    0xd4, 0xcb, 0xb3, 0xff, 0xc4, 0x00, 0x19, 0x10, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x61, 0x21, 0x31, 0x51, 0x11, 0xff, 0xda,
+    0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f, 0x10, 0xaa, 0xaf, 0xff, 0xd0, 0xa2, 0x8f, 0xff, 0xd1,
+    0xb2, 0xcf, 0xff, 0xd2, 0xbb, 0x1e, 0xbf, 0xff, 0xd3, 0xaa, 0xaf, 0xff, 0xd4, 0xa2, 0xcf, 0xff,
+    0xd5, 0xb2, 0xef, 0xff, 0xd6, 0xbb, 0x1e, 0xbf, 0xff, 0xd7, 0xa2, 0x8f, 0xff, 0xd0, 0xb2, 0xcf,
+    0xff, 0xd1, 0xba, 0xef, 0xff, 0xd2, 0xab, 0x1e, 0xbf, 0xff, 0xd3, 0xa2, 0x8f, 0xff, 0xd4, 0xb2,
+    0xcf, 0xff, 0xd5, 0xaa, 0xaf, 0xff, 0xd6, 0xab, 0x1e, 0xbf, 0xff, 0xd7, 0xb2, 0xcf, 0xff, 0xd0,
+    0xba, 0xaf, 0xff, 0xd1, 0xaa, 0xaf, 0xff, 0xd2, 0xab, 0x1e, 0xbf, 0xff, 0xd3, 0xf7, 0x3d, 0xcf,
+    0xff, 0xd4, 0xc9, 0xac, 0xda, 0xff, 0xd5, 0xf5, 0x3d, 0x0f, 0xff, 0xd6, 0xf6, 0x3e, 0x0e, 0xbf,
+    0xff, 0xd9,
+};
+
+const unsigned char PROGRESSIVE_GRAY_JPEG[] = {
+    0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+    0x00, 0x01, 0x00, 0x00, 0xff, 0xdb, 0x00, 0x43, 0x00, 0x03, 0x02, 0x02, 0x03, 0x02, 0x02, 0x03,
+    0x03, 0x03, 0x03, 0x04, 0x03, 0x03, 0x04, 0x05, 0x08, 0x05, 0x05, 0x04, 0x04, 0x05, 0x0a, 0x07,
+    0x07, 0x06, 0x08, 0x0c, 0x0a, 0x0c, 0x0c, 0x0b, 0x0a, 0x0b, 0x0b, 0x0d, 0x0e, 0x12, 0x10, 0x0d,
+    0x0e, 0x11, 0x0e, 0x0b, 0x0b, 0x10, 0x16, 0x10, 0x11, 0x13, 0x14, 0x15, 0x15, 0x15, 0x0c, 0x0f,
+    0x17, 0x18, 0x16, 0x14, 0x18, 0x12, 0x14, 0x15, 0x14, 0xff, 0xc2, 0x00, 0x0b, 0x08, 0x00, 0x15,
+    0x00, 0x25, 0x01, 0x01, 0x11, 0x00, 0xff, 0xc4, 0x00, 0x16, 0x00, 0x01, 0x01, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x08, 0x07, 0xff, 0xda,
+    0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x00, 0x01, 0xc3, 0xdb, 0x35, 0x6a, 0xc6, 0x44, 0x6a, 0xd5,
+    0xb3, 0x09, 0x09, 0xab, 0x66, 0xac, 0x3f, 0xff, 0xc4, 0x00, 0x18, 0x10, 0x00, 0x03, 0x01, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x04, 0x02,
+    0x22, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x05, 0x02, 0x91, 0x64, 0x8b, 0x24, 0x59,
+    0x22, 0xc4, 0xaf, 0x99, 0x16, 0x48, 0xb2, 0x45, 0x92, 0x2c, 0x4a, 0xf9, 0x93, 0x24, 0x99, 0x24,
+    0xc9, 0x26, 0x44, 0xe7, 0x9f, 0xff, 0xc4, 0x00, 0x14, 0x10, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0xff, 0xda, 0x00, 0x08, 0x01,
+    0x01, 0x00, 0x06, 0x3f, 0x02, 0x7f, 0xff, 0xc4, 0x00, 0x18, 0x10, 0x00, 0x03, 0x01, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x31, 0x21, 0x10,
+    0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f, 0x21, 0x99, 0x32, 0x64, 0xf9, 0xe6, 0x4c,
+    0x99, 0x3e, 0x75, 0xe0, 0xbc, 0x17, 0x82, 0xf0, 0x59, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00,
+    0x00, 0x00, 0x10, 0xb3, 0x77, 0xff, 0xc4, 0x00, 0x18, 0x10, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x51, 0x21, 0x11, 0x20, 0xff,
+    0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f, 0x10, 0x85, 0x0a, 0x14, 0x2c, 0xb8, 0x85, 0x0a,
+    0x14, 0x2c, 0xb9, 0xe5, 0xdd, 0xdf, 0x9e, 0xff, 0xd9,
+};
+
+static std::vector<uint8_t> makeSmoothPixels(int width, int height, int channels) {
+    // Gentle gradients: block averages survive chroma subsampling and quantization
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* pixel = &pixels[(static_cast<size_t>(y) * width + x) * channels];
+            pixel[0] = static_cast<uint8_t>(30 + x * 180 / width);
+            if (channels >= 3) {
+                pixel[1] = static_cast<uint8_t>(220 - y * 160 / height);
+                pixel[2] = static_cast<uint8_t>(120 + 60 * std::sin((x + y) * 0.02));
+            }
+        }
+    }
+    return pixels;
+}
+
+static std::vector<uint8_t> encodeJpeg(const std::vector<uint8_t>& pixels, int width, int height,
+                                       int channels, int quality) {
+    std::vector<uint8_t> jpeg;
+    stbi_write_jpg_to_func(appendToVector, &jpeg, width, height, channels, pixels.data(), quality);
+    return jpeg;
+}
+
+// Compare each preview pixel with the mean of the matching 8x8 block of stb_image's full decode
+static void assertPreviewMatchesStb(const uint8_t* jpeg, size_t size, bool refineDc,
+                                    double meanTolerance, int maxTolerance) {
+    JpegPreviewDecoder decoder;
+    ImageBuffer preview;
+    assert(decoder.decodePreview(jpeg, size, preview, 3, refineDc));
+
+    int width = 0, height = 0, sourceChannels = 0;
+    stbi_uc* reference = stbi_load_from_memory(jpeg, static_cast<int>(size), &width, &height, &sourceChannels, 3);
+    assert(reference);
+    assert(preview.width == (width + 7) / 8 && preview.height == (height + 7) / 8);
+
+    double totalError = 0.0;
+    int maxError = 0;
+    for (int by = 0; by < preview.height; ++by) {
+        for (int bx = 0; bx < preview.width; ++bx) {
+            for (int c = 0; c < 3; ++c) {
+                int sum = 0, count = 0;
+                for (int y = by * 8; y < std::min(height, by * 8 + 8); ++y) {
+                    for (int x = bx * 8; x < std::min(width, bx * 8 + 8); ++x) {
+                        sum += reference[(static_cast<size_t>(y) * width + x) * 3 + c];
+                        ++count;
+                    }
+                }
+                const int error = std::abs((sum + count / 2) / count - preview.row(by)[bx * 3 + c]);
+                totalError += error;
+                maxError = std::max(maxError, error);
+            }
+        }
+    }
+    stbi_image_free(reference);
+
+    const double meanError = totalError / (preview.width * preview.height * 3);
+    assert(meanError <= meanTolerance);
+    assert(maxError <= maxTolerance);
+}
+
+void testProgressivePreview() {
+    std::cout << "Testing progressive DC-scan previews..." << std::endl;
+
+    JpegPreviewDecoder decoder;
+    JpegInfo info;
+    assert(decoder.readInfo(PROGRESSIVE_YCBCR_420_JPEG, sizeof(PROGRESSIVE_YCBCR_420_JPEG), info));
+    assert(info.width == 60 && info.height == 44 && info.components == 3 && info.progressive);
+
+    // Parsing stops after the first scan unless DC refinement is requested
+    ImageBuffer preview;
+    ImageBuffer refined;
+    assert(decoder.decodePreview(PROGRESSIVE_YCBCR_420_JPEG, sizeof(PROGRESSIVE_YCBCR_420_JPEG), preview));
+    assert(preview.width == 8 && preview.height == 6 && preview.channels == 4);
+    assert(decoder.getScansDecoded() == 1);
+    assert(decoder.decodePreview(PROGRESSIVE_YCBCR_420_JPEG, sizeof(PROGRESSIVE_YCBCR_420_JPEG), refined, 4, true));
+    assert(decoder.getScansDecoded() == 2);
+    std::cout << "  ✓ Early stop after the DC scan" << std::endl;
+
+    assertPreviewMatchesStb(PROGRESSIVE_YCBCR_420_JPEG, sizeof(PROGRESSIVE_YCBCR_420_JPEG), false, 6.0, 32);
+    assertPreviewMatchesStb(PROGRESSIVE_YCBCR_420_JPEG, sizeof(PROGRESSIVE_YCBCR_420_JPEG), true, 6.0, 32);
+    assertPreviewMatchesStb(PROGRESSIVE_GRAY_JPEG, sizeof(PROGRESSIVE_GRAY_JPEG), false, 3.0, 10);
+    assertPreviewMatchesStb(PROGRESSIVE_GRAY_JPEG, sizeof(PROGRESSIVE_GRAY_JPEG), true, 3.0, 10);
+    std::cout << "  ✓ Block averages match stb_image full decodes (4:2:0 with restarts, grayscale)" << std::endl;
+
+    // Everything after the second scan header is AC detail the preview never needs
+    const uint8_t* begin = PROGRESSIVE_YCBCR_420_JPEG;
+    const uint8_t* end = begin + sizeof(PROGRESSIVE_YCBCR_420_JPEG);
+    const uint8_t sos[] = {0xFF, 0xDA};
+    const uint8_t* firstScan = std::search(begin, end, sos, sos + 2);
+    const uint8_t* secondScan = std::search(firstScan + 2, end, sos, sos + 2);
+    assert(secondScan != end);
+    ImageBuffer prefixPreview;
+    assert(decoder.decodePreview(begin, secondScan - begin, prefixPreview));
+    assert(prefixPreview.pixels == preview.pixels);
+    std::cout << "  ✓ Preview decodes from a file prefix ending after the DC scan" << std::endl;
+
+    std::cout << "✓ Progressive preview tests passed" << std::endl;
+}
+
+void testBaselinePreview() {
+    std::cout << "Testing baseline previews (AC skipped by Huffman decode only)..." << std::endl;
+
+    // Edge MCUs carry encoder padding in their chroma DC, so tiny subsampled images are
+    // left out; the tolerances cover the chroma averaging of the larger ones
+    const int sizes[][2] = {{64, 32}, {67, 29}, {256, 160}};
+    for (const auto& size : sizes) {
+        for (int channels : {1, 3}) {
+            const auto pixels = makeSmoothPixels(size[0], size[1], channels);
+            // stb_image_write subsamples chroma at quality <= 90 and keeps 4:4:4 above it
+            for (int quality : {75, 95}) {
+                const auto jpeg = encodeJpeg(pixels, size[0], size[1], channels, quality);
+                assertPreviewMatchesStb(jpeg.data(), jpeg.size(), false, 8.0, 40);
+            }
+        }
+    }
+
+    std::cout << "✓ Baseline preview tests passed" << std::endl;
+}
+
+void testTruncatedAndInvalidInput() {
+    std::cout << "Testing truncated and invalid input..." << std::endl;
+
+    JpegPreviewDecoder decoder;
+    ImageBuffer preview;
+
+    // Data ending before the DC scan completes is reported as truncated
+    for (size_t cut : {size_t(3), size_t(64), sizeof(PROGRESSIVE_GRAY_JPEG) / 3}) {
+        assert(!decoder.decodePreview(PROGRESSIVE_GRAY_JPEG, cut, preview));
+        assert(decoder.getLastErrorCode() == JpegPreviewDecoder::ErrorCode::Truncated);
+    }
+
+    const uint8_t notJpeg[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    assert(!decoder.decodePreview(notJpeg, sizeof(notJpeg), preview));
+    assert(decoder.getLastErrorCode() == JpegPreviewDecoder::ErrorCode::InvalidSignature);
+
+    // Bit flips must never crash (they may or may not decode)
+    std::vector<uint8_t> damaged(PROGRESSIVE_YCBCR_420_JPEG,
+                                 PROGRESSIVE_YCBCR_420_JPEG + sizeof(PROGRESSIVE_YCBCR_420_JPEG));
+    for (size_t i = 2; i < damaged.size(); i += 5) {
+        damaged[i] ^= 0x24;
+        decoder.decodePreview(damaged.data(), damaged.size(), preview, 4, true);
+    }
+
+    std::cout << "✓ Truncated and invalid input tests passed" << std::endl;
+}
+
+void testImageDecoderPreview() {
+    std::cout << "Testing ImageDecoder preview dispatch..." << std::endl;
+
+    ImageDecoder decoder;
+    ImageBuffer image;
+
+    assert(decoder.decodePreviewMemory(PROGRESSIVE_YCBCR_420_JPEG, sizeof(PROGRESSIVE_YCBCR_420_JPEG), image));
+    assert(decoder.isPreview() && image.width == 8 && image.height == 6);
+
+    // The full decode that refines the preview
+    assert(decoder.decodeMemory(PROGRESSIVE_YCBCR_420_JPEG, sizeof(PROGRESSIVE_YCBCR_420_JPEG), image));
+    assert(!decoder.isPreview() && image.width == 60 && image.height == 44);
+
+    // Non-JPEG input decodes at full size
+    const auto pixels = makeSmoothPixels(19, 7, 3);
+    std::vector<uint8_t> png;
+    stbi_write_png_to_func(appendToVector, &png, 19, 7, 3, pixels.data(), 19 * 3);
+    assert(decoder.decodePreviewMemory(png.data(), png.size(), image));
+    assert(!decoder.isPreview() && image.width == 19 && image.height == 7);
+
+    // A file larger than the preview read size; baseline DC is spread over the whole
+    // file, so the truncated prefix is retried with the complete file
+    auto large = makeSmoothPixels(1600, 1200, 3);
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<uint8_t>(large[i] + ((i * 2654435761u) >> 28));
+    }
+    const auto jpeg = encodeJpeg(large, 1600, 1200, 3, 95);
+    assert(jpeg.size() > ImageDecoder::PREVIEW_READ_BYTES);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "caithe_test_preview.jpg").string();
+    writeFile(path, jpeg);
+    assert(decoder.decodePreviewFile(path, image));
+    assert(decoder.isPreview() && image.width == 200 && image.height == 150);
+    std::remove(path.c_str());
+
+    assert(!decoder.decodePreviewFile(path, image));
+    assert(decoder.getLastErrorCode() == ImageDecoder::ErrorCode::FileNotFound);
+
+    std::cout << "✓ ImageDecoder preview tests passed" << std::endl;
+}
+
+void benchmarkPreview() {
+    std::cout << "Benchmarking 3840x2160 preview against full decode..." << std::endl;
+
+    const int width = 3840, height = 2160;
+    const int iterations = 5;
+    const auto pixels = makeSmoothPixels(width, height, 3);
+    const auto jpeg = encodeJpeg(pixels, width, height, 3, 90);
+
+    JpegPreviewDecoder decoder;
+    ImageBuffer preview;
+    Stopwatch timer;
+    for (int i = 0; i < iterations; ++i) {
+        assert(decoder.decodePreview(jpeg.data(), jpeg.size(), preview));
+    }
+    const double previewMs = timer.elapsed() / iterations;
+
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        int w = 0, h = 0, n = 0;
+        stbi_uc* full = stbi_load_from_memory(jpeg.data(), static_cast<int>(jpeg.size()), &w, &h, &n, 4);
+        assert(full);
+        stbi_image_free(full);
+    }
+    const double fullMs = timer.elapsed() / iterations;
+
+    std::cout << "  Baseline preview: " << previewMs << " ms, stb_image full decode: " << fullMs << " ms" << std::endl;
+    std::cout << "✓ Benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing JPEG preview decoder..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testProgressivePreview();
+        testBaselinePreview();
+        testTruncatedAndInvalidInput();
+        testImageDecoderPreview();
+        benchmarkPreview();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All JPEG preview tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "JPEG preview test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,247 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_logger.cpp
+ * Description: Tests for the binary logger: records, levels, threads and rotation
+ */
+
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/utils/Logger.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+enum class Mode { Stretch = 2 };
+
+static std::vector<std::string> readLines(const fs::path& path) {
+    std::vector<std::string> lines;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static int evaluations = 0;
+static int countedArgument() {
+    return ++evaluations;
+}
+
+void testRecords(const fs::path& root) {
+    std::cout << "Testing record formatting..." << std::endl;
+
+    Logger& logger = Logger::instance();
+    const fs::path file = root / "records" / "caithe.log";
+    assert(logger.setFile(file.string()));
+    logger.setLevel(LogLevel::Debug);
+
+    const std::string path = "/home/user/Pictures/wall.png";
+    CAITHE_LOG_INFO("Applied {} to display {} in {} ms", path, 1, 2.5);
+    CAITHE_LOG_WARNING("Flags: {} {} {} {}", true, 'x', Mode::Stretch, static_cast<uint64_t>(1) << 40);
+    CAITHE_LOG_ERROR("Missing {} and {}", "one");
+    CAITHE_LOG_DEBUG("Frame {}", -7);
+    CAITHE_LOG_INFO("Long {}", std::string(5000, 'a'));
+    logger.flush();
+
+    const std::vector<std::string> lines = readLines(file);
+    assert(lines.size() == 5);
+    assert(lines[0].find(" INFO  [t") != std::string::npos);
+    assert(endsWith(lines[0], "] Applied /home/user/Pictures/wall.png to display 1 in 2.5 ms"));
+    assert(endsWith(lines[1], "] Flags: true x 2 1099511627776") && lines[1].find(" WARN  ") != std::string::npos);
+    assert(endsWith(lines[2], "] Missing one and {}"));
+    assert(lines[3].find("Frame -7 (test_logger.cpp:") != std::string::npos);
+    assert(lines[4].size() < 700 && lines[4].find(std::string(Logger::MAX_STRING_BYTES, 'a')) != std::string::npos);
+    assert(lines[0].size() > 24 && lines[0][4] == '-' && lines[0][19] == '.');
+    std::cout << "  ✓ Integers, floats, bools, chars, enums and strings format after the fact" << std::endl;
+    std::cout << "  ✓ Missing arguments, long strings and debug locations" << std::endl;
+
+    logger.setLevel(LogLevel::Warning);
+    evaluations = 0;
+    CAITHE_LOG_DEBUG("Skipped {}", countedArgument());
+    CAITHE_LOG_INFO("Skipped {}", countedArgument());
+    CAITHE_LOG_ERROR("Kept {}", countedArgument());
+    logger.flush();
+    assert(evaluations == 1);
+    assert(readLines(file).size() == 6 && endsWith(readLines(file).back(), "] Kept 1"));
+    std::cout << "  ✓ Disabled levels skip the call, arguments included" << std::endl;
+
+    assert(Logger::parseLevel("Debug", LogLevel::Info) == LogLevel::Debug);
+    assert(Logger::parseLevel("warn", LogLevel::Info) == LogLevel::Warning);
+    assert(Logger::parseLevel("loud", LogLevel::Error) == LogLevel::Error);
+    std::cout << "  ✓ Level names parse" << std::endl;
+
+    std::cout << "✓ Record formatting tests passed" << std::endl;
+}
+
+void testThreads(const fs::path& root) {
+    std::cout << "Testing per-thread rings..." << std::endl;
+
+    Logger& logger = Logger::instance();
+    const fs::path file = root / "threads.log";
+    assert(logger.setFile(file.string()));
+    logger.setLevel(LogLevel::Info);
+    const Logger::Stats before = logger.getStats();
+
+    // Each thread stays within its own ring, so nothing may be dropped
+    const int threads = 8;
+    const int perThread = 1000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([t]() {
+            for (int i = 0; i < perThread; ++i) {
+                CAITHE_LOG_INFO("worker {} event {}", t, i);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    logger.flush();
+
+    Logger::Stats after = logger.getStats();
+    std::vector<std::string> lines = readLines(file);
+    assert(after.dropped == before.dropped);
+    assert(lines.size() == static_cast<size_t>(threads * perThread));
+    std::vector<int> last(threads, -1);
+    for (const std::string& line : lines) {
+        const size_t at = line.find("worker ");
+        assert(at != std::string::npos);
+        int t = 0;
+        int i = 0;
+        std::istringstream(line.substr(at + 7)) >> t;
+        std::istringstream(line.substr(line.find("event ") + 6)) >> i;
+        assert(i == last[t] + 1);
+        last[t] = i;
+    }
+    std::cout << "  ✓ " << lines.size() << " records from " << threads << " threads, each thread in order" << std::endl;
+
+    assert(after.threads == before.threads);
+    std::cout << "  ✓ Rings of exited threads are drained and released" << std::endl;
+
+    // A burst larger than the ring drops records instead of blocking
+    const int burst = 20000;
+    std::thread([]() {
+        for (int i = 0; i < burst; ++i) {
+            CAITHE_LOG_INFO("burst event {}", i);
+        }
+    }).join();
+    logger.flush();
+    const Logger::Stats burstStats = logger.getStats();
+    const size_t burstLines = readLines(file).size() - lines.size();
+    assert(burstStats.dropped > after.dropped);
+    assert(burstLines + (burstStats.dropped - after.dropped) == static_cast<size_t>(burst));
+    std::cout << "  ✓ A burst of " << burst << " kept " << burstLines << " records and counted "
+              << (burstStats.dropped - after.dropped) << " drops" << std::endl;
+
+    std::cout << "✓ Per-thread ring tests passed" << std::endl;
+}
+
+void testRotation(const fs::path& root) {
+    std::cout << "Testing rotation..." << std::endl;
+
+    Logger& logger = Logger::instance();
+    const fs::path file = root / "rotate.log";
+    assert(logger.setFile(file.string(), 8192, 2));
+    const uint64_t rotations = logger.getStats().rotations;
+    for (int batch = 0; batch < 20; ++batch) {
+        for (int i = 0; i < 40; ++i) {
+            CAITHE_LOG_INFO("rotation batch {} line {} padding {}", batch, i, std::string(40, 'p'));
+        }
+        logger.flush();
+    }
+
+    assert(logger.getStats().rotations > rotations);
+    assert(fs::exists(file) && fs::exists(root / "rotate.log.1") && fs::exists(root / "rotate.log.2"));
+    assert(!fs::exists(root / "rotate.log.3"));
+    assert(fs::file_size(file) <= 8192 && fs::file_size(root / "rotate.log.1") <= 8192);
+    assert(endsWith(readLines(file).back(), "batch 19 line 39 padding " + std::string(40, 'p')));
+    std::cout << "  ✓ The file rotates at its size limit and keeps two old files" << std::endl;
+
+    std::ofstream(root / "plain") << "not a directory";
+    assert(!logger.setFile((root / "plain" / "caithe.log").string()));
+    assert(logger.getLastErrorCode() == Logger::ErrorCode::OpenFailed);
+    logger.clearError();
+    assert(logger.setFile(""));
+    std::cout << "  ✓ Open failures are reported; an empty path disables the file" << std::endl;
+
+    std::cout << "✓ Rotation tests passed" << std::endl;
+}
+
+void benchmarkLogger(const fs::path& root) {
+    std::cout << "Benchmarking log calls..." << std::endl;
+
+    Logger& logger = Logger::instance();
+    assert(logger.setFile((root / "bench.log").string()));
+    const int iterations = 200000;
+    const std::string path = "/home/user/Pictures/Wallpapers/forest.png";
+
+    logger.setLevel(LogLevel::Info);
+    Stopwatch timer;
+    for (int i = 0; i < iterations; ++i) {
+        CAITHE_LOG_DEBUG("apply {} display {} took {} ms", path, i, 1.5);
+    }
+    const double disabledNs = timer.elapsed<std::nano>() / iterations;
+
+    // Bursts of 500 fit in the ring; only the logging calls are timed
+    logger.setLevel(LogLevel::Debug);
+    const uint64_t droppedBefore = logger.getStats().dropped;
+    double enabledNs = 0.0;
+    for (int i = 0; i < iterations; i += 500) {
+        timer.restart();
+        for (int j = i; j < i + 500; ++j) {
+            CAITHE_LOG_DEBUG("apply {} display {} took {} ms", path, j, 1.5);
+        }
+        enabledNs += timer.elapsed<std::nano>();
+        logger.flush();
+    }
+    enabledNs /= iterations;
+    assert(logger.getStats().dropped == droppedBefore);
+    logger.setLevel(LogLevel::Info);
+
+    std::ostringstream sink;
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        sink << "apply " << path << " display " << i << " took " << 1.5 << " ms" << std::endl;
+    }
+    const double streamNs = timer.elapsed<std::nano>() / iterations;
+    std::cout << "  Per call: disabled " << disabledNs << " ns, recorded " << enabledNs << " ns, iostream formatting "
+              << streamNs << " ns" << std::endl;
+
+    assert(logger.setFile(""));
+    std::cout << "✓ Logger benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing binary logger..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    Logger::instance().setStderrLevel(LogLevel::Off);
+    const fs::path root = makeTempRoot("logger");
+    try {
+        testRecords(root);
+        testThreads(root);
+        testRotation(root);
+        benchmarkLogger(root);
+
+        fs::remove_all(root);
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All logger tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        fs::remove_all(root);
+        std::cerr << "Logger test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
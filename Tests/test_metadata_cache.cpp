@@ -0,0 +1,196 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_metadata_cache.cpp
+ * Description: Tests for the shared statx/canonical cache and its inotify invalidation
+ */
+
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include "../src/utils/FileUtils.h"
+#include "../src/utils/MetadataCache.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+void testCaching(const fs::path& root) {
+    std::cout << "Testing cached lookups..." << std::endl;
+
+    const fs::path dir = root / "ttl";
+    fs::create_directories(dir);
+    const std::string file = (dir / "wall.png").string();
+    writeFile(file, "12345");
+
+    MetadataCache cache;
+    cache.setTtl(std::chrono::milliseconds(60000));
+    FileMetadata metadata = cache.stat(file);
+    assert(metadata.exists && metadata.isRegularFile && !metadata.isDirectory);
+    assert(metadata.size == 5 && metadata.modified > 0 && metadata.inode != 0);
+    assert(cache.exists(file) && cache.isRegularFile(file) && !cache.isDirectory(file));
+    assert(cache.getStats().misses == 1 && cache.getStats().hits == 3);
+    std::cout << "  ✓ One statx answers every later existence, type and size check" << std::endl;
+
+    const std::string missing = (dir / "missing.png").string();
+    assert(!cache.exists(missing) && !cache.exists(missing));
+    assert(cache.stat(missing).error == ENOENT);
+    assert(cache.getStats().misses == 2);
+    std::cout << "  ✓ Missing files are cached too" << std::endl;
+
+    assert(cache.intern(file) == cache.intern(file) && cache.intern(file) != cache.intern(missing));
+    std::cout << "  ✓ Paths intern to stable ids" << std::endl;
+
+    // Unwatched paths trust the cache only for the TTL
+    fs::remove(file);
+    assert(cache.exists(file));
+    cache.setTtl(std::chrono::milliseconds(20));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    assert(!cache.exists(file));
+    assert(cache.getStats().expirations == 1);
+    writeFile(file, "x");
+    cache.invalidate(file);
+    assert(cache.exists(file));
+    std::cout << "  ✓ Unwatched entries expire after the TTL or on invalidate()" << std::endl;
+
+    const fs::path target = dir / "target";
+    fs::create_directories(target);
+    fs::create_symlink(target, dir / "link");
+    const std::string viaLink = (dir / "link" / ".." / "link").string();
+    assert(cache.canonical(viaLink) == fs::canonical(target).string());
+    assert(cache.canonical((dir / "nope").string()).empty());
+    std::cout << "  ✓ Canonical forms resolve symlinks and fail cleanly" << std::endl;
+
+    std::cout << "✓ Cached lookup tests passed" << std::endl;
+}
+
+void testInotify(const fs::path& root) {
+    std::cout << "Testing inotify invalidation..." << std::endl;
+
+    const fs::path dir = root / "watched";
+    fs::create_directories(dir);
+    const std::string file = (dir / "wall.png").string();
+    writeFile(file, "1");
+
+    MetadataCache cache;
+    cache.setTtl(std::chrono::milliseconds(1));
+    assert(cache.exists(file));
+    if (!cache.watch(dir.string() + "/")) {
+        std::cout << "  inotify not available here (" << cache.getLastError() << "); skipped" << std::endl;
+        return;
+    }
+    assert(cache.isWatched(file) && cache.isWatched(dir.string()) && cache.getStats().watches == 1);
+    assert(cache.watch(dir.string()) && cache.getStats().watches == 1);
+
+    // Watched entries outlive the 1 ms TTL: one syscall, then hits only
+    const uint64_t missesBefore = cache.getStats().misses;
+    for (int i = 0; i < 100; ++i) {
+        assert(cache.stat(file).size == 1);
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    assert(cache.getStats().misses == missesBefore + 1);
+    std::cout << "  ✓ Watched paths ignore the TTL" << std::endl;
+
+    writeFile(file, "12345");
+    assert(waitFor([&]() { return cache.stat(file).size == 5; }));
+    fs::remove(file);
+    assert(waitFor([&]() { return !cache.exists(file); }));
+    const std::string created = (dir / "new.png").string();
+    assert(!cache.exists(created));
+    writeFile(created, "n");
+    assert(waitFor([&]() { return cache.exists(created); }));
+    fs::rename(created, file);
+    assert(waitFor([&]() { return cache.exists(file) && !cache.exists(created); }));
+    std::cout << "  ✓ Writes, deletes, creates and renames invalidate" << std::endl;
+
+    const fs::path real = dir / "real";
+    const fs::path other = dir / "other";
+    fs::create_directories(real);
+    fs::create_directories(other);
+    fs::create_symlink(real, dir / "current");
+    const std::string current = (dir / "current").string();
+    assert(cache.canonical(current) == fs::canonical(real).string());
+    fs::remove(dir / "current");
+    fs::create_symlink(other, dir / "current");
+    assert(waitFor([&]() { return cache.canonical(current) == fs::canonical(other).string(); }));
+    std::cout << "  ✓ A swapped symlink changes the canonical form" << std::endl;
+
+    cache.unwatch(dir.string());
+    assert(!cache.isWatched(file) && cache.getStats().watches == 0);
+    std::cout << "  ✓ Unwatched directories fall back to the TTL" << std::endl;
+
+    std::cout << "✓ Inotify invalidation tests passed" << std::endl;
+}
+
+void testFileUtils(const fs::path& root) {
+    std::cout << "Testing FileUtils integration..." << std::endl;
+
+    const std::string file = (root / "shared.png").string();
+    writeFile(file, "x");
+    MetadataCache& shared = MetadataCache::instance();
+    const uint64_t misses = shared.getStats().misses;
+    assert(FileUtils::fileExists(file) && FileUtils::fileExists(file));
+    assert(FileUtils::normalizePath(file) == fs::canonical(file).string());
+    assert(FileUtils::normalizePath(file) == fs::canonical(file).string());
+    assert(shared.getStats().misses == misses + 2);
+    assert(FileUtils::normalizePath("relative/missing.png") == "relative/missing.png");
+    std::cout << "  ✓ fileExists and normalizePath share the process-wide cache" << std::endl;
+
+    std::cout << "✓ FileUtils integration tests passed" << std::endl;
+}
+
+void benchmarkMetadataCache(const fs::path& root) {
+    std::cout << "Benchmarking cached and direct checks..." << std::endl;
+
+    const std::string file = (root / "bench" / "deep" / "nested" / "wall.png").string();
+    fs::create_directories(fs::path(file).parent_path());
+    writeFile(file, "x");
+    const int iterations = 200000;
+
+    Stopwatch timer;
+    int found = 0;
+    for (int i = 0; i < iterations; ++i) {
+        found += fs::exists(file) ? 1 : 0;
+        found += fs::canonical(file).empty() ? 0 : 1;
+    }
+    const double directNs = timer.elapsed<std::nano>() / iterations;
+
+    MetadataCache cache;
+    cache.setTtl(std::chrono::milliseconds(60000));
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        found += cache.exists(file) ? 1 : 0;
+        found += cache.canonical(file).empty() ? 0 : 1;
+    }
+    const double cachedNs = timer.elapsed<std::nano>() / iterations;
+    assert(found == 4 * iterations);
+
+    std::cout << "  exists + canonical: direct " << directNs << " ns, cached " << cachedNs << " ns ("
+              << directNs / cachedNs << "x)" << std::endl;
+
+    std::cout << "✓ Metadata cache benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing metadata cache..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    const fs::path root = makeTempRoot("metadata");
+    try {
+        testCaching(root);
+        testInotify(root);
+        testFileUtils(root);
+        benchmarkMetadataCache(root);
+
+        fs::remove_all(root);
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All metadata cache tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        fs::remove_all(root);
+        std::cerr << "Metadata cache test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
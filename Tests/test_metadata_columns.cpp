@@ -0,0 +1,366 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_metadata_columns.cpp
+ * Description: Tests for the columnar metadata store and gallery filters, plus 100k-image benchmark
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/library/LibraryIndex.h"
+#include "../src/library/MetadataColumns.h"
+#include "../src/library/SelectionBitmap.h"
+#include "../src/utils/TaskScheduler.h"
+#include "TestSupport.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace fs = std::filesystem;
+
+struct SyntheticLibrary {
+    std::vector<LibraryFile> files;
+    std::vector<LibraryContent> contents;
+};
+
+// Random metadata including unprobed contents, rotated JPEGs, missing luminance
+// and pre-1970 modification times
+static SyntheticLibrary makeLibrary(size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    const int widths[] = {640, 1080, 1280, 1920, 2560, 3440, 3840, 5120};
+    const int heights[] = {480, 1080, 1200, 1440, 1600, 1920, 2160, 2880};
+
+    SyntheticLibrary library;
+    library.contents.resize(count);
+    library.files.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        LibraryContent& content = library.contents[i];
+        content.probed = rng() % 20 != 0;
+        if (content.probed) {
+            content.header.format = static_cast<ImageFormat>(1 + rng() % 5);
+            content.header.width = widths[rng() % 8];
+            content.header.height = rng() % 10 == 0 ? content.header.width : heights[rng() % 8];
+            content.header.orientation = rng() % 6 == 0 ? ImageOrientation::Rotate90 : ImageOrientation::Normal;
+            content.hasLuminance = rng() % 10 != 0;
+            content.luminance = static_cast<uint8_t>(rng());
+        }
+
+        // Files point at contents out of order, as after a regroup
+        LibraryFile& file = library.files[(i * 7919) % count];
+        file.content = static_cast<uint32_t>(i);
+        file.mtimeNs = (static_cast<int64_t>(rng() % 2000000000) - 100000000) * 1000000000LL +
+                       static_cast<int64_t>(rng() % 1000000000);
+    }
+    return library;
+}
+
+static int64_t floorSeconds(int64_t ns) {
+    return ns >= 0 ? ns / 1000000000LL : -((-ns + 999999999LL) / 1000000000LL);
+}
+
+// Row-at-a-time reference for filter()
+static bool matchesReference(const SyntheticLibrary& library, size_t row, const MetadataFilter& filter) {
+    const LibraryFile& file = library.files[row];
+    const LibraryContent& content = library.contents[file.content];
+    const int width = content.header.displayWidth();
+    const int height = content.header.displayHeight();
+    const bool known = width > 0 && height > 0;
+
+    if (filter.minWidth > 0 && width < filter.minWidth) return false;
+    if (filter.minHeight > 0 && height < filter.minHeight) return false;
+    if (filter.minAspect > 0.0f || filter.maxAspect > 0.0f) {
+        if (!known) return false;
+        const float aspect = static_cast<float>(width) / static_cast<float>(height);
+        if (aspect < filter.minAspect) return false;
+        if (filter.maxAspect > 0.0f && aspect > filter.maxAspect) return false;
+    }
+    if (!(filter.formats & MetadataFilter::formatBit(content.header.format))) return false;
+    if (!(filter.shapes & MetadataFilter::shapeBit(MetadataColumns::shapeOf(width, height)))) return false;
+
+    const int64_t seconds = std::max<int64_t>(floorSeconds(file.mtimeNs), 0);
+    if (filter.modifiedAfter != 0 && seconds < filter.modifiedAfter) return false;
+    if (filter.modifiedBefore != 0 && seconds > filter.modifiedBefore) return false;
+
+    if (filter.minLuminance > 0 || filter.maxLuminance < 255) {
+        if (!content.hasLuminance) return false;
+        if (content.luminance < filter.minLuminance || content.luminance > filter.maxLuminance) return false;
+    }
+    return true;
+}
+
+static MetadataFilter randomFilter(std::mt19937& rng) {
+    MetadataFilter filter;
+    if (rng() % 2) filter.minWidth = static_cast<int>(rng() % 4000);
+    if (rng() % 2) filter.minHeight = static_cast<int>(rng() % 3000);
+    if (rng() % 3 == 0) filter.minAspect = 0.5f + (rng() % 100) / 50.0f;
+    if (rng() % 3 == 0) filter.maxAspect = 0.5f + (rng() % 150) / 50.0f;
+    if (rng() % 3 == 0) filter.formats = rng() % 64;
+    if (rng() % 3 == 0) filter.shapes = rng() % 16;
+    if (rng() % 3 == 0) filter.modifiedAfter = static_cast<int64_t>(rng() % 2000000000) - 100000000;
+    if (rng() % 3 == 0) filter.modifiedBefore = static_cast<int64_t>(rng() % 2000000000);
+    if (rng() % 3 == 0) filter.minLuminance = static_cast<int>(rng() % 256);
+    if (rng() % 3 == 0) filter.maxLuminance = static_cast<int>(rng() % 256);
+    return filter;
+}
+
+void testSelectionBitmap() {
+    std::cout << "Testing selection bitmaps..." << std::endl;
+
+    SelectionBitmap selection;
+    selection.fill(130);
+    assert(selection.size() == 130 && selection.count() == 130);
+    assert(selection.words().size() == 3 && selection.words()[2] == 0x3);
+    std::cout << "  ✓ fill() leaves bits past the end clear" << std::endl;
+
+    selection.reset(130);
+    selection.set(0);
+    selection.set(63);
+    selection.set(64);
+    selection.set(129);
+    assert(selection.count() == 4 && selection.test(63) && !selection.test(62));
+    selection.unset(63);
+    assert((selection.toRows() == std::vector<uint32_t>{0, 64, 129}));
+    std::cout << "  ✓ set/unset/test and ordered row iteration" << std::endl;
+
+    SelectionBitmap other;
+    other.reset(130);
+    other.set(64);
+    other.set(100);
+    SelectionBitmap both = selection;
+    both.intersectWith(other);
+    assert((both.toRows() == std::vector<uint32_t>{64}));
+    selection.unionWith(other);
+    assert((selection.toRows() == std::vector<uint32_t>{0, 64, 100, 129}));
+    std::cout << "  ✓ Intersection and union" << std::endl;
+
+    std::cout << "✓ Selection bitmap tests passed" << std::endl;
+}
+
+void testFilters() {
+    std::cout << "Testing vectorized filters against a row-at-a-time reference..." << std::endl;
+
+    // Sizes around block boundaries exercise the padded tail
+    for (size_t count : {size_t(0), size_t(1), size_t(63), size_t(64), size_t(65), size_t(5037)}) {
+        const SyntheticLibrary library = makeLibrary(count, static_cast<uint32_t>(count) + 1);
+        MetadataColumns columns;
+        columns.build(library.files, library.contents);
+        assert(columns.size() == count);
+
+        std::mt19937 rng(7);
+        SelectionBitmap selection;
+        for (int trial = 0; trial < 300; ++trial) {
+            const MetadataFilter filter = randomFilter(rng);
+            columns.filter(filter, selection);
+            assert(selection.size() == count);
+            for (size_t row = 0; row < count; ++row) {
+                assert(selection.test(row) == matchesReference(library, row, filter));
+            }
+            if (count % 64 != 0) {
+                assert((selection.words().back() >> (count % 64)) == 0);
+            }
+        }
+    }
+    std::cout << "  ✓ 1800 random compound filters match the reference" << std::endl;
+
+    const SyntheticLibrary library = makeLibrary(1000, 3);
+    MetadataColumns columns;
+    columns.build(library.files, library.contents);
+    SelectionBitmap selection;
+    columns.filter(MetadataFilter{}, selection);
+    assert(selection.count() == 1000);
+    std::cout << "  ✓ An unconstrained filter selects every row, probed or not" << std::endl;
+
+    MetadataFilter impossible;
+    impossible.minAspect = 2.0f;
+    impossible.maxAspect = 1.0f;
+    columns.filter(impossible, selection);
+    assert(selection.count() == 0);
+    impossible = MetadataFilter{};
+    impossible.modifiedBefore = -5;
+    columns.filter(impossible, selection);
+    assert(selection.count() == 0);
+    impossible = MetadataFilter{};
+    impossible.formats = 0;
+    columns.filter(impossible, selection);
+    assert(selection.count() == 0);
+    std::cout << "  ✓ Empty ranges and empty sets select nothing" << std::endl;
+
+    std::cout << "✓ Filter tests passed" << std::endl;
+}
+
+void testShapes() {
+    std::cout << "Testing display shapes..." << std::endl;
+
+    assert(MetadataColumns::shapeOf(1920, 1080) == ImageShape::Landscape);
+    assert(MetadataColumns::shapeOf(1080, 1920) == ImageShape::Portrait);
+    assert(MetadataColumns::shapeOf(1000, 1040) == ImageShape::Square);
+    assert(MetadataColumns::shapeOf(0, 1080) == ImageShape::Unknown);
+
+    // A rotated camera photo is portrait on screen even though it is stored landscape
+    SyntheticLibrary library;
+    library.contents.resize(1);
+    library.contents[0].header.format = ImageFormat::Jpeg;
+    library.contents[0].header.width = 4000;
+    library.contents[0].header.height = 3000;
+    library.contents[0].header.orientation = ImageOrientation::Rotate90;
+    library.files.resize(1);
+    library.files[0].content = 0;
+
+    MetadataColumns columns;
+    columns.build(library.files, library.contents);
+    assert(columns.widths()[0] == 3000 && columns.heights()[0] == 4000);
+
+    MetadataFilter portrait;
+    portrait.shapes = MetadataFilter::shapeBit(ImageShape::Portrait);
+    SelectionBitmap selection;
+    columns.filter(portrait, selection);
+    assert(selection.count() == 1);
+    portrait.maxAspect = 1.0f;
+    portrait.minHeight = 3500;
+    columns.filter(portrait, selection);
+    assert(selection.count() == 1);
+    std::cout << "  ✓ Dimensions, aspect and shape use display orientation" << std::endl;
+
+    std::cout << "✓ Shape tests passed" << std::endl;
+}
+
+void testLibraryFilters() {
+    std::cout << "Testing filters on an indexed library..." << std::endl;
+
+    const fs::path root = makeTempRoot("columns");
+
+    // A dark landscape, a bright landscape and a mid-gray portrait
+    auto writeFlat = [&root](const std::string& name, int width, int height, uint8_t level) {
+        const std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 3, level);
+        std::vector<uint8_t> encoded;
+        assert(stbi_write_png_to_func(appendToVector, &encoded, width, height, 3, pixels.data(), width * 3) != 0);
+        const std::string path = (root / name).string();
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(encoded.data()),
+                                                    static_cast<std::streamsize>(encoded.size()));
+        return path;
+    };
+    const std::string dark = writeFlat("dark.png", 320, 180, 20);
+    const std::string bright = writeFlat("bright.png", 320, 180, 230);
+    const std::string portrait = writeFlat("portrait.png", 180, 320, 128);
+
+    TaskScheduler scheduler(2);
+    LibraryIndex index;
+    assert(index.indexDirectory(root.string(), scheduler));
+    assert(index.findContent(dark)->hasLuminance && index.findContent(dark)->luminance == 20);
+    assert(index.findContent(bright)->luminance == 230);
+    std::cout << "  ✓ Mean luminance measured from the thumbnail" << std::endl;
+
+    auto selectedPaths = [&index](const MetadataFilter& filter) {
+        SelectionBitmap selection;
+        index.filterFiles(filter, selection);
+        std::vector<std::string> paths;
+        selection.forEach([&](size_t row) { paths.push_back(index.getFiles()[row].path); });
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    };
+
+    MetadataFilter darkOnly;
+    darkOnly.maxLuminance = 60;
+    assert((selectedPaths(darkOnly) == std::vector<std::string>{dark}));
+
+    MetadataFilter landscapes;
+    landscapes.minAspect = 1.5f;
+    landscapes.formats = MetadataFilter::formatBit(ImageFormat::Png);
+    std::vector<std::string> expected = {bright, dark};
+    std::sort(expected.begin(), expected.end());
+    assert(selectedPaths(landscapes) == expected);
+    std::cout << "  ✓ Luminance, aspect and format filters on real files" << std::endl;
+
+    // The columns follow index changes
+    index.removeFile(dark);
+    assert(selectedPaths(darkOnly).empty());
+    assert(index.getColumns().size() == 2);
+    std::cout << "  ✓ Columns rebuilt after the index changes" << std::endl;
+
+    const std::string indexPath = (root / "library.idx").string();
+    assert(index.save(indexPath));
+    LibraryIndex loaded;
+    assert(loaded.load(indexPath));
+    assert(loaded.findContent(bright)->hasLuminance && loaded.findContent(bright)->luminance == 230);
+    MetadataFilter brightOnly;
+    brightOnly.minLuminance = 200;
+    SelectionBitmap selection;
+    loaded.filterFiles(brightOnly, selection);
+    assert(selection.count() == 1);
+    std::cout << "  ✓ Luminance persisted in the index" << std::endl;
+
+    fs::remove_all(root);
+    std::cout << "✓ Library filter tests passed" << std::endl;
+}
+
+void benchmarkFilters() {
+    std::cout << "Benchmarking compound filters over 100k images..." << std::endl;
+
+    const SyntheticLibrary library = makeLibrary(100000, 42);
+    MetadataColumns columns;
+    Stopwatch buildTimer;
+    columns.build(library.files, library.contents);
+    const double buildMs = buildTimer.elapsed();
+
+    // A slider sweep: 4K-ish landscapes in a moving luminance window, recent, PNG or JPEG
+    MetadataFilter filter;
+    filter.minWidth = 2560;
+    filter.minHeight = 1080;
+    filter.minAspect = 1.3f;
+    filter.maxAspect = 2.5f;
+    filter.formats = MetadataFilter::formatBit(ImageFormat::Png) | MetadataFilter::formatBit(ImageFormat::Jpeg);
+    filter.shapes = MetadataFilter::shapeBit(ImageShape::Landscape);
+    filter.modifiedAfter = 1000000000;
+
+    SelectionBitmap selection;
+    const int iterations = 1000;
+    size_t matched = 0;
+    Stopwatch timer;
+    for (int i = 0; i < iterations; ++i) {
+        filter.minLuminance = i % 128;
+        filter.maxLuminance = 128 + i % 128;
+        columns.filter(filter, selection);
+        matched += selection.count();
+    }
+    const double filterUs = timer.elapsed<std::micro>() / iterations;
+
+    MetadataFilter single;
+    single.minWidth = 3000;
+    Stopwatch singleTimer;
+    for (int i = 0; i < iterations; ++i) {
+        columns.filter(single, selection);
+    }
+    const double singleUs = singleTimer.elapsed<std::micro>() / iterations;
+
+    std::cout << "  Build: " << buildMs << " ms" << std::endl;
+    std::cout << "  Compound filter: " << filterUs << " us (" << matched / iterations << " rows avg)" << std::endl;
+    std::cout << "  Single predicate: " << singleUs << " us" << std::endl;
+    std::cout << "✓ Benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing columnar metadata and gallery filters..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testSelectionBitmap();
+        testFilters();
+        testShapes();
+        testLibraryFilters();
+        benchmarkFilters();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All metadata column tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Metadata column test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,225 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_mount_guard.cpp
+ * Description: Tests for deadline-bounded filesystem calls on network mounts
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "../src/utils/FileUtils.h"
+#include "../src/utils/MetadataCache.h"
+#include "../src/utils/MountGuard.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+using std::chrono::milliseconds;
+
+// A mountinfo where `networkDir` is an NFS mount and everything else is local ext4
+static std::string writeMountinfo(const fs::path& root, const fs::path& networkDir) {
+    const std::string path = (root / "mountinfo").string();
+    std::ofstream file(path);
+    file << "22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n";
+    file << "40 22 0:45 / " << networkDir.string() << " rw,relatime shared:30 - nfs4 server:/export rw,vers=4.2\n";
+    file << "41 22 0:46 / /mnt/with\\040space rw - cifs //server/share rw\n";
+    return path;
+}
+
+void testClassification(const fs::path& root) {
+    std::cout << "Testing mount classification..." << std::endl;
+
+    const fs::path network = root / "nfs";
+    fs::create_directories(network);
+    MountGuard guard(2);
+    assert(guard.loadMounts(writeMountinfo(root, network)));
+
+    assert(guard.mountOf((network / "a" / "b.png").string()).fsType == "nfs4");
+    assert(guard.mountOf(network.string()).fsType == "nfs4");
+    assert(guard.mountOf(network.string() + "-sibling/x.png").fsType == "ext4");
+    assert(guard.mountOf((network / ".." / "x.png").string()).fsType == "ext4");
+    assert(guard.mountOf("/mnt/with space/wall.png").fsType == "cifs");
+    std::cout << "  ✓ Longest mount point wins on component boundaries, escapes decoded" << std::endl;
+
+    assert(guard.isNetwork((network / "wall.png").string()));
+    assert(guard.isNetwork("/mnt/with space/wall.png"));
+    assert(!guard.isNetwork((root / "wall.png").string()));
+    std::cout << "  ✓ Network mounts are told apart from local ones" << std::endl;
+
+    assert(MountGuard::isNetworkMagic(0x6969) && MountGuard::isNetworkMagic(0xFF534D42));
+    assert(MountGuard::isNetworkMagic(0x65735546) && !MountGuard::isNetworkMagic(0xEF53));
+    assert(MountGuard::isNetworkType("nfs") && MountGuard::isNetworkType("fuse.sshfs"));
+    assert(!MountGuard::isNetworkType("ext4") && !MountGuard::isNetworkType("tmpfs"));
+    std::cout << "  ✓ statfs magics and mount types" << std::endl;
+
+    std::cout << "✓ Mount classification tests passed" << std::endl;
+}
+
+void testDeadlines(const fs::path& root) {
+    std::cout << "Testing deadlines..." << std::endl;
+
+    const fs::path network = root / "hung";
+    fs::create_directories(network);
+    const std::string path = (network / "wall.png").string();
+    MountGuard guard(2);
+    guard.loadMounts(writeMountinfo(root, network));
+    guard.setDeadline(milliseconds(50));
+    guard.setStallCooldown(milliseconds(300));
+
+    int result = 0;
+    assert(guard.call<int>((root / "local.png").string(), []() { return 1; }, result) == IoStatus::Ok);
+    assert(result == 1 && guard.getStats().inlineCalls == 1);
+    assert(guard.call<int>(path, []() { return 2; }, result) == IoStatus::Ok);
+    assert(result == 2 && guard.getStats().pooledCalls == 1);
+    std::cout << "  ✓ Local calls run inline, network calls on the pool" << std::endl;
+
+    // A hung server: the call overruns, the caller gets control back at the deadline
+    auto release = std::make_shared<std::atomic<bool>>(false);
+    auto hang = [release]() {
+        while (!*release) {
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+        return 3;
+    };
+    Stopwatch timer;
+    result = 0;
+    assert(guard.call<int>(path, hang, result) == IoStatus::TimedOut);
+    const double waitedMs = timer.elapsed();
+    assert(waitedMs >= 50 && waitedMs < 1000);
+    assert(result == 0 && guard.getStats().timeouts == 1);
+    assert(guard.isStalled(path) && guard.getStats().stalledMounts == 1);
+    std::cout << "  ✓ A hung call returns TimedOut at the deadline and stalls its mount" << std::endl;
+
+    timer.restart();
+    assert(guard.call<int>(path, []() { return 4; }, result) == IoStatus::Stalled);
+    assert(timer.elapsed() < 20);
+    assert(guard.getStats().failedFast == 1);
+    assert(guard.call<int>((root / "local.png").string(), []() { return 5; }, result) == IoStatus::Ok);
+    assert(result == 5);
+    std::cout << "  ✓ Stalled mounts fail fast; other mounts are unaffected" << std::endl;
+
+    *release = true;
+    std::this_thread::sleep_for(milliseconds(350));
+    assert(!guard.isStalled(path));
+    assert(guard.call<int>(path, []() { return 6; }, result) == IoStatus::Ok && result == 6);
+    std::cout << "  ✓ The mount recovers after the cooldown" << std::endl;
+
+    std::cout << "✓ Deadline tests passed" << std::endl;
+}
+
+void testPartialListing(const fs::path& root) {
+    std::cout << "Testing partial listings..." << std::endl;
+
+    const fs::path network = root / "slow";
+    fs::create_directories(network);
+    for (int i = 0; i < 40; ++i) {
+        writeFile(network / ("wall" + std::to_string(i) + ".png"), "x");
+    }
+    MountGuard guard(2);
+    guard.loadMounts(writeMountinfo(root, network));
+    guard.setDeadline(milliseconds(100));
+    guard.setStallCooldown(milliseconds(0));
+
+    // Each entry takes 10 ms to read: the deadline lands partway through the directory
+    std::vector<std::string> listed;
+    const IoStatus status = guard.listDirectory(network.string(), [](const fs::directory_entry&) {
+        std::this_thread::sleep_for(milliseconds(10));
+        return true;
+    }, listed);
+    assert(status == IoStatus::TimedOut);
+    assert(!listed.empty() && listed.size() < 40);
+    assert(std::is_sorted(listed.begin(), listed.end()));
+    std::cout << "  ✓ A listing that overruns returns the " << listed.size() << " entries read so far" << std::endl;
+
+    guard.setDeadline(milliseconds(2000));
+    assert(guard.listDirectory(network.string(), [](const fs::directory_entry& entry) {
+        return entry.path().extension() == ".png";
+    }, listed) == IoStatus::Ok);
+    assert(listed.size() == 40);
+    std::cout << "  ✓ A listing within the deadline is complete" << std::endl;
+
+    std::cout << "✓ Partial listing tests passed" << std::endl;
+}
+
+void testFileUtils(const fs::path& root) {
+    std::cout << "Testing FileUtils integration..." << std::endl;
+
+    const fs::path dir = root / "local";
+    fs::create_directories(dir / "sub");
+    writeFile(dir / "b.png", "x");
+    writeFile(dir / "a.jpg", "x");
+    writeFile(dir / "notes.txt", "x");
+
+    bool complete = false;
+    const std::vector<std::string> files = FileUtils::getImageFilesInDirectory(dir.string(), complete);
+    assert(complete && files.size() == 2);
+    assert(files[0] == (dir / "a.jpg").string() && files[1] == (dir / "b.png").string());
+    assert(FileUtils::getSubdirectories(dir.string()) == std::vector<std::string>{(dir / "sub").string()});
+    assert(FileUtils::getImageFilesInDirectory((dir / "missing").string(), complete).empty() && complete);
+    std::cout << "  ✓ Local listings are complete and sorted" << std::endl;
+
+    assert(MetadataCache::instance().exists((dir / "b.png").string()));
+    assert(MountGuard::instance().getStats().inlineCalls > 0);
+    std::cout << "  ✓ The shared cache and listings go through the shared guard" << std::endl;
+
+    std::cout << "✓ FileUtils integration tests passed" << std::endl;
+}
+
+void benchmarkMountGuard(const fs::path& root) {
+    std::cout << "Benchmarking guarded calls..." << std::endl;
+
+    const fs::path network = root / "bench";
+    fs::create_directories(network);
+    MountGuard guard;
+    guard.loadMounts(writeMountinfo(root, network));
+    const int iterations = 20000;
+
+    Stopwatch timer;
+    int total = 0;
+    int result = 0;
+    for (int i = 0; i < iterations; ++i) {
+        guard.call<int>((root / "local.png").string(), [i]() { return i & 1; }, result);
+        total += result;
+    }
+    const double inlineUs = timer.elapsed<std::micro>() / iterations;
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        guard.call<int>((network / "wall.png").string(), [i]() { return i & 1; }, result);
+        total += result;
+    }
+    const double pooledUs = timer.elapsed<std::micro>() / iterations;
+    assert(total == iterations);
+
+    std::cout << "  Per call: local " << inlineUs << " us, network (pool handoff) " << pooledUs << " us" << std::endl;
+
+    std::cout << "✓ Mount guard benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing mount guard..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    const fs::path root = makeTempRoot("mount");
+    try {
+        testClassification(root);
+        testDeadlines(root);
+        testPartialListing(root);
+        testFileUtils(root);
+        benchmarkMountGuard(root);
+
+        fs::remove_all(root);
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All mount guard tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        fs::remove_all(root);
+        std::cerr << "Mount guard test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,231 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_operation_trace.cpp
+ * Description: Tests for operation trace recording, loading and replay against a stand-in hyprpaper
+ */
+
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/core/OperationTrace.h"
+#include "../src/core/TraceReplay.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+static TraceEvent makeEvent(int offsetMs, TraceOp op, const std::string& target, const std::string& argument) {
+    TraceEvent event;
+    event.offset = std::chrono::milliseconds(offsetMs);
+    event.op = op;
+    event.target = target;
+    event.argument = argument;
+    return event;
+}
+
+void testRecording(const fs::path& root) {
+    std::cout << "Testing trace recording..." << std::endl;
+
+    const std::string path = (root / "session.trace").string();
+    const std::string longPath = "/home/user/Pictures/" + std::string(300, 'w') + "/ñight sky.png";
+    OperationTrace trace;
+    assert(trace.startRecording(path) && trace.isRecording());
+    trace.record(TraceOp::RefreshDisplays, "DP-1", "2560x1440");
+    trace.record(TraceOp::SetWallpaper, "DP-1", "/home/user/Pictures/forest.png");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    trace.record(TraceOp::SetMode, "DP-1", "Tile");
+    trace.record(TraceOp::WorkspaceEvent, "focusedmon", "DP-1,3");
+    trace.record(TraceOp::SetWallpaper, "", longPath);
+    trace.stopRecording();
+    trace.record(TraceOp::SetMode, "DP-1", "Scale");      // Not recording: ignored
+    assert(!trace.isRecording() && trace.getRecordedCount() == 5);
+
+    std::vector<TraceEvent> events;
+    assert(trace.load(path, events));
+    assert(events.size() == 5);
+    assert(events[0].op == TraceOp::RefreshDisplays && events[0].target == "DP-1" && events[0].argument == "2560x1440");
+    assert(events[1].op == TraceOp::SetWallpaper && events[1].argument == "/home/user/Pictures/forest.png");
+    assert(events[2].op == TraceOp::SetMode && events[2].argument == "Tile");
+    assert(events[3].target == "focusedmon" && events[3].argument == "DP-1,3");
+    assert(events[4].target.empty() && events[4].argument == longPath);
+    assert(events[2].offset - events[1].offset >= std::chrono::milliseconds(20));
+    for (size_t i = 1; i < events.size(); ++i) {
+        assert(events[i].offset >= events[i - 1].offset);
+    }
+    std::cout << "  ✓ Operations, targets, arguments and timing round-trip" << std::endl;
+
+    const size_t bytes = fs::file_size(path);
+    size_t payload = 0;
+    for (const TraceEvent& event : events) {
+        payload += event.target.size() + event.argument.size();
+    }
+    assert(bytes <= 9 + payload + 5 * 8);     // Header, strings and at most 8 bytes of framing each
+    std::cout << "  ✓ " << bytes << " bytes for 5 operations" << std::endl;
+
+    // A crash mid-write leaves a partial record; everything before it still loads
+    fs::resize_file(path, bytes - 10);
+    assert(trace.load(path, events) && events.size() == 4);
+    std::cout << "  ✓ A truncated last record is dropped" << std::endl;
+
+    std::ofstream(root / "other.trace") << "not a trace at all";
+    assert(!trace.load((root / "other.trace").string(), events));
+    assert(trace.getLastErrorCode() == OperationTrace::ErrorCode::BadFormat && events.empty());
+    assert(!trace.load((root / "missing.trace").string(), events));
+    assert(trace.getLastErrorCode() == OperationTrace::ErrorCode::OpenFailed);
+    assert(!trace.startRecording((root / "missing" / "x.trace").string()));
+    std::cout << "  ✓ Foreign and missing files are rejected" << std::endl;
+
+    std::cout << "✓ Trace recording tests passed" << std::endl;
+}
+
+void testPercentiles() {
+    std::cout << "Testing latency percentiles..." << std::endl;
+
+    std::vector<std::chrono::nanoseconds> samples;
+    for (int i = 100; i >= 1; --i) {
+        samples.push_back(std::chrono::nanoseconds(i));
+    }
+    assert(TraceReplayer::percentile(samples, 0.50).count() == 50);
+    assert(TraceReplayer::percentile(samples, 0.90).count() == 90);
+    assert(TraceReplayer::percentile(samples, 0.99).count() == 99);
+    assert(TraceReplayer::percentile(samples, 1.0).count() == 100);
+    std::vector<std::chrono::nanoseconds> one = { std::chrono::nanoseconds(7) };
+    assert(TraceReplayer::percentile(one, 0.5).count() == 7);
+    std::vector<std::chrono::nanoseconds> none;
+    assert(TraceReplayer::percentile(none, 0.5).count() == 0);
+    std::cout << "  ✓ Nearest-rank percentiles" << std::endl;
+
+    // A slow operation delays the one queued behind it, and that wait is charged to it
+    std::vector<TraceEvent> events = {
+        makeEvent(0, TraceOp::SetWallpaper, "DP-1", "slow"),
+        makeEvent(1, TraceOp::SetMode, "DP-1", "Tile"),
+    };
+    TraceReplayer replayer;
+    replayer.setHandler(TraceOp::SetWallpaper, [](const TraceEvent&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        return false;
+    });
+    const ReplayReport report = replayer.replay(events, 1.0);
+    assert(report.get(TraceOp::SetWallpaper).count == 1 && report.get(TraceOp::SetWallpaper).failures == 1);
+    assert(report.get(TraceOp::SetMode).count == 1 && report.get(TraceOp::SetMode).failures == 0);
+    assert(report.get(TraceOp::SetMode).p50 >= std::chrono::milliseconds(25));
+    assert(report.maxLag >= std::chrono::milliseconds(25));
+    assert(report.get(TraceOp::RefreshDisplays).count == 0);
+    assert(report.describe().find("set ") != std::string::npos && report.describe().find("refresh") == std::string::npos);
+    std::cout << "  ✓ Queueing delay and failures are reported per operation" << std::endl;
+
+    std::cout << "✓ Latency percentile tests passed" << std::endl;
+}
+
+void testReplay(const fs::path& root) {
+    std::cout << "Testing replay against a stand-in hyprpaper..." << std::endl;
+
+    HyprpaperStandIn hyprpaper((root / "hyprpaper.sock").string());
+    assert(hyprpaper.isListening());
+    HyprpaperReplayTarget target(hyprpaper.getSocketPath());
+    target.setWorkspaceWallpaper("3", "/walls/three.png");
+    TraceReplayer replayer;
+    target.install(replayer);
+
+    const std::vector<TraceEvent> events = {
+        makeEvent(0, TraceOp::RefreshDisplays, "DP-1", "2560x1440"),
+        makeEvent(0, TraceOp::SetMode, "DP-1", "Tile"),                 // Nothing shown yet
+        makeEvent(40, TraceOp::SetWallpaper, "DP-1", "/walls/a.png"),
+        makeEvent(80, TraceOp::SetWallpaper, "DP-1", "/walls/b.png"),
+        makeEvent(120, TraceOp::SetWallpaper, "DP-1", "/walls/a.png"),  // Already preloaded
+        makeEvent(160, TraceOp::SetMode, "DP-1", "Scale"),
+        makeEvent(200, TraceOp::WorkspaceEvent, "focusedmon", "DP-1,3"),
+    };
+
+    Stopwatch timer;
+    const ReplayReport report = replayer.replay(events, 4.0);
+    const double elapsedMs = timer.elapsed();
+    assert(elapsedMs >= 50 && elapsedMs < 190);
+    std::cout << "  ✓ 200 ms of recorded operations replayed at 4x in " << static_cast<int>(elapsedMs) << " ms"
+              << std::endl;
+
+    const std::vector<std::string> requests = hyprpaper.takeRequests();
+    const std::vector<std::string> expected = {
+        "preload /walls/a.png", "wallpaper DP-1,/walls/a.png",
+        "preload /walls/b.png", "wallpaper DP-1,/walls/b.png",
+        "wallpaper DP-1,/walls/a.png",
+        "wallpaper DP-1,contain:/walls/a.png",
+        "preload /walls/three.png", "wallpaper DP-1,/walls/three.png",
+    };
+    assert(requests == expected);
+    std::cout << "  ✓ Sets, mode changes and workspace switches send what caithe sends" << std::endl;
+
+    assert(report.get(TraceOp::SetWallpaper).count == 3 && report.get(TraceOp::SetMode).count == 2);
+    assert(report.get(TraceOp::WorkspaceEvent).count == 1 && report.get(TraceOp::WorkspaceEvent).failures == 0);
+    assert(report.get(TraceOp::SetWallpaper).p50 <= report.get(TraceOp::SetWallpaper).max);
+    std::cout << "  ✓ Every operation is counted without failures" << std::endl;
+
+    std::cout << "✓ Replay tests passed" << std::endl;
+}
+
+void benchmarkReplay(const fs::path& root) {
+    std::cout << "Benchmarking a recorded slideshow with a hotplug storm..." << std::endl;
+
+    // A recorded session: slideshow ticks, scrubbing through a folder, monitors flapping
+    const std::string path = (root / "bench.trace").string();
+    OperationTrace trace;
+    assert(trace.startRecording(path));
+    for (int i = 0; i < 2000; ++i) {
+        const std::string monitor = i % 2 ? "HDMI-A-1" : "DP-1";
+        trace.record(TraceOp::SetWallpaper, monitor, "/walls/slide_" + std::to_string(i % 300) + ".png");
+        if (i % 50 == 0) {
+            trace.record(TraceOp::SetMode, monitor, i % 100 ? "Tile" : "Scale");
+        }
+        if (i % 200 == 0) {
+            for (int storm = 0; storm < 10; ++storm) {
+                trace.record(TraceOp::RefreshDisplays, "HDMI-A-1", storm % 2 ? "1920x1080" : "3840x2160");
+            }
+        }
+    }
+    trace.stopRecording();
+
+    std::vector<TraceEvent> events;
+    assert(trace.load(path, events));
+    std::cout << "  " << events.size() << " operations in " << fs::file_size(path) << " bytes" << std::endl;
+
+    for (const int delayUs : {0, 200}) {
+        HyprpaperStandIn hyprpaper((root / ("bench_" + std::to_string(delayUs) + ".sock")).string());
+        hyprpaper.setReplyDelay(std::chrono::microseconds(delayUs));
+        HyprpaperReplayTarget target(hyprpaper.getSocketPath());
+        TraceReplayer replayer;
+        target.install(replayer);
+        const ReplayReport report = replayer.replay(events, 0.0);
+        assert(report.get(TraceOp::SetWallpaper).failures == 0);
+        std::cout << "  Stand-in reply delay " << delayUs << " us:" << std::endl;
+        std::cout << report.describe();
+    }
+
+    std::cout << "✓ Replay benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing operation trace record and replay..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    const fs::path root = makeTempRoot("trace");
+    try {
+        testRecording(root);
+        testPercentiles();
+        testReplay(root);
+        benchmarkReplay(root);
+
+        fs::remove_all(root);
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All operation trace tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        fs::remove_all(root);
+        std::cerr << "Operation trace test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
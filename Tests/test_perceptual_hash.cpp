@@ -0,0 +1,429 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_perceptual_hash.cpp
+ * Description: Tests for perceptual hashing and Hamming near-neighbour search, plus 100k-image benchmark
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/library/HammingIndex.h"
+#include "../src/library/LibraryIndex.h"
+#include "../src/library/PerceptualHash.h"
+#include "../src/imaging/ImageDecoder.h"
+#include "../src/imaging/Resampler.h"
+#include "../src/utils/TaskScheduler.h"
+#include "TestSupport.h"
+
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace fs = std::filesystem;
+
+// Gradient background with a few discs and boxes placed in relative coordinates,
+// so the same seed gives the same picture at any resolution
+static ImageBuffer makeScene(int width, int height, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    struct Shape { bool disc; double x, y, size; uint8_t r, g, b; };
+    std::vector<Shape> shapes;
+    for (int i = 0; i < 6; ++i) {
+        shapes.push_back({unit(rng) < 0.5, unit(rng), unit(rng), 0.08 + 0.2 * unit(rng),
+                          static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng())});
+    }
+    const double tilt = unit(rng);
+
+    ImageBuffer image;
+    image.allocate(width, height, 3);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = image.row(y);
+        for (int x = 0; x < width; ++x) {
+            const double u = (x + 0.5) / width;
+            const double v = (y + 0.5) / height;
+            uint8_t* p = row + x * 3;
+            p[0] = static_cast<uint8_t>(40 + 150 * (tilt * u + (1 - tilt) * v));
+            p[1] = static_cast<uint8_t>(60 + 120 * v);
+            p[2] = static_cast<uint8_t>(90 + 100 * u);
+            for (const Shape& s : shapes) {
+                const double dx = (u - s.x) * width / height;
+                const double dy = v - s.y;
+                const bool inside = s.disc ? dx * dx + dy * dy < s.size * s.size
+                                           : std::fabs(dx) < s.size && std::fabs(dy) < s.size * 0.6;
+                if (inside) {
+                    p[0] = s.r;
+                    p[1] = s.g;
+                    p[2] = s.b;
+                }
+            }
+        }
+    }
+    return image;
+}
+
+static std::vector<uint8_t> encodePng(const ImageBuffer& image) {
+    std::vector<uint8_t> png;
+    stbi_write_png_to_func(appendToVector, &png, image.width, image.height, image.channels,
+                           image.pixels.data(), static_cast<int>(image.stride));
+    return png;
+}
+
+static std::vector<uint8_t> encodeJpeg(const ImageBuffer& image, int quality) {
+    std::vector<uint8_t> jpeg;
+    stbi_write_jpg_to_func(appendToVector, &jpeg, image.width, image.height, image.channels,
+                           image.pixels.data(), quality);
+    return jpeg;
+}
+
+static uint64_t pHashOf(const ImageBuffer& image, ImageOrientation orientation = ImageOrientation::Normal) {
+    PerceptualHash hasher;
+    uint64_t hash = 0;
+    assert(hasher.computePHash(image, orientation, hash));
+    return hash;
+}
+
+static std::vector<HammingMatch> bruteForce(const std::vector<uint64_t>& hashes, uint64_t query, int radius) {
+    std::vector<HammingMatch> matches;
+    for (uint32_t id = 0; id < hashes.size(); ++id) {
+        const int distance = PerceptualHash::distance(hashes[id], query);
+        if (distance <= radius) {
+            matches.push_back({id, distance});
+        }
+    }
+    std::sort(matches.begin(), matches.end(), [](const HammingMatch& a, const HammingMatch& b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.id < b.id;
+    });
+    return matches;
+}
+
+static bool sameMatches(const std::vector<HammingMatch>& a, const std::vector<HammingMatch>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].id != b[i].id || a[i].distance != b[i].distance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Random hashes plus `planted` copies of earlier hashes with 1..maxFlips bits flipped
+static std::vector<uint64_t> makeHashes(size_t count, size_t planted, int maxFlips, uint32_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> hashes(count);
+    for (uint64_t& hash : hashes) {
+        hash = rng();
+    }
+    for (size_t i = 0; i < planted; ++i) {
+        uint64_t hash = hashes[rng() % (count - planted)];
+        const int flips = 1 + static_cast<int>(rng() % maxFlips);
+        for (int f = 0; f < flips; ++f) {
+            hash ^= 1ULL << (rng() % 64);
+        }
+        hashes[count - planted + i] = hash;
+    }
+    return hashes;
+}
+
+void testHammingDistances() {
+    std::cout << "Testing vectorized Hamming distances..." << std::endl;
+
+    std::mt19937_64 rng(5);
+    for (size_t count : {0u, 1u, 2u, 3u, 7u, 64u, 1001u}) {
+        std::vector<uint64_t> hashes(count);
+        for (uint64_t& hash : hashes) {
+            hash = rng();
+        }
+        hashes.push_back(0);
+        hashes.push_back(~0ULL);
+        const uint64_t query = rng();
+        std::vector<uint8_t> distance(hashes.size());
+        HammingIndex::distances(hashes.data(), hashes.size(), query, distance.data());
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            assert(distance[i] == PerceptualHash::distance(hashes[i], query));
+        }
+    }
+    std::cout << "  ✓ SIMD popcount matches scalar for all tail lengths" << std::endl;
+
+    std::cout << "✓ Hamming distance tests passed" << std::endl;
+}
+
+void testHammingSearch() {
+    std::cout << "Testing multi-index Hamming search..." << std::endl;
+
+    const std::vector<uint64_t> hashes = makeHashes(20000, 2000, 12, 7);
+    HammingIndex index;
+    index.build(hashes);
+    assert(index.size() == hashes.size());
+
+    std::mt19937 rng(9);
+    std::vector<HammingMatch> matches;
+    for (int radius = 0; radius <= 16; ++radius) {
+        for (int q = 0; q < 40; ++q) {
+            const uint64_t query = hashes[rng() % hashes.size()] ^ (q % 3 == 0 ? 1ULL << (rng() % 64) : 0);
+            index.radiusSearch(query, radius, matches);
+            assert(sameMatches(matches, bruteForce(hashes, query, radius)));
+        }
+    }
+    std::cout << "  ✓ Radius search equals brute force for radius 0-16" << std::endl;
+
+    for (size_t k : {1u, 5u, 50u}) {
+        for (int q = 0; q < 20; ++q) {
+            const uint64_t query = hashes[rng() % hashes.size()];
+            index.nearest(query, k, matches);
+            std::vector<HammingMatch> expected = bruteForce(hashes, query, 64);
+            expected.resize(k);
+            assert(sameMatches(matches, expected));
+        }
+    }
+    std::cout << "  ✓ Top-k equals brute force" << std::endl;
+
+    // Group reports equal connected components of the brute-force "within radius" graph
+    const std::vector<uint64_t> small = makeHashes(3000, 600, 14, 13);
+    index.build(small);
+    for (int radius : {0, 3, 5, 8, 11, 13}) {
+        std::vector<uint32_t> component(small.size());
+        for (uint32_t i = 0; i < small.size(); ++i) {
+            component[i] = i;
+        }
+        auto root = [&component](uint32_t x) {
+            while (component[x] != x) {
+                x = component[x];
+            }
+            return x;
+        };
+        for (uint32_t i = 0; i < small.size(); ++i) {
+            for (uint32_t j = i + 1; j < small.size(); ++j) {
+                if (PerceptualHash::distance(small[i], small[j]) <= radius) {
+                    const uint32_t a = root(i);
+                    const uint32_t b = root(j);
+                    component[std::max(a, b)] = std::min(a, b);
+                }
+            }
+        }
+        for (uint32_t i = 0; i < small.size(); ++i) {
+            component[i] = root(i);
+        }
+        std::vector<std::vector<uint32_t>> expected;
+        std::vector<int> slot(small.size(), -1);
+        std::vector<size_t> sizes(small.size(), 0);
+        for (uint32_t i = 0; i < small.size(); ++i) {
+            ++sizes[component[i]];
+        }
+        for (uint32_t i = 0; i < small.size(); ++i) {
+            if (sizes[component[i]] < 2) {
+                continue;
+            }
+            if (slot[component[i]] < 0) {
+                slot[component[i]] = static_cast<int>(expected.size());
+                expected.emplace_back();
+            }
+            expected[slot[component[i]]].push_back(i);
+        }
+        assert(index.findGroups(radius) == expected);
+    }
+    std::cout << "  ✓ Group reports equal brute-force components" << std::endl;
+
+    // Three clusters linked through chains of close hashes, plus noise
+    std::vector<uint64_t> clustered = {
+        0x0ULL, 0x1ULL, 0x3ULL,                                 // Chain 0 - 1 - 3
+        0xFFFF0000FFFF0000ULL, 0xFFFF0000FFFF0001ULL,
+        0x123456789ABCDEF0ULL, 0x123456789ABCDEF0ULL ^ 0x30ULL,
+        0xAAAAAAAAAAAAAAAAULL                                   // Alone
+    };
+    index.build(clustered);
+    const std::vector<std::vector<uint32_t>> groups = index.findGroups(2);
+    assert(groups.size() == 3);
+    assert((groups[0] == std::vector<uint32_t>{0, 1, 2}));
+    assert((groups[1] == std::vector<uint32_t>{3, 4}));
+    assert((groups[2] == std::vector<uint32_t>{5, 6}));
+    assert(index.findGroups(0).empty());
+    std::cout << "  ✓ Groups are transitive and singletons omitted" << std::endl;
+
+    std::cout << "✓ Hamming search tests passed" << std::endl;
+}
+
+void testPerceptualHash() {
+    std::cout << "Testing perceptual hashes..." << std::endl;
+
+    const ImageBuffer original = makeScene(960, 640, 1);
+    const uint64_t base = pHashOf(original);
+
+    // Downscaled copy
+    Resampler resampler;
+    ImageBuffer small;
+    assert(resampler.resample(original, ImageOrientation::Normal, small, 400, 267));
+    const int resized = PerceptualHash::distance(base, pHashOf(small));
+
+    // Recompressed copy
+    ImageDecoder decoder;
+    ImageBuffer recompressed;
+    const std::vector<uint8_t> jpeg = encodeJpeg(original, 60);
+    assert(decoder.decodeMemory(jpeg.data(), jpeg.size(), recompressed, 3));
+    const int jpegDistance = PerceptualHash::distance(base, pHashOf(recompressed));
+
+    // Brightened and noisy copy
+    ImageBuffer noisy = original;
+    std::mt19937 rng(3);
+    for (uint8_t& value : noisy.pixels) {
+        value = static_cast<uint8_t>(std::clamp(static_cast<int>(value) + 12 + static_cast<int>(rng() % 17) - 8, 0, 255));
+    }
+    const int noiseDistance = PerceptualHash::distance(base, pHashOf(noisy));
+
+    std::cout << "  Distances: resized " << resized << ", JPEG q60 " << jpegDistance
+              << ", brightened+noise " << noiseDistance << std::endl;
+    assert(resized <= 4 && jpegDistance <= 6 && noiseDistance <= 6);
+    std::cout << "  ✓ Variants stay within a few bits" << std::endl;
+
+    int closestUnrelated = 64;
+    for (uint32_t seed = 2; seed < 12; ++seed) {
+        closestUnrelated = std::min(closestUnrelated, PerceptualHash::distance(base, pHashOf(makeScene(960, 640, seed))));
+    }
+    std::cout << "  Closest unrelated scene: " << closestUnrelated << " bits" << std::endl;
+    assert(closestUnrelated > LibraryIndex::NEAR_DUPLICATE_DISTANCE + 4);
+    std::cout << "  ✓ Unrelated images stay far apart" << std::endl;
+
+    // A copy stored rotated with an EXIF tag hashes like the upright original
+    ImageBuffer stored;
+    assert(resampler.resample(original, ImageOrientation::Rotate270, stored, 640, 960));
+    assert(PerceptualHash::distance(base, pHashOf(stored, ImageOrientation::Rotate90)) <= 2);
+    assert(PerceptualHash::distance(base, pHashOf(stored)) > LibraryIndex::NEAR_DUPLICATE_DISTANCE);
+    std::cout << "  ✓ Orientation applied before hashing" << std::endl;
+
+    PerceptualHash hasher;
+    uint64_t d1 = 0, d2 = 0;
+    assert(hasher.computeDHash(original, ImageOrientation::Normal, d1));
+    assert(hasher.computeDHash(small, ImageOrientation::Normal, d2));
+    assert(PerceptualHash::distance(d1, d2) <= 6);
+    ImageBuffer empty;
+    assert(!hasher.computePHash(empty, ImageOrientation::Normal, d1));
+    assert(hasher.getLastErrorCode() == PerceptualHash::ErrorCode::InvalidImage);
+    std::cout << "  ✓ dHash and error handling" << std::endl;
+
+    std::cout << "✓ Perceptual hash tests passed" << std::endl;
+}
+
+void testLibraryNearDuplicates() {
+    std::cout << "Testing library near-duplicate search..." << std::endl;
+
+    const fs::path dir = makeTempRoot("phash");
+
+    const ImageBuffer original = makeScene(800, 600, 21);
+    Resampler resampler;
+    ImageBuffer small;
+    assert(resampler.resample(original, ImageOrientation::Normal, small, 400, 300));
+
+    writeFile(dir / "original.png", encodePng(original));
+    writeFile(dir / "small.png", encodePng(small));
+    writeFile(dir / "recompressed.jpg", encodeJpeg(original, 70));
+    writeFile(dir / "other.png", encodePng(makeScene(800, 600, 22)));
+    writeFile(dir / "another.jpg", encodeJpeg(makeScene(800, 600, 23), 85));
+
+    TaskScheduler scheduler(2);
+    LibraryIndex index;
+    assert(index.indexDirectory(dir.string(), scheduler));
+    assert(index.getLastIndexStats().perceptualHashed == 5);
+
+    const std::vector<std::vector<std::string>> groups = index.findNearDuplicates();
+    assert(groups.size() == 1 && groups[0].size() == 3);
+    for (const char* name : {"original.png", "small.png", "recompressed.jpg"}) {
+        assert(std::find(groups[0].begin(), groups[0].end(), (dir / name).string()) != groups[0].end());
+    }
+    std::cout << "  ✓ Resized and recompressed variants grouped" << std::endl;
+
+    const std::vector<SimilarImage> similar = index.findSimilar((dir / "original.png").string(), 3);
+    assert(similar.size() == 3);
+    assert(similar[0].distance <= LibraryIndex::NEAR_DUPLICATE_DISTANCE);
+    assert(similar[1].distance <= LibraryIndex::NEAR_DUPLICATE_DISTANCE);
+    assert(similar[2].distance > LibraryIndex::NEAR_DUPLICATE_DISTANCE);
+    assert(similar[0].path != (dir / "original.png").string());
+    std::cout << "  ✓ More-like-this ranks variants first" << std::endl;
+
+    // Perceptual hashes persist and survive reindexing without decoding again
+    const std::string indexPath = (dir / "library.idx").string();
+    assert(index.save(indexPath));
+    LibraryIndex loaded;
+    assert(loaded.load(indexPath));
+    assert(loaded.findNearDuplicates() == groups);
+    assert(loaded.indexDirectory(dir.string(), scheduler));
+    assert(loaded.getLastIndexStats().perceptualHashed == 0);
+    assert(loaded.findNearDuplicates() == groups);
+    std::cout << "  ✓ Hashes persisted in the index" << std::endl;
+
+    // Removing a member updates the groups
+    assert(loaded.removeFile((dir / "small.png").string()));
+    assert(loaded.findNearDuplicates().size() == 1 && loaded.findNearDuplicates()[0].size() == 2);
+
+    LibraryIndex disabled;
+    disabled.setPerceptualHashing(false);
+    assert(disabled.indexDirectory(dir.string(), scheduler));
+    assert(disabled.getLastIndexStats().perceptualHashed == 0);
+    assert(disabled.findNearDuplicates().empty());
+    std::cout << "  ✓ Removal and opt-out" << std::endl;
+
+    fs::remove_all(dir);
+    std::cout << "✓ Library near-duplicate tests passed" << std::endl;
+}
+
+void benchmarkSearch() {
+    std::cout << "Benchmarking search over 100k hashes..." << std::endl;
+
+    const std::vector<uint64_t> hashes = makeHashes(100000, 1000, 6, 42);
+    HammingIndex index;
+    Stopwatch buildTimer;
+    index.build(hashes);
+    const double buildMs = buildTimer.elapsed();
+
+    std::vector<HammingMatch> matches;
+    const int queries = 1000;
+    Stopwatch timer;
+    for (int q = 0; q < queries; ++q) {
+        index.radiusSearch(hashes[(q * 97) % hashes.size()], LibraryIndex::NEAR_DUPLICATE_DISTANCE, matches);
+    }
+    const double radiusUs = timer.elapsed<std::micro>() / queries;
+
+    timer.restart();
+    for (int q = 0; q < 100; ++q) {
+        index.nearest(hashes[(q * 97) % hashes.size()], 10, matches);
+    }
+    const double nearestUs = timer.elapsed<std::micro>() / 100;
+
+    timer.restart();
+    const std::vector<std::vector<uint32_t>> groups = index.findGroups(LibraryIndex::NEAR_DUPLICATE_DISTANCE);
+    const double groupsMs = timer.elapsed();
+    assert(groups.size() >= 900);
+
+    std::cout << "  Build: " << buildMs << " ms" << std::endl;
+    std::cout << "  Radius-" << LibraryIndex::NEAR_DUPLICATE_DISTANCE << " query: " << radiusUs << " us" << std::endl;
+    std::cout << "  Top-10 query: " << nearestUs << " us" << std::endl;
+    std::cout << "  Duplicate report: " << groupsMs << " ms, " << groups.size() << " groups" << std::endl;
+    std::cout << "✓ Benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing perceptual hashing and near-duplicate search..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testHammingDistances();
+        testHammingSearch();
+        testPerceptualHash();
+        testLibraryNearDuplicates();
+        benchmarkSearch();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All perceptual hash tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Perceptual hash test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,377 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_png_decoder.cpp
+ * Description: Differential tests of the PNG fast path against stb_image, plus decode throughput benchmark
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../src/imaging/PngDecoder.h"
+#include "../src/imaging/ImageDecoder.h"
+#include "../src/imaging/PngEncoder.h"
+#include "TestSupport.h"
+
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+// Reference PNGs produced by zlib at level 9 (dynamic Huffman blocks, mixed filters),
+// which stb_image_write never emits (it only uses fixed Huffman codes)
+const unsigned char DYNAMIC_RGBA_PNG[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x0b, 0x08, 0x06, 0x00, 0x00, 0x00, 0x9d, 0xd5, 0xb6,
+    0x3a, 0x00, 0x00, 0x00, 0x0d, 0x74, 0x45, 0x58, 0x74, 0x43, 0x6f, 0x6d, 0x6d, 0x65, 0x6e, 0x74,
+    0x00, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0xe6, 0xff, 0xae, 0x24, 0x00, 0x00, 0x02, 0xe3, 0x49, 0x44,
+    0x41, 0x54, 0x78, 0xda, 0x15, 0x92, 0x5d, 0xa8, 0x55, 0x45, 0x14, 0xc7, 0xdd, 0x5f, 0x33, 0xb3,
+    0xf7, 0x3e, 0x57, 0x94, 0xba, 0x7b, 0x66, 0xf6, 0x9e, 0x7d, 0xc3, 0x8c, 0x73, 0xe6, 0x7b, 0xcf,
+    0x3e, 0x81, 0x5d, 0x09, 0x49, 0xb8, 0x17, 0xa9, 0xfb, 0x20, 0xa1, 0x82, 0xa5, 0xa0, 0x41, 0x20,
+    0x48, 0x42, 0x0f, 0x7d, 0x90, 0x2f, 0xbe, 0x48, 0x44, 0x82, 0x2f, 0x91, 0x75, 0xee, 0x39, 0xd7,
+    0x0f, 0x48, 0x44, 0x50, 0x82, 0x40, 0x2a, 0x08, 0x8a, 0x84, 0x08, 0xc4, 0xea, 0x45, 0x82, 0xa8,
+    0x20, 0x0a, 0xf2, 0xc1, 0xc4, 0x17, 0x83, 0x84, 0xc2, 0xd6, 0x1d, 0x18, 0x18, 0x66, 0xad, 0xf5,
+    0x5f, 0x7f, 0xf8, 0xff, 0xd2, 0x78, 0xc0, 0x87, 0xda, 0x74, 0xc6, 0x7a, 0x2d, 0x83, 0x91, 0xd6,
+    0x78, 0xeb, 0x94, 0xeb, 0xcc, 0xd8, 0x2a, 0x67, 0x5c, 0x30, 0x70, 0xac, 0x92, 0x6e, 0x6c, 0xbd,
+    0x19, 0x75, 0xda, 0x39, 0x3b, 0x76, 0x46, 0x6a, 0x13, 0x9c, 0x96, 0x26, 0xe8, 0x20, 0x8d, 0x33,
+    0xbd, 0xf5, 0x9d, 0x32, 0x4e, 0xd9, 0x0d, 0xf9, 0x23, 0x5b, 0xd5, 0xe2, 0xf2, 0xca, 0xbe, 0x97,
+    0x8f, 0x1d, 0x3f, 0x79, 0x7a, 0x76, 0xf1, 0xe3, 0x2f, 0xae, 0x7f, 0xf7, 0xcb, 0x9f, 0xf7, 0x1e,
+    0xa2, 0x4d, 0xad, 0x0c, 0x3b, 0x77, 0xed, 0x7f, 0xe9, 0x95, 0xb7, 0x4e, 0x9e, 0x3a, 0xf3, 0xd1,
+    0x95, 0xcf, 0xaf, 0x7f, 0xff, 0xf3, 0x1f, 0x77, 0xfe, 0x8d, 0x36, 0xd6, 0xa3, 0xf1, 0xe2, 0xd2,
+    0xde, 0x43, 0x47, 0x5e, 0x3f, 0x71, 0xea, 0x83, 0x73, 0x97, 0x3f, 0xfd, 0xea, 0xe6, 0xad, 0x5f,
+    0xef, 0xfc, 0xfd, 0x70, 0xee, 0xd1, 0xc7, 0xf5, 0xb6, 0x5d, 0xc9, 0x60, 0x33, 0x13, 0x9c, 0xb7,
+    0xa2, 0x62, 0xac, 0x6e, 0x39, 0x6b, 0xf9, 0x63, 0x2d, 0x15, 0x9c, 0x9e, 0x9d, 0x4e, 0x18, 0xa5,
+    0x35, 0x6d, 0x59, 0xc5, 0x85, 0x60, 0x9c, 0x56, 0x8c, 0x37, 0xa2, 0x5e, 0x5b, 0x9d, 0xd4, 0x4d,
+    0xdb, 0xd6, 0x5c, 0xcc, 0xb3, 0xa6, 0x5e, 0x10, 0x35, 0xa7, 0x1c, 0x6e, 0x33, 0x9b, 0x4d, 0xa0,
+    0x25, 0x26, 0x38, 0x26, 0x24, 0x8d, 0xd2, 0x12, 0x93, 0x34, 0xcb, 0x51, 0x54, 0xc4, 0x98, 0x24,
+    0x39, 0x4e, 0x09, 0xc9, 0x31, 0x1a, 0xe4, 0x59, 0x5e, 0xa0, 0x28, 0x45, 0x05, 0x1e, 0x10, 0x9c,
+    0x17, 0x29, 0xce, 0x30, 0x4a, 0x52, 0x82, 0x62, 0x52, 0x22, 0x84, 0x23, 0x8c, 0x33, 0x82, 0x32,
+    0x34, 0x97, 0x21, 0x32, 0x57, 0xe4, 0xe5, 0x86, 0xd6, 0x2c, 0x2e, 0xed, 0x7e, 0xf1, 0xf0, 0xab,
+    0x6f, 0xbc, 0x7d, 0x7a, 0x7a, 0xe9, 0xea, 0x67, 0xdf, 0xfc, 0xf0, 0xd3, 0xed, 0xbb, 0xff, 0xe4,
+    0x9b, 0xc4, 0x30, 0x3c, 0xf3, 0xdc, 0x9e, 0x43, 0xc7, 0xde, 0x3c, 0xf1, 0xee, 0x7b, 0xe7, 0x2e,
+    0x5f, 0xfb, 0xfa, 0xc6, 0x8f, 0xbf, 0xdd, 0x7d, 0x90, 0x6e, 0xae, 0x9e, 0xe8, 0xb7, 0x3f, 0xbb,
+    0xe7, 0x85, 0xa3, 0xaf, 0x1d, 0x7f, 0xe7, 0xcc, 0xf9, 0x2b, 0x9f, 0x7c, 0xf9, 0xed, 0xad, 0xdf,
+    0xff, 0xba, 0xff, 0xdf, 0x46, 0xb6, 0xc5, 0x3e, 0xb5, 0xbc, 0x72, 0x20, 0xc6, 0x69, 0x1c, 0xc5,
+    0x59, 0x8e, 0x4b, 0x30, 0x98, 0xe5, 0x65, 0x06, 0xee, 0x08, 0x8e, 0x4a, 0x30, 0x84, 0x08, 0xc2,
+    0x38, 0x29, 0x4b, 0x82, 0xc0, 0x63, 0x81, 0x06, 0x24, 0xcb, 0xb2, 0xa2, 0x48, 0x32, 0x94, 0x42,
+    0x6d, 0x8e, 0xa4, 0x24, 0xc3, 0x04, 0x93, 0x2c, 0x2e, 0x0b, 0x9c, 0x90, 0xb4, 0x20, 0x24, 0x89,
+    0xcc, 0xe2, 0xf2, 0xf3, 0xc6, 0x49, 0xd5, 0xdb, 0xe0, 0xb5, 0xf7, 0xd2, 0x0d, 0x47, 0x4e, 0xdb,
+    0xde, 0xf8, 0x4e, 0x5b, 0xaf, 0x8c, 0xd7, 0xc1, 0x79, 0xe5, 0xd6, 0xf3, 0x0e, 0xd6, 0x42, 0x66,
+    0xba, 0x93, 0xde, 0x29, 0x3f, 0x84, 0x74, 0x01, 0x00, 0x67, 0x01, 0x81, 0x31, 0x24, 0x6a, 0x7a,
+    0x10, 0x89, 0x9e, 0xdc, 0xb1, 0xb2, 0x77, 0x1d, 0x0c, 0xd9, 0xc3, 0xb4, 0x55, 0x9d, 0x57, 0x30,
+    0x62, 0x55, 0xb0, 0xda, 0x1b, 0xd7, 0x75, 0xc0, 0x8a, 0x09, 0xc6, 0x4b, 0x19, 0x94, 0xb5, 0x12,
+    0xc0, 0x30, 0x76, 0x3c, 0xea, 0x9d, 0x0d, 0xd6, 0x28, 0xa9, 0xbd, 0xf3, 0xeb, 0x88, 0x8c, 0x42,
+    0x6f, 0xba, 0xa1, 0x32, 0xd1, 0x8e, 0xa5, 0x7d, 0x07, 0x47, 0x50, 0xb2, 0xda, 0x9a, 0x0e, 0x50,
+    0xb3, 0xde, 0x2b, 0xe5, 0x1d, 0xe8, 0x82, 0x0d, 0x6b, 0x7b, 0xd7, 0x05, 0x10, 0xd4, 0x00, 0x9c,
+    0x76, 0xd0, 0x34, 0xb4, 0x5d, 0x08, 0x60, 0x44, 0x79, 0xe9, 0x7b, 0xdf, 0xc1, 0x62, 0x80, 0x4f,
+    0x1b, 0xad, 0xac, 0xec, 0x43, 0x32, 0xf4, 0x76, 0x1b, 0x9f, 0x07, 0x3a, 0x38, 0x5f, 0xa8, 0x5b,
+    0x3a, 0x4f, 0xc5, 0xd9, 0xb5, 0x0b, 0xab, 0xbc, 0x6e, 0x58, 0xd3, 0x50, 0x41, 0x69, 0xc3, 0xab,
+    0x06, 0x48, 0x60, 0x9c, 0xad, 0x7e, 0x38, 0xab, 0x01, 0x0f, 0xf8, 0x11, 0x2d, 0xe3, 0xd0, 0x5b,
+    0xd1, 0x06, 0xc0, 0x98, 0x4c, 0xa6, 0xd0, 0xd5, 0xd6, 0xac, 0xe6, 0x89, 0x0e, 0xe3, 0xa7, 0xe1,
+    0x09, 0x8c, 0xad, 0x33, 0x23, 0xc4, 0x02, 0x7d, 0x7f, 0x6d, 0x2a, 0x9a, 0x86, 0x89, 0x5a, 0xc0,
+    0xa0, 0x68, 0xc4, 0x82, 0x68, 0x69, 0xd3, 0xd4, 0x17, 0x66, 0x6b, 0xa2, 0x61, 0x55, 0x45, 0x61,
+    0x29, 0x15, 0x2d, 0x6c, 0x13, 0x14, 0x48, 0x5b, 0x9d, 0x4c, 0x2b, 0x10, 0x17, 0x50, 0xab, 0xff,
+    0x07, 0x79, 0xae, 0xa7, 0xe6, 0xc2, 0xe2, 0x17, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e,
+    0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+const unsigned char DYNAMIC_RGB_MULTI_IDAT_PNG[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x0b, 0x08, 0x02, 0x00, 0x00, 0x00, 0x12, 0xb7, 0x21,
+    0x6d, 0x00, 0x00, 0x00, 0x0d, 0x74, 0x45, 0x58, 0x74, 0x43, 0x6f, 0x6d, 0x6d, 0x65, 0x6e, 0x74,
+    0x00, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0xe6, 0xff, 0xae, 0x24, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44,
+    0x41, 0x54, 0x78, 0xda, 0x2d, 0x51, 0x6b, 0x48, 0x54, 0x41, 0x14, 0x9e, 0x33, 0x8f, 0xfb, 0x9e,
+    0xb9, 0x73, 0xaf, 0x8f, 0x5c, 0x31, 0x6d, 0x61, 0xb7, 0x44, 0x13, 0xf1, 0xc7, 0x92, 0x90, 0x60,
+    0x50, 0xb1, 0x08, 0xe5, 0x8f, 0x22, 0x8b, 0x0a, 0xa1, 0x22, 0xa0, 0x54, 0x3a, 0xf0, 0x00, 0x00,
+    0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0x25, 0xa8, 0x60, 0x49, 0x84, 0x28, 0x41, 0xc2, 0x50, 0x7a,
+    0x20, 0xf6, 0xa2, 0x22, 0x89, 0x8a, 0x22, 0x52, 0x82, 0x0d, 0x2a, 0xa2, 0xd8, 0x1f, 0x49, 0x0f,
+    0x16, 0xc2, 0xe8, 0x81, 0x84, 0x45, 0x14, 0x49, 0xa0, 0x45, 0x3f, 0x5a, 0xa2, 0x82, 0xd8, 0x17,
+    0x8c, 0x3a, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0xac, 0x73, 0x97, 0x18, 0xce, 0xcc,
+    0xf9, 0xbe, 0x39, 0x73, 0xbe, 0x99, 0x6f, 0x80, 0x09, 0xa9, 0x7c, 0x29, 0xb5, 0x0e, 0xb4, 0x92,
+    0x5a, 0x85, 0x08, 0x30, 0xf5, 0xb5, 0xf6, 0x90, 0x0f, 0x64, 0xe0, 0xfb, 0x48, 0x4a, 0xe5, 0x21,
+    0xc0, 0x3c, 0xc8, 0xc5, 0xba, 0xd2, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0xaa, 0xd0,
+    0x81, 0x27, 0xbd, 0x30, 0x60, 0xc2, 0xb2, 0x1c, 0xc7, 0x75, 0x2c, 0xdb, 0x74, 0x1c, 0xcf, 0xb4,
+    0x0d, 0xc7, 0x75, 0x31, 0xb3, 0x2c, 0xdb, 0xb5, 0x6c, 0xdc, 0xb2, 0x6d, 0x07, 0x91, 0xed, 0x22,
+    0xb4, 0x4c, 0xd7, 0x75, 0x6c, 0xc7, 0x16, 0x80, 0x66, 0x4c, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44,
+    0x41, 0x54, 0xb4, 0x06, 0x8f, 0x1d, 0x45, 0x04, 0x96, 0x2c, 0x51, 0x3e, 0x36, 0x97, 0x12, 0x67,
+    0x1d, 0xa8, 0xc0, 0x57, 0x12, 0xd5, 0x50, 0x55, 0x15, 0x35, 0x82, 0x50, 0xfa, 0x4a, 0x7b, 0x1a,
+    0x4b, 0xf0, 0x4e, 0x3e, 0x2a, 0xfa, 0xca, 0x93, 0x32, 0x0c, 0x3e, 0xb0, 0x36, 0xac, 0x00, 0x00,
+    0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0x38, 0x07, 0x22, 0x38, 0x03, 0xc6, 0x18, 0xa7, 0x8c, 0x12,
+    0x00, 0xa0, 0x9c, 0x09, 0x01, 0x0c, 0x38, 0xe5, 0x9c, 0x13, 0x42, 0x05, 0xf2, 0x06, 0x50, 0xf8,
+    0x5f, 0x46, 0x28, 0x35, 0x38, 0x67, 0x84, 0xa8, 0xd2, 0x8a, 0xea, 0x78, 0x72, 0x69, 0xd5, 0xb8,
+    0x2c, 0xc1, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0x63, 0xaa, 0xa5, 0x75, 0x75, 0x5b,
+    0xfb, 0x86, 0x4d, 0x9d, 0x3b, 0xba, 0xf6, 0x66, 0x7a, 0xfb, 0x0e, 0x0d, 0x1c, 0x19, 0x39, 0x79,
+    0x6e, 0xf4, 0xca, 0x8d, 0xf1, 0xec, 0xdd, 0xdc, 0xc4, 0x93, 0xfc, 0xe4, 0xeb, 0xe9, 0xf7, 0x9f,
+    0xe6, 0xbe, 0x46, 0x9b, 0x61, 0xbc, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0x16, 0x7e,
+    0xcf, 0x33, 0xdb, 0xd3, 0x65, 0x95, 0xf1, 0x04, 0x09, 0x16, 0xc4, 0x6a, 0x16, 0xd7, 0x35, 0xa6,
+    0x96, 0xb5, 0xac, 0x4a, 0xaf, 0x5d, 0xdf, 0xb1, 0x75, 0x5b, 0xf7, 0xae, 0x4c, 0xcf, 0x81, 0xbe,
+    0xc3, 0x83, 0xc3, 0x23, 0x67, 0x46, 0xde, 0x84, 0x02, 0x35, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44,
+    0x41, 0x54, 0x2f, 0x5d, 0x1d, 0xcf, 0xde, 0xb9, 0x9f, 0x7b, 0x94, 0x9f, 0x7c, 0x35, 0xf5, 0xf6,
+    0xc3, 0xe7, 0xb9, 0xef, 0x3f, 0xff, 0x80, 0xe9, 0xf9, 0xe5, 0xb1, 0x85, 0x89, 0x5a, 0x52, 0x12,
+    0xab, 0x4e, 0xd4, 0xd6, 0x37, 0x35, 0x2f, 0x5f, 0x91, 0x6e, 0xf4, 0x71, 0xe3, 0x92, 0x00, 0x00,
+    0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0x6b, 0xef, 0xd8, 0xdc, 0xb9, 0xb3, 0x7b, 0xf7, 0xbe, 0xde,
+    0x83, 0xfd, 0x43, 0xc7, 0x4f, 0x9c, 0x3e, 0x7f, 0xf1, 0xda, 0xd8, 0xcd, 0x5b, 0xf7, 0x72, 0x13,
+    0x4f, 0x9f, 0xbd, 0x98, 0x9a, 0xfe, 0x38, 0x33, 0xfb, 0xad, 0xf0, 0xeb, 0x2f, 0x4a, 0x00, 0xd4,
+    0x51, 0x7c, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0x96, 0x56, 0x54, 0xc5, 0x93, 0x0d,
+    0xa4, 0xac, 0xb2, 0x66, 0x49, 0x5d, 0x53, 0xaa, 0xb9, 0x75, 0x65, 0x7a, 0xcd, 0xba, 0x8d, 0x5b,
+    0xb6, 0x77, 0xed, 0xc9, 0xf4, 0xec, 0xef, 0x1f, 0x18, 0x1a, 0x3e, 0x75, 0xf6, 0xc2, 0xe5, 0xeb,
+    0x63, 0xd9, 0xb2, 0x66, 0x15, 0x61, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0xdb, 0x0f,
+    0x1e, 0x3e, 0xce, 0x3f, 0x7f, 0xf9, 0xe6, 0xdd, 0xcc, 0xec, 0x97, 0xc2, 0x8f, 0x79, 0x10, 0x6e,
+    0x58, 0x5e, 0xb5, 0x28, 0x59, 0xdf, 0xc0, 0x85, 0x30, 0x18, 0x8d, 0x1e, 0xcd, 0x98, 0xc1, 0x04,
+    0x03, 0x11, 0xf9, 0x82, 0x2e, 0x71, 0x53, 0xe9, 0xd9, 0x3b, 0x00, 0x00, 0x00, 0x28, 0x49, 0x44,
+    0x41, 0x54, 0x40, 0x1b, 0x90, 0x40, 0x07, 0xb9, 0xa0, 0x02, 0xad, 0xa1, 0x18, 0x80, 0x45, 0x8c,
+    0x02, 0x70, 0x30, 0x28, 0x83, 0x68, 0xa5, 0x94, 0x08, 0x03, 0x5d, 0xe4, 0xb8, 0xc1, 0x44, 0x31,
+    0x38, 0x8f, 0x82, 0x52, 0x5c, 0x70, 0x8a, 0xea, 0x04, 0x41, 0x1b, 0x54, 0xc1, 0xde, 0x00, 0x00,
+    0x00, 0x28, 0x49, 0x44, 0x41, 0x54, 0x9a, 0x50, 0x82, 0x1a, 0x08, 0x8b, 0x66, 0xf3, 0xe8, 0x14,
+    0xf6, 0x03, 0xc6, 0x09, 0x20, 0x89, 0x38, 0xea, 0x45, 0x05, 0xa1, 0x86, 0x88, 0x4e, 0xe3, 0xc7,
+    0x18, 0xa8, 0x2e, 0xb0, 0x35, 0xfe, 0x5e, 0x34, 0x38, 0xfd, 0x07, 0x95, 0x09, 0x75, 0xb1, 0x54,
+    0x58, 0xde, 0x00, 0x00, 0x00, 0x01, 0x49, 0x44, 0x41, 0x54, 0x83, 0x5c, 0x89, 0xaf, 0x72, 0x00,
+    0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+const unsigned char SIXTEEN_BIT_PNG[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x10, 0x02, 0x00, 0x00, 0x00, 0xad, 0x44, 0x46,
+    0x30, 0x00, 0x00, 0x00, 0x23, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x30, 0xdb, 0x56, 0x74,
+    0x79, 0x96, 0x4b, 0xc6, 0xee, 0xcf, 0x81, 0x2e, 0xec, 0x0c, 0x35, 0x3e, 0xcf, 0x0c, 0x15, 0xbc,
+    0xba, 0xce, 0xb6, 0xb3, 0xca, 0x6c, 0x06, 0x00, 0x94, 0x53, 0x0a, 0xbd, 0xbd, 0xd4, 0x31, 0x41,
+    0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+static std::vector<uint8_t> encodePng(const std::vector<uint8_t>& pixels, int width, int height,
+                                      int channels, int filter) {
+    std::vector<uint8_t> png;
+    stbi_write_force_png_filter = filter;
+    stbi_write_png_to_func(appendToVector, &png, width, height, channels, pixels.data(), width * channels);
+    stbi_write_force_png_filter = -1;
+    return png;
+}
+
+static std::vector<uint8_t> makeTestPixels(int width, int height, int channels, unsigned seed) {
+    // Smooth gradients with noise so every filter type gets exercised by the encoder
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+    unsigned state = seed;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width * channels; ++x) {
+            state = state * 1103515245u + 12345u;
+            pixels[static_cast<size_t>(y) * width * channels + x] =
+                static_cast<uint8_t>(x * 3 + y * 5 + ((state >> 16) & 15));
+        }
+    }
+    return pixels;
+}
+
+static void appendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& payload) {
+    const uint32_t length = static_cast<uint32_t>(payload.size());
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        png.push_back(static_cast<uint8_t>(length >> shift));
+    }
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), payload.begin(), payload.end());
+    png.insert(png.end(), 4, 0);    // CRC; the fast path does not check it
+}
+
+// Hand-built PNG with one stored (uncompressed) deflate block, for headers stb would never write
+static std::vector<uint8_t> buildRawPng(uint32_t width, uint32_t height, uint8_t colorType,
+                                        const std::vector<uint8_t>& palette, const std::vector<uint8_t>& scanlines) {
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a};
+    std::vector<uint8_t> header;
+    for (uint32_t value : {width, height}) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            header.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+    header.insert(header.end(), {8, colorType, 0, 0, 0});
+    appendChunk(png, "IHDR", header);
+    if (!palette.empty()) {
+        appendChunk(png, "PLTE", palette);
+    }
+
+    const uint16_t size = static_cast<uint16_t>(scanlines.size());
+    std::vector<uint8_t> zlib = {0x78, 0x01, 0x01, static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+                                 static_cast<uint8_t>(~size), static_cast<uint8_t>(~size >> 8)};
+    zlib.insert(zlib.end(), scanlines.begin(), scanlines.end());
+    const uint32_t adler = PngEncoder::adler32(scanlines.data(), scanlines.size());
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        zlib.push_back(static_cast<uint8_t>(adler >> shift));
+    }
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+    return png;
+}
+
+static void assertMatchesStb(const uint8_t* png, size_t size, int channels) {
+    PngDecoder decoder;
+    ImageBuffer ours;
+    assert(decoder.decode(png, size, ours, channels));
+
+    int width = 0, height = 0, sourceChannels = 0;
+    stbi_uc* reference = stbi_load_from_memory(png, static_cast<int>(size), &width, &height,
+                                               &sourceChannels, channels);
+    assert(reference);
+    assert(ours.width == width && ours.height == height && ours.channels == channels);
+    assert(std::memcmp(ours.pixels.data(), reference, ours.pixels.size()) == 0);
+    stbi_image_free(reference);
+}
+
+void testFilterDifferential() {
+    std::cout << "Testing Sub/Up/Avg/Paeth unfiltering against stb_image..." << std::endl;
+
+    const int sizes[][2] = {{1, 1}, {5, 3}, {67, 29}, {256, 64}};
+    for (const auto& size : sizes) {
+        for (int channels = 1; channels <= 4; ++channels) {
+            const auto pixels = makeTestPixels(size[0], size[1], channels, size[0] * 31u + channels);
+            // -1 lets the encoder choose a filter per scanline
+            for (int filter = -1; filter <= 4; ++filter) {
+                const auto png = encodePng(pixels, size[0], size[1], channels, filter);
+                assertMatchesStb(png.data(), png.size(), 4);
+                assertMatchesStb(png.data(), png.size(), 3);
+            }
+        }
+    }
+
+    std::cout << "  ✓ Gray, gray+alpha, RGB and RGBA with every filter type" << std::endl;
+
+    assertMatchesStb(DYNAMIC_RGBA_PNG, sizeof(DYNAMIC_RGBA_PNG), 4);
+    assertMatchesStb(DYNAMIC_RGB_MULTI_IDAT_PNG, sizeof(DYNAMIC_RGB_MULTI_IDAT_PNG), 4);
+    assertMatchesStb(DYNAMIC_RGB_MULTI_IDAT_PNG, sizeof(DYNAMIC_RGB_MULTI_IDAT_PNG), 3);
+    std::cout << "  ✓ Dynamic Huffman blocks and multi-IDAT streams" << std::endl;
+
+    std::cout << "✓ Filter differential tests passed" << std::endl;
+}
+
+void testCallerProvidedBuffer() {
+    std::cout << "Testing decode into caller-provided buffer..." << std::endl;
+
+    const int width = 37, height = 13;
+    const auto pixels = makeTestPixels(width, height, 4, 99);
+    const auto png = encodePng(pixels, width, height, 4, -1);
+
+    PngDecoder decoder;
+    PngInfo info;
+    assert(decoder.readInfo(png.data(), png.size(), info));
+    assert(info.width == width && info.height == height && info.sourceChannels == 4);
+
+    // Padded rows (e.g. GL unpack alignment); padding bytes must be left untouched
+    const size_t stride = width * 4 + 12;
+    std::vector<uint8_t> arena(stride * height, 0xAB);
+    assert(decoder.decodeInto(png.data(), png.size(), arena.data(), stride, arena.size(), 4));
+
+    for (int y = 0; y < height; ++y) {
+        assert(std::memcmp(arena.data() + y * stride, pixels.data() + y * width * 4, width * 4) == 0);
+        for (size_t pad = width * 4; pad < stride; ++pad) {
+            assert(arena[y * stride + pad] == 0xAB);
+        }
+    }
+
+    // Undersized destination is rejected without writing
+    std::vector<uint8_t> small(PngDecoder::requiredBufferSize(info, 4) - 1);
+    assert(!decoder.decodeInto(png.data(), png.size(), small.data(), width * 4, small.size(), 4));
+    assert(decoder.getLastErrorCode() == PngDecoder::ErrorCode::BufferTooSmall);
+
+    std::cout << "✓ Caller-provided buffer tests passed" << std::endl;
+}
+
+void testCorruptAndUnsupportedInput() {
+    std::cout << "Testing corrupt and unsupported input..." << std::endl;
+
+    PngDecoder decoder;
+    ImageBuffer image;
+
+    // Truncated streams fail cleanly
+    const auto pixels = makeTestPixels(64, 64, 3, 5);
+    const auto png = encodePng(pixels, 64, 64, 3, -1);
+    for (size_t cut : {size_t(0), size_t(8), size_t(33), png.size() / 2, png.size() - 13}) {
+        assert(!decoder.decode(png.data(), cut, image, 4));
+    }
+
+    // Bit flips must never crash (they may or may not decode)
+    auto damaged = png;
+    for (size_t i = 40; i < damaged.size(); i += 7) {
+        damaged[i] ^= 0x5A;
+        decoder.decode(damaged.data(), damaged.size(), image, 4);
+    }
+
+    // A header asking for 16 GiB is refused before anything is allocated
+    const auto huge = buildRawPng(65536, 65536, 6, {}, {0, 0, 0, 0, 0});
+    assert(!decoder.decode(huge.data(), huge.size(), image, 4));
+    assert(decoder.getLastErrorCode() == PngDecoder::ErrorCode::CorruptData);
+
+    // An index past a short palette reads transparent black, not the previous image's entry
+    const auto fullPalette = buildRawPng(1, 1, 3, {1, 2, 3, 10, 20, 30}, {0, 1});
+    assert(decoder.decode(fullPalette.data(), fullPalette.size(), image, 4));
+    assert(image.pixels[0] == 10 && image.pixels[1] == 20 && image.pixels[2] == 30 && image.pixels[3] == 255);
+    const auto shortPalette = buildRawPng(1, 1, 3, {1, 2, 3}, {0, 1});
+    assert(decoder.decode(shortPalette.data(), shortPalette.size(), image, 4));
+    assert(image.pixels[0] == 0 && image.pixels[1] == 0 && image.pixels[2] == 0 && image.pixels[3] == 0);
+
+    // 16-bit images are rejected by the fast path and decoded by the fallback
+    assert(!decoder.decode(SIXTEEN_BIT_PNG, sizeof(SIXTEEN_BIT_PNG), image, 4));
+    assert(decoder.getLastErrorCode() == PngDecoder::ErrorCode::UnsupportedFormat);
+
+    ImageDecoder imageDecoder;
+    assert(imageDecoder.decodeMemory(SIXTEEN_BIT_PNG, sizeof(SIXTEEN_BIT_PNG), image, 4));
+    assert(!imageDecoder.usedFastPath());
+    assert(image.width == 2 && image.height == 2);
+
+    assert(imageDecoder.decodeMemory(png.data(), png.size(), image, 4));
+    assert(imageDecoder.usedFastPath());
+
+    std::cout << "✓ Corrupt and unsupported input tests passed" << std::endl;
+}
+
+void benchmarkDecode() {
+    std::cout << "Benchmarking 3840x2160 decode throughput..." << std::endl;
+
+    const int width = 3840, height = 2160;
+    const int iterations = 5;
+    const double megapixels = width * static_cast<double>(height) / 1e6;
+
+    for (int channels : {3, 4}) {
+        const auto pixels = makeTestPixels(width, height, channels, 2024);
+        const auto png = encodePng(pixels, width, height, channels, -1);
+
+        PngDecoder decoder;
+        ImageBuffer image;
+        Stopwatch timer;
+        for (int i = 0; i < iterations; ++i) {
+            assert(decoder.decode(png.data(), png.size(), image, 4));
+        }
+        const double oursSeconds = timer.elapsed<std::ratio<1>>();
+
+        timer.restart();
+        for (int i = 0; i < iterations; ++i) {
+            int w = 0, h = 0, n = 0;
+            stbi_uc* reference = stbi_load_from_memory(png.data(), static_cast<int>(png.size()), &w, &h, &n, 4);
+            assert(reference);
+            stbi_image_free(reference);
+        }
+        const double stbSeconds = timer.elapsed<std::ratio<1>>();
+
+        std::cout << "  " << (channels == 4 ? "RGBA" : "RGB ") << " fast path: "
+                  << megapixels * iterations / oursSeconds << " MP/s, stb_image: "
+                  << megapixels * iterations / stbSeconds << " MP/s" << std::endl;
+    }
+
+    std::cout << "✓ Benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing PNG fast-path decoder..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testFilterDifferential();
+        testCallerProvidedBuffer();
+        testCorruptAndUnsupportedInput();
+        benchmarkDecode();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All PNG decoder tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "PNG decoder test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
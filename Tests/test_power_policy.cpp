@@ -0,0 +1,305 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_power_policy.cpp
+ * Description: Tests for power- and pressure-aware scheduling against fake sysfs/procfs trees
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "../src/utils/ConfigManager.h"
+#include "../src/utils/PowerPolicy.h"
+#include "../src/utils/TaskScheduler.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+// Fake /sys/class/power_supply and /proc/pressure under one temporary root
+class FakeSystem {
+public:
+    FakeSystem() : m_root(makeTempRoot("power")) {
+        fs::create_directories(powerRoot());
+        fs::create_directories(pressureRoot());
+    }
+
+    ~FakeSystem() { fs::remove_all(m_root); }
+
+    std::string powerRoot() const { return (m_root / "power_supply").string(); }
+    std::string pressureRoot() const { return (m_root / "pressure").string(); }
+
+    void setMains(bool online) {
+        write(m_root / "power_supply" / "AC", "type", "Mains");
+        write(m_root / "power_supply" / "AC", "online", online ? "1" : "0");
+    }
+
+    void setBattery(const std::string& name, const std::string& status, int capacity) {
+        write(m_root / "power_supply" / name, "type", "Battery");
+        write(m_root / "power_supply" / name, "status", status);
+        write(m_root / "power_supply" / name, "capacity", std::to_string(capacity));
+    }
+
+    void setPressure(const std::string& resource, double some, double full = 0.0) {
+        std::ofstream file(m_root / "pressure" / resource);
+        file << "some avg10=" << some << " avg60=0.00 avg300=0.00 total=12345\n";
+        if (resource != "cpu") {
+            file << "full avg10=" << full << " avg60=0.00 avg300=0.00 total=678\n";
+        }
+    }
+
+private:
+    static void write(const fs::path& directory, const std::string& name, const std::string& value) {
+        fs::create_directories(directory);
+        std::ofstream(directory / name) << value << "\n";
+    }
+
+    fs::path m_root;
+};
+
+// Runs `count` tasks of a class and reports the highest number seen running at once
+static size_t peakConcurrency(TaskScheduler& scheduler, IoClass ioClass, int count) {
+    std::atomic<size_t> running{0};
+    std::atomic<size_t> peak{0};
+    for (int i = 0; i < count; ++i) {
+        scheduler.submit(ioClass, [&running, &peak] {
+            const size_t now = ++running;
+            size_t seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            --running;
+        });
+    }
+    scheduler.waitIdle();
+    return peak.load();
+}
+
+void testSystemReading() {
+    std::cout << "Testing sysfs and PSI reading..." << std::endl;
+
+    FakeSystem system;
+    SystemState state;
+    PowerPolicy::readPowerSupply(system.powerRoot(), state);
+    assert(!state.onBattery && state.batteryPercent == -1);
+    std::cout << "  ✓ A desktop without supplies counts as AC" << std::endl;
+
+    system.setMains(false);
+    system.setBattery("BAT0", "Discharging", 64);
+    system.setBattery("BAT1", "Discharging", 37);
+    state = SystemState();
+    PowerPolicy::readPowerSupply(system.powerRoot(), state);
+    assert(state.onBattery && state.batteryPercent == 37);
+    system.setMains(true);
+    system.setBattery("BAT0", "Charging", 64);
+    state = SystemState();
+    PowerPolicy::readPowerSupply(system.powerRoot(), state);
+    assert(!state.onBattery);
+    std::cout << "  ✓ Mains, discharge status and the lowest capacity are read" << std::endl;
+
+    double value = -1.0;
+    assert(!PowerPolicy::readPressure(system.pressureRoot() + "/cpu", value) && value == -1.0);
+    system.setPressure("cpu", 3.5);
+    system.setPressure("memory", 42.25, 10.0);
+    assert(PowerPolicy::readPressure(system.pressureRoot() + "/cpu", value) && value == 3.5);
+    assert(PowerPolicy::readPressure(system.pressureRoot() + "/memory", value) && value == 42.25);
+
+    PowerPolicy policy;
+    policy.setRoots(system.powerRoot(), system.pressureRoot());
+    state = policy.readState();
+    assert(state.pressureAvailable && state.cpuPressure == 3.5 && state.memoryPressure == 42.25 && state.ioPressure == 0.0);
+    std::cout << "  ✓ PSI some avg10 is parsed per resource; missing files mean no PSI" << std::endl;
+
+    std::cout << "✓ System reading tests passed" << std::endl;
+}
+
+void testDecisions() {
+    std::cout << "Testing policy decisions..." << std::endl;
+
+    PowerPolicy policy;
+    SystemState ac;
+    ac.pressureAvailable = true;
+    PowerDecision decision = policy.decide(ac);
+    assert(!decision.constrained() && decision.workerCap == 0 && !decision.deferIdle && decision.prefetchStretch == 1.0);
+    assert(decision.describe() == "full speed");
+    std::cout << "  ✓ AC without pressure runs at full speed" << std::endl;
+
+    SystemState battery = ac;
+    battery.onBattery = true;
+    battery.batteryPercent = 60;
+    decision = policy.decide(battery);
+    assert(decision.onBattery && decision.workerCap == 1 && decision.deferIdle && !decision.deferBackground);
+    assert(decision.prefetchStretch == 4.0 && policy.getDecision().prefetchStretch == 1.0);
+    battery.batteryPercent = 15;
+    decision = policy.decide(battery);
+    assert(decision.lowBattery && decision.deferBackground);
+    assert(decision.describe() == "low battery, 1 worker, background held");
+    std::cout << "  ✓ Battery caps workers, holds idle work and stretches prefetch" << std::endl;
+
+    PowerPolicyConfig config;
+    config.batteryWorkers = 3;
+    config.pressureWorkers = 2;
+    config.deferIdleOnBattery = false;
+    config.lowBatteryPercent = 0;
+    config.prefetchStretch = 2.0;
+    policy.setConfig(config);
+    decision = policy.decide(battery);
+    assert(decision.workerCap == 3 && !decision.deferIdle && !decision.deferBackground && decision.prefetchStretch == 2.0);
+    SystemState pressured = battery;
+    pressured.ioPressure = 30.0;
+    decision = policy.decide(pressured);
+    assert(decision.underPressure && decision.workerCap == 2 && decision.deferIdle);
+    config.enabled = false;
+    policy.setConfig(config);
+    assert(!policy.decide(pressured).constrained());
+    std::cout << "  ✓ Worker counts, deferral and stretch follow the configuration" << std::endl;
+
+    std::cout << "✓ Policy decision tests passed" << std::endl;
+}
+
+void testScheduling() {
+    std::cout << "Testing scheduler throttling..." << std::endl;
+
+    FakeSystem system;
+    system.setMains(true);
+    system.setBattery("BAT0", "Charging", 80);
+    system.setPressure("cpu", 0.0);
+    system.setPressure("memory", 0.0);
+    system.setPressure("io", 0.0);
+
+    PowerPolicy policy;
+    policy.setRoots(system.powerRoot(), system.pressureRoot());
+    TaskScheduler scheduler(4);
+    assert(policy.update(scheduler));
+    assert(!policy.update(scheduler));
+    assert(peakConcurrency(scheduler, IoClass::Background, 16) > 1);
+    std::cout << "  ✓ AC leaves every worker available" << std::endl;
+
+    // Unplug: background work is serialised and idle work waits
+    system.setMains(false);
+    system.setBattery("BAT0", "Discharging", 80);
+    assert(policy.update(scheduler) && policy.getDecision().onBattery);
+    assert(peakConcurrency(scheduler, IoClass::Background, 12) == 1);
+    assert(peakConcurrency(scheduler, IoClass::Interactive, 16) > 1);
+    std::atomic<int> idleRan{0};
+    for (int i = 0; i < 5; ++i) {
+        scheduler.submit(IoClass::Idle, [&idleRan] { ++idleRan; });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    assert(idleRan == 0 && scheduler.getQueuedCount(IoClass::Idle) == 5 && scheduler.isDeferred(IoClass::Idle));
+    assert(policy.scaleHorizon(8) == 32);
+    std::cout << "  ✓ Battery serialises background work and holds idle work" << std::endl;
+
+    // Plug back in: held work drains and the cap is lifted
+    system.setMains(true);
+    assert(policy.update(scheduler) && !policy.getDecision().constrained());
+    scheduler.waitIdle();
+    assert(idleRan == 5 && !scheduler.isDeferred(IoClass::Idle));
+    assert(peakConcurrency(scheduler, IoClass::Background, 16) > 1 && policy.scaleHorizon(8) == 8);
+    std::cout << "  ✓ AC resumes held work at full speed" << std::endl;
+
+    // Pressure with hysteresis: on at 20, still on at 15, off below 10
+    system.setPressure("memory", 25.0);
+    assert(policy.update(scheduler) && policy.getDecision().underPressure);
+    system.setPressure("memory", 15.0);
+    assert(!policy.update(scheduler) && policy.getDecision().underPressure);
+    system.setPressure("memory", 9.0);
+    assert(policy.update(scheduler) && !policy.getDecision().underPressure);
+    system.setPressure("memory", 15.0);
+    assert(!policy.update(scheduler) && !policy.getDecision().underPressure);
+    std::cout << "  ✓ Pressure enters at the threshold and leaves below half of it" << std::endl;
+
+    // A scheduler destroyed while work is held still runs it
+    std::atomic<int> drained{0};
+    {
+        TaskScheduler held(2);
+        held.setDeferred(IoClass::Background, true);
+        for (int i = 0; i < 4; ++i) {
+            held.submit(IoClass::Background, [&drained] { ++drained; });
+        }
+    }
+    assert(drained == 4);
+    std::cout << "  ✓ Held work is not dropped at shutdown" << std::endl;
+
+    // The lower of the configured and policy caps applies
+    scheduler.setConcurrencyLimit(IoClass::Background, 3);
+    scheduler.setPolicyLimit(IoClass::Background, 2);
+    assert(peakConcurrency(scheduler, IoClass::Background, 16) <= 2);
+    scheduler.setPolicyLimit(IoClass::Background, 0);
+    assert(peakConcurrency(scheduler, IoClass::Background, 16) <= 3);
+    std::cout << "  ✓ Policy caps combine with configured limits" << std::endl;
+
+    std::cout << "✓ Scheduler throttling tests passed" << std::endl;
+}
+
+void testConfiguration() {
+    std::cout << "Testing power policy configuration..." << std::endl;
+
+    const std::string configPath = (fs::temp_directory_path() / ("caithe_power_" + std::to_string(::getpid()) + ".json")).string();
+    ConfigManager config;
+    config.createDefaultConfig();
+    assert(config.getConfig().power.enabled && config.getConfig().power.batteryWorkers == 1);
+    config.getConfig().power.batteryWorkers = 2;
+    config.getConfig().power.pressureThreshold = 35.5;
+    config.getConfig().power.deferIdleOnBattery = false;
+    assert(config.saveConfig(configPath));
+    ConfigManager loaded;
+    assert(loaded.loadConfig(configPath));
+    const PowerPolicyConfig& power = loaded.getConfig().power;
+    assert(power.batteryWorkers == 2 && power.pressureThreshold == 35.5 && !power.deferIdleOnBattery);
+    assert(power.lowBatteryPercent == 20 && power.prefetchStretch == 4.0);
+    fs::remove(configPath);
+    std::cout << "  ✓ The policy round-trips through the configuration file" << std::endl;
+
+    std::cout << "✓ Power policy configuration tests passed" << std::endl;
+}
+
+void benchmarkPolicy() {
+    std::cout << "Benchmarking policy updates..." << std::endl;
+
+    FakeSystem system;
+    system.setMains(false);
+    system.setBattery("BAT0", "Discharging", 55);
+    system.setPressure("cpu", 1.0);
+    system.setPressure("memory", 0.5);
+    system.setPressure("io", 2.0);
+
+    PowerPolicy policy;
+    policy.setRoots(system.powerRoot(), system.pressureRoot());
+    TaskScheduler scheduler(2);
+    const int updates = 2000;
+    Stopwatch timer;
+    for (int i = 0; i < updates; ++i) {
+        policy.update(scheduler);
+    }
+    std::cout << "  Policy update (3 sysfs files, 3 PSI files): " << timer.elapsed<std::micro>() / updates << " µs"
+              << std::endl;
+
+    std::cout << "✓ Policy benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing power policy..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testSystemReading();
+        testDecisions();
+        testScheduling();
+        testConfiguration();
+        benchmarkPolicy();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All power policy tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Power policy test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,209 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_state_segment.cpp
+ * Description: Tests for the seqlock-protected shared-memory state snapshot
+ */
+
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../src/daemon/StateSegment.h"
+#include "TestSupport.h"
+
+// A snapshot whose every field is derived from `n`, so a torn read cannot look consistent
+static StateSegment::Snapshot numbered(uint64_t n) {
+    StateSegment::Snapshot snapshot;
+    snapshot.generation = n;
+    snapshot.counters = { n, n, n, n, n, n, n };
+    for (uint64_t i = 0; i < 1 + n % 4; ++i) {
+        snapshot.assignments.push_back({"DP-" + std::to_string(i), "/walls/" + std::string(n % 97, 'x') + std::to_string(n),
+                                        "Tile", n});
+    }
+    return snapshot;
+}
+
+static bool isNumbered(const StateSegment::Snapshot& snapshot) {
+    const uint64_t n = snapshot.generation;
+    const StateSegment::Counters& c = snapshot.counters;
+    if (c.connections != n || c.requests != n || c.applies != n || c.applyFailures != n || c.events != n ||
+        c.droppedClients != n || c.clients != n || snapshot.assignments.size() != 1 + n % 4) {
+        return false;
+    }
+    for (const StateSegment::Assignment& assignment : snapshot.assignments) {
+        if (assignment.generation != n || assignment.path != "/walls/" + std::string(n % 97, 'x') + std::to_string(n)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testPublishAndRead() {
+    std::cout << "Testing publish and read..." << std::endl;
+
+    StateSegment writer;
+    assert(writer.create() && writer.isOpen() && writer.getFd() >= 0);
+    StateSegment reader;
+    assert(reader.attach(::dup(writer.getFd())));
+    StateSegment::Snapshot snapshot;
+    assert(reader.read(snapshot) && snapshot.sequence == 0 && snapshot.assignments.empty());
+    std::cout << "  ✓ A fresh segment reads as empty" << std::endl;
+
+    StateSegment::Snapshot published;
+    published.generation = 7;
+    published.counters.requests = 42;
+    published.counters.clients = 3;
+    published.assignments.push_back({"DP-1", "/walls/a b.png", "Tile", 5});
+    published.assignments.push_back({"HDMI-A-1", "/walls/ünïcode.jpg", "Stretch", 7});
+    assert(writer.publish(published));
+    assert(reader.getSequence() == 2 && reader.read(snapshot));
+    assert(snapshot.sequence == 2 && snapshot.generation == 7 && snapshot.pid == static_cast<uint32_t>(::getpid()));
+    assert(snapshot.counters.requests == 42 && snapshot.counters.clients == 3 && snapshot.publishedNs > 0);
+    assert(snapshot.assignments.size() == 2 && snapshot.assignments[1].monitor == "HDMI-A-1");
+    assert(snapshot.assignments[0].path == "/walls/a b.png" && snapshot.assignments[0].mode == "Tile");
+    assert(snapshot.assignments[0].generation == 5 && snapshot.assignments[1].path == "/walls/ünïcode.jpg");
+    std::cout << "  ✓ Snapshots round-trip through the mapping" << std::endl;
+
+    StateSegment::Snapshot huge;
+    huge.assignments.push_back({"DP-1", std::string(StateSegment::SEGMENT_BYTES, 'x'), "Tile", 1});
+    assert(!writer.publish(huge) && writer.getLastErrorCode() == StateSegment::ErrorCode::TooLarge);
+    assert(reader.read(snapshot) && snapshot.generation == 7 && reader.getSequence() == 2);
+    std::cout << "  ✓ An oversized snapshot is refused and the previous one stays" << std::endl;
+
+    writer.retire();
+    assert(reader.getSequence() == 4);
+    assert(!reader.read(snapshot) && reader.getLastErrorCode() == StateSegment::ErrorCode::Retired);
+    std::cout << "  ✓ Retiring bumps the sequence and readers see Retired" << std::endl;
+
+    std::cout << "✓ Publish and read tests passed" << std::endl;
+}
+
+void testSealing() {
+    std::cout << "Testing segment sealing and validation..." << std::endl;
+
+    StateSegment writer;
+    assert(writer.create());
+    const int fd = writer.getFd();
+    assert(::ftruncate(fd, StateSegment::SEGMENT_BYTES * 2) != 0);
+    assert(::ftruncate(fd, 64) != 0);
+    void* writable = ::mmap(nullptr, StateSegment::SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    assert(writable == MAP_FAILED);
+    assert(::write(fd, "x", 1) != 1);
+    std::cout << "  ✓ Readers cannot resize, write or map it writable" << std::endl;
+
+    StateSegment reader;
+    assert(!reader.attach(-1) && reader.getLastErrorCode() == StateSegment::ErrorCode::AttachFailed);
+    const int other = ::memfd_create("not-a-segment", MFD_CLOEXEC);
+    assert(other >= 0 && ::ftruncate(other, StateSegment::SEGMENT_BYTES) == 0);
+    assert(!reader.attach(other) && reader.getLastErrorCode() == StateSegment::ErrorCode::AttachFailed);
+    assert(!reader.isOpen());
+    const int small = ::memfd_create("small", MFD_CLOEXEC);
+    assert(small >= 0 && ::ftruncate(small, 4096) == 0);
+    assert(!reader.attach(small) && !reader.isOpen());
+    StateSegment::Snapshot snapshot;
+    assert(!reader.read(snapshot) && reader.getLastErrorCode() == StateSegment::ErrorCode::AttachFailed);
+    assert(!reader.publish(snapshot));
+    std::cout << "  ✓ Foreign descriptors are rejected" << std::endl;
+
+    std::cout << "✓ Sealing tests passed" << std::endl;
+}
+
+void testConcurrentReaders() {
+    std::cout << "Testing readers against a busy writer..." << std::endl;
+
+    StateSegment writer;
+    assert(writer.create());
+    assert(writer.publish(numbered(1)));
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> torn(0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&writer, &done, &reads, &torn] {
+            StateSegment reader;
+            assert(reader.attach(::dup(writer.getFd())));
+            StateSegment::Snapshot snapshot;
+            uint64_t last = 0;
+            while (!done) {
+                if (!reader.read(snapshot)) {
+                    continue;   // A writer faster than MAX_READ_ATTEMPTS; never a torn view
+                }
+                if (!isNumbered(snapshot) || snapshot.generation < last) {
+                    ++torn;
+                }
+                last = snapshot.generation;
+                ++reads;
+            }
+        });
+    }
+    Stopwatch timer;
+    uint64_t published = 1;
+    while (timer.elapsed() < 300) {
+        assert(writer.publish(numbered(++published)));
+    }
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    assert(torn == 0 && reads > 0);
+    std::cout << "  ✓ " << reads << " reads during " << published << " publishes, none torn or out of order" << std::endl;
+
+    std::cout << "✓ Concurrent reader tests passed" << std::endl;
+}
+
+void benchmarkRead() {
+    std::cout << "Benchmarking snapshot reads..." << std::endl;
+
+    StateSegment writer;
+    assert(writer.create());
+    StateSegment::Snapshot snapshot;
+    for (int i = 0; i < 4; ++i) {
+        snapshot.assignments.push_back({"DP-" + std::to_string(i), "/home/user/Pictures/Wallpapers/forest-" +
+                                        std::to_string(i) + ".png", "Stretch", static_cast<uint64_t>(i + 1)});
+    }
+    assert(writer.publish(snapshot));
+    StateSegment reader;
+    assert(reader.attach(::dup(writer.getFd())));
+
+    const int iterations = 200000;
+    StateSegment::Snapshot copy;
+    Stopwatch timer;
+    for (int i = 0; i < iterations; ++i) {
+        assert(reader.read(copy));
+    }
+    const double readNs = timer.elapsed<std::nano>() / iterations;
+
+    uint64_t sum = 0;
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        sum += reader.getSequence();
+    }
+    const double checkNs = timer.elapsed<std::nano>() / iterations;
+    assert(sum == static_cast<uint64_t>(iterations) * 2);
+    std::cout << "  4 assignments: " << readNs << " ns per read, " << checkNs << " ns per change check" << std::endl;
+
+    std::cout << "✓ State segment benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing shared state segment..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testPublishAndRead();
+        testSealing();
+        testConcurrentReaders();
+        benchmarkRead();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All state segment tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "State segment test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,394 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_tag_index.cpp
+ * Description: Tests for roaring bitmaps, tag expressions and library tags, plus 100k-file benchmark
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "../src/library/LibraryIndex.h"
+#include "../src/library/RoaringBitmap.h"
+#include "../src/library/TagExpression.h"
+#include "../src/library/TagIndex.h"
+#include "../src/utils/TaskScheduler.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+static std::vector<uint32_t> toVector(const std::set<uint32_t>& values) {
+    return std::vector<uint32_t>(values.begin(), values.end());
+}
+
+// Random set mixing sparse containers, dense containers and values near key boundaries
+static std::set<uint32_t> makeSet(std::mt19937& rng, size_t sparse, size_t dense) {
+    std::set<uint32_t> values;
+    for (size_t i = 0; i < sparse; ++i) {
+        values.insert(rng() % (6u << 16));
+    }
+    const uint32_t denseKey = rng() % 4;
+    for (size_t i = 0; i < dense; ++i) {
+        values.insert((denseKey << 16) | (rng() & 0xFFFF));
+    }
+    values.insert(0xFFFF);
+    values.insert(0x10000);
+    return values;
+}
+
+void testRoaringBitmap() {
+    std::cout << "Testing roaring bitmaps..." << std::endl;
+
+    std::mt19937 rng(11);
+    for (int trial = 0; trial < 40; ++trial) {
+        const std::set<uint32_t> a = makeSet(rng, rng() % 6000, trial % 2 ? 20000 : rng() % 5000);
+        const std::set<uint32_t> b = makeSet(rng, rng() % 6000, trial % 3 ? 30000 : rng() % 100);
+
+        RoaringBitmap ra;
+        RoaringBitmap rb;
+        for (uint32_t v : a) ra.add(v);
+        // Out-of-order adds take the search path
+        std::vector<uint32_t> shuffled(b.begin(), b.end());
+        std::shuffle(shuffled.begin(), shuffled.end(), rng);
+        for (uint32_t v : shuffled) rb.add(v);
+        assert(ra.toVector() == toVector(a) && rb.cardinality() == b.size());
+
+        std::set<uint32_t> expected;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+        RoaringBitmap r = ra;
+        r &= rb;
+        assert(r.toVector() == toVector(expected));
+
+        expected.clear();
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+        r = ra;
+        r |= rb;
+        assert(r.toVector() == toVector(expected));
+
+        expected.clear();
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+        r = ra;
+        r -= rb;
+        assert(r.toVector() == toVector(expected));
+
+        // Building the same set through different operations gives equal bitmaps
+        RoaringBitmap rebuilt;
+        for (uint32_t v : expected) rebuilt.add(v);
+        assert(rebuilt == r);
+    }
+    std::cout << "  ✓ AND / OR / AND NOT match std::set across container kinds" << std::endl;
+
+    RoaringBitmap bitmap;
+    for (uint32_t v = 0; v < 10000; ++v) bitmap.add(v * 3);
+    assert(bitmap.getContainerCount() == 1 && bitmap.getMemoryBytes() == 8192);
+    for (uint32_t v = 0; v < 10000; v += 2) bitmap.remove(v * 3);
+    assert(bitmap.cardinality() == 5000 && !bitmap.contains(0) && bitmap.contains(3));
+    for (uint32_t v = 1; v < 10000; v += 4) bitmap.remove(v * 3);
+    assert(bitmap.cardinality() == 2500 && bitmap.getMemoryBytes() == 5000);
+    assert(bitmap.maximum() == 9999 * 3);
+    std::cout << "  ✓ Containers switch between bitmap and array at the threshold" << std::endl;
+
+    RoaringBitmap single;
+    single.add(70000);
+    single.remove(70000);
+    assert(single.empty() && single.getContainerCount() == 0);
+    std::cout << "  ✓ Emptied containers are released" << std::endl;
+
+    const RoaringBitmap range = RoaringBitmap::range(100, 200000);
+    assert(range.cardinality() == 199900 && range.contains(100) && !range.contains(99) &&
+           range.contains(199999) && !range.contains(200000) && range.maximum() == 199999);
+    assert(RoaringBitmap::range(5, 5).empty());
+    std::cout << "  ✓ Ranges across key boundaries" << std::endl;
+
+    std::vector<uint8_t> encoded;
+    const std::set<uint32_t> values = makeSet(rng, 3000, 20000);
+    RoaringBitmap original;
+    for (uint32_t v : values) original.add(v);
+    original.serialize(encoded);
+    RoaringBitmap decoded;
+    size_t consumed = 0;
+    assert(decoded.deserialize(encoded.data(), encoded.size(), consumed));
+    assert(consumed == encoded.size() && decoded == original);
+    for (size_t cut = 0; cut < encoded.size(); cut += 97) {
+        assert(!decoded.deserialize(encoded.data(), cut, consumed));
+    }
+    encoded[10] ^= 0xFF;        // Corrupt the first container
+    assert(!decoded.deserialize(encoded.data(), encoded.size(), consumed) || decoded != original);
+    std::cout << "  ✓ Serialization round-trips and rejects truncation" << std::endl;
+
+    SelectionBitmap selection;
+    original.toSelection(200000, selection);
+    size_t expectedRows = 0;
+    for (uint32_t v : values) {
+        if (v < 200000) {
+            assert(selection.test(v));
+            ++expectedRows;
+        }
+    }
+    assert(selection.count() == expectedRows);
+    RoaringBitmap back = RoaringBitmap::fromSelection(selection);
+    RoaringBitmap clipped = original;
+    clipped &= RoaringBitmap::range(0, 200000);
+    assert(back == clipped);
+    std::cout << "  ✓ Conversion to and from selection bitmaps" << std::endl;
+
+    std::cout << "✓ Roaring bitmap tests passed" << std::endl;
+}
+
+void testTagExpressions() {
+    std::cout << "Testing tag expressions..." << std::endl;
+
+    using Op = TagExpression::OpCode;
+    TagExpression expression;
+    assert(expression.compile("") && expression.getProgram().size() == 1 &&
+           expression.getProgram()[0].op == Op::All);
+
+    assert(expression.compile("theme:dark AND NOT team:red"));
+    assert(expression.getProgram().size() == 3 && expression.getProgram()[2].op == Op::AndNot);
+    assert((expression.getTags() == std::vector<std::string>{"theme:dark", "team:red"}));
+    std::cout << "  ✓ AND NOT compiles to a single AndNot" << std::endl;
+
+    assert(expression.compile("a | b c"));      // a OR (b AND c)
+    const std::vector<TagExpression::Instruction>& program = expression.getProgram();
+    assert(program.size() == 5 && program[3].op == Op::And && program[4].op == Op::Or);
+    assert(expression.compile("not not a") && expression.getProgram().size() == 1);
+    assert(expression.compile("\"and\" or \"summer night\"") &&
+           (expression.getTags() == std::vector<std::string>{"and", "summer night"}));
+    assert(expression.compile("(a || b) && !c"));
+    std::cout << "  ✓ Precedence, implicit AND, symbols and quoted tags" << std::endl;
+
+    for (const char* bad : {"a AND", "(a", "a)", "AND a", "\"open", "\"\"", "a $ b", "NOT"}) {
+        assert(!expression.compile(bad));
+        assert(expression.getLastErrorCode() == TagExpression::ErrorCode::SyntaxError);
+        assert(expression.getProgram().empty());
+    }
+    assert(!expression.compile(std::string(100, '(') + "a" + std::string(100, ')')));
+    assert(expression.getLastErrorCode() == TagExpression::ErrorCode::TooDeep);
+    std::cout << "  ✓ Syntax errors and runaway nesting are rejected" << std::endl;
+
+    std::cout << "✓ Tag expression tests passed" << std::endl;
+}
+
+void testTagIndex() {
+    std::cout << "Testing tag index evaluation..." << std::endl;
+
+    const uint32_t fileCount = 150000;
+    std::mt19937 rng(5);
+    TagIndex tags;
+    std::vector<std::vector<bool>> member(4, std::vector<bool>(fileCount, false));
+    const char* names[] = {"dark", "winter", "team:red", "favourite"};
+    const uint32_t densities[] = {2, 5, 40, 2000};   // 1 in N files
+    for (int t = 0; t < 4; ++t) {
+        for (uint32_t id = 0; id < fileCount; ++id) {
+            if (rng() % densities[t] == 0) {
+                tags.add(names[t], id);
+                member[t][id] = true;
+            }
+        }
+    }
+    assert(tags.size() == 4 && !tags.add("bad\"name", 1) && !tags.add("", 1));
+
+    struct Case {
+        const char* text;
+        bool (*expected)(const std::vector<std::vector<bool>>&, uint32_t);
+    };
+    const Case cases[] = {
+        {"dark winter", [](const std::vector<std::vector<bool>>& m, uint32_t i) { return m[0][i] && m[1][i]; }},
+        {"dark OR team:red", [](const std::vector<std::vector<bool>>& m, uint32_t i) { return m[0][i] || m[2][i]; }},
+        {"NOT dark", [](const std::vector<std::vector<bool>>& m, uint32_t i) { return !m[0][i]; }},
+        {"winter AND NOT (dark OR favourite)",
+         [](const std::vector<std::vector<bool>>& m, uint32_t i) { return m[1][i] && !(m[0][i] || m[3][i]); }},
+        {"NOT dark AND winter", [](const std::vector<std::vector<bool>>& m, uint32_t i) { return !m[0][i] && m[1][i]; }},
+        {"missing OR favourite", [](const std::vector<std::vector<bool>>& m, uint32_t i) { return m[3][i]; }},
+        {"", [](const std::vector<std::vector<bool>>&, uint32_t) { return true; }},
+    };
+
+    TagExpression expression;
+    RoaringBitmap result;
+    for (const Case& test : cases) {
+        assert(expression.compile(test.text));
+        tags.evaluate(expression, fileCount, result);
+        size_t expected = 0;
+        for (uint32_t id = 0; id < fileCount; ++id) {
+            const bool match = test.expected(member, id);
+            assert(result.contains(id) == match);
+            expected += match;
+        }
+        assert(result.cardinality() == expected);
+    }
+    std::cout << "  ✓ Expressions match a brute-force evaluation" << std::endl;
+
+    // Drop every third id and close the gaps
+    std::vector<uint32_t> newIds(fileCount, TagIndex::NO_ID);
+    uint32_t next = 0;
+    for (uint32_t id = 0; id < fileCount; ++id) {
+        if (id % 3 != 0) {
+            newIds[id] = next++;
+        }
+    }
+    tags.remap(newIds);
+    const RoaringBitmap* dark = tags.find("dark");
+    for (uint32_t id = 0; id < fileCount; ++id) {
+        if (newIds[id] != TagIndex::NO_ID) {
+            assert(dark->contains(newIds[id]) == member[0][id]);
+        }
+    }
+    assert(dark->maximum() < next);
+    std::cout << "  ✓ Remapping follows table compaction" << std::endl;
+
+    std::vector<uint8_t> encoded;
+    tags.serialize(encoded);
+    TagIndex loaded;
+    size_t consumed = 0;
+    assert(loaded.deserialize(encoded.data(), encoded.size(), next, consumed) && consumed == encoded.size());
+    assert(loaded.getTagNames() == tags.getTagNames() && *loaded.find("winter") == *tags.find("winter"));
+    assert(!loaded.deserialize(encoded.data(), encoded.size(), next / 2, consumed));
+    std::cout << "  ✓ Serialization checks ids against the file count" << std::endl;
+
+    std::cout << "✓ Tag index tests passed" << std::endl;
+}
+
+void testLibraryTags() {
+    std::cout << "Testing tags on a library index..." << std::endl;
+
+    const fs::path root = makeTempRoot("tags");
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < 6; ++i) {
+        const std::string path = (root / ("wall" + std::to_string(i) + ".png")).string();
+        std::ofstream(path) << "not really an image " << i;
+        paths.push_back(path);
+    }
+
+    TaskScheduler scheduler(2);
+    LibraryIndex index;
+    index.setPerceptualHashing(false);
+    index.indexFiles(paths, scheduler);
+    assert(index.getFiles().size() == 6);
+
+    for (int i = 0; i < 6; ++i) {
+        assert(index.tagFile(paths[i], i % 2 ? "season:winter" : "season:summer"));
+        if (i < 3) {
+            assert(index.tagFile(paths[i], "theme:dark"));
+        }
+    }
+    assert(!index.tagFile(root.string() + "/missing.png", "theme:dark"));
+    assert(!index.tagFile(paths[0], "bad\nname"));
+    assert((index.getFileTags(paths[1]) == std::vector<std::string>{"season:winter", "theme:dark"}));
+
+    auto selected = [&index](const std::string& text) {
+        TagExpression expression;
+        assert(expression.compile(text));
+        SelectionBitmap selection;
+        index.selectTagged(expression, selection);
+        std::vector<std::string> result;
+        selection.forEach([&](size_t row) { result.push_back(index.getFiles()[row].path); });
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    assert((selected("theme:dark AND season:winter") == std::vector<std::string>{paths[1]}));
+    assert((selected("season:winter AND NOT theme:dark") == std::vector<std::string>{paths[3], paths[5]}));
+    std::cout << "  ✓ Tag files and select them by expression" << std::endl;
+
+    // Removal compacts the file table; tags must follow their files
+    assert(index.removeFile(paths[0]));
+    assert((selected("theme:dark") == std::vector<std::string>{paths[1], paths[2]}));
+    assert(index.untagFile(paths[2], "theme:dark") && !index.untagFile(paths[2], "theme:dark"));
+    assert((selected("theme:dark") == std::vector<std::string>{paths[1]}));
+    std::cout << "  ✓ Tags follow files through removal and untagging" << std::endl;
+
+    const std::string indexPath = (root / "library.idx").string();
+    assert(index.save(indexPath));
+    LibraryIndex loaded;
+    assert(loaded.load(indexPath));
+    assert(loaded.getTags().getTagNames() == index.getTags().getTagNames());
+    assert((loaded.getFileTags(paths[1]) == std::vector<std::string>{"season:winter", "theme:dark"}));
+
+    // A new file appended after reload starts untagged
+    const std::string extra = (root / "extra.png").string();
+    std::ofstream(extra) << "extra";
+    loaded.setPerceptualHashing(false);
+    loaded.indexFiles({extra}, scheduler);
+    assert(loaded.getFileTags(extra).empty());
+    assert(loaded.getFileTags(paths[5]) == std::vector<std::string>{"season:winter"});
+    std::cout << "  ✓ Tags persist in the library index" << std::endl;
+
+    fs::remove_all(root);
+    std::cout << "✓ Library tag tests passed" << std::endl;
+}
+
+void benchmarkTags() {
+    std::cout << "Benchmarking tag expressions over 100k files..." << std::endl;
+
+    const uint32_t fileCount = 100000;
+    std::mt19937 rng(42);
+    TagIndex tags;
+    // Folder-like tags (contiguous runs), broad random tags and a sparse one
+    for (uint32_t id = 20000; id < 45000; ++id) tags.add("folder:anime", id);
+    for (uint32_t id = 0; id < fileCount; ++id) {
+        if (rng() % 3 == 0) tags.add("dark", id);
+        if (rng() % 4 == 0) tags.add("winter", id);
+        if (rng() % 500 == 0) tags.add("favourite", id);
+    }
+
+    size_t memory = 0;
+    for (const std::string& name : tags.getTagNames()) {
+        memory += tags.find(name)->getMemoryBytes();
+    }
+
+    TagExpression expression;
+    assert(expression.compile("(dark OR favourite) AND winter AND NOT folder:anime"));
+    RoaringBitmap result;
+    SelectionBitmap selection;
+    const int iterations = 2000;
+    Stopwatch timer;
+    for (int i = 0; i < iterations; ++i) {
+        tags.evaluate(expression, fileCount, result);
+    }
+    const double evaluateUs = timer.elapsed<std::micro>() / iterations;
+
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        result.toSelection(fileCount, selection);
+    }
+    const double selectionUs = timer.elapsed<std::micro>() / iterations;
+
+    assert(expression.compile("favourite AND NOT dark"));
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        tags.evaluate(expression, fileCount, result);
+    }
+    const double sparseUs = timer.elapsed<std::micro>() / iterations;
+
+    std::cout << "  Tag memory: " << memory / 1024 << " KiB for " << tags.size() << " tags" << std::endl;
+    std::cout << "  Four-tag expression: " << evaluateUs << " us" << std::endl;
+    std::cout << "  To selection bitmap: " << selectionUs << " us" << std::endl;
+    std::cout << "  Sparse expression: " << sparseUs << " us" << std::endl;
+    std::cout << "✓ Benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing tags and compressed bitmaps..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    try {
+        testRoaringBitmap();
+        testTagExpressions();
+        testTagIndex();
+        testLibraryTags();
+        benchmarkTags();
+
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All tag tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Tag test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,656 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_wallpaper_daemon.cpp
+ * Description: Tests for the daemon control socket protocol and the load generator
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+#include "../src/core/TraceReplay.h"
+#include "../src/daemon/ControlClient.h"
+#include "../src/daemon/LoadGenerator.h"
+#include "../src/daemon/RemoteThumbnails.h"
+#include "../src/daemon/StateSegment.h"
+#include "../src/daemon/WallpaperDaemon.h"
+#include "../src/imaging/PngEncoder.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+static nlohmann::json ask(ControlClient& client, const std::string& request) {
+    std::string reply;
+    assert(client.request(request, reply));
+    return nlohmann::json::parse(reply);
+}
+
+// Raw connection for what ControlClient never sends: pipelined and oversized requests
+static int rawConnect(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    return fd;
+}
+
+static int listenOn(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    assert(::listen(fd, 4) == 0);
+    return fd;
+}
+
+static std::string readAll(int fd) {
+    std::string data;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        data.append(buffer, static_cast<size_t>(count));
+    }
+    return data;
+}
+
+void testProtocol(const fs::path& root) {
+    std::cout << "Testing the control socket protocol..." << std::endl;
+
+    HyprpaperStandIn hyprpaper((root / "hyprpaper.sock").string());
+    WallpaperDaemon daemon;
+    daemon.setBackendSocket(hyprpaper.getSocketPath());
+    const std::string socketPath = (root / "caithe.sock").string();
+    assert(daemon.start(socketPath) && daemon.isRunning());
+    assert(!daemon.start(socketPath) && daemon.getLastErrorCode() == WallpaperDaemon::ErrorCode::AlreadyRunning);
+    WallpaperDaemon second;
+    assert(!second.start(socketPath) && second.getLastErrorCode() == WallpaperDaemon::ErrorCode::ListenFailed);
+    std::cout << "  ✓ One daemon per socket" << std::endl;
+
+    ControlClient client;
+    assert(client.connect(socketPath));
+    assert(ask(client, "ping")["ok"] == true);
+    assert(ask(client, "status")["assignments"].empty());
+    assert(ask(client, "get DP-1")["ok"] == false);
+    assert(ask(client, "mode DP-1 Tile")["ok"] == true);            // Remembered for the next set
+    assert(ask(client, "set DP-1 /walls/a b.png")["ok"] == true);
+    const nlohmann::json shown = ask(client, "get DP-1");
+    assert(shown["path"] == "/walls/a b.png" && shown["mode"] == "Tile");
+    assert(ask(client, "mode DP-1 Scale")["ok"] == true);
+    assert(ask(client, "set HDMI-A-1 /walls/b.png")["ok"] == true);
+    const nlohmann::json status = ask(client, "status");
+    assert(status["assignments"].size() == 2 && status["clients"] == 1);
+    assert(status["assignments"][0]["monitor"] == "DP-1" && status["assignments"][0]["mode"] == "Scale");
+    std::cout << "  ✓ ping, status, get, set and mode" << std::endl;
+
+    const std::vector<std::string> expected = {
+        "preload /walls/a b.png", "wallpaper DP-1,tile:/walls/a b.png",
+        "wallpaper DP-1,contain:/walls/a b.png",
+        "preload /walls/b.png", "wallpaper HDMI-A-1,/walls/b.png",
+    };
+    assert(hyprpaper.takeRequests() == expected);
+    std::cout << "  ✓ Applies reach hyprpaper, preloading each image once" << std::endl;
+
+    assert(ask(client, "frobnicate")["error"] == "Unknown command 'frobnicate'");
+    assert(ask(client, "set DP-1")["ok"] == false);
+    assert(ask(client, "mode DP-1 Sideways")["ok"] == false);
+    assert(client.isConnected());
+    std::cout << "  ✓ Bad requests get an error and keep the connection" << std::endl;
+
+    // Pipelined requests are answered in order even though the set completes asynchronously
+    const int raw = rawConnect(socketPath);
+    const std::string batch = "set DP-1 /walls/c.png\nget DP-1\nping\n";
+    assert(::send(raw, batch.data(), batch.size(), 0) == static_cast<ssize_t>(batch.size()));
+    ::shutdown(raw, SHUT_WR);
+    const std::string replies = readAll(raw);
+    ::close(raw);
+    assert(replies == "{\"generation\":5,\"ok\":true}\n"
+                      "{\"generation\":5,\"mode\":\"Scale\",\"monitor\":\"DP-1\",\"ok\":true,\"path\":\"/walls/c.png\"}\n"
+                      "{\"ok\":true}\n");
+    std::cout << "  ✓ Pipelined requests after a half-close are answered in order" << std::endl;
+
+    const int flood = rawConnect(socketPath);
+    const std::string huge(WallpaperDaemon::MAX_REQUEST_BYTES + 100, 'x');
+    assert(::send(flood, huge.data(), huge.size(), 0) == static_cast<ssize_t>(huge.size()));
+    const std::string rejected = readAll(flood);
+    ::close(flood);
+    assert(rejected.find("\"ok\":false") != std::string::npos);
+    assert(daemon.getStats().droppedClients == 1);
+    std::cout << "  ✓ An oversized request drops the client" << std::endl;
+
+    daemon.stop();
+    assert(!daemon.isRunning() && !fs::exists(socketPath));
+    std::string reply;
+    assert(!client.request("ping", reply));
+    std::cout << "  ✓ stop() closes clients and removes the socket" << std::endl;
+
+    std::cout << "✓ Protocol tests passed" << std::endl;
+}
+
+void testSubscriptions(const fs::path& root) {
+    std::cout << "Testing subscriptions..." << std::endl;
+
+    HyprpaperStandIn hyprpaper((root / "hyprpaper_sub.sock").string());
+    WallpaperDaemon daemon;
+    daemon.setBackendSocket(hyprpaper.getSocketPath());
+    assert(daemon.start((root / "sub.sock").string()));
+
+    ControlClient watcher;
+    ControlClient setter;
+    assert(watcher.connect(daemon.getSocketPath()) && setter.connect(daemon.getSocketPath()));
+    assert(ask(watcher, "subscribe")["ok"] == true);
+    assert(ask(setter, "set DP-1 /walls/a.png")["ok"] == true);
+    assert(ask(setter, "mode DP-1 Center")["ok"] == true);
+
+    std::string event;
+    assert(watcher.nextEvent(event, 1000));
+    nlohmann::json parsed = nlohmann::json::parse(event);
+    assert(parsed["event"] == "wallpaper" && parsed["monitor"] == "DP-1" && parsed["path"] == "/walls/a.png");
+    // A request from the subscriber itself skips over the queued event and leaves it for later
+    assert(ask(watcher, "ping")["ok"] == true);
+    assert(watcher.nextEvent(event, 1000));
+    assert(nlohmann::json::parse(event)["mode"] == "Center");
+    assert(!watcher.nextEvent(event, 50) && watcher.getLastErrorCode() == ControlClient::ErrorCode::Timeout);
+    std::cout << "  ✓ Subscribers see every change, interleaved with their own replies" << std::endl;
+
+    // A failed apply changes nothing and sends no event
+    WallpaperDaemon broken;
+    broken.setBackendSocket((root / "nobody.sock").string());
+    assert(broken.start((root / "broken.sock").string()));
+    ControlClient brokenClient;
+    assert(brokenClient.connect(broken.getSocketPath()));
+    assert(ask(brokenClient, "subscribe")["ok"] == true);
+    assert(ask(brokenClient, "set DP-1 /walls/a.png")["ok"] == false);
+    assert(ask(brokenClient, "get DP-1")["ok"] == false);
+    assert(!brokenClient.nextEvent(event, 50));
+    assert(broken.getStats().applyFailures == 1 && broken.getStats().events == 0);
+    std::cout << "  ✓ A failed apply is reported and leaves the state alone" << std::endl;
+
+    std::cout << "✓ Subscription tests passed" << std::endl;
+}
+
+void testGenerations(const fs::path& root) {
+    std::cout << "Testing generations and conditional writes..." << std::endl;
+
+    HyprpaperStandIn hyprpaper((root / "hyprpaper_gen.sock").string());
+    WallpaperDaemon daemon;
+    daemon.setBackendSocket(hyprpaper.getSocketPath());
+    assert(daemon.start((root / "gen.sock").string()));
+
+    ControlClient watcher;
+    ControlClient client;
+    assert(watcher.connect(daemon.getSocketPath()) && client.connect(daemon.getSocketPath()));
+    assert(ask(watcher, "subscribe")["ok"] == true);
+    assert(ask(client, "status")["generation"] == 0);
+    assert(ask(client, "get DP-1")["generation"] == 0);
+    assert(ask(client, "if 0 set DP-1 /walls/a.png")["generation"] == 1);
+    const nlohmann::json stale = ask(client, "if 0 set DP-1 /walls/b.png");
+    assert(stale["ok"] == false && stale["error"] == "Generation mismatch on DP-1" && stale["generation"] == 1);
+    assert(ask(client, "if 0 mode eDP-1 Tile")["generation"] == 2);     // Nothing shown there yet
+    const nlohmann::json pending = ask(client, "get eDP-1");
+    assert(pending["ok"] == false && pending["generation"] == 2);
+    assert(ask(client, "get DP-1")["path"] == "/walls/a.png");
+    std::cout << "  ✓ Writes bump the generation; a stale one is refused with the current value" << std::endl;
+
+    assert(ask(client, "if x set DP-1 /walls/b.png")["error"] == "Usage: if GENERATION set|mode MONITOR ...");
+    assert(ask(client, "if 1 get DP-1")["error"] == "Only set and mode can be conditional");
+    assert(ask(client, "if 1 set DP-1")["error"] == "Usage: set MONITOR PATH");
+    std::cout << "  ✓ Malformed conditions are rejected" << std::endl;
+
+    // Two writers read generation 1; the second is checked only after the first commits
+    hyprpaper.setReplyDelay(std::chrono::milliseconds(50));
+    const int first = rawConnect(daemon.getSocketPath());
+    const int second = rawConnect(daemon.getSocketPath());
+    const int third = rawConnect(daemon.getSocketPath());
+    assert(::send(first, "if 1 set DP-1 /walls/x.png\n", 27, 0) == 27);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    assert(::send(second, "if 1 set DP-1 /walls/y.png\n", 27, 0) == 27);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    assert(::send(third, "mode DP-1 Center\n", 17, 0) == 17);
+    for (const int fd : {first, second, third}) {
+        ::shutdown(fd, SHUT_WR);
+    }
+    const std::string won = readAll(first);
+    const std::string lost = readAll(second);
+    const std::string centered = readAll(third);
+    for (const int fd : {first, second, third}) {
+        ::close(fd);
+    }
+    hyprpaper.setReplyDelay(std::chrono::milliseconds(0));
+    assert(won == "{\"generation\":3,\"ok\":true}\n");
+    assert(lost == "{\"error\":\"Generation mismatch on DP-1\",\"generation\":3,\"ok\":false}\n");
+    assert(centered == "{\"generation\":4,\"ok\":true}\n");
+    const std::vector<std::string> expected = {
+        "preload /walls/a.png", "wallpaper DP-1,/walls/a.png",
+        "preload /walls/x.png", "wallpaper DP-1,/walls/x.png", "wallpaper DP-1,contain:/walls/x.png",
+    };
+    assert(hyprpaper.takeRequests() == expected);
+    std::cout << "  ✓ Racing writers: exactly one wins; writes queued behind an apply see its result" << std::endl;
+
+    // Events carry the generation and only the fields that changed
+    std::vector<nlohmann::json> events;
+    std::string event;
+    while (watcher.nextEvent(event, 200)) {
+        events.push_back(nlohmann::json::parse(event));
+    }
+    assert(events.size() == 4);
+    for (size_t i = 0; i < events.size(); ++i) {
+        assert(events[i]["generation"] == i + 1);
+    }
+    assert(events[0]["path"] == "/walls/a.png" && events[0]["mode"] == "Stretch");
+    assert(events[1]["monitor"] == "eDP-1" && events[1]["path"] == "" && events[1]["mode"] == "Tile");
+    assert(events[2]["path"] == "/walls/x.png" && !events[2].contains("mode"));
+    assert(events[3]["mode"] == "Center" && !events[3].contains("path"));
+    std::cout << "  ✓ Events are diffs numbered by generation" << std::endl;
+
+    daemon.stop();
+    std::cout << "✓ Generation tests passed" << std::endl;
+}
+
+// The segment is republished at the end of the loop iteration that sent the reply
+static bool readUntil(StateSegment& view, StateSegment::Snapshot& snapshot, uint64_t generation) {
+    for (int i = 0; i < 200; ++i) {
+        if (view.read(snapshot) && snapshot.generation >= generation) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+void testStateSegment(const fs::path& root) {
+    std::cout << "Testing the shared state segment..." << std::endl;
+
+    HyprpaperStandIn hyprpaper((root / "hyprpaper_state.sock").string());
+    auto previous = std::make_unique<WallpaperDaemon>();
+    previous->setBackendSocket(hyprpaper.getSocketPath());
+    const std::string socketPath = (root / "state.sock").string();
+    assert(previous->start(socketPath));
+
+    ControlClient watcher;
+    ControlClient setter;
+    assert(watcher.connect(socketPath) && setter.connect(socketPath));
+    StateSegment view;
+    assert(setter.attachState(view));
+    StateSegment::Snapshot snapshot;
+    assert(view.read(snapshot) && snapshot.generation == 0 && snapshot.assignments.empty());
+    assert(snapshot.pid == static_cast<uint32_t>(::getpid()));
+    std::cout << "  ✓ \"state\" passes a segment the client can map" << std::endl;
+
+    assert(ask(watcher, "subscribe")["ok"] == true);
+    assert(ask(setter, "set DP-1 /walls/a.png")["generation"] == 1);
+    assert(ask(setter, "mode DP-1 Tile")["generation"] == 2);
+    assert(readUntil(view, snapshot, 2) && snapshot.assignments.size() == 1);
+    assert(snapshot.assignments[0].monitor == "DP-1" && snapshot.assignments[0].path == "/walls/a.png");
+    assert(snapshot.assignments[0].mode == "Tile" && snapshot.assignments[0].generation == 2);
+    assert(snapshot.counters.applies == 2 && snapshot.counters.clients == 2 && snapshot.counters.events == 2);
+    const uint64_t sequence = view.getSequence();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(view.getSequence() == sequence);
+    std::cout << "  ✓ Changes are republished, and an idle daemon leaves the segment alone" << std::endl;
+
+    // Events are queued ahead of the reply; the descriptor still pairs with the reply
+    StateSegment second;
+    assert(watcher.attachState(second) && second.read(snapshot) && snapshot.generation == 2);
+    std::string event;
+    assert(watcher.nextEvent(event, 1000) && watcher.nextEvent(event, 1000));
+    assert(watcher.takeDescriptor() == -1);
+    std::cout << "  ✓ A subscriber can attach between its events" << std::endl;
+
+    WallpaperDaemon upgraded;
+    upgraded.setBackendSocket(hyprpaper.getSocketPath());
+    assert(upgraded.takeOver(socketPath));
+    for (int i = 0; i < 100 && previous->isRunning(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    previous.reset();
+    assert(!view.read(snapshot) && view.getLastErrorCode() == StateSegment::ErrorCode::Retired);
+    assert(setter.attachState(view) && view.read(snapshot));
+    assert(snapshot.generation == 2 && snapshot.assignments.size() == 1 && snapshot.assignments[0].mode == "Tile");
+    upgraded.stop();
+    assert(!view.read(snapshot) && view.getLastErrorCode() == StateSegment::ErrorCode::Retired);
+    std::cout << "  ✓ Upgrades and shutdowns retire the segment; the new daemon serves its own" << std::endl;
+
+    std::cout << "✓ State segment tests passed" << std::endl;
+}
+
+// A solid-colour PNG, so every thumbnail pixel is known exactly
+static std::string writeSolidPng(const fs::path& path, int width, int height) {
+    ImageBuffer image;
+    image.allocate(width, height, 4);
+    for (size_t i = 0; i < image.pixels.size(); i += 4) {
+        image.pixels[i] = 200;
+        image.pixels[i + 1] = 100;
+        image.pixels[i + 2] = 50;
+        image.pixels[i + 3] = 255;
+    }
+    PngEncoder encoder;
+    assert(encoder.writeFile(image, path.string()));
+    return path.string();
+}
+
+static nlohmann::json nextThumbnailEvent(ControlClient& client) {
+    std::string line;
+    assert(client.nextEvent(line, 5000));
+    const nlohmann::json event = nlohmann::json::parse(line);
+    assert(event["event"] == "thumbnail");
+    return event;
+}
+
+void testThumbnails(const fs::path& root) {
+    std::cout << "Testing daemon thumbnails..." << std::endl;
+
+    fs::create_directories(root / "thumbs");
+    const std::string solid = writeSolidPng(root / "thumbs" / "solid.png", 320, 200);
+    const std::string other = writeSolidPng(root / "thumbs" / "other.png", 100, 300);
+    const std::string broken = (root / "thumbs" / "broken.png").string();
+    std::ofstream(broken) << "not a png";
+
+    WallpaperDaemon daemon;
+    const std::string socketPath = (root / "thumbs.sock").string();
+    assert(daemon.start(socketPath));
+    ControlClient first;
+    ControlClient second;
+    assert(first.connect(socketPath) && second.connect(socketPath));
+
+    assert(ask(first, "thumbnail 5 " + solid)["pending"] == true);
+    nlohmann::json event = nextThumbnailEvent(first);
+    assert(event["fd"] == true && event["format"] == "RGBA" && event["path"] == solid && event["modified"] == 5);
+    assert(event["width"] == 160 && event["height"] == 100);
+    assert(event["sourceWidth"] == 320 && event["sourceHeight"] == 200);
+    const int fd = first.takeDescriptor();
+    assert(fd >= 0);
+    struct stat decoded{};
+    assert(::fstat(fd, &decoded) == 0 && decoded.st_size == 160 * 100 * 4);
+    std::cout << "  ✓ A miss is decoded once and arrives as an event with its buffer" << std::endl;
+
+    assert(::write(fd, "x", 1) != 1 && ::ftruncate(fd, 64) != 0);
+    assert(::mmap(nullptr, decoded.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) == MAP_FAILED);
+    const auto mapped = RemoteThumbnails::map(fd, 160, 100);
+    assert(mapped && mapped->bytes() == 160 * 100 * 4);
+    for (size_t i = 0; i < mapped->bytes(); i += 4) {
+        assert(mapped->pixels[i] == 200 && mapped->pixels[i + 1] == 100 && mapped->pixels[i + 2] == 50 &&
+               mapped->pixels[i + 3] == 255);
+    }
+    const int unsealed = ::memfd_create("unsealed", MFD_CLOEXEC);
+    assert(unsealed >= 0 && ::ftruncate(unsealed, 160 * 100 * 4) == 0);
+    assert(!RemoteThumbnails::map(unsealed, 160, 100));
+    std::cout << "  ✓ The buffer is sealed and maps read-only to the expected pixels" << std::endl;
+
+    nlohmann::json reply = ask(second, "thumbnail 5 " + solid);
+    assert(reply["ok"] == true && reply["fd"] == true && reply["width"] == 160);
+    const int shared = second.takeDescriptor();
+    struct stat hit{};
+    assert(shared >= 0 && ::fstat(shared, &hit) == 0 && hit.st_ino == decoded.st_ino);
+    ::close(shared);
+    std::cout << "  ✓ Another client gets the same buffer at once, without a second decode" << std::endl;
+
+    assert(ask(second, "thumbnail 6 " + solid)["pending"] == true);
+    event = nextThumbnailEvent(second);
+    assert(event["modified"] == 6 && second.takeDescriptor() >= 0);
+    assert(ask(first, "thumbnail 1 " + broken)["pending"] == true);
+    event = nextThumbnailEvent(first);
+    assert(event["failed"] == true && event["path"] == broken && first.takeDescriptor() == -1);
+    reply = ask(first, "thumbnail 1 " + broken);
+    assert(reply["ok"] == false && reply["failed"] == true);
+    assert(ask(first, "thumbnail soon " + solid)["ok"] == false);
+    assert(ask(first, "thumbnail 1 relative.png")["ok"] == false);
+    std::cout << "  ✓ A changed file is decoded again, and unreadable ones fail once" << std::endl;
+
+    RemoteThumbnails thumbnails;
+    assert(thumbnails.connect(socketPath));
+    const auto resident = thumbnails.request(solid, 6);
+    assert(resident && resident->width == 160 && resident->height == 100 && resident->pixels[0] == 200);
+    assert(!thumbnails.request(other, 9) && !thumbnails.request(broken, 1));
+    assert(!thumbnails.request("relative.png", 1) && thumbnails.hasFailed("relative.png"));
+    // Immediate answers are reported too, so the GUI drops textures of an older version
+    std::vector<std::string> completed;
+    for (int i = 0; i < 500 && std::find(completed.begin(), completed.end(), other) == completed.end(); ++i) {
+        const std::vector<std::string> taken = thumbnails.takeCompleted();
+        completed.insert(completed.end(), taken.begin(), taken.end());
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    assert(completed.size() == 4 && completed.front() == solid && thumbnails.hasFailed(broken));
+    const auto arrived = thumbnails.request(other, 9);
+    assert(arrived && arrived->width == 53 && arrived->height == 160 && arrived->sourceHeight == 300);
+    assert(thumbnails.getStats().received == 2 && thumbnails.getStats().hits == 1);
+    assert(daemon.getStats().thumbnails == 5);
+    std::cout << "  ✓ RemoteThumbnails maps replies and events like a local ThumbnailCache" << std::endl;
+
+    // Copies under one content key are asked for once and share the mapping
+    const std::string copy = (root / "thumbs" / "copy.png").string();
+    const std::string twin = (root / "thumbs" / "twin.png").string();
+    fs::copy_file(other, copy, fs::copy_options::overwrite_existing);
+    fs::copy_file(other, twin, fs::copy_options::overwrite_existing);
+    assert(!thumbnails.request(copy, 4, "f-other") && !thumbnails.request(twin, 8, "f-other"));
+    completed.clear();
+    for (int i = 0; i < 500 && completed.empty(); ++i) {
+        completed = thumbnails.takeCompleted();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    assert(completed == std::vector<std::string>{"f-other"} && !thumbnails.hasFailed("f-other"));
+    const auto twinThumbnail = thumbnails.request(twin, 8, "f-other");
+    assert(twinThumbnail && twinThumbnail == thumbnails.request(copy, 4, "f-other") && twinThumbnail->width == 53);
+    assert(thumbnails.getStats().received == 3 && daemon.getStats().thumbnails == 6);
+    std::cout << "  ✓ Copies sharing a content key share one request and one mapping" << std::endl;
+
+    std::cout << "✓ Thumbnail tests passed" << std::endl;
+}
+
+void testUpgrade(const fs::path& root) {
+    std::cout << "Testing the upgrade handoff..." << std::endl;
+
+    HyprpaperStandIn hyprpaper((root / "hyprpaper_upgrade.sock").string());
+    hyprpaper.setReplyDelay(std::chrono::microseconds(50000));
+    auto previous = std::make_unique<WallpaperDaemon>();
+    previous->setBackendSocket(hyprpaper.getSocketPath());
+    const std::string socketPath = (root / "upgrade.sock").string();
+    assert(previous->start(socketPath));
+
+    ControlClient watcher;
+    ControlClient setter;
+    assert(watcher.connect(socketPath) && setter.connect(socketPath));
+    assert(ask(watcher, "subscribe")["ok"] == true);
+    assert(ask(setter, "set DP-1 /walls/a.png")["ok"] == true);
+    assert(ask(setter, "mode DP-1 Tile")["ok"] == true);
+    std::string event;
+    assert(watcher.nextEvent(event, 1000) && watcher.nextEvent(event, 1000));
+    hyprpaper.takeRequests();
+
+    // A new binary that dies mid-handoff leaves the running daemon serving
+    const int dying = rawConnect(socketPath);
+    assert(::send(dying, "handoff\n", 8, 0) == 8);
+    char byte = 0;
+    while (::recv(dying, &byte, 1, 0) == 1 && byte != '\n') {
+    }
+    ::close(dying);
+    ControlClient late;
+    assert(late.connect(socketPath) && ask(late, "ping")["ok"] == true && ask(setter, "ping")["ok"] == true);
+    assert(previous->isRunning() && !previous->hasHandedOff());
+    std::cout << "  ✓ A failed handoff resumes service" << std::endl;
+
+    // One apply in flight and a half-written request when the upgrade starts
+    const int raw = rawConnect(socketPath);
+    const std::string batch = "set HDMI-A-1 /walls/b.png\nget HDMI-A-1\npi";
+    assert(::send(raw, batch.data(), batch.size(), 0) == static_cast<ssize_t>(batch.size()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    WallpaperDaemon upgraded;
+    upgraded.setBackendSocket(hyprpaper.getSocketPath());
+    assert(upgraded.takeOver(socketPath) && upgraded.isRunning());
+    for (int i = 0; i < 100 && previous->isRunning(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(!previous->isRunning() && previous->hasHandedOff());
+    previous.reset();
+    assert(fs::exists(socketPath));
+    assert(upgraded.getStats().adoptedClients == 4 && upgraded.getStats().clients == 4);
+    std::cout << "  ✓ The previous daemon hands over and exits, leaving the socket in place" << std::endl;
+
+    assert(::send(raw, "ng\n", 3, 0) == 3);
+    ::shutdown(raw, SHUT_WR);
+    const std::string replies = readAll(raw);
+    ::close(raw);
+    assert(replies == "{\"generation\":3,\"ok\":true}\n"
+                      "{\"generation\":3,\"mode\":\"Stretch\",\"monitor\":\"HDMI-A-1\",\"ok\":true,\"path\":\"/walls/b.png\"}\n"
+                      "{\"ok\":true}\n");
+    std::cout << "  ✓ The in-flight apply finishes first; queued and half-written requests carry over" << std::endl;
+
+    assert(watcher.nextEvent(event, 1000) && nlohmann::json::parse(event)["path"] == "/walls/b.png");
+    const nlohmann::json carried = ask(setter, "get DP-1");
+    assert(carried["mode"] == "Tile" && carried["generation"] == 2);
+    assert(ask(setter, "if 2 set DP-1 /walls/a.png")["generation"] == 4);
+    assert(watcher.nextEvent(event, 1000));
+    const nlohmann::json rewritten = nlohmann::json::parse(event);
+    assert(rewritten["generation"] == 4 && !rewritten.contains("path") && !rewritten.contains("mode"));
+    const std::vector<std::string> expected = {
+        "preload /walls/b.png", "wallpaper HDMI-A-1,/walls/b.png", "wallpaper DP-1,tile:/walls/a.png",
+    };
+    assert(hyprpaper.takeRequests() == expected);
+    ControlClient fresh;
+    assert(fresh.connect(socketPath));
+    const nlohmann::json status = ask(fresh, "status");
+    assert(status["assignments"].size() == 2 && status["generation"] == 4);
+    std::cout << "  ✓ Connections, subscriptions, assignments, generations and preloads survive" << std::endl;
+
+    // A reply that parses but is not what a daemon sends is refused, not thrown
+    const std::vector<uint8_t> arraySnapshot = nlohmann::json::to_cbor(nlohmann::json::array());
+    const std::vector<std::string> badReplies = {
+        "true\n", "[]\n", "{\"ok\":\"yes\"}\n", "{\"ok\":false,\"error\":7}\n",
+        "{\"ok\":true,\"bytes\":\"many\"}\n",
+        "{\"ok\":true,\"bytes\":" + std::to_string(arraySnapshot.size()) + ",\"fds\":2}\n" +
+            std::string(arraySnapshot.begin(), arraySnapshot.end()),
+    };
+    const std::string fakePath = (root / "fake_upgrade.sock").string();
+    for (const std::string& reply : badReplies) {
+        fs::remove(fakePath);
+        const int listener = listenOn(fakePath);
+        std::thread server([listener, &reply] {
+            const int peer = ::accept(listener, nullptr, nullptr);
+            char request[64];
+            assert(::recv(peer, request, sizeof(request), 0) > 0);
+            assert(::send(peer, reply.data(), reply.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(reply.size()));
+            readAll(peer);
+            ::close(peer);
+        });
+        WallpaperDaemon confused;
+        assert(!confused.takeOver(fakePath));
+        assert(confused.getLastErrorCode() == WallpaperDaemon::ErrorCode::HandoffFailed && !confused.isRunning());
+        server.join();
+        ::close(listener);
+    }
+    std::cout << "  ✓ Malformed handoff replies abandon the takeover" << std::endl;
+
+    WallpaperDaemon orphan;
+    assert(!orphan.takeOver((root / "nobody_upgrade.sock").string()));
+    assert(orphan.getLastErrorCode() == WallpaperDaemon::ErrorCode::HandoffFailed && !orphan.isRunning());
+    upgraded.stop();
+    assert(!fs::exists(socketPath));
+    std::cout << "  ✓ Nothing to take over is an error; the new daemon owns the socket file" << std::endl;
+
+    std::cout << "✓ Upgrade handoff tests passed" << std::endl;
+}
+
+void testLoadGenerator(const fs::path& root) {
+    std::cout << "Testing the load generator..." << std::endl;
+
+    HyprpaperStandIn hyprpaper((root / "hyprpaper_load.sock").string());
+    WallpaperDaemon daemon;
+    daemon.setBackendSocket(hyprpaper.getSocketPath());
+    assert(daemon.start((root / "load.sock").string()));
+
+    LoadProfile profile;
+    profile.socketPath = daemon.getSocketPath();
+    profile.clients = 8;
+    profile.subscribers = 2;
+    profile.queryRate = 100.0;
+    profile.setRate = 20.0;
+    profile.duration = std::chrono::milliseconds(300);
+    const LoadReport report = LoadGenerator(profile).run();
+
+    assert(report.connectErrors == 0 && report.queries.errors == 0 && report.sets.errors == 0);
+    assert(report.queries.count > 100 && report.sets.count > 0);
+    assert(report.queries.p50 <= report.queries.p99 && report.queries.p99 <= report.queries.max);
+    assert(report.eventsExpected == report.sets.count * 2 && report.eventsReceived == report.eventsExpected);
+    assert(daemon.getStats().requests >= report.queries.count + report.sets.count);
+    std::cout << "  ✓ " << report.queries.count << " queries and " << report.sets.count
+              << " sets without errors; every event delivered" << std::endl;
+
+    const nlohmann::json json = nlohmann::json::parse(report.toJson());
+    assert(json["queries"]["count"] == report.queries.count && json["profile"]["clients"] == 8);
+    assert(json["sets"]["latency_ms"].contains("p999") && json["build"].contains("compiler"));
+    std::cout << "  ✓ JSON report carries profile, build and percentiles" << std::endl;
+
+    profile.socketPath = (root / "missing.sock").string();
+    const LoadReport failed = LoadGenerator(profile).run();
+    assert(failed.connectErrors == 1 && failed.queries.count == 0);
+    std::cout << "  ✓ An absent daemon is reported as a connect error" << std::endl;
+
+    std::cout << "✓ Load generator tests passed" << std::endl;
+}
+
+void benchmarkDaemon(const fs::path& root) {
+    std::cout << "Benchmarking the daemon under concurrent load..." << std::endl;
+
+    for (const int delayUs : {0, 500}) {
+        HyprpaperStandIn hyprpaper((root / ("bench_" + std::to_string(delayUs) + ".sock")).string());
+        hyprpaper.setReplyDelay(std::chrono::microseconds(delayUs));
+        WallpaperDaemon daemon;
+        daemon.setBackendSocket(hyprpaper.getSocketPath());
+        assert(daemon.start((root / ("bench_daemon_" + std::to_string(delayUs) + ".sock")).string()));
+
+        LoadProfile profile;
+        profile.socketPath = daemon.getSocketPath();
+        profile.clients = 64;
+        profile.subscribers = 8;
+        profile.queryRate = 200.0;
+        profile.setRate = 5.0;
+        profile.duration = std::chrono::milliseconds(1000);
+        const LoadReport report = LoadGenerator(profile).run();
+        assert(report.connectErrors == 0 && report.queries.errors == 0);
+        std::cout << "  hyprpaper reply delay " << delayUs << " us:" << std::endl;
+        std::cout << report.describe();
+    }
+
+    std::cout << "✓ Daemon benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing wallpaper daemon control socket..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    const fs::path root = makeTempRoot("daemon");
+    try {
+        testProtocol(root);
+        testSubscriptions(root);
+        testGenerations(root);
+        testStateSegment(root);
+        testThumbnails(root);
+        testUpgrade(root);
+        testLoadGenerator(root);
+        benchmarkDaemon(root);
+
+        fs::remove_all(root);
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All wallpaper daemon tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        fs::remove_all(root);
+        std::cerr << "Wallpaper daemon test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,526 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: test_workspace_wallpapers.cpp
+ * Description: Tests for per-workspace wallpapers: PNG pre-renders, socket2 events, hyprpaper requests and switch latency
+ */
+
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../src/core/HyprlandEvents.h"
+#include "../src/core/HyprpaperClient.h"
+#include "../src/core/WorkspaceWallpapers.h"
+#include "../src/imaging/ImageDecoder.h"
+#include "../src/imaging/PngDecoder.h"
+#include "../src/imaging/PngEncoder.h"
+#include "../src/utils/ConfigManager.h"
+#include "../src/utils/TaskScheduler.h"
+#include "TestSupport.h"
+
+namespace fs = std::filesystem;
+
+static int listenOn(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    assert(::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    assert(::listen(fd, 16) == 0);
+    return fd;
+}
+
+// Answers every request with "ok" (or a configured error) and records it, like hyprpaper
+class FakeHyprpaper {
+public:
+    explicit FakeHyprpaper(const std::string& path) : m_path(path), m_fd(listenOn(path)), m_stop(false) {
+        m_thread = std::thread([this] { serve(); });
+    }
+
+    ~FakeHyprpaper() {
+        m_stop = true;
+        m_thread.join();
+        ::close(m_fd);
+        fs::remove(m_path);
+    }
+
+    std::vector<std::string> takeRequests() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<std::string> requests;
+        requests.swap(m_requests);
+        return requests;
+    }
+
+    void setReply(const std::string& reply) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_reply = reply;
+    }
+
+private:
+    void serve() {
+        pollfd descriptor{m_fd, POLLIN, 0};
+        while (!m_stop) {
+            if (::poll(&descriptor, 1, 20) <= 0) {
+                continue;
+            }
+            const int client = ::accept(m_fd, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            char buffer[4096];
+            const ssize_t count = ::recv(client, buffer, sizeof(buffer), 0);
+            std::string reply;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_requests.emplace_back(buffer, count > 0 ? static_cast<size_t>(count) : 0);
+                reply = m_reply;
+            }
+            ::send(client, reply.data(), reply.size(), MSG_NOSIGNAL);
+            ::close(client);
+        }
+    }
+
+    std::string m_path;
+    int m_fd;
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::vector<std::string> m_requests;
+    std::string m_reply = "ok";
+};
+
+static size_t countPrefix(const std::vector<std::string>& requests, const std::string& prefix) {
+    size_t count = 0;
+    for (const std::string& request : requests) {
+        count += request.compare(0, prefix.size(), prefix) == 0 ? 1 : 0;
+    }
+    return count;
+}
+
+static ImageBuffer makeGradient(int width, int height, int channels) {
+    ImageBuffer image;
+    image.allocate(width, height, channels);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* pixel = image.pixels.data() + y * image.stride + x * channels;
+            for (int c = 0; c < channels; ++c) {
+                pixel[c] = static_cast<uint8_t>((x * 7 + y * 3 + c * 50) & 0xFF);
+            }
+        }
+    }
+    return image;
+}
+
+static HyprlandEvent makeEvent(const std::string& name, const std::string& data) {
+    HyprlandEvent event;
+    event.name = name;
+    event.data = data;
+    event.received = std::chrono::steady_clock::now();
+    return event;
+}
+
+// prewarm() only queues renders and collects finished ones; call it until none are pending
+// Each prewarm() clears the last error, so the first failure's code is kept in `error`
+static bool prewarmAll(WorkspaceWallpapers& wallpapers, TaskScheduler& scheduler,
+                       WorkspaceWallpapers::ErrorCode* error = nullptr) {
+    bool success = true;
+    do {
+        if (!wallpapers.prewarm(scheduler) && success) {
+            success = false;
+            if (error) {
+                *error = wallpapers.getLastErrorCode();
+            }
+        }
+        if (wallpapers.getPendingRenders() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    } while (wallpapers.getPendingRenders() > 0);
+    return success;
+}
+
+void testPngEncoder() {
+    std::cout << "Testing PNG encoder..." << std::endl;
+
+    // Reference checksums
+    const std::string check = "123456789";
+    assert(PngEncoder::crc32(reinterpret_cast<const uint8_t*>(check.data()), check.size()) == 0xCBF43926u);
+    const std::string wiki = "Wikipedia";
+    assert(PngEncoder::adler32(reinterpret_cast<const uint8_t*>(wiki.data()), wiki.size()) == 0x11E60398u);
+    std::vector<uint8_t> zeros(100000, 0xFF);
+    const uint32_t whole = PngEncoder::adler32(zeros.data(), zeros.size());
+    assert(PngEncoder::adler32(zeros.data() + 7000, zeros.size() - 7000, PngEncoder::adler32(zeros.data(), 7000)) == whole);
+    std::cout << "  ✓ CRC-32 and Adler-32 match reference values" << std::endl;
+
+    // Every channel count round-trips, including a stream spanning several stored blocks
+    PngEncoder encoder;
+    PngDecoder decoder;
+    for (int channels = 1; channels <= 4; ++channels) {
+        const ImageBuffer image = makeGradient(301, 97, channels);
+        std::vector<uint8_t> encoded;
+        assert(encoder.encode(image, encoded));
+        assert(PngDecoder::isPng(encoded.data(), encoded.size()));
+        ImageBuffer decoded;
+        assert(decoder.decode(encoded.data(), encoded.size(), decoded, 4));
+        assert(decoded.width == image.width && decoded.height == image.height);
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                const uint8_t* source = image.pixels.data() + y * image.stride + x * channels;
+                const uint8_t* pixel = decoded.pixels.data() + y * decoded.stride + x * 4;
+                const bool gray = channels <= 2;
+                assert(pixel[0] == source[0]);
+                assert(pixel[1] == source[gray ? 0 : 1] && pixel[2] == source[gray ? 0 : 2]);
+                assert(pixel[3] == (channels % 2 == 0 ? source[channels - 1] : 255));
+            }
+        }
+    }
+    std::cout << "  ✓ Gray, gray+alpha, RGB and RGBA round-trip through the decoder" << std::endl;
+
+    ImageBuffer empty;
+    std::vector<uint8_t> encoded;
+    assert(!encoder.encode(empty, encoded));
+    assert(encoder.getLastErrorCode() == PngEncoder::ErrorCode::InvalidImage);
+    assert(!encoder.writeFile(makeGradient(4, 4, 3), "/nonexistent/dir/out.png"));
+    assert(encoder.getLastErrorCode() == PngEncoder::ErrorCode::WriteFailed);
+    std::cout << "  ✓ Invalid images and unwritable paths are reported" << std::endl;
+
+    std::cout << "✓ PNG encoder tests passed" << std::endl;
+}
+
+void testEventStream(const fs::path& root) {
+    std::cout << "Testing socket2 event stream..." << std::endl;
+
+    HyprlandEvent event;
+    assert(HyprlandEvents::parseLine("focusedmon>>DP-1,3", event));
+    assert(event.name == "focusedmon" && event.data == "DP-1,3");
+    assert(!HyprlandEvents::parseLine("garbage", event));
+    const auto fields = HyprlandEvents::splitData("DP-1,name,with,commas", 2);
+    assert(fields.size() == 2 && fields[0] == "DP-1" && fields[1] == "name,with,commas");
+    std::cout << "  ✓ Lines and comma-separated data parse" << std::endl;
+
+    const std::string path = (root / "socket2.sock").string();
+    const int server = listenOn(path);
+    HyprlandEvents events;
+    assert(events.connect(path));
+    const int peer = ::accept(server, nullptr, nullptr);
+    assert(peer >= 0);
+
+    // A line split across writes is held back until its newline arrives
+    const std::string first = "workspace>>2\nfocusedmon>>HDMI-A-1,";
+    ::send(peer, first.data(), first.size(), MSG_NOSIGNAL);
+    std::vector<HyprlandEvent> received;
+    assert(events.poll(1000, received));
+    assert(received.size() == 1 && received[0].name == "workspace" && received[0].data == "2");
+    const std::string second = "5\nactivewindow>>kitty,~\n";
+    ::send(peer, second.data(), second.size(), MSG_NOSIGNAL);
+    received.clear();
+    assert(events.poll(1000, received));
+    assert(received.size() == 2 && received[0].data == "HDMI-A-1,5" && received[1].name == "activewindow");
+    std::cout << "  ✓ Partial lines are buffered across reads" << std::endl;
+
+    received.clear();
+    assert(events.poll(0, received) && received.empty());
+    ::close(peer);
+    assert(!events.poll(1000, received));
+    assert(events.getLastErrorCode() == HyprlandEvents::ErrorCode::Disconnected && !events.isConnected());
+    ::close(server);
+    std::cout << "  ✓ Hyprland closing the socket is reported" << std::endl;
+
+    std::cout << "✓ Socket2 event stream tests passed" << std::endl;
+}
+
+void testSwitching(const fs::path& root) {
+    std::cout << "Testing workspace switching..." << std::endl;
+
+    PngEncoder encoder;
+    const std::string red = (root / "red.png").string();
+    const std::string blue = (root / "blue.png").string();
+    const std::string tall = (root / "tall.png").string();
+    assert(encoder.writeFile(makeGradient(400, 300, 3), red));
+    assert(encoder.writeFile(makeGradient(320, 240, 3), blue));
+    assert(encoder.writeFile(makeGradient(90, 160, 3), tall));
+
+    FakeHyprpaper hyprpaper((root / "hyprpaper.sock").string());
+    WorkspaceWallpapers wallpapers;
+    wallpapers.getClient().setSocketPath((root / "hyprpaper.sock").string());
+    wallpapers.setCacheDirectory((root / "cache").string());
+    wallpapers.setMonitor("DP-1", 160, 90, "1");
+    wallpapers.setMonitor("HDMI-A-1", 64, 64, "3");
+    wallpapers.setFocusedMonitor("DP-1");
+    wallpapers.setWallpaper("1", red);
+    wallpapers.setWallpaper("2", blue);
+    wallpapers.setWallpaper("3", tall);
+    assert(wallpapers.needsPrewarm());
+
+    TaskScheduler scheduler(2);
+    assert(prewarmAll(wallpapers, scheduler));
+    assert(!wallpapers.needsPrewarm());
+    assert(wallpapers.getStats().renders == 3);
+
+    // Pre-renders have the monitor's size and are all preloaded within the default budget
+    const std::string redRender = wallpapers.getPrerendered(red, 160, 90);
+    assert(!redRender.empty() && fs::exists(redRender));
+    ImageDecoder decoder;
+    ImageBuffer rendered;
+    assert(decoder.decodeFile(redRender, rendered, 3));
+    assert(rendered.width == 160 && rendered.height == 90);
+    const std::string tallRender = wallpapers.getPrerendered(tall, 64, 64);
+    assert(decoder.decodeFile(tallRender, rendered, 3) && rendered.width == 64 && rendered.height == 64);
+    assert(wallpapers.isPreloaded(redRender) && wallpapers.isPreloaded(tallRender));
+    auto requests = hyprpaper.takeRequests();
+    assert(countPrefix(requests, "preload ") == 3 && countPrefix(requests, "wallpaper ") == 0);
+    std::cout << "  ✓ Pre-renders are cover-fit to their monitor and preloaded" << std::endl;
+
+    // Hyprland sends workspace and focusedmon for the same switch: one request in total
+    assert(wallpapers.handleEvent(makeEvent("workspace", "2")));
+    assert(!wallpapers.handleEvent(makeEvent("focusedmon", "DP-1,2")));
+    requests = hyprpaper.takeRequests();
+    assert(requests.size() == 1 && requests[0] == "wallpaper DP-1," + wallpapers.getPrerendered(blue, 160, 90));
+    assert(wallpapers.getAssigned("DP-1") == wallpapers.getPrerendered(blue, 160, 90));
+    std::cout << "  ✓ A switch issues exactly one wallpaper request" << std::endl;
+
+    // Focus moves to the other monitor and it switches there
+    assert(wallpapers.handleEvent(makeEvent("focusedmon", "HDMI-A-1,3")));
+    assert(!wallpapers.handleEvent(makeEvent("workspace", "3")));
+    assert(wallpapers.handleEvent(makeEvent("workspace", "1")));
+    requests = hyprpaper.takeRequests();
+    assert(requests.size() == 3 && requests[0] == "wallpaper HDMI-A-1," + tallRender);
+    // red was only rendered for DP-1, so HDMI-A-1 falls back to the original and preloads it
+    assert(requests[1] == "preload " + red && requests[2] == "wallpaper HDMI-A-1," + red);
+
+    // A workspace without a wallpaper and unrelated events send nothing
+    assert(!wallpapers.handleEvent(makeEvent("workspace", "9")));
+    assert(!wallpapers.handleEvent(makeEvent("activewindow", "kitty,~")));
+    assert(hyprpaper.takeRequests().empty());
+
+    const WorkspaceSwitchStats& stats = wallpapers.getStats();
+    assert(stats.switches == 3 && stats.assignments == 3);
+    assert(stats.preloadMisses == 1 && stats.preloadHits == 2);   // red at 64x64 was not rendered yet
+    assert(stats.meanLatency().count() > 0 && stats.maxLatency >= stats.lastLatency);
+    assert(wallpapers.needsPrewarm());
+    std::cout << "  ✓ Switch, hit and latency statistics are recorded" << std::endl;
+
+    hyprpaper.setReply("wallpaper failed (not preloaded)");
+    assert(!wallpapers.handleEvent(makeEvent("workspace", "3")));
+    assert(wallpapers.getLastErrorCode() == WorkspaceWallpapers::ErrorCode::HyprpaperFailed);
+    assert(wallpapers.getLastError().find("not preloaded") != std::string::npos);
+    std::cout << "  ✓ hyprpaper errors are reported" << std::endl;
+
+    // Held Background work postpones renders without blocking the caller
+    WorkspaceWallpapers held;
+    held.getClient().setSocketPath((root / "hyprpaper.sock").string());
+    held.setCacheDirectory((root / "held_cache").string());
+    held.setMonitor("DP-1", 160, 90, "1");
+    held.setWallpaper("1", red);
+    scheduler.setDeferred(IoClass::Background, true);
+    assert(held.prewarm(scheduler));
+    assert(held.prewarm(scheduler));
+    assert(held.getPendingRenders() == 1 && held.needsPrewarm());
+    assert(held.getPrerendered(red, 160, 90).empty() && held.getStats().renders == 0);
+    scheduler.setDeferred(IoClass::Background, false);
+    hyprpaper.setReply("ok");
+    assert(prewarmAll(held, scheduler));
+    assert(!held.needsPrewarm() && held.getStats().renders == 1);
+    assert(held.isPreloaded(held.getPrerendered(red, 160, 90)));
+    hyprpaper.takeRequests();
+    std::cout << "  ✓ Prewarm returns while Background work is held and finishes once released" << std::endl;
+
+    // Renders persist: a second instance finds them in the cache without decoding again
+    WorkspaceWallpapers restarted;
+    restarted.getClient().setSocketPath((root / "hyprpaper.sock").string());
+    restarted.setCacheDirectory((root / "cache").string());
+    restarted.setMonitor("DP-1", 160, 90, "1");
+    restarted.setWallpaper("1", red);
+    hyprpaper.setReply("ok");
+    assert(prewarmAll(restarted, scheduler));
+    assert(restarted.getStats().renders == 0 && restarted.getPrerendered(red, 160, 90) == redRender);
+    hyprpaper.takeRequests();
+    std::cout << "  ✓ Pre-renders are reused across restarts" << std::endl;
+
+    // An undecodable source fails once and is not retried until it changes
+    const std::string broken = (root / "broken.png").string();
+    {
+        std::ofstream file(broken, std::ios::binary);
+        file << "not an image";
+    }
+    WorkspaceWallpapers failing;
+    failing.getClient().setSocketPath((root / "hyprpaper.sock").string());
+    failing.setCacheDirectory((root / "failing_cache").string());
+    failing.setMonitor("DP-1", 160, 90, "1");
+    failing.setWallpaper("1", red);
+    failing.setWallpaper("2", broken);
+    WorkspaceWallpapers::ErrorCode error = WorkspaceWallpapers::ErrorCode::None;
+    assert(!prewarmAll(failing, scheduler, &error));
+    assert(error == WorkspaceWallpapers::ErrorCode::RenderFailed);
+    assert(failing.getStats().renders == 1);
+    assert(failing.handleEvent(makeEvent("workspace", "2")));
+    assert(failing.getAssigned("DP-1") == broken && !failing.needsPrewarm());
+    assert(failing.prewarm(scheduler) && failing.getPendingRenders() == 0);
+    assert(encoder.writeFile(makeGradient(200, 100, 3), broken));
+    fs::last_write_time(broken, fs::last_write_time(broken) + std::chrono::seconds(1));
+    assert(failing.handleEvent(makeEvent("workspace", "1")));
+    assert(failing.handleEvent(makeEvent("workspace", "2")));
+    assert(failing.needsPrewarm());
+    assert(prewarmAll(failing, scheduler));
+    assert(failing.getStats().renders == 2 && !failing.getPrerendered(broken, 160, 90).empty());
+    hyprpaper.takeRequests();
+    std::cout << "  ✓ A failed render is not retried until its source changes" << std::endl;
+
+    // Copies known under one content key share a render, a preload and a screen
+    const std::string copy = (root / "red_copy.png").string();
+    fs::copy_file(red, copy, fs::copy_options::overwrite_existing);
+    WorkspaceWallpapers shared;
+    shared.getClient().setSocketPath((root / "hyprpaper.sock").string());
+    shared.setCacheDirectory((root / "shared_cache").string());
+    shared.setContentKeyResolver([&](const std::string& source) {
+        return source == red || source == copy ? std::string("f-red") : std::string();
+    });
+    shared.setMonitor("DP-1", 160, 90);
+    shared.setFocusedMonitor("DP-1");
+    shared.setWallpaper("1", red);
+    shared.setWallpaper("2", copy);
+    shared.setWallpaper("3", blue);
+    assert(prewarmAll(shared, scheduler));
+    assert(shared.getStats().renders == 2);
+    const std::string sharedRender = shared.getPrerendered(copy, 160, 90);
+    assert(!sharedRender.empty() && sharedRender == shared.getPrerendered(red, 160, 90));
+    requests = hyprpaper.takeRequests();
+    assert(countPrefix(requests, "preload ") == 2);
+    assert(shared.handleEvent(makeEvent("workspace", "2")) && shared.getAssigned("DP-1") == sharedRender);
+    assert(!shared.handleEvent(makeEvent("workspace", "1")));
+    hyprpaper.takeRequests();
+    std::cout << "  ✓ Copies sharing a content key share one pre-render" << std::endl;
+
+    std::cout << "✓ Workspace switching tests passed" << std::endl;
+}
+
+void testMemoryBudget(const fs::path& root) {
+    std::cout << "Testing preload memory budget..." << std::endl;
+
+    PngEncoder encoder;
+    std::vector<std::string> sources;
+    for (int i = 0; i < 4; ++i) {
+        sources.push_back((root / ("budget" + std::to_string(i) + ".png")).string());
+        assert(encoder.writeFile(makeGradient(200 + i, 100, 3), sources.back()));
+    }
+
+    FakeHyprpaper hyprpaper((root / "budget.sock").string());
+    WorkspaceWallpapers wallpapers;
+    wallpapers.getClient().setSocketPath((root / "budget.sock").string());
+    wallpapers.setCacheDirectory((root / "budget_cache").string());
+    wallpapers.setMonitor("DP-1", 100, 50, "0");
+    for (int i = 0; i < 4; ++i) {
+        wallpapers.setWallpaper(std::to_string(i), sources[i]);
+    }
+
+    // Room for two 100x50 renders
+    const size_t renderBytes = 100 * 50 * 4;
+    wallpapers.setMemoryBudget(2 * renderBytes);
+    TaskScheduler scheduler(2);
+    assert(prewarmAll(wallpapers, scheduler));
+    assert(wallpapers.getStats().preloadedBytes == 2 * renderBytes);
+    auto requests = hyprpaper.takeRequests();
+    assert(countPrefix(requests, "preload ") == 2);
+    // The two that did not fit are prefetched into the page cache instead
+    assert(wallpapers.getStats().prefetches == 2);
+    // The workspace on screen is preloaded first
+    assert(wallpapers.isPreloaded(wallpapers.getPrerendered(sources[0], 100, 50)));
+    std::cout << "  ✓ Prewarm stops at the budget, on-screen workspace first" << std::endl;
+
+    // Show 0, then visit 2 and 3 (not resident): the oldest image not on screen is unloaded
+    assert(wallpapers.handleEvent(makeEvent("focusedmon", "DP-1,0")));
+    hyprpaper.takeRequests();
+    assert(wallpapers.handleEvent(makeEvent("workspace", "2")));
+    assert(wallpapers.handleEvent(makeEvent("workspace", "3")));
+    requests = hyprpaper.takeRequests();
+    assert(countPrefix(requests, "unload ") == 2 && countPrefix(requests, "preload ") == 2);
+    assert(countPrefix(requests, "wallpaper ") == 2);
+    assert(wallpapers.getStats().preloadedBytes <= 2 * renderBytes);
+    assert(wallpapers.isPreloaded(wallpapers.getAssigned("DP-1")));
+    assert(!wallpapers.isPreloaded(wallpapers.getPrerendered(sources[0], 100, 50)));
+    std::cout << "  ✓ Switches evict the least recently used image that is not on screen" << std::endl;
+
+    const std::string configPath = (root / "config.json").string();
+    ConfigManager config;
+    config.createDefaultConfig();
+    assert(config.getConfig().preloadBudgetMB == 256);
+    config.getConfig().workspaceWallpapers = {{"1", sources[0]}, {"*", sources[1]}};
+    config.getConfig().preloadBudgetMB = 64;
+    assert(config.saveConfig(configPath));
+    ConfigManager loaded;
+    assert(loaded.loadConfig(configPath));
+    assert(loaded.getConfig().workspaceWallpapers == config.getConfig().workspaceWallpapers);
+    assert(loaded.getConfig().preloadBudgetMB == 64);
+    std::cout << "  ✓ Workspace wallpapers and the budget round-trip through the configuration file" << std::endl;
+
+    std::cout << "✓ Preload memory budget tests passed" << std::endl;
+}
+
+void benchmarkSwitchLatency(const fs::path& root) {
+    std::cout << "Benchmarking workspace switch latency..." << std::endl;
+
+    PngEncoder encoder;
+    FakeHyprpaper hyprpaper((root / "bench.sock").string());
+    WorkspaceWallpapers wallpapers;
+    wallpapers.getClient().setSocketPath((root / "bench.sock").string());
+    wallpapers.setCacheDirectory((root / "bench_cache").string());
+    wallpapers.setMonitor("DP-1", 1920, 1080, "1");
+    for (int i = 1; i <= 9; ++i) {
+        const std::string source = (root / ("bench" + std::to_string(i) + ".png")).string();
+        assert(encoder.writeFile(makeGradient(640, 360, 3), source));
+        wallpapers.setWallpaper(std::to_string(i), source);
+    }
+
+    TaskScheduler scheduler;
+    Stopwatch timer;
+    assert(prewarmAll(wallpapers, scheduler));
+    std::cout << "  Pre-rendered and preloaded 9 workspaces at 1920x1080 in " << timer.elapsed() << " ms" << std::endl;
+
+    const int switches = 500;
+    for (int i = 0; i < switches; ++i) {
+        assert(wallpapers.handleEvent(makeEvent("workspace", std::to_string((i + 1) % 9 + 1))));
+    }
+    const WorkspaceSwitchStats& stats = wallpapers.getStats();
+    std::cout << "  " << stats.assignments << " switches, all preloaded: " << (stats.preloadMisses == 0 ? "yes" : "no")
+              << std::endl;
+    std::cout << "  Event-to-apply latency: mean " << stats.meanLatency().count() / 1000.0 << " µs, max "
+              << stats.maxLatency.count() / 1000.0 << " µs" << std::endl;
+    assert(stats.preloadMisses == 0);
+
+    std::cout << "✓ Workspace switch benchmark completed" << std::endl;
+}
+
+int main() {
+    std::cout << "Testing workspace wallpapers..." << std::endl;
+    std::cout << "=================================================" << std::endl;
+
+    const fs::path root = makeTempRoot("workspaces");
+    try {
+        testPngEncoder();
+        testEventStream(root);
+        testSwitching(root);
+        testMemoryBudget(root);
+        benchmarkSwitchLatency(root);
+
+        fs::remove_all(root);
+        std::cout << "=================================================" << std::endl;
+        std::cout << "All workspace wallpaper tests passed! ✨" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        fs::remove_all(root);
+        std::cerr << "Workspace wallpaper test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: caithe_loadgen.cpp
+ * Description: Load generator for the daemon control socket
+ *
+ * caithe_loadgen [--socket PATH] [--clients N] [--subscribers N] [--query-rate N]
+ *                [--set-rate N] [--duration-ms N] [--backend-delay-us N] [--json FILE]
+ *
+ * Without --socket, a daemon is started in-process against a stand-in hyprpaper that
+ * answers after --backend-delay-us, so results do not depend on a running Hyprland.
+ * The JSON report goes to --json FILE (or stdout) and a summary to stderr.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "core/TraceReplay.h"
+#include "daemon/LoadGenerator.h"
+#include "daemon/WallpaperDaemon.h"
+
+static int usage() {
+    std::cerr << "Usage: caithe_loadgen [--socket PATH] [--clients N] [--subscribers N] [--query-rate N]\n"
+              << "                      [--set-rate N] [--duration-ms N] [--backend-delay-us N] [--json FILE]" << std::endl;
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    try {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+        LoadProfile profile;
+        std::string jsonPath;
+        int backendDelayUs = 0;
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (i + 1 >= args.size()) {
+                return usage();
+            }
+            const std::string& value = args[i + 1];
+            if (args[i] == "--socket") {
+                profile.socketPath = value;
+            } else if (args[i] == "--clients") {
+                profile.clients = std::stoul(value);
+            } else if (args[i] == "--subscribers") {
+                profile.subscribers = std::stoul(value);
+            } else if (args[i] == "--query-rate") {
+                profile.queryRate = std::stod(value);
+            } else if (args[i] == "--set-rate") {
+                profile.setRate = std::stod(value);
+            } else if (args[i] == "--duration-ms") {
+                profile.duration = std::chrono::milliseconds(std::stol(value));
+            } else if (args[i] == "--backend-delay-us") {
+                backendDelayUs = std::stoi(value);
+            } else if (args[i] == "--json") {
+                jsonPath = value;
+            } else {
+                return usage();
+            }
+            ++i;
+        }
+
+        std::unique_ptr<HyprpaperStandIn> backend;
+        std::unique_ptr<WallpaperDaemon> daemon;
+        if (profile.socketPath.empty()) {
+            const std::string prefix = "/tmp/caithe-loadgen-" + std::to_string(::getpid());
+            backend = std::make_unique<HyprpaperStandIn>(prefix + "-hyprpaper.sock");
+            if (!backend->isListening()) {
+                std::cerr << "Cannot listen on " << backend->getSocketPath() << std::endl;
+                return 1;
+            }
+            backend->setReplyDelay(std::chrono::microseconds(backendDelayUs));
+            daemon = std::make_unique<WallpaperDaemon>();
+            daemon->setBackendSocket(backend->getSocketPath());
+            if (!daemon->start(prefix + ".sock")) {
+                std::cerr << daemon->getLastError() << std::endl;
+                return 1;
+            }
+            profile.socketPath = daemon->getSocketPath();
+        }
+
+        LoadGenerator generator(profile);
+        const LoadReport report = generator.run();
+        std::cerr << report.describe();
+
+        if (jsonPath.empty()) {
+            std::cout << report.toJson() << std::endl;
+        } else {
+            std::ofstream(jsonPath) << report.toJson() << std::endl;
+        }
+        const bool clean = report.connectErrors == 0 && report.queries.errors == 0 && report.sets.errors == 0;
+        return clean ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Load generator failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
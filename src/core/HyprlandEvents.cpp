@@ -0,0 +1,176 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: HyprlandEvents.cpp
+ * Description: Implementation of the socket2 connection and line-oriented event parsing
+ */
+
+#include "HyprlandEvents.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+HyprlandEvents::HyprlandEvents()
+    : m_fd(-1)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+HyprlandEvents::~HyprlandEvents() {
+    disconnect();
+}
+
+bool HyprlandEvents::connect(const std::string& socketPath) {
+    disconnect();
+    clearError();
+
+    const std::string path = socketPath.empty() ? instanceSocketPath(".socket2.sock") : socketPath;
+    if (path.empty()) {
+        return setError(ErrorCode::NoInstance, "HYPRLAND_INSTANCE_SIGNATURE is not set; is Hyprland running?");
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return setError(ErrorCode::ConnectFailed, "Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const std::string reason = std::strerror(errno);
+        disconnect();
+        return setError(ErrorCode::ConnectFailed, "Cannot connect to " + path + ": " + reason);
+    }
+    return true;
+}
+
+void HyprlandEvents::disconnect() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_buffer.clear();
+}
+
+bool HyprlandEvents::isConnected() const {
+    return m_fd >= 0;
+}
+
+int HyprlandEvents::getFd() const {
+    return m_fd;
+}
+
+bool HyprlandEvents::poll(int timeoutMs, std::vector<HyprlandEvent>& events) {
+    if (m_fd < 0) {
+        return setError(ErrorCode::Disconnected, "Not connected");
+    }
+
+    pollfd descriptor{m_fd, POLLIN, 0};
+    const int ready = ::poll(&descriptor, 1, timeoutMs);
+    if (ready < 0 && errno != EINTR) {
+        const std::string reason = std::strerror(errno);
+        disconnect();
+        return setError(ErrorCode::Disconnected, "poll failed: " + reason);
+    }
+    if (ready <= 0) {
+        return true;
+    }
+
+    // Drain everything available so a burst costs one wakeup
+    char chunk[4096];
+    for (;;) {
+        const ssize_t count = ::recv(m_fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (count > 0) {
+            m_buffer.append(chunk, static_cast<size_t>(count));
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        const std::string reason = count == 0 ? "closed by Hyprland" : std::strerror(errno);
+        disconnect();
+        return setError(ErrorCode::Disconnected, "Event socket " + reason);
+    }
+
+    const auto received = std::chrono::steady_clock::now();
+    size_t start = 0;
+    for (size_t newline = m_buffer.find('\n'); newline != std::string::npos; newline = m_buffer.find('\n', start)) {
+        HyprlandEvent event;
+        if (parseLine(m_buffer.substr(start, newline - start), event)) {
+            event.received = received;
+            events.push_back(std::move(event));
+        }
+        start = newline + 1;
+    }
+    m_buffer.erase(0, start);
+    return true;
+}
+
+std::string HyprlandEvents::instanceSocketPath(const std::string& name) {
+    const char* signature = std::getenv("HYPRLAND_INSTANCE_SIGNATURE");
+    if (!signature || !*signature) {
+        return std::string();
+    }
+
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        const std::string path = std::string(runtime) + "/hypr/" + signature + "/" + name;
+        std::error_code error;
+        if (std::filesystem::exists(path, error)) {
+            return path;
+        }
+    }
+    return std::string("/tmp/hypr/") + signature + "/" + name;
+}
+
+bool HyprlandEvents::parseLine(const std::string& line, HyprlandEvent& event) {
+    const size_t separator = line.find(">>");
+    if (separator == std::string::npos || separator == 0) {
+        return false;
+    }
+    event.name = line.substr(0, separator);
+    event.data = line.substr(separator + 2);
+    return true;
+}
+
+std::vector<std::string> HyprlandEvents::splitData(const std::string& data, size_t fields) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (parts.size() + 1 < fields) {
+        const size_t comma = data.find(',', start);
+        if (comma == std::string::npos) {
+            break;
+        }
+        parts.push_back(data.substr(start, comma - start));
+        start = comma + 1;
+    }
+    parts.push_back(data.substr(start));
+    return parts;
+}
+
+std::string HyprlandEvents::getLastError() const {
+    return m_lastError;
+}
+
+HyprlandEvents::ErrorCode HyprlandEvents::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void HyprlandEvents::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool HyprlandEvents::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
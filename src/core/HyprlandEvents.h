@@ -0,0 +1,73 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: HyprlandEvents.h
+ * Description: Reader for Hyprland's socket2 event stream (workspace, focus and monitor events)
+ *
+ * Protocol:
+ * - Hyprland writes one "EVENT>>DATA\n" line per event to every client connected to
+ *   $XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/.socket2.sock (/tmp/hypr/... on
+ *   releases before 0.40)
+ * - Reads may end mid-line, so partial lines are buffered until their newline arrives
+ * - Each event is stamped when the read that completed it returns, which is the start
+ *   of the event-to-apply latency WorkspaceWallpapers reports
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct HyprlandEvent {
+    std::string name;       // "workspace", "focusedmon", "monitoradded", ...
+    std::string data;       // Everything after ">>"
+    std::chrono::steady_clock::time_point received;
+};
+
+class HyprlandEvents {
+public:
+    HyprlandEvents();
+    ~HyprlandEvents();
+
+    HyprlandEvents(const HyprlandEvents&) = delete;
+    HyprlandEvents& operator=(const HyprlandEvents&) = delete;
+
+    // Empty path selects the running instance's socket2
+    bool connect(const std::string& socketPath = "");
+    void disconnect();
+    bool isConnected() const;
+    int getFd() const;
+
+    // Wait up to timeoutMs (-1 blocks) for data and append every complete event.
+    // Returns false once the socket is closed or fails.
+    bool poll(int timeoutMs, std::vector<HyprlandEvent>& events);
+
+    // Path of a socket of the running Hyprland instance; empty when none is running
+    static std::string instanceSocketPath(const std::string& name);
+    static bool parseLine(const std::string& line, HyprlandEvent& event);
+    // Split event data into at most `fields` comma-separated parts; the last keeps any
+    // further commas (workspace names may contain them)
+    static std::vector<std::string> splitData(const std::string& data, size_t fields);
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        NoInstance = 1,
+        ConnectFailed = 2,
+        Disconnected = 3
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool setError(ErrorCode code, const std::string& message);
+
+    int m_fd;
+    std::string m_buffer;       // Bytes after the last complete line
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
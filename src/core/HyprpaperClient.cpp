@@ -0,0 +1,138 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: HyprpaperClient.cpp
+ * Description: Implementation of hyprpaper socket requests
+ */
+
+#include "HyprpaperClient.h"
+#include "HyprlandEvents.h"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+HyprpaperClient::HyprpaperClient()
+    : m_requests(0)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+HyprpaperClient::~HyprpaperClient() = default;
+
+void HyprpaperClient::setSocketPath(const std::string& path) {
+    m_socketPath = path;
+}
+
+const std::string& HyprpaperClient::getSocketPath() const {
+    return m_socketPath;
+}
+
+bool HyprpaperClient::preload(const std::string& path) {
+    std::string reply;
+    return request("preload " + path, reply);
+}
+
+bool HyprpaperClient::unload(const std::string& path) {
+    std::string reply;
+    return request("unload " + path, reply);
+}
+
+bool HyprpaperClient::assign(const std::string& monitor, const std::string& path) {
+    std::string reply;
+    return request("wallpaper " + monitor + "," + path, reply);
+}
+
+std::string HyprpaperClient::modePrefix(const std::string& mode) {
+    if (mode == "Center" || mode == "Scale") {
+        return "contain:";
+    }
+    if (mode == "Tile") {
+        return "tile:";
+    }
+    return "";
+}
+
+bool HyprpaperClient::request(const std::string& command, std::string& reply) {
+    clearError();
+    reply.clear();
+
+    const std::string path = m_socketPath.empty() ? HyprlandEvents::instanceSocketPath(".hyprpaper.sock") : m_socketPath;
+    if (path.empty()) {
+        return setError(ErrorCode::NoInstance, "HYPRLAND_INSTANCE_SIGNATURE is not set; is Hyprland running?");
+    }
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return setError(ErrorCode::ConnectFailed, "Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return setError(ErrorCode::ConnectFailed, "Cannot connect to hyprpaper at " + path + ": " + reason);
+    }
+    ++m_requests;
+
+    bool sent = true;
+    for (size_t offset = 0; offset < command.size() && sent;) {
+        const ssize_t count = ::send(fd, command.data() + offset, command.size() - offset, MSG_NOSIGNAL);
+        if (count > 0) {
+            offset += static_cast<size_t>(count);
+        } else if (count < 0 && errno != EINTR) {
+            sent = false;
+        }
+    }
+
+    // hyprpaper answers once and closes; stop at EOF, on timeout or when the reply is complete
+    char chunk[256];
+    pollfd descriptor{fd, POLLIN, 0};
+    while (sent && ::poll(&descriptor, 1, REPLY_TIMEOUT_MS) > 0) {
+        const ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (count <= 0) {
+            break;
+        }
+        reply.append(chunk, static_cast<size_t>(count));
+        if (reply == "ok") {
+            break;
+        }
+    }
+    ::close(fd);
+
+    if (!sent) {
+        return setError(ErrorCode::RequestFailed, "Failed to send '" + command + "' to hyprpaper");
+    }
+    if (reply != "ok") {
+        return setError(ErrorCode::RequestFailed, "hyprpaper rejected '" + command + "': " +
+                                                  (reply.empty() ? std::string("no reply") : reply));
+    }
+    return true;
+}
+
+uint64_t HyprpaperClient::getRequestCount() const {
+    return m_requests;
+}
+
+std::string HyprpaperClient::getLastError() const {
+    return m_lastError;
+}
+
+HyprpaperClient::ErrorCode HyprpaperClient::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void HyprpaperClient::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool HyprpaperClient::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
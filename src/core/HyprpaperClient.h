@@ -0,0 +1,63 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: HyprpaperClient.h
+ * Description: Direct IPC client for hyprpaper (preload, unload and wallpaper requests)
+ *
+ * Protocol:
+ * - hyprpaper listens on .hyprpaper.sock next to Hyprland's sockets; a client connects,
+ *   writes one request ("preload PATH", "wallpaper MONITOR,PATH", "unload PATH"), reads
+ *   the reply ("ok" or an error message) and the connection closes
+ * - This is exactly what `hyprctl hyprpaper ...` does, minus a fork/exec of hyprctl per
+ *   request, which dominates the cost of a wallpaper switch
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class HyprpaperClient {
+public:
+    static constexpr int REPLY_TIMEOUT_MS = 2000;   // Large preloads decode before replying
+
+    HyprpaperClient();
+    ~HyprpaperClient();
+
+    // Empty path selects the running instance's hyprpaper socket
+    void setSocketPath(const std::string& path);
+    const std::string& getSocketPath() const;
+
+    bool preload(const std::string& path);
+    bool unload(const std::string& path);
+    bool assign(const std::string& monitor, const std::string& path);
+    
+    // hyprpaper's fit prefix for a WallpaperMode name ("contain:", "tile:" or none)
+    static std::string modePrefix(const std::string& mode);
+
+    // Send one request; true when hyprpaper answers "ok"
+    bool request(const std::string& command, std::string& reply);
+
+    uint64_t getRequestCount() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        NoInstance = 1,
+        ConnectFailed = 2,
+        RequestFailed = 3
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool setError(ErrorCode code, const std::string& message);
+
+    std::string m_socketPath;
+    uint64_t m_requests;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
@@ -0,0 +1,198 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: OperationTrace.cpp
+ * Description: Implementation of trace recording and loading
+ */
+
+#include "OperationTrace.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const char TRACE_MAGIC[8] = {'C', 'A', 'I', 'T', 'H', 'E', 'T', 'R'};
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool getVarint(const std::string& data, size_t& offset, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && offset < data.size(); shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool getString(const std::string& data, size_t& offset, std::string& text) {
+    uint64_t length = 0;
+    if (!getVarint(data, offset, length) || length > data.size() - offset) {
+        return false;
+    }
+    text.assign(data, offset, static_cast<size_t>(length));
+    offset += static_cast<size_t>(length);
+    return true;
+}
+
+} // namespace
+
+OperationTrace::OperationTrace()
+    : m_fd(-1)
+    , m_recorded(0)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+OperationTrace::~OperationTrace() {
+    stopRecording();
+}
+
+bool OperationTrace::startRecording(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        return setError(ErrorCode::OpenFailed, "Cannot create trace " + path + ": " + std::strerror(errno));
+    }
+    std::string header(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header += static_cast<char>(FORMAT_VERSION);
+    if (::write(m_fd, header.data(), header.size()) != static_cast<ssize_t>(header.size())) {
+        ::close(m_fd);
+        m_fd = -1;
+        return setError(ErrorCode::WriteFailed, "Cannot write trace " + path + ": " + std::strerror(errno));
+    }
+    m_last = std::chrono::steady_clock::now();
+    m_recorded = 0;
+    return true;
+}
+
+void OperationTrace::stopRecording() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool OperationTrace::isRecording() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_fd >= 0;
+}
+
+void OperationTrace::record(TraceOp op, const std::string& target, const std::string& argument) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const auto delta = std::chrono::duration_cast<std::chrono::microseconds>(now - m_last);
+    m_last = now;
+
+    std::string record;
+    record.reserve(8 + target.size() + argument.size());
+    putVarint(record, static_cast<uint64_t>(delta.count()));
+    record += static_cast<char>(op);
+    putVarint(record, target.size());
+    record += target;
+    putVarint(record, argument.size());
+    record += argument;
+
+    // One write per record: O_APPEND keeps it contiguous and a crash cuts at most this one
+    if (::write(m_fd, record.data(), record.size()) != static_cast<ssize_t>(record.size())) {
+        setError(ErrorCode::WriteFailed, std::string("Trace write failed, recording stopped: ") + std::strerror(errno));
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    ++m_recorded;
+}
+
+uint64_t OperationTrace::getRecordedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_recorded;
+}
+
+bool OperationTrace::load(const std::string& path, std::vector<TraceEvent>& events) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    events.clear();
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return setError(ErrorCode::OpenFailed, "Cannot open trace " + path);
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(TRACE_MAGIC) + 1 || data.compare(0, sizeof(TRACE_MAGIC), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        return setError(ErrorCode::BadFormat, path + " is not a caithe trace");
+    }
+    if (static_cast<uint8_t>(data[sizeof(TRACE_MAGIC)]) != FORMAT_VERSION) {
+        return setError(ErrorCode::BadFormat, "Unsupported trace version in " + path);
+    }
+
+    size_t offset = sizeof(TRACE_MAGIC) + 1;
+    std::chrono::microseconds elapsed(0);
+    while (offset < data.size()) {
+        uint64_t delta = 0;
+        TraceEvent event;
+        if (!getVarint(data, offset, delta) || offset >= data.size()) {
+            break;      // Truncated by a crash mid-write
+        }
+        const uint8_t op = static_cast<uint8_t>(data[offset++]);
+        if (!getString(data, offset, event.target) || !getString(data, offset, event.argument)) {
+            break;
+        }
+        if (op >= OP_COUNT) {
+            events.clear();
+            return setError(ErrorCode::BadFormat, "Unknown operation " + std::to_string(op) + " in " + path);
+        }
+        elapsed += std::chrono::microseconds(delta);
+        event.offset = elapsed;
+        event.op = static_cast<TraceOp>(op);
+        events.push_back(std::move(event));
+    }
+    return true;
+}
+
+const char* OperationTrace::opName(TraceOp op) {
+    switch (op) {
+        case TraceOp::SetWallpaper: return "set";
+        case TraceOp::SetMode: return "mode";
+        case TraceOp::RefreshDisplays: return "refresh";
+        case TraceOp::WorkspaceEvent: return "workspace";
+    }
+    return "?";
+}
+
+std::string OperationTrace::getLastError() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+OperationTrace::ErrorCode OperationTrace::getLastErrorCode() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastErrorCode;
+}
+
+void OperationTrace::clearError() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool OperationTrace::setError(ErrorCode code, const std::string& message) {
+    m_lastErrorCode = code;
+    m_lastError = message;
+    return false;
+}
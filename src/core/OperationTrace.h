@@ -0,0 +1,89 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: OperationTrace.h
+ * Description: Compact on-disk trace of wallpaper operations for later replay
+ *
+ * Format:
+ * - An 8-byte magic ("CAITHETR") and a version byte, then one record per operation:
+ *   varint microseconds since the previous record, op byte, varint-length target and
+ *   varint-length argument. A slideshow tick costs about as many bytes as its path
+ * - Each record goes out with one append write, so a crash loses at most the record being
+ *   written; a truncated last record is ignored when loading
+ *
+ * Operations:
+ * - SetWallpaper:   target = monitor name, argument = image path
+ * - SetMode:        target = monitor name, argument = mode name (Stretch, Center, Tile, Scale)
+ * - RefreshDisplays: one record per display after a refresh; target = monitor name,
+ *                   argument = "WIDTHxHEIGHT"
+ * - WorkspaceEvent: a socket2 event; target = event name, argument = event data
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class TraceOp : uint8_t {
+    SetWallpaper = 0,
+    SetMode = 1,
+    RefreshDisplays = 2,
+    WorkspaceEvent = 3
+};
+
+struct TraceEvent {
+    std::chrono::microseconds offset{0};    // Since the start of the recording
+    TraceOp op = TraceOp::SetWallpaper;
+    std::string target;
+    std::string argument;
+};
+
+class OperationTrace {
+public:
+    static constexpr uint8_t FORMAT_VERSION = 1;
+    static constexpr size_t OP_COUNT = 4;
+
+    OperationTrace();
+    ~OperationTrace();
+
+    OperationTrace(const OperationTrace&) = delete;
+    OperationTrace& operator=(const OperationTrace&) = delete;
+
+    // Recording (thread safe); an existing file is replaced
+    bool startRecording(const std::string& path);
+    void stopRecording();
+    bool isRecording() const;
+    void record(TraceOp op, const std::string& target, const std::string& argument);
+    uint64_t getRecordedCount() const;
+
+    // Read a whole trace; offsets are rebuilt from the deltas
+    bool load(const std::string& path, std::vector<TraceEvent>& events);
+
+    static const char* opName(TraceOp op);
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        OpenFailed = 1,
+        WriteFailed = 2,
+        BadFormat = 3
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool setError(ErrorCode code, const std::string& message);
+
+    mutable std::mutex m_mutex;
+    int m_fd;
+    std::chrono::steady_clock::time_point m_last;
+    uint64_t m_recorded;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
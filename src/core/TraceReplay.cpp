@@ -0,0 +1,238 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TraceReplay.cpp
+ * Description: Implementation of trace replay, latency reporting and the hyprpaper stand-in
+ */
+
+#include "TraceReplay.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+double toMs(std::chrono::nanoseconds value) {
+    return std::chrono::duration<double, std::milli>(value).count();
+}
+
+} // namespace
+
+std::string ReplayReport::describe() const {
+    std::string text;
+    char line[256];
+    for (size_t i = 0; i < operations.size(); ++i) {
+        const OperationLatency& latency = operations[i];
+        if (latency.count == 0) {
+            continue;
+        }
+        std::snprintf(line, sizeof(line), "%-9s %6llu ops %4llu failed  p50 %8.3f ms  p90 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n",
+                      OperationTrace::opName(static_cast<TraceOp>(i)),
+                      static_cast<unsigned long long>(latency.count), static_cast<unsigned long long>(latency.failures),
+                      toMs(latency.p50), toMs(latency.p90), toMs(latency.p99), toMs(latency.max));
+        text += line;
+    }
+    std::snprintf(line, sizeof(line), "Replayed in %.1f ms, issued at most %.3f ms late\n", toMs(duration), toMs(maxLag));
+    text += line;
+    return text;
+}
+
+TraceReplayer::TraceReplayer() = default;
+
+TraceReplayer::~TraceReplayer() = default;
+
+void TraceReplayer::setHandler(TraceOp op, Handler handler) {
+    m_handlers[static_cast<size_t>(op)] = std::move(handler);
+}
+
+ReplayReport TraceReplayer::replay(const std::vector<TraceEvent>& events, double speed) {
+    ReplayReport report;
+    std::array<std::vector<std::chrono::nanoseconds>, OperationTrace::OP_COUNT> samples;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const TraceEvent& event : events) {
+        auto due = std::chrono::steady_clock::now();
+        if (speed > 0.0) {
+            due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::micro>(static_cast<double>(event.offset.count()) / speed));
+            std::this_thread::sleep_until(due);
+        }
+        const auto issued = std::chrono::steady_clock::now();
+        report.maxLag = std::max(report.maxLag, std::chrono::duration_cast<std::chrono::nanoseconds>(issued - due));
+
+        const size_t op = static_cast<size_t>(event.op);
+        const Handler& handler = m_handlers[op];
+        const bool ok = handler ? handler(event) : true;
+        samples[op].push_back(std::chrono::steady_clock::now() - due);
+        report.operations[op].failures += ok ? 0 : 1;
+    }
+
+    for (size_t op = 0; op < samples.size(); ++op) {
+        OperationLatency& latency = report.operations[op];
+        latency.count = samples[op].size();
+        latency.p50 = percentile(samples[op], 0.50);
+        latency.p90 = percentile(samples[op], 0.90);
+        latency.p99 = percentile(samples[op], 0.99);
+        latency.max = percentile(samples[op], 1.0);
+    }
+    report.duration = std::chrono::steady_clock::now() - start;
+    return report;
+}
+
+std::chrono::nanoseconds TraceReplayer::percentile(std::vector<std::chrono::nanoseconds>& samples, double fraction) {
+    if (samples.empty()) {
+        return std::chrono::nanoseconds(0);
+    }
+    // Nearest rank: the smallest sample with at least `fraction` of all samples at or below it
+    const size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(samples.size())));
+    const size_t index = std::min(samples.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+    return samples[index];
+}
+
+HyprpaperStandIn::HyprpaperStandIn(const std::string& socketPath)
+    : m_socketPath(socketPath)
+    , m_fd(-1)
+    , m_stop(false)
+    , m_delayUs(0)
+    , m_requestCount(0) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        return;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    ::unlink(socketPath.c_str());
+
+    m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        return;
+    }
+    if (::bind(m_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(m_fd, 64) != 0) {
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    m_thread = std::thread(&HyprpaperStandIn::serve, this);
+}
+
+HyprpaperStandIn::~HyprpaperStandIn() {
+    m_stop = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        ::unlink(m_socketPath.c_str());
+    }
+}
+
+bool HyprpaperStandIn::isListening() const {
+    return m_fd >= 0;
+}
+
+const std::string& HyprpaperStandIn::getSocketPath() const {
+    return m_socketPath;
+}
+
+void HyprpaperStandIn::setReplyDelay(std::chrono::microseconds delay) {
+    m_delayUs = delay.count();
+}
+
+uint64_t HyprpaperStandIn::getRequestCount() const {
+    return m_requestCount;
+}
+
+std::vector<std::string> HyprpaperStandIn::takeRequests() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> requests;
+    requests.swap(m_requests);
+    return requests;
+}
+
+void HyprpaperStandIn::serve() {
+    pollfd descriptor{m_fd, POLLIN, 0};
+    char buffer[4096];
+    while (!m_stop) {
+        if (::poll(&descriptor, 1, 20) <= 0) {
+            continue;
+        }
+        const int client = ::accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        const ssize_t count = ::recv(client, buffer, sizeof(buffer), 0);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_requests.emplace_back(buffer, count > 0 ? static_cast<size_t>(count) : 0);
+        }
+        ++m_requestCount;
+        const int64_t delay = m_delayUs;
+        if (delay > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(delay));
+        }
+        ::send(client, "ok", 2, MSG_NOSIGNAL);
+        ::close(client);
+    }
+}
+
+HyprpaperReplayTarget::HyprpaperReplayTarget(const std::string& socketPath) {
+    m_client.setSocketPath(socketPath);
+    m_workspaces.getClient().setSocketPath(socketPath);
+}
+
+void HyprpaperReplayTarget::setWorkspaceWallpaper(const std::string& workspace, const std::string& path) {
+    m_workspaces.setWallpaper(workspace, path);
+}
+
+void HyprpaperReplayTarget::install(TraceReplayer& replayer) {
+    replayer.setHandler(TraceOp::SetWallpaper, [this](const TraceEvent& event) { return setWallpaper(event); });
+    replayer.setHandler(TraceOp::SetMode, [this](const TraceEvent& event) { return setMode(event); });
+    replayer.setHandler(TraceOp::RefreshDisplays, [this](const TraceEvent& event) { return refreshDisplay(event); });
+    replayer.setHandler(TraceOp::WorkspaceEvent, [this](const TraceEvent& event) { return workspaceEvent(event); });
+}
+
+bool HyprpaperReplayTarget::setWallpaper(const TraceEvent& event) {
+    // hyprpaper keeps preloaded images, so only the first set of an image preloads it
+    if (m_preloaded.count(event.argument) == 0) {
+        if (!m_client.preload(event.argument)) {
+            return false;
+        }
+        m_preloaded.insert(event.argument);
+    }
+    m_assigned[event.target] = event.argument;
+    return m_client.assign(event.target, event.argument);
+}
+
+bool HyprpaperReplayTarget::setMode(const TraceEvent& event) {
+    const auto it = m_assigned.find(event.target);
+    if (it == m_assigned.end()) {
+        return true;    // Nothing shown on that monitor yet; the mode applies to the next set
+    }
+    return m_client.assign(event.target, HyprpaperClient::modePrefix(event.argument) + it->second);
+}
+
+bool HyprpaperReplayTarget::refreshDisplay(const TraceEvent& event) {
+    int width = 0;
+    int height = 0;
+    if (std::sscanf(event.argument.c_str(), "%dx%d", &width, &height) != 2) {
+        return false;
+    }
+    m_workspaces.setMonitor(event.target, width, height);
+    return true;
+}
+
+bool HyprpaperReplayTarget::workspaceEvent(const TraceEvent& event) {
+    HyprlandEvent hyprland;
+    hyprland.name = event.target;
+    hyprland.data = event.argument;
+    hyprland.received = std::chrono::steady_clock::now();
+    m_workspaces.clearError();
+    m_workspaces.handleEvent(hyprland);
+    return m_workspaces.getLastErrorCode() == WorkspaceWallpapers::ErrorCode::None;
+}
@@ -0,0 +1,123 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TraceReplay.h
+ * Description: Replays recorded operation traces and reports latency per operation type
+ *
+ * Strategy:
+ * - Events are issued on one thread at their recorded offsets divided by the speed
+ *   (speed 0 issues them back to back), so slideshow ticks, hotplug storms and rapid
+ *   scrubbing arrive with their real spacing or compressed
+ * - Latency runs from the time an event was due, not from when it was issued: when one
+ *   operation stalls, the ones queued behind it are charged the wait, as a user would be
+ * - Percentiles are nearest-rank over every sample of an operation type
+ * - HyprpaperReplayTarget sends what caithe sends to hyprpaper for each operation, and
+ *   HyprpaperStandIn answers like hyprpaper (optionally after a fixed delay), so a trace
+ *   replays without Hyprland
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "OperationTrace.h"
+#include "WorkspaceWallpapers.h"
+
+struct OperationLatency {
+    uint64_t count = 0;
+    uint64_t failures = 0;
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds max{0};
+};
+
+struct ReplayReport {
+    std::array<OperationLatency, OperationTrace::OP_COUNT> operations;
+    std::chrono::nanoseconds duration{0};
+    std::chrono::nanoseconds maxLag{0};     // Latest any event was issued past its due time
+
+    const OperationLatency& get(TraceOp op) const {
+        return operations[static_cast<size_t>(op)];
+    }
+    // One line per operation type that occurred
+    std::string describe() const;
+};
+
+class TraceReplayer {
+public:
+    // Returns false when the operation failed; failures are counted and still timed
+    using Handler = std::function<bool(const TraceEvent&)>;
+
+    TraceReplayer();
+    ~TraceReplayer();
+
+    void setHandler(TraceOp op, Handler handler);
+
+    // speed 1 = recorded pace, 4 = four times faster, 0 = back to back
+    ReplayReport replay(const std::vector<TraceEvent>& events, double speed);
+
+    static std::chrono::nanoseconds percentile(std::vector<std::chrono::nanoseconds>& samples, double fraction);
+
+private:
+    std::array<Handler, OperationTrace::OP_COUNT> m_handlers;
+};
+
+// Minimal hyprpaper: accepts one request per connection and answers "ok"
+class HyprpaperStandIn {
+public:
+    explicit HyprpaperStandIn(const std::string& socketPath);
+    ~HyprpaperStandIn();
+
+    HyprpaperStandIn(const HyprpaperStandIn&) = delete;
+    HyprpaperStandIn& operator=(const HyprpaperStandIn&) = delete;
+
+    bool isListening() const;
+    const std::string& getSocketPath() const;
+
+    // Time spent before each reply, standing in for hyprpaper's decode and upload
+    void setReplyDelay(std::chrono::microseconds delay);
+    uint64_t getRequestCount() const;
+    std::vector<std::string> takeRequests();
+
+private:
+    void serve();
+
+    std::string m_socketPath;
+    int m_fd;
+    std::atomic<bool> m_stop;
+    std::atomic<int64_t> m_delayUs;
+    std::atomic<uint64_t> m_requestCount;
+    std::mutex m_mutex;
+    std::vector<std::string> m_requests;
+    std::thread m_thread;
+};
+
+// Sends each traced operation to a hyprpaper socket the way caithe would
+class HyprpaperReplayTarget {
+public:
+    explicit HyprpaperReplayTarget(const std::string& socketPath);
+
+    // Workspace wallpapers from the configuration, for replayed workspace events
+    void setWorkspaceWallpaper(const std::string& workspace, const std::string& path);
+    void install(TraceReplayer& replayer);
+
+private:
+    bool setWallpaper(const TraceEvent& event);
+    bool setMode(const TraceEvent& event);
+    bool refreshDisplay(const TraceEvent& event);
+    bool workspaceEvent(const TraceEvent& event);
+
+    HyprpaperClient m_client;
+    WorkspaceWallpapers m_workspaces;
+    std::unordered_map<std::string, std::string> m_assigned;   // Monitor -> image
+    std::unordered_set<std::string> m_preloaded;
+};
@@ -6,12 +6,14 @@
  */
 
 #include "WallpaperManager.h"
+#include "../utils/Logger.h"
+#include "../utils/MetadataCache.h"
 #include <iostream>
-#include <fstream>
 #include <filesystem>
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cmath>
 
@@ -38,14 +40,15 @@ bool WallpaperManager::setWallpaper(std::string path, int displayId) {
         return false;
     }
     
-    if (!isValidImageFile(path)) {
+    if (!hasSupportedFormat(path)) {
         m_lastError = "Invalid image file: " + path;
         m_lastErrorCode = ErrorCode::UnsupportedFormat;
         return false;
     }
     
-    // Check if file actually exists
-    if (!std::filesystem::exists(path)) {
+    // Check if file actually exists; the shared metadata cache answers repeat calls
+    // for the same path without a syscall until the file changes
+    if (!MetadataCache::instance().exists(path)) {
         m_lastError = "File not found: " + path;
         m_lastErrorCode = ErrorCode::FileNotFound;
         return false;
@@ -57,65 +60,18 @@ bool WallpaperManager::setWallpaper(std::string path, int displayId) {
     info.displayId = displayId;
     info.mode = WallpaperMode::Scale; // Default mode
     
-    // Get actual image dimensions using  scaling calculations
-    // Read image file header to extract real dimensions
+    // Read real dimensions from the file header; the probe reports them after EXIF
+    // orientation so portrait photos stored sideways get the right aspect for layout
     info.width = 1920;  // Default fallback
     info.height = 1080; // Default fallback
-    
-    // Attempt to read actual image dimensions from file header
-    std::ifstream file(info.path, std::ios::binary);
-    if (file.is_open()) {
-        // Read PNG header (8 bytes) and IHDR chunk for dimensions
-        char header[8];
-        file.read(header, 8);
-        
-        if (std::string(header, 8) == "\x89PNG\r\n\x1a\n") {
-            // PNG format - read IHDR chunk
-            file.seekg(8);
-            char chunkLength[4], chunkType[4], widthBytes[4], heightBytes[4];
-            file.read(chunkLength, 4);
-            file.read(chunkType, 4);
-            
-            if (std::string(chunkType, 4) == "IHDR") {
-                file.read(widthBytes, 4);
-                file.read(heightBytes, 4);
-                
-                // Convert big-endian bytes to integers
-                info.width = (widthBytes[0] << 24) | (widthBytes[1] << 16) | (widthBytes[2] << 8) | widthBytes[3];
-                info.height = (heightBytes[0] << 24) | (heightBytes[1] << 16) | (heightBytes[2] << 8) | heightBytes[3];
-            }
-        } else {
-            // Try JPEG format
-            file.seekg(0);
-            char jpegHeader[2];
-            file.read(jpegHeader, 2);
-            
-            if (jpegHeader[0] == (char)0xFF && jpegHeader[1] == (char)0xD8) {
-                // JPEG format - scan for SOF markers
-                file.seekg(2);
-                while (file.good()) {
-                    char marker[2];
-                    file.read(marker, 2);
-                    
-                    if (marker[0] == (char)0xFF && (marker[1] >= (char)0xC0 && marker[1] <= (char)0xCF)) {
-                        file.seekg(3, std::ios::cur); // Skip length
-                        char heightBytes[2], widthBytes[2];
-                        file.read(heightBytes, 2);
-                        file.read(widthBytes, 2);
-                        
-                        info.height = (heightBytes[0] << 8) | heightBytes[1];
-                        info.width = (widthBytes[0] << 8) | widthBytes[1];
-                        break;
-                    } else if (marker[0] == (char)0xFF) {
-                        char lengthBytes[2];
-                        file.read(lengthBytes, 2);
-                        int length = (lengthBytes[0] << 8) | lengthBytes[1];
-                        file.seekg(length - 2, std::ios::cur);
-                    }
-                }
-            }
-        }
-        file.close();
+    info.orientation = ImageOrientation::Normal;
+
+    ImageProbe probe;
+    ImageHeader header;
+    if (probe.probeFile(info.path, header)) {
+        info.width = header.displayWidth();
+        info.height = header.displayHeight();
+        info.orientation = header.orientation;
     }
     
     // Extract file extension and convert to lowercase
@@ -259,11 +215,11 @@ bool WallpaperManager::isValidImageFile(const std::string& path) const {
         return false;
     }
     
-    // Check if file exists
-    if (!std::filesystem::exists(path)) {
-        return false;
-    }
-    
+    // Extension first: it needs no syscall
+    return hasSupportedFormat(path) && MetadataCache::instance().exists(path);
+}
+
+bool WallpaperManager::hasSupportedFormat(const std::string& path) {
     // Check file extension
     std::filesystem::path filePath(path);
     std::string extension = filePath.extension().string();
@@ -284,6 +240,7 @@ bool WallpaperManager::applyToHyprland(int displayId) {
     }
     
     const auto& info = it->second;
+    const auto start = std::chrono::steady_clock::now();
     
     // First, preload the image
     std::string preloadCommand = "hyprctl hyprpaper preload " + info.path;
@@ -303,6 +260,8 @@ bool WallpaperManager::applyToHyprland(int displayId) {
         return false;
     }
     
+    CAITHE_LOG_DEBUG("Applied {} to display {} in {} ms", info.path, displayId,
+                     std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     return true;
 }
 
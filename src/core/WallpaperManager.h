@@ -16,6 +16,7 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include "../imaging/ImageProbe.h"
 
 // Forward declarations
 struct Display;
@@ -31,8 +32,9 @@ struct WallpaperInfo {
     std::string path;
     WallpaperMode mode;
     int displayId;
-    int width;
+    int width;           // Displayed size, after EXIF orientation
     int height;
+    ImageOrientation orientation;  // Applied by resampling/pre-rendering
     std::string format;  // PNG, JPG, etc.
 };
 
@@ -90,6 +92,7 @@ public:
 private:
     // Internal helper methods
     bool validateImageFile(const std::string& path) const;
+    static bool hasSupportedFormat(const std::string& path);
     std::string createHyprlandCommand(const std::string& path, int displayId, WallpaperMode mode) const;
     std::string getHyprlandDisplayName(int displayId) const;
     
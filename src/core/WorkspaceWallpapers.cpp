@@ -0,0 +1,488 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: WorkspaceWallpapers.cpp
+ * Description: Implementation of workspace switching, pre-rendering and hyprpaper residency
+ */
+
+#include "WorkspaceWallpapers.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include "../imaging/ImageDecoder.h"
+#include "../imaging/ImageProbe.h"
+#include "../imaging/PngEncoder.h"
+#include "../imaging/Resampler.h"
+#include "../utils/TaskScheduler.h"
+#include "../utils/Xxh64.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* DEFAULT_WORKSPACE = "*";     // Wallpaper for workspaces without their own
+constexpr size_t BYTES_PER_PIXEL = 4;              // hyprpaper keeps images as ARGB32 surfaces
+
+int64_t modifiedTime(const std::string& path) {
+    std::error_code error;
+    const auto modified = fs::last_write_time(path, error);
+    return error ? 0 : static_cast<int64_t>(modified.time_since_epoch().count());
+}
+
+std::string defaultCacheDirectory() {
+    const char* cache = std::getenv("XDG_CACHE_HOME");
+    if (cache && *cache) {
+        return std::string(cache) + "/caithe/prerender";
+    }
+    const char* home = std::getenv("HOME");
+    return std::string(home ? home : "/tmp") + "/.cache/caithe/prerender";
+}
+
+// Decode, cover-fit with orientation applied and write as an uncompressed PNG
+bool renderCover(const std::string& source, int width, int height, const std::string& target, std::string& error) {
+    ImageProbe probe;
+    ImageHeader header;
+    const ImageOrientation orientation = probe.probeFile(source, header) ? header.orientation : ImageOrientation::Normal;
+
+    ImageDecoder decoder;
+    ImageBuffer image;
+    if (!decoder.decodeFile(source, image, 3)) {
+        error = decoder.getLastError();
+        return false;
+    }
+
+    // Largest centred region with the monitor's aspect ratio, in displayed coordinates
+    const bool swapsAxes = orientationSwapsAxes(orientation);
+    const double displayWidth = swapsAxes ? image.height : image.width;
+    const double displayHeight = swapsAxes ? image.width : image.height;
+    const double scale = std::max(width / displayWidth, height / displayHeight);
+    ResampleRegion region;
+    region.width = std::min(displayWidth, width / scale);
+    region.height = std::min(displayHeight, height / scale);
+    region.x = (displayWidth - region.width) / 2.0;
+    region.y = (displayHeight - region.height) / 2.0;
+
+    Resampler resampler;
+    ImageBuffer rendered;
+    if (!resampler.resampleRegion(image, orientation, region, rendered, width, height)) {
+        error = resampler.getLastError();
+        return false;
+    }
+    PngEncoder encoder;
+    if (!encoder.writeFile(rendered, target)) {
+        error = encoder.getLastError();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+WorkspaceWallpapers::WorkspaceWallpapers()
+    : m_renderQueue(std::make_shared<RenderQueue>())
+    , m_budget(DEFAULT_MEMORY_BUDGET)
+    , m_cacheDirectory(defaultCacheDirectory())
+    , m_clock(0)
+    , m_needsPrewarm(false)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+WorkspaceWallpapers::~WorkspaceWallpapers() = default;
+
+void WorkspaceWallpapers::setWallpaper(const std::string& workspace, const std::string& path) {
+    m_wallpapers[workspace] = path;
+    m_needsPrewarm = true;
+}
+
+void WorkspaceWallpapers::clearWallpapers() {
+    m_wallpapers.clear();
+}
+
+void WorkspaceWallpapers::setMemoryBudget(size_t bytes) {
+    m_budget = bytes;
+}
+
+void WorkspaceWallpapers::setCacheDirectory(const std::string& directory) {
+    m_cacheDirectory = directory;
+    m_renders.clear();
+    // Renders still queued write to the old directory; their results are dropped
+    m_renderQueue = std::make_shared<RenderQueue>();
+    m_rendering.clear();
+    m_failed.clear();
+    m_needsPrewarm = true;
+}
+
+void WorkspaceWallpapers::setContentKeyResolver(ContentKeyResolver resolver) {
+    m_contentKeys = std::move(resolver);
+    m_needsPrewarm = true;
+}
+
+HyprpaperClient& WorkspaceWallpapers::getClient() {
+    return m_client;
+}
+
+void WorkspaceWallpapers::setMonitor(const std::string& name, int width, int height, const std::string& workspace) {
+    Monitor& monitor = m_monitors[name];
+    if (monitor.width != width || monitor.height != height) {
+        monitor.assigned.clear();
+        m_needsPrewarm = true;
+    }
+    monitor.width = width;
+    monitor.height = height;
+    if (!workspace.empty()) {
+        monitor.workspace = workspace;
+        m_lastMonitor[workspace] = name;
+    }
+    if (m_focused.empty()) {
+        m_focused = name;
+    }
+}
+
+void WorkspaceWallpapers::removeMonitor(const std::string& name) {
+    m_monitors.erase(name);
+    if (m_focused == name) {
+        m_focused.clear();
+    }
+}
+
+void WorkspaceWallpapers::setFocusedMonitor(const std::string& name) {
+    m_focused = name;
+}
+
+bool WorkspaceWallpapers::prewarm(TaskScheduler& scheduler) {
+    clearError();
+    bool success = collectRenders();
+
+    // Size each workspace for the monitor it was last seen on, else the focused one
+    auto monitorFor = [this](const std::string& workspace) -> const Monitor* {
+        auto last = m_lastMonitor.find(workspace);
+        if (last != m_lastMonitor.end() && m_monitors.count(last->second)) {
+            return &m_monitors.at(last->second);
+        }
+        if (m_monitors.count(m_focused)) {
+            return &m_monitors.at(m_focused);
+        }
+        return nullptr;
+    };
+
+    for (const auto& [workspace, source] : m_wallpapers) {
+        const Monitor* monitor = monitorFor(workspace);
+        if (!monitor || monitor->width <= 0 || monitor->height <= 0) {
+            continue;
+        }
+        const std::string contentKey = contentKeyOf(source);
+        const std::string key = renderKey(source, contentKey, monitor->width, monitor->height);
+        if (m_renders.count(key) || m_rendering.count(key) || renderFailed(key, source, contentKey)) {
+            continue;
+        }
+        const std::string target =
+            m_cacheDirectory + "/" + prerenderName(source, monitor->width, monitor->height, contentKey);
+        std::error_code error;
+        if (fs::exists(target, error)) {
+            m_renders[key] = target;
+            continue;
+        }
+        if (m_rendering.empty()) {
+            fs::create_directories(m_cacheDirectory, error);
+        }
+
+        // Rendered off the caller's thread; the result waits in the queue for the next call
+        RenderResult job{key, source, target, sourceVersion(source, contentKey), std::string()};
+        const int width = monitor->width;
+        const int height = monitor->height;
+        scheduler.submit(IoClass::Background, [queue = m_renderQueue, job, width, height]() mutable {
+            renderCover(job.source, width, height, job.target, job.error);
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->finished.push_back(std::move(job));
+        });
+        m_rendering.insert(key);
+    }
+
+    // Preload once every render has landed, so an original is never loaded in its place
+    if (!m_rendering.empty()) {
+        m_needsPrewarm = true;
+        return success;
+    }
+
+    // Preload in priority order: on screen, then most recently visited, then by name
+    std::vector<std::string> order;
+    for (const auto& entry : m_wallpapers) {
+        order.push_back(entry.first);
+    }
+    auto onScreen = [this](const std::string& workspace) {
+        return std::any_of(m_monitors.begin(), m_monitors.end(),
+                           [&workspace](const auto& monitor) { return monitor.second.workspace == workspace; });
+    };
+    auto visit = [this](const std::string& workspace) {
+        auto it = m_lastVisit.find(workspace);
+        return it != m_lastVisit.end() ? it->second : 0;
+    };
+    std::stable_sort(order.begin(), order.end(), [&](const std::string& a, const std::string& b) {
+        const bool screenA = onScreen(a);
+        const bool screenB = onScreen(b);
+        return screenA != screenB ? screenA : visit(a) > visit(b);
+    });
+
+    m_needsPrewarm = false;
+    for (const std::string& workspace : order) {
+        const Monitor* monitor = monitorFor(workspace);
+        if (!monitor) {
+            continue;
+        }
+        const std::string image = imageFor(workspace, *monitor);
+        if (image.empty() || m_preloaded.count(image) || ensurePreloaded(image, residentBytes(image), false)) {
+            continue;
+        }
+        if (m_lastErrorCode == ErrorCode::HyprpaperFailed) {
+            return false;
+        }
+        if (m_prefetcher.prefetch(image)) {
+            ++m_stats.prefetches;
+        }
+    }
+    return success;
+}
+
+bool WorkspaceWallpapers::needsPrewarm() const {
+    return m_needsPrewarm;
+}
+
+size_t WorkspaceWallpapers::getPendingRenders() const {
+    return m_rendering.size();
+}
+
+bool WorkspaceWallpapers::handleEvent(const HyprlandEvent& event) {
+    if (event.name == "workspace") {
+        return !m_focused.empty() && showWorkspace(m_focused, event.data, event.received);
+    }
+    if (event.name == "focusedmon") {
+        const std::vector<std::string> fields = HyprlandEvents::splitData(event.data, 2);
+        if (fields.size() != 2) {
+            return false;
+        }
+        m_focused = fields[0];
+        return showWorkspace(fields[0], fields[1], event.received);
+    }
+    if (event.name == "monitorremoved") {
+        removeMonitor(event.data);
+    }
+    return false;
+}
+
+std::string WorkspaceWallpapers::getAssigned(const std::string& monitor) const {
+    auto it = m_monitors.find(monitor);
+    return it != m_monitors.end() ? it->second.assigned : std::string();
+}
+
+std::string WorkspaceWallpapers::getPrerendered(const std::string& source, int width, int height) const {
+    auto it = m_renders.find(renderKey(source, contentKeyOf(source), width, height));
+    return it != m_renders.end() ? it->second : std::string();
+}
+
+bool WorkspaceWallpapers::isPreloaded(const std::string& path) const {
+    return m_preloaded.count(path) != 0;
+}
+
+const WorkspaceSwitchStats& WorkspaceWallpapers::getStats() const {
+    return m_stats;
+}
+
+std::string WorkspaceWallpapers::prerenderName(const std::string& source, int width, int height,
+                                               const std::string& contentKey) {
+    Xxh64 hash;
+    if (!contentKey.empty()) {
+        hash.update(contentKey.data(), contentKey.size());
+    } else {
+        std::error_code error;
+        const uintmax_t size = fs::file_size(source, error);
+        const auto modified = fs::last_write_time(source, error).time_since_epoch().count();
+        hash.update(source.data(), source.size());
+        hash.update(&size, sizeof(size));
+        hash.update(&modified, sizeof(modified));
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%dx%d.png", static_cast<unsigned long long>(hash.digest()), width, height);
+    return name;
+}
+
+bool WorkspaceWallpapers::showWorkspace(const std::string& name, const std::string& workspace,
+                                        std::chrono::steady_clock::time_point received) {
+    auto it = m_monitors.find(name);
+    if (it == m_monitors.end()) {
+        return false;
+    }
+    Monitor& monitor = it->second;
+    if (monitor.workspace != workspace) {
+        monitor.workspace = workspace;
+        ++m_stats.switches;
+    }
+    m_lastMonitor[workspace] = name;
+    m_lastVisit[workspace] = ++m_clock;
+
+    const std::string image = imageFor(workspace, monitor);
+    if (image.empty() || image == monitor.assigned) {
+        return false;
+    }
+
+    if (m_preloaded.count(image)) {
+        ++m_stats.preloadHits;
+    } else {
+        ++m_stats.preloadMisses;
+    }
+    if (!ensurePreloaded(image, residentBytes(image), true)) {
+        return false;
+    }
+    if (!m_client.assign(name, image)) {
+        return setError(ErrorCode::HyprpaperFailed, m_client.getLastError());
+    }
+    monitor.assigned = image;
+    ++m_stats.assignments;
+
+    if (received != std::chrono::steady_clock::time_point()) {
+        const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - received);
+        m_stats.lastLatency = latency;
+        m_stats.maxLatency = std::max(m_stats.maxLatency, latency);
+        m_stats.totalLatency += latency;
+    }
+    return true;
+}
+
+std::string WorkspaceWallpapers::imageFor(const std::string& workspace, const Monitor& monitor) {
+    auto it = m_wallpapers.find(workspace);
+    if (it == m_wallpapers.end()) {
+        it = m_wallpapers.find(DEFAULT_WORKSPACE);
+        if (it == m_wallpapers.end()) {
+            return std::string();
+        }
+    }
+    const std::string contentKey = contentKeyOf(it->second);
+    const std::string key = renderKey(it->second, contentKey, monitor.width, monitor.height);
+    auto render = m_renders.find(key);
+    if (render != m_renders.end()) {
+        return render->second;
+    }
+    if (!renderFailed(key, it->second, contentKey)) {
+        m_needsPrewarm = true;
+    }
+    return it->second;
+}
+
+bool WorkspaceWallpapers::ensurePreloaded(const std::string& path, size_t bytes, bool required) {
+    auto it = m_preloaded.find(path);
+    if (it != m_preloaded.end()) {
+        it->second.lastUsed = ++m_clock;
+        return true;
+    }
+
+    if (m_stats.preloadedBytes + bytes > m_budget) {
+        if (!required) {
+            return false;
+        }
+        // Unload least recently used images that no monitor shows until it fits
+        while (m_stats.preloadedBytes + bytes > m_budget) {
+            auto victim = m_preloaded.end();
+            for (auto candidate = m_preloaded.begin(); candidate != m_preloaded.end(); ++candidate) {
+                if (!isOnScreen(candidate->first) &&
+                    (victim == m_preloaded.end() || candidate->second.lastUsed < victim->second.lastUsed)) {
+                    victim = candidate;
+                }
+            }
+            if (victim == m_preloaded.end()) {
+                break;
+            }
+            m_client.unload(victim->first);
+            m_stats.preloadedBytes -= victim->second.bytes;
+            m_preloaded.erase(victim);
+        }
+    }
+
+    if (!m_client.preload(path)) {
+        return setError(ErrorCode::HyprpaperFailed, m_client.getLastError());
+    }
+    m_preloaded[path] = Preloaded{bytes, ++m_clock};
+    m_stats.preloadedBytes += bytes;
+    return true;
+}
+
+bool WorkspaceWallpapers::isOnScreen(const std::string& path) const {
+    return std::any_of(m_monitors.begin(), m_monitors.end(),
+                       [&path](const auto& monitor) { return monitor.second.assigned == path; });
+}
+
+bool WorkspaceWallpapers::collectRenders() {
+    std::vector<RenderResult> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_renderQueue->mutex);
+        finished.swap(m_renderQueue->finished);
+    }
+
+    bool success = true;
+    for (const RenderResult& result : finished) {
+        m_rendering.erase(result.key);
+        if (result.error.empty()) {
+            m_renders[result.key] = result.target;
+            ++m_stats.renders;
+        } else {
+            m_failed[result.key] = result.modified;
+            success = setError(ErrorCode::RenderFailed, "Cannot pre-render " + result.source + ": " + result.error);
+        }
+    }
+    return success;
+}
+
+bool WorkspaceWallpapers::renderFailed(const std::string& key, const std::string& source,
+                                       const std::string& contentKey) {
+    auto it = m_failed.find(key);
+    if (it == m_failed.end()) {
+        return false;
+    }
+    if (it->second == sourceVersion(source, contentKey)) {
+        return true;
+    }
+    m_failed.erase(it);     // The source changed since; worth another attempt
+    return false;
+}
+
+size_t WorkspaceWallpapers::residentBytes(const std::string& path) {
+    ImageProbe probe;
+    ImageHeader header;
+    if (!probe.probeFile(path, header)) {
+        return 0;
+    }
+    return static_cast<size_t>(header.displayWidth()) * static_cast<size_t>(header.displayHeight()) * BYTES_PER_PIXEL;
+}
+
+std::string WorkspaceWallpapers::contentKeyOf(const std::string& source) const {
+    return m_contentKeys ? m_contentKeys(source) : std::string();
+}
+
+std::string WorkspaceWallpapers::renderKey(const std::string& source, const std::string& contentKey, int width,
+                                           int height) {
+    return (contentKey.empty() ? source : contentKey) + '\n' + std::to_string(width) + 'x' + std::to_string(height);
+}
+
+int64_t WorkspaceWallpapers::sourceVersion(const std::string& source, const std::string& contentKey) {
+    return contentKey.empty() ? modifiedTime(source) : 0;
+}
+
+std::string WorkspaceWallpapers::getLastError() const {
+    return m_lastError;
+}
+
+WorkspaceWallpapers::ErrorCode WorkspaceWallpapers::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void WorkspaceWallpapers::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool WorkspaceWallpapers::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
@@ -0,0 +1,195 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: WorkspaceWallpapers.h
+ * Description: Per-workspace wallpapers, pre-rendered and preloaded so a switch is one request
+ *
+ * Strategy:
+ * - Every configured workspace wallpaper is pre-rendered once at the size of the monitor
+ *   that shows the workspace (cover fit, EXIF orientation applied) into a cache of
+ *   uncompressed PNGs, so hyprpaper loads a screen-sized image instead of decoding and
+ *   scaling the original
+ * - Pre-renders are preloaded into hyprpaper while their decoded size (w * h * 4) fits
+ *   the memory budget: workspaces on screen first, then the most recently visited. When a
+ *   switch needs an image that is not resident, least recently used images that are not
+ *   on screen are unloaded to make room
+ * - Pre-renders that do not fit the budget are prefetched into the page cache instead, so
+ *   the preload a later switch issues reads memory rather than disk
+ * - Renders run as Background tasks and prewarm() never waits for them: each call collects
+ *   the ones that finished and queues what is missing, so a caller holding a lock is never
+ *   stuck behind a decode, or behind a power policy that holds Background work back
+ * - With a content-key resolver (LibraryIndex::getContentKey) renders are keyed by content,
+ *   so workspaces showing copies of one image share a single pre-render and preload;
+ *   sources the resolver does not know are keyed by path, size and mtime
+ * - A render that fails is not retried, and does not re-arm needsPrewarm(), until the
+ *   source's content key or mtime changes; switches show the original meanwhile
+ * - A socket2 `workspace` event (the focused monitor now shows a workspace) or
+ *   `focusedmon` event (monitor, workspace) issues at most one `wallpaper` request, and
+ *   none when the monitor already shows that image; the duplicate events Hyprland sends
+ *   for one switch therefore cost nothing
+ * - Latency runs from the read that delivered the event to hyprpaper's reply
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "HyprlandEvents.h"
+#include "HyprpaperClient.h"
+#include "../utils/PagePrefetcher.h"
+
+class TaskScheduler;
+
+struct WorkspaceSwitchStats {
+    uint64_t switches = 0;          // Monitor changed workspace
+    uint64_t assignments = 0;       // wallpaper requests sent
+    uint64_t preloadHits = 0;       // Switch found its image resident
+    uint64_t preloadMisses = 0;     // Switch had to preload first
+    uint64_t renders = 0;           // Pre-renders written
+    uint64_t prefetches = 0;        // Over-budget images handed to the page cache
+    size_t preloadedBytes = 0;      // Estimated hyprpaper memory in use
+    std::chrono::nanoseconds lastLatency{0};
+    std::chrono::nanoseconds maxLatency{0};
+    std::chrono::nanoseconds totalLatency{0};   // Over `assignments`
+
+    std::chrono::nanoseconds meanLatency() const {
+        return assignments ? totalLatency / static_cast<int64_t>(assignments) : std::chrono::nanoseconds(0);
+    }
+};
+
+class WorkspaceWallpapers {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+    // Content key of a source image, empty when unknown; called on the caller's thread
+    using ContentKeyResolver = std::function<std::string(const std::string& source)>;
+
+    WorkspaceWallpapers();
+    ~WorkspaceWallpapers();
+
+    // Configuration
+    void setWallpaper(const std::string& workspace, const std::string& path);
+    void clearWallpapers();
+    void setMemoryBudget(size_t bytes);
+    void setCacheDirectory(const std::string& directory);
+    // Renders are looked up again under the new keys on the next prewarm()
+    void setContentKeyResolver(ContentKeyResolver resolver);
+    HyprpaperClient& getClient();
+
+    // Monitor layout; the workspace shown is optional until the first event names it
+    void setMonitor(const std::string& name, int width, int height, const std::string& workspace = "");
+    void removeMonitor(const std::string& name);
+    void setFocusedMonitor(const std::string& name);
+
+    // Collect finished pre-renders, queue missing ones on `scheduler` and, once none are
+    // pending, preload within budget. Never blocks; needsPrewarm() stays true until done
+    bool prewarm(TaskScheduler& scheduler);
+    // A switch showed an image that was not pre-rendered for its monitor, or renders are pending
+    bool needsPrewarm() const;
+    // Renders queued by prewarm() whose result it has not collected yet
+    size_t getPendingRenders() const;
+
+    // Apply one socket2 event; true when a wallpaper request was sent
+    bool handleEvent(const HyprlandEvent& event);
+
+    // Image last assigned to a monitor, pre-render or original
+    std::string getAssigned(const std::string& monitor) const;
+    // Pre-render of `source` for a monitor size, or empty if not rendered yet
+    std::string getPrerendered(const std::string& source, int width, int height) const;
+    bool isPreloaded(const std::string& path) const;
+    const WorkspaceSwitchStats& getStats() const;
+
+    // Cache file name for a source at a size: hash of the content key when there is one,
+    // else of path, file size and mtime
+    static std::string prerenderName(const std::string& source, int width, int height,
+                                     const std::string& contentKey = std::string());
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        RenderFailed = 1,
+        HyprpaperFailed = 2
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    struct Monitor {
+        int width = 0;
+        int height = 0;
+        std::string workspace;
+        std::string assigned;
+    };
+
+    struct Preloaded {
+        size_t bytes = 0;
+        uint64_t lastUsed = 0;
+    };
+
+    struct RenderResult {
+        std::string key;
+        std::string source;
+        std::string target;
+        int64_t modified = 0;       // sourceVersion() when queued
+        std::string error;          // Empty on success
+    };
+
+    // Shared with queued render tasks, which may finish after this object is gone
+    struct RenderQueue {
+        std::mutex mutex;
+        std::vector<RenderResult> finished;
+    };
+
+    bool showWorkspace(const std::string& monitor, const std::string& workspace,
+                       std::chrono::steady_clock::time_point received);
+    // Image for a workspace on a monitor: pre-render when available, else the original
+    std::string imageFor(const std::string& workspace, const Monitor& monitor);
+    // Make `path` resident, evicting unused images; `required` preloads even over budget
+    bool ensurePreloaded(const std::string& path, size_t bytes, bool required);
+    bool isOnScreen(const std::string& path) const;
+    // Move finished renders into m_renders; false if any failed
+    bool collectRenders();
+    // Whether the render for `key` failed and `source` has not changed since
+    bool renderFailed(const std::string& key, const std::string& source, const std::string& contentKey);
+    std::string contentKeyOf(const std::string& source) const;
+    static size_t residentBytes(const std::string& path);
+    static std::string renderKey(const std::string& source, const std::string& contentKey, int width, int height);
+    // A content key changes with the bytes; only sources without one go by mtime
+    static int64_t sourceVersion(const std::string& source, const std::string& contentKey);
+    bool setError(ErrorCode code, const std::string& message);
+
+    std::map<std::string, std::string> m_wallpapers;            // Workspace -> source image
+    std::unordered_map<std::string, Monitor> m_monitors;
+    std::unordered_map<std::string, std::string> m_lastMonitor; // Workspace -> monitor last showing it
+    std::unordered_map<std::string, uint64_t> m_lastVisit;      // Workspace -> visit clock
+    std::string m_focused;
+
+    std::unordered_map<std::string, std::string> m_renders;     // renderKey -> cache file
+    std::unordered_set<std::string> m_rendering;                // renderKeys queued, not collected
+    std::unordered_map<std::string, int64_t> m_failed;          // renderKey -> source mtime it failed at
+    std::shared_ptr<RenderQueue> m_renderQueue;
+    std::unordered_map<std::string, Preloaded> m_preloaded;     // Path -> hyprpaper residency
+    size_t m_budget;
+    std::string m_cacheDirectory;
+    ContentKeyResolver m_contentKeys;
+    uint64_t m_clock;
+    bool m_needsPrewarm;
+
+    HyprpaperClient m_client;
+    PagePrefetcher m_prefetcher;
+    WorkspaceSwitchStats m_stats;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
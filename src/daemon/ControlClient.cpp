@@ -0,0 +1,228 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ControlClient.cpp
+ * Description: Implementation of the control socket client
+ */
+
+#include "ControlClient.h"
+#include "StateSegment.h"
+#include "WallpaperDaemon.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+ControlClient::ControlClient()
+    : m_fd(-1)
+    , m_lastDescriptor(-1)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+ControlClient::~ControlClient() {
+    disconnect();
+}
+
+bool ControlClient::connect(const std::string& socketPath) {
+    disconnect();
+    clearError();
+    const std::string path = socketPath.empty() ? WallpaperDaemon::defaultSocketPath() : socketPath;
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return setError(ErrorCode::ConnectFailed, "Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const std::string reason = std::strerror(errno);
+        disconnect();
+        return setError(ErrorCode::ConnectFailed, "Cannot connect to " + path + ": " + reason);
+    }
+    return true;
+}
+
+void ControlClient::disconnect() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_buffer.clear();
+    for (const auto& [event, fd] : m_events) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    m_events.clear();
+    for (const int fd : m_descriptors) {
+        ::close(fd);
+    }
+    m_descriptors.clear();
+    keepDescriptor(-1);
+}
+
+bool ControlClient::isConnected() const {
+    return m_fd >= 0;
+}
+
+bool ControlClient::request(const std::string& line, std::string& reply, int timeoutMs) {
+    if (m_fd < 0) {
+        return setError(ErrorCode::Disconnected, "Not connected");
+    }
+    const std::string message = line + "\n";
+    size_t written = 0;
+    while (written < message.size()) {
+        const ssize_t count = ::send(m_fd, message.data() + written, message.size() - written, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            const std::string reason = std::strerror(errno);
+            disconnect();
+            return setError(ErrorCode::SendFailed, "Cannot send request: " + reason);
+        }
+        written += static_cast<size_t>(count);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        int descriptor = -1;
+        if (!readLine(reply, descriptor, static_cast<int>(std::max<int64_t>(0, left.count())))) {
+            return false;
+        }
+        if (!isEvent(reply)) {
+            keepDescriptor(descriptor);
+            return true;
+        }
+        m_events.emplace_back(std::move(reply), descriptor);
+    }
+}
+
+bool ControlClient::nextEvent(std::string& event, int timeoutMs) {
+    if (!m_events.empty()) {
+        event = std::move(m_events.front().first);
+        keepDescriptor(m_events.front().second);
+        m_events.pop_front();
+        return true;
+    }
+    if (m_fd < 0) {
+        return setError(ErrorCode::Disconnected, "Not connected");
+    }
+    int descriptor = -1;
+    if (!readLine(event, descriptor, timeoutMs)) {
+        return false;
+    }
+    keepDescriptor(descriptor);
+    return true;
+}
+
+int ControlClient::takeDescriptor() {
+    const int fd = m_lastDescriptor;
+    m_lastDescriptor = -1;
+    return fd;
+}
+
+bool ControlClient::attachState(StateSegment& segment) {
+    std::string reply;
+    if (!request("state", reply)) {
+        return false;
+    }
+    if (reply.find("\"ok\":true") == std::string::npos) {
+        return setError(ErrorCode::Refused, "No state segment: " + reply);
+    }
+    if (!segment.attach(takeDescriptor())) {
+        return setError(ErrorCode::Refused, segment.getLastError());
+    }
+    return true;
+}
+
+bool ControlClient::isEvent(const std::string& line) {
+    return line.compare(0, 9, "{\"event\":") == 0;
+}
+
+bool ControlClient::readLine(std::string& line, int& descriptor, int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        const size_t end = m_buffer.find('\n');
+        if (end != std::string::npos) {
+            line = m_buffer.substr(0, end);
+            m_buffer.erase(0, end + 1);
+            // Quotes inside JSON strings are escaped, so this cannot match part of a path
+            descriptor = -1;
+            if (line.find("\"fd\":true") != std::string::npos && !m_descriptors.empty()) {
+                descriptor = m_descriptors.front();
+                m_descriptors.pop_front();
+            }
+            return true;
+        }
+
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd descriptor{m_fd, POLLIN, 0};
+        const int ready = ::poll(&descriptor, 1, static_cast<int>(std::max<int64_t>(0, left.count())));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return setError(ErrorCode::Timeout, "No reply within " + std::to_string(timeoutMs) + " ms");
+        }
+        char buffer[16384];
+        iovec vector{ buffer, sizeof(buffer) };
+        alignas(cmsghdr) char control[CMSG_SPACE(4 * sizeof(int))];
+        msghdr message{};
+        message.msg_iov = &vector;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        const ssize_t count = ::recvmsg(m_fd, &message, MSG_CMSG_CLOEXEC);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            disconnect();
+            return setError(ErrorCode::Disconnected, "Daemon closed the connection");
+        }
+        for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+                const size_t fds = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (size_t i = 0; i < fds; ++i) {
+                    int fd = -1;
+                    std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+                    m_descriptors.push_back(fd);
+                }
+            }
+        }
+        m_buffer.append(buffer, static_cast<size_t>(count));
+    }
+}
+
+void ControlClient::keepDescriptor(int descriptor) {
+    if (m_lastDescriptor >= 0) {
+        ::close(m_lastDescriptor);
+    }
+    m_lastDescriptor = descriptor;
+}
+
+std::string ControlClient::getLastError() const {
+    return m_lastError;
+}
+
+ControlClient::ErrorCode ControlClient::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void ControlClient::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool ControlClient::setError(ErrorCode code, const std::string& message) {
+    m_lastErrorCode = code;
+    m_lastError = message;
+    return false;
+}
@@ -0,0 +1,79 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ControlClient.h
+ * Description: Client side of the daemon control socket
+ *
+ * Replies arrive in request order; event lines from a subscription may arrive in between,
+ * so request() sets those aside for nextEvent() instead of mistaking them for its reply.
+ * Lines marked "fd":true (the "state" reply, thumbnails) come with a file descriptor;
+ * descriptors arrive in the order of their lines, so each marked line takes the next one.
+ */
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <utility>
+
+class StateSegment;
+
+class ControlClient {
+public:
+    static constexpr int DEFAULT_TIMEOUT_MS = 5000;
+
+    ControlClient();
+    ~ControlClient();
+
+    ControlClient(const ControlClient&) = delete;
+    ControlClient& operator=(const ControlClient&) = delete;
+
+    // Empty path connects to WallpaperDaemon::defaultSocketPath()
+    bool connect(const std::string& socketPath = "");
+    void disconnect();
+    bool isConnected() const;
+
+    // Send one request and wait for its reply line (a JSON object)
+    bool request(const std::string& line, std::string& reply, int timeoutMs = DEFAULT_TIMEOUT_MS);
+
+    // Next event line after "subscribe"; false on timeout or disconnect
+    bool nextEvent(std::string& event, int timeoutMs);
+
+    // Descriptor that came with the line request() or nextEvent() last returned, now owned by
+    // the caller; -1 when it had none. Unclaimed ones are closed with the next line
+    int takeDescriptor();
+
+    // Send "state" and map the segment that comes with the reply
+    bool attachState(StateSegment& segment);
+
+    // True for {"event":...} lines; keys are serialised sorted and replies carry no "event"
+    static bool isEvent(const std::string& line);
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        ConnectFailed = 1,
+        SendFailed = 2,
+        Timeout = 3,
+        Disconnected = 4,
+        Refused = 5             // The daemon answered {"ok":false}
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool readLine(std::string& line, int& descriptor, int timeoutMs);
+    void keepDescriptor(int descriptor);
+    bool setError(ErrorCode code, const std::string& message);
+
+    int m_fd;
+    std::string m_buffer;
+    std::deque<std::pair<std::string, int>> m_events;  // With their descriptor, or -1
+    std::deque<int> m_descriptors;                      // Received, not yet matched to a line
+    int m_lastDescriptor;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
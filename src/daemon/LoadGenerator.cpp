@@ -0,0 +1,239 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: LoadGenerator.cpp
+ * Description: Implementation of the control socket load generator
+ */
+
+#include "LoadGenerator.h"
+#include "ControlClient.h"
+#include "../core/TraceReplay.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct ClientSamples {
+    std::vector<std::chrono::nanoseconds> queries;
+    std::vector<std::chrono::nanoseconds> sets;
+    uint64_t queryErrors = 0;
+    uint64_t setErrors = 0;
+    uint64_t setsApplied = 0;
+};
+
+bool replyOk(const std::string& reply) {
+    return reply.find("\"ok\":true") != std::string::npos;
+}
+
+std::string imageFor(const LoadProfile& profile, size_t index) {
+    if (!profile.images.empty()) {
+        return profile.images[index % profile.images.size()];
+    }
+    return "/tmp/caithe-loadgen/wall_" + std::to_string(index % 64) + ".png";
+}
+
+RequestLatency summarize(std::vector<std::chrono::nanoseconds>& samples, uint64_t errors, double seconds) {
+    RequestLatency latency;
+    latency.count = samples.size();
+    latency.errors = errors;
+    latency.throughput = seconds > 0.0 ? static_cast<double>(samples.size()) / seconds : 0.0;
+    latency.p50 = TraceReplayer::percentile(samples, 0.50);
+    latency.p90 = TraceReplayer::percentile(samples, 0.90);
+    latency.p99 = TraceReplayer::percentile(samples, 0.99);
+    latency.p999 = TraceReplayer::percentile(samples, 0.999);
+    latency.max = TraceReplayer::percentile(samples, 1.0);
+    return latency;
+}
+
+double toMs(std::chrono::nanoseconds value) {
+    return std::chrono::duration<double, std::milli>(value).count();
+}
+
+nlohmann::json latencyJson(const RequestLatency& latency) {
+    return {
+        {"count", latency.count},
+        {"errors", latency.errors},
+        {"throughput_per_s", latency.throughput},
+        {"latency_ms", {
+            {"p50", toMs(latency.p50)},
+            {"p90", toMs(latency.p90)},
+            {"p99", toMs(latency.p99)},
+            {"p999", toMs(latency.p999)},
+            {"max", toMs(latency.max)},
+        }},
+    };
+}
+
+} // namespace
+
+std::string LoadReport::toJson() const {
+    nlohmann::json report;
+    report["build"] = {
+        {"compiler", __VERSION__},
+        {"date", __DATE__ " " __TIME__},
+    };
+    report["profile"] = {
+        {"clients", profile.clients},
+        {"subscribers", profile.subscribers},
+        {"query_rate", profile.queryRate},
+        {"set_rate", profile.setRate},
+        {"duration_ms", profile.duration.count()},
+        {"monitors", profile.monitors},
+    };
+    report["seconds"] = seconds;
+    report["queries"] = latencyJson(queries);
+    report["sets"] = latencyJson(sets);
+    report["connect_errors"] = connectErrors;
+    report["events"] = {{"received", eventsReceived}, {"expected", eventsExpected}};
+    return report.dump(2);
+}
+
+std::string LoadReport::describe() const {
+    std::string text;
+    char line[256];
+    const std::pair<const char*, const RequestLatency*> kinds[] = { {"query", &queries}, {"set", &sets} };
+    for (const auto& [name, latency] : kinds) {
+        std::snprintf(line, sizeof(line), "%-6s %8llu ok %5llu errors %9.1f/s  p50 %7.3f  p99 %7.3f  p99.9 %7.3f  max %7.3f ms\n",
+                      name, static_cast<unsigned long long>(latency->count), static_cast<unsigned long long>(latency->errors),
+                      latency->throughput, toMs(latency->p50), toMs(latency->p99), toMs(latency->p999), toMs(latency->max));
+        text += line;
+    }
+    std::snprintf(line, sizeof(line), "%zu clients, %zu subscribers for %.2f s: %llu connect errors, %llu/%llu events\n",
+                  profile.clients, profile.subscribers, seconds, static_cast<unsigned long long>(connectErrors),
+                  static_cast<unsigned long long>(eventsReceived), static_cast<unsigned long long>(eventsExpected));
+    text += line;
+    return text;
+}
+
+LoadGenerator::LoadGenerator(LoadProfile profile)
+    : m_profile(std::move(profile)) {
+}
+
+LoadGenerator::~LoadGenerator() = default;
+
+LoadReport LoadGenerator::run() {
+    LoadReport report;
+    report.profile = m_profile;
+    if (m_profile.monitors.empty()) {
+        return report;
+    }
+
+    // Give every monitor a wallpaper so gets succeed from the first request
+    {
+        ControlClient primer;
+        std::string reply;
+        if (!primer.connect(m_profile.socketPath)) {
+            ++report.connectErrors;
+            return report;
+        }
+        for (size_t i = 0; i < m_profile.monitors.size(); ++i) {
+            primer.request("set " + m_profile.monitors[i] + " " + imageFor(m_profile, i), reply);
+        }
+    }
+
+    // Subscribe up front so no event of the measured run is missed
+    std::vector<std::unique_ptr<ControlClient>> subscribers;
+    for (size_t i = 0; i < m_profile.subscribers; ++i) {
+        auto subscriber = std::make_unique<ControlClient>();
+        std::string reply;
+        if (subscriber->connect(m_profile.socketPath) && subscriber->request("subscribe", reply) && replyOk(reply)) {
+            subscribers.push_back(std::move(subscriber));
+        } else {
+            ++report.connectErrors;
+        }
+    }
+
+    std::atomic<bool> clientsDone(false);
+    std::atomic<uint64_t> eventsReceived(0);
+    std::vector<std::thread> subscriberThreads;
+    for (auto& subscriber : subscribers) {
+        subscriberThreads.emplace_back([&clientsDone, &eventsReceived, client = subscriber.get()] {
+            std::string event;
+            // After the clients finish, drain until the daemon has been quiet for a while
+            for (;;) {
+                const bool done = clientsDone;
+                if (client->nextEvent(event, done ? 200 : 20)) {
+                    ++eventsReceived;
+                } else if (done || !client->isConnected()) {
+                    return;
+                }
+            }
+        });
+    }
+
+    std::mutex mergeMutex;
+    ClientSamples merged;
+    std::atomic<uint64_t> connectErrors(0);
+    const double totalRate = m_profile.queryRate + m_profile.setRate;
+    const auto start = Clock::now();
+    const auto end = start + m_profile.duration;
+
+    std::vector<std::thread> clients;
+    for (size_t index = 0; index < m_profile.clients; ++index) {
+        clients.emplace_back([&, index] {
+            ControlClient client;
+            if (!client.connect(m_profile.socketPath)) {
+                ++connectErrors;
+                return;
+            }
+            ClientSamples samples;
+            std::mt19937 random(static_cast<uint32_t>(index) * 2654435761u + 1);
+            std::uniform_real_distribution<double> pick(0.0, totalRate);
+            const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / totalRate));
+            // Stagger the clients across one interval instead of firing in lockstep
+            auto due = start + interval * static_cast<int64_t>(index) / static_cast<int64_t>(m_profile.clients);
+            std::string reply;
+
+            for (size_t sequence = 0; totalRate > 0.0 && due < end; ++sequence, due += interval) {
+                std::this_thread::sleep_until(due);
+                if (pick(random) < m_profile.setRate) {
+                    const std::string& monitor = m_profile.monitors[random() % m_profile.monitors.size()];
+                    const bool ok = client.request("set " + monitor + " " + imageFor(m_profile, random()), reply) && replyOk(reply);
+                    samples.sets.push_back(Clock::now() - due);
+                    samples.setErrors += ok ? 0 : 1;
+                    samples.setsApplied += ok ? 1 : 0;
+                } else {
+                    const std::string query = sequence % 2 ? "status"
+                        : "get " + m_profile.monitors[random() % m_profile.monitors.size()];
+                    const bool ok = client.request(query, reply) && replyOk(reply);
+                    samples.queries.push_back(Clock::now() - due);
+                    samples.queryErrors += ok ? 0 : 1;
+                }
+                if (!client.isConnected() && !client.connect(m_profile.socketPath)) {
+                    ++connectErrors;
+                    break;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mergeMutex);
+            merged.queries.insert(merged.queries.end(), samples.queries.begin(), samples.queries.end());
+            merged.sets.insert(merged.sets.end(), samples.sets.begin(), samples.sets.end());
+            merged.queryErrors += samples.queryErrors;
+            merged.setErrors += samples.setErrors;
+            merged.setsApplied += samples.setsApplied;
+        });
+    }
+    for (std::thread& thread : clients) {
+        thread.join();
+    }
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    clientsDone = true;
+    for (std::thread& thread : subscriberThreads) {
+        thread.join();
+    }
+
+    report.queries = summarize(merged.queries, merged.queryErrors, report.seconds);
+    report.sets = summarize(merged.sets, merged.setErrors, report.seconds);
+    report.connectErrors += connectErrors;
+    report.eventsReceived = eventsReceived;
+    report.eventsExpected = merged.setsApplied * subscribers.size();
+    return report;
+}
@@ -0,0 +1,70 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: LoadGenerator.h
+ * Description: Concurrent load generator for the daemon control socket
+ *
+ * Strategy:
+ * - Every client runs its own open-loop schedule: requests are due at fixed intervals, and
+ *   latency is measured from the due time, so a stalled daemon shows up as queueing delay
+ *   instead of quietly lowering the offered load
+ * - Queries (status and get) and sets are mixed per client at the configured rates;
+ *   subscribers only count the events they receive
+ * - Each monitor gets one set before measuring, so every get has something to return and
+ *   an error in the report is a real one
+ * - The JSON report carries the profile and the compiler, so runs from different builds
+ *   can be diffed directly
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct LoadProfile {
+    std::string socketPath;
+    size_t clients = 16;
+    size_t subscribers = 4;
+    double queryRate = 50.0;        // Per client per second
+    double setRate = 2.0;           // Per client per second
+    std::chrono::milliseconds duration{5000};
+    std::vector<std::string> monitors = { "DP-1", "HDMI-A-1" };
+    std::vector<std::string> images;    // Empty uses synthetic paths (fine with a mock backend)
+};
+
+struct RequestLatency {
+    uint64_t count = 0;
+    uint64_t errors = 0;            // Transport failures, timeouts and {"ok":false} replies
+    double throughput = 0.0;        // Completed requests per second
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds p999{0};
+    std::chrono::nanoseconds max{0};
+};
+
+struct LoadReport {
+    LoadProfile profile;
+    RequestLatency queries;
+    RequestLatency sets;
+    uint64_t connectErrors = 0;
+    uint64_t eventsReceived = 0;
+    uint64_t eventsExpected = 0;    // Successful sets times subscribers
+    double seconds = 0.0;
+
+    std::string toJson() const;
+    std::string describe() const;
+};
+
+class LoadGenerator {
+public:
+    explicit LoadGenerator(LoadProfile profile);
+    ~LoadGenerator();
+
+    LoadReport run();
+
+private:
+    LoadProfile m_profile;
+};
@@ -0,0 +1,248 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: RemoteThumbnails.cpp
+ * Description: Implementation of the client-side cache of daemon thumbnails
+ */
+
+#include "RemoteThumbnails.h"
+#include <fcntl.h>
+#include <nlohmann/json.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Width, height and source size of a thumbnail reply or event
+std::shared_ptr<const MappedThumbnail> mapFields(int fd, const nlohmann::json& fields) {
+    return RemoteThumbnails::map(fd, fields.value("width", 0), fields.value("height", 0),
+                                 fields.value("sourceWidth", 0), fields.value("sourceHeight", 0));
+}
+
+} // namespace
+
+MappedThumbnail::~MappedThumbnail() {
+    if (pixels) {
+        ::munmap(const_cast<uint8_t*>(pixels), bytes());
+    }
+}
+
+RemoteThumbnails::RemoteThumbnails(size_t budgetBytes)
+    : m_budgetBytes(budgetBytes)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+RemoteThumbnails::~RemoteThumbnails() = default;
+
+bool RemoteThumbnails::connect(const std::string& socketPath) {
+    clear();
+    clearError();
+    if (!m_client.connect(socketPath)) {
+        return setError(ErrorCode::ConnectFailed, m_client.getLastError());
+    }
+    return true;
+}
+
+bool RemoteThumbnails::isConnected() const {
+    return m_client.isConnected();
+}
+
+std::shared_ptr<const MappedThumbnail> RemoteThumbnails::request(const std::string& path, int64_t modified,
+                                                                 const std::string& contentKey) {
+    const std::string& key = contentKey.empty() ? path : contentKey;
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && !it->second.keyed && it->second.modified != modified) {
+        erase(it);      // The file changed on disk
+        it = m_entries.end();
+    }
+    if (it != m_entries.end()) {
+        if (it->second.state != State::Ready) {
+            return nullptr;
+        }
+        ++m_stats.hits;
+        m_recent.splice(m_recent.begin(), m_recent, it->second.recent);
+        return it->second.thumbnail;
+    }
+
+    ++m_stats.misses;
+    Entry& entry = m_entries[key];
+    entry.modified = modified;
+    entry.keyed = !contentKey.empty();
+    // Requests are lines, and the daemon would resolve a relative path against its own directory
+    if (path.empty() || path.front() != '/' || path.find('\n') != std::string::npos) {
+        settle(key, modified, nullptr);
+        return nullptr;
+    }
+    std::string line;
+    if (!m_client.request("thumbnail " + std::to_string(modified) + " " + path, line, REQUEST_TIMEOUT_MS)) {
+        // A late reply would be taken for the next one; the caller reconnects or decodes locally
+        m_entries.erase(key);
+        setError(ErrorCode::RequestFailed, m_client.getLastError());
+        m_client.disconnect();
+        return nullptr;
+    }
+    const nlohmann::json reply = nlohmann::json::parse(line, nullptr, false);
+    if (reply.is_object() && reply.value("pending", false)) {
+        if (entry.keyed) {
+            m_keys[path] = key;     // The event names the path
+        }
+        return nullptr;
+    }
+    if (!reply.is_object() || !reply.value("ok", false)) {
+        if (reply.is_object() && reply.value("failed", false)) {
+            settle(key, modified, nullptr);
+        } else {
+            m_entries.erase(key);       // The daemon is busy; asked again on a later frame
+        }
+        return nullptr;
+    }
+    settle(key, modified, mapFields(m_client.takeDescriptor(), reply));
+    it = m_entries.find(key);
+    return it != m_entries.end() ? it->second.thumbnail : nullptr;
+}
+
+bool RemoteThumbnails::hasFailed(const std::string& key) const {
+    const auto it = m_entries.find(key);
+    return it != m_entries.end() && it->second.state == State::Failed;
+}
+
+std::vector<std::string> RemoteThumbnails::takeCompleted() {
+    std::string line;
+    while (m_client.isConnected() && m_client.nextEvent(line, 0)) {
+        const nlohmann::json event = nlohmann::json::parse(line, nullptr, false);
+        if (!event.is_object() || event.value("event", std::string()) != "thumbnail") {
+            continue;
+        }
+        std::string key = event.value("path", std::string());
+        const int64_t modified = event.value("modified", int64_t{0});
+        const auto alias = m_keys.find(key);
+        const bool keyed = alias != m_keys.end();
+        if (keyed) {
+            key = std::move(alias->second);
+            m_keys.erase(alias);
+        }
+        settle(key, modified, event.value("failed", false) ? nullptr : mapFields(m_client.takeDescriptor(), event),
+               keyed);
+    }
+    std::vector<std::string> completed;
+    completed.swap(m_completed);
+    return completed;
+}
+
+void RemoteThumbnails::cancelPending() {
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->second.state == State::Pending) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RemoteThumbnails::clear() {
+    m_entries.clear();
+    m_keys.clear();
+    m_recent.clear();
+    m_completed.clear();
+    m_stats.residentBytes = 0;
+}
+
+std::shared_ptr<const MappedThumbnail> RemoteThumbnails::map(int fd, int width, int height, int sourceWidth,
+                                                             int sourceHeight) {
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto thumbnail = std::make_shared<MappedThumbnail>();
+    thumbnail->width = width;
+    thumbnail->height = height;
+    thumbnail->sourceWidth = sourceWidth;
+    thumbnail->sourceHeight = sourceHeight;
+
+    // Unsealed, the file could shrink under the mapping and turn a texture upload into SIGBUS
+    const int required = F_SEAL_SHRINK | F_SEAL_WRITE;
+    const int seals = ::fcntl(fd, F_GET_SEALS);
+    struct stat info{};
+    const bool valid = width > 0 && height > 0 && width <= MAX_SIDE && height <= MAX_SIDE && seals >= 0 &&
+                       (seals & required) == required && ::fstat(fd, &info) == 0 &&
+                       static_cast<size_t>(info.st_size) == thumbnail->bytes();
+    void* pixels = valid ? ::mmap(nullptr, thumbnail->bytes(), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (pixels == MAP_FAILED) {
+        return nullptr;
+    }
+    thumbnail->pixels = static_cast<const uint8_t*>(pixels);
+    return thumbnail;
+}
+
+RemoteThumbnails::Stats RemoteThumbnails::getStats() const {
+    Stats stats = m_stats;
+    stats.entries = m_recent.size();
+    return stats;
+}
+
+void RemoteThumbnails::settle(const std::string& key, int64_t modified, std::shared_ptr<const MappedThumbnail> thumbnail,
+                              bool keyed) {
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && (it->second.modified != modified || it->second.state != State::Pending)) {
+        return;     // Another version of the file, or already settled
+    }
+    if (it == m_entries.end()) {
+        if (!thumbnail) {
+            return;     // Cancelled, and nothing worth keeping
+        }
+        it = m_entries.emplace(key, Entry{}).first;
+        it->second.modified = modified;
+        it->second.keyed = keyed;
+    }
+
+    Entry& entry = it->second;
+    m_completed.push_back(key);
+    if (!thumbnail) {
+        entry.state = State::Failed;
+        ++m_stats.failures;
+        return;
+    }
+    ++m_stats.received;
+    entry.state = State::Ready;
+    entry.thumbnail = std::move(thumbnail);
+    m_recent.push_front(key);
+    entry.recent = m_recent.begin();
+    m_stats.residentBytes += entry.thumbnail->bytes();
+    evict();
+}
+
+void RemoteThumbnails::erase(std::unordered_map<std::string, Entry>::iterator it) {
+    if (it->second.state == State::Ready) {
+        m_stats.residentBytes -= it->second.thumbnail->bytes();
+        m_recent.erase(it->second.recent);
+    }
+    m_entries.erase(it);
+}
+
+// Evict from the cold end; the newest thumbnail stays even if it alone exceeds the budget
+void RemoteThumbnails::evict() {
+    while (m_stats.residentBytes > m_budgetBytes && m_recent.size() > 1) {
+        erase(m_entries.find(m_recent.back()));
+        ++m_stats.evictions;
+    }
+}
+
+std::string RemoteThumbnails::getLastError() const {
+    return m_lastError;
+}
+
+RemoteThumbnails::ErrorCode RemoteThumbnails::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void RemoteThumbnails::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool RemoteThumbnails::setError(ErrorCode code, const std::string& message) {
+    m_lastErrorCode = code;
+    m_lastError = message;
+    return false;
+}
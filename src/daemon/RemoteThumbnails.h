@@ -0,0 +1,140 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: RemoteThumbnails.h
+ * Description: Client-side thumbnail cache over the daemon's shared thumbnail buffers
+ *
+ * Strategy:
+ * - request() behaves like ThumbnailCache::request(): a hit returns the thumbnail, a miss
+ *   asks the daemon once and returns null. The daemon answers at once with the buffer when
+ *   it holds one, and otherwise sends a "thumbnail" event when its decode finishes
+ * - Each buffer arrives as a sealed memfd that is mapped read-only and closed; the pages are
+ *   the daemon's, so nothing is decoded or copied here and the pixels can go straight to GL
+ * - A content key (LibraryIndex::getContentKey) keys the entry instead of the path, so exact
+ *   duplicates are asked for once and share one mapping; the daemon only ever sees the
+ *   first path of each content and decodes that alone
+ * - takeCompleted() drains the events without blocking and reports the keys that arrived
+ * - Mappings are kept LRU within a byte budget; one still held by a caller stays mapped
+ * - Not thread-safe: a GUI calls it from its render thread only
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ControlClient.h"
+
+// Read-only mapping of one RGBA buffer, unmapped with the last reference
+struct MappedThumbnail {
+    const uint8_t* pixels = nullptr;    // Tightly packed rows, width * 4 bytes each
+    int width = 0;
+    int height = 0;
+    int sourceWidth = 0;                // Displayed size of the full image (0 when unknown)
+    int sourceHeight = 0;
+
+    size_t bytes() const { return static_cast<size_t>(width) * height * 4; }
+
+    MappedThumbnail() = default;
+    ~MappedThumbnail();
+    MappedThumbnail(const MappedThumbnail&) = delete;
+    MappedThumbnail& operator=(const MappedThumbnail&) = delete;
+};
+
+class RemoteThumbnails {
+public:
+    static constexpr size_t DEFAULT_BUDGET_BYTES = 64 * 1024 * 1024;
+    static constexpr int REQUEST_TIMEOUT_MS = 1000;
+    static constexpr int MAX_SIDE = 4096;      // Larger buffers are refused as malformed
+
+    explicit RemoteThumbnails(size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+    ~RemoteThumbnails();
+
+    RemoteThumbnails(const RemoteThumbnails&) = delete;
+    RemoteThumbnails& operator=(const RemoteThumbnails&) = delete;
+
+    // Empty path connects to WallpaperDaemon::defaultSocketPath(); clears the cache
+    bool connect(const std::string& socketPath = "");
+    bool isConnected() const;
+
+    // Mapped thumbnail, or null while the daemon decodes it or when it cannot be decoded;
+    // `contentKey` as for ThumbnailCache::request()
+    std::shared_ptr<const MappedThumbnail> request(const std::string& path, int64_t modified = 0,
+                                                   const std::string& contentKey = std::string());
+
+    // Whether the daemon could not decode the file behind `key` (its content key, else its path)
+    bool hasFailed(const std::string& key) const;
+
+    // Keys whose thumbnail arrived (or failed) since the last call
+    std::vector<std::string> takeCompleted();
+
+    // Forget requests still waiting; a thumbnail arriving for one later is kept anyway
+    void cancelPending();
+
+    void clear();
+
+    // Map a buffer received from the daemon, taking ownership of `fd`; null when it is not a
+    // sealed buffer of exactly width * height * 4 bytes
+    static std::shared_ptr<const MappedThumbnail> map(int fd, int width, int height, int sourceWidth = 0,
+                                                      int sourceHeight = 0);
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t received = 0;          // Buffers mapped, from replies and events alike
+        uint64_t failures = 0;
+        uint64_t evictions = 0;
+        size_t residentBytes = 0;       // Mapped, not allocated: the pages are the daemon's
+        size_t entries = 0;
+    };
+    Stats getStats() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        ConnectFailed = 1,
+        RequestFailed = 2
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    enum class State {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    struct Entry {
+        int64_t modified = 0;       // As sent to the daemon
+        bool keyed = false;         // Keyed by content, so `modified` does not invalidate it
+        State state = State::Pending;
+        std::shared_ptr<const MappedThumbnail> thumbnail;
+        std::list<std::string>::iterator recent;    // Valid while Ready
+    };
+
+    // Record what the daemon sent for `key`; null when it could not be decoded or mapped.
+    // `keyed` marks a content key for an entry that was cancelled meanwhile
+    void settle(const std::string& key, int64_t modified, std::shared_ptr<const MappedThumbnail> thumbnail,
+                bool keyed = false);
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+    void evict();
+    bool setError(ErrorCode code, const std::string& message);
+
+    ControlClient m_client;
+    size_t m_budgetBytes;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::unordered_map<std::string, std::string> m_keys;    // Path asked for -> content key, until it arrives
+    std::list<std::string> m_recent;        // Ready entries, most recently requested first
+    std::vector<std::string> m_completed;
+    Stats m_stats;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
@@ -0,0 +1,327 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: StateSegment.cpp
+ * Description: Implementation of the shared-memory state snapshot
+ *
+ * Segment layout (64-bit words, native endianness; both sides run on the same machine):
+ * - 0: "CAITHESS", 1: format version, 2: segment bytes, 3: sequence (odd while writing),
+ *   4: retired flag, 5-7: reserved
+ * - 8: payload length in words, followed by the payload:
+ *   u64 generation, u64 published ns, u32 pid, u32 assignment count, 7 x u64 counters,
+ *   then per assignment u64 generation, u32 monitor, mode and path lengths, u32 padding and
+ *   the three strings; zero-padded to a whole word
+ */
+
+#include "StateSegment.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010      // Linux 5.1; older kernels refuse it and readers could map it writable
+#endif
+
+namespace {
+
+constexpr char SEGMENT_MAGIC[8] = { 'C', 'A', 'I', 'T', 'H', 'E', 'S', 'S' };
+constexpr size_t MAGIC_WORD = 0;
+constexpr size_t VERSION_WORD = 1;
+constexpr size_t BYTES_WORD = 2;
+constexpr size_t SEQUENCE_WORD = 3;
+constexpr size_t RETIRED_WORD = 4;
+constexpr size_t PAYLOAD_WORD = 8;
+constexpr size_t SEGMENT_WORDS = StateSegment::SEGMENT_BYTES / sizeof(uint64_t);
+constexpr size_t MAX_PAYLOAD_WORDS = SEGMENT_WORDS - PAYLOAD_WORD - 1;
+constexpr int SPINS_BEFORE_YIELD = 64;
+
+uint64_t loadWord(const uint64_t* word, int order = __ATOMIC_RELAXED) {
+    return __atomic_load_n(word, order);
+}
+
+void storeWord(uint64_t* word, uint64_t value, int order = __ATOMIC_RELAXED) {
+    __atomic_store_n(word, value, order);
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+bool get(const uint8_t*& cursor, const uint8_t* end, T& value) {
+    if (static_cast<size_t>(end - cursor) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return true;
+}
+
+bool getString(const uint8_t*& cursor, const uint8_t* end, uint32_t length, std::string& value) {
+    if (static_cast<size_t>(end - cursor) < length) {
+        return false;
+    }
+    value.assign(reinterpret_cast<const char*>(cursor), length);
+    cursor += length;
+    return true;
+}
+
+uint64_t magicWord() {
+    uint64_t word = 0;
+    std::memcpy(&word, SEGMENT_MAGIC, sizeof(word));
+    return word;
+}
+
+bool decode(const std::vector<uint64_t>& words, StateSegment::Snapshot& snapshot) {
+    const uint8_t* cursor = reinterpret_cast<const uint8_t*>(words.data());
+    const uint8_t* end = cursor + words.size() * sizeof(uint64_t);
+    uint32_t count = 0;
+    StateSegment::Counters& counters = snapshot.counters;
+    if (!get(cursor, end, snapshot.generation) || !get(cursor, end, snapshot.publishedNs) ||
+        !get(cursor, end, snapshot.pid) || !get(cursor, end, count) ||
+        !get(cursor, end, counters.connections) || !get(cursor, end, counters.requests) ||
+        !get(cursor, end, counters.applies) || !get(cursor, end, counters.applyFailures) ||
+        !get(cursor, end, counters.events) || !get(cursor, end, counters.droppedClients) ||
+        !get(cursor, end, counters.clients)) {
+        return false;
+    }
+    snapshot.assignments.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+        StateSegment::Assignment assignment;
+        uint32_t monitorLength = 0;
+        uint32_t modeLength = 0;
+        uint32_t pathLength = 0;
+        uint32_t padding = 0;
+        if (!get(cursor, end, assignment.generation) || !get(cursor, end, monitorLength) ||
+            !get(cursor, end, modeLength) || !get(cursor, end, pathLength) || !get(cursor, end, padding) ||
+            !getString(cursor, end, monitorLength, assignment.monitor) ||
+            !getString(cursor, end, modeLength, assignment.mode) ||
+            !getString(cursor, end, pathLength, assignment.path)) {
+            return false;
+        }
+        snapshot.assignments.push_back(std::move(assignment));
+    }
+    return true;
+}
+
+} // namespace
+
+StateSegment::StateSegment()
+    : m_fd(-1)
+    , m_words(nullptr)
+    , m_writable(false)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+StateSegment::~StateSegment() {
+    close();
+}
+
+bool StateSegment::create() {
+    close();
+    clearError();
+    m_fd = ::memfd_create("caithe-state", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (m_fd < 0 || ::ftruncate(m_fd, SEGMENT_BYTES) != 0) {
+        const std::string reason = std::strerror(errno);
+        close();
+        return setError(ErrorCode::CreateFailed, "Cannot create the state segment: " + reason);
+    }
+    void* data = ::mmap(nullptr, SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED) {
+        const std::string reason = std::strerror(errno);
+        close();
+        return setError(ErrorCode::CreateFailed, "Cannot map the state segment: " + reason);
+    }
+    m_words = static_cast<uint64_t*>(data);
+    m_writable = true;
+    m_words[MAGIC_WORD] = magicWord();
+    m_words[VERSION_WORD] = FORMAT_VERSION;
+    m_words[BYTES_WORD] = SEGMENT_BYTES;
+
+    // Our own writable mapping survives the seals; nobody else gets one
+    if (::fcntl(m_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0) {
+        const std::string reason = std::strerror(errno);
+        close();
+        return setError(ErrorCode::CreateFailed, "Cannot seal the state segment: " + reason);
+    }
+    (void)::fcntl(m_fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE);
+    (void)::fcntl(m_fd, F_ADD_SEALS, F_SEAL_SEAL);
+    return true;
+}
+
+bool StateSegment::publish(const Snapshot& snapshot) {
+    if (!m_writable) {
+        return setError(ErrorCode::CreateFailed, "State segment is not open for writing");
+    }
+    std::vector<uint8_t> bytes;
+    bytes.reserve(128 + snapshot.assignments.size() * 96);
+    timespec now{};
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    put<uint64_t>(bytes, snapshot.generation);
+    put<uint64_t>(bytes, static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec));
+    put<uint32_t>(bytes, static_cast<uint32_t>(::getpid()));
+    put<uint32_t>(bytes, static_cast<uint32_t>(snapshot.assignments.size()));
+    const Counters& counters = snapshot.counters;
+    for (const uint64_t counter : { counters.connections, counters.requests, counters.applies, counters.applyFailures,
+                                    counters.events, counters.droppedClients, counters.clients }) {
+        put<uint64_t>(bytes, counter);
+    }
+    for (const Assignment& assignment : snapshot.assignments) {
+        put<uint64_t>(bytes, assignment.generation);
+        put<uint32_t>(bytes, static_cast<uint32_t>(assignment.monitor.size()));
+        put<uint32_t>(bytes, static_cast<uint32_t>(assignment.mode.size()));
+        put<uint32_t>(bytes, static_cast<uint32_t>(assignment.path.size()));
+        put<uint32_t>(bytes, 0);
+        bytes.insert(bytes.end(), assignment.monitor.begin(), assignment.monitor.end());
+        bytes.insert(bytes.end(), assignment.mode.begin(), assignment.mode.end());
+        bytes.insert(bytes.end(), assignment.path.begin(), assignment.path.end());
+    }
+    const size_t words = (bytes.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    if (words > MAX_PAYLOAD_WORDS) {
+        return setError(ErrorCode::TooLarge, "State snapshot of " + std::to_string(bytes.size()) + " bytes does not fit");
+    }
+    m_buffer.assign(words, 0);
+    std::memcpy(m_buffer.data(), bytes.data(), bytes.size());
+
+    uint64_t* sequence = m_words + SEQUENCE_WORD;
+    const uint64_t current = loadWord(sequence);
+    storeWord(sequence, current + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    storeWord(m_words + PAYLOAD_WORD, words);
+    for (size_t i = 0; i < words; ++i) {
+        storeWord(m_words + PAYLOAD_WORD + 1 + i, m_buffer[i]);
+    }
+    storeWord(sequence, current + 2, __ATOMIC_RELEASE);
+    return true;
+}
+
+void StateSegment::retire() {
+    if (!m_writable) {
+        return;
+    }
+    // A write cycle of its own, so readers polling getSequence() notice
+    uint64_t* sequence = m_words + SEQUENCE_WORD;
+    const uint64_t current = loadWord(sequence);
+    storeWord(sequence, current + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    storeWord(m_words + RETIRED_WORD, 1);
+    storeWord(sequence, current + 2, __ATOMIC_RELEASE);
+}
+
+int StateSegment::getFd() const {
+    return m_fd;
+}
+
+bool StateSegment::attach(int fd) {
+    close();
+    clearError();
+    if (fd < 0) {
+        return setError(ErrorCode::AttachFailed, "No state segment descriptor");
+    }
+    m_fd = fd;
+    struct stat info{};
+    if (::fstat(m_fd, &info) != 0 || static_cast<size_t>(info.st_size) != SEGMENT_BYTES) {
+        close();
+        return setError(ErrorCode::AttachFailed, "Descriptor is not a state segment");
+    }
+    void* data = ::mmap(nullptr, SEGMENT_BYTES, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED) {
+        const std::string reason = std::strerror(errno);
+        close();
+        return setError(ErrorCode::AttachFailed, "Cannot map the state segment: " + reason);
+    }
+    m_words = static_cast<uint64_t*>(data);
+    if (loadWord(m_words + MAGIC_WORD) != magicWord() || loadWord(m_words + VERSION_WORD) != FORMAT_VERSION ||
+        loadWord(m_words + BYTES_WORD) != SEGMENT_BYTES) {
+        close();
+        return setError(ErrorCode::AttachFailed, "State segment has another format version");
+    }
+    return true;
+}
+
+bool StateSegment::read(Snapshot& snapshot) {
+    if (!m_words) {
+        return setError(ErrorCode::AttachFailed, "State segment is not attached");
+    }
+    const uint64_t* sequence = m_words + SEQUENCE_WORD;
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+        if (attempt >= SPINS_BEFORE_YIELD) {
+            std::this_thread::yield();
+        }
+        const uint64_t before = loadWord(sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        const bool retired = loadWord(m_words + RETIRED_WORD) != 0;
+        const uint64_t words = loadWord(m_words + PAYLOAD_WORD);
+        m_buffer.resize(words <= MAX_PAYLOAD_WORDS ? words : 0);
+        for (size_t i = 0; i < m_buffer.size(); ++i) {
+            m_buffer[i] = loadWord(m_words + PAYLOAD_WORD + 1 + i);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (loadWord(sequence) != before) {
+            continue;   // Overwritten while copying
+        }
+
+        if (retired) {
+            return setError(ErrorCode::Retired, "The daemon no longer updates this state segment");
+        }
+        if (before == 0) {
+            snapshot = Snapshot();      // Nothing published yet
+            return true;
+        }
+        if (words > MAX_PAYLOAD_WORDS || !decode(m_buffer, snapshot)) {
+            return setError(ErrorCode::Inconsistent, "Malformed state snapshot");
+        }
+        snapshot.sequence = before;
+        return true;
+    }
+    return setError(ErrorCode::Inconsistent, "State segment stayed mid-update for " +
+                                             std::to_string(MAX_READ_ATTEMPTS) + " attempts");
+}
+
+uint64_t StateSegment::getSequence() const {
+    return m_words ? loadWord(m_words + SEQUENCE_WORD, __ATOMIC_ACQUIRE) : 0;
+}
+
+void StateSegment::close() {
+    if (m_words) {
+        ::munmap(m_words, SEGMENT_BYTES);
+        m_words = nullptr;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_writable = false;
+}
+
+bool StateSegment::isOpen() const {
+    return m_words != nullptr;
+}
+
+std::string StateSegment::getLastError() const {
+    return m_lastError;
+}
+
+StateSegment::ErrorCode StateSegment::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void StateSegment::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool StateSegment::setError(ErrorCode code, const std::string& message) {
+    m_lastErrorCode = code;
+    m_lastError = message;
+    return false;
+}
@@ -0,0 +1,110 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: StateSegment.h
+ * Description: Read-only shared-memory snapshot of the daemon state for local readers
+ *
+ * Strategy:
+ * - The daemon writes a compact snapshot (assignments, generation, counters) into a sealed
+ *   memfd after every loop iteration that changed something; readers get the fd with the
+ *   "state" request and mmap it, then read it every frame without any socket traffic
+ * - A seqlock guards the snapshot: the writer makes the sequence odd, copies the payload and
+ *   makes it even again; a reader copies the payload between two equal even sequences, and
+ *   retries otherwise. Neither side ever blocks the other
+ * - Payload words are copied with relaxed atomic loads and stores, so a torn read is
+ *   detected and discarded rather than being a data race
+ * - Once the daemon has mapped it, the memfd is sealed against resizing and further
+ *   writable mappings, so readers can only ever map it read-only
+ * - A stopped or upgraded daemon retires its segment; readers see Retired and ask the
+ *   daemon now serving the socket for the new one
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class StateSegment {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr size_t SEGMENT_BYTES = 256 * 1024;
+    static constexpr int MAX_READ_ATTEMPTS = 1000;      // Before giving up on a writer stuck mid-update
+
+    struct Assignment {
+        std::string monitor;
+        std::string path;
+        std::string mode;
+        uint64_t generation = 0;
+    };
+
+    struct Counters {
+        uint64_t connections = 0;
+        uint64_t requests = 0;
+        uint64_t applies = 0;
+        uint64_t applyFailures = 0;
+        uint64_t events = 0;
+        uint64_t droppedClients = 0;
+        uint64_t clients = 0;
+    };
+
+    struct Snapshot {
+        uint64_t sequence = 0;          // Even; grows by two per publish
+        uint64_t generation = 0;        // Daemon generation, see WallpaperDaemon.h
+        uint64_t publishedNs = 0;       // CLOCK_MONOTONIC
+        uint32_t pid = 0;               // Of the publishing daemon
+        std::vector<Assignment> assignments;
+        Counters counters;
+    };
+
+    StateSegment();
+    ~StateSegment();
+
+    StateSegment(const StateSegment&) = delete;
+    StateSegment& operator=(const StateSegment&) = delete;
+
+    // Writer side: create, map and seal a new segment
+    bool create();
+    // sequence, publishedNs and pid are filled in here; false when the snapshot does not fit,
+    // and the previous one stays visible
+    bool publish(const Snapshot& snapshot);
+    // Tell readers this segment will never change again
+    void retire();
+    int getFd() const;      // Owned by the segment; pass a copy to readers
+
+    // Reader side: map a segment received from the daemon, taking ownership of `fd`
+    bool attach(int fd);
+    // Consistent copy of the latest snapshot
+    bool read(Snapshot& snapshot);
+    // Cheap change check: compare with the last snapshot's sequence before calling read()
+    uint64_t getSequence() const;
+
+    void close();
+    bool isOpen() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        CreateFailed = 1,
+        AttachFailed = 2,
+        TooLarge = 3,
+        Inconsistent = 4,
+        Retired = 5
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool setError(ErrorCode code, const std::string& message);
+
+    int m_fd;
+    uint64_t* m_words;              // The mapping, as 64-bit words
+    bool m_writable;
+    std::vector<uint64_t> m_buffer; // Payload being written or read
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
@@ -0,0 +1,186 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ThumbnailService.cpp
+ * Description: Implementation of the daemon's shared thumbnail buffers
+ */
+
+#include "ThumbnailService.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../utils/TaskScheduler.h"
+
+struct ThumbnailService::Shared {
+    std::mutex mutex;
+    std::vector<Completion> completed;
+    std::function<void()> onComplete;   // Cleared when the service goes away
+};
+
+namespace {
+
+// Sealed memfd holding `image`; -1 on failure
+int sealedCopy(const ImageBuffer& image) {
+    const int fd = ::memfd_create("caithe-thumbnail", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        return -1;
+    }
+    const size_t rowBytes = static_cast<size_t>(image.width) * image.channels;
+    bool written = ::ftruncate(fd, static_cast<off_t>(rowBytes * image.height)) == 0;
+    for (int y = 0; written && y < image.height; ++y) {
+        size_t done = 0;
+        while (written && done < rowBytes) {
+            const ssize_t count = ::pwrite(fd, image.row(y) + done, rowBytes - done,
+                                           static_cast<off_t>(rowBytes * y + done));
+            if (count > 0) {
+                done += static_cast<size_t>(count);
+            } else if (count < 0 && errno == EINTR) {
+                continue;
+            } else {
+                written = false;
+            }
+        }
+    }
+    if (!written || ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+ThumbnailService::Buffer::~Buffer() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+ThumbnailService::ThumbnailService(TaskScheduler& scheduler, std::function<void()> onComplete, int side,
+                                   size_t budgetBytes)
+    : m_scheduler(scheduler)
+    , m_shared(std::make_shared<Shared>())
+    , m_side(std::max(1, side))
+    , m_budgetBytes(budgetBytes) {
+    m_shared->onComplete = std::move(onComplete);
+}
+
+ThumbnailService::~ThumbnailService() {
+    // Decodes still running finish into the shared state and find nobody to tell
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->onComplete = nullptr;
+}
+
+std::shared_ptr<const ThumbnailService::Buffer> ThumbnailService::find(const std::string& path, int64_t modified) {
+    const auto it = m_entries.find(path);
+    if (it == m_entries.end() || it->second.modified != modified) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+    ++m_stats.hits;
+    m_recent.splice(m_recent.begin(), m_recent, it->second.recent);
+    return it->second.buffer;
+}
+
+bool ThumbnailService::hasFailed(const std::string& path, int64_t modified) const {
+    const auto it = m_failed.find(path);
+    return it != m_failed.end() && it->second == modified;
+}
+
+bool ThumbnailService::queue(const std::string& path, int64_t modified) {
+    Key key(path, modified);
+    if (m_pending.count(key)) {
+        return true;
+    }
+    if (m_pending.size() >= MAX_PENDING) {
+        return false;
+    }
+    m_pending.insert(std::move(key));
+    std::shared_ptr<Shared> shared = m_shared;
+    const int side = m_side;
+    m_scheduler.submit(IoClass::Interactive, [shared, path, modified, side]() {
+        render(shared, path, modified, side);
+    });
+    return true;
+}
+
+std::vector<ThumbnailService::Completion> ThumbnailService::takeCompleted() {
+    std::vector<Completion> completed;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        completed.swap(m_shared->completed);
+    }
+    for (const Completion& completion : completed) {
+        m_pending.erase(Key(completion.path, completion.modified));
+        if (!completion.buffer) {
+            ++m_stats.failures;
+            m_failed[completion.path] = completion.modified;
+            continue;
+        }
+        ++m_stats.decoded;
+        m_failed.erase(completion.path);
+        const auto existing = m_entries.find(completion.path);
+        if (existing != m_entries.end()) {
+            erase(existing);    // An older version of the file
+        }
+        m_recent.push_front(completion.path);
+        m_entries[completion.path] = Entry{ completion.modified, completion.buffer, m_recent.begin() };
+        m_stats.residentBytes += completion.buffer->bytes();
+    }
+    evict();
+    return completed;
+}
+
+int ThumbnailService::getSide() const {
+    return m_side;
+}
+
+ThumbnailService::Stats ThumbnailService::getStats() const {
+    Stats stats = m_stats;
+    stats.entries = m_entries.size();
+    stats.pending = m_pending.size();
+    return stats;
+}
+
+void ThumbnailService::render(const std::shared_ptr<Shared>& shared, const std::string& path, int64_t modified,
+                              int side) {
+    Thumbnail thumbnail;
+    Completion completion;
+    completion.path = path;
+    completion.modified = modified;
+    if (ThumbnailCache::render(path, side, thumbnail)) {
+        auto buffer = std::make_shared<Buffer>();
+        buffer->fd = sealedCopy(thumbnail.image);
+        buffer->width = thumbnail.image.width;
+        buffer->height = thumbnail.image.height;
+        buffer->channels = thumbnail.image.channels;
+        buffer->sourceWidth = thumbnail.sourceWidth;
+        buffer->sourceHeight = thumbnail.sourceHeight;
+        if (buffer->fd >= 0) {
+            completion.buffer = std::move(buffer);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    shared->completed.push_back(std::move(completion));
+    if (shared->onComplete) {
+        shared->onComplete();
+    }
+}
+
+void ThumbnailService::erase(std::map<std::string, Entry>::iterator it) {
+    m_stats.residentBytes -= it->second.buffer->bytes();
+    m_recent.erase(it->second.recent);
+    m_entries.erase(it);
+}
+
+// Evict from the cold end; the newest buffer stays even if it alone exceeds the budget
+void ThumbnailService::evict() {
+    while (m_stats.residentBytes > m_budgetBytes && m_recent.size() > 1) {
+        erase(m_entries.find(m_recent.back()));
+        ++m_stats.evictions;
+    }
+}
@@ -0,0 +1,121 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ThumbnailService.h
+ * Description: Daemon-side thumbnails in sealed memfds, shared by every control client
+ *
+ * Strategy:
+ * - The GUI and other clients ask the daemon instead of each decoding the library, so every
+ *   (path, modified) is decoded once per machine and held in memory once
+ * - ThumbnailCache::render() runs on TaskScheduler workers; its pixels are written once into
+ *   a memfd of their own, which is then sealed against writes and resizing
+ * - Clients receive the memfd over the control socket and map it read-only: the daemon and
+ *   every client share the same pages, and the GUI hands the mapping straight to
+ *   glTexImage2D, with no decode and no pixels copied through the socket
+ * - The daemon keeps the most recently requested buffers within a byte budget; a buffer it
+ *   evicts stays valid for as long as a client still maps it
+ * - Only the daemon's loop thread calls in, except for the workers reporting completions;
+ *   `onComplete` runs on the worker so the loop can be woken
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../library/ThumbnailCache.h"
+
+class TaskScheduler;
+
+class ThumbnailService {
+public:
+    static constexpr int DEFAULT_SIDE = ThumbnailCache::DEFAULT_SIDE;
+    static constexpr size_t DEFAULT_BUDGET_BYTES = 64 * 1024 * 1024;
+    static constexpr size_t MAX_PENDING = 1024;     // Decodes queued or running
+
+    // Tightly packed rows (stride = width * channels) in a sealed memfd
+    struct Buffer {
+        int fd = -1;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        int sourceWidth = 0;        // Displayed size of the full image (0 when unknown)
+        int sourceHeight = 0;
+
+        size_t bytes() const { return static_cast<size_t>(width) * height * channels; }
+
+        Buffer() = default;
+        ~Buffer();
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+    };
+
+    struct Completion {
+        std::string path;
+        int64_t modified = 0;
+        std::shared_ptr<const Buffer> buffer;   // Null when the file could not be decoded
+    };
+
+    ThumbnailService(TaskScheduler& scheduler, std::function<void()> onComplete, int side = DEFAULT_SIDE,
+                     size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+    ~ThumbnailService();
+
+    ThumbnailService(const ThumbnailService&) = delete;
+    ThumbnailService& operator=(const ThumbnailService&) = delete;
+
+    // Resident buffer for this version of the file, or null
+    std::shared_ptr<const Buffer> find(const std::string& path, int64_t modified);
+    // Whether this version of the file already failed to decode
+    bool hasFailed(const std::string& path, int64_t modified) const;
+    // Start a decode unless one is in flight; false when MAX_PENDING are
+    bool queue(const std::string& path, int64_t modified);
+
+    // Decodes finished since the last call; successful ones are now resident
+    std::vector<Completion> takeCompleted();
+
+    int getSide() const;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t decoded = 0;
+        uint64_t failures = 0;
+        uint64_t evictions = 0;
+        size_t residentBytes = 0;
+        size_t entries = 0;
+        size_t pending = 0;
+    };
+    Stats getStats() const;
+
+private:
+    struct Shared;
+    using Key = std::pair<std::string, int64_t>;
+
+    struct Entry {
+        int64_t modified = 0;
+        std::shared_ptr<const Buffer> buffer;
+        std::list<std::string>::iterator recent;
+    };
+
+    static void render(const std::shared_ptr<Shared>& shared, const std::string& path, int64_t modified, int side);
+    void erase(std::map<std::string, Entry>::iterator it);
+    void evict();
+
+    TaskScheduler& m_scheduler;
+    std::shared_ptr<Shared> m_shared;
+    int m_side;
+    size_t m_budgetBytes;
+
+    std::map<std::string, Entry> m_entries;
+    std::list<std::string> m_recent;        // Most recently requested first
+    std::set<Key> m_pending;
+    std::map<std::string, int64_t> m_failed;
+    Stats m_stats;
+};
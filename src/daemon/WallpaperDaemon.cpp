@@ -0,0 +1,1302 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: WallpaperDaemon.cpp
+ * Description: Implementation of the control socket event loop and the apply thread
+ */
+
+#include "WallpaperDaemon.h"
+#include "../utils/Logger.h"
+#include "../utils/TaskScheduler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t LISTEN_ID = 0;
+constexpr uint64_t WAKE_ID = 1;
+
+std::string okReply() {
+    return "{\"ok\":true}";
+}
+
+std::string generationReply(uint64_t generation) {
+    return nlohmann::json{{"ok", true}, {"generation", generation}}.dump();
+}
+
+std::string errorReply(const std::string& message) {
+    nlohmann::json reply;
+    reply["ok"] = false;
+    reply["error"] = message;
+    return reply.dump();
+}
+
+bool isMode(const std::string& mode) {
+    return mode == "Stretch" || mode == "Center" || mode == "Tile" || mode == "Scale";
+}
+
+// "set DP-1 /a b.png" -> {"set", "DP-1", "/a b.png"}: the last field keeps its spaces
+std::vector<std::string> splitRequest(const std::string& line, size_t fields) {
+    std::vector<std::string> parts;
+    size_t position = 0;
+    while (position < line.size() && parts.size() + 1 < fields) {
+        const size_t end = line.find(' ', position);
+        if (end == std::string::npos) {
+            break;
+        }
+        if (end > position) {
+            parts.push_back(line.substr(position, end - position));
+        }
+        position = end + 1;
+    }
+    if (position < line.size()) {
+        parts.push_back(line.substr(position));
+    }
+    return parts;
+}
+
+// Every key sorts after "event", so the same fields serve as a reply and as an event
+nlohmann::json thumbnailFields(const std::string& path, int64_t modified, const ThumbnailService::Buffer& buffer) {
+    return {{"fd", true}, {"format", "RGBA"}, {"width", buffer.width}, {"height", buffer.height},
+            {"sourceWidth", buffer.sourceWidth}, {"sourceHeight", buffer.sourceHeight}, {"path", path},
+            {"modified", modified}};
+}
+
+// Non-blocking send of `size` bytes with `fd` attached to the first one
+ssize_t sendWithDescriptor(int socket, const char* data, size_t size, int fd) {
+    iovec vector{ const_cast<char*>(data), size };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(header), &fd, sizeof(int));
+    return ::sendmsg(socket, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+nlohmann::json::binary_t toBinary(const std::string& bytes) {
+    return nlohmann::json::binary_t(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+}
+
+std::string fromBinary(const nlohmann::json& value) {
+    const std::vector<uint8_t>& bytes = value.get_binary();
+    return std::string(bytes.begin(), bytes.end());
+}
+
+// Blocking exchange over a (possibly non-blocking) socket, every step bounded by the handoff timeout.
+// Bytes that carry descriptors are only ever read by receiveFds, never by the buffered reads.
+class HandoffChannel {
+public:
+    static constexpr size_t FDS_PER_MESSAGE = 64;
+    static constexpr size_t MAX_LINE = 4096;
+
+    explicit HandoffChannel(int fd, std::string buffered = std::string())
+        : m_fd(fd)
+        , m_buffer(std::move(buffered)) {
+    }
+
+    bool send(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        size_t written = 0;
+        while (written < size) {
+            const ssize_t count = ::send(m_fd, bytes + written, size - written, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (count > 0) {
+                written += static_cast<size_t>(count);
+            } else if (count < 0 && errno == EINTR) {
+                continue;
+            } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!wait(POLLOUT)) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool send(const std::string& data) {
+        return send(data.data(), data.size());
+    }
+
+    bool readLine(std::string& line) {
+        for (;;) {
+            const size_t end = m_buffer.find('\n');
+            if (end != std::string::npos) {
+                line = m_buffer.substr(0, end);
+                m_buffer.erase(0, end + 1);
+                return true;
+            }
+            if (m_buffer.size() > MAX_LINE || !fill()) {
+                return false;
+            }
+        }
+    }
+
+    bool readBytes(size_t size, std::vector<uint8_t>& out) {
+        while (m_buffer.size() < size) {
+            if (!fill(size - m_buffer.size())) {
+                return false;
+            }
+        }
+        out.assign(m_buffer.begin(), m_buffer.begin() + static_cast<std::ptrdiff_t>(size));
+        m_buffer.erase(0, size);
+        return true;
+    }
+
+    bool sendFds(const std::vector<int>& fds) {
+        for (size_t first = 0; first < fds.size(); first += FDS_PER_MESSAGE) {
+            const size_t count = std::min(FDS_PER_MESSAGE, fds.size() - first);
+            char byte = 0;
+            iovec io{ &byte, 1 };
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * FDS_PER_MESSAGE)] = {};
+            msghdr message{};
+            message.msg_iov = &io;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+            std::memcpy(CMSG_DATA(header), fds.data() + first, sizeof(int) * count);
+            for (;;) {
+                const ssize_t sent = ::sendmsg(m_fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (sent == 1) {
+                    break;
+                }
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && wait(POLLOUT)) {
+                    continue;
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Received descriptors are appended to `fds` even on failure, so the caller can close them
+    bool receiveFds(size_t count, std::vector<int>& fds) {
+        if (!m_buffer.empty()) {
+            return false;   // The sender never writes between the payload and the descriptors
+        }
+        while (fds.size() < count) {
+            char byte = 0;
+            iovec io{ &byte, 1 };
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * FDS_PER_MESSAGE)] = {};
+            msghdr message{};
+            message.msg_iov = &io;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            const ssize_t received = ::recvmsg(m_fd, &message, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!wait(POLLIN)) {
+                    return false;
+                }
+                continue;
+            }
+            if (received != 1) {
+                return false;
+            }
+            for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+                if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+                    const size_t carried = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    const size_t offset = fds.size();
+                    fds.resize(offset + carried);
+                    std::memcpy(fds.data() + offset, CMSG_DATA(header), carried * sizeof(int));
+                }
+            }
+            if (message.msg_flags & MSG_CTRUNC) {
+                return false;
+            }
+        }
+        return fds.size() == count;
+    }
+
+private:
+    bool wait(short events) {
+        pollfd entry{ m_fd, events, 0 };
+        int ready;
+        do {
+            ready = ::poll(&entry, 1, WallpaperDaemon::HANDOFF_TIMEOUT_MS);
+        } while (ready < 0 && errno == EINTR);
+        return ready > 0;
+    }
+
+    bool fill(size_t wanted = 4096) {
+        char buffer[65536];
+        for (;;) {
+            const ssize_t count = ::recv(m_fd, buffer, std::min(wanted, sizeof(buffer)), MSG_DONTWAIT);
+            if (count > 0) {
+                m_buffer.append(buffer, static_cast<size_t>(count));
+                return true;
+            }
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && wait(POLLIN)) {
+                continue;
+            }
+            return false;
+        }
+    }
+
+    int m_fd;
+    std::string m_buffer;
+};
+
+} // namespace
+
+WallpaperDaemon::WallpaperDaemon()
+    : m_listenFd(-1)
+    , m_epollFd(-1)
+    , m_wakeFd(-1)
+    , m_stopping(false)
+    , m_handedOff(false)
+    , m_nextClient(2)
+    , m_generation(0)
+    , m_pendingApplies(0)
+    , m_handoffClient(0)
+    , m_publishedGeneration(0)
+    , m_scheduler(std::make_unique<TaskScheduler>(THUMBNAIL_THREADS))
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+WallpaperDaemon::~WallpaperDaemon() {
+    stop();
+}
+
+void WallpaperDaemon::setBackendSocket(const std::string& path) {
+    m_hyprpaper.setSocketPath(path);
+}
+
+std::string WallpaperDaemon::defaultSocketPath() {
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        return std::string(runtime) + "/caithe.sock";
+    }
+    return "/tmp/caithe-" + std::to_string(::getuid()) + ".sock";
+}
+
+bool WallpaperDaemon::start(const std::string& socketPath) {
+    if (isRunning()) {
+        return setError(ErrorCode::AlreadyRunning, "Daemon already serving " + m_socketPath);
+    }
+    clearError();
+    const std::string path = socketPath.empty() ? defaultSocketPath() : socketPath;
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return setError(ErrorCode::ListenFailed, "Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // A socket file nobody answers on is left over from a crash; a live one is another daemon
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        const bool live = ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        ::close(probe);
+        if (live) {
+            return setError(ErrorCode::ListenFailed, "Another daemon is serving " + path);
+        }
+    }
+    ::unlink(path.c_str());
+
+    m_listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0 || ::bind(m_listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(m_listenFd, SOMAXCONN) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (m_listenFd >= 0) {
+            ::close(m_listenFd);
+            m_listenFd = -1;
+        }
+        return setError(ErrorCode::ListenFailed, "Cannot listen on " + path + ": " + reason);
+    }
+    m_socketPath = path;
+    if (!setUpLoop()) {
+        const std::string reason = std::strerror(errno);
+        stop();
+        return setError(ErrorCode::ListenFailed, "Cannot set up the event loop: " + reason);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats = Stats{};
+    }
+    startThreads();
+    CAITHE_LOG_INFO("Control socket listening on {}", path);
+    return true;
+}
+
+bool WallpaperDaemon::takeOver(const std::string& socketPath) {
+    if (isRunning()) {
+        return setError(ErrorCode::AlreadyRunning, "Daemon already serving " + m_socketPath);
+    }
+    clearError();
+    const std::string path = socketPath.empty() ? defaultSocketPath() : socketPath;
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return setError(ErrorCode::HandoffFailed, "Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return setError(ErrorCode::HandoffFailed, "No daemon to take over at " + path + ": " + reason);
+    }
+
+    // Until "ok" is sent the previous daemon still owns everything; closing our copies is enough to back out
+    std::vector<int> fds;
+    const auto abandon = [&](const std::string& reason) {
+        for (const int received : fds) {
+            ::close(received);
+        }
+        ::close(fd);
+        for (const int owned : {m_epollFd, m_wakeFd}) {
+            if (owned >= 0) {
+                ::close(owned);
+            }
+        }
+        m_clients.clear();
+        m_assignments.clear();
+        m_thumbnails.reset();
+        m_listenFd = -1;
+        m_epollFd = -1;
+        m_wakeFd = -1;
+        return setError(ErrorCode::HandoffFailed, "Handoff from " + path + " failed: " + reason);
+    };
+
+    HandoffChannel channel(fd);
+    std::string line;
+    if (!channel.send("handoff\n") || !channel.readLine(line)) {
+        return abandon("the running daemon did not answer");
+    }
+    // value() throws on a non-object or a mistyped field; an old or broken daemon must only abandon
+    const nlohmann::json header = nlohmann::json::parse(line, nullptr, false);
+    if (!header.is_object()) {
+        return abandon("unreadable reply");
+    }
+    size_t bytes = 0;
+    size_t fdCount = 0;
+    try {
+        if (!header.value("ok", false)) {
+            return abandon(header.value("error", std::string("refused")));
+        }
+        bytes = header.value("bytes", size_t{0});
+        fdCount = header.value("fds", size_t{0});
+    } catch (const nlohmann::json::exception& e) {
+        return abandon(std::string("malformed reply: ") + e.what());
+    }
+    std::vector<uint8_t> payload;
+    if (bytes > MAX_HANDOFF_BYTES || !channel.readBytes(bytes, payload)) {
+        return abandon("truncated state snapshot");
+    }
+    const nlohmann::json snapshot = nlohmann::json::from_cbor(payload, true, false);
+    const auto version = snapshot.find("version");     // end() unless an object holds it
+    const auto clients = snapshot.find("clients");
+    if (version == snapshot.end() || !version->is_number_unsigned() || *version != HANDOFF_VERSION ||
+        clients == snapshot.end() || !clients->is_array() || fdCount < clients->size() + 1) {
+        return abandon("incompatible state snapshot");
+    }
+    if (!channel.send("ready\n") || !channel.receiveFds(fdCount, fds)) {
+        return abandon("listening and client sockets were not received");
+    }
+    int listening = 0;
+    socklen_t length = sizeof(listening);
+    if (::getsockopt(fds[0], SOL_SOCKET, SO_ACCEPTCONN, &listening, &length) != 0 || !listening) {
+        return abandon("the first socket received is not listening");
+    }
+
+    try {
+        for (const nlohmann::json& entry : snapshot.at("assignments")) {
+            Assignment& assignment = m_assignments[entry.at("monitor").get<std::string>()];
+            assignment.path = entry.at("path").get<std::string>();
+            assignment.mode = entry.at("mode").get<std::string>();
+            assignment.generation = entry.at("generation").get<uint64_t>();
+        }
+        m_generation = snapshot.at("generation").get<uint64_t>();
+        m_preloaded.clear();
+        for (const nlohmann::json& image : snapshot.at("preloaded")) {
+            m_preloaded.insert(image.get<std::string>());
+        }
+        // Client sockets follow the listening socket, then the descriptors of their unsent replies
+        size_t attached = snapshot["clients"].size() + 1;
+        for (const nlohmann::json& entry : snapshot["clients"]) {
+            attached += entry.at("attachments").size();
+        }
+        if (attached != fdCount) {
+            return abandon("descriptor count does not match the state snapshot");
+        }
+        m_listenFd = fds[0];
+        if (!setUpLoop()) {
+            return abandon(std::string("cannot set up the event loop: ") + std::strerror(errno));
+        }
+        size_t nextAttachment = snapshot["clients"].size() + 1;
+        for (size_t i = 0; i < snapshot["clients"].size(); ++i) {
+            const nlohmann::json& entry = snapshot["clients"][i];
+            Client client;
+            client.fd = fds[i + 1];
+            client.input = fromBinary(entry.at("input"));
+            client.output = fromBinary(entry.at("output"));
+            client.subscribed = entry.at("subscribed").get<bool>();
+            client.closing = entry.at("closing").get<bool>();
+            for (const nlohmann::json& offset : entry.at("attachments")) {
+                client.attachments.emplace_back(offset.get<size_t>(), fds[nextAttachment++]);
+            }
+            const uint64_t id = m_nextClient++;
+            epoll_event event{};
+            event.events = client.closing ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP);
+            event.data.u64 = id;
+            if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, client.fd, &event) != 0) {
+                return abandon(std::string("cannot watch a client: ") + std::strerror(errno));
+            }
+            m_clients[id] = std::move(client);
+        }
+    } catch (const nlohmann::json::exception& e) {
+        return abandon(std::string("malformed state snapshot: ") + e.what());
+    }
+
+    // Commit: the previous daemon closes its copies and exits
+    if (!channel.send("ok\n")) {
+        return abandon("the running daemon went away before the commit");
+    }
+    ::close(fd);
+    m_socketPath = path;
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats = Stats{};
+        m_stats.clients = m_clients.size();
+        m_stats.adoptedClients = m_clients.size();
+    }
+    startThreads();
+    CAITHE_LOG_INFO("Took over {} with {} clients and {} assignments", path, m_clients.size(), m_assignments.size());
+    return true;
+}
+
+bool WallpaperDaemon::setUpLoop() {
+    if (!m_stateSegment.create()) {
+        CAITHE_LOG_WARNING("{}; \"state\" requests will fail", m_stateSegment.getLastError());
+    }
+    m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event listenEvent{};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.u64 = LISTEN_ID;
+    epoll_event wakeEvent{};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.u64 = WAKE_ID;
+    // Workers report a finished decode the way the apply thread does
+    const int wakeFd = m_wakeFd;
+    m_thumbnails = std::make_unique<ThumbnailService>(*m_scheduler, [wakeFd]() {
+        const uint64_t one = 1;
+        (void)::write(wakeFd, &one, sizeof(one));
+    });
+    return m_epollFd >= 0 && m_wakeFd >= 0 &&
+           ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &listenEvent) == 0 &&
+           ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &wakeEvent) == 0;
+}
+
+void WallpaperDaemon::startThreads() {
+    m_stopping = false;
+    m_handedOff = false;
+    m_loopThread = std::thread(&WallpaperDaemon::loop, this);
+    m_applyThread = std::thread(&WallpaperDaemon::applyLoop, this);
+}
+
+void WallpaperDaemon::stop() {
+    m_stopping = true;
+    if (m_wakeFd >= 0) {
+        const uint64_t one = 1;
+        (void)::write(m_wakeFd, &one, sizeof(one));
+    }
+    if (m_loopThread.joinable()) {
+        m_loopThread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_applyMutex);
+        m_applyQueue.clear();
+    }
+    m_applyReady.notify_all();
+    if (m_applyThread.joinable()) {
+        m_applyThread.join();
+    }
+    m_completed.clear();
+    m_stateSegment.close();
+    m_thumbnails.reset();       // Before m_wakeFd closes: decodes still running stop reporting
+    m_thumbnailWaiters.clear();
+
+    for (const int fd : {m_listenFd, m_epollFd, m_wakeFd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (m_listenFd >= 0 && !m_handedOff) {
+        ::unlink(m_socketPath.c_str());     // After a handoff the path belongs to the new daemon
+    }
+    m_listenFd = -1;
+    m_epollFd = -1;
+    m_wakeFd = -1;
+}
+
+bool WallpaperDaemon::isRunning() const {
+    return m_listenFd >= 0 && !m_stopping;
+}
+
+bool WallpaperDaemon::hasHandedOff() const {
+    return m_handedOff;
+}
+
+const std::string& WallpaperDaemon::getSocketPath() const {
+    return m_socketPath;
+}
+
+WallpaperDaemon::Stats WallpaperDaemon::getStats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+std::string WallpaperDaemon::getLastError() const {
+    return m_lastError;
+}
+
+WallpaperDaemon::ErrorCode WallpaperDaemon::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void WallpaperDaemon::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+void WallpaperDaemon::loop() {
+    // Clients adopted by takeOver() may already hold complete requests or unsent replies
+    std::vector<uint64_t> adopted;
+    for (const auto& [id, client] : m_clients) {
+        adopted.push_back(id);
+    }
+    for (const uint64_t id : adopted) {
+        if (flushClient(id)) {
+            processInput(id);
+        }
+    }
+
+    publishState(true);
+
+    epoll_event events[MAX_EPOLL_EVENTS];
+    while (!m_stopping) {
+        const int count = ::epoll_wait(m_epollFd, events, MAX_EPOLL_EVENTS, -1);
+        if (count < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < count && !m_stopping; ++i) {
+            const uint64_t id = events[i].data.u64;
+            if (id == LISTEN_ID) {
+                acceptClients();
+            } else if (id == WAKE_ID) {
+                uint64_t value = 0;
+                (void)::read(m_wakeFd, &value, sizeof(value));
+                completeApplies();
+                completeThumbnails();
+            } else {
+                const auto it = m_clients.find(id);
+                if (it == m_clients.end()) {
+                    continue;
+                }
+                if (it->second.closing && (events[i].events & (EPOLLHUP | EPOLLERR))) {
+                    closeClient(id);    // Gone entirely; its replies cannot be delivered
+                    continue;
+                }
+                if (!it->second.closing && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP))) {
+                    readClient(id);
+                }
+                if ((events[i].events & EPOLLOUT) && m_clients.count(id)) {
+                    flushClient(id);
+                }
+            }
+        }
+        if (m_handoffClient != 0 && m_pendingApplies == 0 && m_thumbnails->getStats().pending == 0 && !m_stopping) {
+            handOff();
+        }
+        publishState();
+    }
+    m_stateSegment.retire();
+
+    for (auto& [id, client] : m_clients) {
+        ::close(client.fd);
+        for (const auto& [offset, fd] : client.attachments) {
+            ::close(fd);
+        }
+    }
+    m_clients.clear();
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.clients = 0;
+}
+
+void WallpaperDaemon::acceptClients() {
+    for (;;) {
+        const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;     // EAGAIN: accepted everything pending
+        }
+        const uint64_t id = m_nextClient++;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = id;
+        if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        m_clients[id].fd = fd;
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        ++m_stats.connections;
+        m_stats.clients = m_clients.size();
+    }
+}
+
+void WallpaperDaemon::readClient(uint64_t id) {
+    auto it = m_clients.find(id);
+    if (it == m_clients.end()) {
+        return;
+    }
+    char buffer[16384];
+    bool hungUp = false;
+    for (;;) {
+        const ssize_t count = ::recv(it->second.fd, buffer, sizeof(buffer), 0);
+        if (count > 0) {
+            it->second.input.append(buffer, static_cast<size_t>(count));
+            continue;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        hungUp = count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+
+    processInput(id);
+    it = m_clients.find(id);
+    if (it == m_clients.end()) {
+        return;
+    }
+    if (it->second.input.size() > MAX_REQUEST_BYTES && it->second.input.find('\n') == std::string::npos) {
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            ++m_stats.droppedClients;
+        }
+        send(id, errorReply("Request longer than " + std::to_string(MAX_REQUEST_BYTES) + " bytes"));
+        flushClient(id);
+        closeClient(id);
+        return;
+    }
+    // A client that sent its requests and shut down writing still gets its replies
+    if (hungUp) {
+        Client& client = it->second;
+        if (client.busy || !client.output.empty()) {
+            client.closing = true;
+            client.subscribed = false;
+            epoll_event event{};
+            event.events = client.writable ? 0u : static_cast<uint32_t>(EPOLLOUT);
+            event.data.u64 = id;
+            ::epoll_ctl(m_epollFd, EPOLL_CTL_MOD, client.fd, &event);
+        } else {
+            closeClient(id);
+        }
+    }
+}
+
+void WallpaperDaemon::processInput(uint64_t id) {
+    for (;;) {
+        auto it = m_clients.find(id);
+        if (it == m_clients.end() || it->second.busy || m_handoffClient != 0) {
+            return;     // While handing off, requests stay queued for the new daemon
+        }
+        std::string& input = it->second.input;
+        const size_t end = input.find('\n');
+        if (end == std::string::npos) {
+            return;
+        }
+        std::string line = input.substr(0, end);
+        input.erase(0, end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(m_statsMutex);
+                ++m_stats.requests;
+            }
+            handleRequest(id, line);
+        }
+    }
+}
+
+void WallpaperDaemon::handleRequest(uint64_t id, const std::string& line) {
+    const std::vector<std::string> words = splitRequest(line, 2);
+    const std::string command = words.empty() ? std::string() : words.front();
+
+    if (command == "ping") {
+        send(id, okReply());
+    } else if (command == "status") {
+        nlohmann::json reply;
+        reply["ok"] = true;
+        reply["generation"] = m_generation;
+        reply["assignments"] = nlohmann::json::array();
+        for (const auto& [monitor, assignment] : m_assignments) {
+            if (!assignment.path.empty()) {
+                reply["assignments"].push_back({{"monitor", monitor}, {"path", assignment.path}, {"mode", assignment.mode},
+                                                {"generation", assignment.generation}});
+            }
+        }
+        reply["clients"] = m_clients.size();
+        send(id, reply.dump());
+    } else if (command == "get") {
+        const std::vector<std::string> fields = splitRequest(line, 2);
+        const auto it = fields.size() == 2 ? m_assignments.find(fields[1]) : m_assignments.end();
+        if (fields.size() != 2) {
+            send(id, errorReply("Usage: get MONITOR"));
+        } else if (it == m_assignments.end() || it->second.path.empty()) {
+            // The generation still matters to "if GEN": a mode may have been written already
+            nlohmann::json reply = nlohmann::json::parse(errorReply("No wallpaper on " + fields[1]));
+            reply["generation"] = it == m_assignments.end() ? 0 : it->second.generation;
+            send(id, reply.dump());
+        } else {
+            nlohmann::json reply = {{"ok", true}, {"monitor", it->first}, {"path", it->second.path}, {"mode", it->second.mode},
+                                    {"generation", it->second.generation}};
+            send(id, reply.dump());
+        }
+    } else if (command == "set" || command == "mode" || command == "if") {
+        handleWrite(id, line);
+    } else if (command == "subscribe") {
+        m_clients[id].subscribed = true;
+        send(id, okReply());
+    } else if (command == "state") {
+        if (!m_stateSegment.isOpen()) {
+            send(id, errorReply("No state segment: " + m_stateSegment.getLastError()));
+        } else {
+            nlohmann::json reply = {{"ok", true}, {"bytes", StateSegment::SEGMENT_BYTES}, {"fd", true},
+                                    {"version", StateSegment::FORMAT_VERSION}};
+            if (!sendAttached(id, reply.dump(), m_stateSegment.getFd())) {
+                send(id, errorReply(std::string("Cannot pass the state segment: ") + std::strerror(errno)));
+            }
+        }
+    } else if (command == "thumbnail") {
+        handleThumbnail(id, line);
+    } else if (command == "handoff") {
+        beginHandoff(id);
+    } else {
+        send(id, errorReply("Unknown command '" + command + "'"));
+    }
+}
+
+void WallpaperDaemon::handleWrite(uint64_t id, const std::string& line) {
+    std::string request = line;
+    bool conditional = false;
+    uint64_t expected = 0;
+    if (line.compare(0, 3, "if ") == 0) {
+        const std::vector<std::string> fields = splitRequest(line, 3);
+        if (fields.size() != 3 || fields[1].size() > 19 || fields[1].find_first_not_of("0123456789") != std::string::npos) {
+            send(id, errorReply("Usage: if GENERATION set|mode MONITOR ..."));
+            return;
+        }
+        conditional = true;
+        expected = std::stoull(fields[1]);
+        request = fields[2];
+    }
+
+    const std::vector<std::string> fields = splitRequest(request, 3);
+    const std::string command = fields.empty() ? std::string() : fields.front();
+    if (command == "set" && fields.size() != 3) {
+        send(id, errorReply("Usage: set MONITOR PATH"));
+        return;
+    }
+    if (command == "mode" && (fields.size() != 3 || !isMode(fields[2]))) {
+        send(id, errorReply("Usage: mode MONITOR Stretch|Center|Tile|Scale"));
+        return;
+    }
+    if (command != "set" && command != "mode") {
+        send(id, errorReply("Only set and mode can be conditional"));
+        return;
+    }
+
+    // Checked against committed state only: wait for the monitor's apply in flight
+    const std::string& monitor = fields[1];
+    if (m_monitorApplies.count(monitor)) {
+        m_clients[id].busy = true;
+        m_deferred[monitor].emplace_back(id, line);
+        return;
+    }
+    const auto it = m_assignments.find(monitor);
+    const uint64_t current = it != m_assignments.end() ? it->second.generation : 0;
+    if (conditional && current != expected) {
+        nlohmann::json reply = nlohmann::json::parse(errorReply("Generation mismatch on " + monitor));
+        reply["generation"] = current;
+        send(id, reply.dump());
+        return;
+    }
+
+    const std::string path = command == "set" ? fields[2] : (it != m_assignments.end() ? it->second.path : std::string());
+    const std::string mode = command == "mode" ? fields[2] : (it != m_assignments.end() ? it->second.mode : "Stretch");
+    if (path.empty()) {
+        send(id, generationReply(commit(monitor, path, mode)));     // Nothing shown yet; used by the next set
+    } else {
+        queueApply(id, monitor, path, mode);
+    }
+}
+
+void WallpaperDaemon::queueApply(uint64_t id, const std::string& monitor, const std::string& path, const std::string& mode) {
+    m_clients[id].busy = true;
+    ++m_pendingApplies;
+    ++m_monitorApplies[monitor];
+    Apply apply;
+    apply.client = id;
+    apply.monitor = monitor;
+    apply.path = path;
+    apply.mode = mode;
+    {
+        std::lock_guard<std::mutex> lock(m_applyMutex);
+        m_applyQueue.push_back(std::move(apply));
+    }
+    m_applyReady.notify_one();
+}
+
+void WallpaperDaemon::applyLoop() {
+    for (;;) {
+        Apply apply;
+        {
+            std::unique_lock<std::mutex> lock(m_applyMutex);
+            m_applyReady.wait(lock, [this] { return m_stopping || !m_applyQueue.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            apply = std::move(m_applyQueue.front());
+            m_applyQueue.pop_front();
+        }
+
+        // hyprpaper keeps preloaded images, so an image is preloaded once per daemon
+        apply.ok = true;
+        if (m_preloaded.count(apply.path) == 0) {
+            apply.ok = m_hyprpaper.preload(apply.path);
+            if (apply.ok) {
+                m_preloaded.insert(apply.path);
+            }
+        }
+        apply.ok = apply.ok && m_hyprpaper.assign(apply.monitor, HyprpaperClient::modePrefix(apply.mode) + apply.path);
+        if (!apply.ok) {
+            apply.error = m_hyprpaper.getLastError();
+        }
+        CAITHE_LOG_DEBUG("Daemon apply {} on {}: {}", apply.path, apply.monitor, apply.ok ? "ok" : apply.error);
+
+        {
+            std::lock_guard<std::mutex> lock(m_applyMutex);
+            m_completed.push_back(std::move(apply));
+        }
+        const uint64_t one = 1;
+        (void)::write(m_wakeFd, &one, sizeof(one));
+    }
+}
+
+void WallpaperDaemon::completeApplies() {
+    std::vector<Apply> completed;
+    {
+        std::lock_guard<std::mutex> lock(m_applyMutex);
+        completed.swap(m_completed);
+    }
+    for (const Apply& apply : completed) {
+        --m_pendingApplies;
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            ++(apply.ok ? m_stats.applies : m_stats.applyFailures);
+        }
+        const uint64_t generation = apply.ok ? commit(apply.monitor, apply.path, apply.mode) : 0;
+
+        const auto it = m_clients.find(apply.client);
+        if (it != m_clients.end()) {
+            it->second.busy = false;
+            send(apply.client, apply.ok ? generationReply(generation) : errorReply(apply.error));
+        }
+        // Writes that waited for this monitor go before the client's own next request
+        if (--m_monitorApplies[apply.monitor] == 0) {
+            m_monitorApplies.erase(apply.monitor);
+            runDeferred(apply.monitor);
+        }
+        processInput(apply.client);
+    }
+}
+
+void WallpaperDaemon::handleThumbnail(uint64_t id, const std::string& line) {
+    const std::vector<std::string> fields = splitRequest(line, 3);
+    char* end = nullptr;
+    errno = 0;
+    const int64_t modified = fields.size() == 3 ? std::strtoll(fields[1].c_str(), &end, 10) : 0;
+    if (fields.size() != 3 || end == fields[1].c_str() || *end != '\0' || errno == ERANGE || fields[2][0] != '/') {
+        send(id, errorReply("Usage: thumbnail MODIFIED /PATH"));
+        return;
+    }
+    const std::string& path = fields[2];
+
+    if (const auto buffer = m_thumbnails->find(path, modified)) {
+        nlohmann::json reply = thumbnailFields(path, modified, *buffer);
+        reply["ok"] = true;
+        if (!sendAttached(id, reply.dump(), buffer->fd)) {
+            send(id, errorReply(std::string("Cannot pass the thumbnail: ") + std::strerror(errno)));
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        ++m_stats.thumbnails;
+    } else if (m_thumbnails->hasFailed(path, modified)) {
+        nlohmann::json reply = nlohmann::json::parse(errorReply("Cannot decode " + path));
+        reply["failed"] = true;     // Unlike a full queue, asking again will not help
+        send(id, reply.dump());
+    } else if (!m_thumbnails->queue(path, modified)) {
+        send(id, errorReply("Too many thumbnails pending"));
+    } else {
+        m_thumbnailWaiters[{path, modified}].insert(id);
+        send(id, nlohmann::json{{"ok", true}, {"pending", true}}.dump());
+    }
+}
+
+void WallpaperDaemon::completeThumbnails() {
+    for (const ThumbnailService::Completion& completion : m_thumbnails->takeCompleted()) {
+        const auto waiting = m_thumbnailWaiters.find({completion.path, completion.modified});
+        if (waiting == m_thumbnailWaiters.end()) {
+            continue;
+        }
+        const std::string failed = nlohmann::json{{"event", "thumbnail"}, {"failed", true}, {"path", completion.path},
+                                                  {"modified", completion.modified}}.dump();
+        std::string ready;
+        if (completion.buffer) {
+            nlohmann::json event = thumbnailFields(completion.path, completion.modified, *completion.buffer);
+            event["event"] = "thumbnail";
+            ready = event.dump();
+        }
+        for (const uint64_t id : waiting->second) {
+            if (!m_clients.count(id)) {
+                continue;
+            }
+            // Out of descriptors, the client still hears back rather than waiting forever
+            if (!completion.buffer || !sendAttached(id, ready, completion.buffer->fd)) {
+                send(id, failed);
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            ++m_stats.thumbnails;
+        }
+        m_thumbnailWaiters.erase(waiting);
+    }
+}
+
+uint64_t WallpaperDaemon::commit(const std::string& monitor, const std::string& path, const std::string& mode) {
+    Assignment& assignment = m_assignments[monitor];
+    nlohmann::json event = {{"event", "wallpaper"}, {"generation", ++m_generation}, {"monitor", monitor}};
+    const bool created = assignment.generation == 0;
+    if (created || assignment.path != path) {
+        event["path"] = path;
+    }
+    if (created || assignment.mode != mode) {
+        event["mode"] = mode;
+    }
+    assignment.path = path;
+    assignment.mode = mode;
+    assignment.generation = m_generation;
+    broadcast(event.dump());
+    return m_generation;
+}
+
+void WallpaperDaemon::runDeferred(const std::string& monitor) {
+    for (;;) {
+        const auto waiting = m_deferred.find(monitor);
+        if (waiting == m_deferred.end() || m_monitorApplies.count(monitor)) {
+            return;
+        }
+        if (waiting->second.empty()) {
+            m_deferred.erase(waiting);
+            return;
+        }
+        const auto [id, line] = waiting->second.front();
+        waiting->second.pop_front();
+        const auto it = m_clients.find(id);
+        if (it == m_clients.end()) {
+            continue;
+        }
+        it->second.busy = false;
+        handleWrite(id, line);
+        processInput(id);
+    }
+}
+
+void WallpaperDaemon::send(uint64_t id, const std::string& line) {
+    auto it = m_clients.find(id);
+    if (it == m_clients.end()) {
+        return;
+    }
+    it->second.output += line;
+    it->second.output += '\n';
+    if (it->second.output.size() > MAX_PENDING_OUTPUT) {
+        CAITHE_LOG_WARNING("Control client {} stopped reading; disconnected", id);
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            ++m_stats.droppedClients;
+        }
+        closeClient(id);
+        return;
+    }
+    if (it->second.writable) {
+        flushClient(id);
+    }
+}
+
+// `line` goes out carrying a duplicate of `fd`, which stays open until it is sent; false when it cannot be duplicated
+bool WallpaperDaemon::sendAttached(uint64_t id, const std::string& line, int fd) {
+    const auto it = m_clients.find(id);
+    if (it == m_clients.end()) {
+        return true;
+    }
+    const int copy = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0) {
+        return false;
+    }
+    it->second.attachments.emplace_back(it->second.output.size(), copy);
+    send(id, line);
+    return true;
+}
+
+bool WallpaperDaemon::flushClient(uint64_t id) {
+    auto it = m_clients.find(id);
+    if (it == m_clients.end()) {
+        return false;
+    }
+    Client& client = it->second;
+    size_t written = 0;
+    while (written < client.output.size()) {
+        // A line with a descriptor goes out in a send of its own, carrying it
+        const bool attach = !client.attachments.empty() && client.attachments.front().first == written;
+        const size_t next = attach ? 1 : 0;
+        const size_t end = client.attachments.size() > next ? client.attachments[next].first : client.output.size();
+        const ssize_t count = attach ? sendWithDescriptor(client.fd, client.output.data() + written, end - written,
+                                                          client.attachments.front().second)
+                                     : ::send(client.fd, client.output.data() + written, end - written,
+                                              MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (count > 0) {
+            if (attach) {
+                ::close(client.attachments.front().second);
+                client.attachments.pop_front();
+            }
+            written += static_cast<size_t>(count);
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            closeClient(id);
+            return false;
+        }
+    }
+    client.output.erase(0, written);
+    for (auto& [offset, fd] : client.attachments) {
+        offset -= written;
+    }
+
+    const bool pending = !client.output.empty();
+    if (client.closing && !pending && !client.busy && client.input.find('\n') == std::string::npos) {
+        closeClient(id);
+        return false;
+    }
+    // Arm EPOLLOUT only while output is pending
+    if (pending == client.writable) {
+        client.writable = !pending;
+        epoll_event event{};
+        const uint32_t reading = client.closing ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP);
+        event.events = reading | (pending ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        event.data.u64 = id;
+        ::epoll_ctl(m_epollFd, EPOLL_CTL_MOD, client.fd, &event);
+    }
+    return true;
+}
+
+void WallpaperDaemon::closeClient(uint64_t id) {
+    auto it = m_clients.find(id);
+    if (it == m_clients.end()) {
+        return;
+    }
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    ::close(it->second.fd);
+    for (const auto& [offset, fd] : it->second.attachments) {
+        ::close(fd);
+    }
+    m_clients.erase(it);
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.clients = m_clients.size();
+    }
+    if (id == m_handoffClient) {
+        CAITHE_LOG_WARNING("New daemon went away during the handoff; still serving {}", m_socketPath);
+        m_handoffClient = 0;
+        resumeService();
+    }
+}
+
+void WallpaperDaemon::broadcast(const std::string& line) {
+    std::vector<uint64_t> subscribers;
+    for (const auto& [id, client] : m_clients) {
+        if (client.subscribed) {
+            subscribers.push_back(id);
+        }
+    }
+    for (const uint64_t id : subscribers) {
+        send(id, line);
+    }
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.events += subscribers.size();
+}
+
+void WallpaperDaemon::beginHandoff(uint64_t id) {
+    if (m_handoffClient != 0) {
+        send(id, errorReply("Handoff already in progress"));
+        return;
+    }
+    // New connections wait in the backlog of the listening socket, which the new daemon inherits
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_listenFd, nullptr);
+    m_handoffClient = id;
+    m_clients[id].subscribed = false;
+    CAITHE_LOG_INFO("Handing off {} once {} applies finish", m_socketPath, m_pendingApplies);
+}
+
+void WallpaperDaemon::handOff() {
+    const uint64_t handoffId = m_handoffClient;
+    Client& channelClient = m_clients[handoffId];
+    HandoffChannel channel(channelClient.fd, std::move(channelClient.input));
+
+    nlohmann::json snapshot;
+    snapshot["version"] = HANDOFF_VERSION;
+    snapshot["generation"] = m_generation;
+    snapshot["assignments"] = nlohmann::json::array();
+    for (const auto& [monitor, assignment] : m_assignments) {
+        snapshot["assignments"].push_back({{"monitor", monitor}, {"path", assignment.path}, {"mode", assignment.mode},
+                                           {"generation", assignment.generation}});
+    }
+    // No apply is running, and the last one was handed over under m_applyMutex
+    snapshot["preloaded"] = m_preloaded;
+    // Descriptors of unsent replies follow the client sockets; a state segment among them is
+    // retired once this daemon stops, and its reader asks the new one again
+    snapshot["clients"] = nlohmann::json::array();
+    std::vector<int> fds = { m_listenFd };
+    std::vector<int> attached;
+    std::vector<uint64_t> passed;
+    for (const auto& [id, client] : m_clients) {
+        if (id == handoffId) {
+            continue;
+        }
+        fds.push_back(client.fd);
+        passed.push_back(id);
+        nlohmann::json offsets = nlohmann::json::array();
+        for (const auto& [offset, fd] : client.attachments) {
+            offsets.push_back(offset);
+            attached.push_back(fd);
+        }
+        snapshot["clients"].push_back({{"input", toBinary(client.input)}, {"output", toBinary(client.output)},
+                                       {"subscribed", client.subscribed}, {"closing", client.closing},
+                                       {"attachments", offsets}});
+    }
+    fds.insert(fds.end(), attached.begin(), attached.end());
+    const std::vector<uint8_t> payload = nlohmann::json::to_cbor(snapshot);
+    const nlohmann::json header = {{"ok", true}, {"bytes", payload.size()}, {"fds", fds.size()}};
+
+    std::string line;
+    const bool committed = channel.send(header.dump() + "\n") && channel.send(payload.data(), payload.size()) &&
+                           channel.readLine(line) && line == "ready" && channel.sendFds(fds) &&
+                           channel.readLine(line) && line == "ok";
+    if (!committed) {
+        closeClient(handoffId);     // Resumes service
+        return;
+    }
+
+    // The new daemon holds duplicates of every socket; closing ours does not disturb the peers
+    m_handoffClient = 0;
+    for (const uint64_t id : passed) {
+        ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_clients[id].fd, nullptr);
+        ::close(m_clients[id].fd);
+        for (const auto& [offset, fd] : m_clients[id].attachments) {
+            ::close(fd);
+        }
+        m_clients.erase(id);
+    }
+    closeClient(handoffId);
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.clients = 0;
+    }
+    CAITHE_LOG_INFO("Handed {} and {} clients to the new daemon", m_socketPath, passed.size());
+    m_handedOff = true;
+    m_stopping = true;
+}
+
+void WallpaperDaemon::publishState(bool force) {
+    if (!m_stateSegment.isOpen()) {
+        return;
+    }
+    const Stats stats = getStats();
+    const StateSegment::Counters counters = { stats.connections, stats.requests, stats.applies, stats.applyFailures,
+                                              stats.events, stats.droppedClients, stats.clients };
+    if (!force && m_publishedGeneration == m_generation &&
+        std::memcmp(&counters, &m_publishedCounters, sizeof(counters)) == 0) {
+        return;
+    }
+
+    StateSegment::Snapshot snapshot;
+    snapshot.generation = m_generation;
+    snapshot.counters = counters;
+    for (const auto& [monitor, assignment] : m_assignments) {
+        if (!assignment.path.empty()) {
+            snapshot.assignments.push_back({monitor, assignment.path, assignment.mode, assignment.generation});
+        }
+    }
+    if (!m_stateSegment.publish(snapshot)) {
+        CAITHE_LOG_WARNING("State segment not updated: {}", m_stateSegment.getLastError());
+    }
+    m_publishedGeneration = m_generation;
+    m_publishedCounters = counters;
+}
+
+void WallpaperDaemon::resumeService() {
+    epoll_event listenEvent{};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.u64 = LISTEN_ID;
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &listenEvent);
+    std::vector<uint64_t> ids;
+    for (const auto& [id, client] : m_clients) {
+        ids.push_back(id);
+    }
+    for (const uint64_t id : ids) {
+        processInput(id);
+    }
+}
+
+bool WallpaperDaemon::setError(ErrorCode code, const std::string& message) {
+    m_lastErrorCode = code;
+    m_lastError = message;
+    return false;
+}
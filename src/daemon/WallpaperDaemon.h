@@ -0,0 +1,233 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: WallpaperDaemon.h
+ * Description: Headless wallpaper daemon serving a line-based control socket
+ *
+ * Protocol (one request per line, one JSON object per reply line):
+ * - ping                   -> {"ok":true}
+ * - status                 -> {"ok":true,"generation","assignments":[{"monitor","path","mode","generation"}...],
+ *                              "clients":N}
+ * - get MONITOR            -> {"ok":true,"monitor","path","mode","generation"} or {"ok":false,"error"}
+ * - set MONITOR PATH       -> {"ok":true,"generation"} once hyprpaper has shown it (PATH may hold spaces)
+ * - mode MONITOR MODE      -> {"ok":true,"generation"}; Stretch, Center, Tile or Scale, reapplied when shown
+ * - if GEN set|mode ...    -> as above, but only when MONITOR is still at generation GEN (0 = never
+ *                             written); otherwise {"ok":false,"error","generation":current}
+ * - subscribe              -> {"ok":true}, then {"event":"wallpaper","generation","monitor",...}
+ *                             after every change, holding only the fields that changed
+ * - state                  -> {"ok":true,"bytes":N,"fd":true,"version":V}, with the StateSegment memfd
+ *                             attached over SCM_RIGHTS; see StateSegment.h
+ * - thumbnail MODIFIED PATH -> {"ok":true,"fd":true,"format":"RGBA","width","height","sourceWidth",...} with
+ *                             the sealed pixel memfd attached when it is resident; otherwise
+ *                             {"ok":true,"pending":true}, then {"event":"thumbnail","fd":true,...} once
+ *                             decoded or {"event":"thumbnail","failed":true,...}. A file that already
+ *                             failed gets {"ok":false,"error","failed":true}; see ThumbnailService.h
+ * - handoff                -> sent by takeOver() in the upgraded binary, see below
+ *
+ * Generations:
+ * - Every committed write takes the next daemon-wide generation, and the monitor it wrote
+ *   remembers it; events go out in generation order, one per write
+ * - A client caching state from status applies each event whose generation is one past its
+ *   own, and re-reads status on a gap; "if GEN" turns a read-modify-write into a compare-and-set
+ * - Writes to one monitor are evaluated one at a time: a write arriving while that monitor has
+ *   an apply in flight waits for it, so its condition is checked against committed state.
+ *   Writes to other monitors are not held up
+ *
+ * Strategy:
+ * - One epoll thread owns every connection and all state, so queries never lock and are
+ *   answered straight from memory
+ * - Applies (hyprpaper round trips) run on a separate thread, in arrival order; the result
+ *   comes back through an eventfd, and only then does the state change and the event go out
+ * - A client's requests are answered in order: while its apply is in flight, the rest of
+ *   its input waits, but other clients keep being served
+ * - Thumbnails are decoded on a TaskScheduler and reported through the same eventfd; only
+ *   the clients that asked for one get its event, whether or not they subscribed
+ * - Output is buffered per client; a subscriber that lets MAX_PENDING_OUTPUT bytes pile up
+ *   is disconnected rather than letting it grow the daemon without bound
+ * - After each loop iteration that changed the assignments or the counters, the state is
+ *   republished to the shared segment, so local readers never need a round trip to poll
+ *
+ * Upgrade handoff (caithe --daemon --upgrade):
+ * - The new binary connects and sends "handoff"; the running daemon stops accepting and
+ *   stops reading requests, and lets the applies and thumbnail decodes already queued
+ *   finish
+ * - It then replies with a header line and a CBOR snapshot: assignments, the images hyprpaper
+ *   already holds, and every client's unread input, unsent output and subscription
+ * - On "ready" it passes the listening socket, every client socket and the descriptors still
+ *   attached to unsent replies over SCM_RIGHTS; on "ok" it closes its copies and exits
+ *   without unlinking the socket
+ * - Connections arriving meanwhile wait in the listen backlog, so clients never see a gap;
+ *   if the new binary fails before "ok", the running daemon resumes as if nothing happened
+ * - The old state segment is retired; its readers fetch the new daemon's with "state"
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../core/HyprpaperClient.h"
+#include "StateSegment.h"
+#include "ThumbnailService.h"
+
+class WallpaperDaemon {
+public:
+    static constexpr size_t MAX_REQUEST_BYTES = 8192;
+    static constexpr size_t MAX_PENDING_OUTPUT = 1024 * 1024;   // Per client
+    static constexpr int MAX_EPOLL_EVENTS = 64;
+    static constexpr uint32_t HANDOFF_VERSION = 3;
+    static constexpr int HANDOFF_TIMEOUT_MS = 10000;            // Per handoff step, including the drain
+    static constexpr size_t MAX_HANDOFF_BYTES = 256 * 1024 * 1024;
+    static constexpr size_t THUMBNAIL_THREADS = 2;
+
+    WallpaperDaemon();
+    ~WallpaperDaemon();
+
+    WallpaperDaemon(const WallpaperDaemon&) = delete;
+    WallpaperDaemon& operator=(const WallpaperDaemon&) = delete;
+
+    // hyprpaper socket for applies; empty selects the running instance's
+    void setBackendSocket(const std::string& path);
+
+    // Listen on `socketPath` (empty = defaultSocketPath()) and serve on background threads
+    bool start(const std::string& socketPath = "");
+
+    // Take the listening socket, clients and state over from the daemon serving `socketPath`
+    bool takeOver(const std::string& socketPath = "");
+
+    void stop();
+    bool isRunning() const;
+    bool hasHandedOff() const;      // Stopped because a newer daemon took over
+    const std::string& getSocketPath() const;
+
+    // $XDG_RUNTIME_DIR/caithe.sock, or /tmp/caithe-UID.sock without a runtime directory
+    static std::string defaultSocketPath();
+
+    struct Stats {
+        uint64_t connections = 0;       // Accepted since start
+        uint64_t requests = 0;
+        uint64_t applies = 0;
+        uint64_t applyFailures = 0;
+        uint64_t events = 0;            // Event lines queued to subscribers
+        uint64_t thumbnails = 0;        // Thumbnail buffers passed to clients
+        uint64_t droppedClients = 0;    // Disconnected for oversized requests or unread output
+        size_t clients = 0;             // Connected now
+        size_t adoptedClients = 0;      // Received from the previous daemon by takeOver()
+    };
+    Stats getStats() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        ListenFailed = 1,
+        AlreadyRunning = 2,
+        HandoffFailed = 3
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    struct Client {
+        int fd = -1;
+        std::string input;
+        std::string output;
+        bool subscribed = false;
+        bool busy = false;          // Waiting for an apply; later requests stay queued
+        bool writable = true;       // False while EPOLLOUT is armed
+        bool closing = false;       // Peer stopped sending; closed once its replies are out
+        std::deque<std::pair<size_t, int>> attachments;     // Output offsets sent with an owned fd attached
+    };
+
+    struct Assignment {
+        std::string path;
+        std::string mode = "Stretch";
+        uint64_t generation = 0;    // Of the last write; 0 = never written
+    };
+
+    struct Apply {
+        uint64_t client = 0;
+        std::string monitor;
+        std::string path;
+        std::string mode;
+        bool ok = false;
+        std::string error;
+    };
+
+    bool setUpLoop();
+    void startThreads();
+    void loop();
+    void applyLoop();
+    void acceptClients();
+    void readClient(uint64_t id);
+    void processInput(uint64_t id);
+    void handleRequest(uint64_t id, const std::string& line);
+    void completeApplies();
+    void handleThumbnail(uint64_t id, const std::string& line);
+    void completeThumbnails();
+    void handleWrite(uint64_t id, const std::string& line);
+    void queueApply(uint64_t id, const std::string& monitor, const std::string& path, const std::string& mode);
+    uint64_t commit(const std::string& monitor, const std::string& path, const std::string& mode);
+    void runDeferred(const std::string& monitor);
+    void send(uint64_t id, const std::string& line);
+    bool sendAttached(uint64_t id, const std::string& line, int fd);
+    bool flushClient(uint64_t id);
+    void closeClient(uint64_t id);
+    void broadcast(const std::string& line);
+    void publishState(bool force = false);
+    void beginHandoff(uint64_t id);
+    void handOff();
+    void resumeService();
+    bool setError(ErrorCode code, const std::string& message);
+
+    std::string m_socketPath;
+    int m_listenFd;
+    int m_epollFd;
+    int m_wakeFd;
+    std::thread m_loopThread;
+    std::atomic<bool> m_stopping;
+    std::atomic<bool> m_handedOff;
+
+    // Loop thread only
+    std::unordered_map<uint64_t, Client> m_clients;
+    uint64_t m_nextClient;
+    std::map<std::string, Assignment> m_assignments;
+    uint64_t m_generation;
+    std::map<std::string, size_t> m_monitorApplies;                                  // In flight per monitor
+    std::map<std::string, std::deque<std::pair<uint64_t, std::string>>> m_deferred;  // Writes waiting for them
+    size_t m_pendingApplies;        // Queued or running; a handoff waits for zero
+    uint64_t m_handoffClient;       // Connection of the new daemon while draining, else 0
+    StateSegment m_stateSegment;
+    uint64_t m_publishedGeneration;
+    StateSegment::Counters m_publishedCounters;
+    std::unique_ptr<ThumbnailService> m_thumbnails;
+    std::map<std::pair<std::string, int64_t>, std::unordered_set<uint64_t>> m_thumbnailWaiters;
+
+    // Thumbnail decodes; completions come back through m_wakeFd
+    std::unique_ptr<TaskScheduler> m_scheduler;
+
+    // Apply thread; the queue and completions are shared with the loop thread
+    HyprpaperClient m_hyprpaper;
+    std::unordered_set<std::string> m_preloaded;
+    std::thread m_applyThread;
+    std::mutex m_applyMutex;
+    std::condition_variable m_applyReady;
+    std::deque<Apply> m_applyQueue;
+    std::vector<Apply> m_completed;
+
+    mutable std::mutex m_statsMutex;
+    Stats m_stats;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
@@ -0,0 +1,39 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ImageBuffer.h
+ * Description: Owned 8-bit pixel buffer shared by the imaging decoders
+ *
+ * Memory Layout:
+ * - Rows are stored top to bottom, each row is `stride` bytes long
+ * - Pixels are interleaved 8-bit channels (1 = gray, 2 = gray+alpha, 3 = RGB, 4 = RGBA)
+ * - Byte offset of pixel (x, y) = y * stride + x * channels
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ImageBuffer {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    size_t stride = 0;              // Bytes per row
+    std::vector<uint8_t> pixels;    // height * stride bytes
+
+    bool empty() const { return width <= 0 || height <= 0 || pixels.empty(); }
+
+    // Resize storage for a tightly packed image, reusing existing capacity
+    void allocate(int newWidth, int newHeight, int newChannels) {
+        width = newWidth;
+        height = newHeight;
+        channels = newChannels;
+        stride = static_cast<size_t>(newWidth) * static_cast<size_t>(newChannels);
+        pixels.resize(stride * static_cast<size_t>(newHeight));
+    }
+
+    uint8_t* row(int y) { return pixels.data() + static_cast<size_t>(y) * stride; }
+    const uint8_t* row(int y) const { return pixels.data() + static_cast<size_t>(y) * stride; }
+};
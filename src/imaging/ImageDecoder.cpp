@@ -0,0 +1,192 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ImageDecoder.cpp
+ * Description: Implementation of the format-dispatching image decoder
+ */
+
+#include "ImageDecoder.h"
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+ImageDecoder::ImageDecoder()
+    : m_fileComplete(false)
+    , m_usedFastPath(false)
+    , m_isPreview(false)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+ImageDecoder::~ImageDecoder() = default;
+
+bool ImageDecoder::decodeFile(const std::string& path, ImageBuffer& out, int channels) {
+    clearError();
+
+    if (!readFile(path)) {
+        return false;
+    }
+
+    return decodeMemory(m_fileData.data(), m_fileData.size(), out, channels);
+}
+
+bool ImageDecoder::decodeMemory(const uint8_t* data, size_t size, ImageBuffer& out, int channels) {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+    m_usedFastPath = false;
+    m_isPreview = false;
+
+    if (!data || size == 0 || channels < 3 || channels > 4) {
+        m_lastError = "Invalid decode arguments";
+        m_lastErrorCode = ErrorCode::InvalidArgument;
+        return false;
+    }
+
+    // PNG fast path; a rejected or corrupt PNG still gets a chance with stb_image,
+    // which is more lenient about trailing data and supports 16-bit/interlaced files
+    if (PngDecoder::isPng(data, size)) {
+        if (m_pngDecoder.decode(data, size, out, channels)) {
+            m_usedFastPath = true;
+            return true;
+        }
+    }
+
+    return decodeWithStb(data, size, out, channels);
+}
+
+bool ImageDecoder::decodePreviewFile(const std::string& path, ImageBuffer& out, int channels) {
+    clearError();
+
+    if (!readFile(path, PREVIEW_READ_BYTES)) {
+        return false;
+    }
+
+    // A prefix only ever feeds the DC preview; a full decode of it would show a cut-off image
+    if (JpegPreviewDecoder::isJpeg(m_fileData.data(), m_fileData.size()) && !m_fileComplete) {
+        if (decodeJpegPreview(m_fileData.data(), m_fileData.size(), out, channels)) {
+            return true;
+        }
+
+        // Only a truncated DC scan is worth another attempt with the whole file
+        if (m_jpegPreviewDecoder.getLastErrorCode() != JpegPreviewDecoder::ErrorCode::Truncated) {
+            return decodeFile(path, out, channels);
+        }
+    }
+
+    if (!m_fileComplete && !readFile(path)) {
+        return false;
+    }
+    return decodePreviewMemory(m_fileData.data(), m_fileData.size(), out, channels);
+}
+
+bool ImageDecoder::decodePreviewMemory(const uint8_t* data, size_t size, ImageBuffer& out, int channels) {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+    m_usedFastPath = false;
+    m_isPreview = false;
+
+    if (!data || size == 0 || channels < 3 || channels > 4) {
+        m_lastError = "Invalid decode arguments";
+        m_lastErrorCode = ErrorCode::InvalidArgument;
+        return false;
+    }
+
+    if (JpegPreviewDecoder::isJpeg(data, size)) {
+        if (decodeJpegPreview(data, size, out, channels)) {
+            return true;
+        }
+
+        // A truncated prefix cannot be decoded fully either; let the caller read more
+        if (m_jpegPreviewDecoder.getLastErrorCode() == JpegPreviewDecoder::ErrorCode::Truncated) {
+            return false;
+        }
+    }
+
+    return decodeMemory(data, size, out, channels);
+}
+
+bool ImageDecoder::decodeJpegPreview(const uint8_t* data, size_t size, ImageBuffer& out, int channels) {
+    m_usedFastPath = false;
+    m_isPreview = false;
+
+    if (m_jpegPreviewDecoder.decodePreview(data, size, out, channels)) {
+        m_usedFastPath = true;
+        m_isPreview = true;
+        return true;
+    }
+
+    m_lastError = "JPEG preview failed: " + m_jpegPreviewDecoder.getLastError();
+    m_lastErrorCode = ErrorCode::DecodeFailed;
+    return false;
+}
+
+bool ImageDecoder::usedFastPath() const {
+    return m_usedFastPath;
+}
+
+bool ImageDecoder::isPreview() const {
+    return m_isPreview;
+}
+
+std::string ImageDecoder::getLastError() const {
+    return m_lastError;
+}
+
+ImageDecoder::ErrorCode ImageDecoder::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void ImageDecoder::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool ImageDecoder::readFile(const std::string& path, size_t maxBytes) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        m_lastError = "Failed to open image: " + path;
+        m_lastErrorCode = ErrorCode::FileNotFound;
+        return false;
+    }
+
+    const std::streamsize size = file.tellg();
+    if (size <= 0) {
+        m_lastError = "Empty image file: " + path;
+        m_lastErrorCode = ErrorCode::ReadFailed;
+        return false;
+    }
+
+    // Reuse the file buffer between calls; only grows
+    const size_t readSize = std::min(static_cast<size_t>(size), maxBytes);
+    m_fileData.resize(readSize);
+    m_fileComplete = readSize == static_cast<size_t>(size);
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(m_fileData.data()), static_cast<std::streamsize>(readSize))) {
+        m_lastError = "Failed to read image: " + path;
+        m_lastErrorCode = ErrorCode::ReadFailed;
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageDecoder::decodeWithStb(const uint8_t* data, size_t size, ImageBuffer& out, int channels) {
+    int width = 0;
+    int height = 0;
+    int sourceChannels = 0;
+
+    stbi_uc* pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height,
+                                            &sourceChannels, channels);
+    if (!pixels) {
+        m_lastError = std::string("Failed to decode image: ") + stbi_failure_reason();
+        m_lastErrorCode = ErrorCode::DecodeFailed;
+        return false;
+    }
+
+    out.allocate(width, height, channels);
+    std::memcpy(out.pixels.data(), pixels, out.pixels.size());
+    stbi_image_free(pixels);
+    return true;
+}
@@ -0,0 +1,82 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ImageDecoder.h
+ * Description: Format-dispatching image decoder for previews, thumbnails and pre-rendering
+ *
+ * Dispatch Strategy:
+ * - 8-bit non-interlaced PNG goes through PngDecoder (SIMD unfiltering, pooled scratch)
+ * - Everything else, and any PNG the fast path rejects, is decoded by stb_image
+ * - Preview decodes return a 1/8-scale JPEG image from the DC coefficients of the first
+ *   scan(s) so a progressive file can be shown from a short prefix; callers refine it later
+ *   with a full decodeFile()
+ * - One ImageDecoder per worker thread: file and scratch buffers are reused across calls
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+#include "JpegPreviewDecoder.h"
+#include "PngDecoder.h"
+
+class ImageDecoder {
+public:
+    ImageDecoder();
+    ~ImageDecoder();
+
+    // Disable copy: owns pooled decode buffers
+    ImageDecoder(const ImageDecoder&) = delete;
+    ImageDecoder& operator=(const ImageDecoder&) = delete;
+
+    // Decode operations; `channels` is 3 (RGB) or 4 (RGBA)
+    bool decodeFile(const std::string& path, ImageBuffer& out, int channels = 4);
+    bool decodeMemory(const uint8_t* data, size_t size, ImageBuffer& out, int channels = 4);
+
+    // Low-detail decode for immediate display. JPEG yields a 1/8-scale DC preview read
+    // from the start of the file; other formats fall back to a full decode.
+    bool decodePreviewFile(const std::string& path, ImageBuffer& out, int channels = 4);
+    bool decodePreviewMemory(const uint8_t* data, size_t size, ImageBuffer& out, int channels = 4);
+
+    // Whether the last successful decode used the PNG fast path
+    bool usedFastPath() const;
+
+    // Whether the last successful decode produced a reduced-scale preview
+    bool isPreview() const;
+
+    // Bytes read up front by decodePreviewFile(); progressive DC scans of typical
+    // wallpapers fit well within this, larger files are re-read in full on demand
+    static constexpr size_t PREVIEW_READ_BYTES = 256 * 1024;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        FileNotFound = 1,
+        ReadFailed = 2,
+        DecodeFailed = 3,
+        InvalidArgument = 4
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool readFile(const std::string& path, size_t maxBytes = SIZE_MAX);
+    bool decodeWithStb(const uint8_t* data, size_t size, ImageBuffer& out, int channels);
+    // DC preview only, never a full decode; safe on a prefix of the file
+    bool decodeJpegPreview(const uint8_t* data, size_t size, ImageBuffer& out, int channels);
+
+    PngDecoder m_pngDecoder;
+    JpegPreviewDecoder m_jpegPreviewDecoder;
+    std::vector<uint8_t> m_fileData;
+    bool m_fileComplete;        // Whether m_fileData holds the whole file
+    bool m_usedFastPath;
+    bool m_isPreview;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
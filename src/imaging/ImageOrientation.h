@@ -0,0 +1,64 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ImageOrientation.h
+ * Description: EXIF orientation values and the coordinate mapping they imply
+ *
+ * Mathematical Foundation:
+ * - Each EXIF orientation is one of the 8 symmetries of the rectangle (rotations by
+ *   multiples of 90 degrees, optionally mirrored)
+ * - Values 5-8 transpose the axes, so the displayed image is height x width
+ * - Mapping a stored pixel (u, v) of a w x h image to its displayed position (x, y) is an
+ *   integer affine map: x = x0 + xu * u + xv * v, y = y0 + yu * u + yv * v with entries in
+ *   {-1, 0, 1}, which lets resampling write rotated output with a fixed pointer step
+ */
+
+#pragma once
+
+#include <cstdint>
+
+enum class ImageOrientation : uint8_t {
+    Normal = 1,             // Stored as displayed
+    FlipHorizontal = 2,     // Mirrored left-right
+    Rotate180 = 3,
+    FlipVertical = 4,       // Mirrored top-bottom
+    Transpose = 5,          // Mirrored along the main diagonal
+    Rotate90 = 6,           // Displayed rotated 90 degrees clockwise
+    Transverse = 7,         // Mirrored along the anti-diagonal
+    Rotate270 = 8           // Displayed rotated 90 degrees counter-clockwise
+};
+
+// Whether the orientation swaps width and height
+inline bool orientationSwapsAxes(ImageOrientation orientation) {
+    return static_cast<int>(orientation) >= 5;
+}
+
+// Convert a raw EXIF value, treating anything out of range as Normal
+inline ImageOrientation orientationFromExif(int value) {
+    return (value >= 1 && value <= 8) ? static_cast<ImageOrientation>(value) : ImageOrientation::Normal;
+}
+
+// Stored (u, v) -> displayed (x, y) for a stored image of width x height
+struct OrientationMap {
+    int x0, xu, xv;
+    int y0, yu, yv;
+
+    static OrientationMap forOrientation(ImageOrientation orientation, int width, int height) {
+        const int w = width - 1;
+        const int h = height - 1;
+        switch (orientation) {
+            case ImageOrientation::FlipHorizontal: return {w, -1, 0, 0, 0, 1};
+            case ImageOrientation::Rotate180:      return {w, -1, 0, h, 0, -1};
+            case ImageOrientation::FlipVertical:   return {0, 1, 0, h, 0, -1};
+            case ImageOrientation::Transpose:      return {0, 0, 1, 0, 1, 0};
+            case ImageOrientation::Rotate90:       return {h, 0, -1, 0, 1, 0};
+            case ImageOrientation::Transverse:     return {h, 0, -1, w, -1, 0};
+            case ImageOrientation::Rotate270:      return {0, 0, 1, w, -1, 0};
+            case ImageOrientation::Normal:
+            default:                               return {0, 1, 0, 0, 0, 1};
+        }
+    }
+
+    int mapX(int u, int v) const { return x0 + xu * u + xv * v; }
+    int mapY(int u, int v) const { return y0 + yu * u + yv * v; }
+};
@@ -0,0 +1,392 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ImageProbe.cpp
+ * Description: Implementation of header-only image probing
+ */
+
+#include "ImageProbe.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+inline uint32_t readBigEndian32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline uint16_t readBigEndian16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t readLittleEndian32(const uint8_t* p) {
+    return p[0] | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint16_t readLittleEndian16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t readLittleEndian24(const uint8_t* p) {
+    return p[0] | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16);
+}
+
+const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+
+} // namespace
+
+ImageProbe::ImageProbe()
+    : m_lastErrorCode(ErrorCode::None) {
+}
+
+ImageProbe::~ImageProbe() = default;
+
+bool ImageProbe::probeFile(const std::string& path, ImageHeader& header) {
+    clearError();
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return setError(ErrorCode::FileNotFound, "Failed to open image: " + path);
+    }
+
+    const std::streamsize fileSize = file.tellg();
+    if (fileSize <= 0) {
+        return setError(ErrorCode::ReadFailed, "Empty image file: " + path);
+    }
+
+    // Grow the prefix only while the header is known to continue past it
+    size_t readSize = std::min(static_cast<size_t>(fileSize), PROBE_READ_BYTES);
+    for (;;) {
+        m_buffer.resize(readSize);
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(m_buffer.data()), static_cast<std::streamsize>(readSize))) {
+            return setError(ErrorCode::ReadFailed, "Failed to read image: " + path);
+        }
+
+        if (probeMemory(m_buffer.data(), m_buffer.size(), header)) {
+            return true;
+        }
+        if (m_lastErrorCode != ErrorCode::Truncated || readSize == static_cast<size_t>(fileSize)) {
+            return false;
+        }
+        readSize = std::min(static_cast<size_t>(fileSize), readSize * 4);
+    }
+}
+
+bool ImageProbe::probeMemory(const uint8_t* data, size_t size, ImageHeader& header) {
+    clearError();
+    header = ImageHeader{};
+
+    if (!data || size < 4) {
+        return setError(ErrorCode::Truncated, "Not enough data to identify image");
+    }
+
+    if (size >= 8 && std::memcmp(data, PNG_SIGNATURE, 8) == 0) {
+        return probePng(data, size, header);
+    }
+    if (data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+        return probeJpeg(data, size, header);
+    }
+    if (std::memcmp(data, "GIF8", 4) == 0) {
+        return probeGif(data, size, header);
+    }
+    if (data[0] == 'B' && data[1] == 'M') {
+        return probeBmp(data, size, header);
+    }
+    if (std::memcmp(data, "RIFF", 4) == 0) {
+        return probeWebP(data, size, header);
+    }
+
+    return setError(ErrorCode::UnknownFormat, "Unrecognized image format");
+}
+
+const char* ImageProbe::formatName(ImageFormat format) {
+    switch (format) {
+        case ImageFormat::Png:  return "png";
+        case ImageFormat::Jpeg: return "jpeg";
+        case ImageFormat::Gif:  return "gif";
+        case ImageFormat::Bmp:  return "bmp";
+        case ImageFormat::WebP: return "webp";
+        case ImageFormat::Unknown:
+        default:                return "unknown";
+    }
+}
+
+int ImageProbe::parseExifOrientation(const uint8_t* tiff, size_t size) {
+    if (!tiff || size < 8) {
+        return 0;
+    }
+
+    // TIFF header: byte order mark, magic 42, offset of IFD0
+    bool littleEndian;
+    if (tiff[0] == 'I' && tiff[1] == 'I') {
+        littleEndian = true;
+    } else if (tiff[0] == 'M' && tiff[1] == 'M') {
+        littleEndian = false;
+    } else {
+        return 0;
+    }
+
+    auto read16 = [&](size_t offset) {
+        return littleEndian ? readLittleEndian16(tiff + offset) : readBigEndian16(tiff + offset);
+    };
+    auto read32 = [&](size_t offset) {
+        return littleEndian ? readLittleEndian32(tiff + offset) : readBigEndian32(tiff + offset);
+    };
+
+    if (read16(2) != 42) {
+        return 0;
+    }
+
+    const size_t ifd = read32(4);
+    if (ifd > size - 2) {
+        return 0;
+    }
+
+    // IFD0 entries are 12 bytes: tag, type, count, value/offset
+    const size_t entries = read16(ifd);
+    for (size_t i = 0; i < entries; ++i) {
+        const size_t entry = ifd + 2 + i * 12;
+        if (entry + 12 > size) {
+            break;
+        }
+        if (read16(entry) != 0x0112) {
+            continue;
+        }
+
+        // Orientation is a single SHORT stored inline in the value field
+        const int type = read16(entry + 2);
+        if (type != 3 || read32(entry + 4) < 1) {
+            return 0;
+        }
+        const int value = read16(entry + 8);
+        return (value >= 1 && value <= 8) ? value : 0;
+    }
+
+    return 0;
+}
+
+std::string ImageProbe::getLastError() const {
+    return m_lastError;
+}
+
+ImageProbe::ErrorCode ImageProbe::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void ImageProbe::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool ImageProbe::probePng(const uint8_t* data, size_t size, ImageHeader& header) {
+    header.format = ImageFormat::Png;
+
+    // IHDR must be the first chunk: length(4) type(4) width(4) height(4) ... interlace at 28
+    if (size < 33) {
+        return setError(ErrorCode::Truncated, "Truncated PNG header");
+    }
+    if (readBigEndian32(data + 8) != 13 || std::memcmp(data + 12, "IHDR", 4) != 0) {
+        return setError(ErrorCode::CorruptHeader, "PNG does not start with IHDR");
+    }
+
+    const uint32_t width = readBigEndian32(data + 16);
+    const uint32_t height = readBigEndian32(data + 20);
+    if (width == 0 || height == 0 || width > 0x7FFFFFFFu || height > 0x7FFFFFFFu) {
+        return setError(ErrorCode::CorruptHeader, "Invalid PNG dimensions");
+    }
+    header.width = static_cast<int>(width);
+    header.height = static_cast<int>(height);
+    header.progressive = data[28] == 1;
+
+    // eXIf is ancillary: look for it up to the first IDAT within the data we have
+    size_t offset = 33;
+    while (offset + 8 <= size) {
+        const uint32_t length = readBigEndian32(data + offset);
+        const uint8_t* type = data + offset + 4;
+        if (std::memcmp(type, "IDAT", 4) == 0 || std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        if (length > size - offset - 8) {
+            break;
+        }
+        if (std::memcmp(type, "eXIf", 4) == 0) {
+            header.orientation = orientationFromExif(parseExifOrientation(data + offset + 8, length));
+            break;
+        }
+        offset += 12 + static_cast<size_t>(length);
+    }
+
+    return true;
+}
+
+bool ImageProbe::probeJpeg(const uint8_t* data, size_t size, ImageHeader& header) {
+    header.format = ImageFormat::Jpeg;
+
+    bool exifSeen = false;
+    size_t offset = 2;
+    for (;;) {
+        // Markers are 0xFF followed by a code; any number of 0xFF fill bytes may precede it
+        if (offset >= size) {
+            return setError(ErrorCode::Truncated, "JPEG frame header not found in data");
+        }
+        if (data[offset] != 0xFF) {
+            return setError(ErrorCode::CorruptHeader, "Invalid JPEG marker");
+        }
+        while (offset < size && data[offset] == 0xFF) {
+            ++offset;
+        }
+        if (offset >= size) {
+            return setError(ErrorCode::Truncated, "JPEG frame header not found in data");
+        }
+        const int marker = data[offset++];
+
+        // Standalone markers carry no length
+        if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) {
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) {
+            return setError(ErrorCode::CorruptHeader, "JPEG has no frame header before image data");
+        }
+
+        if (offset + 2 > size) {
+            return setError(ErrorCode::Truncated, "Truncated JPEG segment");
+        }
+        const size_t length = readBigEndian16(data + offset);
+        if (length < 2) {
+            return setError(ErrorCode::CorruptHeader, "Invalid JPEG segment length");
+        }
+        const uint8_t* payload = data + offset + 2;
+        const size_t payloadSize = length - 2;
+
+        // SOFn (excluding DHT 0xC4, JPG 0xC8, DAC 0xCC): precision, height, width, components
+        const bool frame = marker >= 0xC0 && marker <= 0xCF &&
+                           marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (frame) {
+            if (offset + 2 + 5 > size) {
+                return setError(ErrorCode::Truncated, "Truncated JPEG frame header");
+            }
+            header.height = readBigEndian16(payload + 1);
+            header.width = readBigEndian16(payload + 3);
+            header.progressive = marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE;
+            if (header.width == 0 || header.height == 0) {
+                return setError(ErrorCode::CorruptHeader, "Invalid JPEG dimensions");
+            }
+            return true;
+        }
+
+        if (marker == 0xE1 && !exifSeen && payloadSize >= 6) {
+            if (offset + 2 + 6 > size) {
+                return setError(ErrorCode::Truncated, "Truncated JPEG APP1 segment");
+            }
+            if (std::memcmp(payload, "Exif\0\0", 6) == 0) {
+                if (offset + length > size) {
+                    return setError(ErrorCode::Truncated, "Truncated EXIF segment");
+                }
+                exifSeen = true;
+                header.orientation = orientationFromExif(parseExifOrientation(payload + 6, payloadSize - 6));
+            }
+        }
+
+        offset += length;
+    }
+}
+
+bool ImageProbe::probeGif(const uint8_t* data, size_t size, ImageHeader& header) {
+    header.format = ImageFormat::Gif;
+
+    // Logical screen descriptor follows the 6-byte signature
+    if (size < 10) {
+        return setError(ErrorCode::Truncated, "Truncated GIF header");
+    }
+    if (data[4] != '7' && data[4] != '9') {
+        return setError(ErrorCode::CorruptHeader, "Invalid GIF signature");
+    }
+
+    header.width = readLittleEndian16(data + 6);
+    header.height = readLittleEndian16(data + 8);
+    if (header.width == 0 || header.height == 0) {
+        return setError(ErrorCode::CorruptHeader, "Invalid GIF dimensions");
+    }
+    return true;
+}
+
+bool ImageProbe::probeBmp(const uint8_t* data, size_t size, ImageHeader& header) {
+    header.format = ImageFormat::Bmp;
+
+    if (size < 26) {
+        return setError(ErrorCode::Truncated, "Truncated BMP header");
+    }
+
+    // OS/2 BITMAPCOREHEADER uses 16-bit sizes; every later header uses signed 32-bit
+    // values where a negative height marks a top-down bitmap
+    const uint32_t infoSize = readLittleEndian32(data + 14);
+    if (infoSize == 12) {
+        header.width = readLittleEndian16(data + 18);
+        header.height = readLittleEndian16(data + 20);
+    } else if (infoSize >= 40) {
+        const int32_t width = static_cast<int32_t>(readLittleEndian32(data + 18));
+        const int32_t height = static_cast<int32_t>(readLittleEndian32(data + 22));
+        if (width <= 0 || height == INT32_MIN) {
+            return setError(ErrorCode::CorruptHeader, "Invalid BMP dimensions");
+        }
+        header.width = width;
+        header.height = height < 0 ? -height : height;
+    } else {
+        return setError(ErrorCode::CorruptHeader, "Unsupported BMP info header");
+    }
+
+    if (header.width == 0 || header.height == 0) {
+        return setError(ErrorCode::CorruptHeader, "Invalid BMP dimensions");
+    }
+    return true;
+}
+
+bool ImageProbe::probeWebP(const uint8_t* data, size_t size, ImageHeader& header) {
+    if (size < 16 || std::memcmp(data + 8, "WEBP", 4) != 0) {
+        return setError(size < 16 ? ErrorCode::Truncated : ErrorCode::UnknownFormat, "Not a WebP file");
+    }
+    header.format = ImageFormat::WebP;
+
+    if (size < 30) {
+        return setError(ErrorCode::Truncated, "Truncated WebP header");
+    }
+
+    const uint8_t* chunk = data + 12;
+    if (std::memcmp(chunk, "VP8 ", 4) == 0) {
+        // Lossy: 3-byte frame tag, start code 9D 01 2A, then 14-bit width and height
+        if (data[23] != 0x9D || data[24] != 0x01 || data[25] != 0x2A) {
+            return setError(ErrorCode::CorruptHeader, "Invalid VP8 start code");
+        }
+        header.width = readLittleEndian16(data + 26) & 0x3FFF;
+        header.height = readLittleEndian16(data + 28) & 0x3FFF;
+    } else if (std::memcmp(chunk, "VP8L", 4) == 0) {
+        // Lossless: signature 0x2F, then 14-bit (width - 1) and (height - 1)
+        if (data[20] != 0x2F) {
+            return setError(ErrorCode::CorruptHeader, "Invalid VP8L signature");
+        }
+        const uint32_t bits = readLittleEndian32(data + 21);
+        header.width = static_cast<int>((bits & 0x3FFF) + 1);
+        header.height = static_cast<int>(((bits >> 14) & 0x3FFF) + 1);
+    } else if (std::memcmp(chunk, "VP8X", 4) == 0) {
+        // Extended: flags(1) reserved(3), then 24-bit (canvas width - 1) and (height - 1)
+        header.width = static_cast<int>(readLittleEndian24(data + 24) + 1);
+        header.height = static_cast<int>(readLittleEndian24(data + 27) + 1);
+    } else {
+        return setError(ErrorCode::CorruptHeader, "Unknown WebP chunk");
+    }
+
+    if (header.width == 0 || header.height == 0) {
+        return setError(ErrorCode::CorruptHeader, "Invalid WebP dimensions");
+    }
+    return true;
+}
+
+bool ImageProbe::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
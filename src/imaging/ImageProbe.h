@@ -0,0 +1,85 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ImageProbe.h
+ * Description: Header-only image probing: format, dimensions and EXIF orientation without decoding
+ *
+ * Probe Strategy:
+ * - Files are probed from a 64 KiB prefix; JPEGs whose frame header sits behind large
+ *   APPn segments (ICC profiles, EXIF thumbnails) are re-read with a larger prefix
+ * - JPEG orientation comes from the first APP1 "Exif" segment, PNG orientation from eXIf
+ * - Reported display dimensions are post-rotation: orientations 5-8 swap width and height
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ImageOrientation.h"
+
+enum class ImageFormat {
+    Unknown = 0,
+    Png,
+    Jpeg,
+    Gif,
+    Bmp,
+    WebP
+};
+
+struct ImageHeader {
+    ImageFormat format = ImageFormat::Unknown;
+    int width = 0;                  // Stored (encoded) dimensions
+    int height = 0;
+    ImageOrientation orientation = ImageOrientation::Normal;
+    bool progressive = false;       // Progressive JPEG or interlaced PNG/GIF
+
+    // Dimensions as displayed after applying the orientation
+    int displayWidth() const { return orientationSwapsAxes(orientation) ? height : width; }
+    int displayHeight() const { return orientationSwapsAxes(orientation) ? width : height; }
+};
+
+class ImageProbe {
+public:
+    ImageProbe();
+    ~ImageProbe();
+
+    bool probeFile(const std::string& path, ImageHeader& header);
+    bool probeMemory(const uint8_t* data, size_t size, ImageHeader& header);
+
+    static const char* formatName(ImageFormat format);
+
+    // Orientation tag (0x0112) of a TIFF structure as embedded in EXIF; 0 when absent
+    static int parseExifOrientation(const uint8_t* tiff, size_t size);
+
+    // Initial read size for probeFile()
+    static constexpr size_t PROBE_READ_BYTES = 64 * 1024;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        FileNotFound = 1,
+        ReadFailed = 2,
+        UnknownFormat = 3,
+        CorruptHeader = 4,
+        Truncated = 5       // The header continues beyond the supplied data
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool probePng(const uint8_t* data, size_t size, ImageHeader& header);
+    bool probeJpeg(const uint8_t* data, size_t size, ImageHeader& header);
+    bool probeGif(const uint8_t* data, size_t size, ImageHeader& header);
+    bool probeBmp(const uint8_t* data, size_t size, ImageHeader& header);
+    bool probeWebP(const uint8_t* data, size_t size, ImageHeader& header);
+
+    bool setError(ErrorCode code, const std::string& message);
+
+    std::vector<uint8_t> m_buffer;  // Reused file prefix
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
@@ -0,0 +1,496 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: Inflate.cpp
+ * Description: Implementation of the table-driven DEFLATE/zlib decompressor
+ */
+
+#include "Inflate.h"
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+// RFC 1951 section 3.2.5 length and distance tables
+constexpr uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+constexpr uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+constexpr uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+constexpr uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Order in which code length code lengths are transmitted
+constexpr uint8_t CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+inline uint64_t loadLittleEndian64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+inline int reverseBits(int code, int bits) {
+    int result = 0;
+    for (int i = 0; i < bits; ++i) {
+        result = (result << 1) | (code & 1);
+        code >>= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+InflateDecoder::InflateDecoder()
+    : m_in(nullptr)
+    , m_inEnd(nullptr)
+    , m_bits(0)
+    , m_bitCount(0)
+    , m_padBytes(0)
+    , m_outStart(nullptr)
+    , m_out(nullptr)
+    , m_outEnd(nullptr) {
+}
+
+InflateDecoder::~InflateDecoder() = default;
+
+bool InflateDecoder::inflateZlib(const uint8_t* input, size_t inputSize,
+                                 uint8_t* output, size_t outputSize, size_t& written) {
+    clearError();
+    written = 0;
+
+    // zlib header: CMF (method + window) and FLG (check bits + preset dictionary)
+    if (inputSize < 2) {
+        m_lastError = "zlib stream too short";
+        return false;
+    }
+
+    const uint8_t cmf = input[0];
+    const uint8_t flg = input[1];
+    if ((cmf & 0x0F) != 8 || ((cmf << 8) | flg) % 31 != 0) {
+        m_lastError = "Invalid zlib header";
+        return false;
+    }
+    if (flg & 0x20) {
+        m_lastError = "zlib preset dictionaries are not supported";
+        return false;
+    }
+
+    // The Adler-32 trailer is not verified: PNG chunks are already length-delimited and
+    // a corrupt stream is caught by the Huffman/distance validation below
+    return inflateRaw(input + 2, inputSize - 2, output, outputSize, written);
+}
+
+bool InflateDecoder::inflateRaw(const uint8_t* input, size_t inputSize,
+                                uint8_t* output, size_t outputSize, size_t& written) {
+    clearError();
+    written = 0;
+
+    m_in = input;
+    m_inEnd = input + inputSize;
+    m_bits = 0;
+    m_bitCount = 0;
+    m_padBytes = 0;
+    m_outStart = output;
+    m_out = output;
+    m_outEnd = output + outputSize;
+
+    bool finalBlock = false;
+    while (!finalBlock) {
+        refill();
+        finalBlock = takeBits(1) != 0;
+        const uint32_t blockType = takeBits(2);
+
+        bool ok = false;
+        switch (blockType) {
+            case 0:
+                ok = decodeStored();
+                break;
+            case 1:
+                ok = decodeHuffmanBlock(fixedLiteralTable(), fixedDistanceTable());
+                break;
+            case 2:
+                ok = readDynamicTables() && decodeHuffmanBlock(m_literals, m_distances);
+                break;
+            default:
+                m_lastError = "Invalid DEFLATE block type";
+                break;
+        }
+
+        if (!ok) {
+            written = static_cast<size_t>(m_out - m_outStart);
+            return false;
+        }
+    }
+
+    written = static_cast<size_t>(m_out - m_outStart);
+    return true;
+}
+
+std::string InflateDecoder::getLastError() const {
+    return m_lastError;
+}
+
+void InflateDecoder::clearError() {
+    m_lastError.clear();
+}
+
+bool InflateDecoder::decodeStored() {
+    // Discard bits up to the next byte boundary, then hand any whole bytes still held
+    // in the bit buffer back to the input so the block can be copied with memcpy
+    takeBits(m_bitCount & 7);
+    size_t heldBytes = static_cast<size_t>(m_bitCount) / 8;
+    const size_t padded = std::min(heldBytes, m_padBytes);
+    heldBytes -= padded;
+    m_in -= heldBytes;
+    m_bits = 0;
+    m_bitCount = 0;
+    m_padBytes = 0;
+
+    if (m_inEnd - m_in < 4) {
+        m_lastError = "Truncated stored block header";
+        return false;
+    }
+
+    const uint32_t length = m_in[0] | (m_in[1] << 8);
+    const uint32_t inverse = m_in[2] | (m_in[3] << 8);
+    m_in += 4;
+
+    if ((length ^ 0xFFFF) != inverse) {
+        m_lastError = "Corrupt stored block length";
+        return false;
+    }
+    if (static_cast<size_t>(m_inEnd - m_in) < length) {
+        m_lastError = "Truncated stored block";
+        return false;
+    }
+    if (static_cast<size_t>(m_outEnd - m_out) < length) {
+        m_lastError = "Output buffer overflow";
+        return false;
+    }
+
+    std::memcpy(m_out, m_in, length);
+    m_out += length;
+    m_in += length;
+    return true;
+}
+
+bool InflateDecoder::decodeHuffmanBlock(const HuffmanTable& literals, const HuffmanTable& distances) {
+    for (;;) {
+        if (overran()) {
+            m_lastError = "Truncated compressed data";
+            return false;
+        }
+
+        // One refill guarantees >= 56 bits: enough for literal/length + extra + distance + extra
+        refill();
+
+        int symbol = decodeSymbol(literals);
+        if (symbol < 256) {
+            if (symbol < 0) {
+                m_lastError = "Invalid literal/length code";
+                return false;
+            }
+            if (m_out >= m_outEnd) {
+                m_lastError = "Output buffer overflow";
+                return false;
+            }
+            *m_out++ = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        if (symbol == 256) {
+            if (overran()) {
+                m_lastError = "Truncated compressed data";
+                return false;
+            }
+            return true;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29) {
+            m_lastError = "Invalid length symbol";
+            return false;
+        }
+
+        size_t length = LENGTH_BASE[symbol];
+        if (LENGTH_EXTRA[symbol]) {
+            length += takeBits(LENGTH_EXTRA[symbol]);
+        }
+
+        const int distanceSymbol = decodeSymbol(distances);
+        if (distanceSymbol < 0 || distanceSymbol >= 30) {
+            m_lastError = "Invalid distance symbol";
+            return false;
+        }
+
+        size_t distance = DIST_BASE[distanceSymbol];
+        if (DIST_EXTRA[distanceSymbol]) {
+            distance += takeBits(DIST_EXTRA[distanceSymbol]);
+        }
+
+        if (distance > static_cast<size_t>(m_out - m_outStart)) {
+            m_lastError = "Distance too far back";
+            return false;
+        }
+
+        const size_t remaining = static_cast<size_t>(m_outEnd - m_out);
+        if (length > remaining) {
+            m_lastError = "Output buffer overflow";
+            return false;
+        }
+
+        const uint8_t* source = m_out - distance;
+        if (distance >= 8 && remaining >= length + 8) {
+            // Non-overlapping 8-byte words; may write up to 7 bytes past the match,
+            // which stays inside the buffer and is overwritten by later output
+            uint8_t* end = m_out + length;
+            do {
+                std::memcpy(m_out, source, 8);
+                m_out += 8;
+                source += 8;
+            } while (m_out < end);
+            m_out = end;
+        } else if (distance == 1) {
+            std::memset(m_out, *source, length);
+            m_out += length;
+        } else {
+            for (size_t i = 0; i < length; ++i) {
+                m_out[i] = source[i];
+            }
+            m_out += length;
+        }
+    }
+}
+
+bool InflateDecoder::readDynamicTables() {
+    refill();
+    const int literalCount = static_cast<int>(takeBits(5)) + 257;
+    const int distanceCount = static_cast<int>(takeBits(5)) + 1;
+    const int codeLengthCount = static_cast<int>(takeBits(4)) + 4;
+
+    uint8_t codeLengthSizes[19] = {0};
+    for (int i = 0; i < codeLengthCount; ++i) {
+        refill();
+        codeLengthSizes[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(takeBits(3));
+    }
+
+    HuffmanTable codeLengthTable;
+    if (!buildTable(codeLengthTable, codeLengthSizes, 19)) {
+        m_lastError = "Invalid code length code";
+        return false;
+    }
+
+    uint8_t lengths[288 + 32];
+    const int total = literalCount + distanceCount;
+    int count = 0;
+    while (count < total) {
+        refill();
+        const int symbol = decodeSymbol(codeLengthTable);
+        if (symbol < 0 || symbol >= 19) {
+            m_lastError = "Invalid code length symbol";
+            return false;
+        }
+
+        if (symbol < 16) {
+            lengths[count++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        uint8_t fill = 0;
+        int repeat = 0;
+        if (symbol == 16) {
+            if (count == 0) {
+                m_lastError = "Code length repeat with no previous length";
+                return false;
+            }
+            repeat = static_cast<int>(takeBits(2)) + 3;
+            fill = lengths[count - 1];
+        } else if (symbol == 17) {
+            repeat = static_cast<int>(takeBits(3)) + 3;
+        } else {
+            repeat = static_cast<int>(takeBits(7)) + 11;
+        }
+
+        if (total - count < repeat) {
+            m_lastError = "Code length repeat overflows table";
+            return false;
+        }
+        std::memset(lengths + count, fill, static_cast<size_t>(repeat));
+        count += repeat;
+    }
+
+    if (lengths[256] == 0) {
+        m_lastError = "Missing end-of-block code";
+        return false;
+    }
+
+    if (!buildTable(m_literals, lengths, literalCount) ||
+        !buildTable(m_distances, lengths + literalCount, distanceCount)) {
+        m_lastError = "Invalid Huffman code lengths";
+        return false;
+    }
+
+    return !overran();
+}
+
+void InflateDecoder::refill() {
+    if (m_inEnd - m_in >= 8) {
+        // Branchless refill: afterwards 56 <= m_bitCount <= 63. Bits above m_bitCount hold
+        // the genuine upcoming stream bytes, so re-OR-ing them on the next refill is harmless.
+        m_bits |= loadLittleEndian64(m_in) << m_bitCount;
+        m_in += (63 - m_bitCount) >> 3;
+        m_bitCount |= 56;
+        return;
+    }
+
+    while (m_bitCount <= 56) {
+        if (m_in < m_inEnd) {
+            m_bits |= static_cast<uint64_t>(*m_in++) << m_bitCount;
+        } else {
+            ++m_padBytes;
+        }
+        m_bitCount += 8;
+    }
+}
+
+uint32_t InflateDecoder::takeBits(int count) {
+    const uint32_t value = static_cast<uint32_t>(m_bits & ((uint64_t(1) << count) - 1));
+    m_bits >>= count;
+    m_bitCount -= count;
+    return value;
+}
+
+int InflateDecoder::decodeSymbol(const HuffmanTable& table) {
+    const uint16_t entry = table.fast[m_bits & ((1u << FAST_BITS) - 1)];
+    if (entry) {
+        const int length = entry >> 9;
+        m_bits >>= length;
+        m_bitCount -= length;
+        return entry & 511;
+    }
+    return decodeSymbolSlow(table);
+}
+
+int InflateDecoder::decodeSymbolSlow(const HuffmanTable& table) {
+    // Canonical Huffman codes are transmitted MSB-first, so reverse the next 16 bits
+    const uint32_t k = static_cast<uint32_t>(reverseBits(static_cast<int>(m_bits & 0xFFFF), 16));
+
+    int size = FAST_BITS + 1;
+    while (k >= table.maxCode[size]) {
+        ++size;
+    }
+    if (size >= 16) {
+        return -1;
+    }
+
+    const int index = static_cast<int>(k >> (16 - size)) - table.firstCode[size] + table.firstSymbol[size];
+    if (index < 0 || index >= 288 || table.sizes[index] != size) {
+        return -1;
+    }
+
+    m_bits >>= size;
+    m_bitCount -= size;
+    return table.values[index];
+}
+
+bool InflateDecoder::overran() const {
+    // Synthesized zero bytes sit at the top of the bit buffer; consuming any of them
+    // means the stream ended before the decoder did
+    return m_padBytes * 8 > static_cast<size_t>(m_bitCount);
+}
+
+bool InflateDecoder::buildTable(HuffmanTable& table, const uint8_t* lengths, int count) {
+    int sizeCount[17] = {0};
+    int nextCode[16] = {0};
+
+    std::memset(table.fast, 0, sizeof(table.fast));
+    std::memset(table.sizes, 0, sizeof(table.sizes));
+
+    for (int i = 0; i < count; ++i) {
+        ++sizeCount[lengths[i]];
+    }
+    sizeCount[0] = 0;
+
+    for (int i = 1; i < 16; ++i) {
+        if (sizeCount[i] > (1 << i)) {
+            return false;
+        }
+    }
+
+    // Assign canonical codes: each length starts where the previous one ended, doubled
+    int code = 0;
+    int symbolIndex = 0;
+    for (int i = 1; i < 16; ++i) {
+        nextCode[i] = code;
+        table.firstCode[i] = static_cast<uint16_t>(code);
+        table.firstSymbol[i] = static_cast<uint16_t>(symbolIndex);
+        code += sizeCount[i];
+        if (sizeCount[i] && code - 1 >= (1 << i)) {
+            return false;  // Over-subscribed
+        }
+        table.maxCode[i] = static_cast<uint32_t>(code) << (16 - i);
+        code <<= 1;
+        symbolIndex += sizeCount[i];
+    }
+    table.maxCode[16] = 0x10000;  // Sentinel for the slow path
+
+    for (int i = 0; i < count; ++i) {
+        const int size = lengths[i];
+        if (!size) {
+            continue;
+        }
+
+        const int slot = nextCode[size] - table.firstCode[size] + table.firstSymbol[size];
+        table.sizes[slot] = static_cast<uint8_t>(size);
+        table.values[slot] = static_cast<uint16_t>(i);
+
+        if (size <= FAST_BITS) {
+            const uint16_t entry = static_cast<uint16_t>((size << 9) | i);
+            for (int j = reverseBits(nextCode[size], size); j < (1 << FAST_BITS); j += (1 << size)) {
+                table.fast[j] = entry;
+            }
+        }
+        ++nextCode[size];
+    }
+
+    return true;
+}
+
+const InflateDecoder::HuffmanTable& InflateDecoder::fixedLiteralTable() {
+    static const HuffmanTable table = [] {
+        uint8_t lengths[288];
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + 288, 8);
+        HuffmanTable built;
+        buildTable(built, lengths, 288);
+        return built;
+    }();
+    return table;
+}
+
+const InflateDecoder::HuffmanTable& InflateDecoder::fixedDistanceTable() {
+    static const HuffmanTable table = [] {
+        uint8_t lengths[32];
+        std::fill(lengths, lengths + 32, 5);
+        HuffmanTable built;
+        buildTable(built, lengths, 32);
+        return built;
+    }();
+    return table;
+}
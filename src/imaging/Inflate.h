@@ -0,0 +1,84 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: Inflate.h
+ * Description: Table-driven DEFLATE/zlib decompressor tuned for PNG image data
+ *
+ * Algorithm:
+ * - Huffman codes are resolved through a 2^FAST_BITS lookup table; longer codes fall
+ *   back to a canonical-code search (at most 15 - FAST_BITS extra comparisons)
+ * - Input is consumed through a 64-bit bit buffer refilled 8 bytes at a time, so a
+ *   complete length/distance pair (at most 48 bits) decodes with a single refill
+ * - Matches with distance >= 8 are copied in 8-byte words; the output size is known
+ *   up front for PNG (height * (rowBytes + 1)), so the output never reallocates
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class InflateDecoder {
+public:
+    InflateDecoder();
+    ~InflateDecoder();
+
+    // Decompress a zlib stream (RFC 1950) into a caller-sized output buffer.
+    // `written` receives the number of bytes produced.
+    bool inflateZlib(const uint8_t* input, size_t inputSize,
+                     uint8_t* output, size_t outputSize, size_t& written);
+
+    // Decompress a raw DEFLATE stream (RFC 1951)
+    bool inflateRaw(const uint8_t* input, size_t inputSize,
+                    uint8_t* output, size_t outputSize, size_t& written);
+
+    // Error handling
+    std::string getLastError() const;
+    void clearError();
+
+    // Huffman lookup width; 10 bits covers nearly every literal/length code in practice
+    static constexpr int FAST_BITS = 10;
+
+    struct HuffmanTable {
+        uint16_t fast[1 << FAST_BITS];   // (length << 9) | symbol, 0 when code is longer
+        uint16_t firstCode[16];
+        uint16_t firstSymbol[16];
+        uint32_t maxCode[17];            // Pre-shifted to 16 bits for the slow path
+        uint8_t sizes[288];
+        uint16_t values[288];
+    };
+
+private:
+    // Block decoders
+    bool decodeStored();
+    bool decodeHuffmanBlock(const HuffmanTable& literals, const HuffmanTable& distances);
+    bool readDynamicTables();
+
+    // Bit buffer helpers
+    void refill();
+    uint32_t takeBits(int count);
+    int decodeSymbol(const HuffmanTable& table);
+    int decodeSymbolSlow(const HuffmanTable& table);
+    bool overran() const;
+
+    static bool buildTable(HuffmanTable& table, const uint8_t* lengths, int count);
+    static const HuffmanTable& fixedLiteralTable();
+    static const HuffmanTable& fixedDistanceTable();
+
+    // Stream state
+    const uint8_t* m_in;
+    const uint8_t* m_inEnd;
+    uint64_t m_bits;
+    int m_bitCount;
+    size_t m_padBytes;      // Zero bytes synthesized past the end of input
+
+    uint8_t* m_outStart;
+    uint8_t* m_out;
+    uint8_t* m_outEnd;
+
+    HuffmanTable m_literals;
+    HuffmanTable m_distances;
+
+    std::string m_lastError;
+};
@@ -0,0 +1,1000 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: JpegPreviewDecoder.cpp
+ * Description: Implementation of DC-coefficient JPEG preview decoding
+ */
+
+#include "JpegPreviewDecoder.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+constexpr int FAST_BITS = 9;
+
+// Marker codes (ITU T.81, table B.1)
+constexpr int MARKER_SOF0 = 0xC0;
+constexpr int MARKER_SOF1 = 0xC1;
+constexpr int MARKER_SOF2 = 0xC2;
+constexpr int MARKER_DHT = 0xC4;
+constexpr int MARKER_RST0 = 0xD0;
+constexpr int MARKER_RST7 = 0xD7;
+constexpr int MARKER_SOI = 0xD8;
+constexpr int MARKER_EOI = 0xD9;
+constexpr int MARKER_SOS = 0xDA;
+constexpr int MARKER_DQT = 0xDB;
+constexpr int MARKER_DRI = 0xDD;
+constexpr int MARKER_APP14 = 0xEE;
+constexpr int MARKER_TEM = 0x01;
+
+// Largest frame accepted (pixels); bounds the DC plane allocation
+constexpr int64_t MAX_PIXELS = int64_t(1) << 28;
+
+inline bool isRestartMarker(int marker) {
+    return marker >= MARKER_RST0 && marker <= MARKER_RST7;
+}
+
+inline bool isUnsupportedFrame(int marker) {
+    // Lossless, hierarchical and arithmetic-coded frames
+    return marker == 0xC3 || (marker >= 0xC5 && marker <= 0xC7) ||
+           (marker >= 0xC9 && marker <= 0xCB) || (marker >= 0xCD && marker <= 0xCF);
+}
+
+inline uint8_t clampToByte(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Rounded division by 8 that is also correct for negative DC values
+inline int roundedDivideBy8(int value) {
+    const int shifted = value + 4;
+    return shifted >= 0 ? shifted / 8 : -((-shifted + 7) / 8);
+}
+
+// 12.20 fixed point YCbCr -> RGB (JFIF), matching stb_image's full decode
+inline int fixedPoint(float value) {
+    return static_cast<int>(value * 4096.0f + 0.5f) << 8;
+}
+
+} // namespace
+
+JpegPreviewDecoder::JpegPreviewDecoder()
+    : m_data(nullptr)
+    , m_end(nullptr)
+    , m_pos(nullptr)
+    , m_codeBuffer(0)
+    , m_codeBits(0)
+    , m_marker(-1)
+    , m_noMore(false)
+    , m_hitEnd(false)
+    , m_paddedBits(0)
+    , m_haveFrame(false)
+    , m_maxH(1)
+    , m_maxV(1)
+    , m_mcusX(0)
+    , m_mcusY(0)
+    , m_restartInterval(0)
+    , m_adobeTransform(-1)
+    , m_quantDc{1, 1, 1, 1}
+    , m_scansDecoded(0)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+JpegPreviewDecoder::~JpegPreviewDecoder() = default;
+
+bool JpegPreviewDecoder::isJpeg(const uint8_t* data, size_t size) {
+    return data && size >= 3 && data[0] == 0xFF && data[1] == MARKER_SOI && data[2] == 0xFF;
+}
+
+bool JpegPreviewDecoder::readInfo(const uint8_t* data, size_t size, JpegInfo& info) {
+    clearError();
+
+    if (!isJpeg(data, size)) {
+        return setError(ErrorCode::InvalidSignature, "Not a JPEG file");
+    }
+
+    m_data = data;
+    m_end = data + size;
+    m_pos = data + 2;
+    m_marker = -1;
+    m_haveFrame = false;
+    m_components.clear();
+
+    for (;;) {
+        const int marker = nextMarker();
+        if (marker < 0 || marker == MARKER_EOI || marker == MARKER_SOS) {
+            return setError(ErrorCode::CorruptData, "No frame header before image data");
+        }
+        if (marker == MARKER_SOF0 || marker == MARKER_SOF1 || marker == MARKER_SOF2) {
+            if (!parseFrame(marker == MARKER_SOF2)) {
+                return false;
+            }
+            info = m_info;
+            return true;
+        }
+        if (isUnsupportedFrame(marker)) {
+            return setError(ErrorCode::UnsupportedFormat, "Unsupported JPEG frame type");
+        }
+        if (isRestartMarker(marker) || marker == MARKER_TEM) {
+            continue;
+        }
+
+        size_t length = 0;
+        if (!readSegmentLength(length)) {
+            return false;
+        }
+        m_pos += length;
+    }
+}
+
+bool JpegPreviewDecoder::decodePreview(const uint8_t* data, size_t size, ImageBuffer& out,
+                                       int channels, bool refineDc) {
+    clearError();
+
+    if (!isJpeg(data, size)) {
+        return setError(ErrorCode::InvalidSignature, "Not a JPEG file");
+    }
+    if (channels != 3 && channels != 4) {
+        return setError(ErrorCode::UnsupportedFormat, "Output must be RGB or RGBA");
+    }
+
+    m_data = data;
+    m_end = data + size;
+    m_pos = data + 2;
+    m_marker = -1;
+    m_hitEnd = false;
+    m_haveFrame = false;
+    m_restartInterval = 0;
+    m_adobeTransform = -1;
+    m_scansDecoded = 0;
+    m_components.clear();
+    for (int i = 0; i < 4; ++i) {
+        m_quantDc[i] = 1;
+        m_dcTables[i].present = false;
+        m_acTables[i].present = false;
+    }
+
+    // Refinement scans are optional: a file cut short after its DC scans still previews
+    if (!parseSegments(refineDc) && !(hasAllDc() && m_lastErrorCode == ErrorCode::Truncated)) {
+        return false;
+    }
+    clearError();
+
+    if (!m_haveFrame) {
+        return setError(m_hitEnd ? ErrorCode::Truncated : ErrorCode::CorruptData, "Missing frame header");
+    }
+    if (!hasAllDc()) {
+        return setError(m_hitEnd ? ErrorCode::Truncated : ErrorCode::CorruptData,
+                        "Missing DC scan for a component");
+    }
+
+    writePreview(out, channels);
+    return true;
+}
+
+int JpegPreviewDecoder::getScansDecoded() const {
+    return m_scansDecoded;
+}
+
+std::string JpegPreviewDecoder::getLastError() const {
+    return m_lastError;
+}
+
+JpegPreviewDecoder::ErrorCode JpegPreviewDecoder::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void JpegPreviewDecoder::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool JpegPreviewDecoder::parseSegments(bool refineDc) {
+    bool done = false;
+    while (!done) {
+        const int marker = nextMarker();
+        if (marker < 0) {
+            return true;  // Callers check which DC planes arrived
+        }
+
+        switch (marker) {
+            case MARKER_SOF0:
+            case MARKER_SOF1:
+            case MARKER_SOF2:
+                if (!parseFrame(marker == MARKER_SOF2)) {
+                    return false;
+                }
+                break;
+
+            case MARKER_DHT:
+                if (!parseHuffmanTables()) {
+                    return false;
+                }
+                break;
+
+            case MARKER_DQT:
+                if (!parseQuantTables()) {
+                    return false;
+                }
+                break;
+
+            case MARKER_DRI: {
+                size_t length = 0;
+                if (!readSegmentLength(length)) {
+                    return false;
+                }
+                if (length != 2) {
+                    return setError(ErrorCode::CorruptData, "Invalid DRI length");
+                }
+                m_restartInterval = (m_pos[0] << 8) | m_pos[1];
+                m_pos += length;
+                break;
+            }
+
+            case MARKER_SOS: {
+                if (!parseScan(refineDc)) {
+                    return false;
+                }
+
+                // Stop as soon as every DC plane is present: the remaining scans only add
+                // AC detail (or DC refinement bits when the caller did not ask for them)
+                if (hasAllDc() && !(m_info.progressive && refineDc)) {
+                    done = true;
+                }
+                break;
+            }
+
+            case MARKER_EOI:
+                done = true;
+                break;
+
+            case MARKER_APP14: {
+                size_t length = 0;
+                if (!readSegmentLength(length)) {
+                    return false;
+                }
+                if (length >= 12 && std::memcmp(m_pos, "Adobe", 5) == 0) {
+                    m_adobeTransform = m_pos[11];
+                }
+                m_pos += length;
+                break;
+            }
+
+            default: {
+                if (isUnsupportedFrame(marker)) {
+                    return setError(ErrorCode::UnsupportedFormat, "Unsupported JPEG frame type");
+                }
+                if (isRestartMarker(marker) || marker == MARKER_TEM) {
+                    break;  // Standalone markers without a length field
+                }
+                size_t length = 0;
+                if (!readSegmentLength(length)) {
+                    return false;
+                }
+                m_pos += length;
+                break;
+            }
+        }
+    }
+
+
+    return true;
+}
+
+bool JpegPreviewDecoder::hasAllDc() const {
+    return m_haveFrame && std::all_of(m_components.begin(), m_components.end(),
+                                      [](const Component& c) { return c.hasDc; });
+}
+
+bool JpegPreviewDecoder::parseFrame(bool progressive) {
+    if (m_haveFrame) {
+        return setError(ErrorCode::UnsupportedFormat, "Multiple frames are not supported");
+    }
+
+    size_t length = 0;
+    if (!readSegmentLength(length)) {
+        return false;
+    }
+    const uint8_t* p = m_pos;
+    m_pos += length;
+
+    if (length < 6) {
+        return setError(ErrorCode::CorruptData, "Invalid SOF length");
+    }
+    if (p[0] != 8) {
+        return setError(ErrorCode::UnsupportedFormat, "Only 8-bit JPEG is supported");
+    }
+
+    m_info.height = (p[1] << 8) | p[2];
+    m_info.width = (p[3] << 8) | p[4];
+    m_info.components = p[5];
+    m_info.progressive = progressive;
+
+    if (m_info.height == 0) {
+        return setError(ErrorCode::UnsupportedFormat, "DNL-defined height is not supported");
+    }
+    if (m_info.width == 0 || static_cast<int64_t>(m_info.width) * m_info.height > MAX_PIXELS) {
+        return setError(ErrorCode::CorruptData, "Invalid image dimensions");
+    }
+    if (m_info.components != 1 && m_info.components != 3) {
+        return setError(ErrorCode::UnsupportedFormat, "Only gray and three-component JPEG are supported");
+    }
+    if (length != 6 + 3 * static_cast<size_t>(m_info.components)) {
+        return setError(ErrorCode::CorruptData, "Invalid SOF length");
+    }
+
+    m_components.assign(m_info.components, Component{});
+    m_maxH = 1;
+    m_maxV = 1;
+    for (int i = 0; i < m_info.components; ++i) {
+        Component& component = m_components[i];
+        component.id = p[6 + i * 3];
+        component.h = p[7 + i * 3] >> 4;
+        component.v = p[7 + i * 3] & 15;
+        component.quantTable = p[8 + i * 3];
+        if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 ||
+            component.quantTable > 3) {
+            return setError(ErrorCode::CorruptData, "Invalid component parameters");
+        }
+        m_maxH = std::max(m_maxH, component.h);
+        m_maxV = std::max(m_maxV, component.v);
+    }
+
+    m_mcusX = (m_info.width + 8 * m_maxH - 1) / (8 * m_maxH);
+    m_mcusY = (m_info.height + 8 * m_maxV - 1) / (8 * m_maxV);
+    for (auto& component : m_components) {
+        component.blocksPerLine = m_mcusX * component.h;
+        component.blocksPerColumn = m_mcusY * component.v;
+        component.dc.assign(static_cast<size_t>(component.blocksPerLine) * component.blocksPerColumn, 0);
+    }
+
+    m_haveFrame = true;
+    return true;
+}
+
+bool JpegPreviewDecoder::parseHuffmanTables() {
+    size_t length = 0;
+    if (!readSegmentLength(length)) {
+        return false;
+    }
+    const uint8_t* p = m_pos;
+    const uint8_t* end = m_pos + length;
+    m_pos = end;
+
+    while (end - p >= 17) {
+        const int tableClass = p[0] >> 4;
+        const int tableId = p[0] & 15;
+        if (tableClass > 1 || tableId > 3) {
+            return setError(ErrorCode::CorruptData, "Invalid Huffman table id");
+        }
+
+        int total = 0;
+        for (int i = 0; i < 16; ++i) {
+            total += p[1 + i];
+        }
+        if (total > 256 || end - p < 17 + total) {
+            return setError(ErrorCode::CorruptData, "Invalid Huffman table length");
+        }
+
+        HuffmanTable& table = tableClass == 0 ? m_dcTables[tableId] : m_acTables[tableId];
+        if (!buildHuffman(table, p + 1)) {
+            return setError(ErrorCode::CorruptData, "Invalid Huffman code lengths");
+        }
+        std::memcpy(table.values, p + 17, total);
+        p += 17 + total;
+    }
+
+    return true;
+}
+
+bool JpegPreviewDecoder::parseQuantTables() {
+    size_t length = 0;
+    if (!readSegmentLength(length)) {
+        return false;
+    }
+    const uint8_t* p = m_pos;
+    const uint8_t* end = m_pos + length;
+    m_pos = end;
+
+    while (p < end) {
+        const int precision = p[0] >> 4;
+        const int tableId = p[0] & 15;
+        const size_t tableBytes = 1 + 64 * static_cast<size_t>(precision + 1);
+        if (precision > 1 || tableId > 3 || static_cast<size_t>(end - p) < tableBytes) {
+            return setError(ErrorCode::CorruptData, "Invalid quantization table");
+        }
+
+        // Only the DC quantizer (first entry in zigzag order) is needed for the preview
+        m_quantDc[tableId] = precision ? static_cast<uint16_t>((p[1] << 8) | p[2]) : p[1];
+        p += tableBytes;
+    }
+
+    return true;
+}
+
+bool JpegPreviewDecoder::parseScan(bool refineDc) {
+    if (!m_haveFrame) {
+        return setError(ErrorCode::CorruptData, "Scan before frame header");
+    }
+
+    size_t length = 0;
+    if (!readSegmentLength(length)) {
+        return false;
+    }
+    const uint8_t* p = m_pos;
+    m_pos += length;
+
+    const int componentCount = length > 0 ? p[0] : 0;
+    if (componentCount < 1 || componentCount > 4 || length != 4 + 2 * static_cast<size_t>(componentCount)) {
+        return setError(ErrorCode::CorruptData, "Invalid SOS length");
+    }
+
+    std::vector<int> scanComponents;
+    for (int i = 0; i < componentCount; ++i) {
+        const int id = p[1 + i * 2];
+        const int tables = p[2 + i * 2];
+
+        auto it = std::find_if(m_components.begin(), m_components.end(),
+                               [id](const Component& c) { return c.id == id; });
+        if (it == m_components.end() || (tables >> 4) > 3 || (tables & 15) > 3) {
+            return setError(ErrorCode::CorruptData, "Invalid scan component");
+        }
+        it->dcTable = tables >> 4;
+        it->acTable = tables & 15;
+        scanComponents.push_back(static_cast<int>(it - m_components.begin()));
+    }
+
+    const int spectralStart = p[1 + componentCount * 2];
+    const int spectralEnd = p[2 + componentCount * 2];
+    const int approxHigh = p[3 + componentCount * 2] >> 4;
+    const int approxLow = p[3 + componentCount * 2] & 15;
+
+    if (m_info.progressive) {
+        const bool dcScan = spectralStart == 0;
+        if (dcScan && spectralEnd != 0) {
+            return setError(ErrorCode::CorruptData, "Progressive DC scan with AC coefficients");
+        }
+
+        const bool firstDcScan = dcScan && approxHigh == 0;
+        const bool refinementScan = dcScan && approxHigh != 0 && refineDc;
+        if (!firstDcScan && !refinementScan) {
+            // AC scans (and unwanted refinements) carry no block-average information
+            return skipEntropySegment() || m_hitEnd;
+        }
+    } else if (spectralStart != 0 || spectralEnd != 63) {
+        return setError(ErrorCode::CorruptData, "Invalid spectral selection for sequential scan");
+    }
+
+    for (int index : scanComponents) {
+        const Component& component = m_components[index];
+        if (approxHigh == 0 && !m_dcTables[component.dcTable].present) {
+            return setError(ErrorCode::CorruptData, "Missing DC Huffman table");
+        }
+        if (!m_info.progressive && !m_acTables[component.acTable].present) {
+            return setError(ErrorCode::CorruptData, "Missing AC Huffman table");
+        }
+    }
+
+    const bool decoded = decodeScanBlocks(scanComponents, spectralStart, approxHigh, approxLow);
+
+    // Reading ahead past the end is harmless; consuming any of that padding is not
+    if (m_paddedBits > m_codeBits) {
+        m_hitEnd = true;
+        return setError(ErrorCode::Truncated, "Image data ended inside a scan");
+    }
+    if (!decoded) {
+        return false;
+    }
+
+    if (approxHigh == 0) {
+        for (int index : scanComponents) {
+            m_components[index].hasDc = true;
+        }
+    }
+    ++m_scansDecoded;
+
+    // Position on the marker that terminates this scan
+    return skipEntropySegment() || m_hitEnd;
+}
+
+int JpegPreviewDecoder::nextMarker() {
+    if (m_marker >= 0) {
+        const int marker = m_marker;
+        m_marker = -1;
+        return marker;
+    }
+
+    // Tolerate garbage between segments, then skip 0xFF fill bytes
+    while (m_pos < m_end && *m_pos != 0xFF) {
+        ++m_pos;
+    }
+    while (m_pos < m_end && *m_pos == 0xFF) {
+        ++m_pos;
+    }
+    if (m_pos >= m_end) {
+        m_hitEnd = true;
+        return -1;
+    }
+    return *m_pos++;
+}
+
+bool JpegPreviewDecoder::readSegmentLength(size_t& length) {
+    if (m_end - m_pos < 2) {
+        m_hitEnd = true;
+        return setError(ErrorCode::Truncated, "Truncated marker segment");
+    }
+
+    const size_t declared = (static_cast<size_t>(m_pos[0]) << 8) | m_pos[1];
+    if (declared < 2) {
+        return setError(ErrorCode::CorruptData, "Invalid marker segment length");
+    }
+    m_pos += 2;
+
+    length = declared - 2;
+    if (static_cast<size_t>(m_end - m_pos) < length) {
+        m_hitEnd = true;
+        return setError(ErrorCode::Truncated, "Truncated marker segment");
+    }
+    return true;
+}
+
+bool JpegPreviewDecoder::decodeScanBlocks(const std::vector<int>& scanComponents, int spectralStart,
+                                          int approxHigh, int approxLow) {
+    (void)spectralStart;
+
+    resetBitReader();
+    for (auto& component : m_components) {
+        component.dcPredictor = 0;
+    }
+
+    const int interval = m_restartInterval > 0 ? m_restartInterval : INT_MAX;
+    int untilRestart = interval;
+
+    if (scanComponents.size() == 1) {
+        // Non-interleaved scan: one block per MCU over the component's own extent
+        Component& component = m_components[scanComponents[0]];
+        const int componentWidth = (m_info.width * component.h + m_maxH - 1) / m_maxH;
+        const int componentHeight = (m_info.height * component.v + m_maxV - 1) / m_maxV;
+        const int blocksWide = (componentWidth + 7) / 8;
+        const int blocksHigh = (componentHeight + 7) / 8;
+        const int64_t total = static_cast<int64_t>(blocksWide) * blocksHigh;
+
+        int64_t processed = 0;
+        for (int by = 0; by < blocksHigh; ++by) {
+            for (int bx = 0; bx < blocksWide; ++bx) {
+                if (!decodeBlock(component, by * component.blocksPerLine + bx, approxHigh, approxLow)) {
+                    return false;
+                }
+                if (++processed < total && --untilRestart == 0) {
+                    if (!processRestart()) {
+                        return false;
+                    }
+                    untilRestart = interval;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Interleaved scan: each MCU holds h x v blocks of every scan component
+    const int64_t total = static_cast<int64_t>(m_mcusX) * m_mcusY;
+    int64_t processed = 0;
+    for (int mcuY = 0; mcuY < m_mcusY; ++mcuY) {
+        for (int mcuX = 0; mcuX < m_mcusX; ++mcuX) {
+            for (int index : scanComponents) {
+                Component& component = m_components[index];
+                for (int v = 0; v < component.v; ++v) {
+                    for (int h = 0; h < component.h; ++h) {
+                        const int blockIndex = (mcuY * component.v + v) * component.blocksPerLine +
+                                               mcuX * component.h + h;
+                        if (!decodeBlock(component, blockIndex, approxHigh, approxLow)) {
+                            return false;
+                        }
+                    }
+                }
+            }
+            if (++processed < total && --untilRestart == 0) {
+                if (!processRestart()) {
+                    return false;
+                }
+                untilRestart = interval;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool JpegPreviewDecoder::decodeBlock(Component& component, int blockIndex, int approxHigh, int approxLow) {
+    if (approxHigh != 0) {
+        // DC successive-approximation refinement: one raw bit per block
+        if (getBit()) {
+            component.dc[blockIndex] |= (1 << approxLow);
+        }
+        return true;
+    }
+
+    const int category = decodeHuffman(m_dcTables[component.dcTable]);
+    if (category < 0 || category > 15) {
+        return setError(ErrorCode::CorruptData, "Invalid DC code");
+    }
+
+    const int diff = category ? receiveExtend(category) : 0;
+    component.dcPredictor += diff;
+    component.dc[blockIndex] = component.dcPredictor * (1 << approxLow);
+
+    if (m_info.progressive) {
+        return true;
+    }
+
+    // Sequential scan: decode AC run/size symbols only to skip their magnitude bits
+    const HuffmanTable& acTable = m_acTables[component.acTable];
+    for (int k = 1; k < 64;) {
+        const int symbol = decodeHuffman(acTable);
+        if (symbol < 0) {
+            return setError(ErrorCode::CorruptData, "Invalid AC code");
+        }
+
+        const int run = symbol >> 4;
+        const int size = symbol & 15;
+        if (size == 0) {
+            if (run != 15) {
+                break;  // End of block
+            }
+            k += 16;    // ZRL: sixteen zero coefficients
+        } else {
+            k += run;
+            skipBits(size);
+            ++k;
+        }
+    }
+
+    return true;
+}
+
+bool JpegPreviewDecoder::processRestart() {
+    // Locate the RSTn marker that must follow a completed restart interval
+    if (m_marker < 0) {
+        while (m_pos < m_end) {
+            if (*m_pos++ != 0xFF) {
+                continue;
+            }
+            while (m_pos < m_end && *m_pos == 0xFF) {
+                ++m_pos;
+            }
+            if (m_pos < m_end && *m_pos != 0x00) {
+                m_marker = *m_pos++;
+                break;
+            }
+        }
+    }
+
+    if (m_marker < 0) {
+        m_hitEnd = true;
+        return setError(ErrorCode::Truncated, "Image data ended before restart marker");
+    }
+    if (!isRestartMarker(m_marker)) {
+        return setError(ErrorCode::CorruptData, "Expected restart marker");
+    }
+
+    resetBitReader();
+    for (auto& component : m_components) {
+        component.dcPredictor = 0;
+    }
+    return true;
+}
+
+bool JpegPreviewDecoder::skipEntropySegment() {
+    if (m_marker >= 0 && !isRestartMarker(m_marker)) {
+        return true;
+    }
+    m_marker = -1;
+
+    // Entropy-coded data never contains a bare 0xFF: it is either stuffed (0xFF00)
+    // or starts a marker, so memchr-driven scanning finds the next segment quickly
+    while (m_pos < m_end) {
+        const void* found = std::memchr(m_pos, 0xFF, static_cast<size_t>(m_end - m_pos));
+        if (!found) {
+            break;
+        }
+        m_pos = static_cast<const uint8_t*>(found) + 1;
+        while (m_pos < m_end && *m_pos == 0xFF) {
+            ++m_pos;
+        }
+        if (m_pos >= m_end) {
+            break;
+        }
+
+        const int code = *m_pos++;
+        if (code != 0x00 && !isRestartMarker(code)) {
+            m_marker = code;
+            return true;
+        }
+    }
+
+    m_pos = m_end;
+    m_hitEnd = true;
+    return false;
+}
+
+void JpegPreviewDecoder::resetBitReader() {
+    m_codeBuffer = 0;
+    m_codeBits = 0;
+    m_noMore = false;
+    m_marker = -1;
+    m_paddedBits = 0;
+}
+
+void JpegPreviewDecoder::fillBits() {
+    do {
+        uint32_t byte = 0;
+        if (!m_noMore) {
+            if (m_pos >= m_end) {
+                m_noMore = true;
+            } else {
+                byte = *m_pos++;
+                if (byte == 0xFF) {
+                    while (m_pos < m_end && *m_pos == 0xFF) {
+                        ++m_pos;
+                    }
+                    if (m_pos >= m_end) {
+                        m_noMore = true;
+                        byte = 0;
+                    } else if (*m_pos != 0x00) {
+                        // A marker ends the entropy-coded segment; pad with zero bits
+                        m_marker = *m_pos++;
+                        m_noMore = true;
+                        byte = 0;
+                    } else {
+                        ++m_pos;  // Stuffed 0xFF00 -> data byte 0xFF
+                    }
+                }
+            }
+        }
+        if (m_noMore && m_marker < 0) {
+            m_paddedBits += 8;  // Zero bits beyond the end of the data, not a marker
+        }
+        m_codeBuffer |= byte << (24 - m_codeBits);
+        m_codeBits += 8;
+    } while (m_codeBits <= 24);
+}
+
+int JpegPreviewDecoder::decodeHuffman(const HuffmanTable& table) {
+    if (m_codeBits < 16) {
+        fillBits();
+    }
+
+    const int fastIndex = static_cast<int>(m_codeBuffer >> (32 - FAST_BITS));
+    const int slot = table.fast[fastIndex];
+    if (slot < 255) {
+        const int size = table.size[slot];
+        m_codeBuffer <<= size;
+        m_codeBits -= size;
+        return table.values[slot];
+    }
+
+    // Codes longer than FAST_BITS: compare against the per-length upper bounds
+    const uint32_t top = m_codeBuffer >> 16;
+    int size = FAST_BITS + 1;
+    while (top >= table.maxCode[size]) {
+        ++size;
+    }
+    if (size == 17) {
+        return -1;
+    }
+
+    const int index = static_cast<int>((m_codeBuffer >> (32 - size)) & ((1u << size) - 1)) + table.delta[size];
+    if (index < 0 || index > 255) {
+        return -1;
+    }
+    m_codeBuffer <<= size;
+    m_codeBits -= size;
+    return table.values[index];
+}
+
+int JpegPreviewDecoder::receiveExtend(int bits) {
+    if (m_codeBits < bits) {
+        fillBits();
+    }
+    int value = static_cast<int>(m_codeBuffer >> (32 - bits));
+    m_codeBuffer <<= bits;
+    m_codeBits -= bits;
+
+    // Values below 2^(bits-1) encode negative differences (T.81 figure F.12)
+    if (value < (1 << (bits - 1))) {
+        value += 1 - (1 << bits);
+    }
+    return value;
+}
+
+int JpegPreviewDecoder::getBit() {
+    if (m_codeBits < 1) {
+        fillBits();
+    }
+    const int bit = static_cast<int>(m_codeBuffer >> 31);
+    m_codeBuffer <<= 1;
+    m_codeBits -= 1;
+    return bit;
+}
+
+bool JpegPreviewDecoder::skipBits(int bits) {
+    if (m_codeBits < bits) {
+        fillBits();
+    }
+    m_codeBuffer <<= bits;
+    m_codeBits -= bits;
+    return true;
+}
+
+bool JpegPreviewDecoder::buildHuffman(HuffmanTable& table, const uint8_t* counts) {
+    // Canonical code assignment (T.81 annex C): sizes in order, codes counting upward
+    int symbolCount = 0;
+    for (int length = 0; length < 16; ++length) {
+        for (int j = 0; j < counts[length]; ++j) {
+            table.size[symbolCount++] = static_cast<uint8_t>(length + 1);
+        }
+    }
+    table.size[symbolCount] = 0;
+
+    uint32_t code = 0;
+    int k = 0;
+    int length = 1;
+    for (; length <= 16; ++length) {
+        table.delta[length] = k - static_cast<int>(code);
+        if (table.size[k] == length) {
+            while (table.size[k] == length) {
+                table.code[k++] = static_cast<uint16_t>(code++);
+            }
+            if (code - 1 >= (1u << length)) {
+                return false;
+            }
+        }
+        table.maxCode[length] = code << (16 - length);
+        code <<= 1;
+    }
+    table.maxCode[length] = 0xFFFFFFFFu;
+
+    std::memset(table.fast, 255, sizeof(table.fast));
+    for (int i = 0; i < symbolCount; ++i) {
+        const int size = table.size[i];
+        if (size <= FAST_BITS) {
+            const int first = table.code[i] << (FAST_BITS - size);
+            const int span = 1 << (FAST_BITS - size);
+            for (int j = 0; j < span; ++j) {
+                table.fast[first + j] = static_cast<uint8_t>(i);
+            }
+        }
+    }
+
+    table.present = true;
+    return true;
+}
+
+void JpegPreviewDecoder::writePreview(ImageBuffer& out, int channels) const {
+    const int width = (m_info.width + PREVIEW_SCALE - 1) / PREVIEW_SCALE;
+    const int height = (m_info.height + PREVIEW_SCALE - 1) / PREVIEW_SCALE;
+    out.allocate(width, height, channels);
+
+    // Dequantize each DC plane into block-average sample levels, then bring subsampled
+    // planes up to preview resolution
+    std::vector<std::vector<uint8_t>> planes(m_components.size());
+    for (size_t c = 0; c < m_components.size(); ++c) {
+        const Component& component = m_components[c];
+        const int quant = m_quantDc[component.quantTable];
+
+        std::vector<uint8_t> levels(component.dc.size());
+        for (size_t i = 0; i < component.dc.size(); ++i) {
+            levels[i] = clampToByte(128 + roundedDivideBy8(component.dc[i] * quant));
+        }
+
+        if (component.h == m_maxH && component.v == m_maxV) {
+            planes[c].resize(static_cast<size_t>(width) * height);
+            for (int y = 0; y < height; ++y) {
+                std::memcpy(&planes[c][static_cast<size_t>(y) * width],
+                            &levels[static_cast<size_t>(y) * component.blocksPerLine], width);
+            }
+        } else {
+            upsamplePlane(levels, component, width, height, planes[c]);
+        }
+    }
+
+    const bool gray = m_components.size() == 1;
+    const bool rgb = !gray && (m_adobeTransform == 0 ||
+                               (m_components[0].id == 'R' && m_components[1].id == 'G' &&
+                                m_components[2].id == 'B'));
+
+    const int crR = fixedPoint(1.40200f);
+    const int crG = -fixedPoint(0.71414f);
+    const int cbG = -fixedPoint(0.34414f);
+    const int cbB = fixedPoint(1.77200f);
+
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = out.row(y);
+        const size_t offset = static_cast<size_t>(y) * width;
+
+        for (int x = 0; x < width; ++x) {
+            uint8_t* pixel = row + x * channels;
+            const uint8_t first = planes[0][offset + x];
+
+            if (gray) {
+                pixel[0] = pixel[1] = pixel[2] = first;
+            } else if (rgb) {
+                pixel[0] = first;
+                pixel[1] = planes[1][offset + x];
+                pixel[2] = planes[2][offset + x];
+            } else {
+                const int yFixed = (first << 20) + (1 << 19);
+                const int cb = planes[1][offset + x] - 128;
+                const int cr = planes[2][offset + x] - 128;
+                pixel[0] = clampToByte((yFixed + cr * crR) >> 20);
+                pixel[1] = clampToByte((yFixed + cr * crG + static_cast<int>((cb * cbG) & 0xFFFF0000)) >> 20);
+                pixel[2] = clampToByte((yFixed + cb * cbB) >> 20);
+            }
+            if (channels == 4) {
+                pixel[3] = 255;
+            }
+        }
+    }
+}
+
+void JpegPreviewDecoder::upsamplePlane(const std::vector<uint8_t>& levels, const Component& component,
+                                       int width, int height, std::vector<uint8_t>& plane) const {
+    // Blocks that cover visible pixels; MCU padding blocks are never sampled
+    const int blocksWide = ((m_info.width * component.h + m_maxH - 1) / m_maxH + 7) / 8;
+    const int blocksHigh = ((m_info.height * component.v + m_maxV - 1) / m_maxV + 7) / 8;
+
+    // Per-axis source index and 1/16 weight of the following sample for every output
+    // position: centre (x + 0.5) maps to (x + 0.5) * h / Hmax - 0.5 in block units
+    auto buildTaps = [](int outputSize, int factor, int maxFactor, int blocks,
+                        std::vector<int>& index, std::vector<int>& weight) {
+        index.resize(outputSize);
+        weight.resize(outputSize);
+        for (int i = 0; i < outputSize; ++i) {
+            const int position = ((2 * i + 1) * factor * 8) / maxFactor - 8;
+            int base = position >= 0 ? position / 16 : -1;
+            int fraction = position - base * 16;
+            if (base < 0) {
+                base = 0;
+                fraction = 0;
+            }
+            if (base >= blocks - 1) {
+                base = blocks - 1;
+                fraction = 0;
+            }
+            index[i] = base;
+            weight[i] = fraction;
+        }
+    };
+
+    std::vector<int> xIndex;
+    std::vector<int> xWeight;
+    std::vector<int> yIndex;
+    std::vector<int> yWeight;
+    buildTaps(width, component.h, m_maxH, blocksWide, xIndex, xWeight);
+    buildTaps(height, component.v, m_maxV, blocksHigh, yIndex, yWeight);
+
+    plane.resize(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* top = &levels[static_cast<size_t>(yIndex[y]) * component.blocksPerLine];
+        const uint8_t* bottom = yWeight[y] ? top + component.blocksPerLine : top;
+        const int wy = yWeight[y];
+
+        for (int x = 0; x < width; ++x) {
+            const int x0 = xIndex[x];
+            const int x1 = xWeight[x] ? x0 + 1 : x0;
+            const int wx = xWeight[x];
+
+            const int upper = top[x0] * (16 - wx) + top[x1] * wx;
+            const int lower = bottom[x0] * (16 - wx) + bottom[x1] * wx;
+            plane[static_cast<size_t>(y) * width + x] =
+                static_cast<uint8_t>((upper * (16 - wy) + lower * wy + 128) >> 8);
+        }
+    }
+}
+
+bool JpegPreviewDecoder::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
@@ -0,0 +1,156 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: JpegPreviewDecoder.h
+ * Description: Low-detail JPEG preview decoding from DC coefficients (1/8 scale)
+ *
+ * Mathematical Foundation:
+ * - The DC coefficient of an 8x8 DCT block is 8x the block's mean sample offset:
+ *   mean = 128 + DC * Q[0] / 8, so one DC value per block yields an exact 1/8-scale image
+ *   of block averages without any IDCT
+ * - Progressive JPEGs transmit every component's DC coefficients in the first scan(s),
+ *   so the preview only needs those few scans; AC scans are skipped by marker search and
+ *   parsing stops as soon as every component has its DC plane
+ * - Baseline JPEGs interleave DC and AC per block; AC symbols are Huffman-decoded only to
+ *   skip them (no dequantization, IDCT or chroma upsampling)
+ * - Subsampled chroma planes are interpolated bilinearly between block centres: preview
+ *   pixel centre x + 0.5 lies at (x + 0.5) * h / Hmax - 0.5 in the plane of a component
+ *   with horizontal sampling factor h (3:1 weights for the usual 2x subsampling)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+
+struct JpegInfo {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    bool progressive = false;
+};
+
+class JpegPreviewDecoder {
+public:
+    JpegPreviewDecoder();
+    ~JpegPreviewDecoder();
+
+    static bool isJpeg(const uint8_t* data, size_t size);
+    bool readInfo(const uint8_t* data, size_t size, JpegInfo& info);
+
+    // Decode a ceil(width/8) x ceil(height/8) preview. With `refineDc` the decoder also
+    // applies DC successive-approximation refinement scans (progressive files only),
+    // which costs extra scans but restores full DC precision.
+    bool decodePreview(const uint8_t* data, size_t size, ImageBuffer& out,
+                       int channels = 4, bool refineDc = false);
+
+    // Number of entropy-coded scans decoded (not skipped) by the last preview
+    int getScansDecoded() const;
+
+    // Preview downscale factor relative to the full image
+    static constexpr int PREVIEW_SCALE = 8;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        InvalidSignature = 1,
+        CorruptData = 2,
+        UnsupportedFormat = 3,
+        Truncated = 4       // Data ended before every component had its DC scan
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    struct HuffmanTable {
+        bool present = false;
+        uint8_t fast[1 << 9];
+        uint16_t code[256];
+        uint8_t values[256];
+        uint8_t size[257];
+        uint32_t maxCode[18];
+        int delta[17];
+    };
+
+    struct Component {
+        int id = 0;
+        int h = 1;
+        int v = 1;
+        int quantTable = 0;
+        int dcTable = 0;
+        int acTable = 0;
+        int blocksPerLine = 0;      // Padded to whole MCUs
+        int blocksPerColumn = 0;
+        int dcPredictor = 0;
+        bool hasDc = false;
+        std::vector<int32_t> dc;    // Quantized DC coefficient per block
+    };
+
+    // Marker segment parsing
+    bool parseSegments(bool refineDc);
+    bool hasAllDc() const;
+    bool parseFrame(bool progressive);
+    bool parseHuffmanTables();
+    bool parseQuantTables();
+    bool parseScan(bool refineDc);
+    int nextMarker();
+    bool readSegmentLength(size_t& length);
+
+    // Entropy-coded segment decoding
+    bool decodeScanBlocks(const std::vector<int>& scanComponents, int spectralStart,
+                          int approxHigh, int approxLow);
+    bool decodeBlock(Component& component, int blockIndex, int approxHigh, int approxLow);
+    bool processRestart();
+    bool skipEntropySegment();
+
+    // Bit reader over the entropy-coded segment (handles 0xFF00 stuffing and markers)
+    void resetBitReader();
+    void fillBits();
+    int decodeHuffman(const HuffmanTable& table);
+    int receiveExtend(int bits);
+    int getBit();
+    bool skipBits(int bits);
+
+    static bool buildHuffman(HuffmanTable& table, const uint8_t* counts);
+
+    // Output conversion
+    void writePreview(ImageBuffer& out, int channels) const;
+    void upsamplePlane(const std::vector<uint8_t>& levels, const Component& component,
+                       int width, int height, std::vector<uint8_t>& plane) const;
+
+    bool setError(ErrorCode code, const std::string& message);
+
+    // Stream state
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+    const uint8_t* m_pos;
+    uint32_t m_codeBuffer;
+    int m_codeBits;
+    int m_marker;               // Marker latched by the bit reader, -1 when none
+    bool m_noMore;
+    bool m_hitEnd;
+    int m_paddedBits;           // Zero bits appended after the end of the data
+
+    // Frame state
+    JpegInfo m_info;
+    bool m_haveFrame;
+    int m_maxH;
+    int m_maxV;
+    int m_mcusX;
+    int m_mcusY;
+    int m_restartInterval;
+    int m_adobeTransform;       // -1 when no Adobe APP14 segment was seen
+    uint16_t m_quantDc[4];
+    HuffmanTable m_dcTables[4];
+    HuffmanTable m_acTables[4];
+    std::vector<Component> m_components;
+    int m_scansDecoded;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
@@ -0,0 +1,576 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: PngDecoder.cpp
+ * Description: Implementation of the fast-path PNG decoder with SSE2 scanline unfiltering
+ */
+
+#include "PngDecoder.h"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CAITHE_PNG_SSE2 1
+#endif
+
+namespace {
+
+constexpr uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+// Filter types from the PNG specification, section 9.2
+enum FilterType : uint8_t {
+    FILTER_NONE = 0,
+    FILTER_SUB = 1,
+    FILTER_UP = 2,
+    FILTER_AVG = 3,
+    FILTER_PAETH = 4
+};
+
+// Color types from the PNG specification, section 11.2.2
+enum ColorType : uint8_t {
+    COLOR_GRAY = 0,
+    COLOR_RGB = 2,
+    COLOR_PALETTE = 3,
+    COLOR_GRAY_ALPHA = 4,
+    COLOR_RGBA = 6
+};
+
+inline uint32_t readBigEndian32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline uint32_t chunkTag(const char* tag) {
+    return readBigEndian32(reinterpret_cast<const uint8_t*>(tag));
+}
+
+// Paeth predictor: choose the neighbour closest to p = a + b - c (ties favour a, then b)
+inline uint8_t paethPredictor(int a, int b, int c) {
+    const int pa = std::abs(b - c);
+    const int pb = std::abs(a - c);
+    const int pc = std::abs(a + b - 2 * c);
+    if (pa <= pb && pa <= pc) {
+        return static_cast<uint8_t>(a);
+    }
+    return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+void unfilterUp(uint8_t* out, const uint8_t* in, const uint8_t* prior, size_t n) {
+    size_t i = 0;
+#ifdef CAITHE_PNG_SSE2
+    // Up has no horizontal dependency, so whole 16-byte vectors can be reconstructed
+    for (; i + 16 <= n; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prior + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi8(x, b));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = static_cast<uint8_t>(in[i] + prior[i]);
+    }
+}
+
+void unfilterSubScalar(uint8_t* out, const uint8_t* in, size_t n, int bpp) {
+    for (int i = 0; i < bpp && static_cast<size_t>(i) < n; ++i) {
+        out[i] = in[i];
+    }
+    for (size_t i = bpp; i < n; ++i) {
+        out[i] = static_cast<uint8_t>(in[i] + out[i - bpp]);
+    }
+}
+
+void unfilterAvgScalar(uint8_t* out, const uint8_t* in, const uint8_t* prior, size_t n, int bpp) {
+    for (int i = 0; i < bpp && static_cast<size_t>(i) < n; ++i) {
+        out[i] = static_cast<uint8_t>(in[i] + (prior[i] >> 1));
+    }
+    for (size_t i = bpp; i < n; ++i) {
+        out[i] = static_cast<uint8_t>(in[i] + ((out[i - bpp] + prior[i]) >> 1));
+    }
+}
+
+void unfilterPaethScalar(uint8_t* out, const uint8_t* in, const uint8_t* prior, size_t n, int bpp) {
+    for (int i = 0; i < bpp && static_cast<size_t>(i) < n; ++i) {
+        out[i] = static_cast<uint8_t>(in[i] + prior[i]);
+    }
+    for (size_t i = bpp; i < n; ++i) {
+        out[i] = static_cast<uint8_t>(in[i] + paethPredictor(out[i - bpp], prior[i], prior[i - bpp]));
+    }
+}
+
+#ifdef CAITHE_PNG_SSE2
+
+// Whole-pixel loads/stores for 3- and 4-byte pixels. memcpy keeps the accesses
+// within the scanline (no over-read on the last RGB pixel)
+template <int BPP>
+inline __m128i loadPixel(const uint8_t* p) {
+    uint32_t value = 0;
+    std::memcpy(&value, p, BPP);
+    return _mm_cvtsi32_si128(static_cast<int>(value));
+}
+
+template <int BPP>
+inline void storePixel(uint8_t* p, __m128i v) {
+    const uint32_t value = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+    std::memcpy(p, &value, BPP);
+}
+
+template <int BPP>
+void unfilterSubSse2(uint8_t* out, const uint8_t* in, size_t n) {
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i + BPP <= n; i += BPP) {
+        a = _mm_add_epi8(a, loadPixel<BPP>(in + i));
+        storePixel<BPP>(out + i, a);
+    }
+}
+
+template <int BPP>
+void unfilterAvgSse2(uint8_t* out, const uint8_t* in, const uint8_t* prior, size_t n) {
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i + BPP <= n; i += BPP) {
+        const __m128i b = loadPixel<BPP>(prior + i);
+        const __m128i x = loadPixel<BPP>(in + i);
+        // _mm_avg_epu8 rounds up; subtract the carry bit to get floor((a + b) / 2)
+        const __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(x, average);
+        storePixel<BPP>(out + i, a);
+    }
+}
+
+inline __m128i absInt16(__m128i x) {
+    const __m128i negative = _mm_cmplt_epi16(x, _mm_setzero_si128());
+    return _mm_sub_epi16(_mm_xor_si128(x, negative), negative);
+}
+
+inline __m128i select(__m128i mask, __m128i whenTrue, __m128i whenFalse) {
+    return _mm_or_si128(_mm_and_si128(mask, whenTrue), _mm_andnot_si128(mask, whenFalse));
+}
+
+template <int BPP>
+void unfilterPaethSse2(uint8_t* out, const uint8_t* in, const uint8_t* prior, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    // a = left, b = above, c = upper-left; widened to 16 bits for signed distances
+    __m128i a = zero;
+    __m128i c = zero;
+    for (size_t i = 0; i + BPP <= n; i += BPP) {
+        const __m128i b = _mm_unpacklo_epi8(loadPixel<BPP>(prior + i), zero);
+        __m128i x = _mm_unpacklo_epi8(loadPixel<BPP>(in + i), zero);
+
+        // |p - a| = |b - c|, |p - b| = |a - c|, |p - c| = |a + b - 2c|
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = _mm_add_epi16(pa, pb);
+        pa = absInt16(pa);
+        pb = absInt16(pb);
+        pc = absInt16(pc);
+
+        const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        const __m128i nearest = select(_mm_cmpeq_epi16(smallest, pa), a,
+                                       select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+        // Both operands have zero high bytes, so the 8-bit add wraps per channel
+        x = _mm_add_epi8(x, nearest);
+        storePixel<BPP>(out + i, _mm_packus_epi16(x, x));
+
+        a = x;
+        c = b;
+    }
+}
+
+#endif // CAITHE_PNG_SSE2
+
+} // namespace
+
+PngDecoder::PngDecoder()
+    : m_idatData(nullptr)
+    , m_idatSize(0)
+    , m_idatChunks(0)
+    , m_paletteSize(0)
+    , m_hasColorKey(false)
+    , m_colorKey{0, 0, 0}
+    , m_lastErrorCode(ErrorCode::None) {
+    std::memset(m_palette, 0, sizeof(m_palette));
+}
+
+PngDecoder::~PngDecoder() = default;
+
+bool PngDecoder::isPng(const uint8_t* data, size_t size) {
+    return data && size >= sizeof(PNG_SIGNATURE) &&
+           std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0;
+}
+
+bool PngDecoder::readInfo(const uint8_t* data, size_t size, PngInfo& info) {
+    clearError();
+    return parseChunks(data, size, info, true);
+}
+
+bool PngDecoder::decode(const uint8_t* data, size_t size, ImageBuffer& out, int outputChannels) {
+    clearError();
+
+    PngInfo info;
+    if (!parseChunks(data, size, info, false)) {
+        return false;
+    }
+    if (outputChannels != 3 && outputChannels != 4) {
+        return setError(ErrorCode::UnsupportedFormat, "Output must be RGB or RGBA");
+    }
+
+    out.allocate(static_cast<int>(info.width), static_cast<int>(info.height), outputChannels);
+    return decodePixels(info, out.pixels.data(), out.stride, outputChannels);
+}
+
+bool PngDecoder::decodeInto(const uint8_t* data, size_t size, uint8_t* dst, size_t dstStride,
+                            size_t dstCapacity, int outputChannels) {
+    clearError();
+
+    PngInfo info;
+    if (!parseChunks(data, size, info, false)) {
+        return false;
+    }
+    if (outputChannels != 3 && outputChannels != 4) {
+        return setError(ErrorCode::UnsupportedFormat, "Output must be RGB or RGBA");
+    }
+
+    // Last row only needs width * channels bytes, the stride padding may be absent
+    const size_t rowBytes = static_cast<size_t>(info.width) * outputChannels;
+    if (!dst || dstStride < rowBytes ||
+        dstCapacity < dstStride * (info.height - 1) + rowBytes) {
+        return setError(ErrorCode::BufferTooSmall, "Destination buffer too small for image");
+    }
+
+    return decodePixels(info, dst, dstStride, outputChannels);
+}
+
+size_t PngDecoder::requiredBufferSize(const PngInfo& info, int outputChannels) {
+    return static_cast<size_t>(info.width) * info.height * static_cast<size_t>(outputChannels);
+}
+
+void PngDecoder::releaseScratch() {
+    std::vector<uint8_t>().swap(m_compressed);
+    std::vector<uint8_t>().swap(m_inflated);
+    std::vector<uint8_t>().swap(m_zeroRow);
+}
+
+std::string PngDecoder::getLastError() const {
+    return m_lastError;
+}
+
+PngDecoder::ErrorCode PngDecoder::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void PngDecoder::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool PngDecoder::unfilterScanline(uint8_t filter, uint8_t* current, const uint8_t* filtered,
+                                  const uint8_t* prior, size_t rowBytes, int bytesPerPixel) {
+    switch (filter) {
+        case FILTER_NONE:
+            if (current != filtered) {
+                std::memcpy(current, filtered, rowBytes);
+            }
+            return true;
+
+        case FILTER_UP:
+            unfilterUp(current, filtered, prior, rowBytes);
+            return true;
+
+        case FILTER_SUB:
+#ifdef CAITHE_PNG_SSE2
+            if (bytesPerPixel == 4) {
+                unfilterSubSse2<4>(current, filtered, rowBytes);
+                return true;
+            }
+            if (bytesPerPixel == 3) {
+                unfilterSubSse2<3>(current, filtered, rowBytes);
+                return true;
+            }
+#endif
+            unfilterSubScalar(current, filtered, rowBytes, bytesPerPixel);
+            return true;
+
+        case FILTER_AVG:
+#ifdef CAITHE_PNG_SSE2
+            if (bytesPerPixel == 4) {
+                unfilterAvgSse2<4>(current, filtered, prior, rowBytes);
+                return true;
+            }
+            if (bytesPerPixel == 3) {
+                unfilterAvgSse2<3>(current, filtered, prior, rowBytes);
+                return true;
+            }
+#endif
+            unfilterAvgScalar(current, filtered, prior, rowBytes, bytesPerPixel);
+            return true;
+
+        case FILTER_PAETH:
+#ifdef CAITHE_PNG_SSE2
+            if (bytesPerPixel == 4) {
+                unfilterPaethSse2<4>(current, filtered, prior, rowBytes);
+                return true;
+            }
+            if (bytesPerPixel == 3) {
+                unfilterPaethSse2<3>(current, filtered, prior, rowBytes);
+                return true;
+            }
+#endif
+            unfilterPaethScalar(current, filtered, prior, rowBytes, bytesPerPixel);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool PngDecoder::parseChunks(const uint8_t* data, size_t size, PngInfo& info, bool headerOnly) {
+    if (!isPng(data, size)) {
+        return setError(ErrorCode::InvalidSignature, "Not a PNG file");
+    }
+
+    // Indices past a short PLTE read transparent black, never the previous image's colours
+    std::memset(m_palette, 0, sizeof(m_palette));
+    m_paletteSize = 0;
+    m_hasColorKey = false;
+    m_idatData = nullptr;
+    m_idatSize = 0;
+    m_idatChunks = 0;
+    m_compressed.clear();
+
+    bool seenHeader = false;
+    size_t offset = sizeof(PNG_SIGNATURE);
+
+    while (offset + 12 <= size) {
+        const uint32_t length = readBigEndian32(data + offset);
+        const uint32_t type = readBigEndian32(data + offset + 4);
+        const uint8_t* payload = data + offset + 8;
+
+        if (length > size - offset - 12) {
+            return setError(ErrorCode::CorruptData, "Chunk extends past end of file");
+        }
+
+        if (!seenHeader && type != chunkTag("IHDR")) {
+            // CgBI (Apple-optimized) and other exotic streams go to the fallback decoder
+            return setError(type == chunkTag("CgBI") ? ErrorCode::UnsupportedFormat : ErrorCode::CorruptData,
+                            "First chunk is not IHDR");
+        }
+
+        if (type == chunkTag("IHDR")) {
+            if (length != 13) {
+                return setError(ErrorCode::CorruptData, "Invalid IHDR length");
+            }
+            info.width = readBigEndian32(payload);
+            info.height = readBigEndian32(payload + 4);
+            info.bitDepth = payload[8];
+            info.colorType = payload[9];
+            info.interlace = payload[12];
+
+            if (info.width == 0 || info.height == 0 ||
+                info.width > MAX_DIMENSION || info.height > MAX_DIMENSION) {
+                return setError(ErrorCode::CorruptData, "Invalid image dimensions");
+            }
+            if (static_cast<uint64_t>(info.width) * info.height > MAX_PIXELS) {
+                return setError(ErrorCode::CorruptData, "Image too large: " + std::to_string(info.width) + "x" +
+                                std::to_string(info.height));
+            }
+            if (payload[10] != 0 || payload[11] != 0) {
+                return setError(ErrorCode::CorruptData, "Unknown compression or filter method");
+            }
+
+            switch (info.colorType) {
+                case COLOR_GRAY: info.sourceChannels = 1; break;
+                case COLOR_RGB: info.sourceChannels = 3; break;
+                case COLOR_PALETTE: info.sourceChannels = 1; break;
+                case COLOR_GRAY_ALPHA: info.sourceChannels = 2; break;
+                case COLOR_RGBA: info.sourceChannels = 4; break;
+                default:
+                    return setError(ErrorCode::CorruptData, "Invalid color type");
+            }
+
+            seenHeader = true;
+            if (headerOnly) {
+                return true;
+            }
+
+            if (info.bitDepth != 8 || info.interlace != 0) {
+                return setError(ErrorCode::UnsupportedFormat,
+                                "Fast path handles 8-bit non-interlaced PNG only");
+            }
+        } else if (type == chunkTag("PLTE")) {
+            if (length % 3 != 0 || length / 3 > 256) {
+                return setError(ErrorCode::CorruptData, "Invalid PLTE length");
+            }
+            m_paletteSize = static_cast<int>(length / 3);
+            for (int i = 0; i < m_paletteSize; ++i) {
+                m_palette[i * 4 + 0] = payload[i * 3 + 0];
+                m_palette[i * 4 + 1] = payload[i * 3 + 1];
+                m_palette[i * 4 + 2] = payload[i * 3 + 2];
+                m_palette[i * 4 + 3] = 255;
+            }
+        } else if (type == chunkTag("tRNS")) {
+            if (info.colorType == COLOR_PALETTE) {
+                if (static_cast<int>(length) > m_paletteSize) {
+                    return setError(ErrorCode::CorruptData, "tRNS longer than palette");
+                }
+                for (uint32_t i = 0; i < length; ++i) {
+                    m_palette[i * 4 + 3] = payload[i];
+                }
+            } else if (info.colorType == COLOR_GRAY && length == 2) {
+                m_hasColorKey = true;
+                m_colorKey[0] = payload[1];  // 8-bit images use the low byte of the 16-bit sample
+            } else if (info.colorType == COLOR_RGB && length == 6) {
+                m_hasColorKey = true;
+                for (int i = 0; i < 3; ++i) {
+                    m_colorKey[i] = payload[i * 2 + 1];
+                }
+            }
+        } else if (type == chunkTag("IDAT")) {
+            // Single-IDAT files are inflated in place; multi-IDAT files are concatenated
+            if (m_idatChunks == 0) {
+                m_idatData = payload;
+                m_idatSize = length;
+            } else {
+                if (m_idatChunks == 1) {
+                    m_compressed.assign(m_idatData, m_idatData + m_idatSize);
+                }
+                m_compressed.insert(m_compressed.end(), payload, payload + length);
+                m_idatData = m_compressed.data();
+                m_idatSize = m_compressed.size();
+            }
+            ++m_idatChunks;
+        } else if (type == chunkTag("IEND")) {
+            break;
+        } else if (!(type & 0x20000000u)) {
+            // Unknown critical chunk (uppercase first letter): not safe to ignore
+            return setError(ErrorCode::UnsupportedFormat, "Unknown critical chunk");
+        }
+
+        offset += 12 + static_cast<size_t>(length);
+    }
+
+    if (!seenHeader) {
+        return setError(ErrorCode::CorruptData, "Missing IHDR chunk");
+    }
+    if (info.colorType == COLOR_PALETTE && m_paletteSize == 0) {
+        return setError(ErrorCode::CorruptData, "Palette image without PLTE chunk");
+    }
+    if (m_idatChunks == 0) {
+        return setError(ErrorCode::CorruptData, "Missing IDAT chunk");
+    }
+
+    return true;
+}
+
+bool PngDecoder::decodePixels(const PngInfo& info, uint8_t* dst, size_t dstStride, int outputChannels) {
+    const int bytesPerPixel = info.sourceChannels;
+    const size_t rowBytes = static_cast<size_t>(info.width) * bytesPerPixel;
+    const size_t filteredSize = (rowBytes + 1) * info.height;
+
+    // Scratch buffers grow to the largest image seen and are then reused
+    if (m_inflated.size() < filteredSize) {
+        m_inflated.resize(filteredSize);
+    }
+    if (m_zeroRow.size() < rowBytes) {
+        m_zeroRow.assign(rowBytes, 0);
+    }
+
+    size_t written = 0;
+    if (!m_inflater.inflateZlib(m_idatData, m_idatSize, m_inflated.data(), filteredSize, written)) {
+        return setError(ErrorCode::InflateFailed, "Inflate failed: " + m_inflater.getLastError());
+    }
+    if (written != filteredSize) {
+        return setError(ErrorCode::CorruptData, "Not enough pixel data");
+    }
+
+    // Direct path: scanlines already match the output layout, so reconstruct straight
+    // into the destination and use the previous destination row as the prior scanline
+    const bool direct = info.colorType != COLOR_PALETTE && info.sourceChannels == outputChannels;
+
+    const uint8_t* prior = m_zeroRow.data();
+    for (uint32_t y = 0; y < info.height; ++y) {
+        uint8_t* filtered = m_inflated.data() + y * (rowBytes + 1);
+        const uint8_t filter = filtered[0];
+        ++filtered;
+
+        uint8_t* dstRow = dst + y * dstStride;
+        uint8_t* current = direct ? dstRow : filtered;
+
+        if (!unfilterScanline(filter, current, filtered, prior, rowBytes, bytesPerPixel)) {
+            return setError(ErrorCode::CorruptData, "Invalid scanline filter type");
+        }
+
+        if (!direct) {
+            convertScanline(current, dstRow, info.width, info.colorType == COLOR_PALETTE ? 0 : info.sourceChannels,
+                            outputChannels);
+        }
+        prior = current;
+    }
+
+    return true;
+}
+
+void PngDecoder::convertScanline(const uint8_t* source, uint8_t* dst, uint32_t width,
+                                 int sourceChannels, int outputChannels) const {
+    // sourceChannels == 0 marks palette indices
+    switch (sourceChannels) {
+        case 0:
+            for (uint32_t x = 0; x < width; ++x) {
+                std::memcpy(dst + x * outputChannels, m_palette + source[x] * 4, outputChannels);
+            }
+            break;
+
+        case 1:
+            for (uint32_t x = 0; x < width; ++x) {
+                const uint8_t g = source[x];
+                uint8_t* p = dst + x * outputChannels;
+                p[0] = p[1] = p[2] = g;
+                if (outputChannels == 4) {
+                    p[3] = (m_hasColorKey && g == m_colorKey[0]) ? 0 : 255;
+                }
+            }
+            break;
+
+        case 2:
+            for (uint32_t x = 0; x < width; ++x) {
+                const uint8_t* s = source + x * 2;
+                uint8_t* p = dst + x * outputChannels;
+                p[0] = p[1] = p[2] = s[0];
+                if (outputChannels == 4) {
+                    p[3] = s[1];
+                }
+            }
+            break;
+
+        case 3:
+            // Only reached for RGBA output (RGB -> RGB takes the direct path)
+            for (uint32_t x = 0; x < width; ++x) {
+                const uint8_t* s = source + x * 3;
+                uint8_t* p = dst + x * 4;
+                p[0] = s[0];
+                p[1] = s[1];
+                p[2] = s[2];
+                p[3] = (m_hasColorKey && s[0] == m_colorKey[0] && s[1] == m_colorKey[1] &&
+                        s[2] == m_colorKey[2]) ? 0 : 255;
+            }
+            break;
+
+        case 4:
+            // Only reached for RGB output (RGBA -> RGBA takes the direct path)
+            for (uint32_t x = 0; x < width; ++x) {
+                std::memcpy(dst + x * 3, source + x * 4, 3);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool PngDecoder::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
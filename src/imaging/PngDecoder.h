@@ -0,0 +1,115 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: PngDecoder.h
+ * Description: Fast-path PNG decoder for wallpaper-sized 8-bit images with SIMD unfiltering
+ *
+ * Decode Pipeline:
+ * - Chunk walk: IHDR/PLTE/tRNS are parsed, IDAT payloads are concatenated, CRCs are skipped
+ * - Inflate: the zlib stream is expanded into a reusable scratch buffer of exactly
+ *   height * (rowBytes + 1) bytes (one filter byte per scanline)
+ * - Unfilter: Sub/Up/Avg/Paeth are reversed per scanline. Up is 16 bytes per step;
+ *   Sub/Avg/Paeth are sequential across pixels, so SSE2 processes one whole 3- or
+ *   4-byte pixel per step (recon(x) depends on recon(x - bpp))
+ * - Output: when the source already has the requested channel count the scanline is
+ *   unfiltered straight into the destination row, otherwise it is expanded in place
+ *
+ * Supported fast-path formats: 8-bit, non-interlaced gray, gray+alpha, RGB, RGBA and
+ * palette images. Anything else reports ErrorCode::UnsupportedFormat so callers can
+ * fall back to a general-purpose decoder.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+#include "Inflate.h"
+
+struct PngInfo {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t bitDepth = 0;
+    uint8_t colorType = 0;
+    uint8_t interlace = 0;
+    int sourceChannels = 0;     // Channels per pixel in the encoded scanlines
+};
+
+class PngDecoder {
+public:
+    PngDecoder();
+    ~PngDecoder();
+
+    // Header inspection without decoding pixel data
+    static bool isPng(const uint8_t* data, size_t size);
+    bool readInfo(const uint8_t* data, size_t size, PngInfo& info);
+
+    // Decode into an owned buffer (storage is reused when the buffer is recycled)
+    bool decode(const uint8_t* data, size_t size, ImageBuffer& out, int outputChannels = 4);
+
+    // Decode directly into caller-provided memory (arena or pooled buffer).
+    // `dstStride` may exceed width * outputChannels for padded/aligned rows.
+    bool decodeInto(const uint8_t* data, size_t size, uint8_t* dst, size_t dstStride,
+                    size_t dstCapacity, int outputChannels = 4);
+
+    // Bytes needed by decodeInto for a tightly packed destination
+    static size_t requiredBufferSize(const PngInfo& info, int outputChannels = 4);
+
+    // Release pooled scratch memory
+    void releaseScratch();
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        InvalidSignature = 1,
+        CorruptData = 2,
+        UnsupportedFormat = 3,
+        BufferTooSmall = 4,
+        InflateFailed = 5
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+    // Scanline unfiltering (public for testing). `filtered` is the encoded scanline,
+    // `current` receives the reconstruction and may alias `filtered`, and `prior` is the
+    // previous reconstructed scanline (all zeros for the first row)
+    static bool unfilterScanline(uint8_t filter, uint8_t* current, const uint8_t* filtered,
+                                 const uint8_t* prior, size_t rowBytes, int bytesPerPixel);
+
+private:
+    bool parseChunks(const uint8_t* data, size_t size, PngInfo& info, bool headerOnly);
+    bool decodePixels(const PngInfo& info, uint8_t* dst, size_t dstStride, int outputChannels);
+    void convertScanline(const uint8_t* source, uint8_t* dst, uint32_t width,
+                         int sourceChannels, int outputChannels) const;
+    bool setError(ErrorCode code, const std::string& message);
+
+    // Pooled scratch, reused between decodes to avoid per-image allocation
+    std::vector<uint8_t> m_compressed;
+    std::vector<uint8_t> m_inflated;
+    std::vector<uint8_t> m_zeroRow;
+    InflateDecoder m_inflater;
+
+    // Compressed stream: points into the caller's data for single-IDAT files,
+    // otherwise into m_compressed
+    const uint8_t* m_idatData;
+    size_t m_idatSize;
+    int m_idatChunks;
+
+    // Palette (RGBA) and transparency state of the image being decoded
+    uint8_t m_palette[256 * 4];
+    int m_paletteSize;
+    bool m_hasColorKey;
+    uint16_t m_colorKey[3];
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+
+    // Largest dimension and pixel count accepted before treating the header as corrupt;
+    // 2^28 pixels is 1 GiB of RGBA, so a crafted header cannot ask for the scratch of 2^32
+    static constexpr uint32_t MAX_DIMENSION = 1u << 16;
+    static constexpr uint64_t MAX_PIXELS = uint64_t(1) << 28;
+};
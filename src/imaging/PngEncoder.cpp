@@ -0,0 +1,213 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: PngEncoder.cpp
+ * Description: Implementation of the stored-deflate PNG writer and its checksums
+ */
+
+#include "PngEncoder.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+constexpr size_t STORED_BLOCK_MAX = 65535;
+constexpr uint32_t ADLER_MOD = 65521;
+constexpr size_t ADLER_NMAX = 5552;     // Largest n keeping the sums below 2^32
+
+// table[k][b] = CRC of byte b followed by k zero bytes
+const std::array<std::array<uint32_t, 256>, 8>& crcTables() {
+    static const std::array<std::array<uint32_t, 256>, 8> tables = [] {
+        std::array<std::array<uint32_t, 256>, 8> t{};
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t c = b;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[0][b] = c;
+        }
+        for (uint32_t b = 0; b < 256; ++b) {
+            for (int k = 1; k < 8; ++k) {
+                t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xff];
+            }
+        }
+        return t;
+    }();
+    return tables;
+}
+
+void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Length, type and data are already in `out` from `start`; append the CRC
+void finishChunk(std::vector<uint8_t>& out, size_t start) {
+    putBigEndian(out, PngEncoder::crc32(out.data() + start + 4, out.size() - start - 4));
+}
+
+} // namespace
+
+PngEncoder::PngEncoder()
+    : m_lastErrorCode(ErrorCode::None) {
+}
+
+PngEncoder::~PngEncoder() = default;
+
+bool PngEncoder::encode(const ImageBuffer& image, std::vector<uint8_t>& out) {
+    clearError();
+    out.clear();
+    if (image.empty() || image.channels < 1 || image.channels > 4) {
+        return setError(ErrorCode::InvalidImage, "Image is empty or has an unsupported channel count");
+    }
+
+    static constexpr uint8_t COLOR_TYPES[5] = {0, 0, 4, 2, 6};
+    const size_t rowBytes = static_cast<size_t>(image.width) * image.channels;
+    const size_t rawSize = (rowBytes + 1) * image.height;
+    const size_t blocks = (rawSize + STORED_BLOCK_MAX - 1) / STORED_BLOCK_MAX;
+    const size_t idatSize = 2 + blocks * 5 + rawSize + 4;
+    out.reserve(sizeof(PNG_SIGNATURE) + 25 + 12 + idatSize + 12);
+
+    out.insert(out.end(), PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+
+    size_t chunk = out.size();
+    putBigEndian(out, 13);
+    out.insert(out.end(), {'I', 'H', 'D', 'R'});
+    putBigEndian(out, static_cast<uint32_t>(image.width));
+    putBigEndian(out, static_cast<uint32_t>(image.height));
+    out.insert(out.end(), {8, COLOR_TYPES[image.channels], 0, 0, 0});
+    finishChunk(out, chunk);
+
+    chunk = out.size();
+    putBigEndian(out, static_cast<uint32_t>(idatSize));
+    out.insert(out.end(), {'I', 'D', 'A', 'T'});
+    out.insert(out.end(), {0x78, 0x01});    // zlib: deflate, 32K window, no preset dictionary
+
+    // Stored blocks over the filtered scanlines, streamed straight from the image rows
+    uint32_t adler = 1;
+    size_t row = 0;
+    size_t column = 0;                      // 0 is the filter byte, then 1..rowBytes
+    size_t remaining = rawSize;
+    while (remaining > 0) {
+        const size_t length = std::min(remaining, STORED_BLOCK_MAX);
+        remaining -= length;
+        out.push_back(remaining == 0 ? 1 : 0);
+        out.push_back(static_cast<uint8_t>(length));
+        out.push_back(static_cast<uint8_t>(length >> 8));
+        out.push_back(static_cast<uint8_t>(~length));
+        out.push_back(static_cast<uint8_t>(~length >> 8));
+
+        const size_t blockStart = out.size();
+        for (size_t left = length; left > 0;) {
+            if (column == 0) {
+                out.push_back(0);
+                column = 1;
+                --left;
+                continue;
+            }
+            const size_t take = std::min(left, rowBytes + 1 - column);
+            const uint8_t* source = image.row(static_cast<int>(row)) + column - 1;
+            out.insert(out.end(), source, source + take);
+            left -= take;
+            column += take;
+            if (column == rowBytes + 1) {
+                column = 0;
+                ++row;
+            }
+        }
+        adler = adler32(out.data() + blockStart, out.size() - blockStart, adler);
+    }
+    putBigEndian(out, adler);
+    finishChunk(out, chunk);
+
+    chunk = out.size();
+    putBigEndian(out, 0);
+    out.insert(out.end(), {'I', 'E', 'N', 'D'});
+    finishChunk(out, chunk);
+    return true;
+}
+
+bool PngEncoder::writeFile(const ImageBuffer& image, const std::string& path) {
+    if (!encode(image, m_encoded)) {
+        return false;
+    }
+
+    const std::string temporary = path + ".tmp" + std::to_string(::getpid());
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return setError(ErrorCode::WriteFailed, "Cannot create " + temporary);
+    }
+    const bool written = std::fwrite(m_encoded.data(), 1, m_encoded.size(), file) == m_encoded.size();
+    if (std::fclose(file) != 0 || !written) {
+        std::remove(temporary.c_str());
+        return setError(ErrorCode::WriteFailed, "Failed writing " + temporary);
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::remove(temporary.c_str());
+        return setError(ErrorCode::WriteFailed, "Cannot rename to " + path + ": " + error.message());
+    }
+    return true;
+}
+
+uint32_t PngEncoder::crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    const auto& t = crcTables();
+    crc = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, data, 4);
+        std::memcpy(&high, data + 4, 4);
+        low ^= crc;     // Slice-by-8 tables assume little-endian loads
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+    }
+    for (; size > 0; --size, ++data) {
+        crc = t[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t PngEncoder::adler32(const uint8_t* data, size_t size, uint32_t adler) {
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        const size_t run = std::min(size, ADLER_NMAX);
+        for (size_t i = 0; i < run; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= ADLER_MOD;
+        b %= ADLER_MOD;
+        data += run;
+        size -= run;
+    }
+    return (b << 16) | a;
+}
+
+std::string PngEncoder::getLastError() const {
+    return m_lastError;
+}
+
+PngEncoder::ErrorCode PngEncoder::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void PngEncoder::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool PngEncoder::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
@@ -0,0 +1,55 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: PngEncoder.h
+ * Description: Fast PNG writer for pre-rendered wallpapers
+ *
+ * Encode Pipeline:
+ * - Pre-renders are written once and read back by hyprpaper, usually within seconds, so
+ *   encode and decode speed matter more than file size: scanlines use filter None and
+ *   the zlib stream uses stored (uncompressed) deflate blocks of up to 65535 bytes
+ * - CRC-32 (chunk checksums) runs slice-by-8 and Adler-32 (zlib trailer) defers the
+ *   modulo to every 5552 bytes, so checksums stay well below the cost of the copy
+ * - The whole image is a single IDAT chunk
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+
+class PngEncoder {
+public:
+    PngEncoder();
+    ~PngEncoder();
+
+    // 1-4 channel 8-bit images (gray, gray+alpha, RGB, RGBA)
+    bool encode(const ImageBuffer& image, std::vector<uint8_t>& out);
+    // Written to a temporary name and renamed, so readers never see a partial file
+    bool writeFile(const ImageBuffer& image, const std::string& path);
+
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+    static uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        InvalidImage = 1,
+        WriteFailed = 2
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool setError(ErrorCode code, const std::string& message);
+
+    std::vector<uint8_t> m_encoded;     // Reused by writeFile()
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
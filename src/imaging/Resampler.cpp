@@ -0,0 +1,262 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: Resampler.cpp
+ * Description: Implementation of orientation-aware separable resampling
+ */
+
+#include "Resampler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int WEIGHT_BITS = 14;
+constexpr int WEIGHT_ONE = 1 << WEIGHT_BITS;
+constexpr int WEIGHT_ROUND = 1 << (WEIGHT_BITS - 1);
+
+inline uint8_t clampToByte(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+double filterRadius(Resampler::Filter filter) {
+    return filter == Resampler::Filter::Box ? 0.5 : 1.0;
+}
+
+double filterWeight(Resampler::Filter filter, double t) {
+    if (filter == Resampler::Filter::Box) {
+        return (t >= -0.5 && t < 0.5) ? 1.0 : 0.0;
+    }
+    t = std::fabs(t);
+    return t < 1.0 ? 1.0 - t : 0.0;
+}
+
+} // namespace
+
+template <int Channels>
+void Resampler::resampleRow(const uint8_t* in, uint8_t* out, int outputWidth, const AxisWeights& axis) {
+    for (int u = 0; u < outputWidth; ++u) {
+        const uint8_t* taps = in + static_cast<size_t>(axis.first[u]) * Channels;
+        const int16_t* weights = &axis.weights[axis.offset[u]];
+        const int count = axis.count[u];
+
+        int sum[Channels];
+        for (int c = 0; c < Channels; ++c) {
+            sum[c] = WEIGHT_ROUND;
+        }
+        for (int k = 0; k < count; ++k) {
+            for (int c = 0; c < Channels; ++c) {
+                sum[c] += taps[k * Channels + c] * weights[k];
+            }
+        }
+        for (int c = 0; c < Channels; ++c) {
+            out[u * Channels + c] = clampToByte(sum[c] >> WEIGHT_BITS);
+        }
+    }
+}
+
+Resampler::Resampler()
+    : m_lastErrorCode(ErrorCode::None) {
+}
+
+Resampler::~Resampler() = default;
+
+bool Resampler::resample(const ImageBuffer& src, ImageOrientation orientation, ImageBuffer& dst,
+                         int dstWidth, int dstHeight, Filter filter) {
+    return resampleRegion(src, orientation, ResampleRegion{}, dst, dstWidth, dstHeight, filter);
+}
+
+bool Resampler::resampleRegion(const ImageBuffer& src, ImageOrientation orientation, const ResampleRegion& region,
+                               ImageBuffer& dst, int dstWidth, int dstHeight, Filter filter) {
+    clearError();
+
+    if (src.empty() || src.channels < 1 || src.channels > 4) {
+        return setError(ErrorCode::InvalidArgument, "Source image is empty or has an unsupported channel count");
+    }
+    if (dstWidth <= 0 || dstHeight <= 0) {
+        return setError(ErrorCode::InvalidArgument, "Destination size must be positive");
+    }
+    if (&src == &dst) {
+        return setError(ErrorCode::InvalidArgument, "Resampling cannot run in place");
+    }
+
+    const bool swapsAxes = orientationSwapsAxes(orientation);
+    const double displayWidth = swapsAxes ? src.height : src.width;
+    const double displayHeight = swapsAxes ? src.width : src.height;
+
+    // Region in displayed coordinates, defaulting to (and clipped against) the whole image
+    double regionX = region.x;
+    double regionY = region.y;
+    double regionWidth = region.width > 0.0 ? region.width : displayWidth;
+    double regionHeight = region.height > 0.0 ? region.height : displayHeight;
+    if (regionX < 0.0 || regionY < 0.0 || regionX + regionWidth > displayWidth + 1e-9 ||
+        regionY + regionHeight > displayHeight + 1e-9) {
+        return setError(ErrorCode::InvalidArgument, "Region lies outside the image");
+    }
+
+    // Map the displayed region back to stored coordinates. On continuous coordinates the
+    // orientation map has offsets of W or H (rather than W - 1 or H - 1) for flipped axes.
+    const OrientationMap map = OrientationMap::forOrientation(orientation, src.width, src.height);
+    const double continuousX0 = map.x0 != 0 ? map.x0 + 1 : 0;
+    const double continuousY0 = map.y0 != 0 ? map.y0 + 1 : 0;
+
+    auto storedInterval = [](double start, double length, double origin, int direction,
+                             double& outStart, double& outLength) {
+        const double a = (start - origin) / direction;
+        const double b = (start + length - origin) / direction;
+        outStart = std::min(a, b);
+        outLength = std::fabs(b - a);
+    };
+
+    double uStart, uLength, vStart, vLength;
+    if (map.xu != 0) {
+        storedInterval(regionX, regionWidth, continuousX0, map.xu, uStart, uLength);
+        storedInterval(regionY, regionHeight, continuousY0, map.yv, vStart, vLength);
+    } else {
+        storedInterval(regionY, regionHeight, continuousY0, map.yu, uStart, uLength);
+        storedInterval(regionX, regionWidth, continuousX0, map.xv, vStart, vLength);
+    }
+
+    // Output size in stored orientation: the stored u axis becomes displayed y when swapped
+    const int scaledWidth = swapsAxes ? dstHeight : dstWidth;
+    const int scaledHeight = swapsAxes ? dstWidth : dstHeight;
+
+    computeWeights(uStart, uLength, src.width, scaledWidth, filter, m_horizontal);
+    computeWeights(vStart, vLength, src.height, scaledHeight, filter, m_vertical);
+
+    const int channels = src.channels;
+    const int firstRow = m_vertical.first.front();
+    const int lastRow = m_vertical.first.back() + m_vertical.count.back() - 1;
+    const size_t intermediateStride = static_cast<size_t>(scaledWidth) * channels;
+    m_intermediate.resize(intermediateStride * (lastRow - firstRow + 1));
+
+    // Horizontal pass along stored rows, only for the rows the vertical pass will read
+    for (int y = firstRow; y <= lastRow; ++y) {
+        uint8_t* out = &m_intermediate[(y - firstRow) * intermediateStride];
+        switch (channels) {
+            case 1: resampleRow<1>(src.row(y), out, scaledWidth, m_horizontal); break;
+            case 2: resampleRow<2>(src.row(y), out, scaledWidth, m_horizontal); break;
+            case 3: resampleRow<3>(src.row(y), out, scaledWidth, m_horizontal); break;
+            default: resampleRow<4>(src.row(y), out, scaledWidth, m_horizontal); break;
+        }
+    }
+
+    dst.allocate(dstWidth, dstHeight, channels);
+
+    // Vertical pass: accumulate whole rows, then scatter each finished row to its oriented
+    // position. A stored-space row maps to a fixed start and a constant step in dst.
+    const OrientationMap scaledMap = OrientationMap::forOrientation(orientation, scaledWidth, scaledHeight);
+    const ptrdiff_t step = static_cast<ptrdiff_t>(scaledMap.xu) * channels +
+                           static_cast<ptrdiff_t>(scaledMap.yu) * static_cast<ptrdiff_t>(dst.stride);
+
+    std::vector<int> accumulator(intermediateStride);
+    for (int v = 0; v < scaledHeight; ++v) {
+        std::fill(accumulator.begin(), accumulator.end(), WEIGHT_ROUND);
+
+        const int16_t* weights = &m_vertical.weights[m_vertical.offset[v]];
+        const int count = m_vertical.count[v];
+        for (int k = 0; k < count; ++k) {
+            const uint8_t* in = &m_intermediate[(m_vertical.first[v] + k - firstRow) * intermediateStride];
+            const int weight = weights[k];
+            for (size_t i = 0; i < intermediateStride; ++i) {
+                accumulator[i] += in[i] * weight;
+            }
+        }
+
+        uint8_t* out = dst.row(scaledMap.mapY(0, v)) + static_cast<size_t>(scaledMap.mapX(0, v)) * channels;
+        for (int u = 0; u < scaledWidth; ++u, out += step) {
+            for (int c = 0; c < channels; ++c) {
+                out[c] = clampToByte(accumulator[u * channels + c] >> WEIGHT_BITS);
+            }
+        }
+    }
+
+    return true;
+}
+
+std::string Resampler::getLastError() const {
+    return m_lastError;
+}
+
+Resampler::ErrorCode Resampler::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void Resampler::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+void Resampler::computeWeights(double start, double length, int sourceSize, int outputSize,
+                               Filter filter, AxisWeights& axis) {
+    axis.first.resize(outputSize);
+    axis.count.resize(outputSize);
+    axis.offset.resize(outputSize);
+    axis.weights.clear();
+
+    const double scale = outputSize / length;
+    const double filterScale = std::min(scale, 1.0);
+    const double support = filterRadius(filter) / filterScale;
+
+    std::vector<double> taps;
+    for (int i = 0; i < outputSize; ++i) {
+        const double center = start + (i + 0.5) / scale;
+
+        // Taps outside the image fold onto the border sample (clamp-to-edge)
+        const int left = static_cast<int>(std::floor(center - support));
+        const int right = static_cast<int>(std::ceil(center + support));
+        const int first = std::clamp(left, 0, sourceSize - 1);
+        const int last = std::clamp(right, 0, sourceSize - 1);
+
+        taps.assign(last - first + 1, 0.0);
+        double total = 0.0;
+        for (int j = left; j <= right; ++j) {
+            const double weight = filterWeight(filter, (j + 0.5 - center) * filterScale);
+            if (weight > 0.0) {
+                taps[std::clamp(j, first, last) - first] += weight;
+                total += weight;
+            }
+        }
+
+        // Degenerate coverage (possible at sub-pixel regions): nearest sample
+        if (total <= 0.0) {
+            const int nearest = std::clamp(static_cast<int>(std::floor(center)), first, last);
+            std::fill(taps.begin(), taps.end(), 0.0);
+            taps[nearest - first] = 1.0;
+            total = 1.0;
+        }
+
+        // Trim zero taps at both ends so the inner loops stay short
+        int begin = 0;
+        int end = static_cast<int>(taps.size());
+        while (begin < end - 1 && taps[begin] == 0.0) {
+            ++begin;
+        }
+        while (end - 1 > begin && taps[end - 1] == 0.0) {
+            --end;
+        }
+
+        // Quantize so that every run sums exactly to WEIGHT_ONE
+        axis.first[i] = first + begin;
+        axis.count[i] = end - begin;
+        axis.offset[i] = static_cast<int>(axis.weights.size());
+
+        int sum = 0;
+        int largest = static_cast<int>(axis.weights.size());
+        for (int k = begin; k < end; ++k) {
+            const int weight = static_cast<int>(std::lround(taps[k] / total * WEIGHT_ONE));
+            axis.weights.push_back(static_cast<int16_t>(weight));
+            sum += weight;
+            if (weight > axis.weights[largest]) {
+                largest = static_cast<int>(axis.weights.size()) - 1;
+            }
+        }
+        axis.weights[largest] = static_cast<int16_t>(axis.weights[largest] + (WEIGHT_ONE - sum));
+    }
+}
+
+bool Resampler::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
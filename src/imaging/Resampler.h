@@ -0,0 +1,85 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: Resampler.h
+ * Description: Separable image resampling with EXIF orientation applied inside the scaling pass
+ *
+ * Mathematical Foundation:
+ * - Output sample i on an axis of scale s = dst / src is centred at c = (i + 0.5) / s in
+ *   source coordinates; source sample j contributes f((j + 0.5 - c) * min(s, 1)), so the
+ *   kernel widens by 1/s when shrinking (area averaging) and stays unit width when enlarging
+ * - Weights are normalized to 1 << 14 in fixed point; edge taps are clamped to the border
+ * - The horizontal pass runs along stored rows (cache friendly); the vertical pass writes
+ *   each result straight to its rotated/flipped destination through OrientationMap, so
+ *   orientation costs no extra full-image copy
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+#include "ImageOrientation.h"
+
+// Sub-rectangle of the displayed (post-orientation) image, in pixels
+struct ResampleRegion {
+    double x = 0.0;
+    double y = 0.0;
+    double width = 0.0;     // 0 selects the whole image
+    double height = 0.0;
+};
+
+class Resampler {
+public:
+    enum class Filter {
+        Box,        // Area average; sharpest for large reductions
+        Triangle    // Bilinear when enlarging, tent-weighted average when shrinking
+    };
+
+    Resampler();
+    ~Resampler();
+
+    // Scale the whole image to dstWidth x dstHeight as displayed under `orientation`
+    bool resample(const ImageBuffer& src, ImageOrientation orientation, ImageBuffer& dst,
+                  int dstWidth, int dstHeight, Filter filter = Filter::Triangle);
+
+    // Scale a displayed-space region (e.g. the visible part of a cover fit) in one pass
+    bool resampleRegion(const ImageBuffer& src, ImageOrientation orientation, const ResampleRegion& region,
+                        ImageBuffer& dst, int dstWidth, int dstHeight, Filter filter = Filter::Triangle);
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        InvalidArgument = 1
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    // Contributing source samples for every output sample of one axis
+    struct AxisWeights {
+        std::vector<int> first;         // First source index per output sample
+        std::vector<int> count;         // Taps per output sample
+        std::vector<int> offset;        // Start of the taps in `weights`
+        std::vector<int16_t> weights;   // Fixed point, each run sums to 1 << 14
+    };
+
+    static void computeWeights(double start, double length, int sourceSize, int outputSize,
+                               Filter filter, AxisWeights& axis);
+
+    // Horizontal pass over one row, specialized per channel count
+    template <int Channels>
+    static void resampleRow(const uint8_t* in, uint8_t* out, int outputWidth, const AxisWeights& axis);
+
+    bool setError(ErrorCode code, const std::string& message);
+
+    AxisWeights m_horizontal;
+    AxisWeights m_vertical;
+    std::vector<uint8_t> m_intermediate;    // Horizontally scaled rows, reused between calls
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
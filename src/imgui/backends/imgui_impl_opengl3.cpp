@@ -217,6 +217,11 @@
 #define IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
 #endif
 
+// Caithe: Desktop GL 4.1+ (or GL_ARB_get_program_binary) and GL ES 3.0+ have glGetProgramBinary()/glProgramBinary(), WebGL doesn't.
+#if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(__EMSCRIPTEN__)
+#define IMGUI_IMPL_OPENGL_MAY_HAVE_PROGRAM_BINARY
+#endif
+
 // [Debugging]
 //#define IMGUI_IMPL_OPENGL_DEBUG
 #ifdef IMGUI_IMPL_OPENGL_DEBUG
@@ -247,8 +252,10 @@ struct ImGui_ImplOpenGL3_Data
     GLsizeiptr      IndexBufferSize;
     bool            HasPolygonMode;
     bool            HasClipOrigin;
+    bool            HasProgramBinary;
     bool            UseBufferSubData;
     ImVector<char>  TempBuffer;
+    char            ProgramCacheDir[512];    // Caithe: see ImGui_ImplOpenGL3_SetProgramCacheDir(), empty when disabled
 
     ImGui_ImplOpenGL3_Data() { memset((void*)this, 0, sizeof(*this)); }
 };
@@ -398,6 +405,9 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
     bd->HasPolygonMode = (!bd->GlProfileIsES2 && !bd->GlProfileIsES3);
 #endif
     bd->HasClipOrigin = (bd->GlVersion >= 450);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PROGRAM_BINARY
+    bd->HasProgramBinary = (bd->GlVersion >= 410 || bd->GlProfileIsES3);
+#endif
 #ifdef IMGUI_IMPL_OPENGL_HAS_EXTENSIONS
     GLint num_extensions = 0;
     glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
@@ -406,6 +416,19 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
         const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
         if (extension != nullptr && strcmp(extension, "GL_ARB_clip_control") == 0)
             bd->HasClipOrigin = true;
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PROGRAM_BINARY
+        if (extension != nullptr && strcmp(extension, "GL_ARB_get_program_binary") == 0)
+            bd->HasProgramBinary = true;
+#endif
+    }
+#endif
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PROGRAM_BINARY
+    // A driver may support the entry points but no binary format at all
+    if (bd->HasProgramBinary)
+    {
+        GLint num_binary_formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+        bd->HasProgramBinary = (num_binary_formats > 0);
     }
 #endif
 
@@ -765,8 +788,18 @@ void ImGui_ImplOpenGL3_UpdateTexture(ImTextureData* tex)
         GL_CALL(glBindTexture(GL_TEXTURE_2D, gl_tex_id));
 #if GL_UNPACK_ROW_LENGTH // Not on WebGL/ES
         GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, tex->Width));
+        // Caithe: glyphs rasterized in the same frame are packed next to each other, so when their
+        // bounding box is at most twice their area, upload it once instead of once per glyph.
+        // Pixels between the rects are already valid in tex->Pixels, so re-sending them is harmless.
+        int update_area = 0;
         for (ImTextureRect& r : tex->Updates)
-            GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_RGBA, GL_UNSIGNED_BYTE, tex->GetPixelsAt(r.x, r.y)));
+            update_area += r.w * r.h;
+        const ImTextureRect& bounds = tex->UpdateRect;
+        if (tex->Updates.Size > 1 && bounds.w * bounds.h <= update_area * 2)
+            GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, bounds.x, bounds.y, bounds.w, bounds.h, GL_RGBA, GL_UNSIGNED_BYTE, tex->GetPixelsAt(bounds.x, bounds.y)));
+        else
+            for (ImTextureRect& r : tex->Updates)
+                GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_RGBA, GL_UNSIGNED_BYTE, tex->GetPixelsAt(r.x, r.y)));
         GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
 #else
         // GL ES doesn't have GL_UNPACK_ROW_LENGTH, so we need to (A) copy to a contiguous buffer or (B) upload line by line.
@@ -827,6 +860,136 @@ static bool CheckProgram(GLuint handle, const char* desc)
     return (GLboolean)status == GL_TRUE;
 }
 
+// Caithe: linked program cache.
+// Compiling and linking from GLSL costs milliseconds per program on hardware drivers and far more
+// on llvmpipe, while glProgramBinary() only reloads the driver's own output. Entries are keyed by
+// GL_VENDOR, GL_RENDERER, GL_VERSION and the shader sources, so a driver update or a shader edit
+// falls back to compiling; the driver also rejects binaries it no longer accepts.
+// File: "IMGLPROG", u64 key, u32 binary format, u32 binary length, binary.
+static const char   ProgramCacheMagic[8] = { 'I', 'M', 'G', 'L', 'P', 'R', 'O', 'G' };
+static const ImU32  ProgramCacheMaxBytes = 16 * 1024 * 1024;
+
+void    ImGui_ImplOpenGL3_SetProgramCacheDir(const char* dir)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != nullptr && "Context or backend not initialized! Did you call ImGui_ImplOpenGL3_Init()?");
+    IM_ASSERT((dir == nullptr || strlen(dir) + 32 < sizeof(bd->ProgramCacheDir)) && "Program cache directory too long");
+    bd->ProgramCacheDir[0] = 0;
+    if (dir != nullptr && strlen(dir) + 32 < sizeof(bd->ProgramCacheDir))
+        strcpy(bd->ProgramCacheDir, dir);
+}
+
+// FNV-1a over the strings, each followed by a 0xFF byte (never present in GLSL or driver strings)
+static ImU64 ImGui_ImplOpenGL3_HashProgramKey(const char* const* strings, int count)
+{
+    ImU64 hash = 0xcbf29ce484222325ULL;
+    for (int n = 0; n < count; n++)
+    {
+        for (const char* p = strings[n] ? strings[n] : ""; *p; p++)
+            hash = (hash ^ (unsigned char)*p) * 0x100000001b3ULL;
+        hash = (hash ^ 0xFF) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PROGRAM_BINARY
+static void ImGui_ImplOpenGL3_GetProgramCachePath(ImU64 key, char* out, size_t out_size)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    snprintf(out, out_size, "%s/%016llx.bin", bd->ProgramCacheDir, (unsigned long long)key);
+}
+#endif
+
+// Returns 0 when there is no usable cached binary
+static GLuint ImGui_ImplOpenGL3_LoadCachedProgram(ImU64 key)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PROGRAM_BINARY
+    if (!bd->HasProgramBinary || bd->ProgramCacheDir[0] == 0)
+        return 0;
+    char path[sizeof(bd->ProgramCacheDir) + 32];
+    ImGui_ImplOpenGL3_GetProgramCachePath(key, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr)
+        return 0;
+    char magic[8];
+    ImU64 stored_key = 0;
+    ImU32 format = 0, length = 0;
+    ImVector<char> binary;
+    bool ok = fread(magic, sizeof(magic), 1, f) == 1 && memcmp(magic, ProgramCacheMagic, sizeof(magic)) == 0
+           && fread(&stored_key, sizeof(stored_key), 1, f) == 1 && stored_key == key
+           && fread(&format, sizeof(format), 1, f) == 1 && fread(&length, sizeof(length), 1, f) == 1
+           && length > 0 && length <= ProgramCacheMaxBytes;
+    if (ok)
+    {
+        binary.resize((int)length);
+        ok = fread(binary.Data, 1, length, f) == length;
+    }
+    fclose(f);
+    if (!ok)
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)format, binary.Data, (GLsizei)length);
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if ((GLboolean)status == GL_TRUE)
+        return program;
+    glGetError(); // A stale binary format raises GL_INVALID_ENUM; we recompile instead, so clear it
+    glDeleteProgram(program);
+    return 0;
+#else
+    IM_UNUSED(bd);
+    IM_UNUSED(key);
+    return 0;
+#endif
+}
+
+static void ImGui_ImplOpenGL3_SaveCachedProgram(GLuint program, ImU64 key)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PROGRAM_BINARY
+    if (!bd->HasProgramBinary || bd->ProgramCacheDir[0] == 0)
+        return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0 || (ImU32)length > ProgramCacheMaxBytes)
+        return;
+    ImVector<char> binary;
+    binary.resize((int)length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, (GLsizei)length, &written, &format, binary.Data);
+    if (written <= 0)
+        return;
+
+    // Write a temporary file and rename it over the entry, so a concurrent start never reads half a binary
+    char path[sizeof(bd->ProgramCacheDir) + 32];
+    char temp_path[sizeof(path) + 4];
+    ImGui_ImplOpenGL3_GetProgramCachePath(key, path, sizeof(path));
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* f = fopen(temp_path, "wb");
+    if (f == nullptr)
+        return;
+    const ImU32 format32 = (ImU32)format, length32 = (ImU32)written;
+    bool ok = fwrite(ProgramCacheMagic, sizeof(ProgramCacheMagic), 1, f) == 1
+           && fwrite(&key, sizeof(key), 1, f) == 1
+           && fwrite(&format32, sizeof(format32), 1, f) == 1 && fwrite(&length32, sizeof(length32), 1, f) == 1
+           && fwrite(binary.Data, 1, length32, f) == length32;
+    ok = (fclose(f) == 0) && ok;
+#ifdef _WIN32
+    if (ok)
+        remove(path);
+#endif
+    if (!ok || rename(temp_path, path) != 0)
+        remove(temp_path);
+#else
+    IM_UNUSED(bd);
+    IM_UNUSED(program);
+    IM_UNUSED(key);
+#endif
+}
+
 bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
 {
     ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
@@ -972,35 +1135,47 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
         fragment_shader = fragment_shader_glsl_130;
     }
 
-    // Create shaders
-    const GLchar* vertex_shader_with_version[2] = { bd->GlslVersionString, vertex_shader };
-    GLuint vert_handle;
-    GL_CALL(vert_handle = glCreateShader(GL_VERTEX_SHADER));
-    glShaderSource(vert_handle, 2, vertex_shader_with_version, nullptr);
-    glCompileShader(vert_handle);
-    if (!CheckShader(vert_handle, "vertex shader"))
-        return false;
-
-    const GLchar* fragment_shader_with_version[2] = { bd->GlslVersionString, fragment_shader };
-    GLuint frag_handle;
-    GL_CALL(frag_handle = glCreateShader(GL_FRAGMENT_SHADER));
-    glShaderSource(frag_handle, 2, fragment_shader_with_version, nullptr);
-    glCompileShader(frag_handle);
-    if (!CheckShader(frag_handle, "fragment shader"))
-        return false;
-
-    // Link
-    bd->ShaderHandle = glCreateProgram();
-    glAttachShader(bd->ShaderHandle, vert_handle);
-    glAttachShader(bd->ShaderHandle, frag_handle);
-    glLinkProgram(bd->ShaderHandle);
-    if (!CheckProgram(bd->ShaderHandle, "shader program"))
-        return false;
-
-    glDetachShader(bd->ShaderHandle, vert_handle);
-    glDetachShader(bd->ShaderHandle, frag_handle);
-    glDeleteShader(vert_handle);
-    glDeleteShader(frag_handle);
+    // Caithe: reuse the program linked by an earlier run with the same driver and sources
+    const char* program_key_strings[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION), bd->GlslVersionString, vertex_shader, fragment_shader };
+    const ImU64 program_key = ImGui_ImplOpenGL3_HashProgramKey(program_key_strings, IM_ARRAYSIZE(program_key_strings));
+    bd->ShaderHandle = ImGui_ImplOpenGL3_LoadCachedProgram(program_key);
+    if (bd->ShaderHandle == 0)
+    {
+        // Create shaders
+        const GLchar* vertex_shader_with_version[2] = { bd->GlslVersionString, vertex_shader };
+        GLuint vert_handle;
+        GL_CALL(vert_handle = glCreateShader(GL_VERTEX_SHADER));
+        glShaderSource(vert_handle, 2, vertex_shader_with_version, nullptr);
+        glCompileShader(vert_handle);
+        if (!CheckShader(vert_handle, "vertex shader"))
+            return false;
+
+        const GLchar* fragment_shader_with_version[2] = { bd->GlslVersionString, fragment_shader };
+        GLuint frag_handle;
+        GL_CALL(frag_handle = glCreateShader(GL_FRAGMENT_SHADER));
+        glShaderSource(frag_handle, 2, fragment_shader_with_version, nullptr);
+        glCompileShader(frag_handle);
+        if (!CheckShader(frag_handle, "fragment shader"))
+            return false;
+
+        // Link
+        bd->ShaderHandle = glCreateProgram();
+        glAttachShader(bd->ShaderHandle, vert_handle);
+        glAttachShader(bd->ShaderHandle, frag_handle);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PROGRAM_BINARY
+        if (bd->HasProgramBinary && bd->ProgramCacheDir[0] != 0)
+            glProgramParameteri(bd->ShaderHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+        glLinkProgram(bd->ShaderHandle);
+        if (!CheckProgram(bd->ShaderHandle, "shader program"))
+            return false;
+
+        glDetachShader(bd->ShaderHandle, vert_handle);
+        glDetachShader(bd->ShaderHandle, frag_handle);
+        glDeleteShader(vert_handle);
+        glDeleteShader(frag_handle);
+        ImGui_ImplOpenGL3_SaveCachedProgram(bd->ShaderHandle, program_key);
+    }
 
     bd->AttribLocationTex = glGetUniformLocation(bd->ShaderHandle, "Texture");
     bd->AttribLocationProjMtx = glGetUniformLocation(bd->ShaderHandle, "ProjMtx");
@@ -43,6 +43,10 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 // (Advanced) Use e.g. if you need to precisely control the timing of texture updates (e.g. for staged rendering), by setting ImDrawData::Textures = NULL to handle this manually.
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_UpdateTexture(ImTextureData* tex);
 
+// (Caithe) Cache linked shader programs as glGetProgramBinary() output in 'dir', which must exist. Call after Init() and before the first NewFrame().
+// Ignored when the driver has no binary formats. nullptr or "" disables the cache.
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetProgramCacheDir(const char* dir);
+
 // Configuration flags to add in your imconfig file:
 //#define IMGUI_IMPL_OPENGL_ES2     // Enable ES 2 (Auto-detected on Emscripten)
 //#define IMGUI_IMPL_OPENGL_ES3     // Enable ES 3 (Auto-detected on iOS/Android)
@@ -19,6 +19,8 @@
 //
 // Regenerate with:
 //   python3 gl3w_gen.py --output ../imgui/backends/imgui_impl_opengl3_loader.h --ref ../imgui/backends/imgui_impl_opengl3.cpp ./extra_symbols.txt
+// Caithe: glGetProgramBinary, glProgramBinary and glProgramParameteri (GL 4.1 / ARB_get_program_binary)
+// were added by hand for the program binary cache; list them in extra_symbols.txt when regenerating.
 //
 // More info:
 //   https://github.com/dearimgui/gl3w_stripped
@@ -406,6 +408,12 @@ GLAPI void APIENTRY glBindSampler (GLuint unit, GLuint sampler);
 #endif
 #endif /* GL_VERSION_3_3 */
 #ifndef GL_VERSION_4_1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC) (GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC) (GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC) (GLuint program, GLenum pname, GLint value);
 typedef void (APIENTRYP PFNGLGETFLOATI_VPROC) (GLenum target, GLuint index, GLfloat *data);
 typedef void (APIENTRYP PFNGLGETDOUBLEI_VPROC) (GLenum target, GLuint index, GLdouble *data);
 #endif /* GL_VERSION_4_1 */
@@ -483,7 +491,7 @@ GL3W_API GL3WglProc imgl3wGetProcAddress(const char *proc);
 
 /* gl3w internal state */
 union ImGL3WProcs {
-    GL3WglProc ptr[60];
+    GL3WglProc ptr[63];
     struct {
         PFNGLACTIVETEXTUREPROC            ActiveTexture;
         PFNGLATTACHSHADERPROC             AttachShader;
@@ -520,6 +528,7 @@ union ImGL3WProcs {
         PFNGLGETATTRIBLOCATIONPROC        GetAttribLocation;
         PFNGLGETERRORPROC                 GetError;
         PFNGLGETINTEGERVPROC              GetIntegerv;
+        PFNGLGETPROGRAMBINARYPROC         GetProgramBinary;
         PFNGLGETPROGRAMINFOLOGPROC        GetProgramInfoLog;
         PFNGLGETPROGRAMIVPROC             GetProgramiv;
         PFNGLGETSHADERINFOLOGPROC         GetShaderInfoLog;
@@ -534,6 +543,8 @@ union ImGL3WProcs {
         PFNGLLINKPROGRAMPROC              LinkProgram;
         PFNGLPIXELSTOREIPROC              PixelStorei;
         PFNGLPOLYGONMODEPROC              PolygonMode;
+        PFNGLPROGRAMBINARYPROC            ProgramBinary;
+        PFNGLPROGRAMPARAMETERIPROC        ProgramParameteri;
         PFNGLREADPIXELSPROC               ReadPixels;
         PFNGLSCISSORPROC                  Scissor;
         PFNGLSHADERSOURCEPROC             ShaderSource;
@@ -586,6 +597,7 @@ GL3W_API extern union ImGL3WProcs imgl3wProcs;
 #define glGetAttribLocation               imgl3wProcs.gl.GetAttribLocation
 #define glGetError                        imgl3wProcs.gl.GetError
 #define glGetIntegerv                     imgl3wProcs.gl.GetIntegerv
+#define glGetProgramBinary                imgl3wProcs.gl.GetProgramBinary
 #define glGetProgramInfoLog               imgl3wProcs.gl.GetProgramInfoLog
 #define glGetProgramiv                    imgl3wProcs.gl.GetProgramiv
 #define glGetShaderInfoLog                imgl3wProcs.gl.GetShaderInfoLog
@@ -600,6 +612,8 @@ GL3W_API extern union ImGL3WProcs imgl3wProcs;
 #define glLinkProgram                     imgl3wProcs.gl.LinkProgram
 #define glPixelStorei                     imgl3wProcs.gl.PixelStorei
 #define glPolygonMode                     imgl3wProcs.gl.PolygonMode
+#define glProgramBinary                   imgl3wProcs.gl.ProgramBinary
+#define glProgramParameteri               imgl3wProcs.gl.ProgramParameteri
 #define glReadPixels                      imgl3wProcs.gl.ReadPixels
 #define glScissor                         imgl3wProcs.gl.Scissor
 #define glShaderSource                    imgl3wProcs.gl.ShaderSource
@@ -887,6 +901,7 @@ static const char *proc_names[] = {
     "glGetAttribLocation",
     "glGetError",
     "glGetIntegerv",
+    "glGetProgramBinary",
     "glGetProgramInfoLog",
     "glGetProgramiv",
     "glGetShaderInfoLog",
@@ -901,6 +916,8 @@ static const char *proc_names[] = {
     "glLinkProgram",
     "glPixelStorei",
     "glPolygonMode",
+    "glProgramBinary",
+    "glProgramParameteri",
     "glReadPixels",
     "glScissor",
     "glShaderSource",
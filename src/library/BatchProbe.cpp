@@ -0,0 +1,538 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: BatchProbe.cpp
+ * Description: Implementation of io_uring batch header probing and its worker fallback
+ */
+
+#include "BatchProbe.h"
+#include "../utils/FileDescriptor.h"
+#include "../utils/Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Parse the `filled` bytes read so far. Returns true when `result` is final, false when
+// the header continues past them and the file may hold more (the last read was not short).
+bool parsePrefix(ImageProbe& probe, const uint8_t* data, size_t filled, bool shortRead, ProbeResult& result) {
+    if (filled == 0) {
+        result.error = ImageProbe::ErrorCode::ReadFailed;     // Empty file
+        return true;
+    }
+    if (probe.probeMemory(data, filled, result.header)) {
+        result.ok = true;
+        result.error = ImageProbe::ErrorCode::None;
+        return true;
+    }
+    result.error = probe.getLastErrorCode();
+    return result.error != ImageProbe::ErrorCode::Truncated || shortRead;
+}
+
+// The fallback path: the same reads and growth rule as the ring, one blocking call at a time
+ProbeResult probeWithPread(const std::string& path, ImageProbe& probe, std::vector<uint8_t>& buffer,
+                           TaskScheduler& scheduler, IoClass ioClass, uint64_t& bytesRead, bool& followUp) {
+    ProbeResult result;
+    FileDescriptor fd(path);
+    if (fd.get() < 0) {
+        result.error = ImageProbe::ErrorCode::FileNotFound;
+        result.systemError = errno;
+        return result;
+    }
+
+    size_t filled = 0;
+    buffer.resize(ImageProbe::PROBE_READ_BYTES);
+    for (;;) {
+        const size_t requested = buffer.size() - filled;
+        const ssize_t count = ::pread(fd.get(), buffer.data() + filled, requested, static_cast<off_t>(filled));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result.error = ImageProbe::ErrorCode::ReadFailed;
+            result.systemError = errno;
+            return result;
+        }
+        filled += static_cast<size_t>(count);
+        bytesRead += static_cast<uint64_t>(count);
+        scheduler.throttle(ioClass, static_cast<uint64_t>(count));
+        if (parsePrefix(probe, buffer.data(), filled, static_cast<size_t>(count) < requested, result)) {
+            return result;
+        }
+        followUp = true;
+        buffer.resize(buffer.size() * 4);
+    }
+}
+
+} // namespace
+
+// Minimal io_uring over the raw syscalls: one SQ and one CQ, no SQPOLL, no registered files
+class BatchProbe::Ring {
+public:
+    static std::unique_ptr<Ring> create(unsigned entries) {
+        std::unique_ptr<Ring> ring(new Ring());
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CLAMP;
+        ring->m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring->m_fd < 0) {
+            return nullptr;
+        }
+
+        ring->m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            ring->m_sqRingSize = ring->m_cqRingSize = std::max(ring->m_sqRingSize, ring->m_cqRingSize);
+        }
+        ring->m_sqRing = ::mmap(nullptr, ring->m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                ring->m_fd, IORING_OFF_SQ_RING);
+        if (ring->m_sqRing == MAP_FAILED) {
+            return nullptr;
+        }
+        if (single) {
+            ring->m_cqRing = ring->m_sqRing;
+        } else {
+            ring->m_cqRing = ::mmap(nullptr, ring->m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                    ring->m_fd, IORING_OFF_CQ_RING);
+            if (ring->m_cqRing == MAP_FAILED) {
+                return nullptr;
+            }
+        }
+        ring->m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, ring->m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->m_fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        uint8_t* sq = static_cast<uint8_t*>(ring->m_sqRing);
+        uint8_t* cq = static_cast<uint8_t*>(ring->m_cqRing);
+        ring->m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        ring->m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        ring->m_sqEntries = params.sq_entries;
+        ring->m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        ring->m_sqLocalTail = *ring->m_sqTail;
+
+        // openat and close need 5.6; older kernels (or seccomp filters) fall back to threads
+        std::vector<uint8_t> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (::syscall(__NR_io_uring_register, ring->m_fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+            return nullptr;
+        }
+        for (const unsigned op : { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE }) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return nullptr;
+            }
+        }
+        return ring;
+    }
+
+    ~Ring() {
+        if (m_sqes) {
+            ::munmap(m_sqes, m_sqesSize);
+        }
+        if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) {
+            ::munmap(m_cqRing, m_cqRingSize);
+        }
+        if (m_sqRing != MAP_FAILED) {
+            ::munmap(m_sqRing, m_sqRingSize);
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    unsigned getEntries() const { return m_sqEntries; }
+
+    // Zeroed SQE queued for the next enter(), or null when the queue is full
+    io_uring_sqe* acquire() {
+        if (m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) {
+            return nullptr;
+        }
+        const unsigned index = m_sqLocalTail & m_sqMask;
+        io_uring_sqe* sqe = &m_sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        m_sqArray[index] = index;
+        ++m_sqLocalTail;
+        return sqe;
+    }
+
+    // Submit everything queued and wait for at least `waitFor` completions; -errno on failure
+    int enter(unsigned waitFor) {
+        __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+        const unsigned pending = m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        const long result = ::syscall(__NR_io_uring_enter, m_fd, pending, waitFor,
+                                      waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        return result < 0 ? -errno : static_cast<int>(result);
+    }
+
+    bool pop(io_uring_cqe& out) {
+        const unsigned head = *m_cqHead;
+        if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        out = m_cqes[head & m_cqMask];
+        __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Read buffers live as long as the ring: after a failed enter() the kernel may still own them
+    std::vector<uint8_t>& buffer(size_t slot) {
+        if (m_buffers.size() <= slot) {
+            m_buffers.resize(slot + 1);
+        }
+        return m_buffers[slot];
+    }
+
+private:
+    Ring() = default;
+
+    int m_fd = -1;
+    void* m_sqRing = MAP_FAILED;
+    void* m_cqRing = MAP_FAILED;
+    size_t m_sqRingSize = 0;
+    size_t m_cqRingSize = 0;
+    io_uring_sqe* m_sqes = nullptr;
+    size_t m_sqesSize = 0;
+
+    unsigned* m_sqHead = nullptr;
+    unsigned* m_sqTail = nullptr;
+    unsigned* m_sqArray = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned m_sqEntries = 0;
+    unsigned m_sqLocalTail = 0;
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+
+    std::deque<std::vector<uint8_t>> m_buffers;
+};
+
+// Hands results to the callback as they come, or holds them until every earlier index is out
+class BatchProbe::Reorder {
+public:
+    Reorder(Order order, const ResultCallback& callback, Stats& stats)
+        : m_order(order)
+        , m_callback(callback)
+        , m_stats(stats)
+        , m_next(0) {
+    }
+
+    void push(ProbeResult&& result) {
+        m_stats.probed += result.ok ? 1 : 0;
+        if (m_order == Order::Completion) {
+            m_callback(result);
+            return;
+        }
+        m_pending.emplace(result.index, std::move(result));
+        for (auto it = m_pending.begin(); it != m_pending.end() && it->first == m_next; it = m_pending.begin()) {
+            m_callback(it->second);
+            m_pending.erase(it);
+            ++m_next;
+        }
+    }
+
+private:
+    Order m_order;
+    const ResultCallback& m_callback;
+    Stats& m_stats;
+    size_t m_next;
+    std::map<size_t, ProbeResult> m_pending;
+};
+
+BatchProbe::BatchProbe(size_t queueDepth)
+    : m_queueDepth(std::max<size_t>(1, queueDepth))
+    , m_ring(Ring::create(static_cast<unsigned>(std::min<size_t>(m_queueDepth, 32768))))
+    , m_backend(m_ring ? Backend::IoUring : Backend::Threads)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+BatchProbe::~BatchProbe() = default;
+
+bool BatchProbe::probe(const std::vector<std::string>& paths, TaskScheduler& scheduler, IoClass ioClass,
+                       const ResultCallback& onResult, Order order) {
+    clearError();
+    m_stats = Stats{};
+    m_stats.files = paths.size();
+    Reorder reorder(order, onResult, m_stats);
+
+    std::vector<size_t> remaining;
+    bool ok = true;
+    if (m_backend == Backend::IoUring && !paths.empty()) {
+        ok = probeRing(paths, scheduler, ioClass, reorder, remaining);
+    } else {
+        remaining.resize(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            remaining[i] = i;
+        }
+    }
+    if (!remaining.empty()) {
+        probeThreads(paths, remaining, scheduler, ioClass, reorder);
+    }
+    CAITHE_LOG_DEBUG("Probed {} of {} headers: {} bytes, {} follow-up reads, {} ring enters, {} on workers",
+                     m_stats.probed, m_stats.files, m_stats.bytesRead, m_stats.followUpReads, m_stats.ringEnters,
+                     remaining.size());
+    return ok;
+}
+
+BatchProbe::Backend BatchProbe::getBackend() const {
+    return m_backend;
+}
+
+bool BatchProbe::setBackend(Backend backend) {
+    if (backend == Backend::IoUring && !m_ring) {
+        return false;
+    }
+    m_backend = backend;
+    return true;
+}
+
+bool BatchProbe::isIoUringAvailable() {
+    return Ring::create(1) != nullptr;
+}
+
+BatchProbe::Stats BatchProbe::getStats() const {
+    return m_stats;
+}
+
+std::string BatchProbe::getLastError() const {
+    return m_lastError;
+}
+
+BatchProbe::ErrorCode BatchProbe::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void BatchProbe::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool BatchProbe::probeRing(const std::vector<std::string>& paths, TaskScheduler& scheduler, IoClass ioClass,
+                           Reorder& reorder, std::vector<size_t>& unfinished) {
+    enum class Stage { Idle, Open, Read, Close };
+    struct Slot {
+        Stage stage = Stage::Idle;
+        size_t index = 0;
+        int fd = -1;
+        size_t filled = 0;
+        size_t requested = 0;
+        bool reported = false;
+        ProbeResult result;
+    };
+
+    Ring& ring = *m_ring;
+    std::vector<Slot> slots(std::min<size_t>({ m_queueDepth, ring.getEntries(), paths.size() }));
+    std::vector<size_t> freeSlots(slots.size());
+    for (size_t s = 0; s < slots.size(); ++s) {
+        freeSlots[s] = slots.size() - 1 - s;
+    }
+    size_t next = 0;
+    size_t outstanding = 0;     // Operations submitted or queued, not yet completed
+
+    // Every slot has at most one operation outstanding and the ring has an entry per slot,
+    // so acquire() cannot fail here
+    auto submitRead = [&](size_t s) {
+        Slot& slot = slots[s];
+        std::vector<uint8_t>& buffer = ring.buffer(s);
+        if (slot.filled == 0) {
+            buffer.resize(ImageProbe::PROBE_READ_BYTES);    // Shrink back after a grown header
+        }
+        slot.stage = Stage::Read;
+        slot.requested = buffer.size() - slot.filled;
+        io_uring_sqe* sqe = ring.acquire();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = slot.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer.data() + slot.filled);
+        sqe->len = static_cast<uint32_t>(slot.requested);
+        sqe->off = slot.filled;
+        sqe->user_data = s;
+        ++outstanding;
+    };
+    auto submitClose = [&](size_t s) {
+        Slot& slot = slots[s];
+        slot.stage = Stage::Close;
+        io_uring_sqe* sqe = ring.acquire();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = slot.fd;
+        sqe->user_data = s;
+        ++outstanding;
+    };
+    auto report = [&](size_t s) {
+        Slot& slot = slots[s];
+        slot.result.index = slot.index;
+        slot.reported = true;
+        reorder.push(std::move(slot.result));
+    };
+    auto release = [&](size_t s) {
+        slots[s].stage = Stage::Idle;
+        freeSlots.push_back(s);
+    };
+
+    for (;;) {
+        while (!freeSlots.empty() && next < paths.size()) {
+            const size_t s = freeSlots.back();
+            freeSlots.pop_back();
+            Slot& slot = slots[s];
+            slot = Slot();
+            slot.stage = Stage::Open;
+            slot.index = next++;
+            io_uring_sqe* sqe = ring.acquire();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uint64_t>(paths[slot.index].c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = s;
+            ++outstanding;
+        }
+        if (outstanding == 0) {
+            return true;
+        }
+        m_stats.peakInFlight = std::max(m_stats.peakInFlight, slots.size() - freeSlots.size());
+
+        const int entered = ring.enter(1);
+        ++m_stats.ringEnters;
+        if (entered < 0 && entered != -EINTR && entered != -EAGAIN && entered != -EBUSY) {
+            // Give up on the ring; files it did not finish are probed on the workers
+            for (const Slot& slot : slots) {
+                if (slot.stage != Stage::Idle && !slot.reported) {
+                    unfinished.push_back(slot.index);
+                }
+            }
+            for (size_t i = next; i < paths.size(); ++i) {
+                unfinished.push_back(i);
+            }
+            std::sort(unfinished.begin(), unfinished.end());
+            m_backend = Backend::Threads;
+            return setError(ErrorCode::RingFailed, std::string("io_uring_enter failed: ") + std::strerror(-entered));
+        }
+
+        io_uring_cqe cqe;
+        while (ring.pop(cqe)) {
+            --outstanding;
+            const size_t s = static_cast<size_t>(cqe.user_data);
+            Slot& slot = slots[s];
+            switch (slot.stage) {
+                case Stage::Open:
+                    if (cqe.res < 0) {
+                        slot.result.error = ImageProbe::ErrorCode::FileNotFound;
+                        slot.result.systemError = -cqe.res;
+                        report(s);
+                        release(s);
+                    } else {
+                        slot.fd = cqe.res;
+                        submitRead(s);
+                    }
+                    break;
+                case Stage::Read: {
+                    if (cqe.res < 0) {
+                        slot.result.error = ImageProbe::ErrorCode::ReadFailed;
+                        slot.result.systemError = -cqe.res;
+                        report(s);
+                        submitClose(s);
+                        break;
+                    }
+                    const size_t count = static_cast<size_t>(cqe.res);
+                    slot.filled += count;
+                    m_stats.bytesRead += count;
+                    scheduler.throttle(ioClass, count);
+                    std::vector<uint8_t>& buffer = ring.buffer(s);
+                    if (parsePrefix(m_probe, buffer.data(), slot.filled, count < slot.requested, slot.result)) {
+                        report(s);
+                        submitClose(s);
+                    } else {
+                        ++m_stats.followUpReads;
+                        buffer.resize(buffer.size() * 4);
+                        submitRead(s);
+                    }
+                    break;
+                }
+                case Stage::Close:
+                case Stage::Idle:
+                    release(s);
+                    break;
+            }
+        }
+    }
+}
+
+void BatchProbe::probeThreads(const std::vector<std::string>& paths, const std::vector<size_t>& indices,
+                              TaskScheduler& scheduler, IoClass ioClass, Reorder& reorder) {
+    struct Shared {
+        std::atomic<size_t> next{0};
+        std::atomic<uint64_t> bytesRead{0};
+        std::atomic<uint64_t> followUpReads{0};
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<ProbeResult> results;
+        size_t running = 0;
+    } shared;
+
+    const size_t workers = std::min(indices.size(), scheduler.getThreadCount());
+    shared.running = workers;
+    m_stats.peakInFlight = std::max(m_stats.peakInFlight, workers);
+    for (size_t w = 0; w < workers; ++w) {
+        scheduler.submit(ioClass, [&shared, &paths, &indices, &scheduler, ioClass] {
+            ImageProbe probe;
+            std::vector<uint8_t> buffer;
+            for (size_t i = shared.next++; i < indices.size(); i = shared.next++) {
+                uint64_t bytesRead = 0;
+                bool followUp = false;
+                ProbeResult result = probeWithPread(paths[indices[i]], probe, buffer, scheduler, ioClass,
+                                                    bytesRead, followUp);
+                result.index = indices[i];
+                shared.bytesRead += bytesRead;
+                shared.followUpReads += followUp ? 1 : 0;
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                shared.results.push_back(std::move(result));
+                shared.ready.notify_one();
+            }
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            --shared.running;
+            shared.ready.notify_one();
+        });
+    }
+
+    // Results are handed to the callback here, on the calling thread
+    std::unique_lock<std::mutex> lock(shared.mutex);
+    for (;;) {
+        shared.ready.wait(lock, [&shared] { return !shared.results.empty() || shared.running == 0; });
+        if (shared.results.empty()) {
+            break;
+        }
+        std::deque<ProbeResult> batch;
+        batch.swap(shared.results);
+        lock.unlock();
+        for (ProbeResult& result : batch) {
+            reorder.push(std::move(result));
+        }
+        lock.lock();
+    }
+    m_stats.bytesRead += shared.bytesRead;
+    m_stats.followUpReads += shared.followUpReads;
+}
+
+bool BatchProbe::setError(ErrorCode code, const std::string& message) {
+    m_lastErrorCode = code;
+    m_lastError = message;
+    return false;
+}
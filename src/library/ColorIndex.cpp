@@ -0,0 +1,200 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ColorIndex.cpp
+ * Description: Implementation of the SIMD chamfer-distance scan and top-k selection
+ */
+
+#include "ColorIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CAITHE_COLOR_SSE2 1
+#endif
+
+namespace {
+
+constexpr int SLOTS = ColorSignature::PALETTE_SIZE;
+constexpr size_t GROUP = 4;             // Signatures per SSE2 register
+constexpr size_t CHUNK = 1024;          // Distances computed per top-k batch
+
+// Used query colors with normalized weights
+struct Query {
+    int count = 0;
+    float l[SLOTS];
+    float a[SLOTS];
+    float b[SLOTS];
+    float weight[SLOTS];
+};
+
+Query prepareQuery(const ColorSignature& signature) {
+    Query query;
+    float total = 0.0f;
+    for (int j = 0; j < SLOTS; ++j) {
+        total += signature.palette[j].weight;
+    }
+    for (int j = 0; j < SLOTS; ++j) {
+        if (signature.palette[j].weight == 0) {
+            continue;
+        }
+        const LabColor color = signature.color(j);
+        query.l[query.count] = color.l;
+        query.a[query.count] = color.a;
+        query.b[query.count] = color.b;
+        query.weight[query.count] = signature.palette[j].weight / total;
+        ++query.count;
+    }
+    return query;
+}
+
+} // namespace
+
+ColorIndex::ColorIndex()
+    : m_count(0)
+    , m_padded(0) {
+}
+
+ColorIndex::~ColorIndex() = default;
+
+void ColorIndex::build(const std::vector<ColorSignature>& signatures) {
+    m_count = signatures.size();
+    m_padded = (m_count + CHUNK - 1) / CHUNK * CHUNK;
+
+    // Padding signatures are black with no weight; their distances are never reported
+    m_l.assign(SLOTS * m_padded, 0.0f);
+    m_a.assign(SLOTS * m_padded, 0.0f);
+    m_b.assign(SLOTS * m_padded, 0.0f);
+    m_weight.assign(SLOTS * m_padded, 0.0f);
+
+    for (size_t i = 0; i < m_count; ++i) {
+        const ColorSignature& signature = signatures[i];
+        float total = 0.0f;
+        for (int s = 0; s < SLOTS; ++s) {
+            total += signature.palette[s].weight;
+        }
+        for (int s = 0; s < SLOTS; ++s) {
+            const LabColor color = signature.color(s);
+            m_l[s * m_padded + i] = color.l;
+            m_a[s * m_padded + i] = color.a;
+            m_b[s * m_padded + i] = color.b;
+            m_weight[s * m_padded + i] = total > 0.0f ? signature.palette[s].weight / total : 0.0f;
+        }
+    }
+}
+
+void ColorIndex::clear() {
+    m_count = 0;
+    m_padded = 0;
+    m_l.clear();
+    m_a.clear();
+    m_b.clear();
+    m_weight.clear();
+}
+
+size_t ColorIndex::size() const {
+    return m_count;
+}
+
+void ColorIndex::distances(const ColorSignature& signature, float* out) const {
+    const Query query = prepareQuery(signature);
+    if (query.count == 0) {
+        std::fill(out, out + m_count, 0.0f);
+        return;
+    }
+
+    float chunk[CHUNK];
+    for (size_t begin = 0; begin < m_count; begin += CHUNK) {
+#ifdef CAITHE_COLOR_SSE2
+        for (size_t i = begin; i < begin + CHUNK; i += GROUP) {
+            __m128 l[SLOTS], a[SLOTS], b[SLOTS], imageNearest[SLOTS];
+            for (int s = 0; s < SLOTS; ++s) {
+                l[s] = _mm_loadu_ps(&m_l[s * m_padded + i]);
+                a[s] = _mm_loadu_ps(&m_a[s * m_padded + i]);
+                b[s] = _mm_loadu_ps(&m_b[s * m_padded + i]);
+                imageNearest[s] = _mm_set1_ps(INFINITY);
+            }
+
+            __m128 queryTerm = _mm_setzero_ps();
+            for (int j = 0; j < query.count; ++j) {
+                const __m128 ql = _mm_set1_ps(query.l[j]);
+                const __m128 qa = _mm_set1_ps(query.a[j]);
+                const __m128 qb = _mm_set1_ps(query.b[j]);
+                __m128 queryNearest = _mm_set1_ps(INFINITY);
+                for (int s = 0; s < SLOTS; ++s) {
+                    const __m128 dl = _mm_sub_ps(l[s], ql);
+                    const __m128 da = _mm_sub_ps(a[s], qa);
+                    const __m128 db = _mm_sub_ps(b[s], qb);
+                    const __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dl, dl), _mm_mul_ps(da, da)),
+                                                            _mm_mul_ps(db, db)));
+                    imageNearest[s] = _mm_min_ps(imageNearest[s], d);
+                    queryNearest = _mm_min_ps(queryNearest, d);
+                }
+                queryTerm = _mm_add_ps(queryTerm, _mm_mul_ps(_mm_set1_ps(query.weight[j]), queryNearest));
+            }
+
+            __m128 imageTerm = _mm_setzero_ps();
+            for (int s = 0; s < SLOTS; ++s) {
+                imageTerm = _mm_add_ps(imageTerm, _mm_mul_ps(_mm_loadu_ps(&m_weight[s * m_padded + i]), imageNearest[s]));
+            }
+            _mm_storeu_ps(&chunk[i - begin], _mm_mul_ps(_mm_set1_ps(0.5f), _mm_add_ps(imageTerm, queryTerm)));
+        }
+#else
+        for (size_t i = begin; i < begin + CHUNK; ++i) {
+            float imageNearest[SLOTS] = {INFINITY, INFINITY, INFINITY, INFINITY};
+            float queryTerm = 0.0f;
+            for (int j = 0; j < query.count; ++j) {
+                float queryNearest = INFINITY;
+                for (int s = 0; s < SLOTS; ++s) {
+                    const float dl = m_l[s * m_padded + i] - query.l[j];
+                    const float da = m_a[s * m_padded + i] - query.a[j];
+                    const float db = m_b[s * m_padded + i] - query.b[j];
+                    const float d = std::sqrt(dl * dl + da * da + db * db);
+                    imageNearest[s] = std::min(imageNearest[s], d);
+                    queryNearest = std::min(queryNearest, d);
+                }
+                queryTerm += query.weight[j] * queryNearest;
+            }
+            float imageTerm = 0.0f;
+            for (int s = 0; s < SLOTS; ++s) {
+                imageTerm += m_weight[s * m_padded + i] * imageNearest[s];
+            }
+            chunk[i - begin] = 0.5f * (imageTerm + queryTerm);
+        }
+#endif
+        std::copy(chunk, chunk + std::min(CHUNK, m_count - begin), out + begin);
+    }
+}
+
+void ColorIndex::nearest(const ColorSignature& query, size_t k, std::vector<ColorMatch>& matches) const {
+    matches.clear();
+    if (k == 0 || m_count == 0) {
+        return;
+    }
+
+    std::vector<float> all(m_count);
+    distances(query, all.data());
+
+    // Max-heap of the best k by (distance, id)
+    auto worse = [](const ColorMatch& x, const ColorMatch& y) {
+        return x.distance != y.distance ? x.distance < y.distance : x.id < y.id;
+    };
+    std::priority_queue<ColorMatch, std::vector<ColorMatch>, decltype(worse)> best(worse);
+    for (size_t i = 0; i < m_count; ++i) {
+        const ColorMatch candidate{static_cast<uint32_t>(i), all[i]};
+        if (best.size() < k) {
+            best.push(candidate);
+        } else if (worse(candidate, best.top())) {
+            best.pop();
+            best.push(candidate);
+        }
+    }
+
+    matches.resize(best.size());
+    for (size_t i = matches.size(); i-- > 0;) {
+        matches[i] = best.top();
+        best.pop();
+    }
+}
@@ -0,0 +1,267 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ColorSignature.cpp
+ * Description: Implementation of CIELAB conversion, palette clustering and signature distance
+ */
+
+#include "ColorSignature.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// D65 reference white
+constexpr float WHITE_X = 0.95047f;
+constexpr float WHITE_Y = 1.0f;
+constexpr float WHITE_Z = 1.08883f;
+
+const std::array<float, 256>& linearTable() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> values{};
+        for (int i = 0; i < 256; ++i) {
+            const float c = i / 255.0f;
+            values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table;
+}
+
+float labF(float t) {
+    constexpr float delta = 6.0f / 29.0f;
+    return t > delta * delta * delta ? std::cbrt(t) : t / (3.0f * delta * delta) + 4.0f / 29.0f;
+}
+
+float squaredDistance(const LabColor& x, const LabColor& y) {
+    const float dl = x.l - y.l;
+    const float da = x.a - y.a;
+    const float db = x.b - y.b;
+    return dl * dl + da * da + db * db;
+}
+
+PaletteEntry quantize(const LabColor& color, uint8_t weight) {
+    PaletteEntry entry;
+    entry.l = static_cast<uint8_t>(std::clamp(std::lround(color.l * 2.55f), 0L, 255L));
+    entry.a = static_cast<int8_t>(std::clamp(std::lround(color.a), -128L, 127L));
+    entry.b = static_cast<int8_t>(std::clamp(std::lround(color.b), -128L, 127L));
+    entry.weight = weight;
+    return entry;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Weighted mean over `from` of the distance to the nearest used color of `to`
+float directedDistance(const ColorSignature& from, const ColorSignature& to) {
+    float sum = 0.0f;
+    float total = 0.0f;
+    for (int i = 0; i < ColorSignature::PALETTE_SIZE; ++i) {
+        if (from.palette[i].weight == 0) {
+            continue;
+        }
+        float nearest = std::numeric_limits<float>::infinity();
+        for (int j = 0; j < ColorSignature::PALETTE_SIZE; ++j) {
+            if (to.palette[j].weight != 0) {
+                nearest = std::min(nearest, squaredDistance(from.color(i), to.color(j)));
+            }
+        }
+        sum += from.palette[i].weight * std::sqrt(nearest);
+        total += from.palette[i].weight;
+    }
+    return total > 0.0f ? sum / total : 0.0f;
+}
+
+} // namespace
+
+LabColor ColorSignature::color(int slot) const {
+    const PaletteEntry& entry = palette[slot];
+    return {entry.l / 2.55f, static_cast<float>(entry.a), static_cast<float>(entry.b)};
+}
+
+ColorSignature ColorSignature::fromColor(const LabColor& color) {
+    ColorSignature signature;
+    signature.palette[0] = quantize(color, 255);
+    for (int i = 1; i < PALETTE_SIZE; ++i) {
+        signature.palette[i] = signature.palette[0];
+        signature.palette[i].weight = 0;
+    }
+    return signature;
+}
+
+ColorAnalyzer::ColorAnalyzer()
+    : m_lastErrorCode(ErrorCode::None) {
+}
+
+ColorAnalyzer::~ColorAnalyzer() = default;
+
+bool ColorAnalyzer::computeSignature(const ImageBuffer& image, ColorSignature& signature) {
+    clearError();
+    if (image.empty() || image.channels < 1 || image.channels > 4) {
+        return setError(ErrorCode::InvalidImage, "Image is empty or has an unsupported channel count");
+    }
+
+    // Shrink so the longer side is at most SAMPLE_SIDE; colors, not detail, matter here
+    const float scale = std::min(1.0f, static_cast<float>(SAMPLE_SIDE) / std::max(image.width, image.height));
+    const int width = std::max(1, static_cast<int>(std::lround(image.width * scale)));
+    const int height = std::max(1, static_cast<int>(std::lround(image.height * scale)));
+    if (!m_resampler.resample(image, ImageOrientation::Normal, m_sample, width, height, Resampler::Filter::Box)) {
+        return setError(ErrorCode::InvalidImage, m_resampler.getLastError());
+    }
+
+    m_pixels.clear();
+    m_pixels.reserve(static_cast<size_t>(width) * height);
+    LabColor mean;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* p = m_sample.row(y);
+        for (int x = 0; x < width; ++x, p += m_sample.channels) {
+            const LabColor lab = m_sample.channels >= 3 ? srgbToLab(p[0], p[1], p[2]) : srgbToLab(p[0], p[0], p[0]);
+            m_pixels.push_back(lab);
+            mean.l += lab.l;
+            mean.a += lab.a;
+            mean.b += lab.b;
+        }
+    }
+    const float count = static_cast<float>(m_pixels.size());
+    mean = {mean.l / count, mean.a / count, mean.b / count};
+
+    // Maximin seeding: start at the mean, then repeatedly take the pixel farthest from
+    // every centre so far. Stops early on near-flat images.
+    LabColor centres[ColorSignature::PALETTE_SIZE];
+    int centreCount = 1;
+    centres[0] = mean;
+    std::vector<float> nearest(m_pixels.size(), std::numeric_limits<float>::infinity());
+    while (centreCount < ColorSignature::PALETTE_SIZE) {
+        size_t farthest = 0;
+        for (size_t i = 0; i < m_pixels.size(); ++i) {
+            nearest[i] = std::min(nearest[i], squaredDistance(m_pixels[i], centres[centreCount - 1]));
+            if (nearest[i] > nearest[farthest]) {
+                farthest = i;
+            }
+        }
+        if (nearest[farthest] < 1.0f) {
+            break;
+        }
+        centres[centreCount++] = m_pixels[farthest];
+    }
+
+    // Lloyd iterations
+    m_assignment.assign(m_pixels.size(), 0);
+    int sizes[ColorSignature::PALETTE_SIZE] = {};
+    for (int iteration = 0; iteration < KMEANS_ITERATIONS; ++iteration) {
+        LabColor sums[ColorSignature::PALETTE_SIZE];
+        std::fill(sizes, sizes + ColorSignature::PALETTE_SIZE, 0);
+        for (size_t i = 0; i < m_pixels.size(); ++i) {
+            int best = 0;
+            float bestDistance = squaredDistance(m_pixels[i], centres[0]);
+            for (int c = 1; c < centreCount; ++c) {
+                const float d = squaredDistance(m_pixels[i], centres[c]);
+                if (d < bestDistance) {
+                    bestDistance = d;
+                    best = c;
+                }
+            }
+            m_assignment[i] = static_cast<uint8_t>(best);
+            sums[best].l += m_pixels[i].l;
+            sums[best].a += m_pixels[i].a;
+            sums[best].b += m_pixels[i].b;
+            ++sizes[best];
+        }
+        for (int c = 0; c < centreCount; ++c) {
+            if (sizes[c] > 0) {
+                centres[c] = {sums[c].l / sizes[c], sums[c].a / sizes[c], sums[c].b / sizes[c]};
+            }
+        }
+    }
+
+    int order[ColorSignature::PALETTE_SIZE] = {0, 1, 2, 3};
+    std::stable_sort(order, order + centreCount, [&sizes](int x, int y) { return sizes[x] > sizes[y]; });
+
+    for (int slot = 0; slot < ColorSignature::PALETTE_SIZE; ++slot) {
+        if (slot < centreCount && sizes[order[slot]] > 0) {
+            const int weight = static_cast<int>(std::lround(255.0f * sizes[order[slot]] / count));
+            signature.palette[slot] = quantize(centres[order[slot]], static_cast<uint8_t>(std::max(weight, 1)));
+        } else {
+            // Unused slots repeat the dominant color with no weight, so nearest-color
+            // matching never lands on garbage
+            signature.palette[slot] = signature.palette[0];
+            signature.palette[slot].weight = 0;
+        }
+    }
+    return true;
+}
+
+LabColor ColorAnalyzer::srgbToLab(uint8_t r, uint8_t g, uint8_t b) {
+    const std::array<float, 256>& linear = linearTable();
+    const float lr = linear[r];
+    const float lg = linear[g];
+    const float lb = linear[b];
+
+    const float x = (0.4124564f * lr + 0.3575761f * lg + 0.1804375f * lb) / WHITE_X;
+    const float y = (0.2126729f * lr + 0.7151522f * lg + 0.0721750f * lb) / WHITE_Y;
+    const float z = (0.0193339f * lr + 0.1191920f * lg + 0.9503041f * lb) / WHITE_Z;
+
+    const float fx = labF(x);
+    const float fy = labF(y);
+    const float fz = labF(z);
+    return {116.0f * fy - 16.0f, 500.0f * (fx - fy), 200.0f * (fy - fz)};
+}
+
+bool ColorAnalyzer::parseHexColor(const std::string& text, LabColor& color) {
+    const size_t start = !text.empty() && text[0] == '#' ? 1 : 0;
+    const size_t length = text.size() - start;
+    if (length != 6 && length != 3) {
+        return false;
+    }
+
+    int channels[3];
+    for (int c = 0; c < 3; ++c) {
+        if (length == 6) {
+            const int high = hexDigit(text[start + 2 * c]);
+            const int low = hexDigit(text[start + 2 * c + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            channels[c] = high * 16 + low;
+        } else {
+            const int digit = hexDigit(text[start + c]);
+            if (digit < 0) {
+                return false;
+            }
+            channels[c] = digit * 17;
+        }
+    }
+    color = srgbToLab(static_cast<uint8_t>(channels[0]), static_cast<uint8_t>(channels[1]),
+                      static_cast<uint8_t>(channels[2]));
+    return true;
+}
+
+float ColorAnalyzer::distance(const ColorSignature& a, const ColorSignature& b) {
+    return 0.5f * (directedDistance(a, b) + directedDistance(b, a));
+}
+
+std::string ColorAnalyzer::getLastError() const {
+    return m_lastError;
+}
+
+ColorAnalyzer::ErrorCode ColorAnalyzer::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void ColorAnalyzer::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool ColorAnalyzer::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
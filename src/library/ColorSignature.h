@@ -0,0 +1,89 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ColorSignature.h
+ * Description: Compact CIELAB palette signatures for color-similarity search
+ *
+ * Mathematical Foundation:
+ * - sRGB is linearized (IEC 61966-2-1), converted to XYZ under D65 and then to CIELAB:
+ *   L = 116 f(Y/Yn) - 16, a = 500 (f(X/Xn) - f(Y/Yn)), b = 200 (f(Y/Yn) - f(Z/Zn)),
+ *   f(t) = t^(1/3) above (6/29)^3, linear below; Euclidean distance in Lab is delta E 1976
+ * - The thumbnail is box-filtered to at most SAMPLE_SIDE x SAMPLE_SIDE and clustered
+ *   with k-means (PALETTE_SIZE centres, maximin seeding from the mean, fixed iterations),
+ *   giving the dominant colors and the share of pixels each covers
+ * - Signatures are compared with a weighted chamfer distance: every color of either
+ *   palette is matched to its nearest color in the other, and the matches are averaged
+ *   by weight over both directions. A single theme color is a one-entry palette, so
+ *   "matches #1e1e2e" rewards images dominated by colors near it
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../imaging/ImageBuffer.h"
+#include "../imaging/Resampler.h"
+
+struct LabColor {
+    float l = 0.0f;     // 0-100
+    float a = 0.0f;
+    float b = 0.0f;
+};
+
+// One palette entry, quantized to 4 bytes: L in half units, a and b in whole units
+struct PaletteEntry {
+    uint8_t l = 0;      // round(L * 2.55)
+    int8_t a = 0;
+    int8_t b = 0;
+    uint8_t weight = 0; // Share of pixels out of 255; 0 marks an unused slot
+};
+
+struct ColorSignature {
+    static constexpr int PALETTE_SIZE = 4;
+    PaletteEntry palette[PALETTE_SIZE];    // Heaviest first
+
+    LabColor color(int slot) const;
+
+    // One-color signature, e.g. for a theme color
+    static ColorSignature fromColor(const LabColor& color);
+};
+
+class ColorAnalyzer {
+public:
+    static constexpr int SAMPLE_SIDE = 48;
+    static constexpr int KMEANS_ITERATIONS = 8;
+
+    ColorAnalyzer();
+    ~ColorAnalyzer();
+
+    bool computeSignature(const ImageBuffer& image, ColorSignature& signature);
+
+    static LabColor srgbToLab(uint8_t r, uint8_t g, uint8_t b);
+    // "#rrggbb", "rrggbb" or "#rgb"
+    static bool parseHexColor(const std::string& text, LabColor& color);
+
+    // Weighted chamfer distance in delta E units (scalar reference for ColorIndex)
+    static float distance(const ColorSignature& a, const ColorSignature& b);
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        InvalidImage = 1
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool setError(ErrorCode code, const std::string& message);
+
+    Resampler m_resampler;
+    ImageBuffer m_sample;
+    std::vector<LabColor> m_pixels;
+    std::vector<uint8_t> m_assignment;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
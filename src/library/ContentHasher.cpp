@@ -0,0 +1,160 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ContentHasher.cpp
+ * Description: Implementation of two-stage file content hashing
+ */
+
+#include "ContentHasher.h"
+#include "../utils/FileDescriptor.h"
+#include "../utils/Xxh64.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ContentHasher::ContentHasher()
+    : m_bytesRead(0)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+ContentHasher::~ContentHasher() = default;
+
+void ContentHasher::setThrottle(ThrottleCallback throttle) {
+    m_throttle = std::move(throttle);
+}
+
+bool ContentHasher::hashSample(const std::string& path, ContentHash& hash) {
+    clearError();
+
+    FileDescriptor file(path);
+    if (file.get() < 0) {
+        return setError(errno == ENOENT ? ErrorCode::FileNotFound : ErrorCode::ReadFailed,
+                        "Cannot open " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat info;
+    if (::fstat(file.get(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return setError(ErrorCode::ReadFailed, "Not a regular file: " + path);
+    }
+
+    const uint64_t size = static_cast<uint64_t>(info.st_size);
+    hash = ContentHash{};
+    hash.size = size;
+
+    Xxh64 sample(size);
+
+    if (size <= 3 * SAMPLE_CHUNK_BYTES) {
+        // Small file: the chunks would overlap, so the sample is the whole file
+        m_buffer.resize(static_cast<size_t>(size));
+        if (!readAt(file.get(), 0, m_buffer.size(), m_buffer.data())) {
+            return false;
+        }
+        sample.update(m_buffer.data(), m_buffer.size());
+        hash.full = Xxh64::hash(m_buffer.data(), m_buffer.size());
+        hash.hasFull = true;
+    } else {
+        const uint64_t offsets[3] = {
+            0,
+            size / 2 - SAMPLE_CHUNK_BYTES / 2,
+            size - SAMPLE_CHUNK_BYTES
+        };
+        m_buffer.resize(SAMPLE_CHUNK_BYTES);
+        for (uint64_t offset : offsets) {
+            if (!readAt(file.get(), offset, SAMPLE_CHUNK_BYTES, m_buffer.data())) {
+                return false;
+            }
+            sample.update(m_buffer.data(), SAMPLE_CHUNK_BYTES);
+        }
+    }
+
+    hash.sample = sample.digest();
+    return true;
+}
+
+bool ContentHasher::hashFull(const std::string& path, ContentHash& hash) {
+    clearError();
+    if (hash.hasFull) {
+        return true;
+    }
+
+    FileDescriptor file(path);
+    if (file.get() < 0) {
+        return setError(errno == ENOENT ? ErrorCode::FileNotFound : ErrorCode::ReadFailed,
+                        "Cannot open " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat info;
+    if (::fstat(file.get(), &info) != 0 || static_cast<uint64_t>(info.st_size) != hash.size) {
+        return setError(ErrorCode::FileChanged, "File changed since it was sampled: " + path);
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(file.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    Xxh64 full;
+    m_buffer.resize(STREAM_BLOCK_BYTES);
+    uint64_t offset = 0;
+    while (offset < hash.size) {
+        const size_t block = static_cast<size_t>(std::min<uint64_t>(STREAM_BLOCK_BYTES, hash.size - offset));
+        if (!readAt(file.get(), offset, block, m_buffer.data())) {
+            return false;
+        }
+        full.update(m_buffer.data(), block);
+        offset += block;
+    }
+
+    hash.full = full.digest();
+    hash.hasFull = true;
+    return true;
+}
+
+uint64_t ContentHasher::getBytesRead() const {
+    return m_bytesRead;
+}
+
+std::string ContentHasher::getLastError() const {
+    return m_lastError;
+}
+
+ContentHasher::ErrorCode ContentHasher::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void ContentHasher::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool ContentHasher::readAt(int fd, uint64_t offset, size_t size, uint8_t* out) {
+    if (m_throttle && size > 0) {
+        m_throttle(size);
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = ::pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return setError(ErrorCode::ReadFailed, std::string("Read failed: ") + std::strerror(errno));
+        }
+        if (n == 0) {
+            return setError(ErrorCode::FileChanged, "File shrank while hashing");
+        }
+        done += static_cast<size_t>(n);
+    }
+
+    m_bytesRead += size;
+    return true;
+}
+
+bool ContentHasher::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
@@ -0,0 +1,73 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ContentHasher.h
+ * Description: Two-stage file content hashing for exact-duplicate detection
+ *
+ * Strategy:
+ * - Sample hash: XXH64 over the head, middle and tail chunks, seeded with the file
+ *   size; reads at most 3 chunks however large the file is
+ * - Files of at most 3 chunks are read whole, so their sample already covers every byte
+ *   and the full hash comes for free
+ * - Full hash: streaming XXH64 over the whole file, only computed when two files
+ *   share size and sample hash
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ContentHash {
+    uint64_t size = 0;
+    uint64_t sample = 0;    // Size-seeded hash of head, middle and tail chunks
+    uint64_t full = 0;      // Whole-file hash, valid when hasFull
+    bool hasFull = false;
+};
+
+class ContentHasher {
+public:
+    static constexpr size_t SAMPLE_CHUNK_BYTES = 16 * 1024;
+    static constexpr size_t STREAM_BLOCK_BYTES = 256 * 1024;
+
+    // Called with the byte count before every read, e.g. TaskScheduler::throttle
+    using ThrottleCallback = std::function<void(uint64_t bytes)>;
+
+    ContentHasher();
+    ~ContentHasher();
+
+    void setThrottle(ThrottleCallback throttle);
+
+    // Fill size and sample (and full, for small files)
+    bool hashSample(const std::string& path, ContentHash& hash);
+
+    // Fill full; fails with FileChanged if the size no longer matches hash.size
+    bool hashFull(const std::string& path, ContentHash& hash);
+
+    uint64_t getBytesRead() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        FileNotFound = 1,
+        ReadFailed = 2,
+        FileChanged = 3
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    bool readAt(int fd, uint64_t offset, size_t size, uint8_t* out);
+    bool setError(ErrorCode code, const std::string& message);
+
+    ThrottleCallback m_throttle;
+    std::vector<uint8_t> m_buffer;      // Reused between files
+    uint64_t m_bytesRead;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
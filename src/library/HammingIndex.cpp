@@ -0,0 +1,329 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: HammingIndex.cpp
+ * Description: Implementation of multi-index hashing with vectorized popcount scans
+ */
+
+#include "HammingIndex.h"
+#include <algorithm>
+#include <numeric>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CAITHE_HAMMING_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CAITHE_HAMMING_SSE2 1
+#endif
+
+namespace {
+
+constexpr uint32_t BUCKET_COUNT = 1u << HammingIndex::SUBSTRING_BITS;
+
+inline uint32_t substring(uint64_t hash, int table) {
+    return static_cast<uint32_t>(hash >> (table * HammingIndex::SUBSTRING_BITS)) & (BUCKET_COUNT - 1);
+}
+
+inline int popcount64(uint64_t value) {
+    return __builtin_popcountll(value);
+}
+
+bool matchOrder(const HammingMatch& a, const HammingMatch& b) {
+    return a.distance != b.distance ? a.distance < b.distance : a.id < b.id;
+}
+
+// XOR masks of every 16-bit key exactly `distance` bits away, for distance 0..2 (the
+// range that MAX_INDEXED_RADIUS allows)
+const std::vector<uint32_t>& neighbourMasks(int distance) {
+    static const std::vector<uint32_t> masks[3] = {
+        {0u},
+        [] {
+            std::vector<uint32_t> m;
+            for (int i = 0; i < HammingIndex::SUBSTRING_BITS; ++i) {
+                m.push_back(1u << i);
+            }
+            return m;
+        }(),
+        [] {
+            std::vector<uint32_t> m;
+            for (int i = 0; i < HammingIndex::SUBSTRING_BITS; ++i) {
+                for (int j = i + 1; j < HammingIndex::SUBSTRING_BITS; ++j) {
+                    m.push_back((1u << i) | (1u << j));
+                }
+            }
+            return m;
+        }()
+    };
+    return masks[distance];
+}
+
+// Substring distances table t must probe for radius r = 4s + q: every table probes
+// distances below s, but distance exactly s only in tables 0..q. If no substring is
+// within s - 1 then all are >= s and at most q exceed s, so at least 4 - q equal s and
+// one of them lies in the first q + 1 tables.
+int probeDepth(int radius, int table) {
+    const int s = radius / HammingIndex::SUBSTRING_COUNT;
+    const int q = radius % HammingIndex::SUBSTRING_COUNT;
+    return table <= q ? s : s - 1;
+}
+
+// Union-find with path halving
+uint32_t findRoot(std::vector<uint32_t>& parent, uint32_t x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+} // namespace
+
+HammingIndex::HammingIndex() = default;
+
+HammingIndex::~HammingIndex() = default;
+
+void HammingIndex::build(std::vector<uint64_t> hashes) {
+    m_hashes = std::move(hashes);
+
+    // Counting sort of ids by substring value, one table per substring
+    for (int t = 0; t < SUBSTRING_COUNT; ++t) {
+        std::vector<uint32_t>& offsets = m_offsets[t];
+        std::vector<uint32_t>& entries = m_entries[t];
+        offsets.assign(BUCKET_COUNT + 1, 0);
+        for (uint64_t hash : m_hashes) {
+            ++offsets[substring(hash, t) + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        entries.resize(m_hashes.size());
+        m_entryHashes[t].resize(m_hashes.size());
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (uint32_t id = 0; id < m_hashes.size(); ++id) {
+            const uint32_t slot = cursor[substring(m_hashes[id], t)]++;
+            entries[slot] = id;
+            m_entryHashes[t][slot] = m_hashes[id];
+        }
+    }
+}
+
+void HammingIndex::clear() {
+    m_hashes.clear();
+    for (int t = 0; t < SUBSTRING_COUNT; ++t) {
+        m_offsets[t].clear();
+        m_entries[t].clear();
+        m_entryHashes[t].clear();
+    }
+}
+
+size_t HammingIndex::size() const {
+    return m_hashes.size();
+}
+
+uint64_t HammingIndex::getHash(uint32_t id) const {
+    return m_hashes[id];
+}
+
+void HammingIndex::radiusSearch(uint64_t query, int radius, std::vector<HammingMatch>& matches) const {
+    matches.clear();
+    if (radius < 0 || m_hashes.empty()) {
+        return;
+    }
+    if (radius > MAX_INDEXED_RADIUS) {
+        scanRadius(query, radius, matches);
+        return;
+    }
+
+    for (int t = 0; t < SUBSTRING_COUNT; ++t) {
+        const std::vector<uint32_t>& offsets = m_offsets[t];
+        const std::vector<uint32_t>& entries = m_entries[t];
+        const std::vector<uint64_t>& entryHashes = m_entryHashes[t];
+
+        const uint32_t key = substring(query, t);
+        for (int depth = 0; depth <= probeDepth(radius, t); ++depth) {
+            for (uint32_t mask : neighbourMasks(depth)) {
+                const uint32_t bucket = key ^ mask;
+                for (uint32_t e = offsets[bucket]; e < offsets[bucket + 1]; ++e) {
+                    const int distance = popcount64(entryHashes[e] ^ query);
+                    if (distance <= radius) {
+                        matches.push_back({entries[e], distance});
+                    }
+                }
+            }
+        }
+    }
+
+    // A match close in several substrings is found once per table
+    std::sort(matches.begin(), matches.end(), [](const HammingMatch& a, const HammingMatch& b) {
+        return a.id < b.id;
+    });
+    matches.erase(std::unique(matches.begin(), matches.end(), [](const HammingMatch& a, const HammingMatch& b) {
+        return a.id == b.id;
+    }), matches.end());
+    std::sort(matches.begin(), matches.end(), matchOrder);
+}
+
+void HammingIndex::nearest(uint64_t query, size_t k, std::vector<HammingMatch>& matches) const {
+    matches.clear();
+    k = std::min(k, m_hashes.size());
+    if (k == 0) {
+        return;
+    }
+
+    std::vector<uint8_t> distance(m_hashes.size());
+    distances(m_hashes.data(), m_hashes.size(), query, distance.data());
+
+    // Counting sort over the 65 possible distances: find the cut-off, then collect in id order
+    size_t histogram[65] = {};
+    for (uint8_t d : distance) {
+        ++histogram[d];
+    }
+    int cutoff = 0;
+    size_t below = 0;
+    while (below + histogram[cutoff] < k) {
+        below += histogram[cutoff++];
+    }
+
+    matches.reserve(below + histogram[cutoff]);
+    for (uint32_t id = 0; id < distance.size(); ++id) {
+        if (distance[id] <= cutoff) {
+            matches.push_back({id, distance[id]});
+        }
+    }
+    std::sort(matches.begin(), matches.end(), matchOrder);
+    matches.resize(k);
+}
+
+std::vector<std::vector<uint32_t>> HammingIndex::findGroups(int radius) const {
+    std::vector<uint32_t> parent(m_hashes.size());
+    std::iota(parent.begin(), parent.end(), 0u);
+    auto unite = [&parent](uint32_t a, uint32_t b) {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a != b) {
+            parent[std::max(a, b)] = std::min(a, b);
+        }
+    };
+
+    if (radius > MAX_INDEXED_RADIUS) {
+        std::vector<HammingMatch> matches;
+        for (uint32_t id = 0; id < m_hashes.size(); ++id) {
+            matches.clear();
+            scanRadius(m_hashes[id], radius, matches);
+            for (const HammingMatch& match : matches) {
+                unite(id, match.id);
+            }
+        }
+    } else if (radius >= 0) {
+        // Self-join per table: every close pair shares a substring within the probe depth,
+        // so comparing each bucket with its neighbour buckets (key' >= key, to visit each
+        // bucket pair once) finds every pair without per-item queries or deduplication
+        for (int t = 0; t < SUBSTRING_COUNT; ++t) {
+            const std::vector<uint32_t>& offsets = m_offsets[t];
+            const std::vector<uint32_t>& entries = m_entries[t];
+            const std::vector<uint64_t>& entryHashes = m_entryHashes[t];
+
+            for (int depth = 0; depth <= probeDepth(radius, t); ++depth) {
+                const std::vector<uint32_t>& masks = neighbourMasks(depth);
+                for (uint32_t key = 0; key < BUCKET_COUNT; ++key) {
+                    const uint32_t begin = offsets[key];
+                    const uint32_t end = offsets[key + 1];
+                    if (begin == end) {
+                        continue;
+                    }
+                    for (uint32_t mask : masks) {
+                        const uint32_t other = key ^ mask;
+                        if (other < key) {
+                            continue;
+                        }
+                        const uint32_t otherEnd = offsets[other + 1];
+                        for (uint32_t a = begin; a < end; ++a) {
+                            const uint64_t hash = entryHashes[a];
+                            for (uint32_t b = (other == key ? a + 1 : offsets[other]); b < otherEnd; ++b) {
+                                if (popcount64(entryHashes[b] ^ hash) <= radius) {
+                                    unite(entries[a], entries[b]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Roots are the smallest id of each group, so groups come out ordered by first member
+    std::vector<std::vector<uint32_t>> groups;
+    std::vector<uint32_t> groupOfRoot(m_hashes.size(), UINT32_MAX);
+    std::vector<uint32_t> memberCount(m_hashes.size(), 0);
+    for (uint32_t id = 0; id < m_hashes.size(); ++id) {
+        ++memberCount[findRoot(parent, id)];
+    }
+    for (uint32_t id = 0; id < m_hashes.size(); ++id) {
+        const uint32_t root = findRoot(parent, id);
+        if (memberCount[root] < 2) {
+            continue;
+        }
+        if (groupOfRoot[root] == UINT32_MAX) {
+            groupOfRoot[root] = static_cast<uint32_t>(groups.size());
+            groups.emplace_back();
+        }
+        groups[groupOfRoot[root]].push_back(id);
+    }
+    return groups;
+}
+
+void HammingIndex::distances(const uint64_t* hashes, size_t count, uint64_t query, uint8_t* out) {
+    size_t i = 0;
+
+#if defined(CAITHE_HAMMING_AVX2)
+    const __m256i q = _mm256_set1_epi64x(static_cast<long long>(query));
+    const __m256i lowMask = _mm256_set1_epi8(0x0F);
+    const __m256i nibbleCounts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 4 <= count; i += 4) {
+        const __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hashes + i)), q);
+        const __m256i low = _mm256_shuffle_epi8(nibbleCounts, _mm256_and_si256(x, lowMask));
+        const __m256i high = _mm256_shuffle_epi8(nibbleCounts, _mm256_and_si256(_mm256_srli_epi16(x, 4), lowMask));
+        const __m256i sums = _mm256_sad_epu8(_mm256_add_epi8(low, high), zero);     // One total per 64-bit lane
+        alignas(32) uint64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+        out[i] = static_cast<uint8_t>(lanes[0]);
+        out[i + 1] = static_cast<uint8_t>(lanes[1]);
+        out[i + 2] = static_cast<uint8_t>(lanes[2]);
+        out[i + 3] = static_cast<uint8_t>(lanes[3]);
+    }
+#elif defined(CAITHE_HAMMING_SSE2)
+    // Bit-slice popcount per byte (no byte shuffle in SSE2); the masks discard bits that
+    // the 16-bit shifts carry across byte boundaries
+    const __m128i q = _mm_set1_epi64x(static_cast<long long>(query));
+    const __m128i m1 = _mm_set1_epi8(0x55);
+    const __m128i m2 = _mm_set1_epi8(0x33);
+    const __m128i m4 = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 2 <= count; i += 2) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hashes + i)), q);
+        x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi16(x, 1), m1));
+        x = _mm_add_epi8(_mm_and_si128(x, m2), _mm_and_si128(_mm_srli_epi16(x, 2), m2));
+        x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi16(x, 4)), m4);
+        const __m128i sums = _mm_sad_epu8(x, zero);
+        out[i] = static_cast<uint8_t>(_mm_cvtsi128_si32(sums));
+        out[i + 1] = static_cast<uint8_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        out[i] = static_cast<uint8_t>(popcount64(hashes[i] ^ query));
+    }
+}
+
+void HammingIndex::scanRadius(uint64_t query, int radius, std::vector<HammingMatch>& matches) const {
+    std::vector<uint8_t> distance(m_hashes.size());
+    distances(m_hashes.data(), m_hashes.size(), query, distance.data());
+    for (uint32_t id = 0; id < distance.size(); ++id) {
+        if (distance[id] <= radius) {
+            matches.push_back({id, distance[id]});
+        }
+    }
+    std::sort(matches.begin(), matches.end(), matchOrder);
+}
@@ -0,0 +1,66 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: HammingIndex.h
+ * Description: Near-neighbour search over 64-bit hashes by Hamming distance
+ *
+ * Mathematical Foundation:
+ * - Multi-index hashing: each hash is split into 4 disjoint 16-bit substrings, each
+ *   with its own table. If dist(a, b) <= r then, by pigeonhole, at least one substring
+ *   differs in at most s = floor(r / 4) bits. Sharper: with r = 4s + q, a match whose
+ *   substrings all differ in s or more bits has at least 4 - q of them at exactly s, so
+ *   distance s is only probed in the first q + 1 tables (distance < s in all of them)
+ * - Candidates are verified with a full 64-bit popcount; radii beyond
+ *   MAX_INDEXED_RADIUS touch too many keys and scan linearly instead
+ * - Group reports self-join each table bucket against its neighbour buckets rather than
+ *   querying every hash, visiting each bucket pair once
+ * - Linear scans compute popcount(a ^ b) for 4 (AVX2) or 2 (SSE2) hashes per instruction
+ *   with nibble-table / bit-slice popcount and a sum of absolute differences
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct HammingMatch {
+    uint32_t id;        // Position of the hash passed to build()
+    int distance;
+};
+
+class HammingIndex {
+public:
+    static constexpr int SUBSTRING_COUNT = 4;
+    static constexpr int SUBSTRING_BITS = 16;
+    static constexpr int MAX_INDEXED_RADIUS = 11;
+
+    HammingIndex();
+    ~HammingIndex();
+
+    void build(std::vector<uint64_t> hashes);
+    void clear();
+
+    size_t size() const;
+    uint64_t getHash(uint32_t id) const;
+
+    // Every hash within `radius` bits, ordered by (distance, id)
+    void radiusSearch(uint64_t query, int radius, std::vector<HammingMatch>& matches) const;
+
+    // The k closest hashes, ordered by (distance, id)
+    void nearest(uint64_t query, size_t k, std::vector<HammingMatch>& matches) const;
+
+    // Connected groups (size >= 2) of hashes linked by distance <= radius
+    std::vector<std::vector<uint32_t>> findGroups(int radius) const;
+
+    // out[i] = popcount(hashes[i] ^ query), vectorized where the target allows
+    static void distances(const uint64_t* hashes, size_t count, uint64_t query, uint8_t* out);
+
+private:
+    void scanRadius(uint64_t query, int radius, std::vector<HammingMatch>& matches) const;
+
+    std::vector<uint64_t> m_hashes;
+    std::vector<uint32_t> m_offsets[SUBSTRING_COUNT];   // Bucket starts, 2^16 + 1 per table
+    std::vector<uint32_t> m_entries[SUBSTRING_COUNT];   // Ids grouped by substring value
+    std::vector<uint64_t> m_entryHashes[SUBSTRING_COUNT]; // Hashes in m_entries order, scanned without indirection
+};
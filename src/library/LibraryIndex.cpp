@@ -0,0 +1,939 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: LibraryIndex.cpp
+ * Description: Implementation of the content-keyed library index
+ */
+
+#include "LibraryIndex.h"
+#include "BatchProbe.h"
+#include "../imaging/ImageDecoder.h"
+#include "../utils/FileUtils.h"
+#include "../utils/MetadataCache.h"
+#include "../utils/Xxh64.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sys/stat.h>
+#include <unordered_set>
+
+namespace {
+
+constexpr char INDEX_MAGIC[8] = { 'C', 'A', 'I', 'T', 'H', 'E', 'I', 'X' };
+
+constexpr uint8_t CONTENT_HAS_FULL = 1 << 0;
+constexpr uint8_t CONTENT_PROBED = 1 << 1;
+constexpr uint8_t CONTENT_PROGRESSIVE = 1 << 2;
+constexpr uint8_t CONTENT_HAS_PERCEPTUAL = 1 << 3;
+constexpr uint8_t CONTENT_HAS_LUMINANCE = 1 << 4;
+constexpr uint8_t CONTENT_HAS_COLORS = 1 << 5;
+
+// Run task(state, i) for i in [0, count) on up to one scheduler task per worker thread.
+// Each scheduler task owns one State, so per-thread buffers are reused across items.
+// Must not be called from inside a scheduler task: it blocks until the items are done.
+// Waits for items rather than tasks, so once one task runs it finishes the batch even if
+// the power policy holds the rest; those start later, find nothing left and return.
+template <typename State, typename Task>
+void runParallel(TaskScheduler& scheduler, IoClass ioClass, size_t count, Task task) {
+    if (count == 0) {
+        return;
+    }
+
+    // Shared with the tasks, which may start after this returns
+    struct Shared {
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t finished = 0;
+    };
+    auto shared = std::make_shared<Shared>();
+
+    const size_t workers = std::min(count, scheduler.getThreadCount());
+    for (size_t w = 0; w < workers; ++w) {
+        scheduler.submit(ioClass, [shared, &task, count] {
+            if (shared->next >= count) {
+                return;     // Started late; `task` may be gone already
+            }
+            State state;
+            size_t completed = 0;
+            for (size_t i = shared->next++; i < count; i = shared->next++) {
+                task(state, i);
+                ++completed;
+            }
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->finished += completed;
+            if (shared->finished == count) {
+                shared->done.notify_all();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&shared, count] { return shared->finished == count; });
+}
+
+bool sameContent(const ContentHash& a, const ContentHash& b) {
+    return a.size == b.size && a.sample == b.sample && a.hasFull && b.hasFull && a.full == b.full;
+}
+
+// Little-endian serialization helpers
+class ByteWriter {
+public:
+    template <typename T>
+    void put(T value) {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            m_data.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+        }
+    }
+    void putBytes(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        m_data.insert(m_data.end(), p, p + size);
+    }
+    std::vector<uint8_t>& data() { return m_data; }
+
+private:
+    std::vector<uint8_t> m_data;
+};
+
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : m_data(data), m_size(size), m_offset(0) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (m_size - m_offset < sizeof(T)) {
+            return false;
+        }
+        uint64_t raw = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            raw |= static_cast<uint64_t>(m_data[m_offset + i]) << (8 * i);
+        }
+        value = static_cast<T>(raw);
+        m_offset += sizeof(T);
+        return true;
+    }
+    bool getBytes(void* out, size_t size) {
+        if (m_size - m_offset < size) {
+            return false;
+        }
+        std::memcpy(out, m_data + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+    bool atEnd() const { return m_offset == m_size; }
+    const uint8_t* position() const { return m_data + m_offset; }
+    size_t remaining() const { return m_size - m_offset; }
+    void skip(size_t size) { m_offset += std::min(size, remaining()); }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset;
+};
+
+int64_t modificationTimeNs(const struct stat& info) {
+    return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+}
+
+// Mean BT.601 luma (integer weights summing to 256); gray and gray-alpha use the first channel
+uint8_t meanLuminance(const ImageBuffer& image) {
+    uint64_t total = 0;
+    for (int y = 0; y < image.height; ++y) {
+        const uint8_t* p = image.row(y);
+        for (int x = 0; x < image.width; ++x, p += image.channels) {
+            total += image.channels >= 3 ? (77u * p[0] + 150u * p[1] + 29u * p[2]) >> 8 : p[0];
+        }
+    }
+    const uint64_t pixels = static_cast<uint64_t>(image.width) * static_cast<uint64_t>(image.height);
+    return static_cast<uint8_t>((total + pixels / 2) / pixels);
+}
+
+} // namespace
+
+LibraryIndex::LibraryIndex()
+    : m_perceptualHashing(true)
+    , m_similarityValid(false)
+    , m_colorValid(false)
+    , m_columnsValid(false)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+LibraryIndex::~LibraryIndex() = default;
+
+bool LibraryIndex::indexFiles(const std::vector<std::string>& paths, TaskScheduler& scheduler, IoClass ioClass) {
+    clearError();
+    m_lastStats = IndexStats{};
+
+    // The pass waits for its tasks, and a held class would not start them
+    if (scheduler.isDeferred(ioClass)) {
+        return setError(ErrorCode::Deferred, "Indexing deferred by the power policy");
+    }
+
+    std::vector<std::string> unique;
+    {
+        std::unordered_set<std::string> seen;
+        unique.reserve(paths.size());
+        for (const std::string& path : paths) {
+            if (seen.insert(path).second) {
+                unique.push_back(path);
+            }
+        }
+    }
+    m_lastStats.filesSeen = unique.size();
+
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<size_t> failed{0};
+    std::string firstFailure;
+    std::mutex failureMutex;
+    auto recordFailure = [&](const std::string& message) {
+        if (failed++ == 0) {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            firstFailure = message;
+        }
+    };
+    auto throttle = [&scheduler, ioClass](uint64_t bytes) { scheduler.throttle(ioClass, bytes); };
+
+    // Stage 1: stat every file, sample-hash the new or changed ones. Workers only read
+    // the existing tables, so no locking is needed until the merge below.
+    struct Scan {
+        bool ok = false;
+        bool reused = false;
+        uint64_t size = 0;
+        int64_t mtimeNs = 0;
+        ContentHash hash;
+    };
+    std::vector<Scan> scans(unique.size());
+
+    runParallel<ContentHasher>(scheduler, ioClass, unique.size(), [&](ContentHasher& hasher, size_t i) {
+        Scan& scan = scans[i];
+        struct stat info;
+        if (::stat(unique[i].c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            recordFailure("Cannot stat " + unique[i]);
+            return;
+        }
+        scan.size = static_cast<uint64_t>(info.st_size);
+        scan.mtimeNs = modificationTimeNs(info);
+
+        const auto existing = m_fileByPath.find(unique[i]);
+        if (existing != m_fileByPath.end()) {
+            const LibraryFile& file = m_files[existing->second];
+            if (file.size == scan.size && file.mtimeNs == scan.mtimeNs) {
+                scan.hash = file.hash;
+                scan.reused = true;
+                scan.ok = true;
+                return;
+            }
+        }
+
+        hasher.setThrottle(throttle);
+        const uint64_t before = hasher.getBytesRead();
+        scan.ok = hasher.hashSample(unique[i], scan.hash);
+        bytesRead += hasher.getBytesRead() - before;
+        if (!scan.ok) {
+            recordFailure(hasher.getLastError());
+        }
+    });
+
+    std::vector<bool> erase(m_files.size(), false);
+    for (size_t i = 0; i < unique.size(); ++i) {
+        const Scan& scan = scans[i];
+        const auto existing = m_fileByPath.find(unique[i]);
+
+        if (!scan.ok) {
+            if (existing != m_fileByPath.end()) {
+                erase[existing->second] = true;     // Gone or unreadable: drop the stale entry
+            }
+            continue;
+        }
+
+        if (scan.reused) {
+            ++m_lastStats.reused;
+            continue;
+        }
+        ++m_lastStats.sampleHashed;
+
+        LibraryFile* file;
+        if (existing != m_fileByPath.end()) {
+            file = &m_files[existing->second];
+        } else {
+            m_fileByPath.emplace(unique[i], static_cast<uint32_t>(m_files.size()));
+            m_files.emplace_back();
+            erase.push_back(false);
+            file = &m_files.back();
+            file->path = unique[i];
+        }
+        file->size = scan.size;
+        file->mtimeNs = scan.mtimeNs;
+        file->hash = scan.hash;
+        file->content = NO_CONTENT;     // Content changed: old probe metadata no longer applies
+    }
+    eraseFiles(erase);
+
+    // Stage 2: full hashes, only inside (size, sample) buckets holding more than one file
+    std::vector<uint32_t> order(m_files.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        const ContentHash& ha = m_files[a].hash;
+        const ContentHash& hb = m_files[b].hash;
+        return ha.size != hb.size ? ha.size < hb.size : ha.sample < hb.sample;
+    });
+
+    std::vector<uint32_t> needFull;
+    for (size_t begin = 0; begin < order.size();) {
+        size_t end = begin + 1;
+        const ContentHash& first = m_files[order[begin]].hash;
+        while (end < order.size() && m_files[order[end]].hash.size == first.size &&
+               m_files[order[end]].hash.sample == first.sample) {
+            ++end;
+        }
+        if (end - begin > 1) {
+            for (size_t k = begin; k < end; ++k) {
+                if (!m_files[order[k]].hash.hasFull) {
+                    needFull.push_back(order[k]);
+                }
+            }
+        }
+        begin = end;
+    }
+
+    std::vector<uint8_t> fullFailed(needFull.size(), 0);
+    runParallel<ContentHasher>(scheduler, ioClass, needFull.size(), [&](ContentHasher& hasher, size_t i) {
+        LibraryFile& file = m_files[needFull[i]];
+        hasher.setThrottle(throttle);
+        const uint64_t before = hasher.getBytesRead();
+        if (!hasher.hashFull(file.path, file.hash)) {
+            fullFailed[i] = 1;
+            recordFailure(hasher.getLastError());
+        }
+        bytesRead += hasher.getBytesRead() - before;
+    });
+
+    erase.assign(m_files.size(), false);
+    for (size_t i = 0; i < needFull.size(); ++i) {
+        if (fullFailed[i]) {
+            erase[needFull[i]] = true;
+        } else {
+            ++m_lastStats.fullHashed;
+        }
+    }
+    eraseFiles(erase);
+
+    rebuildContents();
+
+    // Stage 3: probe one representative per content that has no metadata yet, then hash
+    // its decoded thumbnail perceptually and measure its luminance and palette (JPEGs
+    // use the 1/8-scale DC preview)
+    std::vector<uint32_t> needProbe;
+    for (uint32_t c = 0; c < m_contents.size(); ++c) {
+        if (!m_contents[c].probed) {
+            needProbe.push_back(c);
+        }
+    }
+
+    // Headers first, all at once: the batch keeps hundreds of opens and reads in flight
+    // (io_uring where available) and parses each prefix as it lands
+    std::vector<std::string> probePaths;
+    probePaths.reserve(needProbe.size());
+    for (const uint32_t c : needProbe) {
+        probePaths.push_back(m_files[m_contents[c].files.front()].path);
+    }
+    std::vector<uint32_t> needDecode;
+    BatchProbe batch;
+    batch.probe(probePaths, scheduler, ioClass, [&](const ProbeResult& result) {
+        // Non-images and corrupt headers are recorded as Unknown rather than retried
+        LibraryContent& content = m_contents[needProbe[result.index]];
+        content.probed = true;
+        if (!result.ok) {
+            return;
+        }
+        content.header = result.header;
+        if (m_perceptualHashing) {
+            needDecode.push_back(needProbe[result.index]);
+        }
+    });
+    bytesRead += batch.getStats().bytesRead;
+
+    struct DecodeWorker {
+        ImageDecoder decoder;
+        PerceptualHash perceptual;
+        ColorAnalyzer colors;
+        ImageBuffer thumbnail;
+    };
+    std::atomic<size_t> perceptualHashed{0};
+
+    runParallel<DecodeWorker>(scheduler, ioClass, needDecode.size(), [&](DecodeWorker& worker, size_t i) {
+        LibraryContent& content = m_contents[needDecode[i]];
+        const LibraryFile& file = m_files[content.files.front()];
+        const ImageHeader& header = content.header;
+        const uint64_t decodeCharge = header.format == ImageFormat::Jpeg
+            ? std::min<uint64_t>(file.size, ImageDecoder::PREVIEW_READ_BYTES) : file.size;
+        throttle(decodeCharge);
+        bytesRead += decodeCharge;
+
+        if (!worker.decoder.decodePreviewFile(file.path, worker.thumbnail, 3) || worker.thumbnail.empty()) {
+            return;
+        }
+        content.luminance = meanLuminance(worker.thumbnail);
+        content.hasLuminance = true;
+        content.hasColors = worker.colors.computeSignature(worker.thumbnail, content.colors);
+        if (worker.perceptual.computePHash(worker.thumbnail, header.orientation, content.perceptualHash)) {
+            content.hasPerceptualHash = true;
+            ++perceptualHashed;
+        }
+    });
+    m_columnsValid = false;
+    m_lastStats.probed = needProbe.size();
+    m_lastStats.perceptualHashed = perceptualHashed;
+
+    m_lastStats.failed = failed;
+    m_lastStats.bytesRead = bytesRead;
+    m_lastStats.duplicateFiles = m_files.size() - m_contents.size();
+
+    if (m_lastStats.failed > 0) {
+        std::string message = firstFailure;
+        if (m_lastStats.failed > 1) {
+            message += " (and " + std::to_string(m_lastStats.failed - 1) + " more)";
+        }
+        return setError(ErrorCode::FileFailed, message);
+    }
+    return true;
+}
+
+bool LibraryIndex::indexDirectory(const std::string& directory, TaskScheduler& scheduler, IoClass ioClass) {
+    if (!MetadataCache::instance().isDirectory(directory)) {
+        return setError(ErrorCode::DirectoryNotFound, "Directory not found: " + directory);
+    }
+    bool complete = true;
+    const std::vector<std::string> files = FileUtils::getImageFilesInDirectory(directory, complete);
+    if (!indexFiles(files, scheduler, ioClass)) {
+        return false;
+    }
+    if (!complete) {
+        return setError(ErrorCode::ListingTimedOut, "Listing of " + directory + " timed out after " +
+                        std::to_string(files.size()) + " files");
+    }
+    return true;
+}
+
+bool LibraryIndex::removeFile(const std::string& path) {
+    const auto it = m_fileByPath.find(path);
+    if (it == m_fileByPath.end()) {
+        return false;
+    }
+
+    // Removal only ever splits groups, so no hashing is needed to regroup
+    std::vector<bool> erase(m_files.size(), false);
+    erase[it->second] = true;
+    eraseFiles(erase);
+    rebuildContents();
+    return true;
+}
+
+void LibraryIndex::clear() {
+    m_files.clear();
+    m_fileByPath.clear();
+    m_contents.clear();
+    m_tags.clear();
+    m_similarityValid = false;
+    m_colorValid = false;
+    m_columnsValid = false;
+    m_lastStats = IndexStats{};
+}
+
+bool LibraryIndex::save(const std::string& path) {
+    ByteWriter writer;
+    writer.putBytes(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    writer.put<uint32_t>(FORMAT_VERSION);
+    writer.put<uint32_t>(static_cast<uint32_t>(m_contents.size()));
+    writer.put<uint32_t>(static_cast<uint32_t>(m_files.size()));
+
+    for (const LibraryContent& content : m_contents) {
+        uint8_t flags = 0;
+        flags |= content.hash.hasFull ? CONTENT_HAS_FULL : 0;
+        flags |= content.probed ? CONTENT_PROBED : 0;
+        flags |= content.header.progressive ? CONTENT_PROGRESSIVE : 0;
+        flags |= content.hasPerceptualHash ? CONTENT_HAS_PERCEPTUAL : 0;
+        flags |= content.hasLuminance ? CONTENT_HAS_LUMINANCE : 0;
+        flags |= content.hasColors ? CONTENT_HAS_COLORS : 0;
+
+        writer.put<uint64_t>(content.hash.size);
+        writer.put<uint64_t>(content.hash.sample);
+        writer.put<uint64_t>(content.hash.full);
+        writer.put<uint8_t>(flags);
+        writer.put<uint8_t>(static_cast<uint8_t>(content.header.format));
+        writer.put<uint8_t>(static_cast<uint8_t>(content.header.orientation));
+        writer.put<uint32_t>(static_cast<uint32_t>(content.header.width));
+        writer.put<uint32_t>(static_cast<uint32_t>(content.header.height));
+        writer.put<uint64_t>(content.perceptualHash);
+        writer.put<uint8_t>(content.luminance);
+        for (const PaletteEntry& entry : content.colors.palette) {
+            writer.put<uint8_t>(entry.l);
+            writer.put<uint8_t>(static_cast<uint8_t>(entry.a));
+            writer.put<uint8_t>(static_cast<uint8_t>(entry.b));
+            writer.put<uint8_t>(entry.weight);
+        }
+    }
+
+    // File hashes are not stored: a file always carries its content's hash
+    for (const LibraryFile& file : m_files) {
+        writer.put<uint64_t>(file.size);
+        writer.put<uint64_t>(static_cast<uint64_t>(file.mtimeNs));
+        writer.put<uint32_t>(file.content);
+        writer.put<uint32_t>(static_cast<uint32_t>(file.path.size()));
+        writer.putBytes(file.path.data(), file.path.size());
+    }
+    m_tags.serialize(writer.data());
+
+    std::vector<uint8_t>& data = writer.data();
+    const uint64_t checksum = Xxh64::hash(data.data(), data.size());
+    writer.put<uint64_t>(checksum);
+
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return setError(ErrorCode::WriteFailed, "Cannot write " + temporary);
+        }
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            return setError(ErrorCode::WriteFailed, "Write failed: " + temporary);
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return setError(ErrorCode::WriteFailed, "Cannot replace " + path);
+    }
+    return true;
+}
+
+bool LibraryIndex::load(const std::string& path) {
+    clearError();
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return setError(ErrorCode::ReadFailed, "Cannot open " + path);
+    }
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(INDEX_MAGIC) + 12 + 8 ||
+        std::memcmp(data.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        return setError(ErrorCode::CorruptIndex, "Not a library index: " + path);
+    }
+
+    ByteReader trailer(data.data() + data.size() - 8, 8);
+    uint64_t checksum = 0;
+    trailer.get(checksum);
+    if (checksum != Xxh64::hash(data.data(), data.size() - 8)) {
+        return setError(ErrorCode::CorruptIndex, "Checksum mismatch: " + path);
+    }
+
+    ByteReader reader(data.data() + sizeof(INDEX_MAGIC), data.size() - sizeof(INDEX_MAGIC) - 8);
+    uint32_t version = 0, contentCount = 0, fileCount = 0;
+    reader.get(version);
+    if (version < 1 || version > FORMAT_VERSION) {
+        return setError(ErrorCode::VersionMismatch, "Unsupported index version " + std::to_string(version));
+    }
+    reader.get(contentCount);
+    reader.get(fileCount);
+
+    std::vector<LibraryContent> contents;
+    contents.reserve(std::min<size_t>(contentCount, data.size() / 32));
+    for (uint32_t c = 0; c < contentCount; ++c) {
+        LibraryContent content;
+        uint8_t flags = 0, format = 0, orientation = 0;
+        uint32_t width = 0, height = 0;
+        if (!reader.get(content.hash.size) || !reader.get(content.hash.sample) || !reader.get(content.hash.full) ||
+            !reader.get(flags) || !reader.get(format) || !reader.get(orientation) ||
+            !reader.get(width) || !reader.get(height) ||
+            (version >= 2 && !reader.get(content.perceptualHash)) ||
+            (version >= 3 && !reader.get(content.luminance))) {
+            return setError(ErrorCode::CorruptIndex, "Truncated content table: " + path);
+        }
+        if (version >= 5) {
+            for (PaletteEntry& entry : content.colors.palette) {
+                uint8_t a = 0, b = 0;
+                if (!reader.get(entry.l) || !reader.get(a) || !reader.get(b) || !reader.get(entry.weight)) {
+                    return setError(ErrorCode::CorruptIndex, "Truncated content table: " + path);
+                }
+                entry.a = static_cast<int8_t>(a);
+                entry.b = static_cast<int8_t>(b);
+            }
+        }
+        content.hash.hasFull = (flags & CONTENT_HAS_FULL) != 0;
+        content.hasPerceptualHash = (flags & CONTENT_HAS_PERCEPTUAL) != 0;
+        content.hasLuminance = (flags & CONTENT_HAS_LUMINANCE) != 0;
+        content.hasColors = (flags & CONTENT_HAS_COLORS) != 0;
+        // Versions before 5 lack perceptual hashes, luminance or color signatures: probe
+        // again on the next pass to fill them in
+        content.probed = version >= 5 && (flags & CONTENT_PROBED) != 0;
+        content.header.progressive = (flags & CONTENT_PROGRESSIVE) != 0;
+        content.header.format = format <= static_cast<uint8_t>(ImageFormat::WebP)
+            ? static_cast<ImageFormat>(format) : ImageFormat::Unknown;
+        content.header.orientation = orientationFromExif(orientation);
+        content.header.width = static_cast<int>(width);
+        content.header.height = static_cast<int>(height);
+        contents.push_back(std::move(content));
+    }
+
+    std::vector<LibraryFile> files;
+    files.reserve(std::min<size_t>(fileCount, data.size() / 24));
+    for (uint32_t f = 0; f < fileCount; ++f) {
+        LibraryFile file;
+        uint64_t mtime = 0;
+        uint32_t pathLength = 0;
+        if (!reader.get(file.size) || !reader.get(mtime) || !reader.get(file.content) || !reader.get(pathLength)) {
+            return setError(ErrorCode::CorruptIndex, "Truncated file table: " + path);
+        }
+        file.path.resize(pathLength);
+        if (!reader.getBytes(&file.path[0], pathLength) || file.content >= contents.size()) {
+            return setError(ErrorCode::CorruptIndex, "Corrupt file entry: " + path);
+        }
+        file.mtimeNs = static_cast<int64_t>(mtime);
+        file.hash = contents[file.content].hash;
+        files.push_back(std::move(file));
+    }
+
+    TagIndex tags;
+    if (version >= 4) {
+        size_t consumed = 0;
+        if (!tags.deserialize(reader.position(), reader.remaining(), fileCount, consumed)) {
+            return setError(ErrorCode::CorruptIndex, "Corrupt tag table: " + path);
+        }
+        reader.skip(consumed);
+    }
+    if (!reader.atEnd()) {
+        return setError(ErrorCode::CorruptIndex, "Trailing data in " + path);
+    }
+
+    m_files = std::move(files);
+    m_contents = std::move(contents);
+    m_tags = std::move(tags);
+    m_fileByPath.clear();
+    for (uint32_t i = 0; i < m_files.size(); ++i) {
+        m_fileByPath.emplace(m_files[i].path, i);
+    }
+    m_lastStats = IndexStats{};
+
+    // Regroup from the file table so the in-memory invariants never depend on the file
+    rebuildContents();
+    return true;
+}
+
+const LibraryFile* LibraryIndex::findFile(const std::string& path) const {
+    const auto it = m_fileByPath.find(path);
+    return it == m_fileByPath.end() ? nullptr : &m_files[it->second];
+}
+
+const LibraryContent* LibraryIndex::findContent(const std::string& path) const {
+    const LibraryFile* file = findFile(path);
+    return file ? &m_contents[file->content] : nullptr;
+}
+
+std::vector<std::string> LibraryIndex::getDuplicates(const std::string& path) const {
+    std::vector<std::string> duplicates;
+    const LibraryContent* content = findContent(path);
+    if (content) {
+        for (uint32_t f : content->files) {
+            if (m_files[f].path != path) {
+                duplicates.push_back(m_files[f].path);
+            }
+        }
+    }
+    return duplicates;
+}
+
+std::vector<std::vector<std::string>> LibraryIndex::getDuplicateGroups() const {
+    std::vector<std::vector<std::string>> groups;
+    for (const LibraryContent& content : m_contents) {
+        if (content.files.size() < 2) {
+            continue;
+        }
+        std::vector<std::string> group;
+        group.reserve(content.files.size());
+        for (uint32_t f : content.files) {
+            group.push_back(m_files[f].path);
+        }
+        groups.push_back(std::move(group));
+    }
+    return groups;
+}
+
+void LibraryIndex::setPerceptualHashing(bool enabled) {
+    m_perceptualHashing = enabled;
+}
+
+std::vector<std::vector<std::string>> LibraryIndex::findNearDuplicates(int maxDistance) const {
+    updateSimilarityIndex();
+
+    std::vector<std::vector<std::string>> groups;
+    for (const std::vector<uint32_t>& members : m_similarity.findGroups(maxDistance)) {
+        std::vector<std::string> group;
+        group.reserve(members.size());
+        for (uint32_t id : members) {
+            group.push_back(m_files[m_contents[m_similarityContents[id]].files.front()].path);
+        }
+        groups.push_back(std::move(group));
+    }
+    return groups;
+}
+
+std::vector<SimilarImage> LibraryIndex::findSimilar(const std::string& path, size_t count) const {
+    std::vector<SimilarImage> similar;
+    const LibraryContent* content = findContent(path);
+    if (!content || !content->hasPerceptualHash) {
+        return similar;
+    }
+    updateSimilarityIndex();
+
+    // One extra result covers the query's own content
+    std::vector<HammingMatch> matches;
+    m_similarity.nearest(content->perceptualHash, count + 1, matches);
+    for (const HammingMatch& match : matches) {
+        const LibraryContent& other = m_contents[m_similarityContents[match.id]];
+        if (&other == content || similar.size() == count) {
+            continue;
+        }
+        similar.push_back({m_files[other.files.front()].path, match.distance});
+    }
+    return similar;
+}
+
+std::vector<ColorSimilarImage> LibraryIndex::findSimilarColors(const std::string& path, size_t count) const {
+    const LibraryContent* content = findContent(path);
+    if (!content || !content->hasColors) {
+        return {};
+    }
+    return searchColors(content->colors, count, content);
+}
+
+std::vector<ColorSimilarImage> LibraryIndex::findByColor(const LabColor& color, size_t count) const {
+    return searchColors(ColorSignature::fromColor(color), count, nullptr);
+}
+
+void LibraryIndex::filterFiles(const MetadataFilter& filter, SelectionBitmap& selection) const {
+    updateColumns();
+    m_columns.filter(filter, selection);
+}
+
+const MetadataColumns& LibraryIndex::getColumns() const {
+    updateColumns();
+    return m_columns;
+}
+
+bool LibraryIndex::tagFile(const std::string& path, const std::string& tag) {
+    const auto it = m_fileByPath.find(path);
+    return it != m_fileByPath.end() && m_tags.add(tag, it->second);
+}
+
+bool LibraryIndex::untagFile(const std::string& path, const std::string& tag) {
+    const auto it = m_fileByPath.find(path);
+    return it != m_fileByPath.end() && m_tags.remove(tag, it->second);
+}
+
+std::vector<std::string> LibraryIndex::getFileTags(const std::string& path) const {
+    const auto it = m_fileByPath.find(path);
+    return it == m_fileByPath.end() ? std::vector<std::string>() : m_tags.getTagsOf(it->second);
+}
+
+void LibraryIndex::selectTagged(const TagExpression& expression, SelectionBitmap& selection) const {
+    RoaringBitmap matches;
+    m_tags.evaluate(expression, static_cast<uint32_t>(m_files.size()), matches);
+    matches.toSelection(m_files.size(), selection);
+}
+
+const TagIndex& LibraryIndex::getTags() const {
+    return m_tags;
+}
+
+std::string LibraryIndex::getContentKey(const std::string& path) const {
+    const LibraryContent* content = findContent(path);
+    return content ? contentKey(content->hash) : std::string();
+}
+
+std::string LibraryIndex::contentKey(const ContentHash& hash) {
+    // Full-hash keys and sample-only keys (unique files) never collide with each other;
+    // a sample-only key is upgraded when a same-sample file later forces a full hash
+    char key[48];
+    std::snprintf(key, sizeof(key), "%c%016llx%016llx", hash.hasFull ? 'f' : 's',
+                  static_cast<unsigned long long>(hash.size),
+                  static_cast<unsigned long long>(hash.hasFull ? hash.full : hash.sample));
+    return key;
+}
+
+const std::vector<LibraryFile>& LibraryIndex::getFiles() const {
+    return m_files;
+}
+
+const std::vector<LibraryContent>& LibraryIndex::getContents() const {
+    return m_contents;
+}
+
+const LibraryIndex::IndexStats& LibraryIndex::getLastIndexStats() const {
+    return m_lastStats;
+}
+
+std::string LibraryIndex::getLastError() const {
+    return m_lastError;
+}
+
+LibraryIndex::ErrorCode LibraryIndex::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void LibraryIndex::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+void LibraryIndex::rebuildContents() {
+    const std::vector<LibraryContent> previous = std::move(m_contents);
+    m_contents.clear();
+
+    // Equal content sorts adjacently; ties by path make the representative deterministic
+    std::vector<uint32_t> order(m_files.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        const ContentHash& ha = m_files[a].hash;
+        const ContentHash& hb = m_files[b].hash;
+        if (ha.size != hb.size) return ha.size < hb.size;
+        if (ha.sample != hb.sample) return ha.sample < hb.sample;
+        if (ha.hasFull != hb.hasFull) return ha.hasFull;
+        if (ha.full != hb.full) return ha.full < hb.full;
+        return m_files[a].path < m_files[b].path;
+    });
+
+    // Files without a full hash never merge: equality is only trusted on full hashes
+    std::vector<uint32_t> assignment(m_files.size(), NO_CONTENT);
+    for (size_t k = 0; k < order.size(); ++k) {
+        const uint32_t f = order[k];
+        if (k == 0 || !sameContent(m_files[order[k - 1]].hash, m_files[f].hash)) {
+            m_contents.emplace_back();
+            m_contents.back().hash = m_files[f].hash;
+        }
+        LibraryContent& content = m_contents.back();
+        content.files.push_back(f);
+        assignment[f] = static_cast<uint32_t>(m_contents.size() - 1);
+
+        // Any unchanged copy carries its metadata over to the regrouped record
+        const uint32_t old = m_files[f].content;
+        if (!content.probed && old < previous.size() && previous[old].probed) {
+            content.header = previous[old].header;
+            content.perceptualHash = previous[old].perceptualHash;
+            content.hasPerceptualHash = previous[old].hasPerceptualHash;
+            content.luminance = previous[old].luminance;
+            content.hasLuminance = previous[old].hasLuminance;
+            content.colors = previous[old].colors;
+            content.hasColors = previous[old].hasColors;
+            content.probed = true;
+        }
+    }
+
+    m_similarityValid = false;
+    m_colorValid = false;
+    m_columnsValid = false;
+
+    for (size_t f = 0; f < m_files.size(); ++f) {
+        m_files[f].content = assignment[f];
+    }
+}
+
+void LibraryIndex::updateSimilarityIndex() const {
+    if (m_similarityValid) {
+        return;
+    }
+
+    std::vector<uint64_t> hashes;
+    m_similarityContents.clear();
+    for (uint32_t c = 0; c < m_contents.size(); ++c) {
+        if (m_contents[c].hasPerceptualHash) {
+            hashes.push_back(m_contents[c].perceptualHash);
+            m_similarityContents.push_back(c);
+        }
+    }
+    m_similarity.build(std::move(hashes));
+    m_similarityValid = true;
+}
+
+void LibraryIndex::updateColorIndex() const {
+    if (m_colorValid) {
+        return;
+    }
+
+    std::vector<ColorSignature> signatures;
+    m_colorContents.clear();
+    for (uint32_t c = 0; c < m_contents.size(); ++c) {
+        if (m_contents[c].hasColors) {
+            signatures.push_back(m_contents[c].colors);
+            m_colorContents.push_back(c);
+        }
+    }
+    m_colorIndex.build(signatures);
+    m_colorValid = true;
+}
+
+std::vector<ColorSimilarImage> LibraryIndex::searchColors(const ColorSignature& query, size_t count,
+                                                          const LibraryContent* exclude) const {
+    updateColorIndex();
+
+    // One extra result covers the query's own content
+    std::vector<ColorMatch> matches;
+    m_colorIndex.nearest(query, count + (exclude ? 1 : 0), matches);
+    std::vector<ColorSimilarImage> similar;
+    for (const ColorMatch& match : matches) {
+        const LibraryContent& other = m_contents[m_colorContents[match.id]];
+        if (&other == exclude || similar.size() == count) {
+            continue;
+        }
+        similar.push_back({m_files[other.files.front()].path, match.distance});
+    }
+    return similar;
+}
+
+void LibraryIndex::updateColumns() const {
+    if (m_columnsValid) {
+        return;
+    }
+    m_columns.build(m_files, m_contents);
+    m_columnsValid = true;
+}
+
+void LibraryIndex::eraseFiles(const std::vector<bool>& erase) {
+    if (std::find(erase.begin(), erase.end(), true) == erase.end()) {
+        return;
+    }
+
+    // Compaction preserves order, so tag bitmaps are remapped on their append path
+    std::vector<uint32_t> newIds(m_files.size(), TagIndex::NO_ID);
+    size_t kept = 0;
+    for (size_t f = 0; f < m_files.size(); ++f) {
+        if (!erase[f]) {
+            if (kept != f) {
+                m_files[kept] = std::move(m_files[f]);
+            }
+            newIds[f] = static_cast<uint32_t>(kept);
+            ++kept;
+        }
+    }
+    m_files.resize(kept);
+    if (!m_tags.empty()) {
+        m_tags.remap(newIds);
+    }
+
+    m_fileByPath.clear();
+    for (uint32_t i = 0; i < m_files.size(); ++i) {
+        m_fileByPath.emplace(m_files[i].path, i);
+    }
+}
+
+bool LibraryIndex::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
@@ -0,0 +1,204 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: LibraryIndex.h
+ * Description: Wallpaper library index keyed by file content, with exact-duplicate detection
+ *
+ * Strategy:
+ * - Every file gets a size + sample hash; only files whose (size, sample) bucket holds
+ *   more than one file are hashed in full, so unique files cost three chunk reads
+ * - Files with identical content share one LibraryContent record: probe metadata, pHash
+ *   and palette are computed once per content. getContentKey() names that content: the
+ *   application keys thumbnails (ThumbnailCache, RemoteThumbnails, GL textures) and the
+ *   workspace pre-renders by it, so copies share one decode and one render
+ * - Files whose size and mtime are unchanged since the last pass keep their hashes
+ * - All hashing and probing runs on a TaskScheduler under the caller's I/O class, so
+ *   rate limits and concurrency caps of that class apply
+ * - Each content also gets a 64-bit pHash of its decoded thumbnail; near-duplicate
+ *   reports and "more like this" queries run on a HammingIndex rebuilt lazily after changes
+ * - The same thumbnail yields a CIELAB palette signature; color queries ("similar colors",
+ *   "matches #1e1e2e") run on a ColorIndex, also rebuilt lazily
+ * - Gallery filters run on a columnar copy of the file metadata (MetadataColumns),
+ *   likewise rebuilt lazily, so live filter updates never walk the record tables
+ * - Tags are compressed bitmaps over file rows (TagIndex), remapped whenever the file
+ *   table compacts and saved with the index; a file dropped from the index loses its tags
+ * - The index is not thread-safe; callers serialize access
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ColorIndex.h"
+#include "ColorSignature.h"
+#include "ContentHasher.h"
+#include "HammingIndex.h"
+#include "MetadataColumns.h"
+#include "PerceptualHash.h"
+#include "SelectionBitmap.h"
+#include "TagExpression.h"
+#include "TagIndex.h"
+#include "../imaging/ImageProbe.h"
+#include "../utils/TaskScheduler.h"
+
+struct LibraryFile {
+    std::string path;
+    uint64_t size = 0;
+    int64_t mtimeNs = 0;
+    ContentHash hash;
+    uint32_t content = UINT32_MAX;  // Index into the content table
+};
+
+struct LibraryContent {
+    ContentHash hash;
+    ImageHeader header;
+    bool probed = false;            // header holds probe results
+    uint64_t perceptualHash = 0;    // pHash of the displayed image
+    bool hasPerceptualHash = false;
+    uint8_t luminance = 0;          // Mean BT.601 luma of the thumbnail
+    bool hasLuminance = false;
+    ColorSignature colors;          // Dominant CIELAB palette of the thumbnail
+    bool hasColors = false;
+    std::vector<uint32_t> files;    // Every copy; files.front() is the representative
+};
+
+struct SimilarImage {
+    std::string path;
+    int distance;                   // Hamming distance between perceptual hashes
+};
+
+struct ColorSimilarImage {
+    std::string path;
+    float distance;                 // Chamfer delta E between color signatures
+};
+
+class LibraryIndex {
+public:
+    static constexpr uint32_t NO_CONTENT = UINT32_MAX;
+    static constexpr uint32_t FORMAT_VERSION = 5;
+
+    // Resized/recompressed copies typically differ in 0-6 pHash bits, unrelated images near 32
+    static constexpr int NEAR_DUPLICATE_DISTANCE = 8;
+
+    struct IndexStats {
+        size_t filesSeen = 0;
+        size_t reused = 0;              // Unchanged since the last pass, no hashing
+        size_t sampleHashed = 0;
+        size_t fullHashed = 0;
+        size_t probed = 0;
+        size_t perceptualHashed = 0;
+        size_t failed = 0;
+        size_t duplicateFiles = 0;      // Files beyond the first copy of their content
+        uint64_t bytesRead = 0;
+    };
+
+    LibraryIndex();
+    ~LibraryIndex();
+
+    // Add or refresh files. Returns false if any file could not be indexed; the rest
+    // of the index is still updated and the failures are counted in the stats.
+    // Blocks until done. Fails with Deferred, touching nothing, while `ioClass` is held;
+    // a hold that begins mid-pass before any of its tasks has started is waited out.
+    bool indexFiles(const std::vector<std::string>& paths, TaskScheduler& scheduler,
+                    IoClass ioClass = IoClass::Background);
+    bool indexDirectory(const std::string& directory, TaskScheduler& scheduler,
+                        IoClass ioClass = IoClass::Background);
+
+    // Decode thumbnails during indexing for perceptual hashes, luminance and colors (on by default)
+    void setPerceptualHashing(bool enabled);
+
+    bool removeFile(const std::string& path);
+    void clear();
+
+    // Binary persistence ("CAITHEIX"), written atomically through a temporary file
+    bool save(const std::string& path);
+    bool load(const std::string& path);
+
+    // Lookups
+    const LibraryFile* findFile(const std::string& path) const;
+    const LibraryContent* findContent(const std::string& path) const;
+    std::vector<std::string> getDuplicates(const std::string& path) const;     // Other copies
+    std::vector<std::vector<std::string>> getDuplicateGroups() const;
+
+    // Near-duplicates by perceptual hash, one representative path per content
+    std::vector<std::vector<std::string>> findNearDuplicates(int maxDistance = NEAR_DUPLICATE_DISTANCE) const;
+    std::vector<SimilarImage> findSimilar(const std::string& path, size_t count) const;   // "More like this"
+
+    // Color similarity, one representative path per content, closest first
+    std::vector<ColorSimilarImage> findSimilarColors(const std::string& path, size_t count) const;
+    std::vector<ColorSimilarImage> findByColor(const LabColor& color, size_t count) const;   // Theme color
+
+    // Gallery filters; selection row i is getFiles()[i]
+    void filterFiles(const MetadataFilter& filter, SelectionBitmap& selection) const;
+    const MetadataColumns& getColumns() const;
+
+    // Tags on indexed files; false if the file is not indexed or the name is invalid
+    bool tagFile(const std::string& path, const std::string& tag);
+    bool untagFile(const std::string& path, const std::string& tag);
+    std::vector<std::string> getFileTags(const std::string& path) const;
+    // Files matching a compiled tag expression; selection row i is getFiles()[i]
+    void selectTagged(const TagExpression& expression, SelectionBitmap& selection) const;
+    const TagIndex& getTags() const;
+
+    // Stable cache key for per-content outputs (thumbnails, pre-renders); empty if unknown
+    std::string getContentKey(const std::string& path) const;
+    static std::string contentKey(const ContentHash& hash);
+
+    const std::vector<LibraryFile>& getFiles() const;
+    const std::vector<LibraryContent>& getContents() const;
+    const IndexStats& getLastIndexStats() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        FileFailed = 1,         // Some files could not be hashed or probed
+        DirectoryNotFound = 2,
+        WriteFailed = 3,
+        ReadFailed = 4,
+        CorruptIndex = 5,
+        VersionMismatch = 6,
+        ListingTimedOut = 7,    // A network mount overran its deadline; the files listed were indexed
+        Deferred = 8            // The I/O class is held by the power policy; nothing was indexed
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    // Group files into content records; carries probe metadata over from the old table
+    void rebuildContents();
+    void eraseFiles(const std::vector<bool>& erase);
+    void updateSimilarityIndex() const;
+    void updateColumns() const;
+    void updateColorIndex() const;
+    std::vector<ColorSimilarImage> searchColors(const ColorSignature& query, size_t count,
+                                                const LibraryContent* exclude) const;
+    bool setError(ErrorCode code, const std::string& message);
+
+    std::vector<LibraryFile> m_files;
+    std::unordered_map<std::string, uint32_t> m_fileByPath;
+    std::vector<LibraryContent> m_contents;
+    TagIndex m_tags;
+    bool m_perceptualHashing;
+
+    // Mutable cache for the similarity queries
+    mutable HammingIndex m_similarity;
+    mutable std::vector<uint32_t> m_similarityContents;    // HammingIndex id -> content
+    mutable bool m_similarityValid;
+
+    // Mutable cache for the color queries
+    mutable ColorIndex m_colorIndex;
+    mutable std::vector<uint32_t> m_colorContents;          // ColorIndex id -> content
+    mutable bool m_colorValid;
+
+    // Mutable cache for the gallery filters
+    mutable MetadataColumns m_columns;
+    mutable bool m_columnsValid;
+
+    IndexStats m_lastStats;
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
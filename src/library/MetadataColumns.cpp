@@ -0,0 +1,273 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: MetadataColumns.cpp
+ * Description: Implementation of the columnar metadata store and its block predicates
+ */
+
+#include "MetadataColumns.h"
+#include "LibraryIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CAITHE_COLUMNS_SSE2 1
+#endif
+
+namespace {
+
+constexpr size_t BLOCK_ROWS = 64;
+constexpr uint32_t FORMAT_COUNT = static_cast<uint32_t>(ImageFormat::WebP) + 1;
+constexpr uint32_t SHAPE_COUNT = static_cast<uint32_t>(ImageShape::Square) + 1;
+
+// Each predicate tests one 64-row block and returns bit i set when row i passes
+
+uint64_t int32AtLeast(const int32_t* values, int32_t minimum) {
+    uint64_t word = 0;
+#ifdef CAITHE_COLUMNS_SSE2
+    const __m128i bound = _mm_set1_epi32(minimum - 1);
+    for (size_t i = 0; i < BLOCK_ROWS; i += 4) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const int bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(x, bound)));
+        word |= static_cast<uint64_t>(bits) << i;
+    }
+#else
+    for (size_t i = 0; i < BLOCK_ROWS; ++i) {
+        word |= static_cast<uint64_t>(values[i] >= minimum) << i;
+    }
+#endif
+    return word;
+}
+
+uint64_t uint32Between(const uint32_t* values, uint32_t low, uint32_t high) {
+    uint64_t word = 0;
+#ifdef CAITHE_COLUMNS_SSE2
+    // SSE2 only compares signed lanes: flipping the sign bit maps unsigned order onto it
+    const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i lo = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(low)), bias);
+    const __m128i hi = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(high)), bias);
+    for (size_t i = 0; i < BLOCK_ROWS; i += 4) {
+        const __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)), bias);
+        const __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(lo, x), _mm_cmpgt_epi32(x, hi));
+        const int bits = _mm_movemask_ps(_mm_castsi128_ps(outside)) ^ 0xF;
+        word |= static_cast<uint64_t>(bits) << i;
+    }
+#else
+    for (size_t i = 0; i < BLOCK_ROWS; ++i) {
+        word |= static_cast<uint64_t>(values[i] >= low && values[i] <= high) << i;
+    }
+#endif
+    return word;
+}
+
+uint64_t floatBetween(const float* values, float low, float high) {
+    uint64_t word = 0;
+#ifdef CAITHE_COLUMNS_SSE2
+    const __m128 lo = _mm_set1_ps(low);
+    const __m128 hi = _mm_set1_ps(high);
+    for (size_t i = 0; i < BLOCK_ROWS; i += 4) {
+        const __m128 x = _mm_loadu_ps(values + i);
+        const int bits = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(x, lo), _mm_cmple_ps(x, hi)));
+        word |= static_cast<uint64_t>(bits) << i;
+    }
+#else
+    for (size_t i = 0; i < BLOCK_ROWS; ++i) {
+        word |= static_cast<uint64_t>(values[i] >= low && values[i] <= high) << i;
+    }
+#endif
+    return word;
+}
+
+uint64_t uint8Between(const uint8_t* values, uint8_t low, uint8_t high) {
+    uint64_t word = 0;
+#ifdef CAITHE_COLUMNS_SSE2
+    // x >= low <=> max(x, low) == x, and likewise for the upper bound
+    const __m128i lo = _mm_set1_epi8(static_cast<char>(low));
+    const __m128i hi = _mm_set1_epi8(static_cast<char>(high));
+    for (size_t i = 0; i < BLOCK_ROWS; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const __m128i inside = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(x, lo), x),
+                                             _mm_cmpeq_epi8(_mm_min_epu8(x, hi), x));
+        word |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(inside))) << i;
+    }
+#else
+    for (size_t i = 0; i < BLOCK_ROWS; ++i) {
+        word |= static_cast<uint64_t>(values[i] >= low && values[i] <= high) << i;
+    }
+#endif
+    return word;
+}
+
+// Rows whose value is one of the set bits of `set`; values are below `valueCount`
+uint64_t uint8InSet(const uint8_t* values, uint32_t set, uint32_t valueCount) {
+    uint64_t word = 0;
+#ifdef CAITHE_COLUMNS_SSE2
+    for (size_t i = 0; i < BLOCK_ROWS; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i match = _mm_setzero_si128();
+        for (uint32_t value = 0; value < valueCount; ++value) {
+            if (set & (1u << value)) {
+                match = _mm_or_si128(match, _mm_cmpeq_epi8(x, _mm_set1_epi8(static_cast<char>(value))));
+            }
+        }
+        word |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(match))) << i;
+    }
+#else
+    for (size_t i = 0; i < BLOCK_ROWS; ++i) {
+        word |= static_cast<uint64_t>(values[i] < valueCount && (set >> values[i]) & 1) << i;
+    }
+#endif
+    return word;
+}
+
+uint32_t clampSeconds(int64_t seconds) {
+    return static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(seconds, 0),
+                                                   std::numeric_limits<uint32_t>::max()));
+}
+
+} // namespace
+
+MetadataColumns::MetadataColumns()
+    : m_rows(0) {
+}
+
+MetadataColumns::~MetadataColumns() = default;
+
+void MetadataColumns::build(const std::vector<LibraryFile>& files, const std::vector<LibraryContent>& contents) {
+    m_rows = files.size();
+    const size_t blocks = (m_rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    const size_t padded = blocks * BLOCK_ROWS;
+
+    // Padding rows look like unknown metadata; filter() also masks them off
+    m_width.assign(padded, 0);
+    m_height.assign(padded, 0);
+    m_aspect.assign(padded, std::numeric_limits<float>::quiet_NaN());
+    m_format.assign(padded, static_cast<uint8_t>(ImageFormat::Unknown));
+    m_shape.assign(padded, static_cast<uint8_t>(ImageShape::Unknown));
+    m_mtime.assign(padded, 0);
+    m_luminance.assign(padded, 0);
+    m_luminanceKnown.assign(blocks, 0);
+
+    for (size_t row = 0; row < m_rows; ++row) {
+        const LibraryFile& file = files[row];
+        // Floor division keeps pre-1970 times below every valid bound
+        const int64_t seconds = file.mtimeNs >= 0 ? file.mtimeNs / 1000000000LL
+                                                  : -((-file.mtimeNs + 999999999LL) / 1000000000LL);
+        m_mtime[row] = clampSeconds(seconds);
+
+        if (file.content >= contents.size()) {
+            continue;
+        }
+        const LibraryContent& content = contents[file.content];
+        const int width = content.header.displayWidth();
+        const int height = content.header.displayHeight();
+        m_format[row] = static_cast<uint8_t>(content.header.format);
+        m_shape[row] = static_cast<uint8_t>(shapeOf(width, height));
+        if (width > 0 && height > 0) {
+            m_width[row] = width;
+            m_height[row] = height;
+            m_aspect[row] = static_cast<float>(width) / static_cast<float>(height);
+        }
+        if (content.hasLuminance) {
+            m_luminance[row] = content.luminance;
+            m_luminanceKnown[row / BLOCK_ROWS] |= 1ULL << (row % BLOCK_ROWS);
+        }
+    }
+}
+
+void MetadataColumns::clear() {
+    m_rows = 0;
+    m_width.clear();
+    m_height.clear();
+    m_aspect.clear();
+    m_format.clear();
+    m_shape.clear();
+    m_mtime.clear();
+    m_luminance.clear();
+    m_luminanceKnown.clear();
+}
+
+size_t MetadataColumns::size() const {
+    return m_rows;
+}
+
+void MetadataColumns::filter(const MetadataFilter& filter, SelectionBitmap& selection) const {
+    selection.reset(m_rows);
+
+    // Resolve which predicates constrain anything before touching a column
+    const bool byWidth = filter.minWidth > 0;
+    const bool byHeight = filter.minHeight > 0;
+    const bool byAspect = filter.minAspect > 0.0f || filter.maxAspect > 0.0f;
+    const float minAspect = std::max(filter.minAspect, 0.0f);
+    const float maxAspect = filter.maxAspect > 0.0f ? filter.maxAspect : std::numeric_limits<float>::infinity();
+
+    const uint32_t allFormats = (1u << FORMAT_COUNT) - 1;
+    const uint32_t allShapes = (1u << SHAPE_COUNT) - 1;
+    const uint32_t formats = filter.formats & allFormats;
+    const uint32_t shapes = filter.shapes & allShapes;
+    const bool byFormat = formats != allFormats;
+    const bool byShape = shapes != allShapes;
+
+    const bool byTime = filter.modifiedAfter != 0 || filter.modifiedBefore != 0;
+    const int64_t timeLow = std::max<int64_t>(filter.modifiedAfter, 0);
+    const int64_t timeHigh = filter.modifiedBefore != 0 ? filter.modifiedBefore
+                                                        : std::numeric_limits<uint32_t>::max();
+
+    const int luminanceLow = std::max(filter.minLuminance, 0);
+    const int luminanceHigh = std::min(filter.maxLuminance, 255);
+    const bool byLuminance = luminanceLow > 0 || luminanceHigh < 255;
+
+    // Ranges that no stored value can satisfy select nothing
+    if (minAspect > maxAspect || (byFormat && formats == 0) || (byShape && shapes == 0) ||
+        (byTime && (timeLow > timeHigh || timeHigh < 0 || timeLow > std::numeric_limits<uint32_t>::max())) ||
+        luminanceLow > luminanceHigh) {
+        return;
+    }
+
+    std::vector<uint64_t>& words = selection.words();
+    for (size_t block = 0; block < words.size(); ++block) {
+        const size_t base = block * BLOCK_ROWS;
+        uint64_t word = ~0ULL;
+
+        if (byWidth) {
+            word &= int32AtLeast(&m_width[base], filter.minWidth);
+        }
+        if (word && byHeight) {
+            word &= int32AtLeast(&m_height[base], filter.minHeight);
+        }
+        if (word && byAspect) {
+            word &= floatBetween(&m_aspect[base], minAspect, maxAspect);
+        }
+        if (word && byFormat) {
+            word &= uint8InSet(&m_format[base], formats, FORMAT_COUNT);
+        }
+        if (word && byShape) {
+            word &= uint8InSet(&m_shape[base], shapes, SHAPE_COUNT);
+        }
+        if (word && byTime) {
+            word &= uint32Between(&m_mtime[base], clampSeconds(timeLow), clampSeconds(timeHigh));
+        }
+        if (word && byLuminance) {
+            word &= m_luminanceKnown[block];
+            if (word) {
+                word &= uint8Between(&m_luminance[base], static_cast<uint8_t>(luminanceLow),
+                                     static_cast<uint8_t>(luminanceHigh));
+            }
+        }
+        words[block] = word;
+    }
+    selection.trim();
+}
+
+ImageShape MetadataColumns::shapeOf(int displayWidth, int displayHeight) {
+    if (displayWidth <= 0 || displayHeight <= 0) {
+        return ImageShape::Unknown;
+    }
+    const float aspect = static_cast<float>(displayWidth) / static_cast<float>(displayHeight);
+    if (std::fabs(aspect - 1.0f) <= SQUARE_TOLERANCE) {
+        return ImageShape::Square;
+    }
+    return aspect > 1.0f ? ImageShape::Landscape : ImageShape::Portrait;
+}
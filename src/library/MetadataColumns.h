@@ -0,0 +1,95 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: MetadataColumns.h
+ * Description: Columnar copy of library metadata with vectorized gallery filters
+ *
+ * Strategy:
+ * - One row per library file, stored as parallel arrays (width, height, aspect, format,
+ *   shape, modification time, luminance) so a predicate streams only the column it tests
+ * - Columns are padded to whole 64-row blocks; every predicate turns one block into one
+ *   64-bit word, and the words of a compound filter are ANDed into a SelectionBitmap
+ * - Later predicates are skipped for blocks that are already empty, and unconstrained
+ *   fields are never read
+ * - Comparisons run 4 (int32/float) or 16 (uint8) rows per SSE2 instruction with a
+ *   movemask into the block word; targets without SSE2 use the scalar loop
+ * - Rows whose metadata is missing (unprobed, non-image, undecoded) fail every predicate
+ *   on that field but pass an unconstrained filter
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SelectionBitmap.h"
+#include "../imaging/ImageProbe.h"
+
+struct LibraryFile;
+struct LibraryContent;
+
+// Display shape, derived from the post-orientation aspect ratio
+enum class ImageShape : uint8_t {
+    Unknown = 0,
+    Landscape,
+    Portrait,
+    Square
+};
+
+struct MetadataFilter {
+    static constexpr uint32_t ANY = ~0u;
+
+    int minWidth = 0;               // Display dimensions; 0 = unconstrained
+    int minHeight = 0;
+    float minAspect = 0.0f;         // Display width / height; 0 = unconstrained
+    float maxAspect = 0.0f;
+    uint32_t formats = ANY;         // Bit per ImageFormat, see formatBit()
+    uint32_t shapes = ANY;          // Bit per ImageShape, see shapeBit()
+    int64_t modifiedAfter = 0;      // Unix seconds, inclusive; 0 = unconstrained
+    int64_t modifiedBefore = 0;
+    int minLuminance = 0;           // Mean BT.601 luma, 0-255
+    int maxLuminance = 255;
+
+    static uint32_t formatBit(ImageFormat format) { return 1u << static_cast<uint32_t>(format); }
+    static uint32_t shapeBit(ImageShape shape) { return 1u << static_cast<uint32_t>(shape); }
+};
+
+class MetadataColumns {
+public:
+    // Aspect ratios within this relative distance of 1 count as square
+    static constexpr float SQUARE_TOLERANCE = 0.05f;
+
+    MetadataColumns();
+    ~MetadataColumns();
+
+    // Rebuild from the index tables; row i is files[i]
+    void build(const std::vector<LibraryFile>& files, const std::vector<LibraryContent>& contents);
+    void clear();
+
+    size_t size() const;
+
+    // selection = rows matching every constraint of the filter
+    void filter(const MetadataFilter& filter, SelectionBitmap& selection) const;
+
+    // Column access; each column holds size() rows followed by block padding
+    const int32_t* widths() const { return m_width.data(); }
+    const int32_t* heights() const { return m_height.data(); }
+    const float* aspects() const { return m_aspect.data(); }
+    const uint8_t* formats() const { return m_format.data(); }
+    const uint8_t* shapes() const { return m_shape.data(); }
+    const uint32_t* modifiedTimes() const { return m_mtime.data(); }
+    const uint8_t* luminances() const { return m_luminance.data(); }
+
+    static ImageShape shapeOf(int displayWidth, int displayHeight);
+
+private:
+    size_t m_rows;
+    std::vector<int32_t> m_width;       // Display width, 0 when unknown
+    std::vector<int32_t> m_height;
+    std::vector<float> m_aspect;        // NaN when unknown, so every range test fails
+    std::vector<uint8_t> m_format;      // ImageFormat
+    std::vector<uint8_t> m_shape;       // ImageShape
+    std::vector<uint32_t> m_mtime;      // Unix seconds, clamped to [0, 2^32)
+    std::vector<uint8_t> m_luminance;
+    std::vector<uint64_t> m_luminanceKnown;   // Bit per row, one word per block
+};
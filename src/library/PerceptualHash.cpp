@@ -0,0 +1,129 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: PerceptualHash.cpp
+ * Description: Implementation of DCT-based and gradient-based perceptual hashes
+ */
+
+#include "PerceptualHash.h"
+#include <algorithm>
+#include <cmath>
+
+PerceptualHash::PerceptualHash()
+    : m_lastErrorCode(ErrorCode::None) {
+    // Basis rows k = 0..8 of the 32-point DCT-II; only 1..8 are used, row 0 keeps indexing direct
+    const double pi = std::acos(-1.0);
+    m_cosine.resize((PHASH_BLOCK + 1) * PHASH_SIZE);
+    for (int k = 0; k <= PHASH_BLOCK; ++k) {
+        for (int x = 0; x < PHASH_SIZE; ++x) {
+            m_cosine[k * PHASH_SIZE + x] = static_cast<float>(std::cos((2 * x + 1) * k * pi / (2 * PHASH_SIZE)));
+        }
+    }
+}
+
+PerceptualHash::~PerceptualHash() = default;
+
+bool PerceptualHash::computePHash(const ImageBuffer& image, ImageOrientation orientation, uint64_t& hash) {
+    clearError();
+    if (!reduceToLuma(image, orientation, PHASH_SIZE, PHASH_SIZE)) {
+        return false;
+    }
+
+    // Row transform for the 8 kept horizontal frequencies
+    m_rowTransform.assign(PHASH_SIZE * PHASH_BLOCK, 0.0f);
+    for (int y = 0; y < PHASH_SIZE; ++y) {
+        const float* row = &m_luma[y * PHASH_SIZE];
+        for (int u = 1; u <= PHASH_BLOCK; ++u) {
+            const float* basis = &m_cosine[u * PHASH_SIZE];
+            float sum = 0.0f;
+            for (int x = 0; x < PHASH_SIZE; ++x) {
+                sum += row[x] * basis[x];
+            }
+            m_rowTransform[y * PHASH_BLOCK + (u - 1)] = sum;
+        }
+    }
+
+    // Column transform for the 8 kept vertical frequencies
+    float coefficients[PHASH_BLOCK * PHASH_BLOCK];
+    for (int v = 1; v <= PHASH_BLOCK; ++v) {
+        const float* basis = &m_cosine[v * PHASH_SIZE];
+        for (int u = 0; u < PHASH_BLOCK; ++u) {
+            float sum = 0.0f;
+            for (int y = 0; y < PHASH_SIZE; ++y) {
+                sum += m_rowTransform[y * PHASH_BLOCK + u] * basis[y];
+            }
+            coefficients[(v - 1) * PHASH_BLOCK + u] = sum;
+        }
+    }
+
+    float sorted[PHASH_BLOCK * PHASH_BLOCK];
+    std::copy(coefficients, coefficients + PHASH_BLOCK * PHASH_BLOCK, sorted);
+    std::nth_element(sorted, sorted + 32, sorted + 64);
+    const float median = sorted[32];
+
+    hash = 0;
+    for (int i = 0; i < PHASH_BLOCK * PHASH_BLOCK; ++i) {
+        if (coefficients[i] > median) {
+            hash |= 1ULL << i;
+        }
+    }
+    return true;
+}
+
+bool PerceptualHash::computeDHash(const ImageBuffer& image, ImageOrientation orientation, uint64_t& hash) {
+    clearError();
+    if (!reduceToLuma(image, orientation, 9, 8)) {
+        return false;
+    }
+
+    hash = 0;
+    for (int y = 0; y < 8; ++y) {
+        const float* row = &m_luma[y * 9];
+        for (int x = 0; x < 8; ++x) {
+            if (row[x] > row[x + 1]) {
+                hash |= 1ULL << (y * 8 + x);
+            }
+        }
+    }
+    return true;
+}
+
+std::string PerceptualHash::getLastError() const {
+    return m_lastError;
+}
+
+PerceptualHash::ErrorCode PerceptualHash::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void PerceptualHash::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool PerceptualHash::reduceToLuma(const ImageBuffer& image, ImageOrientation orientation, int width, int height) {
+    if (image.empty() || image.channels < 1 || image.channels > 4) {
+        return setError(ErrorCode::InvalidImage, "Image is empty or has an unsupported channel count");
+    }
+    if (!m_resampler.resample(image, orientation, m_reduced, width, height, Resampler::Filter::Box)) {
+        return setError(ErrorCode::InvalidImage, m_resampler.getLastError());
+    }
+
+    m_luma.resize(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = m_reduced.row(y);
+        for (int x = 0; x < width; ++x) {
+            const uint8_t* p = row + x * m_reduced.channels;
+            m_luma[y * width + x] = m_reduced.channels >= 3
+                ? 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]
+                : static_cast<float>(p[0]);
+        }
+    }
+    return true;
+}
+
+bool PerceptualHash::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
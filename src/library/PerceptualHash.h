@@ -0,0 +1,66 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: PerceptualHash.h
+ * Description: 64-bit perceptual hashes (pHash, dHash) that survive resizing and recompression
+ *
+ * Mathematical Foundation:
+ * - pHash: luma is box-filtered to 32x32 and transformed with a 2-D DCT-II,
+ *   F(u, v) = sum_x sum_y f(x, y) cos((2x + 1) u pi / 64) cos((2y + 1) v pi / 64);
+ *   the 8x8 block F(1..8, 1..8) (lowest frequencies without the DC row and column)
+ *   is thresholded at its median, one bit per coefficient
+ * - dHash: luma is box-filtered to 9x8 and each bit records whether a pixel is
+ *   brighter than its right-hand neighbour
+ * - Similar images differ in few bits, so Hamming distance approximates visual distance:
+ *   recompressed or rescaled copies typically land within 0-6 bits, unrelated images near 32
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../imaging/ImageBuffer.h"
+#include "../imaging/ImageOrientation.h"
+#include "../imaging/Resampler.h"
+
+class PerceptualHash {
+public:
+    static constexpr int PHASH_SIZE = 32;       // Side of the DCT input
+    static constexpr int PHASH_BLOCK = 8;       // Side of the kept coefficient block
+
+    PerceptualHash();
+    ~PerceptualHash();
+
+    // Hashes of the image as displayed under `orientation`
+    bool computePHash(const ImageBuffer& image, ImageOrientation orientation, uint64_t& hash);
+    bool computeDHash(const ImageBuffer& image, ImageOrientation orientation, uint64_t& hash);
+
+    static int distance(uint64_t a, uint64_t b) {
+        return __builtin_popcountll(a ^ b);
+    }
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        InvalidImage = 1
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    // Box-filter to width x height and convert to BT.601 luma
+    bool reduceToLuma(const ImageBuffer& image, ImageOrientation orientation, int width, int height);
+    bool setError(ErrorCode code, const std::string& message);
+
+    Resampler m_resampler;
+    ImageBuffer m_reduced;
+    std::vector<float> m_luma;
+    std::vector<float> m_rowTransform;
+    std::vector<float> m_cosine;    // PHASH_BLOCK + 1 rows of PHASH_SIZE basis values
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
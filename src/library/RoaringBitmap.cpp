@@ -0,0 +1,539 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: RoaringBitmap.cpp
+ * Description: Implementation of the roaring bitmap containers and set operations
+ */
+
+#include "RoaringBitmap.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Array containers at least this many times larger than the other side are galloped
+constexpr size_t GALLOP_RATIO = 32;
+
+uint32_t popcount(const std::vector<uint64_t>& words) {
+    uint32_t total = 0;
+    for (uint64_t word : words) {
+        total += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+    return total;
+}
+
+template <typename T>
+void putLittle(std::vector<uint8_t>& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+    }
+}
+
+template <typename T>
+T getLittle(const uint8_t* data) {
+    uint64_t raw = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        raw |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    return static_cast<T>(raw);
+}
+
+} // namespace
+
+bool RoaringBitmap::Container::contains(uint16_t low) const {
+    if (isBitmap()) {
+        return (bitmap[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+void RoaringBitmap::Container::toBitmap() {
+    bitmap.assign(BITMAP_WORDS, 0);
+    for (uint16_t low : array) {
+        bitmap[low >> 6] |= 1ULL << (low & 63);
+    }
+    array.clear();
+    array.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::toArray() {
+    array.clear();
+    array.reserve(cardinality);
+    for (uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+        for (uint64_t word = bitmap[w]; word != 0; word &= word - 1) {
+            array.push_back(static_cast<uint16_t>(w * 64 + static_cast<uint32_t>(__builtin_ctzll(word))));
+        }
+    }
+    bitmap.clear();
+    bitmap.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::normalize() {
+    if (isBitmap() && cardinality <= ARRAY_MAX) {
+        toArray();
+    } else if (!isBitmap() && cardinality > ARRAY_MAX) {
+        toBitmap();
+    }
+}
+
+RoaringBitmap::RoaringBitmap() = default;
+
+RoaringBitmap::~RoaringBitmap() = default;
+
+RoaringBitmap RoaringBitmap::range(uint32_t begin, uint32_t end) {
+    RoaringBitmap result;
+    for (uint64_t start = begin; start < end;) {
+        const uint64_t keyBase = start & ~0xFFFFULL;
+        const uint64_t stop = std::min<uint64_t>(end, keyBase + 0x10000);
+
+        Container container;
+        container.key = static_cast<uint16_t>(start >> 16);
+        container.cardinality = static_cast<uint32_t>(stop - start);
+        container.bitmap.assign(BITMAP_WORDS, 0);
+        for (uint64_t v = start - keyBase; v < stop - keyBase; ++v) {
+            container.bitmap[v >> 6] |= 1ULL << (v & 63);
+        }
+        container.normalize();
+        result.m_containers.push_back(std::move(container));
+        start = stop;
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::fromSelection(const SelectionBitmap& selection) {
+    RoaringBitmap result;
+    const std::vector<uint64_t>& words = selection.words();
+    for (size_t first = 0; first < words.size(); first += BITMAP_WORDS) {
+        const size_t last = std::min(words.size(), first + BITMAP_WORDS);
+        Container container;
+        container.key = static_cast<uint16_t>(first / BITMAP_WORDS);
+        container.bitmap.assign(BITMAP_WORDS, 0);
+        std::copy(words.begin() + first, words.begin() + last, container.bitmap.begin());
+        container.cardinality = popcount(container.bitmap);
+        if (container.cardinality == 0) {
+            continue;
+        }
+        container.normalize();
+        result.m_containers.push_back(std::move(container));
+    }
+    return result;
+}
+
+void RoaringBitmap::add(uint32_t value) {
+    const uint16_t key = static_cast<uint16_t>(value >> 16);
+    const uint16_t low = static_cast<uint16_t>(value);
+
+    Container* container;
+    if (m_containers.empty() || m_containers.back().key < key) {
+        m_containers.emplace_back();
+        container = &m_containers.back();
+        container->key = key;
+    } else if (m_containers.back().key == key) {
+        container = &m_containers.back();
+    } else {
+        auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                                   [](const Container& c, uint16_t k) { return c.key < k; });
+        if (it == m_containers.end() || it->key != key) {
+            it = m_containers.emplace(it);
+            it->key = key;
+        }
+        container = &*it;
+    }
+
+    if (container->isBitmap()) {
+        uint64_t& word = container->bitmap[low >> 6];
+        const uint64_t bit = 1ULL << (low & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            ++container->cardinality;
+        }
+        return;
+    }
+
+    std::vector<uint16_t>& array = container->array;
+    if (array.empty() || array.back() < low) {
+        array.push_back(low);
+    } else {
+        const auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (*it == low) {
+            return;
+        }
+        array.insert(it, low);
+    }
+    ++container->cardinality;
+    container->normalize();
+}
+
+void RoaringBitmap::remove(uint32_t value) {
+    Container* container = findContainer(static_cast<uint16_t>(value >> 16));
+    const uint16_t low = static_cast<uint16_t>(value);
+    if (!container || !container->contains(low)) {
+        return;
+    }
+
+    if (container->isBitmap()) {
+        container->bitmap[low >> 6] &= ~(1ULL << (low & 63));
+    } else {
+        container->array.erase(std::lower_bound(container->array.begin(), container->array.end(), low));
+    }
+    if (--container->cardinality == 0) {
+        m_containers.erase(m_containers.begin() + (container - m_containers.data()));
+        return;
+    }
+    container->normalize();
+}
+
+bool RoaringBitmap::contains(uint32_t value) const {
+    const Container* container = findContainer(static_cast<uint16_t>(value >> 16));
+    return container && container->contains(static_cast<uint16_t>(value));
+}
+
+void RoaringBitmap::clear() {
+    m_containers.clear();
+}
+
+size_t RoaringBitmap::cardinality() const {
+    size_t total = 0;
+    for (const Container& container : m_containers) {
+        total += container.cardinality;
+    }
+    return total;
+}
+
+bool RoaringBitmap::empty() const {
+    return m_containers.empty();
+}
+
+uint32_t RoaringBitmap::maximum() const {
+    const Container& last = m_containers.back();
+    uint32_t low;
+    if (last.isBitmap()) {
+        uint32_t w = BITMAP_WORDS - 1;
+        while (last.bitmap[w] == 0) {
+            --w;
+        }
+        low = w * 64 + 63 - static_cast<uint32_t>(__builtin_clzll(last.bitmap[w]));
+    } else {
+        low = last.array.back();
+    }
+    return (static_cast<uint32_t>(last.key) << 16) | low;
+}
+
+RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap& other) {
+    size_t kept = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < m_containers.size(); ++i) {
+        Container& container = m_containers[i];
+        while (j < other.m_containers.size() && other.m_containers[j].key < container.key) {
+            ++j;
+        }
+        if (j == other.m_containers.size() || other.m_containers[j].key != container.key) {
+            continue;
+        }
+        intersect(container, other.m_containers[j]);
+        if (container.cardinality > 0) {
+            if (kept != i) {
+                m_containers[kept] = std::move(container);
+            }
+            ++kept;
+        }
+    }
+    m_containers.resize(kept);
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap& other) {
+    std::vector<Container> merged;
+    merged.reserve(m_containers.size() + other.m_containers.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < m_containers.size() || j < other.m_containers.size()) {
+        if (j == other.m_containers.size() ||
+            (i < m_containers.size() && m_containers[i].key < other.m_containers[j].key)) {
+            merged.push_back(std::move(m_containers[i++]));
+        } else if (i == m_containers.size() || other.m_containers[j].key < m_containers[i].key) {
+            merged.push_back(other.m_containers[j++]);
+        } else {
+            unite(m_containers[i], other.m_containers[j++]);
+            merged.push_back(std::move(m_containers[i++]));
+        }
+    }
+    m_containers = std::move(merged);
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::operator-=(const RoaringBitmap& other) {
+    size_t kept = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < m_containers.size(); ++i) {
+        Container& container = m_containers[i];
+        while (j < other.m_containers.size() && other.m_containers[j].key < container.key) {
+            ++j;
+        }
+        if (j < other.m_containers.size() && other.m_containers[j].key == container.key) {
+            subtract(container, other.m_containers[j]);
+        }
+        if (container.cardinality > 0) {
+            if (kept != i) {
+                m_containers[kept] = std::move(container);
+            }
+            ++kept;
+        }
+    }
+    m_containers.resize(kept);
+    return *this;
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap& other) const {
+    // The representation is a function of the cardinality, so equal sets compare field-wise
+    if (m_containers.size() != other.m_containers.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < m_containers.size(); ++i) {
+        const Container& a = m_containers[i];
+        const Container& b = other.m_containers[i];
+        if (a.key != b.key || a.cardinality != b.cardinality || a.array != b.array || a.bitmap != b.bitmap) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<uint32_t> RoaringBitmap::toVector() const {
+    std::vector<uint32_t> values;
+    values.reserve(cardinality());
+    forEach([&values](uint32_t value) { values.push_back(value); });
+    return values;
+}
+
+void RoaringBitmap::toSelection(size_t rows, SelectionBitmap& selection) const {
+    selection.reset(rows);
+    std::vector<uint64_t>& words = selection.words();
+    for (const Container& container : m_containers) {
+        const size_t base = static_cast<size_t>(container.key) << 16;
+        if (base >= rows) {
+            break;
+        }
+        if (container.isBitmap()) {
+            const size_t firstWord = base / 64;
+            const size_t count = std::min<size_t>(BITMAP_WORDS, words.size() - firstWord);
+            std::copy(container.bitmap.begin(), container.bitmap.begin() + count, words.begin() + firstWord);
+        } else {
+            for (uint16_t low : container.array) {
+                const size_t row = base | low;
+                if (row >= rows) {
+                    break;
+                }
+                words[row / 64] |= 1ULL << (row % 64);
+            }
+        }
+    }
+    selection.trim();
+}
+
+void RoaringBitmap::serialize(std::vector<uint8_t>& out) const {
+    putLittle<uint32_t>(out, static_cast<uint32_t>(m_containers.size()));
+    for (const Container& container : m_containers) {
+        putLittle<uint16_t>(out, container.key);
+        putLittle<uint32_t>(out, container.cardinality);
+        if (container.isBitmap()) {
+            for (uint64_t word : container.bitmap) {
+                putLittle<uint64_t>(out, word);
+            }
+        } else {
+            for (uint16_t low : container.array) {
+                putLittle<uint16_t>(out, low);
+            }
+        }
+    }
+}
+
+bool RoaringBitmap::deserialize(const uint8_t* data, size_t size, size_t& consumed) {
+    m_containers.clear();
+    consumed = 0;
+    if (size < 4) {
+        return false;
+    }
+    const uint32_t count = getLittle<uint32_t>(data);
+    size_t offset = 4;
+
+    std::vector<Container> containers;
+    for (uint32_t c = 0; c < count; ++c) {
+        if (size - offset < 6) {
+            return false;
+        }
+        Container container;
+        container.key = getLittle<uint16_t>(data + offset);
+        container.cardinality = getLittle<uint32_t>(data + offset + 2);
+        offset += 6;
+        if (container.cardinality == 0 || container.cardinality > 0x10000 ||
+            (!containers.empty() && containers.back().key >= container.key)) {
+            return false;
+        }
+
+        // The encoding is chosen by cardinality, exactly as in memory
+        if (container.cardinality > ARRAY_MAX) {
+            if (size - offset < BITMAP_WORDS * 8) {
+                return false;
+            }
+            container.bitmap.resize(BITMAP_WORDS);
+            for (uint32_t w = 0; w < BITMAP_WORDS; ++w, offset += 8) {
+                container.bitmap[w] = getLittle<uint64_t>(data + offset);
+            }
+            if (popcount(container.bitmap) != container.cardinality) {
+                return false;
+            }
+        } else {
+            if (size - offset < static_cast<size_t>(container.cardinality) * 2) {
+                return false;
+            }
+            container.array.resize(container.cardinality);
+            for (uint32_t k = 0; k < container.cardinality; ++k, offset += 2) {
+                container.array[k] = getLittle<uint16_t>(data + offset);
+                if (k > 0 && container.array[k] <= container.array[k - 1]) {
+                    return false;
+                }
+            }
+        }
+        containers.push_back(std::move(container));
+    }
+
+    m_containers = std::move(containers);
+    consumed = offset;
+    return true;
+}
+
+size_t RoaringBitmap::getContainerCount() const {
+    return m_containers.size();
+}
+
+size_t RoaringBitmap::getMemoryBytes() const {
+    size_t bytes = 0;
+    for (const Container& container : m_containers) {
+        bytes += container.array.size() * sizeof(uint16_t) + container.bitmap.size() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+void RoaringBitmap::intersect(Container& a, const Container& b) {
+    if (a.isBitmap() && b.isBitmap()) {
+        for (uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+            a.bitmap[w] &= b.bitmap[w];
+        }
+        a.cardinality = popcount(a.bitmap);
+        a.normalize();
+        return;
+    }
+
+    std::vector<uint16_t> result;
+    if (a.isBitmap()) {
+        result.reserve(b.array.size());
+        for (uint16_t low : b.array) {
+            if (a.contains(low)) {
+                result.push_back(low);
+            }
+        }
+        a.bitmap.clear();
+        a.bitmap.shrink_to_fit();
+    } else if (b.isBitmap()) {
+        result.reserve(a.array.size());
+        for (uint16_t low : a.array) {
+            if (b.contains(low)) {
+                result.push_back(low);
+            }
+        }
+    } else {
+        const std::vector<uint16_t>& small = a.array.size() <= b.array.size() ? a.array : b.array;
+        const std::vector<uint16_t>& large = a.array.size() <= b.array.size() ? b.array : a.array;
+        result.reserve(small.size());
+        if (large.size() >= small.size() * GALLOP_RATIO) {
+            auto from = large.begin();
+            for (uint16_t low : small) {
+                from = std::lower_bound(from, large.end(), low);
+                if (from == large.end()) {
+                    break;
+                }
+                if (*from == low) {
+                    result.push_back(low);
+                }
+            }
+        } else {
+            std::set_intersection(small.begin(), small.end(), large.begin(), large.end(),
+                                  std::back_inserter(result));
+        }
+    }
+    a.array = std::move(result);
+    a.cardinality = static_cast<uint32_t>(a.array.size());
+}
+
+void RoaringBitmap::unite(Container& a, const Container& b) {
+    if (!a.isBitmap() && !b.isBitmap()) {
+        std::vector<uint16_t> result;
+        result.reserve(a.array.size() + b.array.size());
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                       std::back_inserter(result));
+        a.array = std::move(result);
+        a.cardinality = static_cast<uint32_t>(a.array.size());
+        a.normalize();
+        return;
+    }
+
+    if (!a.isBitmap()) {
+        a.toBitmap();
+    }
+    if (b.isBitmap()) {
+        for (uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+            a.bitmap[w] |= b.bitmap[w];
+        }
+    } else {
+        for (uint16_t low : b.array) {
+            a.bitmap[low >> 6] |= 1ULL << (low & 63);
+        }
+    }
+    a.cardinality = popcount(a.bitmap);
+    a.normalize();
+}
+
+void RoaringBitmap::subtract(Container& a, const Container& b) {
+    if (a.isBitmap()) {
+        if (b.isBitmap()) {
+            for (uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+                a.bitmap[w] &= ~b.bitmap[w];
+            }
+        } else {
+            for (uint16_t low : b.array) {
+                a.bitmap[low >> 6] &= ~(1ULL << (low & 63));
+            }
+        }
+        a.cardinality = popcount(a.bitmap);
+        a.normalize();
+        return;
+    }
+
+    std::vector<uint16_t> result;
+    result.reserve(a.array.size());
+    if (b.isBitmap()) {
+        for (uint16_t low : a.array) {
+            if (!b.contains(low)) {
+                result.push_back(low);
+            }
+        }
+    } else {
+        std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                            std::back_inserter(result));
+    }
+    a.array = std::move(result);
+    a.cardinality = static_cast<uint32_t>(a.array.size());
+}
+
+RoaringBitmap::Container* RoaringBitmap::findContainer(uint16_t key) {
+    const auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                                     [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != m_containers.end() && it->key == key ? &*it : nullptr;
+}
+
+const RoaringBitmap::Container* RoaringBitmap::findContainer(uint16_t key) const {
+    const auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                                     [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != m_containers.end() && it->key == key ? &*it : nullptr;
+}
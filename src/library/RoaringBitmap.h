@@ -0,0 +1,110 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: RoaringBitmap.h
+ * Description: Compressed 32-bit integer set (roaring layout) for tag membership
+ *
+ * Strategy:
+ * - Values are split into a 16-bit key (high half) and a 16-bit low half; each key owns
+ *   one container covering 65536 values, kept sorted by key
+ * - Sparse containers (up to ARRAY_MAX values) are sorted uint16 arrays; dense ones are
+ *   65536-bit bitmaps. Results are converted at the boundary, so a container never
+ *   uses more than 8 KiB
+ * - Set operations walk both container lists in key order: bitmap x bitmap is a word
+ *   loop, array x bitmap tests bits, array x array merges (or gallops when one side
+ *   is much smaller)
+ * - Library ids are dense and small, so run containers are left out: a tag over a whole
+ *   folder costs at most one 8 KiB bitmap per 65536 files
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SelectionBitmap.h"
+
+class RoaringBitmap {
+public:
+    static constexpr uint32_t ARRAY_MAX = 4096;         // Above this a bitmap is smaller
+    static constexpr uint32_t BITMAP_WORDS = 1024;      // 65536 bits
+
+    RoaringBitmap();
+    ~RoaringBitmap();
+
+    // Every value in [begin, end)
+    static RoaringBitmap range(uint32_t begin, uint32_t end);
+    static RoaringBitmap fromSelection(const SelectionBitmap& selection);
+
+    void add(uint32_t value);           // Ascending adds append without searching
+    void remove(uint32_t value);
+    bool contains(uint32_t value) const;
+    void clear();
+
+    size_t cardinality() const;
+    bool empty() const;
+    uint32_t maximum() const;           // Largest value; the bitmap must not be empty
+
+    // In-place set operations
+    RoaringBitmap& operator&=(const RoaringBitmap& other);
+    RoaringBitmap& operator|=(const RoaringBitmap& other);
+    RoaringBitmap& operator-=(const RoaringBitmap& other);     // AND NOT
+
+    bool operator==(const RoaringBitmap& other) const;
+    bool operator!=(const RoaringBitmap& other) const { return !(*this == other); }
+
+    // Call fn(value) for each value in ascending order
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (const Container& container : m_containers) {
+            const uint32_t high = static_cast<uint32_t>(container.key) << 16;
+            if (container.isBitmap()) {
+                for (uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+                    for (uint64_t word = container.bitmap[w]; word != 0; word &= word - 1) {
+                        fn(high | (w * 64 + static_cast<uint32_t>(__builtin_ctzll(word))));
+                    }
+                }
+            } else {
+                for (uint16_t low : container.array) {
+                    fn(high | low);
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> toVector() const;
+
+    // Rows of a selection covering `rows` rows; values >= rows are dropped
+    void toSelection(size_t rows, SelectionBitmap& selection) const;
+
+    // Compact little-endian encoding, appended to `out`
+    void serialize(std::vector<uint8_t>& out) const;
+    // Decode from `data`; `consumed` receives the encoded length
+    bool deserialize(const uint8_t* data, size_t size, size_t& consumed);
+
+    size_t getContainerCount() const;
+    size_t getMemoryBytes() const;      // Container payload, for diagnostics
+
+private:
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array;    // Sorted low halves, when sparse
+        std::vector<uint64_t> bitmap;   // BITMAP_WORDS words, when dense
+
+        bool isBitmap() const { return !bitmap.empty(); }
+        bool contains(uint16_t low) const;
+        void toBitmap();
+        void toArray();
+        void normalize();               // Pick the representation for the cardinality
+    };
+
+    static void intersect(Container& a, const Container& b);
+    static void unite(Container& a, const Container& b);
+    static void subtract(Container& a, const Container& b);
+
+    Container* findContainer(uint16_t key);
+    const Container* findContainer(uint16_t key) const;
+
+    std::vector<Container> m_containers;    // Non-empty, sorted by key
+};
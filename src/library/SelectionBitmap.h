@@ -0,0 +1,90 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: SelectionBitmap.h
+ * Description: Dense row-selection bitmap produced by metadata filters
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SelectionBitmap {
+public:
+    SelectionBitmap() : m_size(0) {}
+
+    // Resize to `size` rows, all cleared
+    void reset(size_t size) {
+        m_size = size;
+        m_words.assign((size + 63) / 64, 0);
+    }
+
+    // Every row in [0, size) set
+    void fill(size_t size) {
+        reset(size);
+        for (uint64_t& word : m_words) {
+            word = ~0ULL;
+        }
+        trim();
+    }
+
+    size_t size() const { return m_size; }
+
+    bool test(size_t row) const { return (m_words[row / 64] >> (row % 64)) & 1; }
+    void set(size_t row) { m_words[row / 64] |= 1ULL << (row % 64); }
+    void unset(size_t row) { m_words[row / 64] &= ~(1ULL << (row % 64)); }
+
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t word : m_words) {
+            total += static_cast<size_t>(__builtin_popcountll(word));
+        }
+        return total;
+    }
+
+    // In-place set operations; both bitmaps must cover the same rows
+    void intersectWith(const SelectionBitmap& other) {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            m_words[i] &= other.m_words[i];
+        }
+    }
+    void unionWith(const SelectionBitmap& other) {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            m_words[i] |= other.m_words[i];
+        }
+    }
+
+    // Call fn(row) for each set row in ascending order
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            for (uint64_t word = m_words[i]; word != 0; word &= word - 1) {
+                fn(i * 64 + static_cast<size_t>(__builtin_ctzll(word)));
+            }
+        }
+    }
+
+    std::vector<uint32_t> toRows() const {
+        std::vector<uint32_t> rows;
+        rows.reserve(count());
+        forEach([&rows](size_t row) { rows.push_back(static_cast<uint32_t>(row)); });
+        return rows;
+    }
+
+    // Raw words, 64 rows each; bits past size() are always zero
+    std::vector<uint64_t>& words() { return m_words; }
+    const std::vector<uint64_t>& words() const { return m_words; }
+
+    // Clear the bits past size() after writing words() directly
+    void trim() {
+        if (m_size % 64 != 0) {
+            m_words.back() &= (1ULL << (m_size % 64)) - 1;
+        }
+    }
+
+private:
+    std::vector<uint64_t> m_words;
+    size_t m_size;
+};
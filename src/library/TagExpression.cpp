@@ -0,0 +1,238 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TagExpression.cpp
+ * Description: Implementation of the tag expression tokenizer and recursive-descent compiler
+ */
+
+#include "TagExpression.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+bool equalsKeyword(const std::string& word, const char* keyword) {
+    size_t i = 0;
+    for (; keyword[i] != '\0'; ++i) {
+        if (i >= word.size() || std::toupper(static_cast<unsigned char>(word[i])) != keyword[i]) {
+            return false;
+        }
+    }
+    return i == word.size();
+}
+
+} // namespace
+
+TagExpression::TagExpression()
+    : m_next(0)
+    , m_lastErrorCode(ErrorCode::None) {
+    m_program.push_back({OpCode::All, 0});
+}
+
+TagExpression::~TagExpression() = default;
+
+bool TagExpression::compile(const std::string& text) {
+    clearError();
+    m_text = text;
+    m_program.clear();
+    m_tags.clear();
+    m_next = 0;
+
+    bool ok = tokenize(text);
+    if (ok && m_tokens.front().type == TokenType::End) {
+        emit(OpCode::All);
+    } else if (ok) {
+        ok = parseOr(0);
+        if (ok && m_tokens[m_next].type != TokenType::End) {
+            ok = setError(ErrorCode::SyntaxError,
+                          "Unexpected '" + m_tokens[m_next].text + "' at " + std::to_string(m_tokens[m_next].position));
+        }
+    }
+    m_tokens.clear();
+
+    if (!ok) {
+        m_program.clear();
+        m_tags.clear();
+    }
+    return ok;
+}
+
+const std::string& TagExpression::getText() const {
+    return m_text;
+}
+
+const std::vector<TagExpression::Instruction>& TagExpression::getProgram() const {
+    return m_program;
+}
+
+const std::vector<std::string>& TagExpression::getTags() const {
+    return m_tags;
+}
+
+bool TagExpression::isBareTagChar(char c) {
+    const unsigned char u = static_cast<unsigned char>(c);
+    return std::isalnum(u) || u >= 0x80 || c == '-' || c == '_' || c == ':' || c == '.' ||
+           c == '/' || c == '+' || c == '#';
+}
+
+std::string TagExpression::getLastError() const {
+    return m_lastError;
+}
+
+TagExpression::ErrorCode TagExpression::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void TagExpression::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool TagExpression::tokenize(const std::string& text) {
+    m_tokens.clear();
+    size_t i = 0;
+    while (i < text.size()) {
+        const char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+            continue;
+        }
+
+        const size_t start = i;
+        if (c == '(' || c == ')' || c == '!') {
+            m_tokens.push_back({c == '(' ? TokenType::LeftParen : c == ')' ? TokenType::RightParen : TokenType::Not,
+                                std::string(1, c), start});
+            ++i;
+        } else if (c == '&' || c == '|') {
+            // "&&" and "||" are accepted as well
+            i += (i + 1 < text.size() && text[i + 1] == c) ? 2 : 1;
+            m_tokens.push_back({c == '&' ? TokenType::And : TokenType::Or, text.substr(start, i - start), start});
+        } else if (c == '"') {
+            const size_t close = text.find('"', i + 1);
+            if (close == std::string::npos) {
+                return setError(ErrorCode::SyntaxError, "Unterminated quote at " + std::to_string(start));
+            }
+            if (close == i + 1) {
+                return setError(ErrorCode::SyntaxError, "Empty tag at " + std::to_string(start));
+            }
+            m_tokens.push_back({TokenType::Tag, text.substr(i + 1, close - i - 1), start});
+            i = close + 1;
+        } else if (isBareTagChar(c)) {
+            while (i < text.size() && isBareTagChar(text[i])) {
+                ++i;
+            }
+            const std::string word = text.substr(start, i - start);
+            TokenType type = TokenType::Tag;
+            if (equalsKeyword(word, "AND")) {
+                type = TokenType::And;
+            } else if (equalsKeyword(word, "OR")) {
+                type = TokenType::Or;
+            } else if (equalsKeyword(word, "NOT")) {
+                type = TokenType::Not;
+            }
+            m_tokens.push_back({type, word, start});
+        } else {
+            return setError(ErrorCode::SyntaxError,
+                            "Unexpected character '" + std::string(1, c) + "' at " + std::to_string(start));
+        }
+    }
+    m_tokens.push_back({TokenType::End, "end of expression", text.size()});
+    return true;
+}
+
+bool TagExpression::parseOr(int depth) {
+    if (!parseAnd(depth)) {
+        return false;
+    }
+    while (m_tokens[m_next].type == TokenType::Or) {
+        ++m_next;
+        if (!parseAnd(depth)) {
+            return false;
+        }
+        emit(OpCode::Or);
+    }
+    return true;
+}
+
+bool TagExpression::parseAnd(int depth) {
+    if (!parseUnary(depth)) {
+        return false;
+    }
+    for (;;) {
+        const TokenType type = m_tokens[m_next].type;
+        if (type == TokenType::And) {
+            ++m_next;
+        } else if (type != TokenType::Tag && type != TokenType::Not && type != TokenType::LeftParen) {
+            return true;
+        }
+        // Juxtaposed terms are an implicit AND
+        if (!parseUnary(depth)) {
+            return false;
+        }
+        emit(OpCode::And);
+    }
+}
+
+bool TagExpression::parseUnary(int depth) {
+    if (depth >= MAX_DEPTH) {
+        return setError(ErrorCode::TooDeep, "Expression nested deeper than " + std::to_string(MAX_DEPTH));
+    }
+
+    const Token& token = m_tokens[m_next];
+    switch (token.type) {
+    case TokenType::Not:
+        ++m_next;
+        if (!parseUnary(depth + 1)) {
+            return false;
+        }
+        emit(OpCode::Not);
+        return true;
+
+    case TokenType::LeftParen:
+        ++m_next;
+        if (!parseOr(depth + 1)) {
+            return false;
+        }
+        if (m_tokens[m_next].type != TokenType::RightParen) {
+            return setError(ErrorCode::SyntaxError, "Expected ')' at " + std::to_string(m_tokens[m_next].position));
+        }
+        ++m_next;
+        return true;
+
+    case TokenType::Tag: {
+        ++m_next;
+        const auto it = std::find(m_tags.begin(), m_tags.end(), token.text);
+        const uint32_t index = static_cast<uint32_t>(it - m_tags.begin());
+        if (it == m_tags.end()) {
+            m_tags.push_back(token.text);
+        }
+        emit(OpCode::Tag, index);
+        return true;
+    }
+
+    default:
+        return setError(ErrorCode::SyntaxError,
+                        "Expected a tag before '" + token.text + "' at " + std::to_string(token.position));
+    }
+}
+
+void TagExpression::emit(OpCode op, uint32_t operand) {
+    // Peephole rewrites on the operand that was just emitted
+    if (!m_program.empty() && m_program.back().op == OpCode::Not) {
+        if (op == OpCode::Not) {
+            m_program.pop_back();       // NOT NOT x = x
+            return;
+        }
+        if (op == OpCode::And) {
+            m_program.back().op = OpCode::AndNot;
+            return;
+        }
+    }
+    m_program.push_back({op, operand});
+}
+
+bool TagExpression::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
@@ -0,0 +1,100 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TagExpression.h
+ * Description: Boolean tag expressions compiled to a postfix program
+ *
+ * Syntax:
+ * - Tags are bare words (letters, digits and any of - _ : . / + #) or "quoted strings"
+ * - AND / OR / NOT (any case) or & / | / !, with parentheses; adjacent terms are ANDed,
+ *   so "dark winter" means "dark AND winter"
+ * - Precedence: NOT binds tightest, then AND, then OR
+ * - The empty expression matches every file
+ *
+ * Compilation:
+ * - The program is evaluated on a stack of bitmaps (see TagIndex::evaluate)
+ * - "x AND NOT y" compiles to a single AndNot, so the complement of y is never built
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TagExpression {
+public:
+    enum class OpCode : uint8_t {
+        All = 0,        // Push every file
+        Tag,            // Push the files carrying getTags()[operand]
+        Not,            // Replace the top with its complement
+        And,            // Pop b, top = top AND b
+        Or,
+        AndNot          // Pop b, top = top AND NOT b
+    };
+
+    struct Instruction {
+        OpCode op;
+        uint32_t operand;
+    };
+
+    static constexpr int MAX_DEPTH = 64;    // Parenthesis / NOT nesting limit
+
+    TagExpression();
+    ~TagExpression();
+
+    bool compile(const std::string& text);
+
+    const std::string& getText() const;
+    const std::vector<Instruction>& getProgram() const;
+    const std::vector<std::string>& getTags() const;   // Distinct tags referenced
+
+    // Characters allowed in unquoted tags
+    static bool isBareTagChar(char c);
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        SyntaxError = 1,
+        TooDeep = 2
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    enum class TokenType {
+        End,
+        Tag,
+        And,
+        Or,
+        Not,
+        LeftParen,
+        RightParen
+    };
+
+    struct Token {
+        TokenType type;
+        std::string text;
+        size_t position;
+    };
+
+    bool tokenize(const std::string& text);
+    bool parseOr(int depth);
+    bool parseAnd(int depth);
+    bool parseUnary(int depth);
+    void emit(OpCode op, uint32_t operand = 0);
+    bool setError(ErrorCode code, const std::string& message);
+
+    std::string m_text;
+    std::vector<Instruction> m_program;
+    std::vector<std::string> m_tags;
+
+    // Parser state
+    std::vector<Token> m_tokens;
+    size_t m_next;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
@@ -0,0 +1,203 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TagIndex.cpp
+ * Description: Implementation of tag bitmaps, remapping and expression evaluation
+ */
+
+#include "TagIndex.h"
+#include <algorithm>
+
+TagIndex::TagIndex() = default;
+
+TagIndex::~TagIndex() = default;
+
+bool TagIndex::add(const std::string& tag, uint32_t id) {
+    if (!isValidTagName(tag) || id == NO_ID) {
+        return false;
+    }
+    m_tags[tag].add(id);
+    return true;
+}
+
+bool TagIndex::remove(const std::string& tag, uint32_t id) {
+    const auto it = m_tags.find(tag);
+    if (it == m_tags.end() || !it->second.contains(id)) {
+        return false;
+    }
+    it->second.remove(id);
+    if (it->second.empty()) {
+        m_tags.erase(it);
+    }
+    return true;
+}
+
+bool TagIndex::eraseTag(const std::string& tag) {
+    return m_tags.erase(tag) > 0;
+}
+
+void TagIndex::clear() {
+    m_tags.clear();
+}
+
+bool TagIndex::empty() const {
+    return m_tags.empty();
+}
+
+size_t TagIndex::size() const {
+    return m_tags.size();
+}
+
+const RoaringBitmap* TagIndex::find(const std::string& tag) const {
+    const auto it = m_tags.find(tag);
+    return it == m_tags.end() ? nullptr : &it->second;
+}
+
+std::vector<std::string> TagIndex::getTagNames() const {
+    std::vector<std::string> names;
+    names.reserve(m_tags.size());
+    for (const auto& entry : m_tags) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+std::vector<std::string> TagIndex::getTagsOf(uint32_t id) const {
+    std::vector<std::string> names;
+    for (const auto& entry : m_tags) {
+        if (entry.second.contains(id)) {
+            names.push_back(entry.first);
+        }
+    }
+    return names;
+}
+
+void TagIndex::remap(const std::vector<uint32_t>& newIds) {
+    for (auto it = m_tags.begin(); it != m_tags.end();) {
+        RoaringBitmap remapped;
+        it->second.forEach([&](uint32_t id) {
+            if (id < newIds.size() && newIds[id] != NO_ID) {
+                remapped.add(newIds[id]);
+            }
+        });
+        if (remapped.empty()) {
+            it = m_tags.erase(it);
+        } else {
+            it->second = std::move(remapped);
+            ++it;
+        }
+    }
+}
+
+void TagIndex::evaluate(const TagExpression& expression, uint32_t fileCount, RoaringBitmap& result) const {
+    result.clear();
+    const std::vector<TagExpression::Instruction>& program = expression.getProgram();
+    if (program.empty()) {
+        return;     // Failed compile: match nothing
+    }
+
+    // Tags are resolved once; operands are copied onto the stack only when pushed
+    std::vector<const RoaringBitmap*> tags;
+    tags.reserve(expression.getTags().size());
+    for (const std::string& tag : expression.getTags()) {
+        tags.push_back(find(tag));
+    }
+
+    std::vector<RoaringBitmap> stack;
+    stack.reserve(program.size());
+    for (const TagExpression::Instruction& instruction : program) {
+        switch (instruction.op) {
+        case TagExpression::OpCode::All:
+            stack.push_back(RoaringBitmap::range(0, fileCount));
+            break;
+        case TagExpression::OpCode::Tag:
+            stack.push_back(tags[instruction.operand] ? *tags[instruction.operand] : RoaringBitmap());
+            break;
+        case TagExpression::OpCode::Not: {
+            RoaringBitmap complement = RoaringBitmap::range(0, fileCount);
+            complement -= stack.back();
+            stack.back() = std::move(complement);
+            break;
+        }
+        case TagExpression::OpCode::And:
+        case TagExpression::OpCode::Or:
+        case TagExpression::OpCode::AndNot: {
+            RoaringBitmap right = std::move(stack.back());
+            stack.pop_back();
+            if (instruction.op == TagExpression::OpCode::And) {
+                stack.back() &= right;
+            } else if (instruction.op == TagExpression::OpCode::Or) {
+                stack.back() |= right;
+            } else {
+                stack.back() -= right;
+            }
+            break;
+        }
+        }
+    }
+    result = std::move(stack.back());
+}
+
+bool TagIndex::isValidTagName(const std::string& tag) {
+    if (tag.empty() || tag.size() > MAX_TAG_LENGTH) {
+        return false;
+    }
+    return std::none_of(tag.begin(), tag.end(), [](char c) {
+        return c == '"' || static_cast<unsigned char>(c) < 0x20 || c == 0x7F;
+    });
+}
+
+void TagIndex::serialize(std::vector<uint8_t>& out) const {
+    auto putU32 = [&out](uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    };
+    putU32(static_cast<uint32_t>(m_tags.size()));
+    for (const auto& entry : m_tags) {
+        putU32(static_cast<uint32_t>(entry.first.size()));
+        out.insert(out.end(), entry.first.begin(), entry.first.end());
+        entry.second.serialize(out);
+    }
+}
+
+bool TagIndex::deserialize(const uint8_t* data, size_t size, uint32_t fileCount, size_t& consumed) {
+    consumed = 0;
+    auto getU32 = [data, size](size_t offset, uint32_t& value) {
+        if (size < 4 || offset > size - 4) {
+            return false;
+        }
+        value = static_cast<uint32_t>(data[offset]) | static_cast<uint32_t>(data[offset + 1]) << 8 |
+                static_cast<uint32_t>(data[offset + 2]) << 16 | static_cast<uint32_t>(data[offset + 3]) << 24;
+        return true;
+    };
+
+    uint32_t count = 0;
+    if (!getU32(0, count)) {
+        return false;
+    }
+    size_t offset = 4;
+
+    std::map<std::string, RoaringBitmap> tags;
+    for (uint32_t t = 0; t < count; ++t) {
+        uint32_t length = 0;
+        if (!getU32(offset, length) || length > size - offset - 4) {
+            return false;
+        }
+        offset += 4;
+        std::string name(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+
+        RoaringBitmap bitmap;
+        size_t used = 0;
+        if (!isValidTagName(name) || !bitmap.deserialize(data + offset, size - offset, used) ||
+            bitmap.empty() || bitmap.maximum() >= fileCount || !tags.emplace(std::move(name), std::move(bitmap)).second) {
+            return false;
+        }
+        offset += used;
+    }
+
+    m_tags = std::move(tags);
+    consumed = offset;
+    return true;
+}
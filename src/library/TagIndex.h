@@ -0,0 +1,60 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TagIndex.h
+ * Description: Tag name -> RoaringBitmap of library file ids, with expression evaluation
+ *
+ * Strategy:
+ * - Each tag owns one compressed bitmap over file ids; a tag exists while at least one
+ *   file carries it
+ * - Expressions run their postfix program on a small stack of bitmaps; NOT is taken
+ *   against the universe [0, fileCount), and AND NOT subtracts directly
+ * - Ids follow the library file table: remap() is applied whenever the table compacts
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "RoaringBitmap.h"
+#include "TagExpression.h"
+
+class TagIndex {
+public:
+    static constexpr uint32_t NO_ID = UINT32_MAX;
+    static constexpr size_t MAX_TAG_LENGTH = 256;
+
+    TagIndex();
+    ~TagIndex();
+
+    // Returns false for invalid names; adding an existing pair is a no-op
+    bool add(const std::string& tag, uint32_t id);
+    bool remove(const std::string& tag, uint32_t id);
+    bool eraseTag(const std::string& tag);
+    void clear();
+
+    bool empty() const;
+    size_t size() const;                                    // Number of tags
+    const RoaringBitmap* find(const std::string& tag) const;
+    std::vector<std::string> getTagNames() const;           // Sorted
+    std::vector<std::string> getTagsOf(uint32_t id) const;  // Sorted
+
+    // newIds[old] is the new id of `old`, or NO_ID to drop it
+    void remap(const std::vector<uint32_t>& newIds);
+
+    // Files in [0, fileCount) matching the expression; unknown tags match nothing
+    void evaluate(const TagExpression& expression, uint32_t fileCount, RoaringBitmap& result) const;
+
+    // Non-empty, at most MAX_TAG_LENGTH bytes, no quotes or control characters
+    static bool isValidTagName(const std::string& tag);
+
+    void serialize(std::vector<uint8_t>& out) const;
+    // Rejects bitmaps holding ids >= fileCount
+    bool deserialize(const uint8_t* data, size_t size, uint32_t fileCount, size_t& consumed);
+
+private:
+    std::map<std::string, RoaringBitmap> m_tags;
+};
@@ -0,0 +1,229 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ThumbnailCache.cpp
+ * Description: Implementation of the asynchronous thumbnail LRU
+ */
+
+#include "ThumbnailCache.h"
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "../imaging/ImageDecoder.h"
+#include "../imaging/ImageProbe.h"
+#include "../imaging/Resampler.h"
+#include "../utils/TaskScheduler.h"
+
+struct ThumbnailCache::Shared {
+    enum class State {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    struct Entry {
+        int64_t modified = 0;
+        State state = State::Pending;
+        bool started = false;
+        uint64_t ticket = 0;
+        std::shared_ptr<const Thumbnail> thumbnail;
+        std::list<std::string>::iterator recent;    // Valid while Ready
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> recent;                  // Ready entries, most recently requested first
+    std::vector<std::string> completed;
+    uint64_t nextTicket = 0;
+    int side = DEFAULT_SIDE;
+    size_t budgetBytes = DEFAULT_BUDGET_BYTES;
+    Stats stats;
+
+    static size_t bytesOf(const Entry& entry) {
+        return entry.thumbnail ? entry.thumbnail->image.pixels.size() : 0;
+    }
+
+    void erase(std::unordered_map<std::string, Entry>::iterator it) {
+        if (it->second.state == State::Ready) {
+            stats.residentBytes -= bytesOf(it->second);
+            recent.erase(it->second.recent);
+        }
+        entries.erase(it);
+    }
+
+    // Evict from the cold end; the newest thumbnail stays even if it alone exceeds the budget
+    void evict() {
+        while (stats.residentBytes > budgetBytes && recent.size() > 1) {
+            erase(entries.find(recent.back()));
+            ++stats.evictions;
+        }
+    }
+};
+
+ThumbnailCache::ThumbnailCache(TaskScheduler& scheduler, int side, size_t budgetBytes)
+    : m_scheduler(scheduler)
+    , m_shared(std::make_shared<Shared>()) {
+    m_shared->side = std::max(1, side);
+    m_shared->budgetBytes = budgetBytes;
+}
+
+ThumbnailCache::~ThumbnailCache() {
+    clear();
+}
+
+std::shared_ptr<const Thumbnail> ThumbnailCache::request(const std::string& path, int64_t modified,
+                                                         const std::string& contentKey) {
+    const std::string key = cacheKey(path, contentKey);
+    if (!contentKey.empty()) {
+        modified = 0;
+    }
+    uint64_t ticket;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        auto it = m_shared->entries.find(key);
+        if (it != m_shared->entries.end() && it->second.modified != modified) {
+            // The file changed on disk; a decode still in flight is discarded by its ticket
+            m_shared->erase(it);
+            it = m_shared->entries.end();
+        }
+        if (it != m_shared->entries.end()) {
+            Shared::Entry& entry = it->second;
+            if (entry.state != Shared::State::Ready) {
+                return nullptr;
+            }
+            ++m_shared->stats.hits;
+            m_shared->recent.splice(m_shared->recent.begin(), m_shared->recent, entry.recent);
+            return entry.thumbnail;
+        }
+
+        ++m_shared->stats.misses;
+        Shared::Entry& entry = m_shared->entries[key];
+        entry.modified = modified;
+        entry.ticket = ticket = ++m_shared->nextTicket;
+    }
+
+    std::shared_ptr<Shared> shared = m_shared;
+    m_scheduler.submit(IoClass::Interactive, [shared, key, path, ticket]() {
+        decode(shared, key, path, ticket);
+    });
+    return nullptr;
+}
+
+const std::string& ThumbnailCache::cacheKey(const std::string& path, const std::string& contentKey) {
+    return contentKey.empty() ? path : contentKey;
+}
+
+bool ThumbnailCache::hasFailed(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    const auto it = m_shared->entries.find(key);
+    return it != m_shared->entries.end() && it->second.state == Shared::State::Failed;
+}
+
+std::vector<std::string> ThumbnailCache::takeCompleted() {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    std::vector<std::string> completed;
+    completed.swap(m_shared->completed);
+    return completed;
+}
+
+void ThumbnailCache::cancelPending() {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    for (auto it = m_shared->entries.begin(); it != m_shared->entries.end();) {
+        if (it->second.state == Shared::State::Pending && !it->second.started) {
+            it = m_shared->entries.erase(it);
+            ++m_shared->stats.cancelled;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ThumbnailCache::clear() {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->entries.clear();
+    m_shared->recent.clear();
+    m_shared->completed.clear();
+    m_shared->stats.residentBytes = 0;
+}
+
+void ThumbnailCache::setBudget(size_t budgetBytes) {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->budgetBytes = budgetBytes;
+    m_shared->evict();
+}
+
+int ThumbnailCache::getSide() const {
+    return m_shared->side;
+}
+
+ThumbnailCache::Stats ThumbnailCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    Stats stats = m_shared->stats;
+    stats.entries = m_shared->recent.size();
+    return stats;
+}
+
+bool ThumbnailCache::render(const std::string& path, int side, Thumbnail& thumbnail) {
+    // Decoders and resampler are per call: callers run concurrently on the scheduler's workers
+    ImageProbe probe;
+    ImageHeader header;
+    const bool probed = probe.probeFile(path, header);
+    const ImageOrientation orientation = probed ? header.orientation : ImageOrientation::Normal;
+    if (probed) {
+        thumbnail.sourceWidth = header.displayWidth();
+        thumbnail.sourceHeight = header.displayHeight();
+    }
+
+    ImageDecoder decoder;
+    ImageBuffer decoded;
+    if (!decoder.decodePreviewFile(path, decoded, 4) || decoded.empty()) {
+        return false;
+    }
+    const bool swap = orientationSwapsAxes(orientation);
+    const int width = swap ? decoded.height : decoded.width;
+    const int height = swap ? decoded.width : decoded.height;
+    const double scale = std::min(1.0, static_cast<double>(side) / std::max(width, height));
+    const int targetWidth = std::max(1, static_cast<int>(std::lround(width * scale)));
+    const int targetHeight = std::max(1, static_cast<int>(std::lround(height * scale)));
+    Resampler resampler;
+    return resampler.resample(decoded, orientation, thumbnail.image, targetWidth, targetHeight, Resampler::Filter::Box);
+}
+
+void ThumbnailCache::decode(const std::shared_ptr<Shared>& shared, const std::string& key, const std::string& path,
+                            uint64_t ticket) {
+    int side;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        const auto it = shared->entries.find(key);
+        if (it == shared->entries.end() || it->second.ticket != ticket) {
+            return;     // Cancelled, cleared or superseded before this task started
+        }
+        it->second.started = true;
+        side = shared->side;
+    }
+
+    auto thumbnail = std::make_shared<Thumbnail>();
+    const bool success = render(path, side, *thumbnail);
+
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    const auto it = shared->entries.find(key);
+    if (it == shared->entries.end() || it->second.ticket != ticket) {
+        return;
+    }
+    Shared::Entry& entry = it->second;
+    if (success) {
+        entry.state = Shared::State::Ready;
+        entry.thumbnail = std::move(thumbnail);
+        shared->recent.push_front(key);
+        entry.recent = shared->recent.begin();
+        shared->stats.residentBytes += Shared::bytesOf(entry);
+        ++shared->stats.decoded;
+        shared->evict();
+    } else {
+        entry.state = Shared::State::Failed;
+        ++shared->stats.failures;
+    }
+    shared->completed.push_back(key);
+}
@@ -0,0 +1,96 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: ThumbnailCache.h
+ * Description: Byte-budgeted LRU of small RGBA thumbnails decoded on a TaskScheduler
+ *
+ * Strategy:
+ * - request() never decodes: a hit returns the thumbnail, a miss queues one Interactive
+ *   task and returns null, so a gallery can ask for every visible cell each frame
+ * - JPEGs use the 1/8-scale DC preview (a 4K wallpaper decodes to 480x270 from the first
+ *   256 KiB of the file), other formats a full decode; either is box-filtered to fit
+ *   within `side` pixels with EXIF orientation applied
+ * - Entries are keyed by the caller's content key when it has one (LibraryIndex::getContentKey),
+ *   so exact duplicates share one decode and one thumbnail; otherwise by path, invalidated
+ *   when the caller's mtime changes. The least recently requested thumbnails are dropped
+ *   once the byte budget is exceeded
+ * - cancelPending() forgets queued decodes that have not started, so scrolling or leaving
+ *   a directory does not leave the workers busy with cells nobody is looking at
+ * - takeCompleted() reports newly decoded keys so the UI uploads each texture once
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../imaging/ImageBuffer.h"
+
+class TaskScheduler;
+
+struct Thumbnail {
+    ImageBuffer image;          // RGBA, fits within side x side
+    int sourceWidth = 0;        // Displayed size of the full image (0 when unknown)
+    int sourceHeight = 0;
+};
+
+class ThumbnailCache {
+public:
+    static constexpr int DEFAULT_SIDE = 160;
+    static constexpr size_t DEFAULT_BUDGET_BYTES = 64 * 1024 * 1024;
+
+    explicit ThumbnailCache(TaskScheduler& scheduler, int side = DEFAULT_SIDE,
+                            size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+    ~ThumbnailCache();
+
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    // Ready thumbnail, or null while it is being decoded or when the file cannot be decoded.
+    // A non-empty `contentKey` names the file's bytes: any path with that key shares the
+    // entry, and `modified` is ignored since new content comes with a new key
+    std::shared_ptr<const Thumbnail> request(const std::string& path, int64_t modified = 0,
+                                             const std::string& contentKey = std::string());
+
+    // Entry key of a request: the content key when there is one, else the path
+    static const std::string& cacheKey(const std::string& path, const std::string& contentKey);
+
+    // The decode a queued request runs: orientation applied, fitted within `side`; blocking
+    static bool render(const std::string& path, int side, Thumbnail& thumbnail);
+
+    // Whether the decode for a cacheKey() failed (the UI shows a placeholder instead of waiting)
+    bool hasFailed(const std::string& key) const;
+
+    // cacheKey()s whose decode finished (or failed) since the last call
+    std::vector<std::string> takeCompleted();
+
+    // Drop queued decodes that have not started yet
+    void cancelPending();
+
+    void clear();
+    void setBudget(size_t budgetBytes);
+    int getSide() const;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t decoded = 0;
+        uint64_t failures = 0;
+        uint64_t evictions = 0;
+        uint64_t cancelled = 0;
+        size_t residentBytes = 0;
+        size_t entries = 0;
+    };
+    Stats getStats() const;
+
+private:
+    struct Shared;
+
+    static void decode(const std::shared_ptr<Shared>& shared, const std::string& key, const std::string& path,
+                       uint64_t ticket);
+
+    TaskScheduler& m_scheduler;
+    std::shared_ptr<Shared> m_shared;
+};
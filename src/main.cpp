@@ -5,13 +5,200 @@
  * Description: Main entry point for Caithe Wallpaper Manager - A modern wallpaper manager for Hyprland
  */
 
+#include <csignal>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "core/TraceReplay.h"
+#include "daemon/ControlClient.h"
+#include "daemon/StateSegment.h"
+#include "daemon/WallpaperDaemon.h"
 #include "ui/Application.h"
 
+// caithe --replay TRACE [--speed N] [--socket PATH] [--delay-ms N]
+// Replays a recorded trace headless, against a stand-in hyprpaper unless --socket names one
+static int runReplay(const std::vector<std::string>& args) {
+    std::string tracePath;
+    std::string socketPath;
+    double speed = 1.0;
+    int delayMs = 0;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const bool hasValue = i + 1 < args.size();
+        if (args[i] == "--replay" && hasValue) {
+            tracePath = args[++i];
+        } else if (args[i] == "--speed" && hasValue) {
+            speed = std::stod(args[++i]);
+        } else if (args[i] == "--socket" && hasValue) {
+            socketPath = args[++i];
+        } else if (args[i] == "--delay-ms" && hasValue) {
+            delayMs = std::stoi(args[++i]);
+        } else {
+            std::cerr << "Usage: caithe --replay TRACE [--speed N] [--socket PATH] [--delay-ms N]" << std::endl;
+            return 2;
+        }
+    }
+
+    OperationTrace trace;
+    std::vector<TraceEvent> events;
+    if (!trace.load(tracePath, events)) {
+        std::cerr << trace.getLastError() << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<HyprpaperStandIn> standIn;
+    if (socketPath.empty()) {
+        socketPath = "/tmp/caithe-replay-" + std::to_string(::getpid()) + ".sock";
+        standIn = std::make_unique<HyprpaperStandIn>(socketPath);
+        if (!standIn->isListening()) {
+            std::cerr << "Cannot listen on " << socketPath << std::endl;
+            return 1;
+        }
+        standIn->setReplyDelay(std::chrono::milliseconds(delayMs));
+    }
+
+    HyprpaperReplayTarget target(socketPath);
+    ConfigManager config;
+    if (config.loadConfig()) {
+        for (const auto& [workspace, path] : config.getConfig().workspaceWallpapers) {
+            target.setWorkspaceWallpaper(workspace, path);
+        }
+    }
+    TraceReplayer replayer;
+    target.install(replayer);
+
+    std::cout << "Replaying " << events.size() << " operations from " << tracePath << " at "
+              << (speed > 0.0 ? std::to_string(speed) + "x" : std::string("full speed")) << std::endl;
+    std::cout << replayer.replay(events, speed).describe();
+    return 0;
+}
+
+// caithe --daemon [--upgrade] [--socket PATH] [--hyprpaper PATH]
+// Serves the control socket headless until SIGINT or SIGTERM, or until a newer binary
+// started with --upgrade takes the socket, its clients and the wallpaper state over
+static int runDaemon(const std::vector<std::string>& args) {
+    std::string socketPath;
+    std::string hyprpaperPath;
+    bool upgrade = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        const bool hasValue = i + 1 < args.size();
+        if (args[i] == "--socket" && hasValue) {
+            socketPath = args[++i];
+        } else if (args[i] == "--hyprpaper" && hasValue) {
+            hyprpaperPath = args[++i];
+        } else if (args[i] == "--upgrade") {
+            upgrade = true;
+        } else {
+            std::cerr << "Usage: caithe --daemon [--upgrade] [--socket PATH] [--hyprpaper PATH]" << std::endl;
+            return 2;
+        }
+    }
+
+    // Block the signals before any thread starts so only sigwait sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    WallpaperDaemon daemon;
+    daemon.setBackendSocket(hyprpaperPath);
+    if (!(upgrade ? daemon.takeOver(socketPath) : daemon.start(socketPath))) {
+        std::cerr << daemon.getLastError() << std::endl;
+        return 1;
+    }
+    std::cout << (upgrade ? "Took over " : "Serving ") << daemon.getSocketPath() << std::endl;
+    const timespec tick{ 0, 200 * 1000 * 1000 };
+    // Wake periodically: a handoff stops the daemon from inside, without a signal
+    while (daemon.isRunning()) {
+        if (sigtimedwait(&signals, nullptr, &tick) > 0) {
+            break;
+        }
+    }
+    if (daemon.hasHandedOff()) {
+        std::cout << "Handed " << daemon.getSocketPath() << " to the upgraded daemon" << std::endl;
+    }
+    daemon.stop();
+    return 0;
+}
+
+// caithe --status [--follow] [--socket PATH]
+// One line per change of the daemon's wallpapers, for status bars. Reads the shared state
+// segment, so --follow only checks its sequence number between updates and never polls the socket
+static int runStatus(const std::vector<std::string>& args) {
+    std::string socketPath;
+    bool follow = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        const bool hasValue = i + 1 < args.size();
+        if (args[i] == "--socket" && hasValue) {
+            socketPath = args[++i];
+        } else if (args[i] == "--follow") {
+            follow = true;
+        } else {
+            std::cerr << "Usage: caithe --status [--follow] [--socket PATH]" << std::endl;
+            return 2;
+        }
+    }
+
+    ControlClient client;
+    StateSegment segment;
+    if (!client.connect(socketPath) || !client.attachState(segment)) {
+        std::cerr << client.getLastError() << std::endl;
+        return 1;
+    }
+    uint64_t checked = 0;
+    bool printed = false;
+    uint64_t printedGeneration = 0;
+    for (;;) {
+        const uint64_t sequence = segment.getSequence();
+        if (!printed || sequence != checked) {
+            StateSegment::Snapshot snapshot;
+            if (segment.read(snapshot)) {
+                checked = snapshot.sequence;
+                if (!printed || snapshot.generation != printedGeneration) {
+                    std::string line;
+                    for (const StateSegment::Assignment& assignment : snapshot.assignments) {
+                        line += (line.empty() ? "" : "  ") + assignment.monitor + " " +
+                                assignment.path.substr(assignment.path.rfind('/') + 1) + " (" + assignment.mode + ")";
+                    }
+                    std::cout << (line.empty() ? "No wallpaper" : line) << std::endl;
+                    printed = true;
+                    printedGeneration = snapshot.generation;
+                }
+            } else if (follow && segment.getLastErrorCode() == StateSegment::ErrorCode::Retired) {
+                // Upgraded or restarted: the daemon now on the socket has a segment of its own
+                if (client.connect(socketPath) && client.attachState(segment)) {
+                    printed = false;
+                    continue;
+                }
+            } else {
+                std::cerr << segment.getLastError() << std::endl;
+                return 1;
+            }
+        }
+        if (!follow) {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+}
+
 int main(int argc, char** argv) {
     try {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+        if (!args.empty() && args.front() == "--replay") {
+            return runReplay(args);
+        }
+        if (!args.empty() && args.front() == "--daemon") {
+            return runDaemon(args);
+        }
+        if (!args.empty() && args.front() == "--status") {
+            return runStatus(args);
+        }
+
         // Create and run the wallpaper manager application
         auto app = std::make_unique<Application>();
         return app->run();
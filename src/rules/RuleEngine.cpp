@@ -0,0 +1,460 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: RuleEngine.cpp
+ * Description: Implementation of rule compilation into masks and the per-event evaluation
+ */
+
+#include "RuleEngine.h"
+#include <algorithm>
+#include <cctype>
+#include "../library/LibraryIndex.h"
+#include "../library/SelectionBitmap.h"
+#include "../utils/PowerPolicy.h"
+#include "../utils/Xxh64.h"
+
+namespace {
+
+constexpr uint8_t ALL_DAYS = 0x7f;
+
+const char* const DAY_NAMES[7] = {"monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"};
+
+std::string trim(const std::string& text) {
+    const size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+std::string lower(std::string text) {
+    for (char& c : text) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+// "mon", "monday" -> 0; -1 when unknown
+int parseDay(const std::string& text) {
+    if (text.size() < 3) {
+        return -1;
+    }
+    for (int d = 0; d < 7; ++d) {
+        const std::string name = DAY_NAMES[d];
+        if (name.compare(0, text.size(), text) == 0) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+// "7", "07:30", "24:00" -> minute of day; -1 when malformed
+int parseTime(const std::string& text) {
+    const size_t colon = text.find(':');
+    const std::string hourText = text.substr(0, colon);
+    const std::string minuteText = colon == std::string::npos ? "0" : text.substr(colon + 1);
+    auto digits = [](const std::string& part) {
+        return !part.empty() && part.size() <= 2 &&
+               std::all_of(part.begin(), part.end(), [](char c) { return c >= '0' && c <= '9'; });
+    };
+    if (!digits(hourText) || !digits(minuteText)) {
+        return -1;
+    }
+    const int hour = std::stoi(hourText);
+    const int minute = std::stoi(minuteText);
+    if (minute > 59 || hour > 24 || (hour == 24 && minute != 0)) {
+        return -1;
+    }
+    return hour * 60 + minute;
+}
+
+} // namespace
+
+int RuleContext::minuteOfWeekAt(std::time_t time) {
+    std::tm local{};
+    localtime_r(&time, &local);
+    const int day = (local.tm_wday + 6) % 7;    // tm_wday counts from Sunday
+    return day * RuleEngine::MINUTES_PER_DAY + local.tm_hour * 60 + local.tm_min;
+}
+
+PowerSource RuleContext::detectPowerSource(const std::string& root) {
+    SystemState state;
+    PowerPolicy::readPowerSupply(root, state);
+    return state.onBattery ? PowerSource::Battery : PowerSource::AC;
+}
+
+RuleEngine::RuleEngine()
+    : m_powerMasks{0, 0}
+    , m_everyOutput(0)
+    , m_hasLast(false)
+    , m_lastSegment(0)
+    , m_lastPower(PowerSource::AC)
+    , m_lastErrorCode(ErrorCode::None) {
+    clear();
+}
+
+RuleEngine::~RuleEngine() = default;
+
+bool RuleEngine::compile(const std::vector<RuleConfig>& rules) {
+    clear();
+    clearError();
+    if (rules.size() > MAX_RULES) {
+        return setError(ErrorCode::TooManyRules, "At most " + std::to_string(MAX_RULES) + " rules are supported");
+    }
+
+    // Half-open [start, end) intervals in minutes of the week, per rule
+    std::vector<std::vector<std::pair<int, int>>> intervals(rules.size());
+    std::vector<int> boundaries = {0};
+    std::vector<CompiledRule> compiled(rules.size());
+
+    for (size_t r = 0; r < rules.size(); ++r) {
+        const RuleConfig& rule = rules[r];
+        const uint64_t bit = 1ULL << r;
+        const std::string label = rule.name.empty() ? "rule " + std::to_string(r + 1) : "rule '" + rule.name + "'";
+
+        uint8_t days = 0;
+        if (!parseDays(rule.days, days)) {
+            clear();
+            return setError(ErrorCode::InvalidDays, "Invalid days in " + label + ": " + rule.days);
+        }
+        int start = 0;
+        int end = 0;
+        if (!parseHours(rule.hours, start, end)) {
+            clear();
+            return setError(ErrorCode::InvalidHours, "Invalid hours in " + label + ": " + rule.hours);
+        }
+        for (int d = 0; d < 7; ++d) {
+            if (!(days & (1 << d))) {
+                continue;
+            }
+            // A window that ends before it starts runs past midnight into the next day
+            const int from = d * MINUTES_PER_DAY + start;
+            const int to = d * MINUTES_PER_DAY + (end > start ? end : end + MINUTES_PER_DAY);
+            if (to <= MINUTES_PER_WEEK) {
+                intervals[r].push_back({from, to});
+            } else {
+                intervals[r].push_back({from, MINUTES_PER_WEEK});
+                intervals[r].push_back({0, to - MINUTES_PER_WEEK});
+            }
+        }
+        for (const auto& interval : intervals[r]) {
+            boundaries.push_back(interval.first);
+            boundaries.push_back(interval.second);
+        }
+
+        const std::string power = lower(trim(rule.power));
+        if (power.empty() || power == "any") {
+            m_powerMasks[0] |= bit;
+            m_powerMasks[1] |= bit;
+        } else if (power == "ac") {
+            m_powerMasks[static_cast<int>(PowerSource::AC)] |= bit;
+        } else if (power == "battery") {
+            m_powerMasks[static_cast<int>(PowerSource::Battery)] |= bit;
+        } else {
+            clear();
+            return setError(ErrorCode::InvalidPower, "Invalid power source in " + label + ": " + rule.power);
+        }
+
+        for (const std::string& display : rule.displays) {
+            if (!display.empty() && display[0] == '!') {
+                m_needsAbsent[display.substr(1)] |= bit;
+            } else {
+                m_needsPresent[display] |= bit;
+            }
+        }
+        if (rule.outputs.empty()) {
+            m_everyOutput |= bit;
+        }
+        for (const std::string& output : rule.outputs) {
+            m_targets[output] |= bit;
+        }
+
+        CompiledRule& target = compiled[r];
+        target.name = rule.name;
+        if (rule.wallpaper.empty() == rule.tags.empty()) {
+            clear();
+            return setError(ErrorCode::InvalidAction, label + " needs exactly one of a wallpaper or tags");
+        }
+        target.wallpaper = rule.wallpaper;
+        if (!rule.tags.empty()) {
+            if (!target.tags.compile(rule.tags)) {
+                const std::string message = target.tags.getLastError();
+                clear();
+                return setError(ErrorCode::InvalidTags, "Invalid tags in " + label + ": " + message);
+            }
+            target.usesTags = true;
+        }
+    }
+
+    // Decision table: the active rules at each boundary hold until the next one
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+    boundaries.erase(std::lower_bound(boundaries.begin(), boundaries.end(), MINUTES_PER_WEEK), boundaries.end());
+    for (int boundary : boundaries) {
+        uint64_t mask = 0;
+        for (size_t r = 0; r < rules.size(); ++r) {
+            for (const auto& interval : intervals[r]) {
+                if (boundary >= interval.first && boundary < interval.second) {
+                    mask |= 1ULL << r;
+                    break;
+                }
+            }
+        }
+        if (m_segmentMasks.empty() || mask != m_segmentMasks.back()) {
+            m_segmentStarts.push_back(boundary);
+            m_segmentMasks.push_back(mask);
+        }
+    }
+
+    m_rules = std::move(compiled);
+    return true;
+}
+
+void RuleEngine::clear() {
+    m_rules.clear();
+    m_segmentStarts.clear();
+    m_segmentMasks.clear();
+    m_powerMasks[0] = 0;
+    m_powerMasks[1] = 0;
+    m_needsPresent.clear();
+    m_needsAbsent.clear();
+    m_targets.clear();
+    m_everyOutput = 0;
+    resetApplied();
+}
+
+const std::vector<CompiledRule>& RuleEngine::getRules() const {
+    return m_rules;
+}
+
+size_t RuleEngine::getRuleCount() const {
+    return m_rules.size();
+}
+
+int RuleEngine::select(const RuleContext& context, const std::string& output) const {
+    if (m_rules.empty()) {
+        return NO_RULE;
+    }
+    const uint64_t mask = contextMask(segmentAt(context.minuteOfWeek), context) & targetMask(output);
+    return mask ? __builtin_ctzll(mask) : NO_RULE;
+}
+
+int RuleEngine::minutesUntilChange(int minuteOfWeek) const {
+    if (m_segmentStarts.size() < 2) {
+        return MINUTES_PER_WEEK;
+    }
+    minuteOfWeek = ((minuteOfWeek % MINUTES_PER_WEEK) + MINUTES_PER_WEEK) % MINUTES_PER_WEEK;
+
+    // Adjacent segments always differ, except across the end of the week
+    const size_t segment = segmentAt(minuteOfWeek);
+    size_t next = segment + 1;
+    int offset = 0;
+    if (next == m_segmentStarts.size()) {
+        next = m_segmentMasks.front() == m_segmentMasks.back() ? 1 : 0;
+        offset = MINUTES_PER_WEEK;
+    }
+    return m_segmentStarts[next] + offset - minuteOfWeek;
+}
+
+std::vector<RuleChange> RuleEngine::upcoming(const RuleContext& context, int& minutes) const {
+    std::vector<RuleChange> changes;
+    minutes = minutesUntilChange(context.minuteOfWeek);
+    if (m_rules.empty() || minutes >= MINUTES_PER_WEEK) {
+        return changes;
+    }
+
+    RuleContext next = context;
+    next.minuteOfWeek = (context.minuteOfWeek + minutes) % MINUTES_PER_WEEK;
+    for (const std::string& output : context.outputs) {
+        const int rule = select(next, output);
+        if (rule != NO_RULE && rule != select(context, output) && !m_rules[rule].wallpaper.empty()) {
+            changes.push_back({output, rule, m_rules[rule].wallpaper});
+        }
+    }
+    return changes;
+}
+
+std::vector<RuleChange> RuleEngine::update(const RuleContext& context, const ImageResolver& resolver) {
+    std::vector<RuleChange> changes;
+    if (m_rules.empty()) {
+        return changes;
+    }
+
+    std::vector<std::string> outputs = context.outputs;
+    std::sort(outputs.begin(), outputs.end());
+    outputs.erase(std::unique(outputs.begin(), outputs.end()), outputs.end());
+    const size_t segment = segmentAt(context.minuteOfWeek);
+    if (m_hasLast && segment == m_lastSegment && context.power == m_lastPower && outputs == m_lastOutputs) {
+        return changes;
+    }
+    m_hasLast = true;
+    m_lastSegment = segment;
+    m_lastPower = context.power;
+
+    // Disconnected outputs get a fresh pick when they return
+    for (auto it = m_applied.begin(); it != m_applied.end();) {
+        it = std::binary_search(outputs.begin(), outputs.end(), it->first) ? std::next(it) : m_applied.erase(it);
+    }
+
+    const uint64_t active = contextMask(segment, context);
+    for (const std::string& output : outputs) {
+        // First matching rule that yields an image; an empty tag set falls through
+        std::string image;
+        int rule = NO_RULE;
+        for (uint64_t mask = active & targetMask(output); mask != 0 && image.empty(); mask &= mask - 1) {
+            rule = __builtin_ctzll(mask);
+            image = resolver ? resolver(m_rules[rule], output) : m_rules[rule].wallpaper;
+        }
+        if (image.empty()) {
+            m_applied.erase(output);
+            continue;
+        }
+        auto applied = m_applied.find(output);
+        if (applied != m_applied.end() && applied->second == image) {
+            continue;
+        }
+        m_applied[output] = image;
+        changes.push_back({output, rule, std::move(image)});
+    }
+    m_lastOutputs = std::move(outputs);
+    return changes;
+}
+
+void RuleEngine::resetApplied() {
+    m_hasLast = false;
+    m_lastOutputs.clear();
+    m_applied.clear();
+}
+
+std::string RuleEngine::pickTagged(const LibraryIndex& library, const TagExpression& tags, const std::string& output) {
+    SelectionBitmap selection;
+    library.selectTagged(tags, selection);
+    const size_t count = selection.count();
+    if (count == 0) {
+        return std::string();
+    }
+
+    // Find the n-th set row, skipping whole words by popcount
+    size_t remaining = Xxh64::hash(output.data(), output.size()) % count;
+    const std::vector<uint64_t>& words = selection.words();
+    for (size_t i = 0; i < words.size(); ++i) {
+        const size_t bits = static_cast<size_t>(__builtin_popcountll(words[i]));
+        if (remaining >= bits) {
+            remaining -= bits;
+            continue;
+        }
+        uint64_t word = words[i];
+        for (; remaining > 0; --remaining) {
+            word &= word - 1;
+        }
+        return library.getFiles()[i * 64 + static_cast<size_t>(__builtin_ctzll(word))].path;
+    }
+    return std::string();
+}
+
+size_t RuleEngine::segmentAt(int minuteOfWeek) const {
+    if (m_segmentStarts.empty()) {
+        return 0;
+    }
+    minuteOfWeek = ((minuteOfWeek % MINUTES_PER_WEEK) + MINUTES_PER_WEEK) % MINUTES_PER_WEEK;
+    return static_cast<size_t>(std::upper_bound(m_segmentStarts.begin(), m_segmentStarts.end(), minuteOfWeek) -
+                               m_segmentStarts.begin()) - 1;
+}
+
+uint64_t RuleEngine::contextMask(size_t segment, const RuleContext& context) const {
+    uint64_t mask = m_segmentMasks[segment] & m_powerMasks[static_cast<int>(context.power)];
+    auto connected = [&context](const std::string& name) {
+        return std::find(context.outputs.begin(), context.outputs.end(), name) != context.outputs.end();
+    };
+    for (const auto& entry : m_needsPresent) {
+        if (!connected(entry.first)) {
+            mask &= ~entry.second;
+        }
+    }
+    for (const auto& entry : m_needsAbsent) {
+        if (connected(entry.first)) {
+            mask &= ~entry.second;
+        }
+    }
+    return mask;
+}
+
+uint64_t RuleEngine::targetMask(const std::string& output) const {
+    auto it = m_targets.find(output);
+    return m_everyOutput | (it != m_targets.end() ? it->second : 0);
+}
+
+bool RuleEngine::parseDays(const std::string& text, uint8_t& days) {
+    const std::string spec = lower(trim(text));
+    if (spec.empty() || spec == "*" || spec == "daily") {
+        days = ALL_DAYS;
+        return true;
+    }
+
+    days = 0;
+    size_t position = 0;
+    while (position <= spec.size()) {
+        const size_t comma = std::min(spec.find(',', position), spec.size());
+        const std::string token = trim(spec.substr(position, comma - position));
+        position = comma + 1;
+
+        if (token == "weekdays") {
+            days |= 0x1f;
+            continue;
+        }
+        if (token == "weekends") {
+            days |= 0x60;
+            continue;
+        }
+        const size_t dash = token.find('-');
+        const int first = parseDay(trim(token.substr(0, dash)));
+        const int last = dash == std::string::npos ? first : parseDay(trim(token.substr(dash + 1)));
+        if (first < 0 || last < 0) {
+            return false;
+        }
+        // Ranges may wrap: "fri-mon"
+        for (int d = first;; d = (d + 1) % 7) {
+            days |= static_cast<uint8_t>(1 << d);
+            if (d == last) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool RuleEngine::parseHours(const std::string& text, int& start, int& end) {
+    const std::string spec = trim(text);
+    if (spec.empty() || spec == "*") {
+        start = 0;
+        end = MINUTES_PER_DAY;
+        return true;
+    }
+    const size_t dash = spec.find('-');
+    if (dash == std::string::npos) {
+        return false;
+    }
+    start = parseTime(trim(spec.substr(0, dash)));
+    end = parseTime(trim(spec.substr(dash + 1)));
+    // An empty window is almost certainly a typo
+    return start >= 0 && start < MINUTES_PER_DAY && end >= 0 && end != start;
+}
+
+std::string RuleEngine::getLastError() const {
+    return m_lastError;
+}
+
+RuleEngine::ErrorCode RuleEngine::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void RuleEngine::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool RuleEngine::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
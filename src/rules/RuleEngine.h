@@ -0,0 +1,150 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: RuleEngine.h
+ * Description: Compiled rules choosing wallpapers by time, weekday, displays, power and tags
+ *
+ * Strategy:
+ * - Rules are compiled into bitmasks with one bit per rule (bit i = rule i), so a whole
+ *   rule set is filtered with a handful of 64-bit ANDs and the winner per output is the
+ *   lowest set bit (first rule in config order)
+ * - Time and weekday are compiled together into a decision table over the minute of the
+ *   week: sorted segment starts, each holding the mask of rules active in it. Adjacent
+ *   segments with equal masks are merged, so the segment count is bounded by the rule
+ *   boundaries and the next boundary is the next moment anything can change
+ * - Power keeps one mask per source; display conditions keep, per referenced output,
+ *   the rules needing it present or absent; output targets keep, per named output, the
+ *   rules that may set it plus one mask for rules that set every output
+ * - An evaluation depends only on (time segment, power, connected outputs). update()
+ *   skips events that leave all three unchanged and reports only outputs whose selected
+ *   image differs from the one it last reported, so nothing is reapplied needlessly
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../library/TagExpression.h"
+#include "../utils/ConfigManager.h"
+
+class LibraryIndex;
+
+enum class PowerSource : uint8_t {
+    AC = 0,
+    Battery = 1
+};
+
+struct RuleContext {
+    int minuteOfWeek = 0;                   // Monday 00:00 = 0
+    PowerSource power = PowerSource::AC;
+    std::vector<std::string> outputs;       // Connected output names
+
+    // Local time
+    static int minuteOfWeekAt(std::time_t time);
+    // Battery only when a battery reports Discharging and no mains supply is online
+    static PowerSource detectPowerSource(const std::string& root = "/sys/class/power_supply");
+};
+
+struct CompiledRule {
+    std::string name;
+    std::string wallpaper;      // Fixed image, or empty when the rule picks by tags
+    TagExpression tags;
+    bool usesTags = false;
+};
+
+struct RuleChange {
+    std::string output;
+    int rule;                   // Index into getRules()
+    std::string image;
+};
+
+class RuleEngine {
+public:
+    static constexpr size_t MAX_RULES = 64;             // One bit per rule
+    static constexpr int NO_RULE = -1;
+    static constexpr int MINUTES_PER_DAY = 24 * 60;
+    static constexpr int MINUTES_PER_WEEK = 7 * MINUTES_PER_DAY;
+
+    // Image a matching rule shows on an output; an empty result defers to the next match
+    using ImageResolver = std::function<std::string(const CompiledRule& rule, const std::string& output)>;
+
+    RuleEngine();
+    ~RuleEngine();
+
+    // Replaces the rule set; on failure the engine is left empty
+    bool compile(const std::vector<RuleConfig>& rules);
+    void clear();
+
+    const std::vector<CompiledRule>& getRules() const;
+    size_t getRuleCount() const;
+
+    // Winning rule for one output, or NO_RULE
+    int select(const RuleContext& context, const std::string& output) const;
+
+    // Minutes from minuteOfWeek until the time conditions next change (a timer period)
+    int minutesUntilChange(int minuteOfWeek) const;
+    // Fixed images that the next time boundary will switch outputs to, for prefetching;
+    // `minutes` receives the time until that boundary
+    std::vector<RuleChange> upcoming(const RuleContext& context, int& minutes) const;
+
+    // Evaluate every connected output and return those whose image changed since the
+    // last update. Without a resolver, fixed-image rules show their image and tag rules
+    // are skipped; outputs no rule yields an image for are left alone.
+    std::vector<RuleChange> update(const RuleContext& context, const ImageResolver& resolver = ImageResolver());
+    // Forget what was reported, so the next update reports every matched output again
+    void resetApplied();
+
+    // Stable pick from the files matching `tags`: each output keeps its image while the
+    // set is unchanged, and different outputs tend to get different images
+    static std::string pickTagged(const LibraryIndex& library, const TagExpression& tags, const std::string& output);
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        TooManyRules = 1,
+        InvalidDays = 2,
+        InvalidHours = 3,
+        InvalidPower = 4,
+        InvalidAction = 5,
+        InvalidTags = 6
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    size_t segmentAt(int minuteOfWeek) const;
+    uint64_t contextMask(size_t segment, const RuleContext& context) const;
+    uint64_t targetMask(const std::string& output) const;
+
+    static bool parseDays(const std::string& text, uint8_t& days);
+    static bool parseHours(const std::string& text, int& start, int& end);
+    bool setError(ErrorCode code, const std::string& message);
+
+    std::vector<CompiledRule> m_rules;
+
+    // Decision table over the minute of the week
+    std::vector<int> m_segmentStarts;       // Ascending, first is 0
+    std::vector<uint64_t> m_segmentMasks;
+
+    uint64_t m_powerMasks[2];
+    std::unordered_map<std::string, uint64_t> m_needsPresent;
+    std::unordered_map<std::string, uint64_t> m_needsAbsent;
+    std::unordered_map<std::string, uint64_t> m_targets;
+    uint64_t m_everyOutput;
+
+    // Last evaluated event and the images reported per output
+    bool m_hasLast;
+    size_t m_lastSegment;
+    PowerSource m_lastPower;
+    std::vector<std::string> m_lastOutputs;
+    std::unordered_map<std::string, std::string> m_applied;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
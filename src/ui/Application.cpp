@@ -6,13 +6,25 @@
  */
 
 #include "Application.h"
-#include <iostream>
+#include <algorithm>
 #include <stdexcept>
 #include <fstream>
 #include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
 
 Application::Application() 
     : m_window(nullptr)
+    , m_prefetchBoundary(-1)
+    , m_stopIndexing(false)
+    , m_slide(0)
+    , m_stopEvents(false)
+    , m_displaysChanged(false)
+    , m_showFileBrowser(false)
+    , m_frame(0)
+    , m_uploadsThisFrame(0)
+    , m_browserFirstRow(-1)
     , m_showDemoWindow(false)
     , m_selectedDisplay(0) {
     
@@ -28,34 +40,87 @@ Application::Application()
     m_wallpaperManager = std::make_unique<WallpaperManager>();
     m_displayManager = std::make_unique<DisplayManager>();
     m_configManager = std::make_unique<ConfigManager>();
+    m_ruleEngine = std::make_unique<RuleEngine>();
+    m_workspaces = std::make_unique<WorkspaceWallpapers>();
+    m_scheduler = std::make_unique<TaskScheduler>();
+    m_powerPolicy = std::make_unique<PowerPolicy>();
+    m_trace = std::make_unique<OperationTrace>();
+    m_prefetcher = std::make_unique<PagePrefetcher>();
+    m_fileBrowser = std::make_unique<FileBrowser>(*m_scheduler);
+    m_thumbnails = std::make_unique<ThumbnailCache>(*m_scheduler);
+    m_remoteThumbnails = std::make_unique<RemoteThumbnails>();
+    if (m_remoteThumbnails->connect()) {
+        CAITHE_LOG_INFO("Thumbnails come from the daemon");
+    } else {
+        CAITHE_LOG_DEBUG("No daemon ({}); thumbnails are decoded here", m_remoteThumbnails->getLastError());
+        m_remoteThumbnails.reset();
+    }
     
     // Load configuration (with error handling)
     try {
         if (!m_configManager->loadConfig()) {
-            std::cerr << "Warning: Failed to load config: " << m_configManager->getLastError() << std::endl;
+            CAITHE_LOG_WARNING("Failed to load config: {}", m_configManager->getLastError());
         }
     } catch (const std::exception& e) {
-        std::cerr << "Error initializing config: " << e.what() << std::endl;
+        CAITHE_LOG_ERROR("Error initializing config: {}", e.what());
+    }
+    
+    configureLogging();
+    configureTracing();
+    compileRules();
+    configurePowerPolicy();
+    configureWorkspaces();
+    
+    // Bound every metadata call on a network mount before the first lookup below
+    MountGuard::instance().setDeadline(
+        std::chrono::milliseconds(std::max(m_configManager->getConfig().ioDeadlineMs, 1)));
+
+    // Metadata of files in the wallpaper folders stays cached until inotify reports a change
+    MetadataCache& metadata = MetadataCache::instance();
+    for (const std::string& entry : m_configManager->getConfig().wallpaperDirectories) {
+        const std::string directory = FileUtils::expandPath(entry);
+        if (metadata.isDirectory(directory) && !metadata.watch(directory)) {
+            CAITHE_LOG_WARNING("{}", metadata.getLastError());
+        }
     }
+    
+    compileSlideshowTags();
+    startLibraryIndexing();
 }
 
 Application::~Application() {
+    stopLibraryIndexing();
+    stopWorkspaceEvents();
+    releaseThumbnailTextures();
     cleanupImGui();
     cleanupWindow();
 }
 
 int Application::run() {
+    bool firstFrame = true;
+    
     // Main application loop
     while (!glfwWindowShouldClose(m_window)) {
         glfwPollEvents();
+        updateRules();
+        updateSlideshow();
+        updatePowerPolicy();
         
             // Start new ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
+    if (firstFrame) {
+        prewarmGlyphs();
+        firstFrame = false;
+    }
     
     // Render our UI
+    const auto frameStart = std::chrono::steady_clock::now();
     renderFrame();
+    CAITHE_LOG_DEBUG("Frame built in {} ms, {} thumbnail uploads",
+                     std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count(),
+                     m_uploadsThisFrame);
     
     // Render ImGui
     ImGui::Render();
@@ -72,12 +137,13 @@ int Application::run() {
         glfwSwapBuffers(m_window);
     }
     
+    saveGlyphCache();
     return 0;
 }
 
 bool Application::initializeWindow() {
     if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
+        CAITHE_LOG_ERROR("Failed to initialize GLFW");
         return false;
     }
     
@@ -99,7 +165,7 @@ bool Application::initializeWindow() {
     // Create window
     m_window = glfwCreateWindow(width, height, WINDOW_TITLE, nullptr, nullptr);
     if (!m_window) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
+        CAITHE_LOG_ERROR("Failed to create GLFW window");
         glfwTerminate();
         return false;
     }
@@ -132,15 +198,377 @@ bool Application::initializeImGui() {
     ImGui_ImplGlfw_InitForOpenGL(m_window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
     
+    // Linked shader programs are reloaded with glProgramBinary while the driver stays the same
+    const std::filesystem::path programCache = std::filesystem::path(GlyphCache::defaultPath()).parent_path() / "programs";
+    std::error_code programCacheError;
+    std::filesystem::create_directories(programCache, programCacheError);
+    if (programCacheError) {
+        CAITHE_LOG_DEBUG("Program cache not used: {}", programCacheError.message());
+    } else {
+        ImGui_ImplOpenGL3_SetProgramCacheDir(programCache.c_str());
+    }
+    
+    m_glyphCache = std::make_unique<GlyphCache>();
+    if (!m_glyphCache->load(GlyphCache::defaultPath(), GlyphCache::fontKey("", "imgui " IMGUI_VERSION))) {
+        CAITHE_LOG_DEBUG("Glyph cache not used: {}", m_glyphCache->getLastError());
+    }
+    CachedFontLoader::install(io.Fonts, m_glyphCache.get());
+    
     return true;
 }
 
+void Application::prewarmGlyphs() {
+    ImFontBaked* baked = ImGui::GetFontBaked();
+    std::vector<uint32_t> codepoints = m_glyphCache->getCodepoints(baked->Size, baked->RasterizerDensity);
+    if (codepoints.empty()) {
+        for (uint32_t codepoint = 0x20; codepoint < 0x7F; ++codepoint) {    // First run: printable ASCII
+            codepoints.push_back(codepoint);
+        }
+    }
+    
+    // The atlas texture is created at the end of this frame, so every glyph packed here
+    // reaches the GPU in a single glTexImage2D; cached ones are copied, not rasterized
+    const auto start = std::chrono::steady_clock::now();
+    for (const uint32_t codepoint : codepoints) {
+        if (codepoint <= IM_UNICODE_CODEPOINT_MAX) {
+            baked->FindGlyph(static_cast<ImWchar>(codepoint));
+        }
+    }
+    const CachedFontLoader::Stats stats = CachedFontLoader::getStats();
+    CAITHE_LOG_DEBUG("Pre-warmed {} glyphs at {}px in {} ms: {} from the cache, {} rasterized", codepoints.size(),
+                     baked->Size, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+                     stats.replayed, stats.rasterized);
+}
+
+void Application::saveGlyphCache() {
+    if (m_glyphCache->isDirty() && !m_glyphCache->save(GlyphCache::defaultPath())) {
+        CAITHE_LOG_WARNING("{}", m_glyphCache->getLastError());
+    }
+}
+
 void Application::cleanupImGui() {
+    CachedFontLoader::release();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 }
 
+void Application::compileRules() {
+    if (!m_ruleEngine->compile(m_configManager->getConfig().rules)) {
+        CAITHE_LOG_WARNING("Wallpaper rules disabled: {}", m_ruleEngine->getLastError());
+    }
+    m_nextRuleCheck = std::chrono::steady_clock::time_point();
+}
+
+void Application::updateRules() {
+    const auto now = std::chrono::steady_clock::now();
+    if (m_displaysChanged.exchange(false)) {
+        m_displayManager->refreshDisplays();
+        syncWorkspaceMonitors(m_displayManager->getDisplays());
+        m_nextRuleCheck = std::chrono::steady_clock::time_point();
+    }
+    if (m_ruleEngine->getRuleCount() == 0 || now < m_nextRuleCheck) {
+        return;
+    }
+    m_nextRuleCheck = now + std::chrono::seconds(RULE_POLL_SECONDS);
+    
+    // The engine ignores events that change nothing, so polling costs one sysfs read
+    // (plus a monitor query with hotplug enabled) per period
+    RuleContext context;
+    context.minuteOfWeek = RuleContext::minuteOfWeekAt(std::time(nullptr));
+    context.power = RuleContext::detectPowerSource();
+    if (m_configManager->getConfig().enableHotplugEvents || m_displayManager->getDisplayCount() == 0) {
+        m_displayManager->refreshDisplays();
+    }
+    const std::vector<Display> displays = m_displayManager->getDisplays();
+    for (const Display& display : displays) {
+        context.outputs.push_back(display.name);
+    }
+    
+    // Only outputs whose selected image changed are reapplied; tag rules pick from the library
+    auto resolver = [this](const CompiledRule& rule, const std::string& output) {
+        return rule.usesTags ? pickFromLibrary(rule.tags, output) : rule.wallpaper;
+    };
+    for (const RuleChange& change : m_ruleEngine->update(context, resolver)) {
+        for (const Display& display : displays) {
+            if (display.name != change.output) {
+                continue;
+            }
+            m_trace->record(TraceOp::SetWallpaper, display.name, change.image);
+            if (!m_wallpaperManager->setWallpaper(change.image, display.id) ||
+                !m_wallpaperManager->applyToHyprland(display.id)) {
+                CAITHE_LOG_WARNING("Rule '{}' failed on {}: {}", m_ruleEngine->getRules()[change.rule].name,
+                                   change.output, m_wallpaperManager->getLastError());
+            }
+        }
+    }
+    
+    // Warm the page cache for the next time boundary once per boundary, so the switch
+    // reads from memory; the prefetcher waits until the boundary is within its horizon
+    int minutes = 0;
+    const std::vector<RuleChange> upcoming = m_ruleEngine->upcoming(context, minutes);
+    const int boundary = (context.minuteOfWeek + minutes) % RuleEngine::MINUTES_PER_WEEK;
+    if (!upcoming.empty() && boundary != m_prefetchBoundary) {
+        const std::time_t wall = std::time(nullptr);
+        const auto due = now + std::chrono::minutes(minutes) - std::chrono::seconds(wall % 60);
+        for (const RuleChange& change : upcoming) {
+            m_prefetcher->schedule(change.image, due);
+        }
+        m_prefetchBoundary = boundary;
+    }
+    m_prefetcher->poll(now);
+}
+
+void Application::startLibraryIndexing() {
+    stopLibraryIndexing();
+    std::vector<std::string> directories;
+    for (const std::string& entry : m_configManager->getConfig().wallpaperDirectories) {
+        directories.push_back(FileUtils::expandPath(entry));
+    }
+    const std::filesystem::path indexPath = std::filesystem::path(GlyphCache::defaultPath()).parent_path() / "library.idx";
+    
+    m_stopIndexing = false;
+    m_libraryThread = std::thread([this, directories, indexPath]() {
+        // Last session's index answers picks while this pass refreshes a private copy
+        auto previous = std::make_unique<LibraryIndex>();
+        if (previous->load(indexPath.string())) {
+            publishLibrary(std::move(previous));
+        }
+        auto library = std::make_unique<LibraryIndex>();
+        if (!library->load(indexPath.string())) {
+            CAITHE_LOG_DEBUG("Library index rebuilt: {}", library->getLastError());
+        }
+        
+        // Batches keep shutdown and power-policy holds from waiting on a whole folder
+        for (const std::string& directory : directories) {
+            bool complete = true;
+            const std::vector<std::string> files = FileUtils::getImageFilesInDirectory(directory, complete);
+            if (!complete) {
+                CAITHE_LOG_WARNING("Listing of {} timed out; indexed {} files", directory, files.size());
+            }
+            for (size_t first = 0; first < files.size() && !m_stopIndexing;) {
+                if (m_scheduler->isDeferred(IoClass::Background)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(EVENT_POLL_MS));
+                    continue;
+                }
+                const size_t last = std::min(files.size(), first + LIBRARY_BATCH);
+                const std::vector<std::string> batch(files.begin() + first, files.begin() + last);
+                if (!library->indexFiles(batch, *m_scheduler, IoClass::Background) &&
+                    library->getLastErrorCode() == LibraryIndex::ErrorCode::Deferred) {
+                    continue;   // Held between the check and the pass; retried once released
+                }
+                first = last;
+            }
+        }
+        
+        std::error_code error;
+        std::filesystem::create_directories(indexPath.parent_path(), error);
+        if (!library->save(indexPath.string())) {
+            CAITHE_LOG_WARNING("Library index not saved: {}", library->getLastError());
+        }
+        CAITHE_LOG_INFO("Library index holds {} files", library->getFiles().size());
+        publishLibrary(std::move(library));
+    });
+}
+
+void Application::publishLibrary(std::unique_ptr<LibraryIndex> library) {
+    {
+        std::lock_guard<std::mutex> lock(m_libraryMutex);
+        m_library = std::move(library);
+    }
+    // Workspace pre-renders move to content keys; the event thread re-renders under them
+    std::lock_guard<std::mutex> lock(m_workspaceMutex);
+    m_workspaces->setContentKeyResolver([this](const std::string& source) { return contentKeyOf(source); });
+}
+
+void Application::stopLibraryIndexing() {
+    m_stopIndexing = true;
+    if (m_libraryThread.joinable()) {
+        m_libraryThread.join();
+    }
+}
+
+std::string Application::pickFromLibrary(const TagExpression& tags, const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_libraryMutex);
+    return m_library ? RuleEngine::pickTagged(*m_library, tags, key) : std::string();
+}
+
+std::string Application::contentKeyOf(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_libraryMutex);
+    return m_library ? m_library->getContentKey(path) : std::string();
+}
+
+void Application::compileSlideshowTags() {
+    m_slideshowTagsText = m_configManager->getConfig().slideshowTags;
+    m_slideshowTagsError.clear();
+    if (!m_slideshowTags.compile(m_slideshowTagsText)) {
+        m_slideshowTagsError = m_slideshowTags.getLastError();
+        CAITHE_LOG_WARNING("Slideshow paused: {}", m_slideshowTagsError);
+    }
+    m_nextSlide = std::chrono::steady_clock::time_point();
+}
+
+void Application::updateSlideshow() {
+    const ApplicationConfig& config = m_configManager->getConfig();
+    const auto now = std::chrono::steady_clock::now();
+    if (!config.enableSlideshow || !m_slideshowTagsError.empty() || now < m_nextSlide) {
+        return;
+    }
+    m_nextSlide = now + std::chrono::seconds(std::max(config.slideshowInterval, MIN_SLIDESHOW_SECONDS));
+    
+    // Each step hashes to a different member of the tagged set, per output; outputs a
+    // rule currently governs keep the rule's image
+    RuleContext context;
+    context.minuteOfWeek = RuleContext::minuteOfWeekAt(std::time(nullptr));
+    context.power = m_ruleEngine->getRuleCount() > 0 ? RuleContext::detectPowerSource() : PowerSource::AC;
+    const std::vector<Display> displays = m_displayManager->getDisplays();
+    for (const Display& display : displays) {
+        context.outputs.push_back(display.name);
+    }
+    ++m_slide;
+    for (const Display& display : displays) {
+        if (m_ruleEngine->select(context, display.name) != RuleEngine::NO_RULE) {
+            continue;
+        }
+        const std::string image = pickFromLibrary(m_slideshowTags, display.name + "#" + std::to_string(m_slide));
+        if (image.empty()) {
+            // Also the case until the first index pass is in; look again shortly
+            CAITHE_LOG_DEBUG("Slideshow: no indexed file matches '{}'", m_slideshowTagsText);
+            m_nextSlide = now + std::chrono::seconds(RULE_POLL_SECONDS);
+            return;
+        }
+        m_trace->record(TraceOp::SetWallpaper, display.name, image);
+        if (!m_wallpaperManager->setWallpaper(image, display.id) || !m_wallpaperManager->applyToHyprland(display.id)) {
+            CAITHE_LOG_WARNING("Slideshow failed on {}: {}", display.name, m_wallpaperManager->getLastError());
+        }
+    }
+}
+
+void Application::configureWorkspaces() {
+    stopWorkspaceEvents();
+    const ApplicationConfig& config = m_configManager->getConfig();
+    if (config.workspaceWallpapers.empty()) {
+        return;
+    }
+    
+    m_workspaces->clearWallpapers();
+    for (const auto& [workspace, path] : config.workspaceWallpapers) {
+        m_workspaces->setWallpaper(workspace, path);
+    }
+    m_workspaces->setMemoryBudget(static_cast<size_t>(std::max(config.preloadBudgetMB, 0)) * 1024 * 1024);
+    m_displayManager->refreshDisplays();
+    syncWorkspaceMonitors(m_displayManager->getDisplays());
+    
+    m_stopEvents = false;
+    m_eventThread = std::thread(&Application::workspaceEventLoop, this);
+}
+
+void Application::syncWorkspaceMonitors(const std::vector<Display>& displays) {
+    std::lock_guard<std::mutex> lock(m_workspaceMutex);
+    for (const Display& display : displays) {
+        m_trace->record(TraceOp::RefreshDisplays, display.name,
+                        std::to_string(display.width) + "x" + std::to_string(display.height));
+        m_workspaces->setMonitor(display.name, display.width, display.height);
+        if (display.isPrimary) {
+            m_workspaces->setFocusedMonitor(display.name);
+        }
+    }
+}
+
+void Application::workspaceEventLoop() {
+    HyprlandEvents events;
+    std::vector<HyprlandEvent> received;
+    while (!m_stopEvents) {
+        if (!events.isConnected() && !events.connect()) {
+            CAITHE_LOG_WARNING("Workspace wallpapers paused: {}", events.getLastError());
+            for (int waited = 0; waited < EVENT_RECONNECT_SECONDS * 1000 && !m_stopEvents; waited += EVENT_POLL_MS) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(EVENT_POLL_MS));
+            }
+            continue;
+        }
+        
+        // Queue renders for whatever is missing and preload those that finished; prewarm()
+        // never waits for a decode, so the render thread is not held up on this lock
+        {
+            std::lock_guard<std::mutex> lock(m_workspaceMutex);
+            // Held on low battery; switches fall back to the original images meanwhile
+            if (m_workspaces->needsPrewarm() && !m_scheduler->isDeferred(IoClass::Background) &&
+                !m_workspaces->prewarm(*m_scheduler)) {
+                CAITHE_LOG_WARNING("Workspace prewarm: {}", m_workspaces->getLastError());
+            }
+        }
+        
+        received.clear();
+        if (!events.poll(EVENT_POLL_MS, received)) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(m_workspaceMutex);
+        for (const HyprlandEvent& event : received) {
+            m_trace->record(TraceOp::WorkspaceEvent, event.name, event.data);
+            if (event.name == "monitoradded" || event.name == "monitorremoved") {
+                m_displaysChanged = true;
+            }
+            if (!m_workspaces->handleEvent(event) &&
+                m_workspaces->getLastErrorCode() != WorkspaceWallpapers::ErrorCode::None) {
+                CAITHE_LOG_WARNING("Workspace switch: {}", m_workspaces->getLastError());
+                m_workspaces->clearError();
+            }
+        }
+    }
+}
+
+void Application::stopWorkspaceEvents() {
+    m_stopEvents = true;
+    if (m_eventThread.joinable()) {
+        m_eventThread.join();
+    }
+}
+
+void Application::configureLogging() {
+    const ApplicationConfig& config = m_configManager->getConfig();
+    Logger& logger = Logger::instance();
+    logger.setLevel(Logger::parseLevel(config.logLevel, LogLevel::Info));
+    if (!config.logFile.empty() && !logger.setFile(FileUtils::expandPath(config.logFile))) {
+        CAITHE_LOG_WARNING("{}", logger.getLastError());
+    }
+}
+
+void Application::configureTracing() {
+    const std::string& traceFile = m_configManager->getConfig().traceFile;
+    if (!traceFile.empty() && !m_trace->startRecording(FileUtils::expandPath(traceFile))) {
+        CAITHE_LOG_WARNING("{}", m_trace->getLastError());
+    }
+}
+
+std::string Application::traceMonitorName(int displayId) const {
+    const std::vector<Display> displays = m_displayManager->getDisplays();
+    for (const Display& display : displays) {
+        if (display.id == displayId) {
+            return display.name;
+        }
+    }
+    return std::to_string(displayId);
+}
+
+void Application::configurePowerPolicy() {
+    m_powerPolicy->setConfig(m_configManager->getConfig().power);
+    m_prefetcher->setHorizon(std::chrono::seconds(std::max(m_configManager->getConfig().prefetchHorizonSeconds, 0)));
+    m_nextPowerCheck = std::chrono::steady_clock::time_point();
+    updatePowerPolicy();
+}
+
+void Application::updatePowerPolicy() {
+    const auto now = std::chrono::steady_clock::now();
+    if (now < m_nextPowerCheck) {
+        return;
+    }
+    m_nextPowerCheck = now + std::chrono::seconds(std::max(m_powerPolicy->getConfig().pollSeconds, 1));
+    if (m_powerPolicy->update(*m_scheduler)) {
+        m_prefetcher->setHorizonScale(m_powerPolicy->getDecision().prefetchStretch);
+        CAITHE_LOG_INFO("Background work: {}", m_powerPolicy->getDecision().describe());
+    }
+}
+
 void Application::renderFrame() {
     renderMainWindow();
     
@@ -188,12 +616,12 @@ void Application::renderWallpaperPanel() {
     // Current wallpaper display
     ImGui::Text("Current Wallpaper: %s", m_currentWallpaperPath.c_str());
     
-    if (ImGui::Button("Select Wallpaper")) {
-        std::vector<std::string> filters = {".png", ".jpg", ".jpeg"};
-        std::string path = FileUtils::openFileDialog("Select Wallpaper", "", filters);
-        if (!path.empty()) {
-            m_currentWallpaperPath = path;
-            m_wallpaperManager->setWallpaper(path, 0);
+    if (ImGui::Button(m_showFileBrowser ? "Close Browser" : "Select Wallpaper")) {
+        if (m_showFileBrowser) {
+            m_showFileBrowser = false;
+            cancelThumbnails();
+        } else {
+            openFileBrowser();
         }
     }
     
@@ -207,8 +635,255 @@ void Application::renderWallpaperPanel() {
     const char* modes[] = {"Stretch", "Center", "Tile", "Scale"};
     static int currentMode = 0;
     if (ImGui::Combo("Wallpaper Mode", &currentMode, modes, IM_ARRAYSIZE(modes))) {
+        m_trace->record(TraceOp::SetMode, traceMonitorName(0), modes[currentMode]);
         m_wallpaperManager->setWallpaperMode(0, static_cast<WallpaperMode>(currentMode));
     }
+    
+    if (m_showFileBrowser) {
+        renderFileBrowser();
+    }
+}
+
+void Application::openFileBrowser() {
+    // Start where the last wallpaper came from, else the first configured wallpaper folder
+    const ApplicationConfig& config = m_configManager->getConfig();
+    std::string directory;
+    if (!m_currentWallpaperPath.empty()) {
+        directory = FileUtils::getDirectory(m_currentWallpaperPath);
+    } else if (!config.lastWallpaperPath.empty()) {
+        directory = FileUtils::getDirectory(config.lastWallpaperPath);
+    } else if (!config.wallpaperDirectories.empty()) {
+        directory = FileUtils::expandPath(config.wallpaperDirectories.front());
+    }
+    if (directory.empty() || !std::filesystem::is_directory(directory)) {
+        directory = FileUtils::getHomeDirectory();
+    }
+    
+    m_fileBrowser->open(directory);
+    m_browserFirstRow = -1;
+    m_showFileBrowser = true;
+}
+
+void Application::renderFileBrowser() {
+    ++m_frame;
+    m_uploadsThisFrame = 0;
+    m_fileBrowser->poll();
+    if (m_remoteThumbnails && !m_remoteThumbnails->isConnected()) {
+        CAITHE_LOG_WARNING("Lost the daemon ({}); decoding thumbnails here", m_remoteThumbnails->getLastError());
+        m_remoteThumbnails.reset();
+        releaseThumbnailTextures();
+    }
+    
+    // A thumbnail decoded again (file changed on disk) needs a fresh texture
+    for (const std::string& key : takeCompletedThumbnails()) {
+        const auto it = m_thumbnailTextures.find(key);
+        if (it != m_thumbnailTextures.end()) {
+            glDeleteTextures(1, &it->second.id);
+            m_thumbnailTextures.erase(it);
+        }
+    }
+    
+    const std::string before = m_fileBrowser->getDirectory();
+    if (ImGui::Button("Up")) {
+        m_fileBrowser->up();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Refresh")) {
+        m_fileBrowser->refresh();
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s%s", m_fileBrowser->getDirectory().c_str(), m_fileBrowser->isScanning() ? "  (listing...)" : "");
+    const std::string error = m_fileBrowser->getLastError();
+    if (!error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+    }
+    
+    const auto& entries = m_fileBrowser->getEntries();
+    const float footer = ImGui::GetFrameHeightWithSpacing() + ImGui::GetStyle().ItemSpacing.y;
+    ImGui::BeginChild("BrowserGrid", ImVec2(0.0f, -footer), true);
+    
+    const float labelHeight = ImGui::GetTextLineHeightWithSpacing();
+    const float cellHeight = THUMBNAIL_CELL + labelHeight;
+    const int columns = std::max(1, static_cast<int>(ImGui::GetContentRegionAvail().x / (THUMBNAIL_CELL + ImGui::GetStyle().ItemSpacing.x)));
+    const int rows = static_cast<int>((entries.size() + columns - 1) / columns);
+    const ImGuiIO& io = ImGui::GetIO();
+    int activated = -1;
+    
+    // Only visible rows are laid out, so a folder of thousands of files costs a screenful
+    ImGuiListClipper clipper;
+    clipper.Begin(rows, cellHeight + ImGui::GetStyle().ItemSpacing.y);
+    bool firstStep = true;
+    while (clipper.Step()) {
+        if (firstStep && clipper.DisplayStart != m_browserFirstRow) {
+            // Scrolled: decodes queued for cells no longer on screen are dropped
+            cancelThumbnails();
+            m_browserFirstRow = clipper.DisplayStart;
+        }
+        firstStep = false;
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            for (int column = 0; column < columns; ++column) {
+                const size_t index = static_cast<size_t>(row) * columns + column;
+                if (index >= entries.size()) {
+                    break;
+                }
+                const DirectoryEntry& entry = entries[index];
+                if (column > 0) {
+                    ImGui::SameLine();
+                }
+                ImGui::PushID(static_cast<int>(index));
+                if (ImGui::Selectable("##cell", m_fileBrowser->isSelected(index), ImGuiSelectableFlags_AllowDoubleClick,
+                                      ImVec2(THUMBNAIL_CELL, cellHeight))) {
+                    if (ImGui::IsMouseDoubleClicked(0)) {
+                        activated = static_cast<int>(index);
+                    } else {
+                        m_fileBrowser->click(index, io.KeyCtrl, io.KeyShift);
+                    }
+                }
+                const ImVec2 cellMin = ImGui::GetItemRectMin();
+                ImDrawList* drawList = ImGui::GetWindowDrawList();
+                
+                if (entry.isDirectory) {
+                    drawList->AddText(ImVec2(cellMin.x + THUMBNAIL_CELL * 0.5f - 16.0f, cellMin.y + THUMBNAIL_CELL * 0.5f),
+                                      ImGui::GetColorU32(ImGuiCol_Text), "[dir]");
+                } else {
+                    int thumbnailWidth = 0;
+                    int thumbnailHeight = 0;
+                    const std::string contentKey = contentKeyOf(entry.path);
+                    const GLuint texture =
+                        requestThumbnail(entry.path, entry.modified, contentKey, thumbnailWidth, thumbnailHeight);
+                    if (texture != 0) {
+                        const float width = static_cast<float>(thumbnailWidth);
+                        const float height = static_cast<float>(thumbnailHeight);
+                        const ImVec2 imageMin(cellMin.x + (THUMBNAIL_CELL - width) * 0.5f,
+                                              cellMin.y + (THUMBNAIL_CELL - height) * 0.5f);
+                        drawList->AddImage((ImTextureID)(intptr_t)texture, imageMin,
+                                           ImVec2(imageMin.x + width, imageMin.y + height));
+                    } else if (thumbnailWidth == 0) {
+                        const bool failed = thumbnailFailed(ThumbnailCache::cacheKey(entry.path, contentKey));
+                        drawList->AddText(ImVec2(cellMin.x + 8.0f, cellMin.y + THUMBNAIL_CELL * 0.5f),
+                                          ImGui::GetColorU32(ImGuiCol_TextDisabled), failed ? "(unreadable)" : "...");
+                    }
+                }
+                
+                const ImVec4 clip(cellMin.x, cellMin.y, cellMin.x + THUMBNAIL_CELL, cellMin.y + cellHeight);
+                drawList->AddText(nullptr, 0.0f, ImVec2(cellMin.x + 4.0f, cellMin.y + THUMBNAIL_CELL),
+                                  ImGui::GetColorU32(ImGuiCol_Text), entry.name.c_str(), nullptr, 0.0f, &clip);
+                ImGui::PopID();
+            }
+        }
+    }
+    clipper.End();
+    ImGui::EndChild();
+    
+    if (activated >= 0 && m_fileBrowser->activate(static_cast<size_t>(activated))) {
+        applyBrowserSelection();
+    }
+    if (m_fileBrowser->getDirectory() != before) {
+        cancelThumbnails();
+        releaseThumbnailTextures();
+        m_browserFirstRow = -1;
+    }
+    
+    const size_t selected = m_fileBrowser->getSelectionCount();
+    ImGui::Text("%zu item%s, %zu selected", entries.size(), entries.size() == 1 ? "" : "s", selected);
+    ImGui::SameLine();
+    if (ImGui::Button(selected > 1 ? "Set Across Displays" : "Set Wallpaper") && selected > 0) {
+        applyBrowserSelection();
+    }
+}
+
+void Application::applyBrowserSelection() {
+    const std::vector<std::string> selection = m_fileBrowser->getSelection();
+    if (selection.empty()) {
+        return;
+    }
+    
+    // One image goes to the first display as before; several are dealt out one per display
+    const size_t displayCount = std::max<size_t>(1, m_displayManager->getDisplays().size());
+    const size_t count = std::min(selection.size(), displayCount);
+    for (size_t i = 0; i < count; ++i) {
+        m_trace->record(TraceOp::SetWallpaper, traceMonitorName(static_cast<int>(i)), selection[i]);
+        m_wallpaperManager->setWallpaper(selection[i], static_cast<int>(i));
+    }
+    m_currentWallpaperPath = selection.front();
+}
+
+GLuint Application::requestThumbnail(const std::string& path, int64_t modified, const std::string& contentKey,
+                                     int& width, int& height) {
+    // Copies of one file share a texture as they share the cache entry
+    const std::string& key = ThumbnailCache::cacheKey(path, contentKey);
+    // A daemon thumbnail is a read-only mapping of its buffer, handed to GL as it is
+    if (m_remoteThumbnails) {
+        const auto mapped = m_remoteThumbnails->request(path, modified, contentKey);
+        if (!mapped) {
+            return 0;
+        }
+        width = mapped->width;
+        height = mapped->height;
+        return thumbnailTexture(key, width, height, mapped->pixels);
+    }
+    const auto thumbnail = m_thumbnails->request(path, modified, contentKey);
+    if (!thumbnail) {
+        return 0;
+    }
+    width = thumbnail->image.width;
+    height = thumbnail->image.height;
+    return thumbnailTexture(key, width, height, thumbnail->image.pixels.data());
+}
+
+bool Application::thumbnailFailed(const std::string& key) const {
+    return m_remoteThumbnails ? m_remoteThumbnails->hasFailed(key) : m_thumbnails->hasFailed(key);
+}
+
+std::vector<std::string> Application::takeCompletedThumbnails() {
+    return m_remoteThumbnails ? m_remoteThumbnails->takeCompleted() : m_thumbnails->takeCompleted();
+}
+
+void Application::cancelThumbnails() {
+    if (m_remoteThumbnails) {
+        m_remoteThumbnails->cancelPending();
+    } else {
+        m_thumbnails->cancelPending();
+    }
+}
+
+GLuint Application::thumbnailTexture(const std::string& key, int width, int height, const uint8_t* pixels) {
+    const auto it = m_thumbnailTextures.find(key);
+    if (it != m_thumbnailTextures.end()) {
+        it->second.lastUsedFrame = m_frame;
+        return it->second.id;
+    }
+    if (m_uploadsThisFrame >= THUMBNAIL_UPLOADS_PER_FRAME) {
+        return 0;   // Uploaded on a later frame; keeps a freshly opened folder from stalling one
+    }
+    if (m_thumbnailTextures.size() >= MAX_THUMBNAIL_TEXTURES) {
+        auto oldest = m_thumbnailTextures.begin();
+        for (auto candidate = m_thumbnailTextures.begin(); candidate != m_thumbnailTextures.end(); ++candidate) {
+            if (candidate->second.lastUsedFrame < oldest->second.lastUsedFrame) {
+                oldest = candidate;
+            }
+        }
+        glDeleteTextures(1, &oldest->second.id);
+        m_thumbnailTextures.erase(oldest);
+    }
+    
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    ++m_uploadsThisFrame;
+    m_thumbnailTextures[key] = ThumbnailTexture{texture, m_frame};
+    return texture;
+}
+
+void Application::releaseThumbnailTextures() {
+    for (const auto& texture : m_thumbnailTextures) {
+        glDeleteTextures(1, &texture.second.id);
+    }
+    m_thumbnailTextures.clear();
 }
 
 void Application::renderDisplayPanel() {
@@ -238,6 +913,23 @@ void Application::renderDisplayPanel() {
         ImGui::Text("Refresh Rate: %d Hz", display.refreshRate);
         ImGui::Text("Connector: %s", display.connector.c_str());
     }
+    
+    // Workspace switching
+    if (m_eventThread.joinable()) {
+        WorkspaceSwitchStats stats;
+        {
+            std::lock_guard<std::mutex> lock(m_workspaceMutex);
+            stats = m_workspaces->getStats();
+        }
+        ImGui::Separator();
+        ImGui::Text("Workspace switches: %llu (%llu preloaded, %llu not)",
+                    static_cast<unsigned long long>(stats.assignments),
+                    static_cast<unsigned long long>(stats.preloadHits),
+                    static_cast<unsigned long long>(stats.preloadMisses));
+        ImGui::Text("Switch latency: last %.2f ms, mean %.2f ms, max %.2f ms",
+                    stats.lastLatency.count() / 1e6, stats.meanLatency().count() / 1e6, stats.maxLatency.count() / 1e6);
+        ImGui::Text("Preloaded: %.1f MB", stats.preloadedBytes / (1024.0 * 1024.0));
+    }
 }
 
 void Application::renderSettingsPanel() {
@@ -249,6 +941,8 @@ void Application::renderSettingsPanel() {
         return;
     }
     
+    ImGui::Text("Background work: %s", m_powerPolicy->getDecision().describe().c_str());
+    
     // Demo window toggle
     bool showDemo = m_configManager->getBool("ui.showDemoWindow", false);
     if (ImGui::Checkbox("Show Demo Window", &showDemo)) {
@@ -312,16 +1006,27 @@ void Application::renderSettingsPanel() {
         m_configManager->setBool("advanced.enableLiveSync", liveSync);
     }
     
-    // Slideshow settings
-    bool slideshow = m_configManager->getBool("advanced.enableSlideshow", false);
-    if (ImGui::Checkbox("Enable Slideshow", &slideshow)) {
-        m_configManager->setBool("advanced.enableSlideshow", slideshow);
+    // Slideshow settings live in the nested "advanced" section, so they bind to the
+    // config struct; the dotted-key accessors only see top-level keys
+    ApplicationConfig& config = m_configManager->getConfig();
+    if (ImGui::Checkbox("Enable Slideshow", &config.enableSlideshow)) {
+        m_nextSlide = std::chrono::steady_clock::time_point();
     }
     
-    if (slideshow) {
-        int interval = m_configManager->getInt("advanced.slideshowInterval", 300);
-        if (ImGui::InputInt("Slideshow Interval (seconds)", &interval, 30, 60)) {
-            m_configManager->setInt("advanced.slideshowInterval", interval);
+    if (config.enableSlideshow) {
+        if (ImGui::InputInt("Slideshow Interval (seconds)", &config.slideshowInterval, 30, 60)) {
+            config.slideshowInterval = std::max(config.slideshowInterval, MIN_SLIDESHOW_SECONDS);
+        }
+        
+        // Tag expression such as "winter AND NOT team:red"; empty plays the whole library
+        char tags[256];
+        std::snprintf(tags, sizeof(tags), "%s", config.slideshowTags.c_str());
+        if (ImGui::InputText("Slideshow Tags", tags, sizeof(tags))) {
+            config.slideshowTags = tags;
+            compileSlideshowTags();
+        }
+        if (!m_slideshowTagsError.empty()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", m_slideshowTagsError.c_str());
         }
     }
     
@@ -339,6 +1044,10 @@ void Application::renderSettingsPanel() {
     ImGui::SameLine();
     if (ImGui::Button("Load Settings")) {
         if (m_configManager->loadConfig()) {
+            compileRules();
+            compileSlideshowTags();
+            configurePowerPolicy();
+            configureWorkspaces();
             ImGui::OpenPopup("Settings Loaded");
         } else {
             ImGui::OpenPopup("Load Failed");
@@ -348,6 +1057,10 @@ void Application::renderSettingsPanel() {
     ImGui::SameLine();
     if (ImGui::Button("Reset to Defaults")) {
         m_configManager->createDefaultConfig();
+        compileRules();
+        compileSlideshowTags();
+        configurePowerPolicy();
+        configureWorkspaces();
         ImGui::OpenPopup("Settings Reset");
     }
     
@@ -7,8 +7,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <GLFW/glfw3.h>
 #include "imgui.h"
@@ -16,8 +22,23 @@
 #include "imgui/backends/imgui_impl_opengl3.h"
 #include "../core/WallpaperManager.h"
 #include "../core/DisplayManager.h"
+#include "../core/OperationTrace.h"
+#include "../core/WorkspaceWallpapers.h"
+#include "../daemon/RemoteThumbnails.h"
+#include "../library/LibraryIndex.h"
+#include "../library/ThumbnailCache.h"
+#include "CachedFontLoader.h"
+#include "FileBrowser.h"
+#include "GlyphCache.h"
 #include "../utils/FileUtils.h"
+#include "../utils/Logger.h"
 #include "../utils/ConfigManager.h"
+#include "../utils/MetadataCache.h"
+#include "../utils/MountGuard.h"
+#include "../rules/RuleEngine.h"
+#include "../utils/PagePrefetcher.h"
+#include "../utils/PowerPolicy.h"
+#include "../utils/TaskScheduler.h"
 
 // Forward declarations
 enum class WallpaperMode;
@@ -43,10 +64,16 @@ private:
     bool initializeImGui();
     void cleanupImGui();
     
+    // Glyphs rasterized in earlier sessions are packed from the cache in the first frame, in
+    // one atlas upload; new ones are recorded as they are rasterized and saved on exit
+    void prewarmGlyphs();
+    void saveGlyphCache();
+    
     // Main rendering loop
     void renderFrame();
     void renderMainWindow();
     void renderWallpaperPanel();
+    void renderFileBrowser();
     void renderDisplayPanel();
     void renderSettingsPanel();
     void renderAboutDialog();
@@ -54,11 +81,99 @@ private:
     // Event handling
     void handleInput();
     
+    // Automatic wallpaper rules
+    void compileRules();
+    void updateRules();
+    
+    // Library index over the wallpaper folders, loaded and refreshed on its own thread.
+    // Tag rules and the slideshow pick from it once the first pass is in; copies of one
+    // file share their thumbnail and workspace pre-renders through its content key
+    void startLibraryIndexing();
+    void stopLibraryIndexing();
+    void publishLibrary(std::unique_ptr<LibraryIndex> library);
+    std::string pickFromLibrary(const TagExpression& tags, const std::string& key);
+    std::string contentKeyOf(const std::string& path);
+    
+    // Slideshow over the files matching the slideshow tag expression
+    void compileSlideshowTags();
+    void updateSlideshow();
+    
+    // Per-workspace wallpapers, driven by Hyprland's event socket
+    void configureWorkspaces();
+    void syncWorkspaceMonitors(const std::vector<Display>& displays);
+    void workspaceEventLoop();
+    void stopWorkspaceEvents();
+    
+    // Log level and rotating log file from the advanced settings
+    void configureLogging();
+    
+    // Recording of incoming operations for replay benchmarks
+    void configureTracing();
+    std::string traceMonitorName(int displayId) const;
+    
+    // Background work throttling on battery and under pressure
+    void configurePowerPolicy();
+    void updatePowerPolicy();
+    
+    // In-app wallpaper browser; thumbnails are uploaded as GL textures on the render thread.
+    // With a daemon running they come from its shared buffers, otherwise they are decoded here
+    void openFileBrowser();
+    void applyBrowserSelection();
+    GLuint requestThumbnail(const std::string& path, int64_t modified, const std::string& contentKey, int& width,
+                            int& height);
+    bool thumbnailFailed(const std::string& key) const;
+    std::vector<std::string> takeCompletedThumbnails();
+    void cancelThumbnails();
+    GLuint thumbnailTexture(const std::string& key, int width, int height, const uint8_t* pixels);
+    void releaseThumbnailTextures();
+    
     // Member variables
     GLFWwindow* m_window;
     std::unique_ptr<WallpaperManager> m_wallpaperManager;
     std::unique_ptr<DisplayManager> m_displayManager;
     std::unique_ptr<ConfigManager> m_configManager;
+    std::unique_ptr<RuleEngine> m_ruleEngine;
+    std::chrono::steady_clock::time_point m_nextRuleCheck;
+    std::unique_ptr<PagePrefetcher> m_prefetcher;
+    int m_prefetchBoundary;     // Minute of week whose images are already scheduled
+    
+    std::unique_ptr<LibraryIndex> m_library;    // Null until the first pass is in
+    std::mutex m_libraryMutex;
+    std::thread m_libraryThread;
+    std::atomic<bool> m_stopIndexing;
+    
+    TagExpression m_slideshowTags;
+    std::string m_slideshowTagsText;    // Text m_slideshowTags was compiled from
+    std::string m_slideshowTagsError;   // Empty when the expression compiled
+    std::chrono::steady_clock::time_point m_nextSlide;
+    uint64_t m_slide;
+    
+    // Workspace switching runs on its own thread so a switch never waits for a frame
+    std::unique_ptr<WorkspaceWallpapers> m_workspaces;
+    std::unique_ptr<TaskScheduler> m_scheduler;
+    std::mutex m_workspaceMutex;
+    std::thread m_eventThread;
+    std::atomic<bool> m_stopEvents;
+    std::atomic<bool> m_displaysChanged;    // monitoradded/monitorremoved seen on socket2
+    
+    std::unique_ptr<OperationTrace> m_trace;
+    std::unique_ptr<GlyphCache> m_glyphCache;
+    
+    std::unique_ptr<PowerPolicy> m_powerPolicy;
+    std::chrono::steady_clock::time_point m_nextPowerCheck;
+    
+    struct ThumbnailTexture {
+        GLuint id;
+        uint64_t lastUsedFrame;
+    };
+    std::unique_ptr<FileBrowser> m_fileBrowser;
+    std::unique_ptr<ThumbnailCache> m_thumbnails;
+    std::unique_ptr<RemoteThumbnails> m_remoteThumbnails;     // Null without a daemon
+    std::unordered_map<std::string, ThumbnailTexture> m_thumbnailTextures;   // By ThumbnailCache::cacheKey()
+    bool m_showFileBrowser;
+    uint64_t m_frame;
+    int m_uploadsThisFrame;
+    int m_browserFirstRow;      // Thumbnails queued for rows above it are cancelled on scroll
     
     // UI state
     bool m_showDemoWindow;
@@ -69,4 +184,12 @@ private:
     static constexpr int WINDOW_WIDTH = 1200;
     static constexpr int WINDOW_HEIGHT = 800;
     static constexpr const char* WINDOW_TITLE = "Caithe Wallpaper Manager";
+    static constexpr int RULE_POLL_SECONDS = 5;    // Power and hotplug polling for rules
+    static constexpr int EVENT_POLL_MS = 250;       // Event thread wakeup to notice shutdown
+    static constexpr int EVENT_RECONNECT_SECONDS = 5;
+    static constexpr int MIN_SLIDESHOW_SECONDS = 10;
+    static constexpr size_t LIBRARY_BATCH = 256;    // Files per indexing pass between stop checks
+    static constexpr float THUMBNAIL_CELL = 168.0f;             // Thumbnail side plus padding
+    static constexpr int THUMBNAIL_UPLOADS_PER_FRAME = 8;       // Bounds glTexImage2D per frame
+    static constexpr size_t MAX_THUMBNAIL_TEXTURES = 512;       // ~50 MB of 160px RGBA
 }; 
\ No newline at end of file
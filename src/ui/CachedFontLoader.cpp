@@ -0,0 +1,113 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: CachedFontLoader.cpp
+ * Description: Implementation of the glyph-replaying font loader
+ */
+
+#include "CachedFontLoader.h"
+#include "imgui.h"
+#include "imgui_internal.h"
+#include <vector>
+
+namespace {
+
+GlyphCache* g_cache = nullptr;
+CachedFontLoader::Stats g_stats;
+ImFontLoader g_loader;
+
+// Bitmap of a glyph just packed, read back from the atlas texture as alpha coverage
+std::vector<uint8_t> readBack(ImFontAtlas* atlas, const ImTextureRect& rect) {
+    ImTextureData* texture = atlas->TexData;
+    std::vector<uint8_t> pixels(static_cast<size_t>(rect.w) * rect.h);
+    for (int y = 0; y < rect.h; ++y) {
+        const unsigned char* row = texture->GetPixelsAt(rect.x, rect.y + y);
+        for (int x = 0; x < rect.w; ++x) {
+            pixels[static_cast<size_t>(y) * rect.w + x] =
+                texture->Format == ImTextureFormat_Alpha8 ? row[x] : row[x * 4 + 3];
+        }
+    }
+    return pixels;
+}
+
+// Pack a cached glyph into the atlas the way the stb_truetype loader packs a rendered one
+bool replay(ImFontAtlas* atlas, ImFontConfig* src, ImFontBaked* baked, const CachedGlyph& cached,
+            ImFontGlyph* glyph) {
+    glyph->Codepoint = cached.codepoint;
+    glyph->AdvanceX = cached.advanceX;
+    if (cached.width == 0 || cached.height == 0) {
+        return true;
+    }
+    const ImFontAtlasRectId pack = ImFontAtlasPackAddRect(atlas, cached.width, cached.height);
+    if (pack == ImFontAtlasRectId_Invalid) {
+        return false;
+    }
+    ImTextureRect* rect = ImFontAtlasPackGetRect(atlas, pack);
+    glyph->X0 = cached.x0;
+    glyph->Y0 = cached.y0;
+    glyph->X1 = cached.x1;
+    glyph->Y1 = cached.y1;
+    glyph->Visible = true;
+    glyph->PackId = pack;
+    ImFontAtlasBakedSetFontGlyphBitmap(atlas, baked, src, glyph, rect, cached.pixels, ImTextureFormat_Alpha8,
+                                       cached.width);
+    return true;
+}
+
+// FontBakedLoadGlyph for every ImGui 1.92 signature; `rest` is the advance-only output
+// newer versions append, and such advance-only queries go straight to stb_truetype
+template <typename... Rest>
+bool loadGlyph(ImFontAtlas* atlas, ImFontConfig* src, ImFontBaked* baked, void* loaderData, ImWchar codepoint,
+               ImFontGlyph* glyph, Rest... rest) {
+    const ImFontLoader* stb = ImFontAtlasGetFontLoaderForStbTruetype();
+    if (!g_cache || !glyph) {
+        return stb->FontBakedLoadGlyph(atlas, src, baked, loaderData, codepoint, glyph, rest...);
+    }
+    if (const CachedGlyph* cached = g_cache->findGlyph(baked->Size, baked->RasterizerDensity, codepoint)) {
+        if (replay(atlas, src, baked, *cached, glyph)) {
+            ++g_stats.replayed;
+            return true;
+        }
+        return false;
+    }
+    if (!stb->FontBakedLoadGlyph(atlas, src, baked, loaderData, codepoint, glyph, rest...)) {
+        return false;   // Not in this font; the next source or the fallback glyph answers
+    }
+    ++g_stats.rasterized;
+
+    CachedGlyph rendered;
+    rendered.codepoint = codepoint;
+    rendered.advanceX = glyph->AdvanceX;
+    std::vector<uint8_t> pixels;
+    if (glyph->Visible) {
+        const ImTextureRect* rect = ImFontAtlasPackGetRect(atlas, glyph->PackId);
+        pixels = readBack(atlas, *rect);
+        rendered.x0 = glyph->X0;
+        rendered.y0 = glyph->Y0;
+        rendered.x1 = glyph->X1;
+        rendered.y1 = glyph->Y1;
+        rendered.width = rect->w;
+        rendered.height = rect->h;
+        rendered.pixels = pixels.data();
+    }
+    g_cache->addGlyph(baked->Size, baked->RasterizerDensity, rendered);
+    return true;
+}
+
+} // namespace
+
+void CachedFontLoader::install(ImFontAtlas* atlas, GlyphCache* cache) {
+    g_cache = cache;
+    g_loader = *ImFontAtlasGetFontLoaderForStbTruetype();
+    g_loader.Name = "caithe glyph cache";
+    g_loader.FontBakedLoadGlyph = &loadGlyph;
+    atlas->SetFontLoader(&g_loader);
+}
+
+void CachedFontLoader::release() {
+    g_cache = nullptr;
+}
+
+CachedFontLoader::Stats CachedFontLoader::getStats() {
+    return g_stats;
+}
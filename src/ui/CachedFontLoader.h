@@ -0,0 +1,38 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: CachedFontLoader.h
+ * Description: ImGui font loader that replays glyphs from a GlyphCache instead of rasterizing them
+ *
+ * Strategy:
+ * - Wraps ImGui's stb_truetype loader; every callback except glyph loading passes through
+ * - A glyph the cache holds for the baked size and density is packed into the atlas from
+ *   its stored bitmap and metrics, so stb_truetype never sees it
+ * - A miss is rasterized by stb_truetype as usual, read back from the atlas texture and
+ *   added to the cache, so the next session replays it. The read-back already carries the
+ *   font's RasterizerMultiply, which is 1 for the fonts this application loads
+ * - ImFontLoader callbacks carry no user data, so the cache is held process-wide; the
+ *   application has a single atlas
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "GlyphCache.h"
+
+struct ImFontAtlas;
+
+class CachedFontLoader {
+public:
+    // Route the glyph loads of `atlas` through `cache`, which must stay alive until release()
+    static void install(ImFontAtlas* atlas, GlyphCache* cache);
+
+    // Stop using the cache; glyphs are then rasterized and not recorded
+    static void release();
+
+    struct Stats {
+        uint64_t replayed = 0;      // Glyphs packed from the cache
+        uint64_t rasterized = 0;    // Glyphs stb_truetype rendered
+    };
+    static Stats getStats();
+};
@@ -0,0 +1,181 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: FileBrowser.cpp
+ * Description: Implementation of the wallpaper browser state
+ */
+
+#include "FileBrowser.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include "../utils/FileUtils.h"
+
+FileBrowser::FileBrowser(TaskScheduler& scheduler)
+    : m_scanner(scheduler)
+    , m_showHidden(false) {
+}
+
+FileBrowser::~FileBrowser() = default;
+
+void FileBrowser::open(const std::string& directory) {
+    std::string normalized = directory;
+    while (normalized.size() > 1 && normalized.back() == '/') {
+        normalized.pop_back();
+    }
+    m_directory = normalized;
+    m_entries.clear();
+    m_selected.clear();
+    m_anchor.clear();
+    m_scanner.start(m_directory, FileUtils::getSupportedImageFormats(), m_showHidden);
+}
+
+bool FileBrowser::up() {
+    const std::filesystem::path parent = std::filesystem::path(m_directory).parent_path();
+    if (parent.empty() || parent.string() == m_directory) {
+        return false;
+    }
+    open(parent.string());
+    return true;
+}
+
+void FileBrowser::refresh() {
+    // Keep the selection across a refresh; files that disappeared simply stop matching
+    const std::unordered_set<std::string> selected = m_selected;
+    const std::string anchor = m_anchor;
+    open(m_directory);
+    m_selected = selected;
+    m_anchor = anchor;
+}
+
+void FileBrowser::setShowHidden(bool showHidden) {
+    if (showHidden != m_showHidden) {
+        m_showHidden = showHidden;
+        refresh();
+    }
+}
+
+bool FileBrowser::poll() {
+    m_incoming.clear();
+    if (m_scanner.take(m_incoming) == 0) {
+        return false;
+    }
+    std::sort(m_incoming.begin(), m_incoming.end(), lessThan);
+    const size_t middle = m_entries.size();
+    m_entries.insert(m_entries.end(), std::make_move_iterator(m_incoming.begin()),
+                     std::make_move_iterator(m_incoming.end()));
+    std::inplace_merge(m_entries.begin(), m_entries.begin() + static_cast<std::ptrdiff_t>(middle),
+                       m_entries.end(), lessThan);
+    return true;
+}
+
+const std::string& FileBrowser::getDirectory() const {
+    return m_directory;
+}
+
+const std::vector<DirectoryEntry>& FileBrowser::getEntries() const {
+    return m_entries;
+}
+
+bool FileBrowser::isScanning() const {
+    return !m_scanner.isFinished();
+}
+
+std::string FileBrowser::getLastError() const {
+    return m_scanner.getLastError();
+}
+
+void FileBrowser::click(size_t index, bool toggle, bool range) {
+    if (index >= m_entries.size() || m_entries[index].isDirectory) {
+        return;
+    }
+    const std::string& path = m_entries[index].path;
+
+    const size_t anchor = range ? indexOf(m_anchor) : m_entries.size();
+    if (anchor < m_entries.size()) {
+        if (!toggle) {
+            m_selected.clear();
+        }
+        const size_t first = std::min(anchor, index);
+        const size_t last = std::max(anchor, index);
+        for (size_t i = first; i <= last; ++i) {
+            if (!m_entries[i].isDirectory) {
+                m_selected.insert(m_entries[i].path);
+            }
+        }
+        return;     // The anchor stays put so further Shift-clicks pivot around it
+    }
+
+    if (toggle) {
+        if (!m_selected.erase(path)) {
+            m_selected.insert(path);
+        }
+    } else {
+        m_selected.clear();
+        m_selected.insert(path);
+    }
+    m_anchor = path;
+}
+
+bool FileBrowser::activate(size_t index) {
+    if (index >= m_entries.size()) {
+        return false;
+    }
+    if (m_entries[index].isDirectory) {
+        open(m_entries[index].path);
+        return false;
+    }
+    click(index, false, false);
+    return true;
+}
+
+bool FileBrowser::isSelected(size_t index) const {
+    return index < m_entries.size() && m_selected.count(m_entries[index].path) != 0;
+}
+
+std::vector<std::string> FileBrowser::getSelection() const {
+    std::vector<std::string> selection;
+    selection.reserve(m_selected.size());
+    for (const DirectoryEntry& entry : m_entries) {
+        if (m_selected.count(entry.path)) {
+            selection.push_back(entry.path);
+        }
+    }
+    return selection;
+}
+
+size_t FileBrowser::getSelectionCount() const {
+    return m_selected.size();
+}
+
+void FileBrowser::clearSelection() {
+    m_selected.clear();
+    m_anchor.clear();
+}
+
+bool FileBrowser::lessThan(const DirectoryEntry& a, const DirectoryEntry& b) {
+    if (a.isDirectory != b.isDirectory) {
+        return a.isDirectory;
+    }
+    const auto lower = [](unsigned char c) { return std::tolower(c); };
+    const bool less = std::lexicographical_compare(a.name.begin(), a.name.end(), b.name.begin(), b.name.end(),
+                                                   [&](char x, char y) { return lower(x) < lower(y); });
+    if (less) {
+        return true;
+    }
+    const bool greater = std::lexicographical_compare(b.name.begin(), b.name.end(), a.name.begin(), a.name.end(),
+                                                      [&](char x, char y) { return lower(x) < lower(y); });
+    return !greater && a.name < b.name;     // Case only breaks ties, so the order is total
+}
+
+size_t FileBrowser::indexOf(const std::string& path) const {
+    if (path.empty()) {
+        return m_entries.size();
+    }
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].path == path) {
+            return i;
+        }
+    }
+    return m_entries.size();
+}
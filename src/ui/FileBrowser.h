@@ -0,0 +1,70 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: FileBrowser.h
+ * Description: State of the in-app wallpaper browser: directory listing and multi-select
+ *
+ * Strategy:
+ * - Listing goes through a DirectoryScanner, so opening a folder returns immediately and
+ *   poll() merges whatever the scan has published since the last frame
+ * - Each merged batch is sorted and merged into the sorted list (folders first, then
+ *   case-insensitive name), which keeps the list ordered while it grows in O(n) per batch
+ * - Selection is held by path, so it survives entries being inserted ahead of it; clicks
+ *   follow the usual file-manager rules: plain click selects one, toggle (Ctrl) adds or
+ *   removes, range (Shift) selects from the anchor, both together extend the selection
+ * - No ImGui here: Application renders the panel, this class only holds its state
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../utils/DirectoryScanner.h"
+
+class FileBrowser {
+public:
+    explicit FileBrowser(TaskScheduler& scheduler);
+    ~FileBrowser();
+
+    FileBrowser(const FileBrowser&) = delete;
+    FileBrowser& operator=(const FileBrowser&) = delete;
+
+    // Start listing `directory`; the selection is cleared
+    void open(const std::string& directory);
+    bool up();
+    void refresh();
+    void setShowHidden(bool showHidden);
+
+    // Merge entries listed since the last frame; true when the list changed
+    bool poll();
+
+    const std::string& getDirectory() const;
+    const std::vector<DirectoryEntry>& getEntries() const;
+    bool isScanning() const;
+    std::string getLastError() const;
+
+    // Click on entry `index` with the Ctrl (`toggle`) and Shift (`range`) modifiers
+    void click(size_t index, bool toggle, bool range);
+
+    // Double-click: folders are entered; true when a file was activated (it becomes the selection)
+    bool activate(size_t index);
+
+    bool isSelected(size_t index) const;
+    std::vector<std::string> getSelection() const;  // Selected files in list order
+    size_t getSelectionCount() const;
+    void clearSelection();
+
+private:
+    static bool lessThan(const DirectoryEntry& a, const DirectoryEntry& b);
+    size_t indexOf(const std::string& path) const;
+
+    DirectoryScanner m_scanner;
+    std::string m_directory;
+    std::vector<DirectoryEntry> m_entries;
+    std::vector<DirectoryEntry> m_incoming;
+    std::unordered_set<std::string> m_selected;
+    std::string m_anchor;
+    bool m_showHidden;
+};
@@ -0,0 +1,354 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: GlyphCache.cpp
+ * Description: Implementation of the persisted glyph cache
+ *
+ * File layout (little-endian):
+ * - "CAITHEGC", u32 version, u64 font key, u32 set count
+ * - Per set: f32 size, f32 density, u32 glyph count, then per glyph (ascending codepoints)
+ *   u32 codepoint, f32 advance, f32 x0, y0, x1, y1, u16 width, u16 height, u32 offset;
+ *   then u32 bitmap bytes and the bitmaps, each at its offset from the start of the block
+ * - u64 XXH64 of everything before it
+ */
+
+#include "GlyphCache.h"
+#include "../utils/Xxh64.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char CACHE_MAGIC[8] = { 'C', 'A', 'I', 'T', 'H', 'E', 'G', 'C' };
+constexpr size_t HEADER_BYTES = sizeof(CACHE_MAGIC) + 4 + 8 + 4;
+constexpr size_t GLYPH_RECORD_BYTES = 4 + 5 * 4 + 2 + 2 + 4;
+constexpr float SIZE_TOLERANCE = 0.01f;
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+bool get(const uint8_t*& cursor, const uint8_t* end, T& value) {
+    if (static_cast<size_t>(end - cursor) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return true;
+}
+
+} // namespace
+
+// Read-only mapping released on destruction
+class GlyphCache::Mapping {
+public:
+    explicit Mapping(const std::string& path)
+        : m_data(nullptr)
+        , m_size(0) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info{};
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const uint8_t*>(data);
+                m_size = static_cast<size_t>(info.st_size);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~Mapping() {
+        if (m_data) {
+            ::munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+};
+
+GlyphCache::GlyphCache()
+    : m_fontKey(0)
+    , m_dirty(false)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+GlyphCache::~GlyphCache() = default;
+
+uint64_t GlyphCache::fontKey(const std::string& fontPath, const std::string& rasterizer) {
+    Xxh64 hasher;
+    if (fontPath.empty()) {
+        hasher.update("builtin", 7);
+    } else {
+        const Mapping font(fontPath);
+        if (font.data()) {
+            hasher.update(font.data(), font.size());
+        } else {
+            hasher.update(fontPath.data(), fontPath.size());    // Unreadable: still a stable key
+        }
+    }
+    hasher.update(rasterizer.data(), rasterizer.size());
+    return hasher.digest();
+}
+
+std::string GlyphCache::defaultPath() {
+    const char* cache = std::getenv("XDG_CACHE_HOME");
+    if (cache && *cache) {
+        return std::string(cache) + "/caithe/glyphs.bin";
+    }
+    const char* home = std::getenv("HOME");
+    return std::string(home ? home : "/tmp") + "/.cache/caithe/glyphs.bin";
+}
+
+bool GlyphCache::load(const std::string& path, uint64_t fontKey) {
+    clearError();
+    m_fontKey = fontKey;
+    m_sets.clear();
+    m_mapping.reset();
+    m_dirty = false;
+
+    auto file = std::make_unique<Mapping>(path);
+    if (!file->data()) {
+        return setError(ErrorCode::ReadFailed, "Cannot read " + path);
+    }
+    if (file->size() < HEADER_BYTES + 8 || std::memcmp(file->data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+        return setError(ErrorCode::Corrupt, "Not a glyph cache: " + path);
+    }
+    uint64_t checksum = 0;
+    std::memcpy(&checksum, file->data() + file->size() - 8, sizeof(checksum));
+    if (checksum != Xxh64::hash(file->data(), file->size() - 8)) {
+        return setError(ErrorCode::Corrupt, "Checksum mismatch: " + path);
+    }
+
+    const uint8_t* cursor = file->data() + sizeof(CACHE_MAGIC);
+    const uint8_t* end = file->data() + file->size() - 8;
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    uint32_t setCount = 0;
+    get(cursor, end, version);
+    get(cursor, end, storedKey);
+    get(cursor, end, setCount);
+    if (version != FORMAT_VERSION || storedKey != fontKey) {
+        return setError(ErrorCode::StaleKey, "Glyph cache was built for another font or ImGui version");
+    }
+    if (setCount > MAX_SETS) {
+        return setError(ErrorCode::Corrupt, "Too many glyph sets in " + path);
+    }
+
+    std::vector<GlyphSet> sets(setCount);
+    for (GlyphSet& set : sets) {
+        uint32_t count = 0;
+        if (!get(cursor, end, set.size) || !get(cursor, end, set.density) || !get(cursor, end, count) ||
+            count > MAX_CODEPOINTS || static_cast<size_t>(end - cursor) < count * GLYPH_RECORD_BYTES) {
+            return setError(ErrorCode::Corrupt, "Truncated glyph set in " + path);
+        }
+        set.glyphs.resize(count);
+        std::vector<uint32_t> offsets(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            CachedGlyph& glyph = set.glyphs[i];
+            get(cursor, end, glyph.codepoint);
+            get(cursor, end, glyph.advanceX);
+            get(cursor, end, glyph.x0);
+            get(cursor, end, glyph.y0);
+            get(cursor, end, glyph.x1);
+            get(cursor, end, glyph.y1);
+            get(cursor, end, glyph.width);
+            get(cursor, end, glyph.height);
+            get(cursor, end, offsets[i]);
+            if (i > 0 && glyph.codepoint <= set.glyphs[i - 1].codepoint) {
+                return setError(ErrorCode::Corrupt, "Unsorted glyph set in " + path);
+            }
+        }
+        uint32_t bitmapBytes = 0;
+        if (!get(cursor, end, bitmapBytes) || static_cast<size_t>(end - cursor) < bitmapBytes) {
+            return setError(ErrorCode::Corrupt, "Truncated glyph bitmaps in " + path);
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            CachedGlyph& glyph = set.glyphs[i];
+            const size_t bytes = static_cast<size_t>(glyph.width) * glyph.height;
+            if (offsets[i] > bitmapBytes || bytes > bitmapBytes - offsets[i]) {
+                return setError(ErrorCode::Corrupt, "Glyph bitmap out of bounds in " + path);
+            }
+            glyph.pixels = bytes > 0 ? cursor + offsets[i] : nullptr;
+        }
+        cursor += bitmapBytes;
+    }
+    m_sets = std::move(sets);
+    m_mapping = std::move(file);
+    return true;
+}
+
+bool GlyphCache::save(const std::string& path) {
+    std::vector<uint8_t> data(CACHE_MAGIC, CACHE_MAGIC + sizeof(CACHE_MAGIC));
+    put<uint32_t>(data, FORMAT_VERSION);
+    put<uint64_t>(data, m_fontKey);
+    put<uint32_t>(data, static_cast<uint32_t>(m_sets.size()));
+    for (const GlyphSet& set : m_sets) {
+        put<float>(data, set.size);
+        put<float>(data, set.density);
+        put<uint32_t>(data, static_cast<uint32_t>(set.glyphs.size()));
+        uint32_t offset = 0;
+        for (const CachedGlyph& glyph : set.glyphs) {
+            put<uint32_t>(data, glyph.codepoint);
+            put<float>(data, glyph.advanceX);
+            put<float>(data, glyph.x0);
+            put<float>(data, glyph.y0);
+            put<float>(data, glyph.x1);
+            put<float>(data, glyph.y1);
+            put<uint16_t>(data, glyph.width);
+            put<uint16_t>(data, glyph.height);
+            put<uint32_t>(data, offset);
+            offset += static_cast<uint32_t>(glyph.width) * glyph.height;
+        }
+        put<uint32_t>(data, offset);
+        for (const CachedGlyph& glyph : set.glyphs) {
+            data.insert(data.end(), glyph.pixels, glyph.pixels + static_cast<size_t>(glyph.width) * glyph.height);
+        }
+    }
+    put<uint64_t>(data, Xxh64::hash(data.data(), data.size()));
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return setError(ErrorCode::WriteFailed, "Cannot write " + temporary);
+        }
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            return setError(ErrorCode::WriteFailed, "Write failed: " + temporary);
+        }
+    }
+    // A rename leaves the mapped file intact, so the loaded bitmaps stay valid
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return setError(ErrorCode::WriteFailed, "Cannot replace " + path);
+    }
+    m_dirty = false;
+    return true;
+}
+
+const CachedGlyph* GlyphCache::findGlyph(float size, float density, uint32_t codepoint) const {
+    const size_t index = findSet(size, density);
+    if (index == m_sets.size()) {
+        return nullptr;
+    }
+    const std::vector<CachedGlyph>& glyphs = m_sets[index].glyphs;
+    const auto it = std::lower_bound(glyphs.begin(), glyphs.end(), codepoint,
+                                     [](const CachedGlyph& glyph, uint32_t value) { return glyph.codepoint < value; });
+    return it != glyphs.end() && it->codepoint == codepoint ? &*it : nullptr;
+}
+
+bool GlyphCache::addGlyph(float size, float density, const CachedGlyph& glyph) {
+    const size_t bytes = static_cast<size_t>(glyph.width) * glyph.height;
+    if (bytes > 0 && !glyph.pixels) {
+        return false;
+    }
+    size_t index = findSet(size, density);
+    if (index == m_sets.size()) {
+        if (m_sets.size() >= MAX_SETS) {
+            return false;
+        }
+        m_sets.push_back(GlyphSet{ size, density, {}, {} });
+    }
+    GlyphSet& set = m_sets[index];
+    const auto it = std::lower_bound(set.glyphs.begin(), set.glyphs.end(), glyph.codepoint,
+                                     [](const CachedGlyph& entry, uint32_t value) { return entry.codepoint < value; });
+    if ((it != set.glyphs.end() && it->codepoint == glyph.codepoint) || set.glyphs.size() >= MAX_CODEPOINTS) {
+        return false;
+    }
+
+    CachedGlyph copy = glyph;
+    if (bytes > 0) {
+        set.added.emplace_back(glyph.pixels, glyph.pixels + bytes);
+        copy.pixels = set.added.back().data();
+    } else {
+        copy.pixels = nullptr;
+    }
+    set.glyphs.insert(it, copy);
+    m_dirty = true;
+    return true;
+}
+
+std::vector<uint32_t> GlyphCache::getCodepoints(float size, float density) const {
+    std::vector<uint32_t> codepoints;
+    const size_t index = findSet(size, density);
+    if (index < m_sets.size()) {
+        codepoints.reserve(m_sets[index].glyphs.size());
+        for (const CachedGlyph& glyph : m_sets[index].glyphs) {
+            codepoints.push_back(glyph.codepoint);
+        }
+    }
+    return codepoints;
+}
+
+uint64_t GlyphCache::getFontKey() const {
+    return m_fontKey;
+}
+
+size_t GlyphCache::getSetCount() const {
+    return m_sets.size();
+}
+
+size_t GlyphCache::getGlyphCount() const {
+    size_t count = 0;
+    for (const GlyphSet& set : m_sets) {
+        count += set.glyphs.size();
+    }
+    return count;
+}
+
+bool GlyphCache::isDirty() const {
+    return m_dirty;
+}
+
+size_t GlyphCache::findSet(float size, float density) const {
+    for (size_t i = 0; i < m_sets.size(); ++i) {
+        if (std::fabs(m_sets[i].size - size) < SIZE_TOLERANCE && std::fabs(m_sets[i].density - density) < SIZE_TOLERANCE) {
+            return i;
+        }
+    }
+    return m_sets.size();
+}
+
+std::string GlyphCache::getLastError() const {
+    return m_lastError;
+}
+
+GlyphCache::ErrorCode GlyphCache::getLastErrorCode() const {
+    return m_lastErrorCode;
+}
+
+void GlyphCache::clearError() {
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+bool GlyphCache::setError(ErrorCode code, const std::string& message) {
+    m_lastErrorCode = code;
+    m_lastError = message;
+    return false;
+}
@@ -0,0 +1,111 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: GlyphCache.h
+ * Description: Persisted rasterized glyphs for pre-warming ImGui's dynamic font atlas at startup
+ *
+ * Strategy:
+ * - ImGui rasterizes glyphs the first time they are drawn; each new batch becomes a
+ *   glTexSubImage2D in the next frame, so the first seconds of UI hitch as text appears
+ * - Every glyph rasterized in a session is kept with its glyph table entry (advance and
+ *   quad) and its coverage bitmap, per font size and rasterizer density, under a key
+ *   covering the font file contents and the rasterizer version
+ * - The file is mmap-loaded and checksummed, and the bitmaps are used in place. At startup
+ *   CachedFontLoader packs them into the atlas in the first frame, before the atlas
+ *   texture exists, so the whole atlas goes to the GPU as one upload; only glyphs missing
+ *   from the cache are rasterized
+ * - A file for another font or ImGui version is ignored and rebuilt
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One rasterized glyph: the glyph table entry ImGui needs plus its coverage bitmap
+struct CachedGlyph {
+    uint32_t codepoint = 0;
+    float advanceX = 0.0f;
+    float x0 = 0.0f;                    // Quad relative to the pen position, in pixels
+    float y0 = 0.0f;
+    float x1 = 0.0f;
+    float y1 = 0.0f;
+    uint16_t width = 0;                 // Bitmap size; 0 x 0 for blank glyphs such as space
+    uint16_t height = 0;
+    const uint8_t* pixels = nullptr;    // width * height alpha bytes, row-major
+};
+
+class GlyphCache {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 2;
+    static constexpr size_t MAX_SETS = 64;              // Distinct size/density pairs kept
+    static constexpr size_t MAX_CODEPOINTS = 0x10000;   // Per set; bounds a corrupt file
+
+    GlyphCache();
+    ~GlyphCache();
+
+    GlyphCache(const GlyphCache&) = delete;
+    GlyphCache& operator=(const GlyphCache&) = delete;
+
+    // Identity of the rasterized output: font file contents (empty path = built-in font)
+    // and the rasterizer, e.g. "imgui 1.92.1"
+    static uint64_t fontKey(const std::string& fontPath, const std::string& rasterizer);
+
+    // $XDG_CACHE_HOME/caithe/glyphs.bin, falling back to ~/.cache
+    static std::string defaultPath();
+
+    // Replace the contents with `path`; fails with StaleKey when it was built for another font.
+    // The file stays mapped while the glyphs are in use
+    bool load(const std::string& path, uint64_t fontKey);
+    bool save(const std::string& path);
+
+    // Glyph recorded for this size and density, or null; valid until the next add or load
+    const CachedGlyph* findGlyph(float size, float density, uint32_t codepoint) const;
+
+    // Record a glyph rasterized this session, copying its bitmap; true when it was new
+    bool addGlyph(float size, float density, const CachedGlyph& glyph);
+
+    // Sorted codepoints recorded for this size and density (empty when none)
+    std::vector<uint32_t> getCodepoints(float size, float density) const;
+
+    uint64_t getFontKey() const;
+    size_t getSetCount() const;
+    size_t getGlyphCount() const;
+    bool isDirty() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        ReadFailed = 1,
+        WriteFailed = 2,
+        Corrupt = 3,
+        StaleKey = 4
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    class Mapping;
+
+    struct GlyphSet {
+        float size;
+        float density;
+        std::vector<CachedGlyph> glyphs;            // Ascending codepoints
+        std::vector<std::vector<uint8_t>> added;    // Bitmaps added since the load; buffers never move
+    };
+
+    size_t findSet(float size, float density) const;   // m_sets.size() when absent
+    bool setError(ErrorCode code, const std::string& message);
+
+    uint64_t m_fontKey;
+    std::unique_ptr<Mapping> m_mapping;     // Loaded file; its bitmaps are used in place
+    std::vector<GlyphSet> m_sets;
+    bool m_dirty;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
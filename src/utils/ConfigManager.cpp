@@ -297,9 +297,19 @@ void ConfigManager::createDefaultApplicationConfig() {
     m_config.enableLiveSync = true;
     m_config.slideshowInterval = DEFAULT_SLIDESHOW_INTERVAL;
     m_config.enableSlideshow = false;
+    m_config.slideshowTags.clear();
+    m_config.preloadBudgetMB = DEFAULT_PRELOAD_BUDGET_MB;
+    m_config.prefetchHorizonSeconds = DEFAULT_PREFETCH_HORIZON_SECONDS;
+    m_config.ioDeadlineMs = DEFAULT_IO_DEADLINE_MS;
+    m_config.logLevel = DEFAULT_LOG_LEVEL;
+    m_config.logFile.clear();
+    m_config.traceFile.clear();
     
     // Display configurations
     m_config.displays.clear();
+    m_config.rules.clear();
+    m_config.workspaceWallpapers.clear();
+    m_config.power = PowerPolicyConfig();
 }
 
 void ConfigManager::createDefaultDisplayConfig() {
@@ -331,6 +341,13 @@ nlohmann::json ConfigManager::configToJson() const {
     json["advanced"]["enableLiveSync"] = m_config.enableLiveSync;
     json["advanced"]["slideshowInterval"] = m_config.slideshowInterval;
     json["advanced"]["enableSlideshow"] = m_config.enableSlideshow;
+    json["advanced"]["slideshowTags"] = m_config.slideshowTags;
+    json["advanced"]["preloadBudgetMB"] = m_config.preloadBudgetMB;
+    json["advanced"]["prefetchHorizonSeconds"] = m_config.prefetchHorizonSeconds;
+    json["advanced"]["ioDeadlineMs"] = m_config.ioDeadlineMs;
+    json["advanced"]["logLevel"] = m_config.logLevel;
+    json["advanced"]["logFile"] = m_config.logFile;
+    json["advanced"]["traceFile"] = m_config.traceFile;
     
     // Display configurations
     json["displays"] = nlohmann::json::array();
@@ -344,6 +361,34 @@ nlohmann::json ConfigManager::configToJson() const {
         json["displays"].push_back(displayJson);
     }
     
+    // Wallpaper rules
+    json["rules"] = nlohmann::json::array();
+    for (const auto& rule : m_config.rules) {
+        nlohmann::json ruleJson;
+        ruleJson["name"] = rule.name;
+        ruleJson["days"] = rule.days;
+        ruleJson["hours"] = rule.hours;
+        ruleJson["power"] = rule.power;
+        ruleJson["displays"] = rule.displays;
+        ruleJson["outputs"] = rule.outputs;
+        ruleJson["wallpaper"] = rule.wallpaper;
+        ruleJson["tags"] = rule.tags;
+        json["rules"].push_back(ruleJson);
+    }
+    
+    // Per-workspace wallpapers
+    json["workspaces"] = m_config.workspaceWallpapers;
+    
+    // Power policy
+    json["power"]["enabled"] = m_config.power.enabled;
+    json["power"]["batteryWorkers"] = m_config.power.batteryWorkers;
+    json["power"]["pressureWorkers"] = m_config.power.pressureWorkers;
+    json["power"]["deferIdleOnBattery"] = m_config.power.deferIdleOnBattery;
+    json["power"]["lowBatteryPercent"] = m_config.power.lowBatteryPercent;
+    json["power"]["pressureThreshold"] = m_config.power.pressureThreshold;
+    json["power"]["prefetchStretch"] = m_config.power.prefetchStretch;
+    json["power"]["pollSeconds"] = m_config.power.pollSeconds;
+    
     return json;
 }
 
@@ -382,6 +427,13 @@ bool ConfigManager::jsonToConfig(const nlohmann::json& json) {
             m_config.enableLiveSync = advanced.value("enableLiveSync", true);
             m_config.slideshowInterval = advanced.value("slideshowInterval", DEFAULT_SLIDESHOW_INTERVAL);
             m_config.enableSlideshow = advanced.value("enableSlideshow", false);
+            m_config.slideshowTags = advanced.value("slideshowTags", "");
+            m_config.preloadBudgetMB = advanced.value("preloadBudgetMB", DEFAULT_PRELOAD_BUDGET_MB);
+            m_config.prefetchHorizonSeconds = advanced.value("prefetchHorizonSeconds", DEFAULT_PREFETCH_HORIZON_SECONDS);
+            m_config.ioDeadlineMs = advanced.value("ioDeadlineMs", DEFAULT_IO_DEADLINE_MS);
+            m_config.logLevel = advanced.value("logLevel", DEFAULT_LOG_LEVEL);
+            m_config.logFile = advanced.value("logFile", "");
+            m_config.traceFile = advanced.value("traceFile", "");
         }
         
         // Display configurations
@@ -398,6 +450,44 @@ bool ConfigManager::jsonToConfig(const nlohmann::json& json) {
             }
         }
         
+        // Wallpaper rules
+        m_config.rules.clear();
+        if (json.contains("rules") && json["rules"].is_array()) {
+            for (const auto& ruleJson : json["rules"]) {
+                RuleConfig rule;
+                rule.name = ruleJson.value("name", "");
+                rule.days = ruleJson.value("days", "");
+                rule.hours = ruleJson.value("hours", "");
+                rule.power = ruleJson.value("power", "");
+                rule.displays = ruleJson.value("displays", std::vector<std::string>{});
+                rule.outputs = ruleJson.value("outputs", std::vector<std::string>{});
+                rule.wallpaper = ruleJson.value("wallpaper", "");
+                rule.tags = ruleJson.value("tags", "");
+                m_config.rules.push_back(rule);
+            }
+        }
+        
+        // Per-workspace wallpapers
+        m_config.workspaceWallpapers.clear();
+        if (json.contains("workspaces") && json["workspaces"].is_object()) {
+            m_config.workspaceWallpapers = json["workspaces"].get<std::map<std::string, std::string>>();
+        }
+        
+        // Power policy
+        m_config.power = PowerPolicyConfig();
+        if (json.contains("power")) {
+            const auto& power = json["power"];
+            const PowerPolicyConfig defaults;
+            m_config.power.enabled = power.value("enabled", defaults.enabled);
+            m_config.power.batteryWorkers = power.value("batteryWorkers", defaults.batteryWorkers);
+            m_config.power.pressureWorkers = power.value("pressureWorkers", defaults.pressureWorkers);
+            m_config.power.deferIdleOnBattery = power.value("deferIdleOnBattery", defaults.deferIdleOnBattery);
+            m_config.power.lowBatteryPercent = power.value("lowBatteryPercent", defaults.lowBatteryPercent);
+            m_config.power.pressureThreshold = power.value("pressureThreshold", defaults.pressureThreshold);
+            m_config.power.prefetchStretch = power.value("prefetchStretch", defaults.prefetchStretch);
+            m_config.power.pollSeconds = power.value("pollSeconds", defaults.pollSeconds);
+        }
+        
         return true;
         
     } catch (const std::exception& e) {
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 #include <memory>
@@ -23,6 +24,30 @@ struct DisplayConfig {
     bool enabled;
 };
 
+// Automatic wallpaper rule; empty conditions always match. Compiled by RuleEngine.
+struct RuleConfig {
+    std::string name;
+    std::string days;                   // "mon-fri", "sat,sun"; empty = every day
+    std::string hours;                  // "07:00-18:30", "22-06"; empty = all day
+    std::string power;                  // "ac", "battery"; empty = either
+    std::vector<std::string> displays;  // Required connected outputs; "!name" = must be absent
+    std::vector<std::string> outputs;   // Outputs this rule sets; empty = every output
+    std::string wallpaper;              // Image to show, or
+    std::string tags;                   // tag expression picking from the library
+};
+
+// Background work policy on battery and under pressure. Applied by PowerPolicy.
+struct PowerPolicyConfig {
+    bool enabled = true;
+    size_t batteryWorkers = 1;          // Background/Idle workers on battery; 0 = no cap
+    size_t pressureWorkers = 1;         // Background/Idle workers under pressure; 0 = no cap
+    bool deferIdleOnBattery = true;     // Hold Idle work until AC returns
+    int lowBatteryPercent = 20;         // At or below, Background work waits as well
+    double pressureThreshold = 20.0;    // PSI "some avg10" percent that counts as pressure
+    double prefetchStretch = 4.0;       // Prefetch horizon multiplier while constrained
+    int pollSeconds = 5;
+};
+
 struct ApplicationConfig {
     // Window settings
     int windowWidth;
@@ -44,11 +69,27 @@ struct ApplicationConfig {
     // Display configurations
     std::vector<DisplayConfig> displays;
     
+    // Wallpaper rules, first match per output wins
+    std::vector<RuleConfig> rules;
+    
+    // Per-workspace wallpapers ("*" = workspaces without their own)
+    std::map<std::string, std::string> workspaceWallpapers;
+    
+    // Background scheduling on battery and under pressure
+    PowerPolicyConfig power;
+    
     // Advanced settings
     bool enableHotplugEvents;
     bool enableLiveSync;
     int slideshowInterval;
     bool enableSlideshow;
+    std::string slideshowTags;      // Tag expression choosing the slideshow set; empty = all
+    int preloadBudgetMB;            // hyprpaper memory for preloaded workspace wallpapers
+    int prefetchHorizonSeconds;     // Page-cache lead time before a scheduled wallpaper change
+    int ioDeadlineMs;               // Longest a metadata call on a network mount may block
+    std::string logLevel;           // debug, info, warning, error or off
+    std::string logFile;            // Rotating log file; empty = stderr only
+    std::string traceFile;          // Operation trace for `caithe --replay`; empty = off
 };
 
 class ConfigManager {
@@ -116,4 +157,8 @@ private:
     static constexpr int DEFAULT_WINDOW_X = 100;
     static constexpr int DEFAULT_WINDOW_Y = 100;
     static constexpr int DEFAULT_SLIDESHOW_INTERVAL = 300; // 5 minutes
+    static constexpr int DEFAULT_PRELOAD_BUDGET_MB = 256;
+    static constexpr int DEFAULT_PREFETCH_HORIZON_SECONDS = 30;
+    static constexpr int DEFAULT_IO_DEADLINE_MS = 2000;
+    static constexpr const char* DEFAULT_LOG_LEVEL = "info";
 }; 
\ No newline at end of file
@@ -0,0 +1,220 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: DirectoryScanner.cpp
+ * Description: Implementation of batched readdir listing with generation-based cancellation
+ */
+
+#include "DirectoryScanner.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "TaskScheduler.h"
+
+struct DirectoryScanner::Shared {
+    std::atomic<uint64_t> generation{0};
+    mutable std::mutex mutex;
+    std::vector<DirectoryEntry> listed;     // Published by the current scan, not yet taken
+    bool done = true;
+    std::string lastError;
+    ErrorCode lastErrorCode = ErrorCode::None;
+};
+
+namespace {
+
+class DirectoryHandle {
+public:
+    explicit DirectoryHandle(const std::string& path)
+        : m_dir(::opendir(path.c_str())) {
+    }
+    ~DirectoryHandle() {
+        if (m_dir) {
+            ::closedir(m_dir);
+        }
+    }
+    DirectoryHandle(const DirectoryHandle&) = delete;
+    DirectoryHandle& operator=(const DirectoryHandle&) = delete;
+
+    DIR* get() const { return m_dir; }
+
+private:
+    DIR* m_dir;
+};
+
+bool matchesExtension(const char* name, const std::vector<std::string>& extensions) {
+    if (extensions.empty()) {
+        return true;
+    }
+    const char* dot = std::strrchr(name, '.');
+    if (!dot || dot == name) {
+        return false;
+    }
+    std::string extension(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+}
+
+} // namespace
+
+DirectoryScanner::DirectoryScanner(TaskScheduler& scheduler)
+    : m_scheduler(scheduler)
+    , m_shared(std::make_shared<Shared>()) {
+}
+
+DirectoryScanner::~DirectoryScanner() {
+    cancel();
+}
+
+uint64_t DirectoryScanner::start(const std::string& directory, const std::vector<std::string>& extensions,
+                                 bool showHidden) {
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_shared->mutex);
+        generation = ++m_shared->generation;
+        m_shared->listed.clear();
+        m_shared->done = false;
+        m_shared->lastError.clear();
+        m_shared->lastErrorCode = ErrorCode::None;
+    }
+
+    std::shared_ptr<Shared> shared = m_shared;
+    m_scheduler.submit(IoClass::Interactive, [shared, generation, directory, extensions, showHidden]() {
+        scan(shared, generation, directory, extensions, showHidden);
+    });
+    return generation;
+}
+
+void DirectoryScanner::cancel() {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    ++m_shared->generation;
+    m_shared->listed.clear();
+    m_shared->done = true;
+}
+
+size_t DirectoryScanner::take(std::vector<DirectoryEntry>& out) {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    const size_t count = m_shared->listed.size();
+    out.insert(out.end(), std::make_move_iterator(m_shared->listed.begin()),
+               std::make_move_iterator(m_shared->listed.end()));
+    m_shared->listed.clear();
+    return count;
+}
+
+bool DirectoryScanner::isFinished() const {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    return m_shared->done && m_shared->listed.empty();
+}
+
+uint64_t DirectoryScanner::getGeneration() const {
+    return m_shared->generation.load();
+}
+
+void DirectoryScanner::scan(const std::shared_ptr<Shared>& shared, uint64_t generation, const std::string& directory,
+                            const std::vector<std::string>& extensions, bool showHidden) {
+    std::vector<DirectoryEntry> batch;
+    batch.reserve(BATCH_SIZE);
+
+    // Publishing under the lock with a generation check means a superseded scan can never
+    // add entries after start() or cancel() cleared the list
+    auto publish = [&](bool finished, ErrorCode code, const std::string& message) {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        if (shared->generation.load() != generation) {
+            return false;
+        }
+        shared->listed.insert(shared->listed.end(), std::make_move_iterator(batch.begin()),
+                              std::make_move_iterator(batch.end()));
+        batch.clear();
+        if (finished) {
+            shared->done = true;
+            shared->lastError = message;
+            shared->lastErrorCode = code;
+        }
+        return true;
+    };
+
+    DirectoryHandle dir(directory);
+    if (!dir.get()) {
+        publish(true, ErrorCode::OpenFailed, "Cannot open " + directory + ": " + std::strerror(errno));
+        return;
+    }
+    const int dirFd = ::dirfd(dir.get());
+    const std::string prefix = directory.empty() || directory.back() == '/' ? directory : directory + "/";
+
+    for (;;) {
+        if (shared->generation.load(std::memory_order_relaxed) != generation) {
+            return;
+        }
+        errno = 0;
+        const struct dirent* item = ::readdir(dir.get());
+        if (!item) {
+            if (errno != 0) {
+                publish(true, ErrorCode::ReadFailed, "Cannot list " + directory + ": " + std::strerror(errno));
+            } else {
+                publish(true, ErrorCode::None, std::string());
+            }
+            return;
+        }
+
+        const char* name = item->d_name;
+        if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0 || (!showHidden && name[0] == '.')) {
+            continue;
+        }
+
+        bool isDirectory = item->d_type == DT_DIR;
+        const bool resolve = item->d_type == DT_UNKNOWN || item->d_type == DT_LNK;
+        if (!isDirectory && !resolve && item->d_type != DT_REG) {
+            continue;
+        }
+        if (!isDirectory && !resolve && !matchesExtension(name, extensions)) {
+            continue;
+        }
+
+        // Follows symlinks, so a link to a folder lists as a folder
+        struct stat info;
+        if (!isDirectory) {
+            if (::fstatat(dirFd, name, &info, 0) != 0) {
+                continue;
+            }
+            isDirectory = S_ISDIR(info.st_mode);
+            if (!isDirectory && (!S_ISREG(info.st_mode) || !matchesExtension(name, extensions))) {
+                continue;
+            }
+        }
+
+        DirectoryEntry entry;
+        entry.name = name;
+        entry.path = prefix + name;
+        entry.isDirectory = isDirectory;
+        if (!isDirectory) {
+            entry.size = static_cast<uint64_t>(info.st_size);
+            entry.modified = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+        }
+        batch.push_back(std::move(entry));
+        if (batch.size() >= BATCH_SIZE && !publish(false, ErrorCode::None, std::string())) {
+            return;
+        }
+    }
+}
+
+std::string DirectoryScanner::getLastError() const {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    return m_shared->lastError;
+}
+
+DirectoryScanner::ErrorCode DirectoryScanner::getLastErrorCode() const {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    return m_shared->lastErrorCode;
+}
+
+void DirectoryScanner::clearError() {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->lastError.clear();
+    m_shared->lastErrorCode = ErrorCode::None;
+}
@@ -0,0 +1,79 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: DirectoryScanner.h
+ * Description: Streaming directory listing on a TaskScheduler, drained without blocking
+ *
+ * Strategy:
+ * - A scan runs as one task on the scheduler and publishes entries in batches, so the
+ *   render loop shows the first files of a large or slow (network) directory while the
+ *   rest is still being read; take() only moves out what is already listed
+ * - Entry types come from readdir's d_type; stat is only called for image files (size and
+ *   mtime key the thumbnail cache) and for filesystems that report DT_UNKNOWN, so
+ *   non-image files cost no syscall beyond the directory read
+ * - Every start() bumps a generation; a superseded scan stops at its next entry and its
+ *   unpublished entries are discarded, so navigating away never shows stale results
+ * - Scan state is shared with the task, so destroying the scanner never waits for it
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TaskScheduler;
+
+struct DirectoryEntry {
+    std::string name;
+    std::string path;
+    bool isDirectory = false;
+    uint64_t size = 0;
+    int64_t modified = 0;       // mtime in nanoseconds; 0 for directories
+};
+
+class DirectoryScanner {
+public:
+    static constexpr size_t BATCH_SIZE = 64;
+
+    explicit DirectoryScanner(TaskScheduler& scheduler);
+    ~DirectoryScanner();
+
+    DirectoryScanner(const DirectoryScanner&) = delete;
+    DirectoryScanner& operator=(const DirectoryScanner&) = delete;
+
+    // List `directory` (subdirectories plus files whose lowercase extension is in
+    // `extensions`, all files when empty); supersedes any scan in flight
+    uint64_t start(const std::string& directory, const std::vector<std::string>& extensions,
+                   bool showHidden = false);
+    void cancel();
+
+    // Append entries listed since the last call; never blocks on the scan
+    size_t take(std::vector<DirectoryEntry>& out);
+
+    // The current scan has listed everything and every entry has been taken
+    bool isFinished() const;
+    uint64_t getGeneration() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        OpenFailed = 1,     // Directory missing or unreadable
+        ReadFailed = 2      // Listing stopped part-way
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    struct Shared;
+
+    static void scan(const std::shared_ptr<Shared>& shared, uint64_t generation, const std::string& directory,
+                     const std::vector<std::string>& extensions, bool showHidden);
+
+    TaskScheduler& m_scheduler;
+    std::shared_ptr<Shared> m_shared;
+};
@@ -0,0 +1,32 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: FileDescriptor.h
+ * Description: Read-only file descriptor closed when it goes out of scope
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+class FileDescriptor {
+public:
+    // -1 from get() when the open failed; errno is left as open() set it
+    explicit FileDescriptor(const std::string& path)
+        : m_fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+    }
+    ~FileDescriptor() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int get() const { return m_fd; }
+
+private:
+    int m_fd;
+};
@@ -6,75 +6,21 @@
  */
 
 #include "FileUtils.h"
-#include <iostream>
+#include "Logger.h"
+#include "MetadataCache.h"
+#include "MountGuard.h"
+#include <cerrno>
 #include <fstream>
-#include <sstream>
 #include <cstdlib>
 #include <algorithm>
-#include <regex>
 
 // Supported image formats
 const std::vector<std::string> FileUtils::SUPPORTED_IMAGE_FORMATS = {
     ".png", ".jpg", ".jpeg", ".bmp", ".tiff", ".webp", ".gif"
 };
 
-std::string FileUtils::openFileDialog(const std::string& title, const std::string& defaultPath,
-                                     const std::vector<std::string>& filters) {
-    // Use zenity for file dialog on Linux with proper error handling
-    
-    std::string command = "zenity --file-selection --title=\"" + title + "\"";
-    
-    if (!defaultPath.empty()) {
-        // Validate default path exists before using it
-        if (fileExists(defaultPath)) {
-            command += " --filename=\"" + defaultPath + "\"";
-        }
-    }
-    
-    // Add file filters
-    if (!filters.empty()) {
-        command += " --file-filter=\"Image files";
-        for (const auto& filter : filters) {
-            command += " *" + filter;
-        }
-        command += "|All files *";
-        command += "\"";
-    }
-    
-    std::string result = executeFileDialog(command);
-    
-    // Validate result path exists and is accessible
-    if (!result.empty() && !fileExists(result)) {
-        return ""; // Return empty if file doesn't exist
-    }
-    
-    return result;
-}
-
-std::string FileUtils::saveFileDialog(const std::string& title, const std::string& defaultPath,
-                                     const std::vector<std::string>& filters) {
-    // Use zenity for save dialog on Linux
-    std::string command = "zenity --file-selection --save --title=\"" + title + "\"";
-    
-    if (!defaultPath.empty()) {
-        command += " --filename=\"" + defaultPath + "\"";
-    }
-    
-    // Add file filters
-    if (!filters.empty()) {
-        command += " --file-filter=\"";
-        for (const auto& filter : filters) {
-            command += "*" + filter + " ";
-        }
-        command += "|All files *";
-        command += "\"";
-    }
-    
-    return executeFileDialog(command);
-}
-
 bool FileUtils::fileExists(const std::string& path) {
-    return std::filesystem::exists(path);
+    return MetadataCache::instance().exists(path);
 }
 
 bool FileUtils::isImageFile(const std::string& path) {
@@ -109,36 +55,40 @@ std::string FileUtils::getDirectory(const std::string& path) {
 }
 
 std::vector<std::string> FileUtils::getImageFilesInDirectory(const std::string& directory) {
+    bool complete = true;
+    std::vector<std::string> imageFiles = getImageFilesInDirectory(directory, complete);
+    if (!complete) {
+        CAITHE_LOG_WARNING("Listing of {} timed out; using {} files found so far", directory, imageFiles.size());
+    }
+    return imageFiles;
+}
+
+std::vector<std::string> FileUtils::getImageFilesInDirectory(const std::string& directory, bool& complete) {
     std::vector<std::string> imageFiles;
+    complete = true;
     
     // Mathematical validation: check directory exists and is accessible
     // Time complexity: O(1) for existence check, O(n) for directory traversal
-    if (!std::filesystem::exists(directory)) {
+    const FileMetadata metadata = MetadataCache::instance().stat(directory);
+    if (!metadata.isDirectory) {
+        complete = metadata.error != ETIMEDOUT;
         return imageFiles;
     }
     
-    try {
-        // Depth-first search for image files
-        // Mathematical approach: traverse directory tree with O(V + E) complexity
-        // where V is vertices (directories), E is edges (files)
-        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
-            if (entry.is_regular_file() && isImageFile(entry.path().string())) {
-                // Validate file is actually readable
-                std::ifstream testFile(entry.path());
-                if (testFile.good()) {
-                    imageFiles.push_back(entry.path().string());
-                }
-                testFile.close();
+    // The filter runs where the listing runs (a MountGuard worker on network mounts), so it
+    // must not throw and must not touch anything the caller owns
+    // Mathematical sorting: O(n log n) complexity, done by listDirectory
+    const IoStatus status = MountGuard::instance().listDirectory(directory,
+        [](const std::filesystem::directory_entry& entry) {
+            std::error_code error;
+            if (!entry.is_regular_file(error) || !isImageFile(entry.path().string())) {
+                return false;
             }
-        }
-        
-        // Sort files alphabetically for consistent ordering
-        // Mathematical sorting: O(n log n) complexity
-        std::sort(imageFiles.begin(), imageFiles.end());
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error reading directory: " << e.what() << std::endl;
-    }
+            // Validate file is actually readable
+            std::ifstream testFile(entry.path());
+            return testFile.good();
+        }, imageFiles);
+    complete = status == IoStatus::Ok;
     
     return imageFiles;
 }
@@ -146,18 +96,16 @@ std::vector<std::string> FileUtils::getImageFilesInDirectory(const std::string&
 std::vector<std::string> FileUtils::getSubdirectories(const std::string& directory) {
     std::vector<std::string> subdirs;
     
-    if (!std::filesystem::exists(directory)) {
+    if (!MetadataCache::instance().isDirectory(directory)) {
         return subdirs;
     }
     
-    try {
-        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
-            if (entry.is_directory()) {
-                subdirs.push_back(entry.path().string());
-            }
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error reading directory: " << e.what() << std::endl;
+    if (MountGuard::instance().listDirectory(directory,
+            [](const std::filesystem::directory_entry& entry) {
+                std::error_code error;
+                return entry.is_directory(error);
+            }, subdirs) != IoStatus::Ok) {
+        CAITHE_LOG_WARNING("Listing of {} timed out; subdirectories are partial", directory);
     }
     
     return subdirs;
@@ -167,7 +115,7 @@ bool FileUtils::createDirectory(const std::string& path) {
     try {
         return std::filesystem::create_directories(path);
     } catch (const std::exception& e) {
-        std::cerr << "Error creating directory: " << e.what() << std::endl;
+        CAITHE_LOG_ERROR("Error creating directory: {}", e.what());
         return false;
     }
 }
@@ -191,13 +139,11 @@ std::string FileUtils::expandPath(const std::string& path) {
 }
 
 std::string FileUtils::normalizePath(const std::string& path) {
-    try {
-        std::filesystem::path filePath(path);
-        return std::filesystem::canonical(filePath).string();
-    } catch (const std::exception& e) {
-        // If canonical fails, return the original path
-        return path;
-    }
+    // Cached: resolving walks every component with lstat/readlink
+    const std::string canonical = MetadataCache::instance().canonical(path);
+    
+    // If resolution fails, return the original path
+    return canonical.empty() ? path : canonical;
 }
 
 std::string FileUtils::getHomeDirectory() {
@@ -217,46 +163,3 @@ std::string FileUtils::getConfigDirectory() {
 const std::vector<std::string>& FileUtils::getSupportedImageFormats() {
     return SUPPORTED_IMAGE_FORMATS;
 }
-
-std::string FileUtils::executeFileDialog(const std::string& command) {
-    std::string result;
-    
-    // Use popen to execute command and capture output
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) {
-        return "";
-    }
-    
-    char buffer[128];
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
-    }
-    
-    int status = pclose(pipe);
-    
-    // Remove trailing newline
-    if (!result.empty() && result[result.length() - 1] == '\n') {
-        result.erase(result.length() - 1);
-    }
-    
-    // Check if dialog was cancelled (zenity returns 1 on cancel)
-    if (status != 0) {
-        return "";
-    }
-    
-    return result;
-}
-
-std::vector<std::string> FileUtils::parseFileDialogOutput(const std::string& output) {
-    std::vector<std::string> files;
-    std::istringstream stream(output);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
-        if (!line.empty()) {
-            files.push_back(line);
-        }
-    }
-    
-    return files;
-} 
\ No newline at end of file
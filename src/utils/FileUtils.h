@@ -15,15 +15,6 @@
 
 class FileUtils {
 public:
-    // File dialog operations
-    static std::string openFileDialog(const std::string& title = "Select Wallpaper",
-                                     const std::string& defaultPath = "",
-                                     const std::vector<std::string>& filters = {});
-    
-    static std::string saveFileDialog(const std::string& title = "Save Settings",
-                                     const std::string& defaultPath = "",
-                                     const std::vector<std::string>& filters = {});
-    
     // File operations
     static bool fileExists(const std::string& path);
     static bool isImageFile(const std::string& path);
@@ -33,6 +24,8 @@ public:
     
     // Directory operations
     static std::vector<std::string> getImageFilesInDirectory(const std::string& directory);
+    // `complete` is false when a network mount overran its deadline; the files listed so far are returned
+    static std::vector<std::string> getImageFilesInDirectory(const std::string& directory, bool& complete);
     static std::vector<std::string> getSubdirectories(const std::string& directory);
     static bool createDirectory(const std::string& path);
     
@@ -46,10 +39,6 @@ public:
     static const std::vector<std::string>& getSupportedImageFormats();
     
 private:
-    // Internal helper methods
-    static std::string executeFileDialog(const std::string& command);
-    static std::vector<std::string> parseFileDialogOutput(const std::string& output);
-    
     // Supported formats
     static const std::vector<std::string> SUPPORTED_IMAGE_FORMATS;
 }; 
\ No newline at end of file
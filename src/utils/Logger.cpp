@@ -0,0 +1,457 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: Logger.cpp
+ * Description: Implementation of the per-thread record rings and the background writer
+ */
+
+#include "Logger.h"
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::mutex Logger::s_siteMutex;
+std::deque<Logger::Site> Logger::s_sites;
+
+namespace {
+
+// Copy `size` bytes starting at ring position `position`, wrapping at the end of the buffer
+void copyFromRing(const uint8_t* ring, size_t capacity, uint64_t position, uint8_t* out, size_t size) {
+    const size_t offset = static_cast<size_t>(position % capacity);
+    const size_t first = std::min(size, capacity - offset);
+    std::memcpy(out, ring + offset, first);
+    std::memcpy(out + first, ring, size - first);
+}
+
+bool writeAll(int fd, const std::string& text) {
+    size_t written = 0;
+    while (written < text.size()) {
+        const ssize_t count = ::write(fd, text.data() + written, text.size() - written);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+} // namespace
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : m_level(static_cast<uint8_t>(LogLevel::Info))
+    , m_stderrLevel(static_cast<uint8_t>(LogLevel::Info))
+    , m_nextThread(1)
+    , m_flushRequested(0)
+    , m_flushCompleted(0)
+    , m_stopping(false)
+    , m_fileFd(-1)
+    , m_fileBytes(0)
+    , m_maxFileBytes(DEFAULT_MAX_FILE_BYTES)
+    , m_keepFiles(DEFAULT_KEEP_FILES)
+    , m_sequence(0)
+    , m_lastErrorCode(ErrorCode::None) {
+    m_writer = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_writer.joinable()) {
+        m_writer.join();      // The last pass drains every ring
+    }
+    if (m_fileFd >= 0) {
+        ::close(m_fileFd);
+    }
+}
+
+uint32_t Logger::registerSite(LogLevel level, const char* format, const char* file, int line) {
+    std::lock_guard<std::mutex> lock(s_siteMutex);
+    s_sites.push_back(Site{ level, format, file, line });
+    return static_cast<uint32_t>(s_sites.size() - 1);
+}
+
+void Logger::setLevel(LogLevel level) {
+    m_level.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() const {
+    return static_cast<LogLevel>(m_level.load(std::memory_order_relaxed));
+}
+
+void Logger::setStderrLevel(LogLevel level) {
+    m_stderrLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+bool Logger::setFile(const std::string& path, size_t maxBytes, size_t keepFiles) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fileFd >= 0) {
+        ::close(m_fileFd);
+        m_fileFd = -1;
+    }
+    m_filePath = path;
+    m_maxFileBytes = std::max<size_t>(maxBytes, MAX_RECORD_BYTES * 4);
+    m_keepFiles = keepFiles;
+    m_fileBytes = 0;
+    if (path.empty()) {
+        return true;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    m_fileFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fileFd < 0) {
+        return setError(ErrorCode::OpenFailed, "Cannot open log file " + path + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    if (::fstat(m_fileFd, &info) == 0) {
+        m_fileBytes = static_cast<size_t>(info.st_size);
+    }
+    return true;
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const uint64_t target = ++m_flushRequested;
+    m_wake.notify_one();
+    m_flushed.wait(lock, [this, target] { return m_flushCompleted >= target; });
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warning: return "WARN";
+        case LogLevel::Error: return "ERROR";
+        case LogLevel::Off: return "OFF";
+    }
+    return "?";
+}
+
+LogLevel Logger::parseLevel(const std::string& name, LogLevel fallback) {
+    std::string lower;
+    for (const char c : name) {
+        lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (lower == "debug") return LogLevel::Debug;
+    if (lower == "info") return LogLevel::Info;
+    if (lower == "warning" || lower == "warn") return LogLevel::Warning;
+    if (lower == "error") return LogLevel::Error;
+    if (lower == "off" || lower == "none") return LogLevel::Off;
+    return fallback;
+}
+
+Logger::Stats Logger::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.threads = m_rings.size();
+    for (const std::shared_ptr<Ring>& ring : m_rings) {
+        stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+std::string Logger::getLastError() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+Logger::ErrorCode Logger::getLastErrorCode() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastErrorCode;
+}
+
+void Logger::clearError() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+Logger::Ring& Logger::threadRing() {
+    // The thread only marks its ring retired on exit; the writer frees it once drained
+    struct Holder {
+        std::shared_ptr<Ring> ring;
+        ~Holder() {
+            if (ring) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Holder holder;
+    if (!holder.ring) {
+        auto ring = std::make_shared<Ring>();
+        ring->data.reset(new uint8_t[RING_BYTES]);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ring->thread = m_nextThread++;
+        m_rings.push_back(ring);
+        holder.ring = std::move(ring);
+    }
+    return *holder.ring;
+}
+
+void Logger::push(uint8_t* record, size_t size) {
+    Ring& ring = threadRing();
+    std::memcpy(record + 16, &ring.thread, sizeof(ring.thread));
+
+    const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    const uint64_t head = ring.head.load(std::memory_order_acquire);
+    if (RING_BYTES - (tail - head) < size) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const size_t offset = static_cast<size_t>(tail % RING_BYTES);
+    const size_t first = std::min(size, RING_BYTES - offset);
+    std::memcpy(ring.data.get() + offset, record, first);
+    std::memcpy(ring.data.get(), record + first, size - first);
+    ring.tail.store(tail + size, std::memory_order_release);
+}
+
+void Logger::writerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this] {
+            return m_stopping || m_flushRequested != m_flushCompleted;
+        });
+        const uint64_t flushTarget = m_flushRequested;
+        const bool stopping = m_stopping;
+        lock.unlock();
+
+        std::vector<Pending> batch;
+        drain(batch);
+        writeBatch(batch);
+
+        lock.lock();
+        m_flushCompleted = flushTarget;
+        m_flushed.notify_all();
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void Logger::drain(std::vector<Pending>& batch) {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        rings = m_rings;
+    }
+
+    std::vector<Ring*> finished;
+    for (const std::shared_ptr<Ring>& ring : rings) {
+        // Read retired first: a ring retired before its last drain has nothing left after it
+        const bool retired = ring->retired.load(std::memory_order_acquire);
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        while (head < tail) {
+            uint32_t size = 0;
+            copyFromRing(ring->data.get(), RING_BYTES, head, reinterpret_cast<uint8_t*>(&size), sizeof(size));
+            Pending pending;
+            pending.record.resize(size);
+            copyFromRing(ring->data.get(), RING_BYTES, head, pending.record.data(), size);
+            std::memcpy(&pending.timestamp, pending.record.data() + 8, sizeof(pending.timestamp));
+            pending.sequence = m_sequence++;
+            batch.push_back(std::move(pending));
+            head += size;
+        }
+        ring->head.store(head, std::memory_order_release);
+        if (retired) {
+            finished.push_back(ring.get());
+        }
+    }
+
+    if (!finished.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), [&finished, this](const std::shared_ptr<Ring>& ring) {
+            if (std::find(finished.begin(), finished.end(), ring.get()) == finished.end()) {
+                return false;
+            }
+            m_stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+            return true;
+        }), m_rings.end());
+    }
+}
+
+void Logger::writeBatch(std::vector<Pending>& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    std::sort(batch.begin(), batch.end(), [](const Pending& a, const Pending& b) {
+        return a.timestamp != b.timestamp ? a.timestamp < b.timestamp : a.sequence < b.sequence;
+    });
+
+    const uint8_t stderrLevel = m_stderrLevel.load(std::memory_order_relaxed);
+    std::string fileText;
+    std::string stderrText;
+    for (const Pending& pending : batch) {
+        uint32_t site = 0;
+        std::memcpy(&site, pending.record.data() + 4, sizeof(site));
+        LogLevel level;
+        {
+            std::lock_guard<std::mutex> lock(s_siteMutex);
+            level = s_sites[site].level;
+        }
+        const std::string line = formatRecord(pending.record.data(), pending.record.size());
+        fileText += line;
+        if (static_cast<uint8_t>(level) >= stderrLevel) {
+            stderrText += line;
+        }
+    }
+
+    if (!stderrText.empty()) {
+        writeAll(STDERR_FILENO, stderrText);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.records += batch.size();
+    writeFile(fileText);
+}
+
+std::string Logger::formatRecord(const uint8_t* record, size_t size) const {
+    uint32_t siteId = 0;
+    uint64_t timestamp = 0;
+    uint32_t thread = 0;
+    std::memcpy(&siteId, record + 4, sizeof(siteId));
+    std::memcpy(&timestamp, record + 8, sizeof(timestamp));
+    std::memcpy(&thread, record + 16, sizeof(thread));
+    Site site;
+    {
+        std::lock_guard<std::mutex> lock(s_siteMutex);
+        site = s_sites[siteId];
+    }
+
+    std::vector<std::string> args;
+    for (size_t offset = RECORD_HEADER_BYTES; offset < size;) {
+        const ArgType type = static_cast<ArgType>(record[offset++]);
+        char text[64];
+        switch (type) {
+            case ArgType::Int: {
+                int64_t value;
+                std::memcpy(&value, record + offset, sizeof(value));
+                offset += sizeof(value);
+                args.push_back(std::to_string(value));
+                break;
+            }
+            case ArgType::UInt: {
+                uint64_t value;
+                std::memcpy(&value, record + offset, sizeof(value));
+                offset += sizeof(value);
+                args.push_back(std::to_string(value));
+                break;
+            }
+            case ArgType::Double: {
+                double value;
+                std::memcpy(&value, record + offset, sizeof(value));
+                offset += sizeof(value);
+                std::snprintf(text, sizeof(text), "%g", value);
+                args.push_back(text);
+                break;
+            }
+            case ArgType::Bool:
+                args.push_back(record[offset++] ? "true" : "false");
+                break;
+            case ArgType::Char:
+                args.push_back(std::string(1, static_cast<char>(record[offset++])));
+                break;
+            case ArgType::String: {
+                uint16_t length;
+                std::memcpy(&length, record + offset, sizeof(length));
+                offset += sizeof(length);
+                args.push_back(std::string(reinterpret_cast<const char*>(record + offset), length));
+                offset += length;
+                break;
+            }
+            default:
+                offset = size;      // Corrupt record: print what was decoded
+                break;
+        }
+    }
+
+    const time_t seconds = static_cast<time_t>(timestamp / 1000000000);
+    struct tm local;
+    localtime_r(&seconds, &local);
+    char prefix[64];
+    const size_t prefixLength = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(prefix + prefixLength, sizeof(prefix) - prefixLength, ".%03u %-5s [t%u] ",
+                  static_cast<unsigned>(timestamp / 1000000 % 1000), levelName(site.level), thread);
+
+    std::string line = prefix;
+    size_t next = 0;
+    for (const char* p = site.format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            line += next < args.size() ? args[next] : std::string("{}");
+            ++next;
+            ++p;
+        } else {
+            line += *p;
+        }
+    }
+    if (site.level == LogLevel::Debug) {
+        const char* slash = std::strrchr(site.file, '/');
+        line += " (" + std::string(slash ? slash + 1 : site.file) + ":" + std::to_string(site.line) + ")";
+    }
+    line += '\n';
+    return line;
+}
+
+void Logger::writeFile(const std::string& text) {
+    if (m_fileFd < 0 || text.empty()) {
+        return;
+    }
+    if (m_fileBytes > 0 && m_fileBytes + text.size() > m_maxFileBytes) {
+        rotate();
+        if (m_fileFd < 0) {
+            return;
+        }
+    }
+    if (!writeAll(m_fileFd, text)) {
+        setError(ErrorCode::WriteFailed, "Cannot write log file " + m_filePath + ": " + std::strerror(errno));
+        return;
+    }
+    m_fileBytes += text.size();
+    m_stats.bytesWritten += text.size();
+}
+
+void Logger::rotate() {
+    ::close(m_fileFd);
+    m_fileFd = -1;
+    if (m_keepFiles == 0) {
+        ::unlink(m_filePath.c_str());
+    } else {
+        for (size_t i = m_keepFiles; i > 1; --i) {
+            ::rename((m_filePath + "." + std::to_string(i - 1)).c_str(), (m_filePath + "." + std::to_string(i)).c_str());
+        }
+        ::rename(m_filePath.c_str(), (m_filePath + ".1").c_str());
+    }
+    m_fileFd = ::open(m_filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    m_fileBytes = 0;
+    ++m_stats.rotations;
+    if (m_fileFd < 0) {
+        setError(ErrorCode::OpenFailed, "Cannot reopen log file " + m_filePath + ": " + std::strerror(errno));
+    }
+}
+
+bool Logger::setError(ErrorCode code, const std::string& message) {
+    m_lastErrorCode = code;
+    m_lastError = message;
+    return false;
+}
+
+uint64_t Logger::nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
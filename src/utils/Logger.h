@@ -0,0 +1,271 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: Logger.h
+ * Description: Binary logging into per-thread lock-free rings with deferred formatting
+ *
+ * Strategy:
+ * - Each call site registers its level, format string and location once (a function-local
+ *   static in the macro) and gets a format id; a log call only copies the id, a timestamp
+ *   and its raw arguments into a compact record, with no formatting and no allocation
+ * - Records go into a ring owned by the calling thread: single producer, single consumer,
+ *   so a write is two atomic loads, a memcpy and a release store. A full ring drops the
+ *   record and counts it rather than blocking a render or apply path
+ * - A background thread drains every ring each FLUSH_INTERVAL_MS, orders the batch by
+ *   timestamp, expands "{}" placeholders and writes each batch with one write() per sink
+ * - The file sink rotates at a size limit (caithe.log -> caithe.log.1 -> ...); stderr gets
+ *   records at or above its own level, so warnings still show in a terminal
+ * - A disabled level costs one relaxed atomic load at the call site; arguments are not
+ *   evaluated
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warning = 2,
+    Error = 3,
+    Off = 4
+};
+
+class Logger {
+public:
+    static constexpr size_t RING_BYTES = 64 * 1024;             // Per logging thread
+    static constexpr size_t MAX_RECORD_BYTES = 1024;
+    static constexpr size_t MAX_STRING_BYTES = 512;             // Longer string arguments are cut
+    static constexpr int FLUSH_INTERVAL_MS = 50;
+    static constexpr size_t DEFAULT_MAX_FILE_BYTES = 4 * 1024 * 1024;
+    static constexpr size_t DEFAULT_KEEP_FILES = 3;
+
+    static Logger& instance();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Format id of a call site; the strings must outlive the process (literals)
+    static uint32_t registerSite(LogLevel level, const char* format, const char* file, int line);
+
+    bool isEnabled(LogLevel level) const {
+        return static_cast<uint8_t>(level) >= m_level.load(std::memory_order_relaxed);
+    }
+
+    // Record an event of a registered site. Arguments: integers, enums, floating point,
+    // bool, char, C strings, std::string and std::string_view.
+    template <class... Args>
+    void log(uint32_t site, const Args&... args);
+
+    void setLevel(LogLevel level);
+    LogLevel getLevel() const;
+    void setStderrLevel(LogLevel level);
+
+    // Empty path disables the file sink
+    bool setFile(const std::string& path, size_t maxBytes = DEFAULT_MAX_FILE_BYTES,
+                 size_t keepFiles = DEFAULT_KEEP_FILES);
+
+    // Block until everything logged before the call has been written
+    void flush();
+
+    static const char* levelName(LogLevel level);
+    static LogLevel parseLevel(const std::string& name, LogLevel fallback);
+
+    struct Stats {
+        uint64_t records = 0;           // Written to the sinks
+        uint64_t dropped = 0;           // Lost to a full ring
+        uint64_t bytesWritten = 0;      // File sink
+        uint64_t rotations = 0;
+        size_t threads = 0;             // Rings currently registered
+    };
+    Stats getStats() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        OpenFailed = 1,
+        WriteFailed = 2
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    enum class ArgType : uint8_t {
+        Int = 0,
+        UInt = 1,
+        Double = 2,
+        Bool = 3,
+        Char = 4,
+        String = 5
+    };
+
+    // Record layout: size (u32), site (u32), timestamp ns (u64), thread (u32), then per
+    // argument a type byte and its payload (strings: u16 length and bytes)
+    static constexpr size_t RECORD_HEADER_BYTES = 20;
+
+    class RecordWriter {
+    public:
+        explicit RecordWriter(uint8_t* data) : m_data(data), m_size(RECORD_HEADER_BYTES) {}
+
+        template <class T>
+        void put(const T& value) {
+            using Type = std::decay_t<T>;
+            if constexpr (std::is_same_v<Type, bool>) {
+                putScalar(ArgType::Bool, static_cast<uint8_t>(value));
+            } else if constexpr (std::is_same_v<Type, char>) {
+                putScalar(ArgType::Char, value);
+            } else if constexpr (std::is_enum_v<Type>) {
+                put(static_cast<std::underlying_type_t<Type>>(value));
+            } else if constexpr (std::is_integral_v<Type> && std::is_signed_v<Type>) {
+                putScalar(ArgType::Int, static_cast<int64_t>(value));
+            } else if constexpr (std::is_integral_v<Type>) {
+                putScalar(ArgType::UInt, static_cast<uint64_t>(value));
+            } else if constexpr (std::is_floating_point_v<Type>) {
+                putScalar(ArgType::Double, static_cast<double>(value));
+            } else if constexpr (std::is_array_v<T>) {
+                putString(std::string_view(value));
+            } else if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>) {
+                putString(value ? std::string_view(value) : std::string_view("(null)"));
+            } else if constexpr (std::is_convertible_v<const Type&, std::string_view>) {
+                putString(std::string_view(value));
+            } else {
+                static_assert(std::is_arithmetic_v<Type>, "Unsupported log argument type");
+            }
+        }
+
+        size_t size() const { return m_size; }
+
+    private:
+        template <class T>
+        void putScalar(ArgType type, T value) {
+            if (m_size + 1 + sizeof(T) > MAX_RECORD_BYTES) {
+                return;
+            }
+            m_data[m_size++] = static_cast<uint8_t>(type);
+            std::memcpy(m_data + m_size, &value, sizeof(T));
+            m_size += sizeof(T);
+        }
+
+        void putString(std::string_view text) {
+            if (m_size + 3 > MAX_RECORD_BYTES) {
+                return;
+            }
+            const size_t length = std::min({ text.size(), MAX_STRING_BYTES, MAX_RECORD_BYTES - m_size - 3 });
+            const uint16_t stored = static_cast<uint16_t>(length);
+            m_data[m_size++] = static_cast<uint8_t>(ArgType::String);
+            std::memcpy(m_data + m_size, &stored, sizeof(stored));
+            std::memcpy(m_data + m_size + sizeof(stored), text.data(), length);
+            m_size += sizeof(stored) + length;
+        }
+
+        uint8_t* m_data;
+        size_t m_size;
+    };
+
+    // Single-producer (the owning thread), single-consumer (the writer thread) byte ring
+    struct Ring {
+        std::unique_ptr<uint8_t[]> data;
+        uint32_t thread = 0;
+        alignas(64) std::atomic<uint64_t> head{0};      // Consumer position
+        alignas(64) std::atomic<uint64_t> tail{0};      // Producer position
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> retired{false};               // Owning thread exited
+    };
+
+    struct Site {
+        LogLevel level;
+        const char* format;
+        const char* file;
+        int line;
+    };
+
+    struct Pending {
+        uint64_t timestamp;
+        uint64_t sequence;
+        std::vector<uint8_t> record;
+    };
+
+    Logger();
+    ~Logger();
+
+    Ring& threadRing();
+    void push(uint8_t* record, size_t size);
+    void writerLoop();
+    void drain(std::vector<Pending>& batch);
+    void writeBatch(std::vector<Pending>& batch);
+    std::string formatRecord(const uint8_t* record, size_t size) const;
+    void writeFile(const std::string& text);
+    void rotate();
+    bool setError(ErrorCode code, const std::string& message);
+
+    static uint64_t nowNs();
+
+    std::atomic<uint8_t> m_level;
+    std::atomic<uint8_t> m_stderrLevel;
+
+    mutable std::mutex m_mutex;                         // Rings, sinks, flush state, stats
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+    std::vector<std::shared_ptr<Ring>> m_rings;
+    uint32_t m_nextThread;
+    uint64_t m_flushRequested;
+    uint64_t m_flushCompleted;
+    bool m_stopping;
+
+    std::string m_filePath;
+    int m_fileFd;
+    size_t m_fileBytes;
+    size_t m_maxFileBytes;
+    size_t m_keepFiles;
+    Stats m_stats;
+    uint64_t m_sequence;
+
+    std::thread m_writer;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+
+    static std::mutex s_siteMutex;
+    static std::deque<Site> s_sites;
+};
+
+template <class... Args>
+void Logger::log(uint32_t site, const Args&... args) {
+    uint8_t record[MAX_RECORD_BYTES];
+    RecordWriter writer(record);
+    (writer.put(args), ...);
+
+    const uint32_t size = static_cast<uint32_t>(writer.size());
+    const uint64_t timestamp = nowNs();
+    std::memcpy(record, &size, sizeof(size));
+    std::memcpy(record + 4, &site, sizeof(site));
+    std::memcpy(record + 8, &timestamp, sizeof(timestamp));
+    push(record, size);
+}
+
+#define CAITHE_LOG(level, format, ...)                                                          \
+    do {                                                                                        \
+        if (Logger::instance().isEnabled(level)) {                                              \
+            static const uint32_t caitheLogSite = Logger::registerSite(level, format, __FILE__, __LINE__); \
+            Logger::instance().log(caitheLogSite, ##__VA_ARGS__);                               \
+        }                                                                                       \
+    } while (0)
+
+#define CAITHE_LOG_DEBUG(format, ...) CAITHE_LOG(LogLevel::Debug, format, ##__VA_ARGS__)
+#define CAITHE_LOG_INFO(format, ...) CAITHE_LOG(LogLevel::Info, format, ##__VA_ARGS__)
+#define CAITHE_LOG_WARNING(format, ...) CAITHE_LOG(LogLevel::Warning, format, ##__VA_ARGS__)
+#define CAITHE_LOG_ERROR(format, ...) CAITHE_LOG(LogLevel::Error, format, ##__VA_ARGS__)
@@ -0,0 +1,402 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: MetadataCache.cpp
+ * Description: Implementation of the statx/canonical cache and its inotify watcher
+ */
+
+#include "MetadataCache.h"
+#include "MountGuard.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_MODIFY |
+                                IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+std::string trimTrailingSlashes(const std::string& path) {
+    std::string trimmed = path;
+    while (trimmed.size() > 1 && trimmed.back() == '/') {
+        trimmed.pop_back();
+    }
+    return trimmed;
+}
+
+std::string parentOf(const std::string& path) {
+    const size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) {
+        return std::string();
+    }
+    return slash == 0 ? std::string("/") : path.substr(0, slash);
+}
+
+} // namespace
+
+MetadataCache& MetadataCache::instance() {
+    static MetadataCache cache;
+    return cache;
+}
+
+MetadataCache::MetadataCache()
+    : m_ttl(DEFAULT_TTL_MS)
+    , m_inotifyFd(-1)
+    , m_wakeFd(-1)
+    , m_lastErrorCode(ErrorCode::None) {
+}
+
+MetadataCache::~MetadataCache() {
+    if (m_watcher.joinable()) {
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+        m_watcher.join();
+    }
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+    }
+}
+
+MetadataCache::PathId MetadataCache::intern(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    slot(path);
+    return m_ids.find(path)->second;
+}
+
+FileMetadata MetadataCache::stat(const std::string& path) {
+    const Clock::time_point now = Clock::now();
+    Entry* entry;
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entry = &slot(path);
+        if (entry->hasStat) {
+            if (fresh(*entry, entry->statTime, now)) {
+                ++m_stats.hits;
+                return entry->metadata;
+            }
+            ++m_stats.expirations;
+        }
+        ++m_stats.misses;
+        version = entry->version;
+    }
+
+    // Outside the lock: one slow filesystem must not stall every other lookup. On a network
+    // mount the statx runs under the MountGuard deadline; an overrun is reported, not cached.
+    FileMetadata metadata;
+    if (MountGuard::instance().call<FileMetadata>(path, [path]() { return statPath(path); }, metadata) !=
+        IoStatus::Ok) {
+        metadata = FileMetadata();
+        metadata.error = ETIMEDOUT;
+        return metadata;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (entry->version == version) {
+        entry->metadata = metadata;
+        entry->statTime = now;
+        entry->hasStat = true;
+    }
+    return metadata;
+}
+
+bool MetadataCache::exists(const std::string& path) {
+    return stat(path).exists;
+}
+
+bool MetadataCache::isDirectory(const std::string& path) {
+    return stat(path).isDirectory;
+}
+
+bool MetadataCache::isRegularFile(const std::string& path) {
+    return stat(path).isRegularFile;
+}
+
+std::string MetadataCache::canonical(const std::string& path) {
+    const Clock::time_point now = Clock::now();
+    Entry* entry;
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entry = &slot(path);
+        if (entry->hasCanonical) {
+            if (fresh(*entry, entry->canonicalTime, now)) {
+                ++m_stats.hits;
+                return entry->canonical;
+            }
+            ++m_stats.expirations;
+        }
+        ++m_stats.misses;
+        version = entry->version;
+    }
+
+    std::string resolved;
+    if (MountGuard::instance().call<std::string>(path, [path]() { return resolvePath(path); }, resolved) !=
+        IoStatus::Ok) {
+        return std::string();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (entry->version == version) {
+        entry->canonical = resolved;
+        entry->canonicalTime = now;
+        entry->hasCanonical = true;
+    }
+    return resolved;
+}
+
+bool MetadataCache::watch(const std::string& directory) {
+    const std::string key = trimTrailingSlashes(directory);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_watchByDirectory.count(key)) {
+        return true;
+    }
+    if (m_watchByDirectory.size() >= MAX_WATCHES) {
+        return setError(ErrorCode::TooManyWatches, "Watch limit reached, " + key + " falls back to the TTL");
+    }
+    if (!startWatcher()) {
+        return false;
+    }
+    const int wd = ::inotify_add_watch(m_inotifyFd, key.c_str(), WATCH_MASK);
+    if (wd < 0) {
+        return setError(ErrorCode::WatchFailed, "Cannot watch " + key + ": " + std::strerror(errno));
+    }
+
+    // Anything cached before the watch existed may already be stale
+    m_watchByDirectory[key] = wd;
+    m_directoryByWatch[wd] = key;
+    for (Entry& entry : m_entries) {
+        if (entry.parent == key || entry.path == key) {
+            ++entry.version;
+            entry.hasStat = false;
+            entry.hasCanonical = false;
+        }
+    }
+    return true;
+}
+
+void MetadataCache::unwatch(const std::string& directory) {
+    const std::string key = trimTrailingSlashes(directory);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_watchByDirectory.find(key);
+    if (it == m_watchByDirectory.end()) {
+        return;
+    }
+    ::inotify_rm_watch(m_inotifyFd, it->second);
+    m_directoryByWatch.erase(it->second);
+    m_watchByDirectory.erase(it);
+}
+
+bool MetadataCache::isWatched(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_watchByDirectory.count(parentOf(path)) != 0 || m_watchByDirectory.count(trimTrailingSlashes(path)) != 0;
+}
+
+void MetadataCache::setTtl(std::chrono::milliseconds ttl) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ttl = ttl;
+}
+
+void MetadataCache::invalidate(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    invalidateLocked(path);
+}
+
+void MetadataCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Entry& entry : m_entries) {
+        ++entry.version;
+        entry.hasStat = false;
+        entry.hasCanonical = false;
+    }
+}
+
+MetadataCache::Stats MetadataCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.watches = m_watchByDirectory.size();
+    return stats;
+}
+
+std::string MetadataCache::getLastError() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+MetadataCache::ErrorCode MetadataCache::getLastErrorCode() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastErrorCode;
+}
+
+void MetadataCache::clearError() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastError.clear();
+    m_lastErrorCode = ErrorCode::None;
+}
+
+MetadataCache::Entry& MetadataCache::slot(const std::string& path) {
+    const auto it = m_ids.find(path);
+    if (it != m_ids.end()) {
+        return m_entries[it->second];
+    }
+    m_ids.emplace(path, static_cast<PathId>(m_entries.size()));
+    m_entries.emplace_back();
+    Entry& entry = m_entries.back();
+    entry.path = path;
+    entry.parent = parentOf(path);
+    return entry;
+}
+
+bool MetadataCache::fresh(const Entry& entry, Clock::time_point stored, Clock::time_point now) const {
+    if (m_watchByDirectory.count(entry.parent) || m_watchByDirectory.count(entry.path)) {
+        return true;
+    }
+    return now - stored < m_ttl;
+}
+
+void MetadataCache::invalidateLocked(const std::string& path) {
+    const auto it = m_ids.find(path);
+    if (it == m_ids.end()) {
+        return;
+    }
+    Entry& entry = m_entries[it->second];
+    ++entry.version;
+    if (entry.hasStat || entry.hasCanonical) {
+        ++m_stats.invalidations;
+    }
+    entry.hasStat = false;
+    entry.hasCanonical = false;
+}
+
+bool MetadataCache::startWatcher() {
+    if (m_watcher.joinable()) {
+        return true;
+    }
+    m_inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wakeFd = ::eventfd(0, EFD_CLOEXEC);
+    if (m_inotifyFd < 0 || m_wakeFd < 0) {
+        const int error = errno;
+        if (m_inotifyFd >= 0) {
+            ::close(m_inotifyFd);
+        }
+        if (m_wakeFd >= 0) {
+            ::close(m_wakeFd);
+        }
+        m_inotifyFd = -1;
+        m_wakeFd = -1;
+        return setError(ErrorCode::InotifyUnavailable, std::string("inotify unavailable: ") + std::strerror(error));
+    }
+    m_watcher = std::thread(&MetadataCache::watchLoop, this);
+    return true;
+}
+
+void MetadataCache::watchLoop() {
+    alignas(struct inotify_event) char buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+    for (;;) {
+        struct pollfd fds[2] = {{m_inotifyFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+
+        for (;;) {
+            const ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                break;      // EAGAIN: drained
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (ssize_t offset = 0; offset < length;) {
+                const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // Events were lost; nothing cached can be trusted any more
+                    for (Entry& entry : m_entries) {
+                        ++entry.version;
+                        entry.hasStat = false;
+                        entry.hasCanonical = false;
+                    }
+                    ++m_stats.invalidations;
+                    continue;
+                }
+                const auto directory = m_directoryByWatch.find(event->wd);
+                if (directory == m_directoryByWatch.end()) {
+                    continue;
+                }
+                const std::string dir = directory->second;
+                if (event->mask & IN_IGNORED) {
+                    // Directory deleted or unmounted: its entries go back to the TTL
+                    m_watchByDirectory.erase(dir);
+                    m_directoryByWatch.erase(directory);
+                    invalidateLocked(dir);
+                    continue;
+                }
+                invalidateLocked(dir);      // A changed entry changes the directory's mtime
+                if (event->len > 0) {
+                    invalidateLocked(dir == "/" ? "/" + std::string(event->name) : dir + "/" + event->name);
+                }
+            }
+        }
+    }
+}
+
+bool MetadataCache::setError(ErrorCode code, const std::string& message) {
+    m_lastError = message;
+    m_lastErrorCode = code;
+    return false;
+}
+
+std::string MetadataCache::resolvePath(const std::string& path) {
+    std::string resolved;
+    if (char* buffer = ::realpath(path.c_str(), nullptr)) {
+        resolved = buffer;
+        std::free(buffer);
+    }
+    return resolved;
+}
+
+FileMetadata MetadataCache::statPath(const std::string& path) {
+    FileMetadata metadata;
+#ifdef STATX_BASIC_STATS
+    struct statx info;
+    if (::statx(AT_FDCWD, path.c_str(), AT_STATX_SYNC_AS_STAT, STATX_TYPE | STATX_SIZE | STATX_MTIME | STATX_INO,
+                &info) != 0) {
+        metadata.error = errno;
+        return metadata;
+    }
+    metadata.exists = true;
+    metadata.isDirectory = S_ISDIR(info.stx_mode);
+    metadata.isRegularFile = S_ISREG(info.stx_mode);
+    metadata.size = info.stx_size;
+    metadata.modified = static_cast<int64_t>(info.stx_mtime.tv_sec) * 1000000000 + info.stx_mtime.tv_nsec;
+    metadata.inode = info.stx_ino;
+#else
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        metadata.error = errno;
+        return metadata;
+    }
+    metadata.exists = true;
+    metadata.isDirectory = S_ISDIR(info.st_mode);
+    metadata.isRegularFile = S_ISREG(info.st_mode);
+    metadata.size = static_cast<uint64_t>(info.st_size);
+    metadata.modified = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    metadata.inode = static_cast<uint64_t>(info.st_ino);
+#endif
+    return metadata;
+}
@@ -0,0 +1,140 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: MetadataCache.h
+ * Description: Process-wide cache of statx results and canonical paths
+ *
+ * Strategy:
+ * - Paths are interned once into stable slots; each slot holds the last statx result
+ *   (missing files included) and the canonical form, so repeated existence, type and size
+ *   checks of the same path cost a hash lookup instead of a syscall
+ * - Paths inside a watched directory stay valid until inotify reports a change to them
+ *   (create, delete, rename, write, attribute change); everything else expires after a
+ *   short TTL, since nobody tells us when it changes
+ * - The watcher thread blocks on the inotify descriptor and only takes the cache lock to
+ *   invalidate, so cache hits never touch the kernel. A queue overflow drops every entry.
+ * - A lookup that misses runs statx outside the lock and stores the result only if no
+ *   invalidation of that slot happened meanwhile, so an event is never lost to a race
+ * - Canonical forms follow the same rules; a symlink swapped in an unwatched ancestor is
+ *   noticed once the TTL runs out
+ * - Misses on network mounts go through MountGuard: a lookup that overruns its deadline
+ *   reports ETIMEDOUT (or an empty canonical form) and is not cached
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+struct FileMetadata {
+    bool exists = false;
+    bool isDirectory = false;
+    bool isRegularFile = false;
+    uint64_t size = 0;
+    int64_t modified = 0;       // mtime in nanoseconds
+    uint64_t inode = 0;
+    int error = 0;              // errno of a failed lookup (ENOENT for missing files, ETIMEDOUT on a hung mount)
+};
+
+class MetadataCache {
+public:
+    using Clock = std::chrono::steady_clock;
+    using PathId = uint32_t;
+
+    static constexpr int DEFAULT_TTL_MS = 2000;
+    static constexpr size_t MAX_WATCHES = 256;
+
+    // Shared by FileUtils, WallpaperManager and anything else that checks files
+    static MetadataCache& instance();
+
+    MetadataCache();
+    ~MetadataCache();
+
+    MetadataCache(const MetadataCache&) = delete;
+    MetadataCache& operator=(const MetadataCache&) = delete;
+
+    // Stable id for `path`; ids are never reused
+    PathId intern(const std::string& path);
+
+    // statx following symlinks, at most one syscall per change (or TTL) of `path`
+    FileMetadata stat(const std::string& path);
+    bool exists(const std::string& path);
+    bool isDirectory(const std::string& path);
+    bool isRegularFile(const std::string& path);
+
+    // Absolute path with symlinks, "." and ".." resolved; empty when `path` cannot be resolved
+    std::string canonical(const std::string& path);
+
+    // Watch `directory` so entries directly inside it are kept until inotify invalidates them
+    bool watch(const std::string& directory);
+    void unwatch(const std::string& directory);
+    bool isWatched(const std::string& path) const;
+
+    void setTtl(std::chrono::milliseconds ttl);
+    void invalidate(const std::string& path);
+    void clear();
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;            // Lookups that issued a syscall
+        uint64_t invalidations = 0;     // Entries dropped by inotify or invalidate()
+        uint64_t expirations = 0;       // Entries refreshed because their TTL ran out
+        size_t watches = 0;
+    };
+    Stats getStats() const;
+
+    // Error handling with detailed error codes
+    enum class ErrorCode {
+        None = 0,
+        InotifyUnavailable = 1,
+        WatchFailed = 2,
+        TooManyWatches = 3
+    };
+
+    std::string getLastError() const;
+    ErrorCode getLastErrorCode() const;
+    void clearError();
+
+private:
+    struct Entry {
+        std::string path;
+        std::string parent;
+        uint64_t version = 0;           // Bumped by every invalidation
+        bool hasStat = false;
+        FileMetadata metadata;
+        Clock::time_point statTime;
+        bool hasCanonical = false;
+        std::string canonical;
+        Clock::time_point canonicalTime;
+    };
+
+    Entry& slot(const std::string& path);
+    bool fresh(const Entry& entry, Clock::time_point stored, Clock::time_point now) const;
+    void invalidateLocked(const std::string& path);
+    void watchLoop();
+    bool startWatcher();
+    bool setError(ErrorCode code, const std::string& message);
+
+    static FileMetadata statPath(const std::string& path);
+    static std::string resolvePath(const std::string& path);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, PathId> m_ids;
+    std::deque<Entry> m_entries;                        // Indexed by PathId; deque keeps references stable
+    std::unordered_map<std::string, int> m_watchByDirectory;
+    std::unordered_map<int, std::string> m_directoryByWatch;
+    std::chrono::milliseconds m_ttl;
+    Stats m_stats;
+
+    int m_inotifyFd;
+    int m_wakeFd;                                       // eventfd that stops the watcher thread
+    std::thread m_watcher;
+
+    std::string m_lastError;
+    ErrorCode m_lastErrorCode;
+};
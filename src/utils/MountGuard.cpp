@@ -0,0 +1,358 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: MountGuard.cpp
+ * Description: Implementation of mount classification and the deadline I/O pool
+ */
+
+#include "MountGuard.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/vfs.h>
+
+namespace {
+
+// Mount points in mountinfo escape space, tab, newline and backslash as \ooo
+std::string unescapeMountPoint(const std::string& field) {
+    std::string result;
+    result.reserve(field.size());
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            const std::string octal = field.substr(i + 1, 3);
+            if (octal.find_first_not_of("01234567") == std::string::npos) {
+                result += static_cast<char>(std::stoi(octal, nullptr, 8));
+                i += 3;
+                continue;
+            }
+        }
+        result += field[i];
+    }
+    return result;
+}
+
+bool underMountPoint(const std::string& path, const std::string& mountPoint) {
+    if (mountPoint == "/") {
+        return !path.empty() && path[0] == '/';
+    }
+    return path.compare(0, mountPoint.size(), mountPoint) == 0 &&
+           (path.size() == mountPoint.size() || path[mountPoint.size()] == '/');
+}
+
+// Longest mount point first; among duplicates the later (overmounting) entry wins
+std::vector<MountInfo> parseMountinfo(const std::string& mountinfoPath) {
+    std::ifstream file(mountinfoPath);
+    std::vector<MountInfo> mounts;
+    std::string line;
+    while (std::getline(file, line)) {
+        // id parent major:minor root mountpoint options [optional...] - fstype source superoptions
+        std::istringstream fields(line);
+        std::string id, parent, device, root, mountPoint;
+        if (!(fields >> id >> parent >> device >> root >> mountPoint)) {
+            continue;
+        }
+        std::string field;
+        while (fields >> field && field != "-") {
+        }
+        MountInfo mount;
+        mount.mountPoint = unescapeMountPoint(mountPoint);
+        fields >> mount.fsType;
+        mounts.push_back(std::move(mount));
+    }
+
+    std::reverse(mounts.begin(), mounts.end());
+    std::stable_sort(mounts.begin(), mounts.end(), [](const MountInfo& a, const MountInfo& b) {
+        return a.mountPoint.size() > b.mountPoint.size();
+    });
+    mounts.erase(std::unique(mounts.begin(), mounts.end(), [](const MountInfo& a, const MountInfo& b) {
+        return a.mountPoint == b.mountPoint;
+    }), mounts.end());
+    return mounts;
+}
+
+} // namespace
+
+MountGuard& MountGuard::instance() {
+    static MountGuard guard;
+    return guard;
+}
+
+MountGuard::MountGuard(size_t threads)
+    : m_deadline(DEFAULT_DEADLINE_MS)
+    , m_cooldown(DEFAULT_STALL_COOLDOWN_MS)
+    , m_pool(std::make_shared<Pool>()) {
+    // Detached: a worker blocked on a dead server must not block shutdown
+    for (size_t i = 0; i < std::max<size_t>(1, threads); ++i) {
+        std::thread(&MountGuard::workerLoop, m_pool).detach();
+    }
+}
+
+MountGuard::~MountGuard() {
+    {
+        std::lock_guard<std::mutex> lock(m_pool->mutex);
+        m_pool->stopping = true;
+        m_pool->queue.clear();
+    }
+    m_pool->workAvailable.notify_all();
+}
+
+void MountGuard::setDeadline(std::chrono::milliseconds deadline) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_deadline = deadline;
+}
+
+std::chrono::milliseconds MountGuard::getDeadline() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_deadline;
+}
+
+void MountGuard::setStallCooldown(std::chrono::milliseconds cooldown) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cooldown = cooldown;
+}
+
+bool MountGuard::loadMounts(const std::string& mountinfoPath) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_mountinfoPath = mountinfoPath;
+    m_mountsLoaded = Clock::now();
+    m_mounts = parseMountinfo(mountinfoPath);
+    return !m_mounts.empty();
+}
+
+MountInfo MountGuard::mountOf(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return mountOfLocked(path);
+}
+
+bool MountGuard::isNetwork(const std::string& path) {
+    MountInfo mount;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        mount = mountOfLocked(path);
+        const auto it = m_states.find(mount.mountPoint);
+        if (mount.mountPoint.empty() || (it != m_states.end() && it->second.classified)) {
+            return !mount.mountPoint.empty() && it->second.network;
+        }
+    }
+    return classify(mount);
+}
+
+bool MountGuard::isStalled(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_states.find(mountOfLocked(path).mountPoint);
+    return it != m_states.end() && Clock::now() < it->second.stalledUntil;
+}
+
+IoStatus MountGuard::listDirectory(const std::string& directory,
+                                   std::function<bool(const std::filesystem::directory_entry&)> filter,
+                                   std::vector<std::string>& out) {
+    auto job = std::make_shared<Job>();
+    job->body = [directory, filter](Job& self) {
+        std::error_code error;
+        std::filesystem::directory_iterator it(directory, error);
+        for (const std::filesystem::directory_iterator end; !error && it != end; it.increment(error)) {
+            if (!filter(*it)) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(self.mutex);
+            if (self.abandoned) {
+                return;     // The caller already returned a partial result
+            }
+            self.listed.push_back(it->path().string());
+        }
+    };
+
+    const IoStatus status = run(directory, job);
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        out = job->listed;
+    }
+    std::sort(out.begin(), out.end());
+    return status;
+}
+
+bool MountGuard::isNetworkMagic(uint64_t magic) {
+    switch (magic) {
+        case 0x6969:        // NFS
+        case 0x517B:        // SMB
+        case 0xFF534D42:    // CIFS
+        case 0xFE534D42:    // SMB2
+        case 0x65735546:    // FUSE (sshfs, rclone, gvfs, ...)
+        case 0x01021997:    // 9P
+        case 0x00C36400:    // Ceph
+        case 0x5346414F:    // OpenAFS
+        case 0x6B414653:    // kAFS
+        case 0x73757245:    // Coda
+        case 0x564C:        // NCP
+        case 0x01161970:    // GFS2
+        case 0x7461636F:    // OCFS2
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool MountGuard::isNetworkType(const std::string& fsType) {
+    static const char* const NETWORK_TYPES[] = {
+        "nfs", "nfs4", "cifs", "smb3", "smbfs", "9p", "ceph", "afs", "glusterfs", "lustre",
+        "gfs2", "ocfs2", "coda", "ncpfs", "davfs", "sshfs"
+    };
+    if (fsType.compare(0, 4, "fuse") == 0) {
+        return true;
+    }
+    return std::find(std::begin(NETWORK_TYPES), std::end(NETWORK_TYPES), fsType) != std::end(NETWORK_TYPES);
+}
+
+MountGuard::Stats MountGuard::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    const Clock::time_point now = Clock::now();
+    stats.stalledMounts = static_cast<size_t>(std::count_if(m_states.begin(), m_states.end(),
+        [now](const auto& state) { return now < state.second.stalledUntil; }));
+    return stats;
+}
+
+IoStatus MountGuard::run(const std::string& path, const std::shared_ptr<Job>& job) {
+    if (!isNetwork(path)) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.inlineCalls;
+        }
+        job->body(*job);
+        return IoStatus::Ok;
+    }
+
+    std::string mountPoint;
+    Clock::time_point deadline;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        mountPoint = mountOfLocked(path).mountPoint;
+        const Clock::time_point now = Clock::now();
+        if (now < m_states[mountPoint].stalledUntil) {
+            ++m_stats.failedFast;
+            return IoStatus::Stalled;
+        }
+        ++m_stats.pooledCalls;
+        deadline = now + m_deadline;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_pool->mutex);
+        m_pool->queue.push_back(job);
+    }
+    m_pool->workAvailable.notify_one();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    if (job->finished.wait_until(lock, deadline, [&job]() { return job->done; })) {
+        return IoStatus::Ok;
+    }
+    job->abandoned = true;
+    const bool started = job->started;
+    lock.unlock();
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    ++m_stats.timeouts;
+    if (started) {
+        m_states[mountPoint].stalledUntil = Clock::now() + m_cooldown;
+    }
+    return IoStatus::TimedOut;
+}
+
+bool MountGuard::classify(const MountInfo& mount) {
+    bool network = isNetworkType(mount.fsType);
+    bool stalled = false;
+    if (!network) {
+        // statfs can hang on a dead server too, so it gets the same deadline treatment
+        auto magic = std::make_shared<uint64_t>(0);
+        auto job = std::make_shared<Job>();
+        const std::string mountPoint = mount.mountPoint;
+        job->body = [magic, mountPoint](Job&) {
+            struct statfs info;
+            if (::statfs(mountPoint.c_str(), &info) == 0) {
+                *magic = static_cast<uint64_t>(info.f_type);
+            }
+        };
+        Clock::time_point deadline;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            deadline = Clock::now() + m_deadline;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_pool->mutex);
+            m_pool->queue.push_back(job);
+        }
+        m_pool->workAvailable.notify_one();
+
+        std::unique_lock<std::mutex> lock(job->mutex);
+        if (job->finished.wait_until(lock, deadline, [&job]() { return job->done; })) {
+            network = isNetworkMagic(*magic);
+        } else {
+            job->abandoned = true;
+            network = true;
+            stalled = job->started;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MountState& state = m_states[mount.mountPoint];
+    state.classified = true;
+    state.network = network;
+    if (stalled) {
+        state.stalledUntil = Clock::now() + m_cooldown;
+    }
+    return network;
+}
+
+MountInfo MountGuard::mountOfLocked(const std::string& path) {
+    // Reading mountinfo never touches the mounted filesystems, so it is safe under the lock
+    const Clock::time_point now = Clock::now();
+    if (m_mountinfoPath.empty() || now - m_mountsLoaded > std::chrono::seconds(MOUNT_REFRESH_SECONDS)) {
+        if (m_mountinfoPath.empty()) {
+            m_mountinfoPath = "/proc/self/mountinfo";
+        }
+        m_mountsLoaded = now;
+        m_mounts = parseMountinfo(m_mountinfoPath);
+    }
+
+    std::string absolute = path;
+    if (absolute.empty() || absolute[0] != '/') {
+        std::error_code error;
+        absolute = (std::filesystem::current_path(error) / path).string();
+    }
+    absolute = std::filesystem::path(absolute).lexically_normal().string();
+    for (const MountInfo& mount : m_mounts) {
+        if (underMountPoint(absolute, mount.mountPoint)) {
+            return mount;
+        }
+    }
+    return MountInfo();     // Outside every known mount: treated as local
+}
+
+void MountGuard::workerLoop(std::shared_ptr<Pool> pool) {
+    for (;;) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            pool->workAvailable.wait(lock, [&pool]() { return pool->stopping || !pool->queue.empty(); });
+            if (pool->stopping) {
+                return;
+            }
+            job = std::move(pool->queue.front());
+            pool->queue.pop_front();
+        }
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            if (job->abandoned) {
+                continue;   // Its caller timed out while it was queued
+            }
+            job->started = true;
+        }
+        job->body(*job);
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            job->done = true;
+        }
+        job->finished.notify_all();
+    }
+}
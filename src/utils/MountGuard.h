@@ -0,0 +1,151 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: MountGuard.h
+ * Description: Deadline-bounded filesystem calls on network mounts
+ *
+ * Strategy:
+ * - The mount holding a path is the longest matching mount point in /proc/self/mountinfo
+ *   (reading it never touches the mounted filesystems). Each mount is classified once by
+ *   its statfs magic (NFS, SMB/CIFS, FUSE, 9P, Ceph, AFS, ...) or its mountinfo type; the
+ *   statfs itself runs under the deadline, and a mount whose statfs hangs is network
+ * - Calls on local mounts run inline. Calls on network mounts run on a small dedicated
+ *   pool (never the TaskScheduler, whose workers a hung mount would eat) and the caller
+ *   waits at most the deadline; a call that overruns keeps its thread but its result is
+ *   dropped, since a syscall stuck in the kernel cannot be cancelled
+ * - A mount that timed out is stalled for a cooldown: further calls on it fail fast
+ *   instead of tying up more pool threads, so one dead server costs one thread and one
+ *   deadline, not a frozen UI. A call that timed out while still queued (pool busy with
+ *   another mount) does not stall its own mount
+ * - Directory listings publish entries as they are read, so a listing that hits the
+ *   deadline returns everything read so far and reports itself partial
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class IoStatus {
+    Ok = 0,
+    TimedOut = 1,       // The call overran its deadline; partial results may be present
+    Stalled = 2         // Not attempted: the mount timed out recently
+};
+
+struct MountInfo {
+    std::string mountPoint;
+    std::string fsType;
+};
+
+class MountGuard {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int DEFAULT_DEADLINE_MS = 2000;
+    static constexpr int DEFAULT_STALL_COOLDOWN_MS = 15000;
+    static constexpr size_t DEFAULT_POOL_THREADS = 4;
+    static constexpr int MOUNT_REFRESH_SECONDS = 30;
+
+    // Shared by MetadataCache and FileUtils
+    static MountGuard& instance();
+
+    explicit MountGuard(size_t threads = DEFAULT_POOL_THREADS);
+    ~MountGuard();
+
+    MountGuard(const MountGuard&) = delete;
+    MountGuard& operator=(const MountGuard&) = delete;
+
+    void setDeadline(std::chrono::milliseconds deadline);
+    std::chrono::milliseconds getDeadline() const;
+    void setStallCooldown(std::chrono::milliseconds cooldown);
+
+    // Mount table source; reloaded every MOUNT_REFRESH_SECONDS
+    bool loadMounts(const std::string& mountinfoPath = "/proc/self/mountinfo");
+
+    MountInfo mountOf(const std::string& path);
+    bool isNetwork(const std::string& path);
+    bool isStalled(const std::string& path);
+
+    // Run `function` inline on local mounts, under the deadline on network mounts.
+    // `function` must own everything it touches: after a timeout it outlives the caller.
+    template <class T>
+    IoStatus call(const std::string& path, std::function<T()> function, T& result) {
+        auto slot = std::make_shared<T>();
+        auto job = std::make_shared<Job>();
+        job->body = [slot, function](Job&) { *slot = function(); };
+        const IoStatus status = run(path, job);
+        if (status == IoStatus::Ok) {
+            result = std::move(*slot);
+        }
+        return status;
+    }
+
+    // Paths in `directory` accepted by `filter` (evaluated where the listing runs), sorted.
+    // On TimedOut, `out` holds what was listed before the deadline.
+    IoStatus listDirectory(const std::string& directory,
+                           std::function<bool(const std::filesystem::directory_entry&)> filter,
+                           std::vector<std::string>& out);
+
+    static bool isNetworkMagic(uint64_t magic);
+    static bool isNetworkType(const std::string& fsType);
+
+    struct Stats {
+        uint64_t inlineCalls = 0;
+        uint64_t pooledCalls = 0;
+        uint64_t timeouts = 0;
+        uint64_t failedFast = 0;
+        size_t stalledMounts = 0;
+    };
+    Stats getStats() const;
+
+private:
+    struct Job {
+        std::function<void(Job&)> body;
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool started = false;
+        bool done = false;
+        bool abandoned = false;
+        std::vector<std::string> listed;    // Published incrementally by listings
+    };
+
+    struct MountState {
+        bool classified = false;
+        bool network = false;
+        Clock::time_point stalledUntil;
+    };
+
+    // Workers share the queue, not the guard, so a worker stuck in a hung syscall can be
+    // left behind when the guard is destroyed
+    struct Pool {
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::deque<std::shared_ptr<Job>> queue;
+        bool stopping = false;
+    };
+
+    IoStatus run(const std::string& path, const std::shared_ptr<Job>& job);
+    bool classify(const MountInfo& mount);
+    MountInfo mountOfLocked(const std::string& path);
+    static void workerLoop(std::shared_ptr<Pool> pool);
+
+    mutable std::mutex m_mutex;
+    std::vector<MountInfo> m_mounts;                    // Longest mount point first
+    std::string m_mountinfoPath;
+    Clock::time_point m_mountsLoaded;
+    std::unordered_map<std::string, MountState> m_states;
+    std::chrono::milliseconds m_deadline;
+    std::chrono::milliseconds m_cooldown;
+    Stats m_stats;
+    std::shared_ptr<Pool> m_pool;
+};
@@ -0,0 +1,185 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: PowerPolicy.cpp
+ * Description: Implementation of sysfs/PSI reading and scheduler throttling
+ */
+
+#include "PowerPolicy.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include "TaskScheduler.h"
+
+namespace {
+
+std::string readFirstLine(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    const size_t begin = line.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    return line.substr(begin, line.find_last_not_of(" \t\r") - begin + 1);
+}
+
+} // namespace
+
+bool PowerDecision::operator==(const PowerDecision& other) const {
+    return onBattery == other.onBattery && lowBattery == other.lowBattery && underPressure == other.underPressure &&
+           workerCap == other.workerCap && deferBackground == other.deferBackground && deferIdle == other.deferIdle &&
+           prefetchStretch == other.prefetchStretch;
+}
+
+std::string PowerDecision::describe() const {
+    if (!constrained()) {
+        return "full speed";
+    }
+    std::string text = onBattery ? (lowBattery ? "low battery" : "battery") : "";
+    if (underPressure) {
+        text += text.empty() ? "pressure" : ", pressure";
+    }
+    if (workerCap != 0) {
+        text += ", " + std::to_string(workerCap) + (workerCap == 1 ? " worker" : " workers");
+    }
+    if (deferBackground) {
+        text += ", background held";
+    } else if (deferIdle) {
+        text += ", idle held";
+    }
+    return text;
+}
+
+PowerPolicy::PowerPolicy()
+    : m_powerSupplyRoot("/sys/class/power_supply")
+    , m_pressureRoot("/proc/pressure")
+    , m_applied(false) {
+}
+
+PowerPolicy::~PowerPolicy() = default;
+
+void PowerPolicy::setConfig(const PowerPolicyConfig& config) {
+    m_config = config;
+    m_applied = false;
+}
+
+const PowerPolicyConfig& PowerPolicy::getConfig() const {
+    return m_config;
+}
+
+void PowerPolicy::setRoots(const std::string& powerSupplyRoot, const std::string& pressureRoot) {
+    m_powerSupplyRoot = powerSupplyRoot;
+    m_pressureRoot = pressureRoot;
+}
+
+bool PowerPolicy::update(TaskScheduler& scheduler) {
+    m_state = readState();
+    const PowerDecision decision = decide(m_state);
+    if (m_applied && decision == m_decision) {
+        return false;
+    }
+    m_decision = decision;
+    m_applied = true;
+    apply(m_decision, scheduler);
+    return true;
+}
+
+void PowerPolicy::apply(const PowerDecision& decision, TaskScheduler& scheduler) {
+    for (IoClass ioClass : {IoClass::Background, IoClass::Idle}) {
+        scheduler.setPolicyLimit(ioClass, decision.workerCap);
+    }
+    scheduler.setDeferred(IoClass::Background, decision.deferBackground);
+    scheduler.setDeferred(IoClass::Idle, decision.deferIdle || decision.deferBackground);
+}
+
+PowerDecision PowerPolicy::decide(const SystemState& state) const {
+    PowerDecision decision;
+    if (!m_config.enabled) {
+        return decision;
+    }
+
+    decision.onBattery = state.onBattery;
+    decision.lowBattery = state.onBattery && state.batteryPercent >= 0 && state.batteryPercent <= m_config.lowBatteryPercent;
+
+    // Enter at the threshold, leave below half of it
+    const double peak = std::max({state.cpuPressure, state.memoryPressure, state.ioPressure});
+    const double threshold = m_decision.underPressure && m_applied ? m_config.pressureThreshold / 2.0
+                                                                   : m_config.pressureThreshold;
+    decision.underPressure = state.pressureAvailable && m_config.pressureThreshold > 0.0 && peak >= threshold;
+
+    if (decision.onBattery) {
+        decision.workerCap = m_config.batteryWorkers;
+        decision.deferIdle = m_config.deferIdleOnBattery;
+        decision.deferBackground = decision.lowBattery;
+    }
+    if (decision.underPressure && m_config.pressureWorkers != 0) {
+        decision.workerCap = decision.workerCap == 0 ? m_config.pressureWorkers
+                                                     : std::min(decision.workerCap, m_config.pressureWorkers);
+        decision.deferIdle = true;
+    }
+    if (decision.constrained()) {
+        decision.prefetchStretch = std::max(1.0, m_config.prefetchStretch);
+    }
+    return decision;
+}
+
+SystemState PowerPolicy::readState() const {
+    SystemState state;
+    readPowerSupply(m_powerSupplyRoot, state);
+    const bool cpu = readPressure(m_pressureRoot + "/cpu", state.cpuPressure);
+    const bool memory = readPressure(m_pressureRoot + "/memory", state.memoryPressure);
+    const bool io = readPressure(m_pressureRoot + "/io", state.ioPressure);
+    state.pressureAvailable = cpu || memory || io;
+    return state;
+}
+
+const SystemState& PowerPolicy::getState() const {
+    return m_state;
+}
+
+const PowerDecision& PowerPolicy::getDecision() const {
+    return m_decision;
+}
+
+size_t PowerPolicy::scaleHorizon(size_t base) const {
+    return static_cast<size_t>(std::ceil(static_cast<double>(base) * m_decision.prefetchStretch));
+}
+
+void PowerPolicy::readPowerSupply(const std::string& root, SystemState& state) {
+    std::error_code error;
+    bool mainsOnline = false;
+    bool discharging = false;
+    for (const auto& entry : std::filesystem::directory_iterator(root, error)) {
+        const std::string type = readFirstLine(entry.path() / "type");
+        if (type == "Mains" && readFirstLine(entry.path() / "online") == "1") {
+            mainsOnline = true;
+        } else if (type == "Battery") {
+            if (readFirstLine(entry.path() / "status") == "Discharging") {
+                discharging = true;
+            }
+            const std::string capacity = readFirstLine(entry.path() / "capacity");
+            if (!capacity.empty()) {
+                const int percent = std::atoi(capacity.c_str());
+                state.batteryPercent = state.batteryPercent < 0 ? percent : std::min(state.batteryPercent, percent);
+            }
+        }
+    }
+    state.onBattery = discharging && !mainsOnline;
+}
+
+bool PowerPolicy::readPressure(const std::string& path, double& someAvg10) {
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        double value = 0.0;
+        if (std::sscanf(line.c_str(), "some avg10=%lf", &value) == 1) {
+            someAvg10 = value;
+            return true;
+        }
+    }
+    return false;
+}
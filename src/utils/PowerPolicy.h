@@ -0,0 +1,89 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: PowerPolicy.h
+ * Description: Power- and pressure-aware throttling of background work on a TaskScheduler
+ *
+ * Strategy:
+ * - Power state comes from /sys/class/power_supply: AC when any Mains supply is online,
+ *   battery when a Battery reports Discharging; capacity is the lowest battery's percent
+ * - Pressure comes from PSI (/proc/pressure/{cpu,memory,io}): the "some avg10" line is the
+ *   share of the last 10 s in which at least one task stalled on that resource
+ * - On battery or under pressure, Background and Idle classes are capped to a few workers
+ *   and prefetch horizons are stretched so work happens in fewer, larger bursts; Idle work
+ *   is held on battery and Background work as well when the battery is low
+ * - Pressure has hysteresis: it starts at the threshold and ends below half of it, so a
+ *   workload hovering at the threshold does not flip the scheduler every poll
+ * - Interactive work is never capped or held
+ * - Both roots are configurable so tests can point them at fake sysfs/procfs trees
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "ConfigManager.h"
+
+class TaskScheduler;
+
+struct SystemState {
+    bool onBattery = false;
+    int batteryPercent = -1;        // -1 when no battery reports a capacity
+    bool pressureAvailable = false; // Kernel without PSI reports no pressure
+    double cpuPressure = 0.0;       // PSI some avg10, percent
+    double memoryPressure = 0.0;
+    double ioPressure = 0.0;
+};
+
+struct PowerDecision {
+    bool onBattery = false;
+    bool lowBattery = false;
+    bool underPressure = false;
+    size_t workerCap = 0;           // Background/Idle cap; 0 = uncapped
+    bool deferBackground = false;
+    bool deferIdle = false;
+    double prefetchStretch = 1.0;
+
+    bool constrained() const { return onBattery || underPressure; }
+    bool operator==(const PowerDecision& other) const;
+    bool operator!=(const PowerDecision& other) const { return !(*this == other); }
+    // Short summary for the UI, e.g. "battery 35%, 1 worker, idle held"
+    std::string describe() const;
+};
+
+class PowerPolicy {
+public:
+    PowerPolicy();
+    ~PowerPolicy();
+
+    void setConfig(const PowerPolicyConfig& config);
+    const PowerPolicyConfig& getConfig() const;
+    void setRoots(const std::string& powerSupplyRoot, const std::string& pressureRoot);
+
+    // Read the system, decide and apply to `scheduler`; true when the decision changed
+    bool update(TaskScheduler& scheduler);
+    // Apply a decision directly (also used to restore full speed)
+    static void apply(const PowerDecision& decision, TaskScheduler& scheduler);
+
+    // Decision for a state, honouring hysteresis against the previous decision
+    PowerDecision decide(const SystemState& state) const;
+    SystemState readState() const;
+
+    const SystemState& getState() const;
+    const PowerDecision& getDecision() const;
+
+    // Stretch a prefetch horizon by the current decision
+    size_t scaleHorizon(size_t base) const;
+
+    static void readPowerSupply(const std::string& root, SystemState& state);
+    // Parse "some avg10=X ..." from a PSI file; false when missing or malformed
+    static bool readPressure(const std::string& path, double& someAvg10);
+
+private:
+    PowerPolicyConfig m_config;
+    std::string m_powerSupplyRoot;
+    std::string m_pressureRoot;
+    SystemState m_state;
+    PowerDecision m_decision;
+    bool m_applied;
+};
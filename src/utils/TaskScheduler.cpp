@@ -0,0 +1,194 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TaskScheduler.cpp
+ * Description: Implementation of the I/O-class aware worker pool
+ */
+
+#include "TaskScheduler.h"
+#include <algorithm>
+
+TaskScheduler::TaskScheduler(size_t threadCount)
+    : m_pending(0)
+    , m_stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const Clock::time_point now = Clock::now();
+    for (ClassState& state : m_classes) {
+        state.lastRefill = now;
+    }
+
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back(&TaskScheduler::workerLoop, this);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        // Deferred work still runs to completion rather than being dropped
+        for (ClassState& state : m_classes) {
+            state.deferred = false;
+        }
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void TaskScheduler::submit(IoClass ioClass, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_classes[static_cast<size_t>(ioClass)].queue.push_back(std::move(task));
+        ++m_pending;
+    }
+    m_workAvailable.notify_one();
+}
+
+void TaskScheduler::waitIdle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending == 0; });
+}
+
+void TaskScheduler::setConcurrencyLimit(IoClass ioClass, size_t maxRunning) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_classes[static_cast<size_t>(ioClass)].maxRunning = maxRunning;
+    }
+    m_workAvailable.notify_all();
+}
+
+void TaskScheduler::setRateLimit(IoClass ioClass, uint64_t bytesPerSecond) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ClassState& state = m_classes[static_cast<size_t>(ioClass)];
+    state.bytesPerSecond = bytesPerSecond;
+    state.tokens = static_cast<double>(bytesPerSecond) * RATE_BURST_SECONDS;
+    state.lastRefill = Clock::now();
+}
+
+void TaskScheduler::setDeferred(IoClass ioClass, bool deferred) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_classes[static_cast<size_t>(ioClass)].deferred = deferred;
+    }
+    m_workAvailable.notify_all();
+}
+
+bool TaskScheduler::isDeferred(IoClass ioClass) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_classes[static_cast<size_t>(ioClass)].deferred;
+}
+
+void TaskScheduler::setPolicyLimit(IoClass ioClass, size_t maxRunning) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_classes[static_cast<size_t>(ioClass)].policyLimit = maxRunning;
+    }
+    m_workAvailable.notify_all();
+}
+
+size_t TaskScheduler::getQueuedCount(IoClass ioClass) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_classes[static_cast<size_t>(ioClass)].queue.size();
+}
+
+void TaskScheduler::throttle(IoClass ioClass, uint64_t bytes) {
+    std::chrono::nanoseconds wait{0};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ClassState& state = m_classes[static_cast<size_t>(ioClass)];
+        state.stats.bytesCharged += bytes;
+        if (state.bytesPerSecond == 0) {
+            return;
+        }
+
+        const double rate = static_cast<double>(state.bytesPerSecond);
+        const Clock::time_point now = Clock::now();
+        const double elapsed = std::chrono::duration<double>(now - state.lastRefill).count();
+        state.tokens = std::min(state.tokens + elapsed * rate, rate * RATE_BURST_SECONDS);
+        state.lastRefill = now;
+
+        // Charge up front; a negative balance is repaid by sleeping
+        state.tokens -= static_cast<double>(bytes);
+        if (state.tokens < 0.0) {
+            wait = std::chrono::nanoseconds(static_cast<int64_t>(-state.tokens / rate * 1e9));
+            state.stats.throttled += wait;
+        }
+    }
+
+    if (wait.count() > 0) {
+        std::this_thread::sleep_for(wait);
+    }
+}
+
+TaskScheduler::ClassStats TaskScheduler::getStats(IoClass ioClass) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_classes[static_cast<size_t>(ioClass)].stats;
+}
+
+size_t TaskScheduler::getThreadCount() const {
+    return m_workers.size();
+}
+
+size_t TaskScheduler::effectiveLimit(const ClassState& state) {
+    if (state.maxRunning == 0 || state.policyLimit == 0) {
+        return std::max(state.maxRunning, state.policyLimit);
+    }
+    return std::min(state.maxRunning, state.policyLimit);
+}
+
+bool TaskScheduler::takeTask(std::function<void()>& task, size_t& classIndex) {
+    for (size_t i = 0; i < IO_CLASS_COUNT; ++i) {
+        ClassState& state = m_classes[i];
+        const size_t limit = effectiveLimit(state);
+        if (state.queue.empty() || state.deferred || (limit != 0 && state.running >= limit)) {
+            continue;
+        }
+        task = std::move(state.queue.front());
+        state.queue.pop_front();
+        ++state.running;
+        classIndex = i;
+        return true;
+    }
+    return false;
+}
+
+void TaskScheduler::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        std::function<void()> task;
+        size_t classIndex = 0;
+        bool taken = false;
+        m_workAvailable.wait(lock, [&] {
+            taken = takeTask(task, classIndex);
+            return taken || m_stopping;
+        });
+        if (!taken) {
+            return;     // Stopping with nothing left to run
+        }
+
+        lock.unlock();
+        if (task) {
+            task();
+        }
+        task = nullptr;
+        lock.lock();
+
+        ClassState& state = m_classes[classIndex];
+        --state.running;
+        ++state.stats.tasksCompleted;
+        if (--m_pending == 0) {
+            m_idle.notify_all();
+        }
+
+        // A capped class may have queued work that can now start
+        if (effectiveLimit(state) != 0 && !state.queue.empty()) {
+            m_workAvailable.notify_one();
+        }
+    }
+}
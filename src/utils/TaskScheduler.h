@@ -0,0 +1,107 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: TaskScheduler.h
+ * Description: Worker pool with I/O classes, per-class concurrency caps and byte-rate limits
+ *
+ * Strategy:
+ * - Tasks are queued per I/O class and dispatched strictly by class priority
+ *   (Interactive before Background before Idle), FIFO within a class
+ * - Each class may cap how many of its tasks run at once, so background indexing
+ *   can never occupy every worker an interactive request needs
+ * - Byte budgets use a token bucket that is allowed to go into debt: a caller
+ *   charges its read up front and sleeps debt / rate, which keeps long-run throughput
+ *   at the configured rate without splitting reads
+ * - A power policy can defer a class (its queue is held, running tasks finish) and cap
+ *   it independently of the configured limit; the lower of the two caps applies
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class IoClass {
+    Interactive = 0,    // User is waiting on the result
+    Background = 1,     // Indexing, hashing, pre-rendering
+    Idle = 2            // Only worth doing when nothing else is queued
+};
+
+class TaskScheduler {
+public:
+    static constexpr size_t IO_CLASS_COUNT = 3;
+
+    // threadCount 0 selects std::thread::hardware_concurrency()
+    explicit TaskScheduler(size_t threadCount = 0);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    void submit(IoClass ioClass, std::function<void()> task);
+
+    // Block until every queued and running task has finished (deferred work included)
+    void waitIdle();
+
+    // 0 removes the limit
+    void setConcurrencyLimit(IoClass ioClass, size_t maxRunning);
+    void setRateLimit(IoClass ioClass, uint64_t bytesPerSecond);
+
+    // Power policy controls: held classes start nothing new until released
+    void setDeferred(IoClass ioClass, bool deferred);
+    bool isDeferred(IoClass ioClass) const;
+    void setPolicyLimit(IoClass ioClass, size_t maxRunning);
+    size_t getQueuedCount(IoClass ioClass) const;
+
+    // Charge `bytes` of I/O to a class, sleeping if the class is over its rate
+    void throttle(IoClass ioClass, uint64_t bytes);
+
+    struct ClassStats {
+        uint64_t tasksCompleted = 0;
+        uint64_t bytesCharged = 0;
+        std::chrono::nanoseconds throttled{0};  // Total time callers slept in throttle()
+    };
+
+    ClassStats getStats(IoClass ioClass) const;
+    size_t getThreadCount() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct ClassState {
+        std::deque<std::function<void()>> queue;
+        size_t running = 0;
+        size_t maxRunning = 0;
+        size_t policyLimit = 0;
+        bool deferred = false;
+
+        uint64_t bytesPerSecond = 0;
+        double tokens = 0.0;
+        Clock::time_point lastRefill;
+
+        ClassStats stats;
+    };
+
+    void workerLoop();
+    bool takeTask(std::function<void()>& task, size_t& classIndex);
+    static size_t effectiveLimit(const ClassState& state);
+
+    std::vector<std::thread> m_workers;
+    std::array<ClassState, IO_CLASS_COUNT> m_classes;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_idle;
+    size_t m_pending;       // Queued plus running
+    bool m_stopping;
+
+    // Burst allowance of a rate-limited class, in seconds of its rate
+    static constexpr double RATE_BURST_SECONDS = 0.25;
+};
@@ -0,0 +1,156 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: Xxh64.cpp
+ * Description: Implementation of the streaming XXH64 hash
+ */
+
+#include "Xxh64.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Little-endian loads; memcpy compiles to a single move on x86/ARM
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+inline uint64_t round(uint64_t lane, uint64_t word) {
+    lane += word * PRIME2;
+    lane = rotl(lane, 31);
+    return lane * PRIME1;
+}
+
+inline uint64_t mergeRound(uint64_t hash, uint64_t lane) {
+    hash ^= round(0, lane);
+    return hash * PRIME1 + PRIME4;
+}
+
+inline void consumeStripe(uint64_t* lanes, const uint8_t* p) {
+    lanes[0] = round(lanes[0], read64(p));
+    lanes[1] = round(lanes[1], read64(p + 8));
+    lanes[2] = round(lanes[2], read64(p + 16));
+    lanes[3] = round(lanes[3], read64(p + 24));
+}
+
+} // namespace
+
+Xxh64::Xxh64(uint64_t seed) {
+    reset(seed);
+}
+
+void Xxh64::reset(uint64_t seed) {
+    m_seed = seed;
+    m_lanes[0] = seed + PRIME1 + PRIME2;
+    m_lanes[1] = seed + PRIME2;
+    m_lanes[2] = seed;
+    m_lanes[3] = seed - PRIME1;
+    m_totalLength = 0;
+    m_bufferSize = 0;
+}
+
+void Xxh64::update(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    m_totalLength += size;
+
+    // Complete a stripe left over from the previous call
+    if (m_bufferSize > 0) {
+        const size_t take = std::min(size, STRIPE_BYTES - m_bufferSize);
+        std::memcpy(m_buffer + m_bufferSize, p, take);
+        m_bufferSize += take;
+        p += take;
+        size -= take;
+        if (m_bufferSize < STRIPE_BYTES) {
+            return;
+        }
+        consumeStripe(m_lanes, m_buffer);
+        m_bufferSize = 0;
+    }
+
+    // Lanes stay in registers across the bulk loop
+    uint64_t lanes[4] = { m_lanes[0], m_lanes[1], m_lanes[2], m_lanes[3] };
+    while (size >= STRIPE_BYTES) {
+        consumeStripe(lanes, p);
+        p += STRIPE_BYTES;
+        size -= STRIPE_BYTES;
+    }
+    std::memcpy(m_lanes, lanes, sizeof(lanes));
+
+    if (size > 0) {
+        std::memcpy(m_buffer, p, size);
+        m_bufferSize = size;
+    }
+}
+
+uint64_t Xxh64::digest() const {
+    uint64_t hash;
+    if (m_totalLength >= STRIPE_BYTES) {
+        hash = rotl(m_lanes[0], 1) + rotl(m_lanes[1], 7) + rotl(m_lanes[2], 12) + rotl(m_lanes[3], 18);
+        for (uint64_t lane : m_lanes) {
+            hash = mergeRound(hash, lane);
+        }
+    } else {
+        hash = m_seed + PRIME5;
+    }
+    hash += m_totalLength;
+
+    const uint8_t* p = m_buffer;
+    size_t remaining = m_bufferSize;
+    while (remaining >= 8) {
+        hash ^= round(0, read64(p));
+        hash = rotl(hash, 27) * PRIME1 + PRIME4;
+        p += 8;
+        remaining -= 8;
+    }
+    if (remaining >= 4) {
+        hash ^= static_cast<uint64_t>(read32(p)) * PRIME1;
+        hash = rotl(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+        remaining -= 4;
+    }
+    while (remaining > 0) {
+        hash ^= static_cast<uint64_t>(*p) * PRIME5;
+        hash = rotl(hash, 11) * PRIME1;
+        ++p;
+        --remaining;
+    }
+
+    // Avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t Xxh64::hash(const void* data, size_t size, uint64_t seed) {
+    Xxh64 state(seed);
+    state.update(data, size);
+    return state.digest();
+}
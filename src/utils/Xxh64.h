@@ -0,0 +1,38 @@
+/*
+ * Author: KleaSCM
+ * Email: KleaSCM@gmail.com
+ * File: Xxh64.h
+ * Description: Streaming XXH64 hash for content identity (not cryptographic)
+ *
+ * Mathematical Foundation:
+ * - Four 64-bit lanes each absorb one 8-byte word of every 32-byte stripe:
+ *   lane = rotl(lane + word * P2, 31) * P1
+ * - The lanes are merged, the tail is folded in 8/4/1 bytes at a time, and a final
+ *   xor-shift-multiply avalanche spreads every input bit over the whole digest
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class Xxh64 {
+public:
+    explicit Xxh64(uint64_t seed = 0);
+
+    void reset(uint64_t seed = 0);
+    void update(const void* data, size_t size);
+    uint64_t digest() const;
+
+    // One-shot convenience
+    static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+
+private:
+    static constexpr size_t STRIPE_BYTES = 32;
+
+    uint64_t m_lanes[4];
+    uint64_t m_seed;
+    uint64_t m_totalLength;
+    uint8_t m_buffer[STRIPE_BYTES];     // Partial stripe carried between updates
+    size_t m_bufferSize;
+};
@@ -27,7 +27,7 @@ target("caithe")
 
 target("test_core_functionality_simple")
     set_kind("binary")
-    add_files("Tests/test_core_functionality_simple.cpp", "src/core/*.cpp", "src/utils/*.cpp")
+    add_files("Tests/test_core_functionality_simple.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
     
     -- Add packages (without imgui for testing)
     add_packages("stb", "nlohmann_json")
@@ -46,7 +46,7 @@ target("test_core_functionality_simple")
 
 target("test_real_wallpaper")
     set_kind("binary")
-    add_files("Tests/test_real_wallpaper.cpp", "src/core/*.cpp", "src/utils/*.cpp")
+    add_files("Tests/test_real_wallpaper.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
     
     -- Add packages (without imgui for testing)
     add_packages("stb", "nlohmann_json")
@@ -65,7 +65,7 @@ target("test_real_wallpaper")
 
 target("test_mathematical_algorithms")
     set_kind("binary")
-    add_files("Tests/test_mathematical_algorithms.cpp", "src/core/*.cpp", "src/utils/*.cpp")
+    add_files("Tests/test_mathematical_algorithms.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
     
     -- Add packages (without imgui for testing)
     add_packages("stb", "nlohmann_json")
@@ -84,7 +84,7 @@ target("test_mathematical_algorithms")
 
 target("test_core_functionality")
     set_kind("binary")
-    add_files("Tests/test_core_functionality.cpp", "src/core/*.cpp", "src/utils/*.cpp")
+    add_files("Tests/test_core_functionality.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
     
     -- Add packages (without imgui for testing)
     add_packages("stb", "nlohmann_json")
@@ -103,7 +103,7 @@ target("test_core_functionality")
 
 target("test_wallpaper_integration")
     set_kind("binary")
-    add_files("Tests/test_wallpaper_integration.cpp", "src/core/*.cpp", "src/utils/*.cpp")
+    add_files("Tests/test_wallpaper_integration.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
     
     -- Add packages (without imgui for testing)
     add_packages("stb", "nlohmann_json")
@@ -122,7 +122,7 @@ target("test_wallpaper_integration")
 
 target("test_cache_implementation")
     set_kind("binary")
-    add_files("Tests/test_cache_implementation.cpp", "src/core/*.cpp", "src/utils/*.cpp")
+    add_files("Tests/test_cache_implementation.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
     
     -- Add packages (without imgui for testing)
     add_packages("stb", "nlohmann_json")
@@ -158,6 +158,420 @@ target("test_config_manager")
     -- Set output directory
     set_targetdir("build")
 
+target("test_png_decoder")
+    set_kind("binary")
+    add_files("Tests/test_png_decoder.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (stb_image is the differential reference)
+    add_packages("stb")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+
+target("test_jpeg_preview")
+    set_kind("binary")
+    add_files("Tests/test_jpeg_preview.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (stb_image is the full-decode reference)
+    add_packages("stb")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_image_orientation")
+    set_kind("binary")
+    add_files("Tests/test_image_orientation.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("X11", "Xrandr", "Xinerama", "dl", "pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_content_hashing")
+    set_kind("binary")
+    add_files("Tests/test_content_hashing.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_perceptual_hash")
+    set_kind("binary")
+    add_files("Tests/test_perceptual_hash.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+
+target("test_metadata_columns")
+    set_kind("binary")
+    add_files("Tests/test_metadata_columns.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+
+target("test_tag_index")
+    set_kind("binary")
+    add_files("Tests/test_tag_index.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+
+target("test_color_search")
+    set_kind("binary")
+    add_files("Tests/test_color_search.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+
+target("test_wallpaper_rules")
+    set_kind("binary")
+    add_files("Tests/test_wallpaper_rules.cpp", "src/rules/*.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+
+target("test_workspace_wallpapers")
+    set_kind("binary")
+    add_files("Tests/test_workspace_wallpapers.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("X11", "Xrandr", "Xinerama", "dl", "pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_power_policy")
+    set_kind("binary")
+    add_files("Tests/test_power_policy.cpp", "src/utils/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_page_prefetch")
+    set_kind("binary")
+    add_files("Tests/test_page_prefetch.cpp", "src/utils/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_file_browser")
+    set_kind("binary")
+    add_files("Tests/test_file_browser.cpp", "src/ui/FileBrowser.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_metadata_cache")
+    set_kind("binary")
+    add_files("Tests/test_metadata_cache.cpp", "src/utils/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_mount_guard")
+    set_kind("binary")
+    add_files("Tests/test_mount_guard.cpp", "src/utils/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_batch_probe")
+    set_kind("binary")
+    add_files("Tests/test_batch_probe.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_logger")
+    set_kind("binary")
+    add_files("Tests/test_logger.cpp", "src/utils/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_operation_trace")
+    set_kind("binary")
+    add_files("Tests/test_operation_trace.cpp", "src/core/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("X11", "Xrandr", "Xinerama", "dl", "pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_wallpaper_daemon")
+    set_kind("binary")
+    add_files("Tests/test_wallpaper_daemon.cpp", "src/daemon/*.cpp", "src/core/*.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("X11", "Xrandr", "Xinerama", "dl", "pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_state_segment")
+    set_kind("binary")
+    add_files("Tests/test_state_segment.cpp", "src/daemon/StateSegment.cpp")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("caithe_loadgen")
+    set_kind("binary")
+    add_files("Tools/caithe_loadgen.cpp", "src/daemon/*.cpp", "src/core/*.cpp", "src/library/*.cpp", "src/utils/*.cpp", "src/imaging/*.cpp")
+    
+    -- Add packages (headless tool, no imgui)
+    add_packages("stb", "nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("X11", "Xrandr", "Xinerama", "dl", "pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
+
+target("test_glyph_cache")
+    set_kind("binary")
+    add_files("Tests/test_glyph_cache.cpp", "src/ui/GlyphCache.cpp", "src/utils/*.cpp")
+    
+    -- Add packages (without imgui for testing)
+    add_packages("nlohmann_json")
+    
+    -- Add system libraries for Linux
+    add_syslinks("pthread")
+    
+    -- Add include directories
+    add_includedirs("src")
+    
+    -- Add compilation flags
+    add_cxflags("-Wall", "-Wextra", "-O2")
+    
+    -- Set output directory
+    set_targetdir("build")
 
 
 --